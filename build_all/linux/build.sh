@@ -9,6 +9,7 @@ build_root=$(cd "${script_dir}/../.." && pwd)
 log_dir=$build_root
 run_e2e_tests=OFF
 run_longhaul_tests=OFF
+run_perf_tests=OFF
 build_amqp=ON
 build_http=ON
 build_mqtt=ON
@@ -33,6 +34,7 @@ usage ()
     echo " --run-e2e-tests               run the end-to-end tests (e2e tests are skipped by default)"
     echo " --run-unittests               run the unit tests"
     echo " --run-longhaul-tests          run long haul tests (long haul tests are not run by default)"
+    echo " --run-perf-tests              build and run the performance tests with the unit tests"
     echo ""
     echo " --no-amqp                     do no build AMQP transport and samples"
     echo " --no-http                     do no build HTTP transport and samples"
@@ -87,6 +89,7 @@ process_args ()
               "--run-e2e-tests" ) run_e2e_tests=ON;;
               "--run-unittests" ) run_unittests=ON;;
               "--run-longhaul-tests" ) run_longhaul_tests=ON;;
+              "--run-perf-tests" ) run_perf_tests=ON;;
               "--no-amqp" ) build_amqp=OFF;;
               "--no-http" ) build_http=OFF;;
               "--no-mqtt" ) build_mqtt=OFF;;
@@ -121,7 +124,7 @@ process_args $*
 rm -r -f $build_folder
 mkdir -p $build_folder
 pushd $build_folder
-cmake $toolchainfile $cmake_install_prefix -Drun_valgrind:BOOL=$run_valgrind -DcompileOption_C:STRING="$extracloptions" -Drun_e2e_tests:BOOL=$run_e2e_tests -Drun_longhaul_tests=$run_longhaul_tests -Duse_amqp:BOOL=$build_amqp -Duse_http:BOOL=$build_http -Duse_mqtt:BOOL=$build_mqtt -Ddont_use_uploadtoblob:BOOL=$no_blob -Drun_unittests:BOOL=$run_unittests -Dbuild_python:STRING=$build_python -Dbuild_javawrapper:BOOL=$build_javawrapper -Dno_logging:BOOL=$no_logging $build_root -Dwip_use_c2d_amqp_methods:BOOL=$wip_use_c2d_amqp_methods
+cmake $toolchainfile $cmake_install_prefix -Drun_valgrind:BOOL=$run_valgrind -DcompileOption_C:STRING="$extracloptions" -Drun_e2e_tests:BOOL=$run_e2e_tests -Drun_longhaul_tests=$run_longhaul_tests -Drun_perf_tests:BOOL=$run_perf_tests -Duse_amqp:BOOL=$build_amqp -Duse_http:BOOL=$build_http -Duse_mqtt:BOOL=$build_mqtt -Ddont_use_uploadtoblob:BOOL=$no_blob -Drun_unittests:BOOL=$run_unittests -Dbuild_python:STRING=$build_python -Dbuild_javawrapper:BOOL=$build_javawrapper -Dno_logging:BOOL=$no_logging $build_root -Dwip_use_c2d_amqp_methods:BOOL=$wip_use_c2d_amqp_methods
 
 if [ "$make" = true ]
 then
@@ -116,6 +116,31 @@ extern "C"
     */
     MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, IoTHubClient_SendEventAsync, IOTHUB_CLIENT_HANDLE, iotHubClientHandle, IOTHUB_MESSAGE_HANDLE, eventMessageHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK, eventConfirmationCallback, void*, userContextCallback);
 
+    /**
+    * @brief	Asynchronous call to send the message specified by @p eventMessageHandle,
+    *			transferring the ownership of the message to the client.
+    *
+    * @param	iotHubClientHandle		   	The handle created by a call to the create function.
+    * @param	eventMessageHandle		   	The handle to an IoT Hub message. Unlike
+    * 										::IoTHubClient_SendEventAsync the message is not
+    * 										cloned. On success the client owns the message and
+    * 										destroys it once the send completes, so the caller
+    * 										shall not use or destroy it anymore. On failure the
+    * 										caller keeps the ownership of the message.
+    * @param	eventConfirmationCallback  	The callback specified by the device for receiving
+    * 										confirmation of the delivery of the IoT Hub message.
+    * 										The user can specify a @c NULL value here to
+    * 										indicate that no callback is required.
+    * @param	userContextCallback			User specified context that will be provided to the
+    * 										callback. This can be @c NULL.
+    *
+    *			@b NOTE: The application behavior is undefined if the user calls
+    *			the ::IoTHubClient_Destroy function from within any callback.
+    *
+    * @return	IOTHUB_CLIENT_OK upon success or an error code upon failure.
+    */
+    MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, IoTHubClient_SendEventAsync_Move, IOTHUB_CLIENT_HANDLE, iotHubClientHandle, IOTHUB_MESSAGE_HANDLE, eventMessageHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK, eventConfirmationCallback, void*, userContextCallback);
+
     /**
     * @brief	This function returns the current sending status for IoTHubClient.
     *
@@ -164,6 +189,21 @@ extern "C"
     */
     MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, IoTHubClient_SetConnectionStatusCallback, IOTHUB_CLIENT_HANDLE, iotHubClientHandle, IOTHUB_CLIENT_CONNECTION_STATUS_CALLBACK, connectionStatusCallback, void*, userContextCallback);
 
+    /**
+    * @brief	Starts connecting to IoT Hub now instead of when the first message
+    * is sent, see ::IoTHubClient_LL_Connect. This call does not wait for the connection.
+    *
+    * @param	iotHubClientHandle		   	        The handle created by a call to the create function.
+    * @param	connectCallback     	   	        The callback invoked once, from the thread running the
+    * 										        callbacks, with the first connection status reported
+    * 										        after this call. This can be @c NULL.
+    * @param	userContextCallback			        User specified context that will be provided to the
+    * 										        callback. This can be @c NULL.
+    *
+    * @return	IOTHUB_CLIENT_OK upon success or an error code upon failure.
+    */
+    MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, IoTHubClient_Connect, IOTHUB_CLIENT_HANDLE, iotHubClientHandle, IOTHUB_CLIENT_CONNECTION_STATUS_CALLBACK, connectCallback, void*, userContextCallback);
+
     /**
     * @brief	Sets up the connection status callback to be invoked representing the status of
     * the connection to IOT Hub. This is a blocking call.
@@ -210,6 +250,20 @@ extern "C"
     */
     MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, IoTHubClient_GetLastMessageReceiveTime, IOTHUB_CLIENT_HANDLE, iotHubClientHandle, time_t*, lastMessageReceiveTime);
 
+    /**
+    * @brief	This function returns in the out parameter @p statistics the runtime
+    * 			statistics of the client, see ::IoTHubClient_LL_GetStatistics.
+    *
+    * @param	iotHubClientHandle	The handle created by a call to the create function.
+    * @param	statistics			Out parameter receiving the statistics.
+    *
+    *			Events submitted by ::IoTHubClient_SendEventAsync that the worker
+    *			thread did not pick up yet are not counted.
+    *
+    * @return	IOTHUB_CLIENT_OK upon success or an error code upon failure.
+    */
+    MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, IoTHubClient_GetStatistics, IOTHUB_CLIENT_HANDLE, iotHubClientHandle, IOTHUB_CLIENT_STATISTICS*, statistics);
+
     /**
     * @brief	This API sets a runtime option identified by parameter @p optionName
     * 			to a value pointed to by @p value. @p optionName and the data type
@@ -330,6 +384,9 @@ extern "C"
     /**
     * @brief	IoTHubClient_UploadToBlobAsync uploads data from memory to a file in Azure Blob Storage.
     *
+    *           The upload runs on its own thread without blocking telemetry, messages or methods.
+    *           The x509certificate, x509privatekey and TrustedCerts options cannot be changed while an upload is in progress.
+    *
     * @param	iotHubClientHandle	                The handle created by a call to the IoTHubClient_Create function.
     * @param	destinationFileName	                The name of the file to be created in Azure Blob Storage.
     * @param	source                              The source of data.
@@ -0,0 +1,67 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file iothub_client_compression.h
+*	@brief Codecs compressing the content of the events sent by IoTHubClient_LL.
+*
+*	@details A codec is set on a client with OPTION_COMPRESSION_CODEC. The
+*	         content of every event at least OPTION_COMPRESSION_MIN_SIZE bytes
+*	         long is then compressed before it is queued, for all transports,
+*	         and the event gets a "content-encoding" application property
+*	         holding the content encoding of the codec so that the receiving
+*	         side knows how to decompress it. Events that do not get smaller,
+*	         or that already have a "content-encoding" property, are sent as is.
+*	         IoTHubCompression_DeflateCodec is the built-in codec; an application
+*	         can plug its own by filling an IOTHUB_CLIENT_COMPRESSION_CODEC that
+*	         outlives the clients it is set on.
+*/
+
+#ifndef IOTHUB_CLIENT_COMPRESSION_H
+#define IOTHUB_CLIENT_COMPRESSION_H
+
+#include <stddef.h>
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*name of the application property holding the content encoding of a compressed event*/
+#define IOTHUB_CLIENT_CONTENT_ENCODING_PROPERTY "content-encoding"
+
+/*content smaller than this is not compressed unless OPTION_COMPRESSION_MIN_SIZE says otherwise*/
+#define IOTHUB_CLIENT_COMPRESSION_DEFAULT_MIN_SIZE 128
+
+/*compresses the size bytes at source into the *destinationSize bytes at destination. Returns 0 and sets *destinationSize
+to the size of the compressed content when it fits, anything else when it does not fit or cannot be compressed*/
+typedef int(*IOTHUB_CLIENT_COMPRESS)(const unsigned char* source, size_t size, unsigned char* destination, size_t* destinationSize);
+
+typedef struct IOTHUB_CLIENT_COMPRESSION_CODEC_TAG
+{
+    const char* contentEncoding; /*value of the "content-encoding" property of the compressed events*/
+    IOTHUB_CLIENT_COMPRESS compress;
+} IOTHUB_CLIENT_COMPRESSION_CODEC;
+
+/**
+* @brief	Compresses @p source in the zlib format (RFC 1950) with a single
+*			deflate block (RFC 1951) of fixed Huffman codes, which any inflate
+*			implementation reads. It favours speed over ratio: every position
+*			is matched against the last one with the same 3 bytes only.
+*
+* @return	0 on success, a non-zero value if the compressed content does not
+*			fit in @p *destinationSize bytes or on failure.
+*/
+MOCKABLE_FUNCTION(, int, IoTHubCompression_Deflate, const unsigned char*, source, size_t, size, unsigned char*, destination, size_t*, destinationSize);
+
+/**
+* @brief	The built-in codec, compressing with IoTHubCompression_Deflate and
+*			setting "content-encoding" to "deflate".
+*/
+MOCKABLE_FUNCTION(, const IOTHUB_CLIENT_COMPRESSION_CODEC*, IoTHubCompression_DeflateCodec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IOTHUB_CLIENT_COMPRESSION_H */
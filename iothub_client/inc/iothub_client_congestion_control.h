@@ -0,0 +1,49 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file iothub_client_congestion_control.h
+*	@brief AIMD congestion window, used by the IoTHubClient_LL layer to bound
+*	       the events the transport has in flight when
+*	       OPTION_CONGESTION_CONTROL_MAX_WINDOW is set.
+*
+*	@details The window starts at 1 event and grows by 1 per acknowledged event
+*	         until the first sign of congestion (slow start), then by 1 per
+*	         window of acknowledged events (additive increase). It is halved
+*	         (multiplicative decrease) when an event fails or times out, or
+*	         when the latency from send to acknowledgement grows well above the
+*	         lowest latency seen recently, which is how a throttling hub shows
+*	         before it drops the connection. It is decreased at most once per
+*	         round trip, and does not grow during that round trip.
+*/
+
+#ifndef IOTHUB_CLIENT_CONGESTION_CONTROL_H
+#define IOTHUB_CLIENT_CONGESTION_CONTROL_H
+
+#include <stddef.h>
+#include "azure_c_shared_utility/tickcounter.h"
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*a latency above CONGESTION_CONTROL_LATENCY_FACTOR times the base latency plus CONGESTION_CONTROL_LATENCY_SLACK_MS is a sign of congestion*/
+#define CONGESTION_CONTROL_LATENCY_FACTOR 2
+#define CONGESTION_CONTROL_LATENCY_SLACK_MS 50
+/*the base latency is the lowest latency of the last 1 or 2 periods of this length, so that it follows a change of route*/
+#define CONGESTION_CONTROL_BASE_LATENCY_PERIOD_MS 10000
+
+typedef struct CONGESTION_CONTROL_INSTANCE_TAG* CONGESTION_CONTROL_HANDLE;
+
+MOCKABLE_FUNCTION(, CONGESTION_CONTROL_HANDLE, congestion_control_create, size_t, max_window);
+MOCKABLE_FUNCTION(, void, congestion_control_destroy, CONGESTION_CONTROL_HANDLE, handle);
+MOCKABLE_FUNCTION(, void, congestion_control_on_ack, CONGESTION_CONTROL_HANDLE, handle, tickcounter_ms_t, latency, tickcounter_ms_t, current_ms);
+MOCKABLE_FUNCTION(, void, congestion_control_on_failure, CONGESTION_CONTROL_HANDLE, handle, tickcounter_ms_t, current_ms);
+MOCKABLE_FUNCTION(, size_t, congestion_control_get_window, CONGESTION_CONTROL_HANDLE, handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IOTHUB_CLIENT_CONGESTION_CONTROL_H */
@@ -0,0 +1,51 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file iothub_client_journal.h
+*	@brief Append only, disk backed journal used by IoTHubClient_LL to keep the
+*	       outbound events that are not yet confirmed by IoT Hub across restarts.
+*
+*	@details The journal is a directory of numbered segment files. Records are
+*	         appended to the newest segment and numbered with a sequence that
+*	         grows by one for every record. Appending only writes to the stdio
+*	         buffer of the segment; journal_commit makes all the records appended
+*	         since the previous commit durable at once (group commit).
+*	         A record is confirmed with journal_confirm once it is no longer
+*	         needed. Segments are deleted, oldest first, when all their records
+*	         are confirmed. journal_create replays the records that were not
+*	         confirmed when the journal was last used, in the order they were
+*	         appended.
+*	         A journal is not thread safe, it is used under the same lock as the
+*	         client that owns it.
+*/
+
+#ifndef IOTHUB_CLIENT_JOURNAL_H
+#define IOTHUB_CLIENT_JOURNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define JOURNAL_DEFAULT_SEGMENT_SIZE (1024 * 1024)
+
+typedef struct JOURNAL_INSTANCE_TAG* JOURNAL_HANDLE;
+
+/*returning a non-zero value tells the journal that the record will never be confirmed, it is confirmed right away*/
+typedef int(*JOURNAL_REPLAY_CALLBACK)(const unsigned char* record, size_t size, uint64_t sequence, void* context);
+
+MOCKABLE_FUNCTION(, JOURNAL_HANDLE, journal_create, const char*, directory, size_t, segment_size, JOURNAL_REPLAY_CALLBACK, replay_callback, void*, replay_context);
+MOCKABLE_FUNCTION(, void, journal_destroy, JOURNAL_HANDLE, handle);
+MOCKABLE_FUNCTION(, int, journal_append, JOURNAL_HANDLE, handle, const unsigned char*, record, size_t, size, uint64_t*, sequence);
+MOCKABLE_FUNCTION(, int, journal_commit, JOURNAL_HANDLE, handle);
+MOCKABLE_FUNCTION(, int, journal_confirm, JOURNAL_HANDLE, handle, uint64_t, sequence);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IOTHUB_CLIENT_JOURNAL_H */
@@ -31,7 +31,8 @@
     IOTHUB_CLIENT_INVALID_ARG,            \
     IOTHUB_CLIENT_ERROR,                  \
     IOTHUB_CLIENT_INVALID_SIZE,           \
-    IOTHUB_CLIENT_INDEFINITE_TIME
+    IOTHUB_CLIENT_INDEFINITE_TIME,        \
+    IOTHUB_CLIENT_QUEUE_FULL
 
 /** @brief Enumeration specifying the status of calls to various APIs in this module.
 */
@@ -93,12 +94,23 @@ DEFINE_ENUM(IOTHUBMESSAGE_DISPOSITION_RESULT, IOTHUBMESSAGE_DISPOSITION_RESULT_V
 #include "azure_c_shared_utility/agenttime.h"
 #include "azure_c_shared_utility/xio.h"
 #include "azure_c_shared_utility/doublylinkedlist.h"
+#include "azure_c_shared_utility/tickcounter.h"
 #include "iothub_message.h"
 #include "iothub_transport_ll.h"
 #include "iothub_client_authorization.h"
 #include <stddef.h>
 #include <stdint.h>
 
+/** @brief Value returned by ::IoTHubClient_LL_GetNextDeadline when no timed work is pending.
+*/
+#define IOTHUB_CLIENT_LL_NO_DEADLINE ((tickcounter_ms_t)-1)
+
+/** @brief Number of buckets of the latency histogram returned by ::IoTHubClient_LL_GetStatistics.
+*		   Bucket 0 counts the latencies under 1 ms, bucket i the latencies from 2^(i-1)
+*		   to 2^i - 1 ms and the last bucket all the longer latencies.
+*/
+#define IOTHUB_CLIENT_LATENCY_HISTOGRAM_BUCKETS 20
+
 #define IOTHUB_CLIENT_IOTHUB_METHOD_STATUS_VALUES \
     IOTHUB_CLIENT_IOTHUB_METHOD_STATUS_SUCCESS,   \
     IOTHUB_CLIENT_IOTHUB_METHOD_STATUS_ERROR      \
@@ -116,7 +128,9 @@ extern "C"
     IOTHUB_CLIENT_CONFIRMATION_OK,                   \
     IOTHUB_CLIENT_CONFIRMATION_BECAUSE_DESTROY,      \
     IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT,      \
-    IOTHUB_CLIENT_CONFIRMATION_ERROR                 \
+    IOTHUB_CLIENT_CONFIRMATION_ERROR,                \
+    IOTHUB_CLIENT_CONFIRMATION_DROPPED,              \
+    IOTHUB_CLIENT_CONFIRMATION_MESSAGE_EXPIRED       \
 
     /** @brief Enumeration passed in by the IoT Hub when the event confirmation
     *		   callback is invoked to indicate status of the event processing in
@@ -124,6 +138,30 @@ extern "C"
     */
     DEFINE_ENUM(IOTHUB_CLIENT_CONFIRMATION_RESULT, IOTHUB_CLIENT_CONFIRMATION_RESULT_VALUES);
 
+#define IOTHUB_CLIENT_OUTBOUND_QUEUE_POLICY_VALUES      \
+    IOTHUB_CLIENT_OUTBOUND_QUEUE_REJECT_NEW,            \
+    IOTHUB_CLIENT_OUTBOUND_QUEUE_DROP_OLDEST,           \
+    IOTHUB_CLIENT_OUTBOUND_QUEUE_DROP_LOWEST_PRIORITY   \
+
+    /** @brief Enumeration of what IoTHubClient_LL does with a new message when the
+    *		   outbound queue has reached the "outbound_queue_max_messages" or
+    *		   "outbound_queue_max_bytes" limits: fail the send with
+    *		   IOTHUB_CLIENT_QUEUE_FULL, drop the oldest queued messages or drop the
+    *		   oldest queued messages of the lowest priority. Dropped messages are
+    *		   completed with IOTHUB_CLIENT_CONFIRMATION_DROPPED.
+    */
+    DEFINE_ENUM(IOTHUB_CLIENT_OUTBOUND_QUEUE_POLICY, IOTHUB_CLIENT_OUTBOUND_QUEUE_POLICY_VALUES);
+
+#define IOTHUB_CLIENT_OUTBOUND_QUEUE_STATE_VALUES       \
+    IOTHUB_CLIENT_OUTBOUND_QUEUE_HIGH_WATER_MARK,       \
+    IOTHUB_CLIENT_OUTBOUND_QUEUE_LOW_WATER_MARK         \
+
+    /** @brief Enumeration passed to the outbound queue callback when the outbound
+    *		   queue fills up past its high water mark or drains down to its low
+    *		   water mark.
+    */
+    DEFINE_ENUM(IOTHUB_CLIENT_OUTBOUND_QUEUE_STATE, IOTHUB_CLIENT_OUTBOUND_QUEUE_STATE_VALUES);
+
 #define IOTHUB_CLIENT_CONNECTION_STATUS_VALUES             \
     IOTHUB_CLIENT_CONNECTION_AUTHENTICATED,                \
     IOTHUB_CLIENT_CONNECTION_UNAUTHENTICATED               \
@@ -162,7 +200,28 @@ extern "C"
 
     DEFINE_ENUM(DEVICE_TWIN_UPDATE_STATE, DEVICE_TWIN_UPDATE_STATE_VALUES);
 
+    /** @brief Runtime statistics of a client, returned by ::IoTHubClient_LL_GetStatistics.
+    *		   The counters of events count from the creation of the client.
+    */
+    struct IOTHUB_CLIENT_STATISTICS_TAG
+    {
+        size_t queue_depth;             /*events waiting in the client for the transport to send them*/
+        size_t in_flight;               /*events the transport is sending and that are not acknowledged yet, of all its devices when it is shared*/
+        size_t events_queued;           /*events accepted by the send functions*/
+        size_t events_sent;             /*events completed with IOTHUB_CLIENT_CONFIRMATION_OK*/
+        size_t events_failed;           /*events completed with IOTHUB_CLIENT_CONFIRMATION_ERROR or IOTHUB_CLIENT_CONFIRMATION_BECAUSE_DESTROY*/
+        size_t events_timed_out;        /*events completed with IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT*/
+        size_t events_dropped;          /*events completed with IOTHUB_CLIENT_CONFIRMATION_DROPPED*/
+        size_t events_expired;          /*events completed with IOTHUB_CLIENT_CONFIRMATION_MESSAGE_EXPIRED*/
+        uint64_t bytes_sent;            /*payload bytes of the events completed with IOTHUB_CLIENT_CONFIRMATION_OK*/
+        size_t retries;                 /*events the transport sent again because their acknowledgement did not arrive*/
+        size_t reconnects;              /*connections the transport opened again after the first one*/
+        size_t congestion_window;       /*events the congestion control lets the transport have in flight, 0 when "congestion_control_max_window" is not set*/
+        size_t latency_histogram[IOTHUB_CLIENT_LATENCY_HISTOGRAM_BUCKETS]; /*time from sending, or from queueing when the send time is not known, to IOTHUB_CLIENT_CONFIRMATION_OK, see IOTHUB_CLIENT_LATENCY_HISTOGRAM_BUCKETS*/
+    };
+
     typedef void(*IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK)(IOTHUB_CLIENT_CONFIRMATION_RESULT result, void* userContextCallback);
+    typedef void(*IOTHUB_CLIENT_OUTBOUND_QUEUE_CALLBACK)(IOTHUB_CLIENT_OUTBOUND_QUEUE_STATE state, void* userContextCallback);
     typedef void(*IOTHUB_CLIENT_CONNECTION_STATUS_CALLBACK)(IOTHUB_CLIENT_CONNECTION_STATUS result, IOTHUB_CLIENT_CONNECTION_STATUS_REASON reason, void* userContextCallback);
     typedef IOTHUBMESSAGE_DISPOSITION_RESULT (*IOTHUB_CLIENT_MESSAGE_CALLBACK_ASYNC)(IOTHUB_MESSAGE_HANDLE message, void* userContextCallback);
     typedef const TRANSPORT_PROVIDER*(*IOTHUB_CLIENT_TRANSPORT_PROVIDER)(void);
@@ -309,6 +368,53 @@ extern "C"
     */
      MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, IoTHubClient_LL_SendEventAsync, IOTHUB_CLIENT_LL_HANDLE, iotHubClientHandle, IOTHUB_MESSAGE_HANDLE, eventMessageHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK, eventConfirmationCallback, void*, userContextCallback);
 
+    /**
+    * @brief	Asynchronous call to send the message specified by @p eventMessageHandle,
+    *			transferring the ownership of the message to the client.
+    *
+    * @param	iotHubClientHandle		   	The handle created by a call to the create function.
+    * @param	eventMessageHandle		   	The handle to an IoT Hub message. Unlike
+    * 										::IoTHubClient_LL_SendEventAsync the message is not
+    * 										cloned. On success the client owns the message and
+    * 										destroys it once the send completes, so the caller
+    * 										shall not use or destroy it anymore. On failure the
+    * 										caller keeps the ownership of the message.
+    * @param	eventConfirmationCallback  	The callback specified by the device for receiving
+    * 										confirmation of the delivery of the IoT Hub message.
+    * 										The user can specify a @c NULL value here to
+    * 										indicate that no callback is required.
+    * @param	userContextCallback			User specified context that will be provided to the
+    * 										callback. This can be @c NULL.
+    *
+    * @return	IOTHUB_CLIENT_OK upon success or an error code upon failure.
+    */
+     MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, IoTHubClient_LL_SendEventAsync_Move, IOTHUB_CLIENT_LL_HANDLE, iotHubClientHandle, IOTHUB_MESSAGE_HANDLE, eventMessageHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK, eventConfirmationCallback, void*, userContextCallback);
+
+    /**
+    * @brief	Asynchronous call to send the @p messageCount messages of @p eventMessageHandles
+    *			in one call.
+    *
+    * @param	iotHubClientHandle		   	The handle created by a call to the create function.
+    * @param	eventMessageHandles		   	An array of @p messageCount handles to IoT Hub
+    * 										messages. Like ::IoTHubClient_LL_SendEventAsync the
+    * 										messages are cloned, the caller keeps ownership of
+    * 										the array and of the messages.
+    * @param	messageCount			   	The number of messages in @p eventMessageHandles.
+    * @param	eventConfirmationCallback  	The callback called once for every message of the
+    * 										batch with the confirmation of its delivery. The
+    * 										user can specify a @c NULL value here to indicate
+    * 										that no callback is required.
+    * @param	userContextCallback			User specified context that will be provided to the
+    * 										callback. This can be @c NULL.
+    *
+    *			The batch is queued as a whole: if queueing any of the messages fails no
+    *			message of the batch is sent and no callback is called. All the messages
+    *			of the batch share the same timeout.
+    *
+    * @return	IOTHUB_CLIENT_OK upon success or an error code upon failure.
+    */
+     MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, IoTHubClient_LL_SendEventBatchAsync, IOTHUB_CLIENT_LL_HANDLE, iotHubClientHandle, const IOTHUB_MESSAGE_HANDLE*, eventMessageHandles, size_t, messageCount, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK, eventConfirmationCallback, void*, userContextCallback);
+
     /**
     * @brief	This function returns the current sending status for IoTHubClient.
     *
@@ -357,6 +463,47 @@ extern "C"
     */
      MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, IoTHubClient_LL_SetConnectionStatusCallback, IOTHUB_CLIENT_LL_HANDLE, iotHubClientHandle, IOTHUB_CLIENT_CONNECTION_STATUS_CALLBACK, connectionStatusCallback, void*, userContextCallback);
 
+    /**
+    * @brief	Starts connecting to IoT Hub now instead of when the first message
+    * is sent, so that a device can open the connection at boot and send its
+    * first message with the latency of an open connection.
+    *
+    * @param	iotHubClientHandle		   	        The handle created by a call to the create function.
+    * @param	connectCallback     	   	        The callback invoked once, with the first connection
+    * 										        status reported after this call (or right away if the
+    * 										        client is already connected). This can be @c NULL.
+    * @param	userContextCallback			        User specified context that will be provided to the
+    * 										        callback. This can be @c NULL.
+    *
+    *			The function runs ::IoTHubClient_LL_DoWork once, which is where the
+    *			transport connects; the connection then completes over the
+    *			following calls to ::IoTHubClient_LL_DoWork. The HTTP transport keeps
+    *			no connection and reports no connection status, so with it
+    *			@p connectCallback is never invoked.
+    *
+    * @return	IOTHUB_CLIENT_OK upon success or an error code upon failure.
+    */
+     MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, IoTHubClient_LL_Connect, IOTHUB_CLIENT_LL_HANDLE, iotHubClientHandle, IOTHUB_CLIENT_CONNECTION_STATUS_CALLBACK, connectCallback, void*, userContextCallback);
+
+    /**
+    * @brief	Sets up the callback invoked when the outbound queue (the messages
+    * given to ::IoTHubClient_LL_SendEventAsync and not completed yet) fills up
+    * past the "outbound_queue_high_water_mark" percentage of its limits, and
+    * again when it drains down to the "outbound_queue_low_water_mark" percentage,
+    * so producers can throttle before the queue is full.
+    *
+    * @param	iotHubClientHandle		   	        The handle created by a call to the create function.
+    * @param	outboundQueueCallback     	   	    The callback, @c NULL to stop the notifications.
+    * @param	userContextCallback			        User specified context that will be provided to the
+    * 										        callback. This can be @c NULL.
+    *
+    *			@b NOTE: The callback is invoked from ::IoTHubClient_LL_SendEventAsync
+    *			and ::IoTHubClient_LL_DoWork, it shall not call ::IoTHubClient_LL_Destroy.
+    *
+    * @return	IOTHUB_CLIENT_OK upon success or an error code upon failure.
+    */
+     MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, IoTHubClient_LL_SetOutboundQueueCallback, IOTHUB_CLIENT_LL_HANDLE, iotHubClientHandle, IOTHUB_CLIENT_OUTBOUND_QUEUE_CALLBACK, outboundQueueCallback, void*, userContextCallback);
+
     /**
     * @brief	Sets up the connection status callback to be invoked representing the status of
     * the connection to IOT Hub. This is a blocking call.
@@ -416,6 +563,49 @@ extern "C"
     */
      MOCKABLE_FUNCTION(, void, IoTHubClient_LL_DoWork, IOTHUB_CLIENT_LL_HANDLE, iotHubClientHandle);
 
+    /**
+    * @brief	This function returns in the out parameter @p msUntilNextDeadline
+    * 			the number of milliseconds after which ::IoTHubClient_LL_DoWork
+    * 			needs to be called again for the pending timed work (message
+    * 			timeouts, transport resends, keep alives, token refreshes,
+    * 			polling) to be processed on time.
+    *
+    * @param	iotHubClientHandle	The handle created by a call to the create function.
+    * @param	msUntilNextDeadline	Out parameter containing the number of milliseconds
+    * 								until the next deadline. A value of 0 means that work
+    * 								is already pending and ::IoTHubClient_LL_DoWork should
+    * 								be called right away. IOTHUB_CLIENT_LL_NO_DEADLINE means
+    * 								that no timed work is pending.
+    *
+    *			Applications running their own event loop can use this value as the
+    *			upper bound of their wait instead of calling ::IoTHubClient_LL_DoWork
+    *			at a fixed period. The value covers only the work the client has
+    *			scheduled itself; data arriving from the network is read by the
+    *			transport inside ::IoTHubClient_LL_DoWork.
+    *
+    * @return	IOTHUB_CLIENT_OK upon success or an error code upon failure.
+    */
+     MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, IoTHubClient_LL_GetNextDeadline, IOTHUB_CLIENT_LL_HANDLE, iotHubClientHandle, tickcounter_ms_t*, msUntilNextDeadline);
+
+    /**
+    * @brief	This function returns in the out parameter @p statistics the
+    * 			runtime statistics of the client: depth of its queue, events
+    * 			in flight, completed events, bytes sent, transport retries and
+    * 			reconnects, congestion window and the histogram of the send-to-acknowledgement latency.
+    *
+    * @param	iotHubClientHandle	The handle created by a call to the create function.
+    * @param	statistics			Out parameter receiving the statistics.
+    *
+    *			The counters are maintained as the events go through the client and
+    *			are only copied by this function, so calling it rarely costs nothing.
+    *			Latencies are measured with the resolution of the calls to
+    *			::IoTHubClient_LL_DoWork. The transport figures (in flight, retries,
+    *			reconnects) are those of the whole transport when it is shared.
+    *
+    * @return	IOTHUB_CLIENT_OK upon success or an error code upon failure.
+    */
+     MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, IoTHubClient_LL_GetStatistics, IOTHUB_CLIENT_LL_HANDLE, iotHubClientHandle, IOTHUB_CLIENT_STATISTICS*, statistics);
+
     /**
     * @brief	This API sets a runtime option identified by parameter @p optionName
     * 			to a value pointed to by @p value. @p optionName and the data type
@@ -0,0 +1,49 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file iothub_client_object_pool.h
+*	@brief Fixed size pool for the small bookkeeping structures that are allocated
+*	       and freed for every message (IOTHUB_MESSAGE_LIST, the transport's per
+*	       message details).
+*
+*	@details All the objects of a pool are carved out of a single allocation made
+*	         when the pool is created. When the pool is exhausted, or when no pool
+*	         is given (NULL handle), object_pool_alloc falls back to malloc and
+*	         object_pool_free to free, so callers do not need to know whether an
+*	         object came from the pool.
+*	         A pool is not thread safe, it is used under the same lock as the
+*	         client or transport that owns it.
+*/
+
+#ifndef IOTHUB_CLIENT_OBJECT_POOL_H
+#define IOTHUB_CLIENT_OBJECT_POOL_H
+
+#include <stddef.h>
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct OBJECT_POOL_INSTANCE_TAG* OBJECT_POOL_HANDLE;
+
+typedef struct OBJECT_POOL_STATISTICS_TAG
+{
+    size_t capacity; /*number of objects held by the pool*/
+    size_t in_use;   /*objects of the pool currently allocated*/
+    size_t hits;     /*allocations served by the pool*/
+    size_t misses;   /*allocations that fell back to malloc because the pool was exhausted*/
+} OBJECT_POOL_STATISTICS;
+
+MOCKABLE_FUNCTION(, OBJECT_POOL_HANDLE, object_pool_create, size_t, object_size, size_t, object_count);
+MOCKABLE_FUNCTION(, void, object_pool_destroy, OBJECT_POOL_HANDLE, handle);
+MOCKABLE_FUNCTION(, void*, object_pool_alloc, OBJECT_POOL_HANDLE, handle, size_t, object_size);
+MOCKABLE_FUNCTION(, void, object_pool_free, OBJECT_POOL_HANDLE, handle, void*, object);
+MOCKABLE_FUNCTION(, int, object_pool_get_statistics, OBJECT_POOL_HANDLE, handle, OBJECT_POOL_STATISTICS*, statistics);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IOTHUB_CLIENT_OBJECT_POOL_H */
@@ -4,6 +4,8 @@
 #ifndef IOTHUB_CLIENT_OPTIONS_H
 #define IOTHUB_CLIENT_OPTIONS_H
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -16,6 +18,15 @@ extern "C"
         const char* password;
     } IOTHUB_PROXY_OPTIONS;
 
+    /*returned by IoTHubClient_LL_GetOption for OPTION_MESSAGE_POOL_STATISTICS*/
+    typedef struct IOTHUB_CLIENT_POOL_STATISTICS_TAG
+    {
+        size_t capacity;
+        size_t in_use;
+        size_t hits;
+        size_t misses;
+    } IOTHUB_CLIENT_POOL_STATISTICS;
+
     static const char* OPTION_LOG_TRACE = "logtrace";
     static const char* OPTION_X509_CERT = "x509certificate";
     static const char* OPTION_X509_PRIVATE_KEY = "x509privatekey";
@@ -34,6 +45,50 @@ extern "C"
 
     static const char* OPTION_PRODUCT_INFO = "product_info";
 
+    static const char* OPTION_DO_WORK_FREQUENCY_IN_MS = "do_work_freq_ms";
+
+    static const char* OPTION_MESSAGE_POOL_SIZE = "message_pool_size";
+    static const char* OPTION_MESSAGE_POOL_STATISTICS = "message_pool_statistics";
+
+    /*most telemetry messages, and bytes of their payload, the MQTT transport has waiting for their PUBACK before it holds back the next ones (size_t*, 0 means no limit)*/
+    static const char* OPTION_MAX_IN_FLIGHT_MESSAGES = "max_in_flight_messages";
+    static const char* OPTION_MAX_IN_FLIGHT_BYTES = "max_in_flight_bytes";
+    /*properties the MQTT transport adds to every telemetry message, formatted once when set (MAP_HANDLE, an empty map removes them)*/
+    static const char* OPTION_STATIC_MESSAGE_PROPERTIES = "static_message_properties";
+    /*true makes the MQTT transport publish telemetry at QoS 0 and confirm it once handed to the socket, without PUBACK nor resend (bool*)*/
+    static const char* OPTION_TELEMETRY_AT_MOST_ONCE = "telemetry_at_most_once";
+
+    /*limits of the outbound queue (size_t*, 0 means no limit), see IOTHUB_CLIENT_OUTBOUND_QUEUE_POLICY*/
+    static const char* OPTION_OUTBOUND_QUEUE_MAX_MESSAGES = "outbound_queue_max_messages";
+    static const char* OPTION_OUTBOUND_QUEUE_MAX_BYTES = "outbound_queue_max_bytes";
+    static const char* OPTION_OUTBOUND_QUEUE_POLICY = "outbound_queue_policy";
+    /*percentages of the limits above at which the outbound queue callback is invoked (size_t*)*/
+    static const char* OPTION_OUTBOUND_QUEUE_HIGH_WATER_MARK = "outbound_queue_high_water_mark";
+    static const char* OPTION_OUTBOUND_QUEUE_LOW_WATER_MARK = "outbound_queue_low_water_mark";
+
+    /*existing directory where the events not yet confirmed are journaled, and replayed from after a restart, not for clients sharing a transport (const char*)*/
+    static const char* OPTION_JOURNAL_DIRECTORY = "journal_directory";
+    /*size of the segment files of the journal, set before OPTION_JOURNAL_DIRECTORY (size_t*)*/
+    static const char* OPTION_JOURNAL_SEGMENT_SIZE = "journal_segment_size";
+
+    /*codec compressing the content of the events before they are queued (const IOTHUB_CLIENT_COMPRESSION_CODEC*, see iothub_client_compression.h)*/
+    static const char* OPTION_COMPRESSION_CODEC = "compression_codec";
+    /*events whose content is smaller are sent uncompressed, IOTHUB_CLIENT_COMPRESSION_DEFAULT_MIN_SIZE by default (size_t*)*/
+    static const char* OPTION_COMPRESSION_MIN_SIZE = "compression_min_size";
+
+    /*most events the congestion window lets the transport have in flight, 0 (the default) disables the congestion control, not for clients sharing a transport (size_t*, see iothub_client_congestion_control.h)*/
+    static const char* OPTION_CONGESTION_CONTROL_MAX_WINDOW = "congestion_control_max_window";
+
+    /*most milliseconds the events are held back so that the transport sends more of them at once, 0 (the default) sends them at the next _DoWork, not for clients sharing a transport (tickcounter_ms_t*)*/
+    static const char* OPTION_LINGER_MS = "linger_ms";
+    /*bytes of content of the held back events at which they are sent without waiting for the end of "linger_ms", 0 (the default) for no such bound (size_t*)*/
+    static const char* OPTION_LINGER_MAX_BYTES = "linger_max_bytes";
+
+    /*number of threads the callbacks of an IoTHubClient are run on instead of its worker thread, at most one per type of callback (size_t*, 0 means the worker thread)*/
+    static const char* OPTION_CALLBACK_DISPATCH_THREADS = "callback_dispatch_threads";
+    /*pool of threads running the client instead of a worker thread of its own, set before the worker thread starts (IOTHUB_WORKER_POOL_HANDLE, see iothub_client_worker_pool.h)*/
+    static const char* OPTION_WORKER_POOL = "worker_pool";
+
 #ifdef __cplusplus
 }
 #endif
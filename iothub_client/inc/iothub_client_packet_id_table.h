@@ -0,0 +1,55 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file iothub_client_packet_id_table.h
+*	@brief Set of in-flight publishes indexed by their 16 bit packet id, used by
+*	       the MQTT transport to find the message a PUBACK acknowledges.
+*
+*	@details Entries are embedded in the structure they index (the same way
+*	         DLIST_ENTRY is) and are hashed on the low bits of their packet id.
+*	         Packet ids are handed out in sequence, so while the table has at
+*	         least as many buckets as entries, which it keeps by doubling up to
+*	         one bucket per packet id, nearly every bucket holds one entry and
+*	         adding or removing an entry is constant time.
+*	         An entry that is in the table must be removed before its memory is
+*	         released. Packet ids wrap around, so two entries may share one:
+*	         packet_id_table_remove_entry removes a given entry whatever other
+*	         entries share its packet id. A table is not thread safe.
+*/
+
+#ifndef IOTHUB_CLIENT_PACKET_ID_TABLE_H
+#define IOTHUB_CLIENT_PACKET_ID_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*buckets of a new table, and the most it grows to (one per packet id)*/
+#define PACKET_ID_TABLE_INITIAL_BUCKETS 16
+#define PACKET_ID_TABLE_MAX_BUCKETS 65536
+
+typedef struct PACKET_ID_TABLE_INSTANCE_TAG* PACKET_ID_TABLE_HANDLE;
+
+typedef struct PACKET_ID_TABLE_ENTRY_TAG
+{
+    struct PACKET_ID_TABLE_ENTRY_TAG* next; /*next entry of the same bucket*/
+    uint16_t packet_id;
+} PACKET_ID_TABLE_ENTRY;
+
+MOCKABLE_FUNCTION(, PACKET_ID_TABLE_HANDLE, packet_id_table_create);
+MOCKABLE_FUNCTION(, void, packet_id_table_destroy, PACKET_ID_TABLE_HANDLE, handle);
+MOCKABLE_FUNCTION(, int, packet_id_table_add, PACKET_ID_TABLE_HANDLE, handle, PACKET_ID_TABLE_ENTRY*, entry, uint16_t, packet_id);
+MOCKABLE_FUNCTION(, PACKET_ID_TABLE_ENTRY*, packet_id_table_remove, PACKET_ID_TABLE_HANDLE, handle, uint16_t, packet_id);
+MOCKABLE_FUNCTION(, int, packet_id_table_remove_entry, PACKET_ID_TABLE_HANDLE, handle, PACKET_ID_TABLE_ENTRY*, entry);
+MOCKABLE_FUNCTION(, size_t, packet_id_table_get_count, PACKET_ID_TABLE_HANDLE, handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IOTHUB_CLIENT_PACKET_ID_TABLE_H */
@@ -5,6 +5,7 @@
 #define IOTHUB_CLIENT_PRIVATE_H
 
 #include <signal.h>
+#include <time.h>
 
 #include "azure_c_shared_utility/constbuffer.h"
 #include "azure_c_shared_utility/crt_abstractions.h"
@@ -15,6 +16,7 @@
 
 #include "iothub_message.h"
 #include "iothub_client_ll.h"
+#include "iothub_client_timeout_queue.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -51,8 +53,17 @@ typedef struct IOTHUB_MESSAGE_LIST_TAG
     void* context; 
     DLIST_ENTRY entry;
     tickcounter_ms_t ms_timesOutAfter; /* a value of "0" means "no timeout", if the IOTHUBCLIENT_LL's handle tickcounter > msTimesOutAfer then the message shall timeout*/
+    TIMEOUT_QUEUE_ENTRY timeout_entry; /* queued in the IOTHUBCLIENT_LL's message timeouts while ms_timesOutAfter != 0 and the message is in waitingToSend*/
+    size_t messageSize; /* bytes counted against the "outbound_queue_max_bytes" limit of the IOTHUBCLIENT_LL, 0 when that limit is not set*/
+    uint64_t journalSequence; /* sequence of the message in the IOTHUBCLIENT_LL's journal, 0 when the message is not journaled*/
+    tickcounter_ms_t ms_queued; /* time of the IOTHUBCLIENT_LL's last _DoWork when the message was queued, used for the latency statistics when ms_sent is not known*/
+    tickcounter_ms_t ms_sent; /* time of the IOTHUBCLIENT_LL's last _DoWork that let the transport take the message while its congestion control is enabled, used for the latency of the acknowledgement and the latency statistics*/
+    IOTHUB_MESSAGE_PRIORITY priority; /* priority of the message when it was queued, waitingToSend is ordered by it*/
+    time_t expiryTime; /* expiry time of the message when it was queued, (time_t)0 when it never expires. Only the records with an expiry time need to be passed to IoTHubClient_LL_CompleteIfExpired*/
 }IOTHUB_MESSAGE_LIST;
 
+MOCKABLE_FUNCTION(, bool, IoTHubClient_LL_CompleteIfExpired, IOTHUB_CLIENT_LL_HANDLE, handle, IOTHUB_MESSAGE_LIST*, message);
+
 typedef struct IOTHUB_DEVICE_TWIN_TAG
 {
     uint32_t item_id;
@@ -0,0 +1,63 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file iothub_client_submission_queue.h
+*	@brief Multiple producer, single consumer queue that lets application threads
+*	       hand work to the worker thread of IoTHubClient without taking the
+*	       lock held by the worker thread while it runs IoTHubClient_LL_DoWork.
+*
+*	@details The queue is intrusive: producers embed a SUBMISSION_QUEUE_ENTRY as
+*	         the first member of the structure they submit. submission_queue_push
+*	         is lock free; the consumer takes all the queued entries at once with
+*	         submission_queue_take_all and gets them back in submission order.
+*	         Only one thread at a time may call submission_queue_take_all.
+*	         On compilers without atomic compare and swap intrinsics (or when
+*	         SUBMISSION_QUEUE_USE_LOCK is defined) the queue is guarded by a
+*	         LOCK_HANDLE of its own instead.
+*/
+
+#ifndef IOTHUB_CLIENT_SUBMISSION_QUEUE_H
+#define IOTHUB_CLIENT_SUBMISSION_QUEUE_H
+
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+#if !defined(SUBMISSION_QUEUE_USE_LOCK) && !defined(_MSC_VER) && !defined(__GNUC__)
+#define SUBMISSION_QUEUE_USE_LOCK
+#endif
+
+#ifdef SUBMISSION_QUEUE_USE_LOCK
+#include "azure_c_shared_utility/lock.h"
+#endif
+
+#ifdef __cplusplus
+#include <cstdbool>
+extern "C"
+{
+#else
+#include <stdbool.h>
+#endif
+
+typedef struct SUBMISSION_QUEUE_ENTRY_TAG
+{
+    struct SUBMISSION_QUEUE_ENTRY_TAG* next;
+} SUBMISSION_QUEUE_ENTRY;
+
+typedef struct SUBMISSION_QUEUE_TAG
+{
+    SUBMISSION_QUEUE_ENTRY* volatile head; /*most recently pushed entry, entries are linked from the newest to the oldest*/
+#ifdef SUBMISSION_QUEUE_USE_LOCK
+    LOCK_HANDLE lock;
+#endif
+} SUBMISSION_QUEUE;
+
+MOCKABLE_FUNCTION(, int, submission_queue_init, SUBMISSION_QUEUE*, queue);
+MOCKABLE_FUNCTION(, void, submission_queue_deinit, SUBMISSION_QUEUE*, queue);
+MOCKABLE_FUNCTION(, int, submission_queue_push, SUBMISSION_QUEUE*, queue, SUBMISSION_QUEUE_ENTRY*, entry);
+MOCKABLE_FUNCTION(, SUBMISSION_QUEUE_ENTRY*, submission_queue_take_all, SUBMISSION_QUEUE*, queue);
+MOCKABLE_FUNCTION(, bool, submission_queue_is_empty, SUBMISSION_QUEUE*, queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IOTHUB_CLIENT_SUBMISSION_QUEUE_H */
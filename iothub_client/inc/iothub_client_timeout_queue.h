@@ -0,0 +1,50 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file iothub_client_timeout_queue.h
+*	@brief Ordered set of expiry times, used by the IoTHubClient_LL layer for
+*	       message timeouts and available to transports for their own per-message timers.
+*
+*	@details Entries are embedded in the structure they time (the same way DLIST_ENTRY is)
+*	         and are kept in a binary min-heap, so adding or removing an entry is O(log n)
+*	         and finding the expired entries only touches those entries.
+*	         An entry that is queued must be removed before its memory is released.
+*/
+
+#ifndef IOTHUB_CLIENT_TIMEOUT_QUEUE_H
+#define IOTHUB_CLIENT_TIMEOUT_QUEUE_H
+
+#include <stddef.h>
+#include "azure_c_shared_utility/tickcounter.h"
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct TIMEOUT_QUEUE_INSTANCE_TAG* TIMEOUT_QUEUE_HANDLE;
+
+typedef struct TIMEOUT_QUEUE_ENTRY_TAG
+{
+    TIMEOUT_QUEUE_HANDLE queue; /*the queue holding this entry, NULL when the entry is not queued*/
+    size_t index;               /*position of the entry in the queue, only meaningful while queued*/
+    tickcounter_ms_t expiry;    /*the entry expires once the current time is past this value*/
+} TIMEOUT_QUEUE_ENTRY;
+
+/** @brief Prepares an entry for use, an initialized entry is not queued. */
+#define TIMEOUT_QUEUE_ENTRY_INIT(entry) ((entry)->queue = NULL, (entry)->index = 0, (entry)->expiry = 0)
+
+MOCKABLE_FUNCTION(, TIMEOUT_QUEUE_HANDLE, timeout_queue_create);
+MOCKABLE_FUNCTION(, void, timeout_queue_destroy, TIMEOUT_QUEUE_HANDLE, handle);
+MOCKABLE_FUNCTION(, int, timeout_queue_add, TIMEOUT_QUEUE_HANDLE, handle, TIMEOUT_QUEUE_ENTRY*, entry, tickcounter_ms_t, expiry);
+MOCKABLE_FUNCTION(, void, timeout_queue_remove, TIMEOUT_QUEUE_ENTRY*, entry);
+MOCKABLE_FUNCTION(, TIMEOUT_QUEUE_ENTRY*, timeout_queue_peek, TIMEOUT_QUEUE_HANDLE, handle);
+MOCKABLE_FUNCTION(, TIMEOUT_QUEUE_ENTRY*, timeout_queue_pop_expired, TIMEOUT_QUEUE_HANDLE, handle, tickcounter_ms_t, current_ms);
+MOCKABLE_FUNCTION(, size_t, timeout_queue_get_count, TIMEOUT_QUEUE_HANDLE, handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IOTHUB_CLIENT_TIMEOUT_QUEUE_H */
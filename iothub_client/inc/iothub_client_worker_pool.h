@@ -0,0 +1,64 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/** @file iothub_client_worker_pool.h
+*	@brief Process wide pool of worker threads that runs the work of many
+*	       IoTHubClient instances, so that the number of threads does not grow
+*	       with the number of devices.
+*
+*	@details An IoTHubClient opts into a pool by setting OPTION_WORKER_POOL
+*	         before its worker thread would be started. The client is then added
+*	         to the pool instead of creating its own thread: every thread of the
+*	         pool takes the next client that is ready, runs its work (the same
+*	         work ScheduleWork_Thread does: IoTHubClient_LL_DoWork and the
+*	         callbacks) and puts it back to wait until its next scheduled run.
+*	         A client is ready when it was signaled (work was queued for it) or
+*	         when the delay returned by its last run elapsed; clients with
+*	         nothing to do are not run. A client never runs on two threads at the
+*	         same time.
+*	         The pool must outlive all the clients added to it.
+*/
+
+#ifndef IOTHUB_CLIENT_WORKER_POOL_H
+#define IOTHUB_CLIENT_WORKER_POOL_H
+
+#include <stddef.h>
+#include "azure_c_shared_utility/umock_c_prod.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+typedef struct IOTHUB_WORKER_POOL_TAG* IOTHUB_WORKER_POOL_HANDLE;
+typedef struct IOTHUB_WORKER_POOL_ITEM_TAG* IOTHUB_WORKER_POOL_ITEM_HANDLE;
+
+/*runs the work of an item, returns the number of milliseconds after which the item has to run again if it is not signaled before (0 to run again as soon as possible)*/
+typedef unsigned int(*IOTHUB_WORKER_POOL_WORK)(void* context);
+
+/**
+* @brief	Creates a pool running @p thread_count threads.
+*
+* @param	thread_count	The number of threads of the pool, at least 1.
+*
+* @return	The handle of the pool or NULL on failure.
+*/
+MOCKABLE_FUNCTION(, IOTHUB_WORKER_POOL_HANDLE, IoTHubWorkerPool_Create, size_t, thread_count);
+
+/**
+* @brief	Stops the threads of the pool and frees it. All the clients using
+*			the pool have to be destroyed first.
+*
+* @param	pool	The handle of the pool.
+*/
+MOCKABLE_FUNCTION(, void, IoTHubWorkerPool_Destroy, IOTHUB_WORKER_POOL_HANDLE, pool);
+
+MOCKABLE_FUNCTION(, IOTHUB_WORKER_POOL_ITEM_HANDLE, IoTHubWorkerPool_Add, IOTHUB_WORKER_POOL_HANDLE, pool, IOTHUB_WORKER_POOL_WORK, work, void*, context);
+MOCKABLE_FUNCTION(, void, IoTHubWorkerPool_Signal, IOTHUB_WORKER_POOL_ITEM_HANDLE, item);
+MOCKABLE_FUNCTION(, void, IoTHubWorkerPool_Remove, IOTHUB_WORKER_POOL_ITEM_HANDLE, item);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* IOTHUB_CLIENT_WORKER_POOL_H */
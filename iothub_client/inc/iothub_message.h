@@ -15,10 +15,12 @@
 
 #ifdef __cplusplus
 #include <cstddef>
+#include <ctime>
 extern "C" 
 {
 #else
 #include <stddef.h>
+#include <time.h>
 #endif
 
 #define IOTHUB_MESSAGE_RESULT_VALUES         \
@@ -42,6 +44,17 @@ IOTHUBMESSAGE_UNKNOWN \
   */
 DEFINE_ENUM(IOTHUBMESSAGE_CONTENT_TYPE, IOTHUBMESSAGE_CONTENT_TYPE_VALUES);
 
+#define IOTHUB_MESSAGE_PRIORITY_VALUES \
+IOTHUB_MESSAGE_PRIORITY_LOW, \
+IOTHUB_MESSAGE_PRIORITY_NORMAL, \
+IOTHUB_MESSAGE_PRIORITY_HIGH \
+
+/** @brief Enumeration specifying the priority of a message on the device.
+  *        The priority is not sent to the hub, it only decides which
+  *        messages the client keeps when its outbound queue is full.
+  */
+DEFINE_ENUM(IOTHUB_MESSAGE_PRIORITY, IOTHUB_MESSAGE_PRIORITY_VALUES);
+
 typedef struct IOTHUB_MESSAGE_HANDLE_DATA_TAG* IOTHUB_MESSAGE_HANDLE;
 
 /**
@@ -70,15 +83,91 @@ MOCKABLE_FUNCTION(, IOTHUB_MESSAGE_HANDLE, IoTHubMessage_CreateFromString, const
 
 /**
  * @brief   Creates a new IoT hub message with the content identical to that
- *          of the @p iotHubMessageHandle parameter.
+ *          of the @p iotHubMessageHandle parameter. If the message is
+ *          immutable (see ::IoTHubMessage_SetImmutable) nothing is copied:
+ *          the same handle is returned with its reference count incremented.
  *
  * @param   iotHubMessageHandle Handle to the message that is to be cloned.
  *
  * @return  A valid @c IOTHUB_MESSAGE_HANDLE if the message was successfully
- *          cloned or @c NULL in case an error occurs.
+ *          cloned or @c NULL in case an error occurs. Every clone must be
+ *          released with ::IoTHubMessage_Destroy.
  */
 MOCKABLE_FUNCTION(, IOTHUB_MESSAGE_HANDLE, IoTHubMessage_Clone, IOTHUB_MESSAGE_HANDLE, iotHubMessageHandle);
 
+/**
+ * @brief   Marks the message as immutable. After this call the content,
+ *          properties, message id and correlation id of the message must
+ *          not change anymore, so ::IoTHubMessage_Clone shares the message
+ *          instead of copying it. The client and the transports then hold
+ *          references to a single copy of the message.
+ *
+ * @param   iotHubMessageHandle Handle to the message.
+ *
+ * @return  Returns IOTHUB_MESSAGE_OK if the message was marked immutable
+ *          or an error code otherwise.
+ *
+ * @note    ::IoTHubMessage_SetMessageId and ::IoTHubMessage_SetCorrelationId
+ *          fail on an immutable message, and ::IoTHubMessage_Properties
+ *          returns NULL for it: use ::IoTHubMessage_ReadOnlyProperties to
+ *          read its properties. A map obtained from
+ *          ::IoTHubMessage_Properties before this call must not be modified
+ *          anymore.
+ */
+MOCKABLE_FUNCTION(, IOTHUB_MESSAGE_RESULT, IoTHubMessage_SetImmutable, IOTHUB_MESSAGE_HANDLE, iotHubMessageHandle);
+
+/**
+ * @brief   Sets the priority of the message. New messages have the priority
+ *          @c IOTHUB_MESSAGE_PRIORITY_NORMAL. Queued events are sent in the
+ *          order of their priority, then in the order they were queued.
+ *
+ * @param   iotHubMessageHandle Handle to the message.
+ * @param   priority            The priority of the message.
+ *
+ * @return  Returns IOTHUB_MESSAGE_OK if the priority was set or an error
+ *          code otherwise. Like the message id, the priority of an
+ *          immutable message cannot be changed.
+ */
+MOCKABLE_FUNCTION(, IOTHUB_MESSAGE_RESULT, IoTHubMessage_SetPriority, IOTHUB_MESSAGE_HANDLE, iotHubMessageHandle, IOTHUB_MESSAGE_PRIORITY, priority);
+
+/**
+ * @brief   Gets the priority of the message.
+ *
+ * @param   iotHubMessageHandle Handle to the message.
+ *
+ * @return  The priority of the message, @c IOTHUB_MESSAGE_PRIORITY_NORMAL
+ *          if @p iotHubMessageHandle is @c NULL.
+ */
+MOCKABLE_FUNCTION(, IOTHUB_MESSAGE_PRIORITY, IoTHubMessage_GetPriority, IOTHUB_MESSAGE_HANDLE, iotHubMessageHandle);
+
+/**
+ * @brief   Sets the time after which the message is not worth sending
+ *          anymore. A message still waiting in the client when it expires is
+ *          not sent: its confirmation callback is called with
+ *          @c IOTHUB_CLIENT_CONFIRMATION_MESSAGE_EXPIRED when a transport
+ *          would have taken it. New messages never expire.
+ *
+ * @param   iotHubMessageHandle Handle to the message.
+ * @param   expiryTime          The absolute time, as returned by @c time(),
+ *                              when the message expires, or @c (time_t)0 so
+ *                              that the message never expires.
+ *
+ * @return  Returns IOTHUB_MESSAGE_OK if the expiry time was set or an error
+ *          code otherwise. Like the priority, the expiry time of an immutable
+ *          message cannot be changed.
+ */
+MOCKABLE_FUNCTION(, IOTHUB_MESSAGE_RESULT, IoTHubMessage_SetExpiryTime, IOTHUB_MESSAGE_HANDLE, iotHubMessageHandle, time_t, expiryTime);
+
+/**
+ * @brief   Gets the time after which the message is not sent anymore.
+ *
+ * @param   iotHubMessageHandle Handle to the message.
+ *
+ * @return  The expiry time of the message, @c (time_t)0 if the message never
+ *          expires or if @p iotHubMessageHandle is @c NULL.
+ */
+MOCKABLE_FUNCTION(, time_t, IoTHubMessage_GetExpiryTime, IOTHUB_MESSAGE_HANDLE, iotHubMessageHandle);
+
 /**
  * @brief   Fetches a pointer and size for the data associated with the IoT
  *          hub message handle. If the content type of the message is not
@@ -123,10 +212,22 @@ MOCKABLE_FUNCTION(, IOTHUBMESSAGE_CONTENT_TYPE, IoTHubMessage_GetContentType, IO
  *
  * @param   iotHubMessageHandle Handle to the message.
  *
- * @return  A @c MAP_HANDLE pointing to the properties map for this message.
+ * @return  A @c MAP_HANDLE pointing to the properties map for this message,
+ *          or @c NULL for an immutable message.
  */
 MOCKABLE_FUNCTION(, MAP_HANDLE, IoTHubMessage_Properties, IOTHUB_MESSAGE_HANDLE, iotHubMessageHandle);
 
+/**
+ * @brief   Gets a handle to the message's properties map for reading only.
+ *          Unlike ::IoTHubMessage_Properties this also works for an
+ *          immutable message. The map must not be modified.
+ *
+ * @param   iotHubMessageHandle Handle to the message.
+ *
+ * @return  A @c MAP_HANDLE pointing to the properties map for this message.
+ */
+MOCKABLE_FUNCTION(, MAP_HANDLE, IoTHubMessage_ReadOnlyProperties, IOTHUB_MESSAGE_HANDLE, iotHubMessageHandle);
+
 /**
 * @brief   Gets the MessageId from the IOTHUB_MESSAGE_HANDLE.
 *
@@ -169,6 +270,8 @@ MOCKABLE_FUNCTION(, IOTHUB_MESSAGE_RESULT, IoTHubMessage_SetCorrelationId, IOTHU
 
 /**
  * @brief   Frees all resources associated with the given message handle.
+ *          For a message shared by ::IoTHubMessage_Clone the resources are
+ *          freed when the last reference is destroyed.
  *
  * @param   iotHubMessageHandle Handle to the message.
  */
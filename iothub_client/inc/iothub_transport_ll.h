@@ -14,10 +14,14 @@ typedef struct TRANSPORT_PROVIDER_TAG TRANSPORT_PROVIDER;
 union IOTHUB_IDENTITY_INFO_TAG;
 typedef union IOTHUB_IDENTITY_INFO_TAG IOTHUB_IDENTITY_INFO;
 
+struct IOTHUB_CLIENT_STATISTICS_TAG;
+typedef struct IOTHUB_CLIENT_STATISTICS_TAG IOTHUB_CLIENT_STATISTICS;
+
 typedef void* METHOD_HANDLE;
 
 #include "azure_c_shared_utility/doublylinkedlist.h"
 #include "azure_c_shared_utility/strings.h"
+#include "azure_c_shared_utility/tickcounter.h"
 #include "iothub_message.h"
 
 struct MESSAGE_DISPOSITION_CONTEXT_TAG;
@@ -67,6 +71,8 @@ extern "C"
     typedef int(*pfIoTHubTransport_Subscribe_DeviceMethod)(IOTHUB_DEVICE_HANDLE handle);
     typedef void(*pfIoTHubTransport_Unsubscribe_DeviceMethod)(IOTHUB_DEVICE_HANDLE handle);
     typedef int(*pfIoTHubTransport_DeviceMethod_Response)(IOTHUB_DEVICE_HANDLE handle, METHOD_HANDLE methodId, const unsigned char* response, size_t response_size, int status_response);
+    typedef int(*pfIoTHubTransport_GetNextDeadline)(TRANSPORT_LL_HANDLE handle, tickcounter_ms_t* msUntilDeadline);
+    typedef int(*pfIoTHubTransport_GetStatistics)(TRANSPORT_LL_HANDLE handle, IOTHUB_CLIENT_STATISTICS* statistics);
 
 #define TRANSPORT_PROVIDER_FIELDS                                                   \
 pfIotHubTransport_SendMessageDisposition IoTHubTransport_SendMessageDisposition;  \
@@ -86,7 +92,9 @@ pfIoTHubTransport_Subscribe IoTHubTransport_Subscribe;
 pfIoTHubTransport_Unsubscribe IoTHubTransport_Unsubscribe;                          \
 pfIoTHubTransport_DoWork IoTHubTransport_DoWork;                                    \
 pfIoTHubTransport_SetRetryPolicy IoTHubTransport_SetRetryPolicy;                    \
-pfIoTHubTransport_GetSendStatus IoTHubTransport_GetSendStatus  /*there's an intentional missing ; on this line*/
+pfIoTHubTransport_GetSendStatus IoTHubTransport_GetSendStatus;                      \
+pfIoTHubTransport_GetNextDeadline IoTHubTransport_GetNextDeadline;                  \
+pfIoTHubTransport_GetStatistics IoTHubTransport_GetStatistics  /*there's an intentional missing ; on this line*/
 
     struct TRANSPORT_PROVIDER_TAG
     {
@@ -7,19 +7,28 @@
 
 #include <signal.h>
 #include <stddef.h>
+#include <string.h>
 #include "azure_c_shared_utility/optimize_size.h"
 #include "azure_c_shared_utility/crt_abstractions.h"
+#include "azure_c_shared_utility/shared_util_options.h"
 #include "iothub_client.h"
 #include "iothub_client_ll.h"
 #include "iothub_client_private.h"
+#include "iothub_client_options.h"
+#include "iothub_client_submission_queue.h"
+#include "iothub_client_worker_pool.h"
 #include "iothubtransport.h"
 #include "azure_c_shared_utility/threadapi.h"
 #include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/condition.h"
 #include "azure_c_shared_utility/xlogging.h"
 #include "azure_c_shared_utility/singlylinkedlist.h"
 #include "azure_c_shared_utility/vector.h"
 
+#define DO_WORK_FREQ_DEFAULT_MS     10
+
 struct IOTHUB_QUEUE_CONTEXT_TAG;
+struct CALLBACK_DISPATCHER_TAG;
 
 typedef struct IOTHUB_CLIENT_INSTANCE_TAG
 {
@@ -28,15 +37,26 @@ typedef struct IOTHUB_CLIENT_INSTANCE_TAG
     THREAD_HANDLE ThreadHandle;
     LOCK_HANDLE LockHandle;
     sig_atomic_t StopThread;
+    COND_HANDLE WorkSignal;         /*signaled (under LockHandle) when there is work for ScheduleWork_Thread*/
+    int do_work_pending;            /*set by producers when the worker thread should call IoTHubClient_LL_DoWork without waiting*/
+    volatile sig_atomic_t worker_waiting;   /*set while ScheduleWork_Thread is blocked in Condition_Wait, read without the lock by IoTHubClient_SendEventAsync*/
+    volatile sig_atomic_t worker_started;   /*set once ScheduleWork_Thread runs, so that IoTHubClient_SendEventAsync does not need the lock to check it*/
+    SUBMISSION_QUEUE submissionQueue;       /*IOTHUB_SUBMITTED_EVENTs queued by IoTHubClient_SendEventAsync for the worker thread*/
+    unsigned int do_work_freq_ms;   /*longest time the worker thread waits between 2 calls to IoTHubClient_LL_DoWork*/
+    IOTHUB_WORKER_POOL_HANDLE workerPool;           /*set by OPTION_WORKER_POOL, the client is then run by the threads of the pool instead of ScheduleWork_Thread*/
+    IOTHUB_WORKER_POOL_ITEM_HANDLE workerPoolItem;  /*the client in workerPool, once it was started*/
 #ifndef DONT_USE_UPLOADTOBLOB
     SINGLYLINKEDLIST_HANDLE savedDataToBeCleaned; /*list containing UPLOADTOBLOB_SAVED_DATA*/
 #endif
     int created_with_transport_handle;
     VECTOR_HANDLE saved_user_callback_list;
+    struct CALLBACK_DISPATCHER_TAG* callbackDispatcher; /*threads running the callbacks when OPTION_CALLBACK_DISPATCH_THREADS is set, NULL when they run on the worker thread*/
     IOTHUB_CLIENT_DEVICE_TWIN_CALLBACK desired_state_callback;
     IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK event_confirm_callback;
     IOTHUB_CLIENT_REPORTED_STATE_CALLBACK reported_state_callback;
     IOTHUB_CLIENT_CONNECTION_STATUS_CALLBACK connection_status_callback;
+    IOTHUB_CLIENT_CONNECTION_STATUS_CALLBACK connect_callback;
+    void* connect_user_context;
     IOTHUB_CLIENT_DEVICE_METHOD_CALLBACK_ASYNC device_method_callback;
     IOTHUB_CLIENT_INBOUND_DEVICE_METHOD_CALLBACK inbound_device_method_callback;
     IOTHUB_CLIENT_MESSAGE_CALLBACK_ASYNC message_callback;
@@ -66,6 +86,7 @@ typedef struct UPLOADTOBLOB_SAVED_DATA_TAG
     CALLBACK_TYPE_EVENT_CONFIRM,        \
     CALLBACK_TYPE_REPORTED_STATE,       \
     CALLBACK_TYPE_CONNECTION_STATUS,    \
+    CALLBACK_TYPE_CONNECT,              \
     CALLBACK_TYPE_DEVICE_METHOD,        \
     CALLBACK_TYPE_INBOUD_DEVICE_METHOD, \
     CALLBACK_TYPE_MESSAGE
@@ -73,6 +94,8 @@ typedef struct UPLOADTOBLOB_SAVED_DATA_TAG
 DEFINE_ENUM(USER_CALLBACK_TYPE, USER_CALLBACK_TYPE_VALUES)
 DEFINE_ENUM_STRINGS(USER_CALLBACK_TYPE, USER_CALLBACK_TYPE_VALUES)
 
+#define USER_CALLBACK_TYPE_COUNT        8
+
 typedef struct DEVICE_TWIN_CALLBACK_INFO_TAG
 {
     DEVICE_TWIN_UPDATE_STATE update_state;
@@ -103,6 +126,15 @@ typedef struct METHOD_CALLBACK_INFO_TAG
     METHOD_HANDLE method_id;
 } METHOD_CALLBACK_INFO;
 
+/*an event queued by IoTHubClient_SendEventAsync, handed to IoTHubClient_LL_SendEventAsync_Move by the worker thread*/
+typedef struct IOTHUB_SUBMITTED_EVENT_TAG
+{
+    SUBMISSION_QUEUE_ENTRY entry; /*must be the first member, the entries taken from the submission queue are cast to IOTHUB_SUBMITTED_EVENT*/
+    IOTHUB_MESSAGE_HANDLE messageHandle;
+    IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK eventConfirmationCallback;
+    void* userContextCallback;
+} IOTHUB_SUBMITTED_EVENT;
+
 typedef struct USER_CALLBACK_INFO_TAG
 {
     USER_CALLBACK_TYPE type;
@@ -124,6 +156,19 @@ typedef struct IOTHUB_QUEUE_CONTEXT_TAG
     void* userContextCallback;
 } IOTHUB_QUEUE_CONTEXT;
 
+/*the threads OPTION_CALLBACK_DISPATCH_THREADS creates: the worker thread queues the callbacks, the dispatcher threads run them*/
+typedef struct CALLBACK_DISPATCHER_TAG
+{
+    IOTHUB_CLIENT_INSTANCE* iotHubClientInstance;
+    LOCK_HANDLE lock;               /*protects queue, busy and stop*/
+    COND_HANDLE signal;             /*signaled (under lock) when callbacks are queued or the threads have to stop*/
+    VECTOR_HANDLE queue;            /*USER_CALLBACK_INFO not yet run, in the order the worker thread queued them*/
+    bool busy[USER_CALLBACK_TYPE_COUNT]; /*set while a thread runs a callback of that type, so that callbacks of a type run one at a time and in order*/
+    THREAD_HANDLE* threads;
+    size_t thread_count;
+    int stop;
+} CALLBACK_DISPATCHER;
+
 /*used by unittests only*/
 const size_t IoTHubClient_ThreadTerminationOffset = offsetof(IOTHUB_CLIENT_INSTANCE, StopThread);
 
@@ -176,6 +221,43 @@ static void garbageCollectorImpl(IOTHUB_CLIENT_INSTANCE* iotHubClientInstance)
 }
 #endif
 
+#ifndef DONT_USE_UPLOADTOBLOB
+/*this function is called with LockHandle held. Uploads run without LockHandle, so the options they read cannot be replaced while any of them is in progress*/
+static bool isUploadInProgress(IOTHUB_CLIENT_INSTANCE* iotHubClientInstance)
+{
+    bool result = false;
+    LIST_ITEM_HANDLE item = singlylinkedlist_get_head_item(iotHubClientInstance->savedDataToBeCleaned);
+    while ((item != NULL) && (result == false))
+    {
+        const UPLOADTOBLOB_SAVED_DATA* savedData = (const UPLOADTOBLOB_SAVED_DATA*)singlylinkedlist_item_get_value(item);
+        if (Lock(savedData->lockGarbage) != LOCK_OK)
+        {
+            LogError("unable to Lock");
+            result = true;
+        }
+        else
+        {
+            result = (savedData->canBeGarbageCollected == 0);
+            if (Unlock(savedData->lockGarbage) != LOCK_OK)
+            {
+                LogError("unable to unlock after locking");
+            }
+        }
+        item = singlylinkedlist_get_next_item(item);
+    }
+    return result;
+}
+
+static bool isUploadToBlobOption(const char* optionName)
+{
+    return (
+        (strcmp(OPTION_X509_CERT, optionName) == 0) ||
+        (strcmp(OPTION_X509_PRIVATE_KEY, optionName) == 0) ||
+        (strcmp("TrustedCerts", optionName) == 0)
+        );
+}
+#endif
+
 static bool iothub_ll_message_callback(MESSAGE_CALLBACK_INFO* messageData, void* userContextCallback)
 {
     bool result;
@@ -313,19 +395,38 @@ static void iothub_ll_connection_status_callback(IOTHUB_CLIENT_CONNECTION_STATUS
     }
 }
 
+static void iothub_ll_connect_callback(IOTHUB_CLIENT_CONNECTION_STATUS result, IOTHUB_CLIENT_CONNECTION_STATUS_REASON reason, void* userContextCallback)
+{
+    IOTHUB_CLIENT_INSTANCE* iotHubClientInstance = (IOTHUB_CLIENT_INSTANCE*)userContextCallback;
+    USER_CALLBACK_INFO queue_cb_info;
+    queue_cb_info.type = CALLBACK_TYPE_CONNECT;
+    queue_cb_info.userContextCallback = iotHubClientInstance->connect_user_context;
+    queue_cb_info.iothub_callback.connection_status_cb_info.status_reason = reason;
+    queue_cb_info.iothub_callback.connection_status_cb_info.connection_status = result;
+    if (VECTOR_push_back(iotHubClientInstance->saved_user_callback_list, &queue_cb_info, 1) != 0)
+    {
+        LogError("connect callback vector push failed.");
+    }
+}
+
+static void queue_event_confirm_callback(IOTHUB_CLIENT_INSTANCE* iotHubClientInstance, IOTHUB_CLIENT_CONFIRMATION_RESULT result, void* userContextCallback)
+{
+    USER_CALLBACK_INFO queue_cb_info;
+    queue_cb_info.type = CALLBACK_TYPE_EVENT_CONFIRM;
+    queue_cb_info.userContextCallback = userContextCallback;
+    queue_cb_info.iothub_callback.event_confirm_cb_info.confirm_result = result;
+    if (VECTOR_push_back(iotHubClientInstance->saved_user_callback_list, &queue_cb_info, 1) != 0)
+    {
+        LogError("event confirm callback vector push failed.");
+    }
+}
+
 static void iothub_ll_event_confirm_callback(IOTHUB_CLIENT_CONFIRMATION_RESULT result, void* userContextCallback)
 {
     IOTHUB_QUEUE_CONTEXT* queue_context = (IOTHUB_QUEUE_CONTEXT*)userContextCallback;
     if (queue_context != NULL)
     {
-        USER_CALLBACK_INFO queue_cb_info;
-        queue_cb_info.type = CALLBACK_TYPE_EVENT_CONFIRM;
-        queue_cb_info.userContextCallback = queue_context->userContextCallback;
-        queue_cb_info.iothub_callback.event_confirm_cb_info.confirm_result = result;
-        if (VECTOR_push_back(queue_context->iotHubClientHandle->saved_user_callback_list, &queue_cb_info, 1) != 0)
-        {
-            LogError("event confirm callback vector push failed.");
-        }
+        queue_event_confirm_callback(queue_context->iotHubClientHandle, result, queue_context->userContextCallback);
         free(queue_context);
     }
 }
@@ -398,6 +499,136 @@ static void iothub_ll_device_twin_callback(DEVICE_TWIN_UPDATE_STATE update_state
     }
 }
 
+/*this function is called with LockHandle held by every API that queues work for the LL layer*/
+static void signal_worker_thread(IOTHUB_CLIENT_INSTANCE* iotHubClientInstance)
+{
+    /*Codes_SRS_IOTHUBCLIENT_31_002: [ Every API that queues work for IoTHubClient_LL_DoWork shall wake up the worker thread. ]*/
+    iotHubClientInstance->do_work_pending = 1;
+    if (iotHubClientInstance->workerPoolItem != NULL)
+    {
+        IoTHubWorkerPool_Signal(iotHubClientInstance->workerPoolItem);
+    }
+    else if ((iotHubClientInstance->worker_waiting != 0) && (iotHubClientInstance->WorkSignal != NULL))
+    {
+        if (Condition_Post(iotHubClientInstance->WorkSignal) != COND_OK)
+        {
+            LogError("unable to Condition_Post");
+        }
+    }
+}
+
+static void dispatch_user_callback(IOTHUB_CLIENT_INSTANCE* iotHubClientInstance, USER_CALLBACK_INFO* queued_cb)
+{
+    switch (queued_cb->type)
+    {
+        case CALLBACK_TYPE_DEVICE_TWIN:
+            if (iotHubClientInstance->desired_state_callback)
+            {
+                iotHubClientInstance->desired_state_callback(queued_cb->iothub_callback.dev_twin_cb_info.update_state, queued_cb->iothub_callback.dev_twin_cb_info.payLoad, queued_cb->iothub_callback.dev_twin_cb_info.size, queued_cb->userContextCallback);
+            }
+            if (queued_cb->iothub_callback.dev_twin_cb_info.payLoad)
+            {
+                free(queued_cb->iothub_callback.dev_twin_cb_info.payLoad);
+            }
+            break;
+        case CALLBACK_TYPE_EVENT_CONFIRM:
+            if (iotHubClientInstance->event_confirm_callback)
+            {
+                iotHubClientInstance->event_confirm_callback(queued_cb->iothub_callback.event_confirm_cb_info.confirm_result, queued_cb->userContextCallback);
+            }
+            break;
+        case CALLBACK_TYPE_REPORTED_STATE:
+            if (iotHubClientInstance->reported_state_callback)
+            {
+                iotHubClientInstance->reported_state_callback(queued_cb->iothub_callback.reported_state_cb_info.status_code, queued_cb->userContextCallback);
+            }
+            break;
+        case CALLBACK_TYPE_CONNECTION_STATUS:
+            if (iotHubClientInstance->connection_status_callback)
+            {
+                iotHubClientInstance->connection_status_callback(queued_cb->iothub_callback.connection_status_cb_info.connection_status, queued_cb->iothub_callback.connection_status_cb_info.status_reason, queued_cb->userContextCallback);
+            }
+            break;
+        case CALLBACK_TYPE_CONNECT:
+            if (iotHubClientInstance->connect_callback)
+            {
+                iotHubClientInstance->connect_callback(queued_cb->iothub_callback.connection_status_cb_info.connection_status, queued_cb->iothub_callback.connection_status_cb_info.status_reason, queued_cb->userContextCallback);
+            }
+            break;
+        case CALLBACK_TYPE_DEVICE_METHOD:
+            if (iotHubClientInstance->device_method_callback)
+            {
+                const char* method_name = STRING_c_str(queued_cb->iothub_callback.method_cb_info.method_name);
+                const unsigned char* payload = BUFFER_u_char(queued_cb->iothub_callback.method_cb_info.payload);
+                size_t payload_len = BUFFER_length(queued_cb->iothub_callback.method_cb_info.payload);
+
+                unsigned char* payload_resp = NULL;
+                size_t response_size = 0;
+                int status = iotHubClientInstance->device_method_callback(method_name, payload, payload_len, &payload_resp, &response_size, queued_cb->userContextCallback);
+
+                if (payload_resp && (response_size > 0))
+                {
+                    IOTHUB_CLIENT_HANDLE handle = iotHubClientInstance->method_user_context->iotHubClientHandle;
+                    IOTHUB_CLIENT_RESULT result = IoTHubClient_DeviceMethodResponse(handle, queued_cb->iothub_callback.method_cb_info.method_id, (const unsigned char*)payload_resp, response_size, status);
+                    if (result != IOTHUB_CLIENT_OK)
+                    {
+                        LogError("IoTHubClient_LL_DeviceMethodResponse failed");
+                    }
+                }
+
+                BUFFER_delete(queued_cb->iothub_callback.method_cb_info.payload);
+                STRING_delete(queued_cb->iothub_callback.method_cb_info.method_name);
+
+                if (payload_resp)
+                {
+                    free(payload_resp);
+                }
+            }
+            break;
+        case CALLBACK_TYPE_INBOUD_DEVICE_METHOD:
+            if (iotHubClientInstance->inbound_device_method_callback)
+            {
+                const char* method_name = STRING_c_str(queued_cb->iothub_callback.method_cb_info.method_name);
+                const unsigned char* payload = BUFFER_u_char(queued_cb->iothub_callback.method_cb_info.payload);
+                size_t payload_len = BUFFER_length(queued_cb->iothub_callback.method_cb_info.payload);
+
+                iotHubClientInstance->inbound_device_method_callback(method_name, payload, payload_len, queued_cb->iothub_callback.method_cb_info.method_id, queued_cb->userContextCallback);
+
+                BUFFER_delete(queued_cb->iothub_callback.method_cb_info.payload);
+                STRING_delete(queued_cb->iothub_callback.method_cb_info.method_name);
+            }
+            break;
+        case CALLBACK_TYPE_MESSAGE:
+            if (iotHubClientInstance->message_callback)
+            {
+                IOTHUBMESSAGE_DISPOSITION_RESULT disposition = iotHubClientInstance->message_callback(queued_cb->iothub_callback.message_cb_info->messageHandle, queued_cb->userContextCallback);
+                IOTHUB_CLIENT_HANDLE handle = iotHubClientInstance->message_user_context->iotHubClientHandle;
+
+                if (Lock(handle->LockHandle) == LOCK_OK)
+                {
+                    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendMessageDisposition(handle->IoTHubClientLLHandle, queued_cb->iothub_callback.message_cb_info, disposition);
+                    if (result == IOTHUB_CLIENT_OK)
+                    {
+                        signal_worker_thread(handle);
+                    }
+                    (void)Unlock(handle->LockHandle);
+                    if (result != IOTHUB_CLIENT_OK)
+                    {
+                        LogError("IoTHubClient_LL_SendMessageDisposition failed");
+                    }
+                }
+                else
+                {
+                    LogError("Lock failed");
+                }
+            }
+            break;
+        default:
+            LogError("Invalid callback type '%s'", ENUM_TO_STRING(USER_CALLBACK_TYPE, queued_cb->type));
+            break;
+    }
+}
+
 static void dispatch_user_callbacks(IOTHUB_CLIENT_INSTANCE* iotHubClientInstance, VECTOR_HANDLE call_backs)
 {
     size_t callbacks_length = VECTOR_size(call_backs);
@@ -411,116 +642,376 @@ static void dispatch_user_callbacks(IOTHUB_CLIENT_INSTANCE* iotHubClientInstance
         }
         else
         {
-            switch (queued_cb->type)
+            dispatch_user_callback(iotHubClientInstance, queued_cb);
+        }
+    }
+    VECTOR_destroy(call_backs);
+}
+
+/*this function is called with the dispatcher lock held, returns VECTOR_size of the queue when no queued callback can run now*/
+static size_t find_dispatchable_callback(CALLBACK_DISPATCHER* dispatcher)
+{
+    size_t queue_length = VECTOR_size(dispatcher->queue);
+    size_t index;
+    for (index = 0; index < queue_length; index++)
+    {
+        USER_CALLBACK_INFO* queued_cb = (USER_CALLBACK_INFO*)VECTOR_element(dispatcher->queue, index);
+        if ((queued_cb != NULL) && (!dispatcher->busy[queued_cb->type]))
+        {
+            break;
+        }
+    }
+    return index;
+}
+
+static int CallbackDispatch_Thread(void* threadArgument)
+{
+    CALLBACK_DISPATCHER* dispatcher = (CALLBACK_DISPATCHER*)threadArgument;
+    bool isLocked = (Lock(dispatcher->lock) == LOCK_OK);
+
+    if (!isLocked)
+    {
+        LogError("unable to Lock");
+    }
+
+    while (isLocked)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_31_033: [ A dispatcher thread shall run the oldest queued callback whose type is not being run by another dispatcher thread, so that callbacks of the same type run one at a time and in the order they were queued. ]*/
+        size_t index = find_dispatchable_callback(dispatcher);
+        if (index < VECTOR_size(dispatcher->queue))
+        {
+            USER_CALLBACK_INFO* element = (USER_CALLBACK_INFO*)VECTOR_element(dispatcher->queue, index);
+            USER_CALLBACK_INFO queued_cb = *element;
+            VECTOR_erase(dispatcher->queue, element, 1);
+            dispatcher->busy[queued_cb.type] = true;
+            (void)Unlock(dispatcher->lock);
+
+            dispatch_user_callback(dispatcher->iotHubClientInstance, &queued_cb);
+
+            isLocked = (Lock(dispatcher->lock) == LOCK_OK);
+            if (!isLocked)
             {
-                case CALLBACK_TYPE_DEVICE_TWIN:
-                    if (iotHubClientInstance->desired_state_callback)
-                    {
-                        iotHubClientInstance->desired_state_callback(queued_cb->iothub_callback.dev_twin_cb_info.update_state, queued_cb->iothub_callback.dev_twin_cb_info.payLoad, queued_cb->iothub_callback.dev_twin_cb_info.size, queued_cb->userContextCallback);
-                    }
-                    if (queued_cb->iothub_callback.dev_twin_cb_info.payLoad)
-                    {
-                        free(queued_cb->iothub_callback.dev_twin_cb_info.payLoad);
-                    }
-                    break;
-                case CALLBACK_TYPE_EVENT_CONFIRM:
-                    if (iotHubClientInstance->event_confirm_callback)
-                    {
-                        iotHubClientInstance->event_confirm_callback(queued_cb->iothub_callback.event_confirm_cb_info.confirm_result, queued_cb->userContextCallback);
-                    }
-                    break;
-                case CALLBACK_TYPE_REPORTED_STATE:
-                    if (iotHubClientInstance->reported_state_callback)
-                    {
-                        iotHubClientInstance->reported_state_callback(queued_cb->iothub_callback.reported_state_cb_info.status_code, queued_cb->userContextCallback);
-                    }
-                    break;
-                case CALLBACK_TYPE_CONNECTION_STATUS:
-                    if (iotHubClientInstance->connection_status_callback)
-                    {
-                        iotHubClientInstance->connection_status_callback(queued_cb->iothub_callback.connection_status_cb_info.connection_status, queued_cb->iothub_callback.connection_status_cb_info.status_reason, queued_cb->userContextCallback);
-                    }
-                    break;
-                case CALLBACK_TYPE_DEVICE_METHOD:
-                    if (iotHubClientInstance->device_method_callback)
-                    {
-                        const char* method_name = STRING_c_str(queued_cb->iothub_callback.method_cb_info.method_name);
-                        const unsigned char* payload = BUFFER_u_char(queued_cb->iothub_callback.method_cb_info.payload);
-                        size_t payload_len = BUFFER_length(queued_cb->iothub_callback.method_cb_info.payload);
+                LogError("unable to Lock");
+            }
+            else
+            {
+                dispatcher->busy[queued_cb.type] = false;
+            }
+        }
+        /*Codes_SRS_IOTHUBCLIENT_31_034: [ The dispatcher threads shall exit when IoTHubClient_Destroy is called. ]*/
+        else if (dispatcher->stop)
+        {
+            (void)Unlock(dispatcher->lock);
+            break;
+        }
+        else if (Condition_Wait(dispatcher->signal, dispatcher->lock, 0) == COND_ERROR)
+        {
+            LogError("Condition_Wait failed");
+        }
+    }
 
-                        unsigned char* payload_resp = NULL;
-                        size_t response_size = 0;
-                        int status = iotHubClientInstance->device_method_callback(method_name, payload, payload_len, &payload_resp, &response_size, queued_cb->userContextCallback);
+    return 0;
+}
 
-                        if (payload_resp && (response_size > 0))
-                        {
-                            IOTHUB_CLIENT_HANDLE handle = iotHubClientInstance->method_user_context->iotHubClientHandle;
-                            IOTHUB_CLIENT_RESULT result = IoTHubClient_DeviceMethodResponse(handle, queued_cb->iothub_callback.method_cb_info.method_id, (const unsigned char*)payload_resp, response_size, status);
-                            if (result != IOTHUB_CLIENT_OK)
-                            {
-                                LogError("IoTHubClient_LL_DeviceMethodResponse failed");
-                            }
-                        }
+/*hands the callbacks moved out of saved_user_callback_list to the dispatcher threads, runs them on the calling thread if they cannot be queued*/
+static void queue_dispatched_callbacks(IOTHUB_CLIENT_INSTANCE* iotHubClientInstance, CALLBACK_DISPATCHER* dispatcher, VECTOR_HANDLE call_backs)
+{
+    size_t callbacks_length = VECTOR_size(call_backs);
+    if (callbacks_length == 0)
+    {
+        VECTOR_destroy(call_backs);
+    }
+    else if (Lock(dispatcher->lock) != LOCK_OK)
+    {
+        LogError("unable to Lock, running the callbacks on the worker thread");
+        dispatch_user_callbacks(iotHubClientInstance, call_backs);
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBCLIENT_31_032: [ When the callback dispatcher is enabled, the worker thread shall queue the callbacks for the dispatcher threads instead of running them. ]*/
+        if (VECTOR_push_back(dispatcher->queue, VECTOR_element(call_backs, 0), callbacks_length) != 0)
+        {
+            (void)Unlock(dispatcher->lock);
+            LogError("unable to VECTOR_push_back, running the callbacks on the worker thread");
+            dispatch_user_callbacks(iotHubClientInstance, call_backs);
+        }
+        else
+        {
+            size_t index;
+            for (index = 0; (index < callbacks_length) && (index < dispatcher->thread_count); index++)
+            {
+                if (Condition_Post(dispatcher->signal) != COND_OK)
+                {
+                    LogError("unable to Condition_Post");
+                }
+            }
+            (void)Unlock(dispatcher->lock);
+            VECTOR_destroy(call_backs);
+        }
+    }
+}
 
-                        BUFFER_delete(queued_cb->iothub_callback.method_cb_info.payload);
-                        STRING_delete(queued_cb->iothub_callback.method_cb_info.method_name);
-						
-						if (payload_resp)
-						{
-                            free(payload_resp);
-						}
-                    }
-                    break;
-                case CALLBACK_TYPE_INBOUD_DEVICE_METHOD:
-                    if (iotHubClientInstance->inbound_device_method_callback)
-                    {
-                        const char* method_name = STRING_c_str(queued_cb->iothub_callback.method_cb_info.method_name);
-                        const unsigned char* payload = BUFFER_u_char(queued_cb->iothub_callback.method_cb_info.payload);
-                        size_t payload_len = BUFFER_length(queued_cb->iothub_callback.method_cb_info.payload);
+/*stops the dispatcher threads and waits for them to finish running the callbacks they took*/
+static void stop_callback_dispatcher(CALLBACK_DISPATCHER* dispatcher)
+{
+    size_t index;
+    if (Lock(dispatcher->lock) != LOCK_OK)
+    {
+        LogError("unable to Lock");
+    }
+    else
+    {
+        dispatcher->stop = 1;
+        for (index = 0; index < dispatcher->thread_count; index++)
+        {
+            if (Condition_Post(dispatcher->signal) != COND_OK)
+            {
+                LogError("unable to Condition_Post");
+            }
+        }
+        (void)Unlock(dispatcher->lock);
+    }
 
-                        iotHubClientInstance->inbound_device_method_callback(method_name, payload, payload_len, queued_cb->iothub_callback.method_cb_info.method_id, queued_cb->userContextCallback);
+    for (index = 0; index < dispatcher->thread_count; index++)
+    {
+        int res;
+        if (ThreadAPI_Join(dispatcher->threads[index], &res) != THREADAPI_OK)
+        {
+            LogError("ThreadAPI_Join failed");
+        }
+    }
+    dispatcher->thread_count = 0;
+}
 
-                        BUFFER_delete(queued_cb->iothub_callback.method_cb_info.payload);
-                        STRING_delete(queued_cb->iothub_callback.method_cb_info.method_name);
-                    }
-                    break;
-                case CALLBACK_TYPE_MESSAGE:
-                    if (iotHubClientInstance->message_callback)
-                    {
-                        IOTHUBMESSAGE_DISPOSITION_RESULT disposition = iotHubClientInstance->message_callback(queued_cb->iothub_callback.message_cb_info->messageHandle, queued_cb->userContextCallback);
-                        IOTHUB_CLIENT_HANDLE handle = iotHubClientInstance->message_user_context->iotHubClientHandle;
+/*the threads have to be stopped, the callbacks left in the queue are released by the caller*/
+static void destroy_callback_dispatcher(CALLBACK_DISPATCHER* dispatcher)
+{
+    VECTOR_destroy(dispatcher->queue);
+    Condition_Deinit(dispatcher->signal);
+    Lock_Deinit(dispatcher->lock);
+    free(dispatcher->threads);
+    free(dispatcher);
+}
 
-                        if (Lock(handle->LockHandle) == LOCK_OK)
-                        {
-                            IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendMessageDisposition(handle->IoTHubClientLLHandle, queued_cb->iothub_callback.message_cb_info, disposition);
-                            (void)Unlock(handle->LockHandle);
-                            if (result != IOTHUB_CLIENT_OK)
-                            {
-                                LogError("IoTHubClient_LL_SendMessageDisposition failed");
-                            }
-                        }
-                        else
-                        {
-                            LogError("Lock failed");
-                        }
-                    }
-                    break;
-                default:
-                    LogError("Invalid callback type '%s'", ENUM_TO_STRING(USER_CALLBACK_TYPE, queued_cb->type));
+static CALLBACK_DISPATCHER* create_callback_dispatcher(IOTHUB_CLIENT_INSTANCE* iotHubClientInstance, size_t thread_count)
+{
+    CALLBACK_DISPATCHER* result = (CALLBACK_DISPATCHER*)malloc(sizeof(CALLBACK_DISPATCHER));
+    if (result == NULL)
+    {
+        LogError("unable to malloc");
+    }
+    else
+    {
+        (void)memset(result, 0, sizeof(CALLBACK_DISPATCHER));
+        result->iotHubClientInstance = iotHubClientInstance;
+        if ((result->lock = Lock_Init()) == NULL)
+        {
+            LogError("Failure creating Lock object");
+            free(result);
+            result = NULL;
+        }
+        else if ((result->signal = Condition_Init()) == NULL)
+        {
+            LogError("Failure creating Condition object");
+            Lock_Deinit(result->lock);
+            free(result);
+            result = NULL;
+        }
+        else if ((result->queue = VECTOR_create(sizeof(USER_CALLBACK_INFO))) == NULL)
+        {
+            LogError("Failed creating VECTOR");
+            Condition_Deinit(result->signal);
+            Lock_Deinit(result->lock);
+            free(result);
+            result = NULL;
+        }
+        else if ((result->threads = (THREAD_HANDLE*)malloc(thread_count * sizeof(THREAD_HANDLE))) == NULL)
+        {
+            LogError("unable to malloc");
+            VECTOR_destroy(result->queue);
+            Condition_Deinit(result->signal);
+            Lock_Deinit(result->lock);
+            free(result);
+            result = NULL;
+        }
+        else
+        {
+            while (result->thread_count < thread_count)
+            {
+                if (ThreadAPI_Create(&result->threads[result->thread_count], CallbackDispatch_Thread, result) != THREADAPI_OK)
+                {
                     break;
+                }
+                result->thread_count++;
+            }
+
+            if (result->thread_count < thread_count)
+            {
+                LogError("ThreadAPI_Create failed");
+                stop_callback_dispatcher(result);
+                destroy_callback_dispatcher(result);
+                result = NULL;
             }
         }
     }
-    VECTOR_destroy(call_backs);
+    return result;
+}
+
+/*this function is called with LockHandle held, right after IoTHubClient_LL_DoWork. do_work_freq_ms caps the wait because data arriving from the network is only read inside IoTHubClient_LL_DoWork*/
+static unsigned int get_do_work_wait_ms(IOTHUB_CLIENT_INSTANCE* iotHubClientInstance)
+{
+    unsigned int result;
+    tickcounter_ms_t msUntilNextDeadline = IOTHUB_CLIENT_LL_NO_DEADLINE;
+    /*Codes_SRS_IOTHUBCLIENT_31_048: [ After calling IoTHubClient_LL_DoWork, the worker shall wait for the time returned by IoTHubClient_LL_GetNextDeadline, at most do_work_freq_ms milliseconds, or for do_work_freq_ms milliseconds if IoTHubClient_LL_GetNextDeadline fails. ]*/
+    if (IoTHubClient_LL_GetNextDeadline(iotHubClientInstance->IoTHubClientLLHandle, &msUntilNextDeadline) != IOTHUB_CLIENT_OK)
+    {
+        LogError("IoTHubClient_LL_GetNextDeadline failed");
+        result = iotHubClientInstance->do_work_freq_ms;
+    }
+    else
+    {
+        result = (msUntilNextDeadline < iotHubClientInstance->do_work_freq_ms) ? (unsigned int)msUntilNextDeadline : iotHubClientInstance->do_work_freq_ms;
+    }
+    return result;
+}
+
+/*this function is called with LockHandle held, Condition_Wait releases it while waiting and reacquires it before returning*/
+static void wait_for_work(IOTHUB_CLIENT_INSTANCE* iotHubClientInstance, unsigned int wait_ms)
+{
+    /*Codes_SRS_IOTHUBCLIENT_31_003: [ If no work was queued since the last call to IoTHubClient_LL_DoWork, the worker thread shall wait on a condition for at most do_work_freq_ms milliseconds. ]*/
+    /*a wait of 0 means a deadline is already due, Condition_Wait would take it as no timeout*/
+    if ((iotHubClientInstance->StopThread == 0) && (iotHubClientInstance->do_work_pending == 0) && (wait_ms != 0))
+    {
+        /*worker_waiting is set before looking at the submission queue: an event submitted after the queue was found empty is submitted by a thread that sees worker_waiting and signals the condition*/
+        iotHubClientInstance->worker_waiting = 1;
+        /*Codes_SRS_IOTHUBCLIENT_31_020: [ The worker thread shall not wait on the condition if events were submitted since it last drained the submission queue. ]*/
+        if (submission_queue_is_empty(&iotHubClientInstance->submissionQueue))
+        {
+            if (Condition_Wait(iotHubClientInstance->WorkSignal, iotHubClientInstance->LockHandle, (int)wait_ms) == COND_ERROR)
+            {
+                LogError("Condition_Wait failed");
+            }
+        }
+        iotHubClientInstance->worker_waiting = 0;
+    }
+}
+
+/*this function is called with LockHandle held, by the worker thread only*/
+static void process_submitted_events(IOTHUB_CLIENT_INSTANCE* iotHubClientInstance)
+{
+    /*Codes_SRS_IOTHUBCLIENT_31_018: [ Before calling IoTHubClient_LL_DoWork, the worker thread shall take all the events queued by IoTHubClient_SendEventAsync and pass them, in the order they were submitted, to IoTHubClient_LL_SendEventAsync_Move. ]*/
+    SUBMISSION_QUEUE_ENTRY* entry = submission_queue_take_all(&iotHubClientInstance->submissionQueue);
+    while (entry != NULL)
+    {
+        IOTHUB_SUBMITTED_EVENT* submitted_event = (IOTHUB_SUBMITTED_EVENT*)entry;
+        IOTHUB_CLIENT_RESULT result;
+        entry = entry->next;
+
+        iotHubClientInstance->event_confirm_callback = submitted_event->eventConfirmationCallback;
+        if (submitted_event->eventConfirmationCallback == NULL)
+        {
+            result = IoTHubClient_LL_SendEventAsync_Move(iotHubClientInstance->IoTHubClientLLHandle, submitted_event->messageHandle, NULL, submitted_event->userContextCallback);
+        }
+        else
+        {
+            /* Codes_SRS_IOTHUBCLIENT_07_001: [ IoTHubClient_SendEventAsync shall allocate a IOTHUB_QUEUE_CONTEXT object to be sent to the IoTHubClient_LL_SendEventAsync function as a user context. ] */
+            IOTHUB_QUEUE_CONTEXT* queue_context = (IOTHUB_QUEUE_CONTEXT*)malloc(sizeof(IOTHUB_QUEUE_CONTEXT));
+            if (queue_context == NULL)
+            {
+                LogError("Failed allocating QUEUE_CONTEXT");
+                result = IOTHUB_CLIENT_ERROR;
+            }
+            else
+            {
+                queue_context->iotHubClientHandle = iotHubClientInstance;
+                queue_context->userContextCallback = submitted_event->userContextCallback;
+                result = IoTHubClient_LL_SendEventAsync_Move(iotHubClientInstance->IoTHubClientLLHandle, submitted_event->messageHandle, iothub_ll_event_confirm_callback, queue_context);
+                if (result != IOTHUB_CLIENT_OK)
+                {
+                    free(queue_context);
+                }
+            }
+        }
+
+        if (result != IOTHUB_CLIENT_OK)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_31_019: [ If handing a submitted event to the LL layer fails, the worker thread shall destroy its message and call its eventConfirmationCallback with IOTHUB_CLIENT_CONFIRMATION_ERROR. ]*/
+            LogError("IoTHubClient_LL_SendEventAsync_Move failed");
+            IoTHubMessage_Destroy(submitted_event->messageHandle);
+            if (submitted_event->eventConfirmationCallback != NULL)
+            {
+                queue_event_confirm_callback(iotHubClientInstance, IOTHUB_CLIENT_CONFIRMATION_ERROR, submitted_event->userContextCallback);
+            }
+        }
+        free(submitted_event);
+    }
+}
+
+/*this function is called with LockHandle held and returns with LockHandle released, once the callbacks were dispatched.
+Returns how long to wait before the next call to IoTHubClient_LL_DoWork if no work is queued meanwhile*/
+static unsigned int do_scheduled_work(IOTHUB_CLIENT_INSTANCE* iotHubClientInstance)
+{
+    VECTOR_HANDLE call_backs;
+    CALLBACK_DISPATCHER* dispatcher;
+    unsigned int result;
+
+    /* Codes_SRS_IOTHUBCLIENT_01_039: [All calls to IoTHubClient_LL_DoWork shall be protected by the lock created in IotHubClient_Create.] */
+    iotHubClientInstance->do_work_pending = 0;
+    process_submitted_events(iotHubClientInstance);
+    IoTHubClient_LL_DoWork(iotHubClientInstance->IoTHubClientLLHandle);
+    result = get_do_work_wait_ms(iotHubClientInstance);
+
+#ifndef DONT_USE_UPLOADTOBLOB
+    garbageCollectorImpl(iotHubClientInstance);
+#endif
+    call_backs = VECTOR_move(iotHubClientInstance->saved_user_callback_list);
+    dispatcher = iotHubClientInstance->callbackDispatcher;
+    (void)Unlock(iotHubClientInstance->LockHandle);
+    if (call_backs == NULL)
+    {
+        LogError("VECTOR_move failed");
+    }
+    else if (dispatcher != NULL)
+    {
+        queue_dispatched_callbacks(iotHubClientInstance, dispatcher, call_backs);
+    }
+    else
+    {
+        dispatch_user_callbacks(iotHubClientInstance, call_backs);
+    }
+    return result;
+}
+
+/*the work function of a client run by a worker pool, does what one iteration of ScheduleWork_Thread does*/
+static unsigned int WorkerPool_Work(void* context)
+{
+    IOTHUB_CLIENT_INSTANCE* iotHubClientInstance = (IOTHUB_CLIENT_INSTANCE*)context;
+    unsigned int result;
+
+    /*Codes_SRS_IOTHUBCLIENT_31_039: [ A client run by a worker pool shall be run by a thread of the pool when work is queued for it and at least every do_work_freq_ms milliseconds, doing what the worker thread of the client would do. ]*/
+    if (Lock(iotHubClientInstance->LockHandle) != LOCK_OK)
+    {
+        LogError("unable to Lock");
+        result = iotHubClientInstance->do_work_freq_ms;
+    }
+    else
+    {
+        unsigned int wait_ms = do_scheduled_work(iotHubClientInstance);
+        /*work queued while the callbacks were dispatched (or not taken by process_submitted_events) is done right away*/
+        /*Codes_SRS_IOTHUBCLIENT_31_048: [ After calling IoTHubClient_LL_DoWork, the worker shall wait for the time returned by IoTHubClient_LL_GetNextDeadline, at most do_work_freq_ms milliseconds, or for do_work_freq_ms milliseconds if IoTHubClient_LL_GetNextDeadline fails. ]*/
+        result = ((iotHubClientInstance->do_work_pending != 0) || !submission_queue_is_empty(&iotHubClientInstance->submissionQueue)) ? 0 : wait_ms;
+    }
+    return result;
 }
 
 static int ScheduleWork_Thread(void* threadArgument)
 {
     IOTHUB_CLIENT_INSTANCE* iotHubClientInstance = (IOTHUB_CLIENT_INSTANCE*)threadArgument;
+    bool isLocked = (Lock(iotHubClientInstance->LockHandle) == LOCK_OK);
 
     while (1)
     {
-        if (Lock(iotHubClientInstance->LockHandle) == LOCK_OK)
+        if (isLocked)
         {
             /*Codes_SRS_IOTHUBCLIENT_01_038: [ The thread shall exit when IoTHubClient_Destroy is called. ]*/
             if (iotHubClientInstance->StopThread)
@@ -530,31 +1021,23 @@ static int ScheduleWork_Thread(void* threadArgument)
             }
             else
             {
-                /* Codes_SRS_IOTHUBCLIENT_01_037: [The thread created by IoTHubClient_SendEvent or IoTHubClient_SetMessageCallback shall call IoTHubClient_LL_DoWork every 1 ms.] */
-                /* Codes_SRS_IOTHUBCLIENT_01_039: [All calls to IoTHubClient_LL_DoWork shall be protected by the lock created in IotHubClient_Create.] */
-                IoTHubClient_LL_DoWork(iotHubClientInstance->IoTHubClientLLHandle);
+                /* Codes_SRS_IOTHUBCLIENT_31_001: [ The thread created by IoTHubClient_SendEvent or IoTHubClient_SetMessageCallback shall call IoTHubClient_LL_DoWork when work is queued and at least every do_work_freq_ms milliseconds. ]*/
+                unsigned int wait_ms = do_scheduled_work(iotHubClientInstance);
 
-#ifndef DONT_USE_UPLOADTOBLOB
-                garbageCollectorImpl(iotHubClientInstance);
-#endif
-                VECTOR_HANDLE call_backs = VECTOR_move(iotHubClientInstance->saved_user_callback_list);
-                (void)Unlock(iotHubClientInstance->LockHandle);
-                if (call_backs == NULL)
-                {
-                    LogError("VECTOR_move failed");
-                }
-                else
+                isLocked = (Lock(iotHubClientInstance->LockHandle) == LOCK_OK);
+                if (isLocked)
                 {
-                    dispatch_user_callbacks(iotHubClientInstance, call_backs);
+                    wait_for_work(iotHubClientInstance, wait_ms);
                 }
             }
         }
         else
         {
             /*Codes_SRS_IOTHUBCLIENT_01_040: [If acquiring the lock fails, IoTHubClient_LL_DoWork shall not be called.]*/
-            /*no code, shall retry*/
+            /*the condition cannot be waited on without the lock, so back off and retry*/
+            (void)ThreadAPI_Sleep(iotHubClientInstance->do_work_freq_ms);
+            isLocked = (Lock(iotHubClientInstance->LockHandle) == LOCK_OK);
         }
-        (void)ThreadAPI_Sleep(1);
     }
 
     return 0;
@@ -565,7 +1048,28 @@ static IOTHUB_CLIENT_RESULT StartWorkerThreadIfNeeded(IOTHUB_CLIENT_INSTANCE* io
     IOTHUB_CLIENT_RESULT result;
     if (iotHubClientInstance->TransportHandle == NULL)
     {
-        if (iotHubClientInstance->ThreadHandle == NULL)
+        if (iotHubClientInstance->workerPool != NULL)
+        {
+            if (iotHubClientInstance->workerPoolItem == NULL)
+            {
+                /*Codes_SRS_IOTHUBCLIENT_31_038: [ If a worker pool was set, the client shall be added to the pool by calling IoTHubWorkerPool_Add instead of starting a thread. ]*/
+                if ((iotHubClientInstance->workerPoolItem = IoTHubWorkerPool_Add(iotHubClientInstance->workerPool, WorkerPool_Work, iotHubClientInstance)) == NULL)
+                {
+                    LogError("IoTHubWorkerPool_Add failed");
+                    result = IOTHUB_CLIENT_ERROR;
+                }
+                else
+                {
+                    iotHubClientInstance->worker_started = 1;
+                    result = IOTHUB_CLIENT_OK;
+                }
+            }
+            else
+            {
+                result = IOTHUB_CLIENT_OK;
+            }
+        }
+        else if (iotHubClientInstance->ThreadHandle == NULL)
         {
             iotHubClientInstance->StopThread = 0;
             if (ThreadAPI_Create(&iotHubClientInstance->ThreadHandle, ScheduleWork_Thread, iotHubClientInstance) != THREADAPI_OK)
@@ -576,6 +1080,7 @@ static IOTHUB_CLIENT_RESULT StartWorkerThreadIfNeeded(IOTHUB_CLIENT_INSTANCE* io
             }
             else
             {
+                iotHubClientInstance->worker_started = 1;
                 result = IOTHUB_CLIENT_OK;
             }
         }
@@ -607,6 +1112,14 @@ static IOTHUB_CLIENT_INSTANCE* create_iothub_instance(const IOTHUB_CLIENT_CONFIG
             free(result);
             result = NULL;
         }
+        /*Codes_SRS_IOTHUBCLIENT_31_023: [ IoTHubClient_Create shall initialize the submission queue used by IoTHubClient_SendEventAsync. ]*/
+        else if (submission_queue_init(&result->submissionQueue) != 0)
+        {
+            LogError("Failed initializing the submission queue");
+            VECTOR_destroy(result->saved_user_callback_list);
+            free(result);
+            result = NULL;
+        }
         else
         {
 #ifndef DONT_USE_UPLOADTOBLOB
@@ -615,6 +1128,7 @@ static IOTHUB_CLIENT_INSTANCE* create_iothub_instance(const IOTHUB_CLIENT_CONFIG
             {
                 /*Codes_SRS_IOTHUBCLIENT_02_061: [ If creating the SINGLYLINKEDLIST_HANDLE fails then IoTHubClient_Create shall fail and return NULL. ]*/
                 LogError("unable to singlylinkedlist_create");
+                submission_queue_deinit(&result->submissionQueue);
                 VECTOR_destroy(result->saved_user_callback_list);
                 free(result);
                 result = NULL;
@@ -624,6 +1138,7 @@ static IOTHUB_CLIENT_INSTANCE* create_iothub_instance(const IOTHUB_CLIENT_CONFIG
             {
                 result->TransportHandle = transportHandle;
                 result->created_with_transport_handle = 0;
+                result->WorkSignal = NULL;
                 if (config != NULL)
                 {
                     if (transportHandle != NULL)
@@ -681,7 +1196,14 @@ static IOTHUB_CLIENT_INSTANCE* create_iothub_instance(const IOTHUB_CLIENT_CONFIG
                             LogError("Failure creating Lock object");
                             result->IoTHubClientLLHandle = NULL;
                         }
-                        else 
+                        /*Codes_SRS_IOTHUBCLIENT_31_004: [ IoTHubClient_Create shall create a condition used to wake up the worker thread. ]*/
+                        else if ((result->WorkSignal = Condition_Init()) == NULL)
+                        {
+                            /*Codes_SRS_IOTHUBCLIENT_31_005: [ If creating the condition fails, then IoTHubClient_Create shall return NULL. ]*/
+                            LogError("Failure creating Condition object");
+                            result->IoTHubClientLLHandle = NULL;
+                        }
+                        else
                         {
                             /* Codes_SRS_IOTHUBCLIENT_01_002: [IoTHubClient_Create shall instantiate a new IoTHubClient_LL instance by calling IoTHubClient_LL_Create and passing the config argument.] */
                             result->IoTHubClientLLHandle = IoTHubClient_LL_Create(config);
@@ -698,7 +1220,14 @@ static IOTHUB_CLIENT_INSTANCE* create_iothub_instance(const IOTHUB_CLIENT_CONFIG
                         LogError("Failure creating Lock object");
                         result->IoTHubClientLLHandle = NULL;
                     }
-                    else 
+                    /*Codes_SRS_IOTHUBCLIENT_31_004: [ IoTHubClient_Create shall create a condition used to wake up the worker thread. ]*/
+                    else if ((result->WorkSignal = Condition_Init()) == NULL)
+                    {
+                        /*Codes_SRS_IOTHUBCLIENT_31_005: [ If creating the condition fails, then IoTHubClient_Create shall return NULL. ]*/
+                        LogError("Failure creating Condition object");
+                        result->IoTHubClientLLHandle = NULL;
+                    }
+                    else
                     {
                         /* Codes_SRS_IOTHUBCLIENT_12_006: [IoTHubClient_CreateFromConnectionString shall instantiate a new IoTHubClient_LL instance by calling IoTHubClient_LL_CreateFromConnectionString and passing the connectionString] */
                         result->IoTHubClientLLHandle = IoTHubClient_LL_CreateFromConnectionString(connectionString, protocol);
@@ -713,11 +1242,16 @@ static IOTHUB_CLIENT_INSTANCE* create_iothub_instance(const IOTHUB_CLIENT_CONFIG
                     if (transportHandle == NULL)
                     {
                         Lock_Deinit(result->LockHandle);
+                        if (result->WorkSignal != NULL)
+                        {
+                            Condition_Deinit(result->WorkSignal);
+                        }
                     }
 #ifndef DONT_USE_UPLOADTOBLOB
                     singlylinkedlist_destroy(result->savedDataToBeCleaned);
 #endif
                     LogError("Failure creating iothub handle");
+                    submission_queue_deinit(&result->submissionQueue);
                     VECTOR_destroy(result->saved_user_callback_list);
                     free(result);
                     result = NULL;
@@ -725,15 +1259,24 @@ static IOTHUB_CLIENT_INSTANCE* create_iothub_instance(const IOTHUB_CLIENT_CONFIG
                 else
                 {
                     result->ThreadHandle = NULL;
+                    result->do_work_pending = 0;
+                    result->worker_waiting = 0;
+                    result->worker_started = 0;
+                    result->do_work_freq_ms = DO_WORK_FREQ_DEFAULT_MS;
+                    result->workerPool = NULL;
+                    result->workerPoolItem = NULL;
                     result->desired_state_callback = NULL;
                     result->event_confirm_callback = NULL;
                     result->reported_state_callback = NULL;
                     result->devicetwin_user_context = NULL;
                     result->connection_status_callback = NULL;
                     result->connection_status_user_context = NULL;
+                    result->connect_callback = NULL;
+                    result->connect_user_context = NULL;
                     result->message_callback = NULL;
                     result->message_user_context = NULL;
                     result->method_user_context = NULL;
+                    result->callbackDispatcher = NULL;
                 }
             }
         }
@@ -796,16 +1339,63 @@ IOTHUB_CLIENT_HANDLE IoTHubClient_CreateWithTransport(TRANSPORT_HANDLE transport
 }
 
 /* Codes_SRS_IOTHUBCLIENT_01_005: [IoTHubClient_Destroy shall free all resources associated with the iotHubClientHandle instance.] */
+/*called by IoTHubClient_Destroy for the callbacks that were saved but not run*/
+static void release_user_callbacks(IOTHUB_CLIENT_INSTANCE* iotHubClientInstance, VECTOR_HANDLE call_backs)
+{
+    size_t vector_size = VECTOR_size(call_backs);
+    size_t index = 0;
+    for (index = 0; index < vector_size; index++)
+    {
+        USER_CALLBACK_INFO* queue_cb_info = (USER_CALLBACK_INFO*)VECTOR_element(call_backs, index);
+        if (queue_cb_info != NULL)
+        {
+            if ((queue_cb_info->type == CALLBACK_TYPE_DEVICE_METHOD) || (queue_cb_info->type == CALLBACK_TYPE_INBOUD_DEVICE_METHOD))
+            {
+                STRING_delete(queue_cb_info->iothub_callback.method_cb_info.method_name);
+                BUFFER_delete(queue_cb_info->iothub_callback.method_cb_info.payload);
+            }
+            else if (queue_cb_info->type == CALLBACK_TYPE_DEVICE_TWIN)
+            {
+                if (queue_cb_info->iothub_callback.dev_twin_cb_info.payLoad != NULL)
+                {
+                    free(queue_cb_info->iothub_callback.dev_twin_cb_info.payLoad);
+                }
+            }
+            else if (queue_cb_info->type == CALLBACK_TYPE_EVENT_CONFIRM)
+            {
+                if (iotHubClientInstance->event_confirm_callback)
+                {
+                    iotHubClientInstance->event_confirm_callback(queue_cb_info->iothub_callback.event_confirm_cb_info.confirm_result, queue_cb_info->userContextCallback);
+                }
+            }
+        }
+    }
+}
+
 void IoTHubClient_Destroy(IOTHUB_CLIENT_HANDLE iotHubClientHandle)
 {
     /* Codes_SRS_IOTHUBCLIENT_01_008: [IoTHubClient_Destroy shall do nothing if parameter iotHubClientHandle is NULL.] */
     if (iotHubClientHandle != NULL)
     {
         bool okToJoin;
-        size_t vector_size;
+        SUBMISSION_QUEUE_ENTRY* submitted_entry;
 
         IOTHUB_CLIENT_INSTANCE* iotHubClientInstance = (IOTHUB_CLIENT_INSTANCE*)iotHubClientHandle;
 
+        if (iotHubClientInstance->callbackDispatcher != NULL)
+        {
+            /*the callbacks run by the dispatcher threads can signal the worker pool, so the dispatcher threads are stopped first*/
+            /*Codes_SRS_IOTHUBCLIENT_31_035: [ IoTHubClient_Destroy shall stop and join the dispatcher threads before taking the serializing lock, so that the callbacks they run can still use the client. ]*/
+            stop_callback_dispatcher(iotHubClientInstance->callbackDispatcher);
+        }
+
+        if (iotHubClientInstance->workerPoolItem != NULL)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_31_040: [ IoTHubClient_Destroy shall remove the client from its worker pool by calling IoTHubWorkerPool_Remove before taking the serializing lock. ]*/
+            IoTHubWorkerPool_Remove(iotHubClientInstance->workerPoolItem);
+            iotHubClientInstance->workerPoolItem = NULL;
+        }
+
         /*Codes_SRS_IOTHUBCLIENT_02_043: [ IoTHubClient_Destroy shall lock the serializing lock and signal the worker thread (if any) to end ]*/
         if (Lock(iotHubClientInstance->LockHandle) != LOCK_OK)
         {
@@ -823,6 +1413,7 @@ void IoTHubClient_Destroy(IOTHUB_CLIENT_HANDLE iotHubClientHandle)
         if (iotHubClientInstance->ThreadHandle != NULL)
         {
             iotHubClientInstance->StopThread = 1;
+            signal_worker_thread(iotHubClientInstance);
             okToJoin = true;
         }
         else
@@ -871,40 +1462,38 @@ void IoTHubClient_Destroy(IOTHUB_CLIENT_HANDLE iotHubClientHandle)
             }
         }
 
-        vector_size = VECTOR_size(iotHubClientInstance->saved_user_callback_list);
-        size_t index = 0;
-        for (index = 0; index < vector_size; index++)
+        if (iotHubClientInstance->callbackDispatcher != NULL)
+        {
+            /*the callbacks queued for the dispatcher threads were saved before the ones left in saved_user_callback_list*/
+            release_user_callbacks(iotHubClientInstance, iotHubClientInstance->callbackDispatcher->queue);
+            /*Codes_SRS_IOTHUBCLIENT_31_036: [ IoTHubClient_Destroy shall free the resources of the callback dispatcher. ]*/
+            destroy_callback_dispatcher(iotHubClientInstance->callbackDispatcher);
+        }
+        release_user_callbacks(iotHubClientInstance, iotHubClientInstance->saved_user_callback_list);
+
+        /*Codes_SRS_IOTHUBCLIENT_31_021: [ IoTHubClient_Destroy shall destroy the messages of the events submitted by IoTHubClient_SendEventAsync that the worker thread did not process and call their eventConfirmationCallback with IOTHUB_CLIENT_CONFIRMATION_BECAUSE_DESTROY. ]*/
+        submitted_entry = submission_queue_take_all(&iotHubClientInstance->submissionQueue);
+        while (submitted_entry != NULL)
         {
-            USER_CALLBACK_INFO* queue_cb_info = (USER_CALLBACK_INFO*)VECTOR_element(iotHubClientInstance->saved_user_callback_list, index);
-            if (queue_cb_info != NULL)
+            IOTHUB_SUBMITTED_EVENT* submitted_event = (IOTHUB_SUBMITTED_EVENT*)submitted_entry;
+            submitted_entry = submitted_entry->next;
+            IoTHubMessage_Destroy(submitted_event->messageHandle);
+            if (submitted_event->eventConfirmationCallback != NULL)
             {
-                if ((queue_cb_info->type == CALLBACK_TYPE_DEVICE_METHOD) || (queue_cb_info->type == CALLBACK_TYPE_INBOUD_DEVICE_METHOD))
-                {
-                    STRING_delete(queue_cb_info->iothub_callback.method_cb_info.method_name);
-                    BUFFER_delete(queue_cb_info->iothub_callback.method_cb_info.payload);
-                }
-                else if (queue_cb_info->type == CALLBACK_TYPE_DEVICE_TWIN)
-                {
-                    if (queue_cb_info->iothub_callback.dev_twin_cb_info.payLoad != NULL)
-                    {
-                        free(queue_cb_info->iothub_callback.dev_twin_cb_info.payLoad);
-                    }
-                }
-                else if (queue_cb_info->type == CALLBACK_TYPE_EVENT_CONFIRM)
-                {
-                    if (iotHubClientInstance->event_confirm_callback)
-                    {
-                        iotHubClientInstance->event_confirm_callback(queue_cb_info->iothub_callback.event_confirm_cb_info.confirm_result, queue_cb_info->userContextCallback);
-                    }
-                }
+                submitted_event->eventConfirmationCallback(IOTHUB_CLIENT_CONFIRMATION_BECAUSE_DESTROY, submitted_event->userContextCallback);
             }
+            free(submitted_event);
         }
+        submission_queue_deinit(&iotHubClientInstance->submissionQueue);
+
         VECTOR_destroy(iotHubClientInstance->saved_user_callback_list);
 
         if (iotHubClientInstance->TransportHandle == NULL)
         {
             /* Codes_SRS_IOTHUBCLIENT_01_032: [If the lock was allocated in IoTHubClient_Create, it shall be also freed..] */
             Lock_Deinit(iotHubClientInstance->LockHandle);
+            /*Codes_SRS_IOTHUBCLIENT_31_006: [ IoTHubClient_Destroy shall free the condition created in IoTHubClient_Create. ]*/
+            Condition_Deinit(iotHubClientInstance->WorkSignal);
         }
         if (iotHubClientInstance->devicetwin_user_context != NULL)
         {
@@ -926,20 +1515,54 @@ void IoTHubClient_Destroy(IOTHUB_CLIENT_HANDLE iotHubClientHandle)
     }
 }
 
-IOTHUB_CLIENT_RESULT IoTHubClient_SendEventAsync(IOTHUB_CLIENT_HANDLE iotHubClientHandle, IOTHUB_MESSAGE_HANDLE eventMessageHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK eventConfirmationCallback, void* userContextCallback)
+/*a client sharing its transport is run by the worker thread of the transport, which calls IoTHubClient_LL_DoWork for all the clients of the transport, so events are given to the LL layer under the lock of the transport*/
+static IOTHUB_CLIENT_RESULT send_event_async_with_shared_transport(IOTHUB_CLIENT_INSTANCE* iotHubClientInstance, IOTHUB_MESSAGE_HANDLE eventMessageHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK eventConfirmationCallback, void* userContextCallback, bool takeOwnership)
 {
     IOTHUB_CLIENT_RESULT result;
 
-    if (iotHubClientHandle == NULL)
+    /* Codes_SRS_IOTHUBCLIENT_01_025: [IoTHubClient_SendEventAsync shall be made thread-safe by using the lock created in IoTHubClient_Create.] */
+    if (Lock(iotHubClientInstance->LockHandle) != LOCK_OK)
     {
-        /* Codes_SRS_IOTHUBCLIENT_01_011: [If iotHubClientHandle is NULL, IoTHubClient_SendEventAsync shall return IOTHUB_CLIENT_INVALID_ARG.] */
-        result = IOTHUB_CLIENT_INVALID_ARG;
-        LogError("NULL iothubClientHandle");
+        /* Codes_SRS_IOTHUBCLIENT_01_026: [If acquiring the lock fails, IoTHubClient_SendEventAsync shall return IOTHUB_CLIENT_ERROR.] */
+        result = IOTHUB_CLIENT_ERROR;
+        LogError("Could not acquire lock");
     }
     else
     {
-        IOTHUB_CLIENT_INSTANCE* iotHubClientInstance = (IOTHUB_CLIENT_INSTANCE*)iotHubClientHandle;
+        /* Codes_SRS_IOTHUBCLIENT_01_009: [IoTHubClient_SendEventAsync shall start the worker thread if it was not previously started.] */
+        if ((result = StartWorkerThreadIfNeeded(iotHubClientInstance)) != IOTHUB_CLIENT_OK)
+        {
+            /* Codes_SRS_IOTHUBCLIENT_01_010: [If starting the thread fails, IoTHubClient_SendEventAsync shall return IOTHUB_CLIENT_ERROR.] */
+            result = IOTHUB_CLIENT_ERROR;
+            LogError("Could not start worker thread");
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBCLIENT_31_011: [ IoTHubClient_SendEventAsync_Move shall call IoTHubClient_LL_SendEventAsync_Move instead of IoTHubClient_LL_SendEventAsync, so that ownership of eventMessageHandle passes to the client when the call succeeds. ]*/
+            IOTHUB_CLIENT_RESULT(*ll_send_event_async)(IOTHUB_CLIENT_LL_HANDLE, IOTHUB_MESSAGE_HANDLE, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK, void*) = takeOwnership ? IoTHubClient_LL_SendEventAsync_Move : IoTHubClient_LL_SendEventAsync;
+            /* Codes_SRS_IOTHUBCLIENT_01_012: [IoTHubClient_SendEventAsync shall call IoTHubClient_LL_SendEventAsync, while passing the IoTHubClient_LL handle created by IoTHubClient_Create and the parameters eventMessageHandle, eventConfirmationCallback and userContextCallback.] */
+            /* Codes_SRS_IOTHUBCLIENT_01_013: [When IoTHubClient_LL_SendEventAsync is called, IoTHubClient_SendEventAsync shall return the result of IoTHubClient_LL_SendEventAsync.] */
+            result = ll_send_event_async(iotHubClientInstance->IoTHubClientLLHandle, eventMessageHandle, eventConfirmationCallback, userContextCallback);
+            if (result == IOTHUB_CLIENT_OK)
+            {
+                signal_worker_thread(iotHubClientInstance);
+            }
+        }
+
+        /* Codes_SRS_IOTHUBCLIENT_01_025: [IoTHubClient_SendEventAsync shall be made thread-safe by using the lock created in IoTHubClient_Create.] */
+        (void)Unlock(iotHubClientInstance->LockHandle);
+    }
+
+    return result;
+}
+
+static IOTHUB_CLIENT_RESULT submit_event_async(IOTHUB_CLIENT_INSTANCE* iotHubClientInstance, IOTHUB_MESSAGE_HANDLE eventMessageHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK eventConfirmationCallback, void* userContextCallback, bool takeOwnership)
+{
+    IOTHUB_CLIENT_RESULT result;
 
+    /*Codes_SRS_IOTHUBCLIENT_31_014: [ IoTHubClient_SendEventAsync shall only take the lock created in IoTHubClient_Create to start the worker thread, once the thread runs it shall not take the lock unless the worker thread is waiting for work. ]*/
+    if (iotHubClientInstance->worker_started == 0)
+    {
         /* Codes_SRS_IOTHUBCLIENT_01_025: [IoTHubClient_SendEventAsync shall be made thread-safe by using the lock created in IoTHubClient_Create.] */
         if (Lock(iotHubClientInstance->LockHandle) != LOCK_OK)
         {
@@ -949,56 +1572,126 @@ IOTHUB_CLIENT_RESULT IoTHubClient_SendEventAsync(IOTHUB_CLIENT_HANDLE iotHubClie
         }
         else
         {
-            if (iotHubClientInstance->created_with_transport_handle == 0)
-            {
-                iotHubClientInstance->event_confirm_callback = eventConfirmationCallback;
-            }
             /* Codes_SRS_IOTHUBCLIENT_01_009: [IoTHubClient_SendEventAsync shall start the worker thread if it was not previously started.] */
-            if ((result = StartWorkerThreadIfNeeded(iotHubClientInstance)) != IOTHUB_CLIENT_OK)
+            result = StartWorkerThreadIfNeeded(iotHubClientInstance);
+            (void)Unlock(iotHubClientInstance->LockHandle);
+            if (result != IOTHUB_CLIENT_OK)
             {
                 /* Codes_SRS_IOTHUBCLIENT_01_010: [If starting the thread fails, IoTHubClient_SendEventAsync shall return IOTHUB_CLIENT_ERROR.] */
                 result = IOTHUB_CLIENT_ERROR;
                 LogError("Could not start worker thread");
             }
+        }
+    }
+    else
+    {
+        result = IOTHUB_CLIENT_OK;
+    }
+
+    if (result == IOTHUB_CLIENT_OK)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_31_015: [ IoTHubClient_SendEventAsync shall make a copy of eventMessageHandle by calling IoTHubMessage_Clone. If that fails, it shall return IOTHUB_CLIENT_ERROR. ]*/
+        /*Codes_SRS_IOTHUBCLIENT_31_022: [ IoTHubClient_SendEventAsync_Move shall queue eventMessageHandle itself instead of a copy, so that ownership of eventMessageHandle passes to the client when the call succeeds. ]*/
+        IOTHUB_MESSAGE_HANDLE messageHandle = takeOwnership ? eventMessageHandle : IoTHubMessage_Clone(eventMessageHandle);
+        if (messageHandle == NULL)
+        {
+            result = IOTHUB_CLIENT_ERROR;
+            LogError("IoTHubMessage_Clone failed");
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBCLIENT_31_016: [ IoTHubClient_SendEventAsync shall allocate an IOTHUB_SUBMITTED_EVENT holding the message, eventConfirmationCallback and userContextCallback. If that fails, it shall return IOTHUB_CLIENT_ERROR. ]*/
+            IOTHUB_SUBMITTED_EVENT* submitted_event = (IOTHUB_SUBMITTED_EVENT*)malloc(sizeof(IOTHUB_SUBMITTED_EVENT));
+            if (submitted_event == NULL)
+            {
+                result = IOTHUB_CLIENT_ERROR;
+                LogError("Failed allocating IOTHUB_SUBMITTED_EVENT");
+            }
             else
             {
-                if (iotHubClientInstance->created_with_transport_handle != 0 || eventConfirmationCallback == NULL)
+                submitted_event->messageHandle = messageHandle;
+                submitted_event->eventConfirmationCallback = eventConfirmationCallback;
+                submitted_event->userContextCallback = userContextCallback;
+
+                /*Codes_SRS_IOTHUBCLIENT_31_012: [ If the client does not share its transport, IoTHubClient_SendEventAsync shall not call IoTHubClient_LL_SendEventAsync, it shall push the event to the lock free submission queue drained by the worker thread and return IOTHUB_CLIENT_OK. ]*/
+                if (submission_queue_push(&iotHubClientInstance->submissionQueue, &submitted_event->entry) != 0)
                 {
-                    result = IoTHubClient_LL_SendEventAsync(iotHubClientInstance->IoTHubClientLLHandle, eventMessageHandle, eventConfirmationCallback, userContextCallback);
+                    result = IOTHUB_CLIENT_ERROR;
+                    LogError("submission_queue_push failed");
+                    free(submitted_event);
                 }
                 else
                 {
-                    /* Codes_SRS_IOTHUBCLIENT_07_001: [ IoTHubClient_SendEventAsync shall allocate a IOTHUB_QUEUE_CONTEXT object to be sent to the IoTHubClient_LL_SendEventAsync function as a user context. ] */
-                    IOTHUB_QUEUE_CONTEXT* queue_context = (IOTHUB_QUEUE_CONTEXT*)malloc(sizeof(IOTHUB_QUEUE_CONTEXT));
-                    if (queue_context == NULL)
+                    /*Codes_SRS_IOTHUBCLIENT_31_017: [ If the worker thread is waiting for work, IoTHubClient_SendEventAsync shall take the lock created in IoTHubClient_Create and wake the worker thread up. ]*/
+                    /*submission_queue_push is a full memory barrier, so either the worker thread finds the event before it waits or worker_waiting is seen set here*/
+                    if (iotHubClientInstance->workerPoolItem != NULL)
                     {
-                        result = IOTHUB_CLIENT_ERROR;
-                        LogError("Failed allocating QUEUE_CONTEXT");
+                        IoTHubWorkerPool_Signal(iotHubClientInstance->workerPoolItem);
                     }
-                    else
+                    else if (iotHubClientInstance->worker_waiting != 0)
                     {
-                        queue_context->iotHubClientHandle = iotHubClientInstance;
-                        queue_context->userContextCallback = userContextCallback;
-                        /* Codes_SRS_IOTHUBCLIENT_01_012: [IoTHubClient_SendEventAsync shall call IoTHubClient_LL_SendEventAsync, while passing the IoTHubClient_LL handle created by IoTHubClient_Create and the parameters eventMessageHandle, eventConfirmationCallback and userContextCallback.] */
-                        /* Codes_SRS_IOTHUBCLIENT_01_013: [When IoTHubClient_LL_SendEventAsync is called, IoTHubClient_SendEventAsync shall return the result of IoTHubClient_LL_SendEventAsync.] */
-                        result = IoTHubClient_LL_SendEventAsync(iotHubClientInstance->IoTHubClientLLHandle, eventMessageHandle, iothub_ll_event_confirm_callback, queue_context);
-                        if (result != IOTHUB_CLIENT_OK)
+                        if (Lock(iotHubClientInstance->LockHandle) != LOCK_OK)
                         {
-                            LogError("IoTHubClient_LL_SendEventAsync failed");
-                            free(queue_context);
+                            LogError("Could not acquire lock, the worker thread picks the event up at its next cycle");
+                        }
+                        else
+                        {
+                            signal_worker_thread(iotHubClientInstance);
+                            (void)Unlock(iotHubClientInstance->LockHandle);
                         }
                     }
+                    result = IOTHUB_CLIENT_OK;
                 }
             }
 
-            /* Codes_SRS_IOTHUBCLIENT_01_025: [IoTHubClient_SendEventAsync shall be made thread-safe by using the lock created in IoTHubClient_Create.] */
-            (void)Unlock(iotHubClientInstance->LockHandle);
+            if ((result != IOTHUB_CLIENT_OK) && !takeOwnership)
+            {
+                IoTHubMessage_Destroy(messageHandle);
+            }
         }
     }
 
     return result;
 }
 
+static IOTHUB_CLIENT_RESULT send_event_async(IOTHUB_CLIENT_HANDLE iotHubClientHandle, IOTHUB_MESSAGE_HANDLE eventMessageHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK eventConfirmationCallback, void* userContextCallback, bool takeOwnership)
+{
+    IOTHUB_CLIENT_RESULT result;
+
+    if (iotHubClientHandle == NULL)
+    {
+        /* Codes_SRS_IOTHUBCLIENT_01_011: [If iotHubClientHandle is NULL, IoTHubClient_SendEventAsync shall return IOTHUB_CLIENT_INVALID_ARG.] */
+        result = IOTHUB_CLIENT_INVALID_ARG;
+        LogError("NULL iothubClientHandle");
+    }
+    else if (iotHubClientHandle->created_with_transport_handle != 0)
+    {
+        result = send_event_async_with_shared_transport(iotHubClientHandle, eventMessageHandle, eventConfirmationCallback, userContextCallback, takeOwnership);
+    }
+    else if (eventMessageHandle == NULL)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_31_013: [ If eventMessageHandle is NULL, IoTHubClient_SendEventAsync shall return IOTHUB_CLIENT_INVALID_ARG. ]*/
+        result = IOTHUB_CLIENT_INVALID_ARG;
+        LogError("NULL eventMessageHandle");
+    }
+    else
+    {
+        result = submit_event_async(iotHubClientHandle, eventMessageHandle, eventConfirmationCallback, userContextCallback, takeOwnership);
+    }
+
+    return result;
+}
+
+IOTHUB_CLIENT_RESULT IoTHubClient_SendEventAsync(IOTHUB_CLIENT_HANDLE iotHubClientHandle, IOTHUB_MESSAGE_HANDLE eventMessageHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK eventConfirmationCallback, void* userContextCallback)
+{
+    return send_event_async(iotHubClientHandle, eventMessageHandle, eventConfirmationCallback, userContextCallback, false);
+}
+
+IOTHUB_CLIENT_RESULT IoTHubClient_SendEventAsync_Move(IOTHUB_CLIENT_HANDLE iotHubClientHandle, IOTHUB_MESSAGE_HANDLE eventMessageHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK eventConfirmationCallback, void* userContextCallback)
+{
+    return send_event_async(iotHubClientHandle, eventMessageHandle, eventConfirmationCallback, userContextCallback, true);
+}
+
 IOTHUB_CLIENT_RESULT IoTHubClient_GetSendStatus(IOTHUB_CLIENT_HANDLE iotHubClientHandle, IOTHUB_CLIENT_STATUS *iotHubClientStatus)
 {
     IOTHUB_CLIENT_RESULT result;
@@ -1193,6 +1886,54 @@ IOTHUB_CLIENT_RESULT IoTHubClient_SetConnectionStatusCallback(IOTHUB_CLIENT_HAND
     return result;
 }
 
+IOTHUB_CLIENT_RESULT IoTHubClient_Connect(IOTHUB_CLIENT_HANDLE iotHubClientHandle, IOTHUB_CLIENT_CONNECTION_STATUS_CALLBACK connectCallback, void* userContextCallback)
+{
+    IOTHUB_CLIENT_RESULT result;
+
+    if (iotHubClientHandle == NULL)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_31_042: [ If iotHubClientHandle is NULL, IoTHubClient_Connect shall return IOTHUB_CLIENT_INVALID_ARG. ]*/
+        result = IOTHUB_CLIENT_INVALID_ARG;
+        LogError("NULL iothubClientHandle");
+    }
+    else
+    {
+        IOTHUB_CLIENT_INSTANCE* iotHubClientInstance = (IOTHUB_CLIENT_INSTANCE*)iotHubClientHandle;
+
+        /*Codes_SRS_IOTHUBCLIENT_31_043: [ IoTHubClient_Connect shall be made thread-safe by using the lock created in IoTHubClient_Create. ]*/
+        if (Lock(iotHubClientInstance->LockHandle) != LOCK_OK)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_31_044: [ If acquiring the lock fails, IoTHubClient_Connect shall return IOTHUB_CLIENT_ERROR. ]*/
+            result = IOTHUB_CLIENT_ERROR;
+            LogError("Could not acquire lock");
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBCLIENT_31_045: [ IoTHubClient_Connect shall start the worker thread if it was not previously started. ]*/
+            if ((result = StartWorkerThreadIfNeeded(iotHubClientInstance)) != IOTHUB_CLIENT_OK)
+            {
+                /*Codes_SRS_IOTHUBCLIENT_31_046: [ If starting the thread fails, IoTHubClient_Connect shall return IOTHUB_CLIENT_ERROR. ]*/
+                result = IOTHUB_CLIENT_ERROR;
+                LogError("Could not start worker thread");
+            }
+            else
+            {
+                /*Codes_SRS_IOTHUBCLIENT_31_047: [ IoTHubClient_Connect shall save connectCallback and userContextCallback, call IoTHubClient_LL_Connect with a callback that queues connectCallback to run like the other callbacks, and return its result. ]*/
+                iotHubClientInstance->connect_callback = connectCallback;
+                iotHubClientInstance->connect_user_context = userContextCallback;
+                result = IoTHubClient_LL_Connect(iotHubClientInstance->IoTHubClientLLHandle, iothub_ll_connect_callback, iotHubClientInstance);
+                if (result != IOTHUB_CLIENT_OK)
+                {
+                    LogError("IoTHubClient_LL_Connect failed");
+                }
+            }
+            (void)Unlock(iotHubClientInstance->LockHandle);
+        }
+    }
+
+    return result;
+}
+
 IOTHUB_CLIENT_RESULT IoTHubClient_SetRetryPolicy(IOTHUB_CLIENT_HANDLE iotHubClientHandle, IOTHUB_CLIENT_RETRY_POLICY retryPolicy, size_t retryTimeoutLimitInSeconds)
 {
     IOTHUB_CLIENT_RESULT result;
@@ -1314,6 +2055,39 @@ IOTHUB_CLIENT_RESULT IoTHubClient_GetLastMessageReceiveTime(IOTHUB_CLIENT_HANDLE
     return result;
 }
 
+IOTHUB_CLIENT_RESULT IoTHubClient_GetStatistics(IOTHUB_CLIENT_HANDLE iotHubClientHandle, IOTHUB_CLIENT_STATISTICS* statistics)
+{
+    IOTHUB_CLIENT_RESULT result;
+
+    if (iotHubClientHandle == NULL || statistics == NULL)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_31_024: [ If iotHubClientHandle or statistics is NULL, IoTHubClient_GetStatistics shall return IOTHUB_CLIENT_INVALID_ARG. ]*/
+        result = IOTHUB_CLIENT_INVALID_ARG;
+        LogError("invalid arg (NULL) iotHubClientHandle=%p, statistics=%p", iotHubClientHandle, statistics);
+    }
+    else
+    {
+        IOTHUB_CLIENT_INSTANCE* iotHubClientInstance = (IOTHUB_CLIENT_INSTANCE*)iotHubClientHandle;
+
+        /*Codes_SRS_IOTHUBCLIENT_31_025: [ IoTHubClient_GetStatistics shall be made thread-safe by using the lock created in IoTHubClient_Create. ]*/
+        if (Lock(iotHubClientInstance->LockHandle) != LOCK_OK)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_31_026: [ If acquiring the lock fails, IoTHubClient_GetStatistics shall return IOTHUB_CLIENT_ERROR. ]*/
+            result = IOTHUB_CLIENT_ERROR;
+            LogError("Could not acquire lock");
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBCLIENT_31_027: [ IoTHubClient_GetStatistics shall call IoTHubClient_LL_GetStatistics and return its result. ]*/
+            result = IoTHubClient_LL_GetStatistics(iotHubClientInstance->IoTHubClientLLHandle, statistics);
+
+            (void)Unlock(iotHubClientInstance->LockHandle);
+        }
+    }
+
+    return result;
+}
+
 IOTHUB_CLIENT_RESULT IoTHubClient_SetOption(IOTHUB_CLIENT_HANDLE iotHubClientHandle, const char* optionName, const void* value)
 {
     IOTHUB_CLIENT_RESULT result;
@@ -1342,11 +2116,94 @@ IOTHUB_CLIENT_RESULT IoTHubClient_SetOption(IOTHUB_CLIENT_HANDLE iotHubClientHan
         }
         else
         {
-            /*Codes_SRS_IOTHUBCLIENT_02_038: [If optionName doesn't match one of the options handled by this module then IoTHubClient_SetOption shall call IoTHubClient_LL_SetOption passing the same parameters and return what IoTHubClient_LL_SetOption returns.] */
-            result = IoTHubClient_LL_SetOption(iotHubClientInstance->IoTHubClientLLHandle, optionName, value);
-            if (result != IOTHUB_CLIENT_OK)
+            if (strcmp(OPTION_DO_WORK_FREQUENCY_IN_MS, optionName) == 0)
+            {
+                /*Codes_SRS_IOTHUBCLIENT_31_007: [ If optionName is OPTION_DO_WORK_FREQUENCY_IN_MS and the value pointed to by value is 0 then IoTHubClient_SetOption shall return IOTHUB_CLIENT_INVALID_ARG. ]*/
+                if (*(const unsigned int*)value == 0)
+                {
+                    result = IOTHUB_CLIENT_INVALID_ARG;
+                    LogError("invalid value for %s (0)", OPTION_DO_WORK_FREQUENCY_IN_MS);
+                }
+                else
+                {
+                    /*Codes_SRS_IOTHUBCLIENT_31_008: [ If optionName is OPTION_DO_WORK_FREQUENCY_IN_MS then IoTHubClient_SetOption shall set the longest time the worker thread waits between 2 calls to IoTHubClient_LL_DoWork and return IOTHUB_CLIENT_OK. ]*/
+                    iotHubClientInstance->do_work_freq_ms = *(const unsigned int*)value;
+                    result = IOTHUB_CLIENT_OK;
+                }
+            }
+            else if (strcmp(OPTION_WORKER_POOL, optionName) == 0)
+            {
+                /*Codes_SRS_IOTHUBCLIENT_31_037: [ If optionName is OPTION_WORKER_POOL and the client shares its transport or its worker thread was already started then IoTHubClient_SetOption shall return IOTHUB_CLIENT_ERROR. ]*/
+                if (iotHubClientInstance->TransportHandle != NULL)
+                {
+                    result = IOTHUB_CLIENT_ERROR;
+                    LogError("%s cannot be set on a client sharing its transport", OPTION_WORKER_POOL);
+                }
+                else if ((iotHubClientInstance->ThreadHandle != NULL) || (iotHubClientInstance->workerPoolItem != NULL))
+                {
+                    result = IOTHUB_CLIENT_ERROR;
+                    LogError("%s has to be set before the worker thread is started", OPTION_WORKER_POOL);
+                }
+                else
+                {
+                    /*Codes_SRS_IOTHUBCLIENT_31_041: [ If optionName is OPTION_WORKER_POOL then IoTHubClient_SetOption shall save value as the worker pool that runs the client instead of a thread of its own and return IOTHUB_CLIENT_OK. ]*/
+                    iotHubClientInstance->workerPool = (IOTHUB_WORKER_POOL_HANDLE)value;
+                    result = IOTHUB_CLIENT_OK;
+                }
+            }
+            else if (strcmp(OPTION_CALLBACK_DISPATCH_THREADS, optionName) == 0)
+            {
+                size_t thread_count = *(const size_t*)value;
+                /*Codes_SRS_IOTHUBCLIENT_31_028: [ If optionName is OPTION_CALLBACK_DISPATCH_THREADS and the value pointed to by value is greater than the number of types of callbacks then IoTHubClient_SetOption shall return IOTHUB_CLIENT_INVALID_ARG. ]*/
+                if (thread_count > USER_CALLBACK_TYPE_COUNT)
+                {
+                    result = IOTHUB_CLIENT_INVALID_ARG;
+                    LogError("invalid value for %s (%zu), at most %d threads can be used", OPTION_CALLBACK_DISPATCH_THREADS, thread_count, USER_CALLBACK_TYPE_COUNT);
+                }
+                /*Codes_SRS_IOTHUBCLIENT_31_029: [ If optionName is OPTION_CALLBACK_DISPATCH_THREADS and the client shares its transport or the dispatcher threads were already created then IoTHubClient_SetOption shall return IOTHUB_CLIENT_ERROR. ]*/
+                else if (iotHubClientInstance->TransportHandle != NULL)
+                {
+                    result = IOTHUB_CLIENT_ERROR;
+                    LogError("%s cannot be set on a client sharing its transport", OPTION_CALLBACK_DISPATCH_THREADS);
+                }
+                else if (iotHubClientInstance->callbackDispatcher != NULL)
+                {
+                    result = IOTHUB_CLIENT_ERROR;
+                    LogError("%s can only be set once", OPTION_CALLBACK_DISPATCH_THREADS);
+                }
+                else if (thread_count == 0)
+                {
+                    /*the callbacks keep running on the worker thread*/
+                    result = IOTHUB_CLIENT_OK;
+                }
+                /*Codes_SRS_IOTHUBCLIENT_31_030: [ Otherwise IoTHubClient_SetOption shall create a callback dispatcher running the number of threads pointed to by value and return IOTHUB_CLIENT_OK. ]*/
+                else if ((iotHubClientInstance->callbackDispatcher = create_callback_dispatcher(iotHubClientInstance, thread_count)) == NULL)
+                {
+                    /*Codes_SRS_IOTHUBCLIENT_31_031: [ If creating the callback dispatcher fails then IoTHubClient_SetOption shall return IOTHUB_CLIENT_ERROR. ]*/
+                    result = IOTHUB_CLIENT_ERROR;
+                    LogError("unable to create the callback dispatcher");
+                }
+                else
+                {
+                    result = IOTHUB_CLIENT_OK;
+                }
+            }
+#ifndef DONT_USE_UPLOADTOBLOB
+            /*Codes_SRS_IOTHUBCLIENT_31_010: [ If optionName is x509certificate, x509privatekey or TrustedCerts and a file upload started by IoTHubClient_UploadToBlobAsync is in progress then IoTHubClient_SetOption shall fail and return IOTHUB_CLIENT_ERROR. ]*/
+            else if (isUploadToBlobOption(optionName) && isUploadInProgress(iotHubClientInstance))
             {
-                LogError("IoTHubClient_LL_SetOption failed");
+                result = IOTHUB_CLIENT_ERROR;
+                LogError("cannot set %s while a file upload is in progress", optionName);
+            }
+#endif
+            else
+            {
+                /*Codes_SRS_IOTHUBCLIENT_02_038: [If optionName doesn't match one of the options handled by this module then IoTHubClient_SetOption shall call IoTHubClient_LL_SetOption passing the same parameters and return what IoTHubClient_LL_SetOption returns.] */
+                result = IoTHubClient_LL_SetOption(iotHubClientInstance->IoTHubClientLLHandle, optionName, value);
+                if (result != IOTHUB_CLIENT_OK)
+                {
+                    LogError("IoTHubClient_LL_SetOption failed");
+                }
             }
 
             (void)Unlock(iotHubClientInstance->LockHandle);
@@ -1497,6 +2354,11 @@ IOTHUB_CLIENT_RESULT IoTHubClient_SendReportedState(IOTHUB_CLIENT_HANDLE iotHubC
                     }
                 }
             }
+
+            if (result == IOTHUB_CLIENT_OK)
+            {
+                signal_worker_thread(iotHubClientInstance);
+            }
             (void)Unlock(iotHubClientInstance->LockHandle);
         }
     }
@@ -1686,6 +2548,10 @@ IOTHUB_CLIENT_RESULT IoTHubClient_DeviceMethodResponse(IOTHUB_CLIENT_HANDLE iotH
             {
                 LogError("IoTHubClient_LL_DeviceMethodResponse failed");
             }
+            else
+            {
+                signal_worker_thread(iotHubClientInstance);
+            }
             (void)Unlock(iotHubClientInstance->LockHandle);
         }
     }
@@ -1696,33 +2562,26 @@ IOTHUB_CLIENT_RESULT IoTHubClient_DeviceMethodResponse(IOTHUB_CLIENT_HANDLE iotH
 static int uploadingThread(void *data)
 {
     UPLOADTOBLOB_SAVED_DATA* savedData = (UPLOADTOBLOB_SAVED_DATA*)data;
+    IOTHUB_CLIENT_FILE_UPLOAD_RESULT upload_result;
 
-    if (Lock(savedData->iotHubClientHandle->LockHandle) == LOCK_OK)
+    /*it so happens that IoTHubClient_LL_UploadToBlob is thread-safe because there's no saved state in the handle and there are no globals, so no need to protect it*/
+    /*not having it protected means multiple simultaneous uploads can happen and that the worker thread keeps running while the upload is in progress*/
+    /*Codes_SRS_IOTHUBCLIENT_02_054: [ The thread shall call IoTHubClient_LL_UploadToBlob passing the information packed in the structure. ]*/
+    /*Codes_SRS_IOTHUBCLIENT_31_009: [ The thread shall not hold the lock created in IoTHubClient_Create while calling IoTHubClient_LL_UploadToBlob. ]*/
+    if (IoTHubClient_LL_UploadToBlob(savedData->iotHubClientHandle->IoTHubClientLLHandle, savedData->destinationFileName, savedData->source, savedData->size) == IOTHUB_CLIENT_OK)
     {
-        IOTHUB_CLIENT_FILE_UPLOAD_RESULT upload_result;
-        /*it so happens that IoTHubClient_LL_UploadToBlob is thread-safe because there's no saved state in the handle and there are no globals, so no need to protect it*/
-        /*not having it protected means multiple simultaneous uploads can happen*/
-        /*Codes_SRS_IOTHUBCLIENT_02_054: [ The thread shall call IoTHubClient_LL_UploadToBlob passing the information packed in the structure. ]*/
-        if (IoTHubClient_LL_UploadToBlob(savedData->iotHubClientHandle->IoTHubClientLLHandle, savedData->destinationFileName, savedData->source, savedData->size) == IOTHUB_CLIENT_OK)
-        {
-            upload_result = FILE_UPLOAD_OK;
-        }
-        else
-        {
-            LogError("unable to IoTHubClient_LL_UploadToBlob");
-            upload_result = FILE_UPLOAD_ERROR;
-        }
-        (void)Unlock(savedData->iotHubClientHandle->LockHandle);
-
-        if (savedData->iotHubClientFileUploadCallback != NULL)
-        {
-            /*Codes_SRS_IOTHUBCLIENT_02_055: [ If IoTHubClient_LL_UploadToBlob fails then the thread shall call iotHubClientFileUploadCallbackInternal passing as result FILE_UPLOAD_ERROR and as context the structure from SRS IOTHUBCLIENT 02 051. ]*/
-            savedData->iotHubClientFileUploadCallback(upload_result, savedData->context);
-        }
+        upload_result = FILE_UPLOAD_OK;
     }
     else
     {
-        LogError("Lock failed");
+        LogError("unable to IoTHubClient_LL_UploadToBlob");
+        upload_result = FILE_UPLOAD_ERROR;
+    }
+
+    if (savedData->iotHubClientFileUploadCallback != NULL)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_02_055: [ If IoTHubClient_LL_UploadToBlob fails then the thread shall call iotHubClientFileUploadCallbackInternal passing as result FILE_UPLOAD_ERROR and as context the structure from SRS IOTHUBCLIENT 02 051. ]*/
+        savedData->iotHubClientFileUploadCallback(upload_result, savedData->context);
     }
 
     /*Codes_SRS_IOTHUBCLIENT_02_071: [ The thread shall mark itself as disposable. ]*/
@@ -0,0 +1,251 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/optimize_size.h"
+#include "azure_c_shared_utility/xlogging.h"
+
+#include "iothub_client_compression.h"
+
+#define DEFLATE_HASH_BITS 12
+#define DEFLATE_HASH_SIZE (1 << DEFLATE_HASH_BITS)
+#define DEFLATE_WINDOW_SIZE 32768
+#define DEFLATE_MIN_MATCH 3
+#define DEFLATE_MAX_MATCH 258
+#define DEFLATE_END_OF_BLOCK 256
+#define ADLER_MODULO 65521
+/*largest number of bytes summed before the sums of adler32 have to be reduced modulo ADLER_MODULO*/
+#define ADLER_BLOCK_SIZE 5552
+
+/*RFC 1951 3.2.5, base lengths and extra bits of the length codes 257 to 285*/
+static const uint16_t LENGTH_BASE[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t LENGTH_EXTRA_BITS[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+/*base distances and extra bits of the distance codes 0 to 29*/
+static const uint16_t DISTANCE_BASE[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t DISTANCE_EXTRA_BITS[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+static const IOTHUB_CLIENT_COMPRESSION_CODEC deflateCodec = { "deflate", IoTHubCompression_Deflate };
+
+typedef struct DEFLATE_OUTPUT_TAG
+{
+    unsigned char* position;
+    unsigned char* end;
+    uint32_t bits;         /*bits not written yet, the first one in the lowest bit*/
+    unsigned int bitCount;
+    bool isFull;           /*set when the output did not fit, nothing more is written*/
+} DEFLATE_OUTPUT;
+
+static void put_bits(DEFLATE_OUTPUT* output, uint32_t value, unsigned int count)
+{
+    output->bits |= value << output->bitCount;
+    output->bitCount += count;
+    while (output->bitCount >= 8)
+    {
+        if (output->position == output->end)
+        {
+            output->isFull = true;
+        }
+        else
+        {
+            *(output->position++) = (unsigned char)output->bits;
+        }
+        output->bits >>= 8;
+        output->bitCount -= 8;
+    }
+}
+
+/*Huffman codes are packed starting with their most significant bit*/
+static void put_code(DEFLATE_OUTPUT* output, uint32_t code, unsigned int length)
+{
+    uint32_t reversed = 0;
+    unsigned int index;
+    for (index = 0; index < length; index++)
+    {
+        reversed = (reversed << 1) | (code & 1);
+        code >>= 1;
+    }
+    put_bits(output, reversed, length);
+}
+
+/*RFC 1951 3.2.6, fixed Huffman codes of the literal/length alphabet*/
+static void put_symbol(DEFLATE_OUTPUT* output, unsigned int symbol)
+{
+    if (symbol < 144)
+    {
+        put_code(output, 0x30 + symbol, 8);
+    }
+    else if (symbol < 256)
+    {
+        put_code(output, 0x190 + (symbol - 144), 9);
+    }
+    else if (symbol < 280)
+    {
+        put_code(output, symbol - 256, 7);
+    }
+    else
+    {
+        put_code(output, 0xC0 + (symbol - 280), 8);
+    }
+}
+
+static void put_match(DEFLATE_OUTPUT* output, size_t length, size_t distance)
+{
+    unsigned int index = (unsigned int)(sizeof(LENGTH_BASE) / sizeof(LENGTH_BASE[0])) - 1;
+    while (LENGTH_BASE[index] > length)
+    {
+        index--;
+    }
+    put_symbol(output, 257 + index);
+    put_bits(output, (uint32_t)(length - LENGTH_BASE[index]), LENGTH_EXTRA_BITS[index]);
+
+    index = (unsigned int)(sizeof(DISTANCE_BASE) / sizeof(DISTANCE_BASE[0])) - 1;
+    while (DISTANCE_BASE[index] > distance)
+    {
+        index--;
+    }
+    /*distance codes are 5 bits long*/
+    put_code(output, index, 5);
+    put_bits(output, (uint32_t)(distance - DISTANCE_BASE[index]), DISTANCE_EXTRA_BITS[index]);
+}
+
+static uint32_t get_hash(const unsigned char* bytes)
+{
+    uint32_t value = ((uint32_t)bytes[0] << 16) | ((uint32_t)bytes[1] << 8) | (uint32_t)bytes[2];
+    return (value * 2654435761u) >> (32 - DEFLATE_HASH_BITS);
+}
+
+static uint32_t get_adler32(const unsigned char* bytes, size_t size)
+{
+    uint32_t a = 1;
+    uint32_t b = 0;
+    while (size > 0)
+    {
+        size_t blockSize = (size < ADLER_BLOCK_SIZE) ? size : ADLER_BLOCK_SIZE;
+        size -= blockSize;
+        while (blockSize-- > 0)
+        {
+            a += *(bytes++);
+            b += a;
+        }
+        a %= ADLER_MODULO;
+        b %= ADLER_MODULO;
+    }
+    return (b << 16) | a;
+}
+
+int IoTHubCompression_Deflate(const unsigned char* source, size_t size, unsigned char* destination, size_t* destinationSize)
+{
+    int result;
+    uint32_t* lastPositions;
+    /*Codes_SRS_IOTHUB_CLIENT_COMPRESSION_31_001: [ If source is NULL while size is not 0, or destination or destinationSize is NULL, IoTHubCompression_Deflate shall fail and return a non-zero value. ]*/
+    if (((source == NULL) && (size != 0)) || (destination == NULL) || (destinationSize == NULL))
+    {
+        LogError("invalid argument const unsigned char* source=%p, unsigned char* destination=%p, size_t* destinationSize=%p", source, destination, destinationSize);
+        result = __FAILURE__;
+    }
+    else if (size >= UINT32_MAX)
+    {
+        LogError("content too large to compress");
+        result = __FAILURE__;
+    }
+    /*Codes_SRS_IOTHUB_CLIENT_COMPRESSION_31_002: [ If allocating memory fails, IoTHubCompression_Deflate shall fail and return a non-zero value. ]*/
+    else if ((lastPositions = (uint32_t*)malloc(DEFLATE_HASH_SIZE * sizeof(uint32_t))) == NULL)
+    {
+        LogError("unable to malloc");
+        result = __FAILURE__;
+    }
+    else
+    {
+        DEFLATE_OUTPUT output;
+        size_t position = 0;
+        uint32_t adler32;
+
+        /*positions are stored plus one, 0 meaning that no position has this hash yet*/
+        (void)memset(lastPositions, 0, DEFLATE_HASH_SIZE * sizeof(uint32_t));
+        output.position = destination;
+        output.end = destination + *destinationSize;
+        output.bits = 0;
+        output.bitCount = 0;
+        output.isFull = false;
+
+        /*Codes_SRS_IOTHUB_CLIENT_COMPRESSION_31_003: [ IoTHubCompression_Deflate shall write to destination a zlib stream (RFC 1950) holding a single deflate block (RFC 1951) of fixed Huffman codes, whose matches are found by looking up the last position of the same 3 bytes in the previous 32KB. ]*/
+        /*CMF: deflate with a 32KB window, FLG: fastest compression, no dictionary*/
+        put_bits(&output, 0x78, 8);
+        put_bits(&output, 0x01, 8);
+        /*BFINAL set, BTYPE 01 (fixed Huffman codes)*/
+        put_bits(&output, 0x03, 3);
+
+        while ((position < size) && !output.isFull)
+        {
+            size_t matchLength = 0;
+            size_t distance = 0;
+            if (size - position >= DEFLATE_MIN_MATCH)
+            {
+                uint32_t hash = get_hash(source + position);
+                uint32_t candidate = lastPositions[hash];
+                lastPositions[hash] = (uint32_t)position + 1;
+                if ((candidate != 0) && ((distance = position - (candidate - 1)) <= DEFLATE_WINDOW_SIZE))
+                {
+                    const unsigned char* match = source + (candidate - 1);
+                    size_t maxLength = ((size - position) < DEFLATE_MAX_MATCH) ? (size - position) : DEFLATE_MAX_MATCH;
+                    while ((matchLength < maxLength) && (match[matchLength] == source[position + matchLength]))
+                    {
+                        matchLength++;
+                    }
+                }
+            }
+
+            if (matchLength >= DEFLATE_MIN_MATCH)
+            {
+                size_t index;
+                put_match(&output, matchLength, distance);
+                /*the positions inside the match are remembered too, so that the next matches can start there*/
+                for (index = 1; (index < matchLength) && (position + index + DEFLATE_MIN_MATCH <= size); index++)
+                {
+                    lastPositions[get_hash(source + position + index)] = (uint32_t)(position + index) + 1;
+                }
+                position += matchLength;
+            }
+            else
+            {
+                put_symbol(&output, source[position]);
+                position++;
+            }
+        }
+
+        put_symbol(&output, DEFLATE_END_OF_BLOCK);
+        if (output.bitCount > 0)
+        {
+            put_bits(&output, 0, 8 - output.bitCount);
+        }
+        adler32 = get_adler32(source, size);
+        put_bits(&output, (adler32 >> 24) & 0xFF, 8);
+        put_bits(&output, (adler32 >> 16) & 0xFF, 8);
+        put_bits(&output, (adler32 >> 8) & 0xFF, 8);
+        put_bits(&output, adler32 & 0xFF, 8);
+
+        if (output.isFull)
+        {
+            /*Codes_SRS_IOTHUB_CLIENT_COMPRESSION_31_004: [ If the compressed content does not fit in *destinationSize bytes, IoTHubCompression_Deflate shall fail and return a non-zero value. ]*/
+            result = __FAILURE__;
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUB_CLIENT_COMPRESSION_31_005: [ Otherwise IoTHubCompression_Deflate shall set *destinationSize to the size of the compressed content and return 0. ]*/
+            *destinationSize = (size_t)(output.position - destination);
+            result = 0;
+        }
+        free(lastPositions);
+    }
+    return result;
+}
+
+const IOTHUB_CLIENT_COMPRESSION_CODEC* IoTHubCompression_DeflateCodec(void)
+{
+    /*Codes_SRS_IOTHUB_CLIENT_COMPRESSION_31_006: [ IoTHubCompression_DeflateCodec shall return a codec compressing with IoTHubCompression_Deflate whose content encoding is "deflate". ]*/
+    return &deflateCodec;
+}
@@ -0,0 +1,189 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/xlogging.h"
+
+#include "iothub_client_congestion_control.h"
+
+/*weight of a new latency in the smoothed latency, as a power of 2 (1/8, like the smoothed round trip time of TCP)*/
+#define SMOOTHED_LATENCY_SHIFT 3
+
+typedef struct CONGESTION_CONTROL_INSTANCE_TAG
+{
+    size_t maxWindow;
+    size_t window;
+    size_t slowStartThreshold;   /*the window grows by 1 per ack below it, by 1 per window of acks above it*/
+    size_t ackedInWindow;        /*acks counted towards the next additive increase*/
+    bool hasLatency;             /*set once the first ack is counted*/
+    tickcounter_ms_t smoothedLatency;
+    tickcounter_ms_t periodStart;
+    tickcounter_ms_t periodBaseLatency;   /*lowest latency of the current period*/
+    tickcounter_ms_t previousBaseLatency; /*lowest latency of the previous period*/
+    bool isRecovering;           /*set after a decrease, until recoveryEnd*/
+    tickcounter_ms_t recoveryEnd;
+} CONGESTION_CONTROL_INSTANCE;
+
+static tickcounter_ms_t get_base_latency(CONGESTION_CONTROL_INSTANCE* congestionControl)
+{
+    return (congestionControl->periodBaseLatency < congestionControl->previousBaseLatency) ? congestionControl->periodBaseLatency : congestionControl->previousBaseLatency;
+}
+
+static void update_latency(CONGESTION_CONTROL_INSTANCE* congestionControl, tickcounter_ms_t latency, tickcounter_ms_t current_ms)
+{
+    if (!congestionControl->hasLatency)
+    {
+        congestionControl->hasLatency = true;
+        congestionControl->smoothedLatency = latency;
+        congestionControl->periodStart = current_ms;
+        congestionControl->periodBaseLatency = latency;
+        congestionControl->previousBaseLatency = latency;
+    }
+    else
+    {
+        congestionControl->smoothedLatency = congestionControl->smoothedLatency - (congestionControl->smoothedLatency >> SMOOTHED_LATENCY_SHIFT) + (latency >> SMOOTHED_LATENCY_SHIFT);
+        if (current_ms - congestionControl->periodStart >= CONGESTION_CONTROL_BASE_LATENCY_PERIOD_MS)
+        {
+            congestionControl->periodStart = current_ms;
+            congestionControl->previousBaseLatency = congestionControl->periodBaseLatency;
+            congestionControl->periodBaseLatency = latency;
+        }
+        else if (latency < congestionControl->periodBaseLatency)
+        {
+            congestionControl->periodBaseLatency = latency;
+        }
+    }
+}
+
+static bool is_recovering(CONGESTION_CONTROL_INSTANCE* congestionControl, tickcounter_ms_t current_ms)
+{
+    if (congestionControl->isRecovering && (current_ms >= congestionControl->recoveryEnd))
+    {
+        congestionControl->isRecovering = false;
+    }
+    return congestionControl->isRecovering;
+}
+
+static void decrease_window(CONGESTION_CONTROL_INSTANCE* congestionControl, tickcounter_ms_t current_ms)
+{
+    /*Codes_SRS_IOTHUB_CLIENT_CONGESTION_CONTROL_31_012: [ After a decrease, the window shall neither decrease nor grow again until the smoothed latency plus CONGESTION_CONTROL_LATENCY_SLACK_MS milliseconds have passed, so that it decreases at most once per round trip. ]*/
+    if (!is_recovering(congestionControl, current_ms))
+    {
+        /*Codes_SRS_IOTHUB_CLIENT_CONGESTION_CONTROL_31_011: [ congestion_control_on_failure shall halve the window, down to 1, and set the slow start threshold to the new window. ]*/
+        congestionControl->window = (congestionControl->window > 1) ? (congestionControl->window / 2) : 1;
+        congestionControl->slowStartThreshold = congestionControl->window;
+        congestionControl->ackedInWindow = 0;
+        congestionControl->isRecovering = true;
+        congestionControl->recoveryEnd = current_ms + congestionControl->smoothedLatency + CONGESTION_CONTROL_LATENCY_SLACK_MS;
+    }
+}
+
+static void increase_window(CONGESTION_CONTROL_INSTANCE* congestionControl)
+{
+    if (congestionControl->window < congestionControl->slowStartThreshold)
+    {
+        /*Codes_SRS_IOTHUB_CLIENT_CONGESTION_CONTROL_31_008: [ While the window is below the slow start threshold, congestion_control_on_ack shall grow it by 1. ]*/
+        congestionControl->window++;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUB_CLIENT_CONGESTION_CONTROL_31_009: [ Otherwise congestion_control_on_ack shall grow the window by 1 once as many acks as the window were counted since it last changed. ]*/
+        congestionControl->ackedInWindow++;
+        if (congestionControl->ackedInWindow >= congestionControl->window)
+        {
+            congestionControl->ackedInWindow = 0;
+            congestionControl->window++;
+        }
+    }
+
+    /*Codes_SRS_IOTHUB_CLIENT_CONGESTION_CONTROL_31_010: [ The window shall never grow above max_window. ]*/
+    if (congestionControl->window > congestionControl->maxWindow)
+    {
+        congestionControl->window = congestionControl->maxWindow;
+    }
+}
+
+CONGESTION_CONTROL_HANDLE congestion_control_create(size_t max_window)
+{
+    CONGESTION_CONTROL_INSTANCE* result;
+    /*Codes_SRS_IOTHUB_CLIENT_CONGESTION_CONTROL_31_001: [ If max_window is 0, congestion_control_create shall return NULL. ]*/
+    if (max_window == 0)
+    {
+        LogError("invalid argument size_t max_window=0");
+        result = NULL;
+    }
+    else if ((result = (CONGESTION_CONTROL_INSTANCE*)malloc(sizeof(CONGESTION_CONTROL_INSTANCE))) == NULL)
+    {
+        /*Codes_SRS_IOTHUB_CLIENT_CONGESTION_CONTROL_31_002: [ If allocating memory fails, congestion_control_create shall return NULL. ]*/
+        LogError("unable to malloc");
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUB_CLIENT_CONGESTION_CONTROL_31_003: [ congestion_control_create shall return a controller whose window is 1 and whose slow start threshold is max_window. ]*/
+        result->maxWindow = max_window;
+        result->window = 1;
+        result->slowStartThreshold = max_window;
+        result->ackedInWindow = 0;
+        result->hasLatency = false;
+        result->smoothedLatency = 0;
+        result->periodStart = 0;
+        result->periodBaseLatency = 0;
+        result->previousBaseLatency = 0;
+        result->isRecovering = false;
+        result->recoveryEnd = 0;
+    }
+    return result;
+}
+
+void congestion_control_destroy(CONGESTION_CONTROL_HANDLE handle)
+{
+    /*Codes_SRS_IOTHUB_CLIENT_CONGESTION_CONTROL_31_004: [ If handle is NULL, congestion_control_destroy shall do nothing, otherwise it shall free the controller. ]*/
+    if (handle != NULL)
+    {
+        free(handle);
+    }
+}
+
+void congestion_control_on_ack(CONGESTION_CONTROL_HANDLE handle, tickcounter_ms_t latency, tickcounter_ms_t current_ms)
+{
+    /*Codes_SRS_IOTHUB_CLIENT_CONGESTION_CONTROL_31_005: [ If handle is NULL, congestion_control_on_ack and congestion_control_on_failure shall do nothing. ]*/
+    if (handle == NULL)
+    {
+        LogError("invalid argument CONGESTION_CONTROL_HANDLE handle=NULL");
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUB_CLIENT_CONGESTION_CONTROL_31_006: [ The base latency shall be the lowest latency given to congestion_control_on_ack in the current and the previous period of CONGESTION_CONTROL_BASE_LATENCY_PERIOD_MS milliseconds. ]*/
+        update_latency(handle, latency, current_ms);
+        if (latency > (get_base_latency(handle) * CONGESTION_CONTROL_LATENCY_FACTOR) + CONGESTION_CONTROL_LATENCY_SLACK_MS)
+        {
+            /*Codes_SRS_IOTHUB_CLIENT_CONGESTION_CONTROL_31_007: [ If latency is above CONGESTION_CONTROL_LATENCY_FACTOR times the base latency plus CONGESTION_CONTROL_LATENCY_SLACK_MS, congestion_control_on_ack shall decrease the window like congestion_control_on_failure. ]*/
+            decrease_window(handle, current_ms);
+        }
+        else if (!is_recovering(handle, current_ms))
+        {
+            increase_window(handle);
+        }
+    }
+}
+
+void congestion_control_on_failure(CONGESTION_CONTROL_HANDLE handle, tickcounter_ms_t current_ms)
+{
+    /*Codes_SRS_IOTHUB_CLIENT_CONGESTION_CONTROL_31_005: [ If handle is NULL, congestion_control_on_ack and congestion_control_on_failure shall do nothing. ]*/
+    if (handle == NULL)
+    {
+        LogError("invalid argument CONGESTION_CONTROL_HANDLE handle=NULL");
+    }
+    else
+    {
+        decrease_window(handle, current_ms);
+    }
+}
+
+size_t congestion_control_get_window(CONGESTION_CONTROL_HANDLE handle)
+{
+    /*Codes_SRS_IOTHUB_CLIENT_CONGESTION_CONTROL_31_013: [ congestion_control_get_window shall return the window, or 0 if handle is NULL. ]*/
+    return (handle == NULL) ? 0 : handle->window;
+}
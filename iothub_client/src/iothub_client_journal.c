@@ -0,0 +1,657 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(_POSIX_C_SOURCE)
+/*fileno, fsync and opendir*/
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/optimize_size.h"
+#include "azure_c_shared_utility/xlogging.h"
+
+#include "iothub_client_journal.h"
+
+#if defined(_WIN32)
+#include <io.h>
+#include <windows.h>
+#define SYNC_FILE(file) _commit(_fileno(file))
+#elif defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#include <dirent.h>
+#define SYNC_FILE(file) fsync(fileno(file))
+#else
+/*no portable way to reach the storage below the stdio buffer, fflush is as far as it goes*/
+#define SYNC_FILE(file) 0
+#endif
+
+#define JOURNAL_HEAD_FILE_NAME          "journal.head"
+#define JOURNAL_HEAD_TEMP_FILE_NAME     "journal.head.tmp"
+#define JOURNAL_SEGMENT_FILE_NAME       "journal_%lu.seg"
+#define JOURNAL_MAX_FILE_NAME_LENGTH    40
+#define JOURNAL_WRITE_BUFFER_SIZE       (64 * 1024)
+
+/*a segment starts with a magic and the sequence of its first record, a record is its length, its checksum and its bytes, integers are little endian*/
+static const unsigned char JOURNAL_SEGMENT_MAGIC[4] = { 'I', 'H', 'J', '1' };
+#define JOURNAL_SEGMENT_HEADER_SIZE     12
+#define JOURNAL_RECORD_HEADER_SIZE      8
+
+typedef struct JOURNAL_SEGMENT_TAG
+{
+    unsigned long number;
+    uint64_t firstSequence;
+    size_t recordCount;
+    size_t confirmedCount;
+    struct JOURNAL_SEGMENT_TAG* next;
+} JOURNAL_SEGMENT;
+
+typedef struct JOURNAL_INSTANCE_TAG
+{
+    char* path;                 /*directory followed by room for a file name, the file name is rewritten for every file opened*/
+    char* headTempPath;         /*the head file is written there before it is renamed over the head, in the same allocation as path*/
+    size_t directoryLength;
+    size_t segmentSize;
+    JOURNAL_SEGMENT* oldest;
+    JOURNAL_SEGMENT* newest;    /*the segment records are appended to*/
+    FILE* newestFile;           /*NULL after a write error, the next append starts a new segment*/
+    size_t newestFileSize;
+    uint64_t nextSequence;
+    bool hasUncommittedRecords;
+} JOURNAL_INSTANCE;
+
+static void put_uint32(unsigned char* destination, uint32_t value)
+{
+    destination[0] = (unsigned char)(value & 0xFF);
+    destination[1] = (unsigned char)((value >> 8) & 0xFF);
+    destination[2] = (unsigned char)((value >> 16) & 0xFF);
+    destination[3] = (unsigned char)((value >> 24) & 0xFF);
+}
+
+static uint32_t get_uint32(const unsigned char* source)
+{
+    return (uint32_t)source[0] | ((uint32_t)source[1] << 8) | ((uint32_t)source[2] << 16) | ((uint32_t)source[3] << 24);
+}
+
+static void put_uint64(unsigned char* destination, uint64_t value)
+{
+    put_uint32(destination, (uint32_t)(value & 0xFFFFFFFF));
+    put_uint32(destination + 4, (uint32_t)(value >> 32));
+}
+
+static uint64_t get_uint64(const unsigned char* source)
+{
+    return (uint64_t)get_uint32(source) | ((uint64_t)get_uint32(source + 4) << 32);
+}
+
+/*FNV-1a, enough to tell a record torn by a crash from a complete one*/
+static uint32_t get_checksum(const unsigned char* bytes, size_t size)
+{
+    uint32_t result = 2166136261U;
+    size_t index;
+    for (index = 0; index < size; index++)
+    {
+        result ^= bytes[index];
+        result *= 16777619U;
+    }
+    return result;
+}
+
+static const char* get_head_path(JOURNAL_INSTANCE* journal)
+{
+    (void)strcpy(journal->path + journal->directoryLength, JOURNAL_HEAD_FILE_NAME);
+    return journal->path;
+}
+
+static const char* get_segment_path(JOURNAL_INSTANCE* journal, unsigned long number)
+{
+    (void)sprintf(journal->path + journal->directoryLength, JOURNAL_SEGMENT_FILE_NAME, number);
+    return journal->path;
+}
+
+static void check_segment_name(const char* name, unsigned long* oldest, bool* found)
+{
+    unsigned long number;
+    int length = 0;
+    if ((sscanf(name, JOURNAL_SEGMENT_FILE_NAME "%n", &number, &length) == 1) &&
+        (name[length] == '\0') &&
+        (!*found || (number < *oldest)))
+    {
+        *oldest = number;
+        *found = true;
+    }
+}
+
+/*returns 0 and the lowest number of the segment files of the directory, if the platform can list it and there is one*/
+static int find_oldest_segment(JOURNAL_INSTANCE* journal, unsigned long* oldest)
+{
+    bool found = false;
+#if defined(_WIN32)
+    WIN32_FIND_DATAA findData;
+    HANDLE find;
+    (void)strcpy(journal->path + journal->directoryLength, "journal_*.seg");
+    if ((find = FindFirstFileA(journal->path, &findData)) != INVALID_HANDLE_VALUE)
+    {
+        do
+        {
+            check_segment_name(findData.cFileName, oldest, &found);
+        } while (FindNextFileA(find, &findData));
+        (void)FindClose(find);
+    }
+#elif defined(__unix__) || defined(__APPLE__)
+    DIR* directory;
+    journal->path[journal->directoryLength] = '\0';
+    if ((directory = opendir((journal->directoryLength == 0) ? "." : journal->path)) != NULL)
+    {
+        struct dirent* entry;
+        while ((entry = readdir(directory)) != NULL)
+        {
+            check_segment_name(entry->d_name, oldest, &found);
+        }
+        (void)closedir(directory);
+    }
+#else
+    (void)journal;
+    (void)oldest;
+#endif
+    return found ? 0 : __FAILURE__;
+}
+
+static unsigned long read_head(JOURNAL_INSTANCE* journal)
+{
+    unsigned long result;
+    FILE* file = fopen(get_head_path(journal), "r");
+    bool isRead = false;
+    if (file != NULL)
+    {
+        isRead = (fscanf(file, "%lu", &result) == 1);
+        if (!isRead)
+        {
+            LogError("unable to read %s, looking for the oldest segment", journal->path);
+        }
+        (void)fclose(file);
+    }
+
+    /*Codes_SRS_IOTHUB_CLIENT_JOURNAL_31_024: [ If the head file is missing or cannot be read, journal_create shall start from the segment file of directory with the lowest number, or from segment 0 if there is none. ]*/
+    if (!isRead && (find_oldest_segment(journal, &result) != 0))
+    {
+        result = 0;
+    }
+    return result;
+}
+
+/*Codes_SRS_IOTHUB_CLIENT_JOURNAL_31_025: [ The head file shall be replaced by writing and synchronizing a temporary file and renaming it over the head file, so that a crash leaves either the previous or the new head. ]*/
+static int write_head(JOURNAL_INSTANCE* journal, unsigned long number)
+{
+    int result;
+    FILE* file = fopen(journal->headTempPath, "w");
+    if (file == NULL)
+    {
+        LogError("unable to open %s", journal->headTempPath);
+        result = __FAILURE__;
+    }
+    else
+    {
+        if ((fprintf(file, "%lu\n", number) < 0) ||
+            (fflush(file) != 0) ||
+            (SYNC_FILE(file) != 0))
+        {
+            LogError("unable to write %s", journal->headTempPath);
+            (void)fclose(file);
+            result = __FAILURE__;
+        }
+        else
+        {
+            (void)fclose(file);
+#if defined(_WIN32)
+            /*rename does not replace an existing file on Windows, a crash in between leaves no head and journal_create looks for the oldest segment*/
+            (void)remove(get_head_path(journal));
+#endif
+            if (rename(journal->headTempPath, get_head_path(journal)) != 0)
+            {
+                LogError("unable to rename %s to %s", journal->headTempPath, journal->path);
+                result = __FAILURE__;
+            }
+            else
+            {
+                result = 0;
+            }
+        }
+    }
+    return result;
+}
+
+static JOURNAL_SEGMENT* add_segment(JOURNAL_INSTANCE* journal, unsigned long number, uint64_t firstSequence)
+{
+    JOURNAL_SEGMENT* result;
+    if ((result = (JOURNAL_SEGMENT*)malloc(sizeof(JOURNAL_SEGMENT))) == NULL)
+    {
+        LogError("unable to malloc");
+    }
+    else
+    {
+        result->number = number;
+        result->firstSequence = firstSequence;
+        result->recordCount = 0;
+        result->confirmedCount = 0;
+        result->next = NULL;
+        if (journal->newest == NULL)
+        {
+            journal->oldest = result;
+        }
+        else
+        {
+            journal->newest->next = result;
+        }
+        journal->newest = result;
+    }
+    return result;
+}
+
+static int replay_segment(JOURNAL_INSTANCE* journal, FILE* file, unsigned long number, JOURNAL_REPLAY_CALLBACK replay_callback, void* replay_context)
+{
+    int result;
+    unsigned char header[JOURNAL_SEGMENT_HEADER_SIZE];
+    JOURNAL_SEGMENT* segment;
+
+    if ((fread(header, 1, JOURNAL_SEGMENT_HEADER_SIZE, file) != JOURNAL_SEGMENT_HEADER_SIZE) ||
+        (memcmp(header, JOURNAL_SEGMENT_MAGIC, sizeof(JOURNAL_SEGMENT_MAGIC)) != 0))
+    {
+        /*a crash right after the segment was created, it holds no record*/
+        LogError("segment %lu has no valid header, ignoring it", number);
+        result = (add_segment(journal, number, journal->nextSequence) == NULL) ? __FAILURE__ : 0;
+    }
+    else if ((segment = add_segment(journal, number, get_uint64(header + sizeof(JOURNAL_SEGMENT_MAGIC)))) == NULL)
+    {
+        result = __FAILURE__;
+    }
+    else
+    {
+        unsigned char recordHeader[JOURNAL_RECORD_HEADER_SIZE];
+        result = 0;
+        /*Codes_SRS_IOTHUB_CLIENT_JOURNAL_31_005: [ Replaying a segment shall stop at the first record that is truncated or whose checksum does not match its bytes. ]*/
+        while (fread(recordHeader, 1, JOURNAL_RECORD_HEADER_SIZE, file) == JOURNAL_RECORD_HEADER_SIZE)
+        {
+            size_t size = get_uint32(recordHeader);
+            unsigned char* record;
+            if ((size == 0) || (size > journal->segmentSize))
+            {
+                LogError("segment %lu has a torn record after %lu records", number, (unsigned long)segment->recordCount);
+                break;
+            }
+            else if ((record = (unsigned char*)malloc(size)) == NULL)
+            {
+                LogError("unable to malloc");
+                result = __FAILURE__;
+                break;
+            }
+            else
+            {
+                if ((fread(record, 1, size, file) != size) ||
+                    (get_checksum(record, size) != get_uint32(recordHeader + 4)))
+                {
+                    LogError("segment %lu has a torn record after %lu records", number, (unsigned long)segment->recordCount);
+                    free(record);
+                    break;
+                }
+                else
+                {
+                    /*Codes_SRS_IOTHUB_CLIENT_JOURNAL_31_004: [ journal_create shall read the segments from the oldest one to the first one missing and call replay_callback, if not NULL, with every record they hold, its size and its sequence, in the order they were appended. ]*/
+                    uint64_t sequence = segment->firstSequence + segment->recordCount;
+                    segment->recordCount++;
+                    if ((replay_callback != NULL) &&
+                        (replay_callback(record, size, sequence, replay_context) != 0))
+                    {
+                        /*Codes_SRS_IOTHUB_CLIENT_JOURNAL_31_006: [ If replay_callback returns a non-zero value, the record shall be confirmed. ]*/
+                        segment->confirmedCount++;
+                    }
+                    free(record);
+                }
+            }
+        }
+
+        if (journal->nextSequence < segment->firstSequence + segment->recordCount)
+        {
+            journal->nextSequence = segment->firstSequence + segment->recordCount;
+        }
+    }
+    return result;
+}
+
+static int open_newest_segment(JOURNAL_INSTANCE* journal, unsigned long number)
+{
+    int result;
+    FILE* file = fopen(get_segment_path(journal, number), "wb");
+    if (file == NULL)
+    {
+        LogError("unable to open %s", journal->path);
+        result = __FAILURE__;
+    }
+    else
+    {
+        unsigned char header[JOURNAL_SEGMENT_HEADER_SIZE];
+        (void)memcpy(header, JOURNAL_SEGMENT_MAGIC, sizeof(JOURNAL_SEGMENT_MAGIC));
+        put_uint64(header + sizeof(JOURNAL_SEGMENT_MAGIC), journal->nextSequence);
+        (void)setvbuf(file, NULL, _IOFBF, JOURNAL_WRITE_BUFFER_SIZE);
+
+        if (fwrite(header, 1, JOURNAL_SEGMENT_HEADER_SIZE, file) != JOURNAL_SEGMENT_HEADER_SIZE)
+        {
+            LogError("unable to write the header of %s", journal->path);
+            (void)fclose(file);
+            (void)remove(journal->path);
+            result = __FAILURE__;
+        }
+        else if (add_segment(journal, number, journal->nextSequence) == NULL)
+        {
+            (void)fclose(file);
+            (void)remove(get_segment_path(journal, number));
+            result = __FAILURE__;
+        }
+        else
+        {
+            journal->newestFile = file;
+            journal->newestFileSize = JOURNAL_SEGMENT_HEADER_SIZE;
+            result = 0;
+        }
+    }
+    return result;
+}
+
+static int commit_newest_segment(JOURNAL_INSTANCE* journal)
+{
+    int result;
+    if ((journal->newestFile != NULL) && journal->hasUncommittedRecords)
+    {
+        if ((fflush(journal->newestFile) != 0) ||
+            (SYNC_FILE(journal->newestFile) != 0))
+        {
+            LogError("unable to commit segment %lu", journal->newest->number);
+            result = __FAILURE__;
+        }
+        else
+        {
+            journal->hasUncommittedRecords = false;
+            result = 0;
+        }
+    }
+    else
+    {
+        result = 0;
+    }
+    return result;
+}
+
+static void close_newest_segment(JOURNAL_INSTANCE* journal)
+{
+    if (journal->newestFile != NULL)
+    {
+        (void)commit_newest_segment(journal);
+        (void)fclose(journal->newestFile);
+        journal->newestFile = NULL;
+    }
+}
+
+/*segments are only ever deleted from the oldest one, the head file is moved past a segment before the segment is deleted so that a crash in between leaves at most a stale file behind*/
+static void delete_confirmed_segments(JOURNAL_INSTANCE* journal)
+{
+    while ((journal->oldest != journal->newest) &&
+        (journal->oldest->confirmedCount >= journal->oldest->recordCount))
+    {
+        JOURNAL_SEGMENT* segment = journal->oldest;
+        if (write_head(journal, segment->next->number) != 0)
+        {
+            LogError("unable to move the head of the journal past segment %lu, it will be replayed again", segment->number);
+            break;
+        }
+        else
+        {
+            if (remove(get_segment_path(journal, segment->number)) != 0)
+            {
+                LogError("unable to delete %s", journal->path);
+            }
+            journal->oldest = segment->next;
+            free(segment);
+        }
+    }
+}
+
+static void free_segments(JOURNAL_INSTANCE* journal)
+{
+    while (journal->oldest != NULL)
+    {
+        JOURNAL_SEGMENT* segment = journal->oldest;
+        journal->oldest = segment->next;
+        free(segment);
+    }
+    journal->newest = NULL;
+}
+
+JOURNAL_HANDLE journal_create(const char* directory, size_t segment_size, JOURNAL_REPLAY_CALLBACK replay_callback, void* replay_context)
+{
+    JOURNAL_INSTANCE* result;
+    /*Codes_SRS_IOTHUB_CLIENT_JOURNAL_31_001: [ If directory is NULL or segment_size cannot hold the header of a segment and a record of one byte, journal_create shall fail and return NULL. ]*/
+    if ((directory == NULL) || (segment_size <= JOURNAL_SEGMENT_HEADER_SIZE + JOURNAL_RECORD_HEADER_SIZE) || (segment_size > UINT32_MAX))
+    {
+        LogError("invalid argument const char* directory=%p, size_t segment_size=%lu", directory, (unsigned long)segment_size);
+        result = NULL;
+    }
+    else if ((result = (JOURNAL_INSTANCE*)malloc(sizeof(JOURNAL_INSTANCE))) == NULL)
+    {
+        /*Codes_SRS_IOTHUB_CLIENT_JOURNAL_31_002: [ If allocating memory fails, journal_create shall fail and return NULL. ]*/
+        LogError("unable to malloc");
+    }
+    else
+    {
+        size_t directoryLength = strlen(directory);
+        /*path and headTempPath*/
+        if ((result->path = (char*)malloc(2 * (directoryLength + 1 + JOURNAL_MAX_FILE_NAME_LENGTH))) == NULL)
+        {
+            /*Codes_SRS_IOTHUB_CLIENT_JOURNAL_31_002: [ If allocating memory fails, journal_create shall fail and return NULL. ]*/
+            LogError("unable to malloc");
+            free(result);
+            result = NULL;
+        }
+        else
+        {
+            unsigned long number;
+            FILE* file;
+            int replayResult = 0;
+
+            (void)memcpy(result->path, directory, directoryLength);
+            if ((directoryLength > 0) && (directory[directoryLength - 1] != '/') && (directory[directoryLength - 1] != '\\'))
+            {
+                result->path[directoryLength++] = '/';
+            }
+            result->directoryLength = directoryLength;
+            result->headTempPath = result->path + directoryLength + JOURNAL_MAX_FILE_NAME_LENGTH + 1;
+            (void)memcpy(result->headTempPath, result->path, directoryLength);
+            (void)strcpy(result->headTempPath + directoryLength, JOURNAL_HEAD_TEMP_FILE_NAME);
+            result->segmentSize = segment_size;
+            result->oldest = NULL;
+            result->newest = NULL;
+            result->newestFile = NULL;
+            result->newestFileSize = 0;
+            result->nextSequence = 1;
+            result->hasUncommittedRecords = false;
+
+            /*Codes_SRS_IOTHUB_CLIENT_JOURNAL_31_003: [ journal_create shall read the number of the oldest segment from the head file of directory, or start from segment 0 if there is no head file. ]*/
+            number = read_head(result);
+            if (number > 0)
+            {
+                /*left behind by a crash between moving the head and deleting the segment*/
+                (void)remove(get_segment_path(result, number - 1));
+            }
+
+            while ((replayResult == 0) &&
+                ((file = fopen(get_segment_path(result, number), "rb")) != NULL))
+            {
+                replayResult = replay_segment(result, file, number, replay_callback, replay_context);
+                (void)fclose(file);
+                number++;
+            }
+
+            /*Codes_SRS_IOTHUB_CLIENT_JOURNAL_31_007: [ journal_create shall start a new segment after the last one replayed, whose first record has the sequence following the last replayed record, or 1 for an empty journal, and return the handle of the journal. ]*/
+            if ((replayResult != 0) ||
+                (open_newest_segment(result, number) != 0) ||
+                ((result->oldest == result->newest) && (write_head(result, number) != 0)))
+            {
+                /*Codes_SRS_IOTHUB_CLIENT_JOURNAL_31_008: [ If replaying the segments or starting the new segment fails, journal_create shall fail and return NULL. ]*/
+                LogError("unable to open the journal in %s", directory);
+                close_newest_segment(result);
+                free_segments(result);
+                free(result->path);
+                free(result);
+                result = NULL;
+            }
+            else
+            {
+                delete_confirmed_segments(result);
+            }
+        }
+    }
+    return result;
+}
+
+void journal_destroy(JOURNAL_HANDLE handle)
+{
+    /*Codes_SRS_IOTHUB_CLIENT_JOURNAL_31_009: [ If handle is NULL, journal_destroy shall do nothing. ]*/
+    if (handle != NULL)
+    {
+        /*Codes_SRS_IOTHUB_CLIENT_JOURNAL_31_010: [ journal_destroy shall commit the records appended since the last commit, close the newest segment and free the journal. The segment files are left in the directory. ]*/
+        close_newest_segment(handle);
+        free_segments(handle);
+        free(handle->path);
+        free(handle);
+    }
+}
+
+int journal_append(JOURNAL_HANDLE handle, const unsigned char* record, size_t size, uint64_t* sequence)
+{
+    int result;
+    /*Codes_SRS_IOTHUB_CLIENT_JOURNAL_31_011: [ If handle, record or sequence is NULL, or size is 0, journal_append shall fail and return a non-zero value. ]*/
+    if ((handle == NULL) || (record == NULL) || (size == 0) || (sequence == NULL))
+    {
+        LogError("invalid argument JOURNAL_HANDLE handle=%p, const unsigned char* record=%p, size_t size=%lu, uint64_t* sequence=%p", handle, record, (unsigned long)size, sequence);
+        result = __FAILURE__;
+    }
+    /*Codes_SRS_IOTHUB_CLIENT_JOURNAL_31_012: [ If size does not fit in a segment, journal_append shall fail and return a non-zero value. ]*/
+    else if (size > handle->segmentSize - JOURNAL_SEGMENT_HEADER_SIZE - JOURNAL_RECORD_HEADER_SIZE)
+    {
+        LogError("a record of %lu bytes does not fit in a segment of %lu bytes", (unsigned long)size, (unsigned long)handle->segmentSize);
+        result = __FAILURE__;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUB_CLIENT_JOURNAL_31_013: [ If the record does not fit in the rest of the newest segment, or writing the newest segment failed before, journal_append shall commit and close the newest segment and start a new one. ]*/
+        if ((handle->newestFile == NULL) ||
+            (handle->newestFileSize + JOURNAL_RECORD_HEADER_SIZE + size > handle->segmentSize))
+        {
+            unsigned long number = handle->newest->number + 1;
+            close_newest_segment(handle);
+            if (open_newest_segment(handle, number) != 0)
+            {
+                LogError("unable to start segment %lu", number);
+            }
+            else
+            {
+                delete_confirmed_segments(handle);
+            }
+        }
+
+        if (handle->newestFile == NULL)
+        {
+            /*Codes_SRS_IOTHUB_CLIENT_JOURNAL_31_015: [ If writing the record fails, journal_append shall fail and return a non-zero value. ]*/
+            result = __FAILURE__;
+        }
+        else
+        {
+            unsigned char recordHeader[JOURNAL_RECORD_HEADER_SIZE];
+            put_uint32(recordHeader, (uint32_t)size);
+            put_uint32(recordHeader + 4, get_checksum(record, size));
+
+            /*Codes_SRS_IOTHUB_CLIENT_JOURNAL_31_014: [ journal_append shall write the size, the checksum and the bytes of the record to the stdio buffer of the newest segment, set sequence to the sequence of the record and return 0. ]*/
+            if ((fwrite(recordHeader, 1, JOURNAL_RECORD_HEADER_SIZE, handle->newestFile) != JOURNAL_RECORD_HEADER_SIZE) ||
+                (fwrite(record, 1, size, handle->newestFile) != size))
+            {
+                /*Codes_SRS_IOTHUB_CLIENT_JOURNAL_31_015: [ If writing the record fails, journal_append shall fail and return a non-zero value. ]*/
+                /*the segment may end with part of the record, nothing more can be appended after it*/
+                LogError("unable to write to segment %lu", handle->newest->number);
+                (void)fclose(handle->newestFile);
+                handle->newestFile = NULL;
+                result = __FAILURE__;
+            }
+            else
+            {
+                handle->newestFileSize += JOURNAL_RECORD_HEADER_SIZE + size;
+                handle->newest->recordCount++;
+                handle->hasUncommittedRecords = true;
+                *sequence = handle->nextSequence++;
+                result = 0;
+            }
+        }
+    }
+    return result;
+}
+
+int journal_commit(JOURNAL_HANDLE handle)
+{
+    int result;
+    /*Codes_SRS_IOTHUB_CLIENT_JOURNAL_31_016: [ If handle is NULL, journal_commit shall fail and return a non-zero value. ]*/
+    if (handle == NULL)
+    {
+        LogError("invalid argument JOURNAL_HANDLE handle=%p", handle);
+        result = __FAILURE__;
+    }
+    /*Codes_SRS_IOTHUB_CLIENT_JOURNAL_31_017: [ If records were appended since the last commit, journal_commit shall flush the stdio buffer of the newest segment and synchronize the file with the storage, so that all those records are made durable by one write. ]*/
+    else if (commit_newest_segment(handle) != 0)
+    {
+        /*Codes_SRS_IOTHUB_CLIENT_JOURNAL_31_018: [ If flushing or synchronizing fails, journal_commit shall fail and return a non-zero value. ]*/
+        result = __FAILURE__;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUB_CLIENT_JOURNAL_31_019: [ Otherwise journal_commit shall return 0. ]*/
+        result = 0;
+    }
+    return result;
+}
+
+int journal_confirm(JOURNAL_HANDLE handle, uint64_t sequence)
+{
+    int result;
+    /*Codes_SRS_IOTHUB_CLIENT_JOURNAL_31_020: [ If handle is NULL, journal_confirm shall fail and return a non-zero value. ]*/
+    if (handle == NULL)
+    {
+        LogError("invalid argument JOURNAL_HANDLE handle=%p", handle);
+        result = __FAILURE__;
+    }
+    else
+    {
+        JOURNAL_SEGMENT* segment = handle->oldest;
+        while ((segment != NULL) &&
+            ((sequence < segment->firstSequence) || (sequence - segment->firstSequence >= segment->recordCount)))
+        {
+            segment = segment->next;
+        }
+
+        if (segment == NULL)
+        {
+            /*Codes_SRS_IOTHUB_CLIENT_JOURNAL_31_021: [ If sequence is not the sequence of a record of the journal, journal_confirm shall fail and return a non-zero value. ]*/
+            LogError("record %llu is not in the journal", (unsigned long long)sequence);
+            result = __FAILURE__;
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUB_CLIENT_JOURNAL_31_022: [ journal_confirm shall count the record as confirmed in its segment and return 0. ]*/
+            segment->confirmedCount++;
+
+            /*Codes_SRS_IOTHUB_CLIENT_JOURNAL_31_023: [ While all the records of the oldest segment are confirmed and it is not the newest segment, journal_confirm shall write the number of the next segment to the head file and delete the oldest segment. ]*/
+            delete_confirmed_segments(handle);
+            result = 0;
+        }
+    }
+    return result;
+}
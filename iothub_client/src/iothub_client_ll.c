@@ -18,14 +18,30 @@
 #include "iothub_client_private.h"
 #include "iothub_client_options.h"
 #include "iothub_client_version.h"
+#include "iothub_client_object_pool.h"
+#include "iothub_client_compression.h"
+#include "iothub_client_congestion_control.h"
 #include <stdint.h>
 
 #ifndef DONT_USE_UPLOADTOBLOB
 #include "iothub_client_ll_uploadtoblob.h"
 #endif
 
+#ifndef DONT_USE_JOURNAL
+#include "iothub_client_journal.h"
+
+/*version of the layout of the messages appended to the journal, the records of version 1 have no expiry time*/
+#define JOURNAL_RECORD_VERSION 2
+#define JOURNAL_RECORD_VERSION_1 1
+#define JOURNAL_RECORD_VERSION_1_HEADER_SIZE 3
+#define JOURNAL_RECORD_HEADER_SIZE (JOURNAL_RECORD_VERSION_1_HEADER_SIZE + sizeof(uint64_t))
+#endif
+
 #define LOG_ERROR_RESULT LogError("result = %s", ENUM_TO_STRING(IOTHUB_CLIENT_RESULT, result));
 #define INDEFINITE_TIME ((time_t)(-1))
+#define PENDING_ITEM_RETRY_MS 1000
+#define UNKNOWN_TICK ((tickcounter_ms_t)-1)
+#define UNLIMITED_ROOM ((size_t)-1)
 
 DEFINE_ENUM_STRINGS(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_RESULT_VALUES);
 DEFINE_ENUM_STRINGS(IOTHUB_CLIENT_CONFIRMATION_RESULT, IOTHUB_CLIENT_CONFIRMATION_RESULT_VALUES);
@@ -58,6 +74,7 @@ typedef struct IOTHUB_CLIENT_LL_HANDLE_DATA_TAG
 {
     DLIST_ENTRY waitingToSend;
     DLIST_ENTRY iot_msg_queue;
+    bool is_msg_queue_updated; /*set when items were added to iot_msg_queue after the last _DoWork*/
     DLIST_ENTRY iot_ack_queue;
     TRANSPORT_LL_HANDLE transportHandle;
     bool isSharedTransport;
@@ -67,8 +84,12 @@ typedef struct IOTHUB_CLIENT_LL_HANDLE_DATA_TAG
     IOTHUB_METHOD_CALLBACK_DATA methodCallback;
     IOTHUB_CLIENT_CONNECTION_STATUS_CALLBACK conStatusCallback;
     void* conStatusUserContextCallback;
+    IOTHUB_CLIENT_CONNECTION_STATUS connectionStatus; /*last status reported by the transport*/
+    IOTHUB_CLIENT_CONNECTION_STATUS_CALLBACK connectCallback; /*set by IoTHubClient_LL_Connect until the next status is reported*/
+    void* connectUserContextCallback;
     time_t lastMessageReceiveTime;
     TICK_COUNTER_HANDLE tickCounter; /*shared tickcounter used to track message timeouts in waitingToSend list*/
+    TIMEOUT_QUEUE_HANDLE messageTimeouts; /*messages in waitingToSend that have a timeout, ordered by ms_timesOutAfter*/
     tickcounter_ms_t currentMessageTimeout;
     uint64_t current_device_twin_timeout;
     IOTHUB_CLIENT_DEVICE_TWIN_CALLBACK deviceTwinCallback;
@@ -82,6 +103,34 @@ typedef struct IOTHUB_CLIENT_LL_HANDLE_DATA_TAG
     bool complete_twin_update_encountered;
     IOTHUB_AUTHORIZATION_HANDLE authorization_module;
     STRING_HANDLE product_info;
+    OBJECT_POOL_HANDLE messagePool; /*optional pool for the IOTHUB_MESSAGE_LIST entries, NULL when "message_pool_size" is not set*/
+    IOTHUB_CLIENT_POOL_STATISTICS messagePoolStatistics; /*returned by IoTHubClient_LL_GetOption*/
+    size_t outboundQueueMaxMessages; /*0 when "outbound_queue_max_messages" is not set*/
+    size_t outboundQueueMaxBytes; /*0 when "outbound_queue_max_bytes" is not set*/
+    IOTHUB_CLIENT_OUTBOUND_QUEUE_POLICY outboundQueuePolicy;
+    size_t outboundQueueHighWaterMark; /*percent of the limits*/
+    size_t outboundQueueLowWaterMark; /*percent of the limits*/
+    size_t outboundMessageCount; /*messages given to SendEventAsync and not completed yet, wherever they are*/
+    size_t outboundByteCount; /*sum of the messageSize of those messages*/
+    bool isOutboundQueueAboveHighWaterMark;
+    IOTHUB_CLIENT_OUTBOUND_QUEUE_CALLBACK outboundQueueCallback;
+    void* outboundQueueUserContextCallback;
+    IOTHUB_CLIENT_STATISTICS statistics; /*the counters kept by the client, IoTHubClient_LL_GetStatistics adds those of the queue and of the transport*/
+    tickcounter_ms_t lastDoWorkTick; /*time of the last _DoWork, UNKNOWN_TICK until the first one*/
+    const IOTHUB_CLIENT_COMPRESSION_CODEC* compressionCodec; /*NULL when "compression_codec" is not set*/
+    size_t compressionMinSize;
+    unsigned char* compressionBuffer; /*reused to compress the content of every event*/
+    size_t compressionBufferCapacity;
+    CONGESTION_CONTROL_HANDLE congestionControl; /*NULL when "congestion_control_max_window" is not set*/
+    tickcounter_ms_t lingerMs; /*0 when "linger_ms" is not set*/
+    size_t lingerMaxBytes; /*0 when "linger_max_bytes" is not set*/
+    tickcounter_ms_t lingerStartTick; /*last _DoWork before the first message of the lingering ones was queued, UNKNOWN_TICK when waitingToSend was drained*/
+#ifndef DONT_USE_JOURNAL
+    JOURNAL_HANDLE journal; /*NULL when "journal_directory" is not set*/
+    size_t journalSegmentSize; /*0 until "journal_segment_size" is set*/
+    unsigned char* journalRecord; /*reused to serialize every message appended to the journal*/
+    size_t journalRecordCapacity;
+#endif
 }IOTHUB_CLIENT_LL_HANDLE_DATA;
 
 static const char HOSTNAME_TOKEN[] = "HostName";
@@ -112,6 +161,8 @@ static void setTransportProtocol(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, TRANS
     handleData->IoTHubTransport_Subscribe_DeviceMethod = protocol->IoTHubTransport_Subscribe_DeviceMethod;
     handleData->IoTHubTransport_Unsubscribe_DeviceMethod = protocol->IoTHubTransport_Unsubscribe_DeviceMethod;
     handleData->IoTHubTransport_DeviceMethod_Response = protocol->IoTHubTransport_DeviceMethod_Response;
+    handleData->IoTHubTransport_GetNextDeadline = protocol->IoTHubTransport_GetNextDeadline;
+    handleData->IoTHubTransport_GetStatistics = protocol->IoTHubTransport_GetStatistics;
 }
 
 static void device_twin_data_destroy(IOTHUB_DEVICE_TWIN* client_item)
@@ -200,6 +251,9 @@ static IOTHUB_CLIENT_LL_HANDLE_DATA* initialize_iothub_client(const IOTHUB_CLIEN
             char* IoTHubName = NULL;
 
             memset(result, 0, sizeof(IOTHUB_CLIENT_LL_HANDLE_DATA));
+            result->lastDoWorkTick = UNKNOWN_TICK;
+            result->lingerStartTick = UNKNOWN_TICK;
+            result->connectionStatus = IOTHUB_CLIENT_CONNECTION_UNAUTHENTICATED;
 
             const char* device_key;
             const char* device_id;
@@ -339,6 +393,17 @@ static IOTHUB_CLIENT_LL_HANDLE_DATA* initialize_iothub_client(const IOTHUB_CLIEN
                         free(result);
                         result = NULL;
                     }
+                    /*Codes_SRS_IOTHUBCLIENT_LL_31_009: [ IoTHubClient_LL_Create shall create a timeout queue to track the timeouts of the messages in waitingToSend. ]*/
+                    else if ((result->messageTimeouts = timeout_queue_create()) == NULL)
+                    {
+                        LogError("unable to create the message timeout queue");
+                        tickcounter_destroy(result->tickCounter);
+                        destroy_blob_upload_module(result);
+                        IoTHubClient_Auth_Destroy(result->authorization_module);
+                        STRING_delete(product_info);
+                        free(result);
+                        result = NULL;
+                    }
                     else
                     {
                         /*Codes_SRS_IOTHUBCLIENT_LL_02_004: [Otherwise IoTHubClient_LL_Create shall initialize a new DLIST (further called "waitingToSend") containing records with fields of the following types: IOTHUB_MESSAGE_HANDLE, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK, void*.]*/
@@ -362,6 +427,7 @@ static IOTHUB_CLIENT_LL_HANDLE_DATA* initialize_iothub_client(const IOTHUB_CLIEN
                             IoTHubClient_Auth_Destroy(result->authorization_module);
                             result->IoTHubTransport_Destroy(result->transportHandle);
                             destroy_blob_upload_module(result);
+                            timeout_queue_destroy(result->messageTimeouts);
                             tickcounter_destroy(result->tickCounter);
                             STRING_delete(product_info);
                             free(result);
@@ -372,6 +438,11 @@ static IOTHUB_CLIENT_LL_HANDLE_DATA* initialize_iothub_client(const IOTHUB_CLIEN
                             /*Codes_SRS_IOTHUBCLIENT_LL_02_042: [ By default, messages shall not timeout. ]*/
                             result->currentMessageTimeout = 0;
                             result->current_device_twin_timeout = 0;
+                            /*Codes_SRS_IOTHUBCLIENT_LL_31_031: [ By default the outbound queue shall not be bounded, its policy shall be IOTHUB_CLIENT_OUTBOUND_QUEUE_REJECT_NEW and its high and low water marks shall be 80 and 50 percent. ]*/
+                            result->outboundQueueHighWaterMark = 80;
+                            result->outboundQueueLowWaterMark = 50;
+                            /*Codes_SRS_IOTHUBCLIENT_LL_31_066: [ By default the events shall not be compressed, and once a codec is set only the events of at least IOTHUB_CLIENT_COMPRESSION_DEFAULT_MIN_SIZE bytes shall be. compression_min_size takes a pointer to a size_t holding another minimum. ]*/
+                            result->compressionMinSize = IOTHUB_CLIENT_COMPRESSION_DEFAULT_MIN_SIZE;
                             /*Codes_SRS_IOTHUBCLIENT_LL_25_124: [ `IoTHubClient_LL_Create` shall set the default retry policy as Exponential backoff with jitter and if succeed and return a `non-NULL` handle. ]*/
                             if (IoTHubClient_LL_SetRetryPolicy(result, IOTHUB_CLIENT_RETRY_EXPONENTIAL_BACKOFF_WITH_JITTER, 0) != IOTHUB_CLIENT_OK)
                             {
@@ -380,6 +451,7 @@ static IOTHUB_CLIENT_LL_HANDLE_DATA* initialize_iothub_client(const IOTHUB_CLIEN
                                 IoTHubClient_Auth_Destroy(result->authorization_module);
                                 result->IoTHubTransport_Destroy(result->transportHandle);
                                 destroy_blob_upload_module(result);
+                                timeout_queue_destroy(result->messageTimeouts);
                                 tickcounter_destroy(result->tickCounter);
                                 STRING_delete(product_info);
                                 free(result);
@@ -789,8 +861,9 @@ void IoTHubClient_LL_Destroy(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle)
             {
                 temp->callback(IOTHUB_CLIENT_CONFIRMATION_BECAUSE_DESTROY, temp->context);
             }
+            timeout_queue_remove(&temp->timeout_entry);
             IoTHubMessage_Destroy(temp->messageHandle);
-            free(temp);
+            object_pool_free(handleData->messagePool, temp);
         }
 
         /* Codes_SRS_IOTHUBCLIENT_LL_07_007: [ IoTHubClient_LL_Destroy shall iterate the device twin queues and destroy any remaining items. ] */
@@ -807,300 +880,1417 @@ void IoTHubClient_LL_Destroy(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle)
 
         /*Codes_SRS_IOTHUBCLIENT_LL_17_011: [IoTHubClient_LL_Destroy  shall free the resources allocated by IoTHubClient (if any).] */
         IoTHubClient_Auth_Destroy(handleData->authorization_module);
+        timeout_queue_destroy(handleData->messageTimeouts);
         tickcounter_destroy(handleData->tickCounter);
 #ifndef DONT_USE_UPLOADTOBLOB
         IoTHubClient_LL_UploadToBlob_Destroy(handleData->uploadToBlobHandle);
 #endif
         STRING_delete(handleData->product_info);
+        object_pool_destroy(handleData->messagePool);
+        congestion_control_destroy(handleData->congestionControl);
+#ifndef DONT_USE_JOURNAL
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_054: [ IoTHubClient_LL_Destroy shall close the journal without confirming the messages that were not completed. ]*/
+        if (handleData->journal != NULL)
+        {
+            journal_destroy(handleData->journal);
+        }
+        if (handleData->journalRecord != NULL)
+        {
+            free(handleData->journalRecord);
+        }
+#endif
+        if (handleData->compressionBuffer != NULL)
+        {
+            free(handleData->compressionBuffer);
+        }
         free(handleData);
     }
 }
 
 /*Codes_SRS_IOTHUBCLIENT_LL_02_044: [ Messages already delivered to IoTHubClient_LL shall not have their timeouts modified by a new call to IoTHubClient_LL_SetOption. ]*/
 /*returns 0 on success, any other value is error*/
-static int attach_ms_timesOutAfter(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, IOTHUB_MESSAGE_LIST *newEntry)
+static int get_ms_timesOutAfter(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, tickcounter_ms_t* ms_timesOutAfter)
 {
     int result;
     /*Codes_SRS_IOTHUBCLIENT_LL_02_043: [ Calling IoTHubClient_LL_SetOption with value set to "0" shall disable the timeout mechanism for all new messages. ]*/
     if (handleData->currentMessageTimeout == 0)
     {
-        newEntry->ms_timesOutAfter = 0; /*do not timeout*/
+        *ms_timesOutAfter = 0; /*do not timeout*/
         result = 0;
     }
     else
     {
         /*Codes_SRS_IOTHUBCLIENT_LL_02_039: [ "messageTimeout" - once IoTHubClient_LL_SendEventAsync is called the message shall timeout after value miliseconds. Value is a pointer to a uint64. ]*/
-        if (tickcounter_get_current_ms(handleData->tickCounter, &newEntry->ms_timesOutAfter) != 0)
+        if (tickcounter_get_current_ms(handleData->tickCounter, ms_timesOutAfter) != 0)
         {
             result = __FAILURE__;
             LogError("unable to get the current relative tickcount");
         }
         else
         {
-            newEntry->ms_timesOutAfter += handleData->currentMessageTimeout;
+            *ms_timesOutAfter += handleData->currentMessageTimeout;
             result = 0;
         }
     }
     return result;
 }
 
-IOTHUB_CLIENT_RESULT IoTHubClient_LL_SendEventAsync(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle, IOTHUB_MESSAGE_HANDLE eventMessageHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK eventConfirmationCallback, void* userContextCallback)
+/*the bytes a message counts for against "outbound_queue_max_bytes"*/
+static size_t get_message_size(IOTHUB_MESSAGE_HANDLE messageHandle)
 {
-    IOTHUB_CLIENT_RESULT result;
-    /*Codes_SRS_IOTHUBCLIENT_LL_02_011: [IoTHubClient_LL_SendEventAsync shall fail and return IOTHUB_CLIENT_INVALID_ARG if parameter iotHubClientHandle or eventMessageHandle is NULL.]*/
-    if (
-        (iotHubClientHandle == NULL) ||
-        (eventMessageHandle == NULL) ||
-        /*Codes_SRS_IOTHUBCLIENT_LL_02_012: [IoTHubClient_LL_SendEventAsync shall fail and return IOTHUB_CLIENT_INVALID_ARG if parameter eventConfirmationCallback is NULL and userContextCallback is not NULL.] */
-        ((eventConfirmationCallback == NULL) && (userContextCallback != NULL))
-        )
+    size_t result;
+    if (IoTHubMessage_GetContentType(messageHandle) == IOTHUBMESSAGE_BYTEARRAY)
     {
-        result = IOTHUB_CLIENT_INVALID_ARG;
-        LOG_ERROR_RESULT;
+        const unsigned char* buffer;
+        if (IoTHubMessage_GetByteArray(messageHandle, &buffer, &result) != IOTHUB_MESSAGE_OK)
+        {
+            result = 0;
+        }
     }
     else
     {
-        IOTHUB_MESSAGE_LIST *newEntry = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST));
-        if (newEntry == NULL)
-        {
-            result = IOTHUB_CLIENT_ERROR;
-            LOG_ERROR_RESULT;
-        }
-        else
-        {
-            IOTHUB_CLIENT_LL_HANDLE_DATA* handleData = (IOTHUB_CLIENT_LL_HANDLE_DATA*)iotHubClientHandle;
-
-            if (attach_ms_timesOutAfter(handleData, newEntry) != 0)
-            {
-                result = IOTHUB_CLIENT_ERROR;
-                LOG_ERROR_RESULT;
-                free(newEntry);
-            }
-            else
-            {
-                /*Codes_SRS_IOTHUBCLIENT_LL_02_013: [IoTHubClient_LL_SendEventAsync shall add the DLIST waitingToSend a new record cloning the information from eventMessageHandle, eventConfirmationCallback, userContextCallback.]*/
-                if ((newEntry->messageHandle = IoTHubMessage_Clone(eventMessageHandle)) == NULL)
-                {
-                    /*Codes_SRS_IOTHUBCLIENT_LL_02_014: [If cloning and/or adding the information fails for any reason, IoTHubClient_LL_SendEventAsync shall fail and return IOTHUB_CLIENT_ERROR.] */
-                    result = IOTHUB_CLIENT_ERROR;
-                    free(newEntry);
-                    LOG_ERROR_RESULT;
-                }
-                else
-                {
-                    /*Codes_SRS_IOTHUBCLIENT_LL_02_013: [IoTHubClient_LL_SendEventAsync shall add the DLIST waitingToSend a new record cloning the information from eventMessageHandle, eventConfirmationCallback, userContextCallback.]*/
-                    newEntry->callback = eventConfirmationCallback;
-                    newEntry->context = userContextCallback;
-                    DList_InsertTailList(&(iotHubClientHandle->waitingToSend), &(newEntry->entry));
-                    /*Codes_SRS_IOTHUBCLIENT_LL_02_015: [Otherwise IoTHubClient_LL_SendEventAsync shall succeed and return IOTHUB_CLIENT_OK.] */
-                    result = IOTHUB_CLIENT_OK;
-                }
-            }
-        }
+        const char* text = IoTHubMessage_GetString(messageHandle);
+        result = (text == NULL) ? 0 : strlen(text);
     }
     return result;
 }
 
-IOTHUB_CLIENT_RESULT IoTHubClient_LL_SetMessageCallback(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle, IOTHUB_CLIENT_MESSAGE_CALLBACK_ASYNC messageCallback, void* userContextCallback)
+/*fill level of the outbound queue in percent of the tightest of its limits, 0 when it is not bounded*/
+static size_t get_outbound_queue_level(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData)
 {
-    IOTHUB_CLIENT_RESULT result;
-    if (iotHubClientHandle == NULL)
+    size_t result = 0;
+    if (handleData->outboundQueueMaxMessages != 0)
     {
-        /*Codes_SRS_IOTHUBCLIENT_LL_02_016: [IoTHubClient_LL_SetMessageCallback shall fail and return IOTHUB_CLIENT_INVALID_ARG if parameter iotHubClientHandle is NULL.] */
-        LogError("Invalid argument - iotHubClientHandle is NULL");
-        result = IOTHUB_CLIENT_INVALID_ARG;
+        result = (size_t)(((uint64_t)handleData->outboundMessageCount * 100) / handleData->outboundQueueMaxMessages);
     }
-    else
+    if (handleData->outboundQueueMaxBytes != 0)
     {
-        IOTHUB_CLIENT_LL_HANDLE_DATA* handleData = (IOTHUB_CLIENT_LL_HANDLE_DATA*)iotHubClientHandle;
-        if (messageCallback == NULL)
+        size_t bytesLevel = (size_t)(((uint64_t)handleData->outboundByteCount * 100) / handleData->outboundQueueMaxBytes);
+        if (bytesLevel > result)
         {
-            if (handleData->messageCallback.type == CALLBACK_TYPE_NONE)
-            {
-                /*Codes_SRS_IOTHUBCLIENT_LL_10_010: [If parameter messageCallback is NULL and the _SetMessageCallback had not been called to subscribe for messages, then IoTHubClient_LL_SetMessageCallback shall fail and return IOTHUB_CLIENT_ERROR.] */
-                LogError("not currently set to accept or process incoming messages.");
-                result = IOTHUB_CLIENT_ERROR;
-            }
-            else if (handleData->messageCallback.type == CALLBACK_TYPE_ASYNC)
-            {
-                /*Codes_SRS_IOTHUBCLIENT_LL_10_010: [If parameter messageCallback is NULL and the _SetMessageCallback had not been called to subscribe for messages, then IoTHubClient_LL_SetMessageCallback shall fail and return IOTHUB_CLIENT_ERROR.] */
-                LogError("Invalid workflow sequence. Please unsubscribe using the IoTHubClient_LL_SetMessageCallback_Ex function.");
-                result = IOTHUB_CLIENT_ERROR;
-            }
-            else
+            result = bytesLevel;
+        }
+    }
+    return result;
+}
+
+static void update_outbound_queue_water_marks(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData)
+{
+    if ((handleData->outboundQueueMaxMessages != 0) || (handleData->outboundQueueMaxBytes != 0))
+    {
+        size_t level = get_outbound_queue_level(handleData);
+        if (!handleData->isOutboundQueueAboveHighWaterMark && (level >= handleData->outboundQueueHighWaterMark))
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_040: [ When the fill level of the outbound queue reaches the high water mark, the outbound queue callback shall be called once with IOTHUB_CLIENT_OUTBOUND_QUEUE_HIGH_WATER_MARK. ]*/
+            handleData->isOutboundQueueAboveHighWaterMark = true;
+            if (handleData->outboundQueueCallback != NULL)
             {
-                /*Codes_SRS_IOTHUBCLIENT_LL_02_019: [If parameter messageCallback is NULL then IoTHubClient_LL_SetMessageCallback shall call the underlying layer's _Unsubscribe function and return IOTHUB_CLIENT_OK.] */
-                handleData->IoTHubTransport_Unsubscribe(handleData->deviceHandle);
-                handleData->messageCallback.type = CALLBACK_TYPE_NONE;
-                handleData->messageCallback.callbackSync = NULL;
-                handleData->messageCallback.callbackAsync = NULL;
-                handleData->messageCallback.userContextCallback = NULL;
-                result = IOTHUB_CLIENT_OK;
+                handleData->outboundQueueCallback(IOTHUB_CLIENT_OUTBOUND_QUEUE_HIGH_WATER_MARK, handleData->outboundQueueUserContextCallback);
             }
         }
-        else
+        else if (handleData->isOutboundQueueAboveHighWaterMark && (level <= handleData->outboundQueueLowWaterMark))
         {
-            if (handleData->messageCallback.type == CALLBACK_TYPE_ASYNC)
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_041: [ When the fill level of the outbound queue then drains to the low water mark, the outbound queue callback shall be called once with IOTHUB_CLIENT_OUTBOUND_QUEUE_LOW_WATER_MARK. ]*/
+            handleData->isOutboundQueueAboveHighWaterMark = false;
+            if (handleData->outboundQueueCallback != NULL)
             {
-                /* Codes_SRS_IOTHUBCLIENT_LL_10_011: [If parameter messageCallback is non-NULL and the _SetMessageCallback_Ex had been used to susbscribe for messages, then IoTHubClient_LL_SetMessageCallback shall fail and return IOTHUB_CLIENT_ERROR.] */
-                LogError("Invalid workflow sequence. Please unsubscribe using the IoTHubClient_LL_SetMessageCallback_Ex function before subscribing with MessageCallback.");
-                result = IOTHUB_CLIENT_ERROR;
+                handleData->outboundQueueCallback(IOTHUB_CLIENT_OUTBOUND_QUEUE_LOW_WATER_MARK, handleData->outboundQueueUserContextCallback);
             }
-            else
+        }
+    }
+}
+
+/*a record leaves the outbound queue: it was completed, timed out, dropped or unqueued*/
+static void release_outbound_queue_space(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, IOTHUB_MESSAGE_LIST* record)
+{
+    handleData->outboundMessageCount--;
+    handleData->outboundByteCount -= record->messageSize;
+}
+
+/*bucket of the latency histogram counting latency, see IOTHUB_CLIENT_LATENCY_HISTOGRAM_BUCKETS*/
+static size_t get_latency_bucket(tickcounter_ms_t latency)
+{
+    size_t result = 0;
+    while ((latency != 0) && (result < IOTHUB_CLIENT_LATENCY_HISTOGRAM_BUCKETS - 1))
+    {
+        latency >>= 1;
+        result++;
+    }
+    return result;
+}
+
+/*the size of the messages is only needed, and kept in their records, when the outbound queue or the linger are bounded in bytes*/
+static bool is_message_size_kept(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData)
+{
+    return (handleData->outboundQueueMaxBytes != 0) || (handleData->lingerMaxBytes != 0);
+}
+
+/*counts in the statistics a message that leaves the client completed with result*/
+static void count_completed_message(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, IOTHUB_MESSAGE_LIST* record, IOTHUB_CLIENT_CONFIRMATION_RESULT result)
+{
+    switch (result)
+    {
+        case IOTHUB_CLIENT_CONFIRMATION_OK:
+            handleData->statistics.events_sent++;
+            handleData->statistics.bytes_sent += is_message_size_kept(handleData) ? record->messageSize : get_message_size(record->messageHandle);
             {
-                if (handleData->IoTHubTransport_Subscribe(handleData->deviceHandle) == 0)
-                {
-                    /*Codes_SRS_IOTHUBCLIENT_LL_02_017: [If parameter messageCallback is non-NULL then IoTHubClient_LL_SetMessageCallback shall call the underlying layer's _Subscribe function.]*/
-                    handleData->messageCallback.type = CALLBACK_TYPE_SYNC;
-                    handleData->messageCallback.callbackSync = messageCallback;
-                    handleData->messageCallback.userContextCallback = userContextCallback;
-                    result = IOTHUB_CLIENT_OK;
-                }
-                else
+                /*Codes_SRS_IOTHUBCLIENT_LL_31_058: [ The latency of a message is the time between the call to IoTHubClient_LL_DoWork that sent it and its completion with IOTHUB_CLIENT_CONFIRMATION_OK. When the send time of the message is not known, because neither the congestion control nor the linger held it back, the latency is counted from the call to IoTHubClient_LL_DoWork preceding its queueing instead. Messages queued before the first call to IoTHubClient_LL_DoWork are not counted in the latency histogram. ]*/
+                tickcounter_ms_t since = (record->ms_sent != UNKNOWN_TICK) ? record->ms_sent : record->ms_queued;
+                if ((handleData->lastDoWorkTick != UNKNOWN_TICK) && (since != UNKNOWN_TICK) && (handleData->lastDoWorkTick >= since))
                 {
-                    /*Codes_SRS_IOTHUBCLIENT_LL_02_018: [If the underlying layer's _Subscribe function fails, then IoTHubClient_LL_SetMessageCallback shall fail and return IOTHUB_CLIENT_ERROR. Otherwise IoTHubClient_LL_SetMessageCallback shall succeed and return IOTHUB_CLIENT_OK.]*/
-                    LogError("IoTHubTransport_Subscribe failed");
-                    handleData->messageCallback.type = CALLBACK_TYPE_NONE;
-                    handleData->messageCallback.callbackSync = NULL;
-                    handleData->messageCallback.callbackAsync = NULL;
-                    handleData->messageCallback.userContextCallback = NULL;
-                    result = IOTHUB_CLIENT_ERROR;
+                    handleData->statistics.latency_histogram[get_latency_bucket(handleData->lastDoWorkTick - since)]++;
                 }
             }
-        }
+            break;
+        case IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT:
+            handleData->statistics.events_timed_out++;
+            break;
+        case IOTHUB_CLIENT_CONFIRMATION_DROPPED:
+            handleData->statistics.events_dropped++;
+            break;
+        case IOTHUB_CLIENT_CONFIRMATION_MESSAGE_EXPIRED:
+            handleData->statistics.events_expired++;
+            break;
+        default:
+            handleData->statistics.events_failed++;
+            break;
     }
-    return result;
 }
 
-IOTHUB_CLIENT_RESULT IoTHubClient_LL_SetMessageCallback_Ex(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle, IOTHUB_CLIENT_MESSAGE_CALLBACK_ASYNC_EX messageCallback, void* userContextCallback)
+static bool is_outbound_queue_bounded(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData)
 {
-    IOTHUB_CLIENT_RESULT result;
-    if (iotHubClientHandle == NULL)
+    return (handleData->outboundQueueMaxMessages != 0) || (handleData->outboundQueueMaxBytes != 0);
+}
+
+/*true when messageCount more messages of byteCount bytes fit once reclaimedCount messages of reclaimedBytes bytes are dropped*/
+static bool outbound_queue_has_room(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, size_t messageCount, size_t byteCount, size_t reclaimedCount, size_t reclaimedBytes)
+{
+    return
+        ((handleData->outboundQueueMaxMessages == 0) || (handleData->outboundMessageCount - reclaimedCount + messageCount <= handleData->outboundQueueMaxMessages)) &&
+        ((handleData->outboundQueueMaxBytes == 0) || (handleData->outboundByteCount - reclaimedBytes + byteCount <= handleData->outboundQueueMaxBytes));
+}
+
+/*with DROP_LOWEST_PRIORITY only the messages whose priority is not above the new ones may be dropped, with DROP_OLDEST any of them, with REJECT_NEW none*/
+static bool is_outbound_queue_victim_candidate(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, IOTHUB_MESSAGE_LIST* record, IOTHUB_MESSAGE_PRIORITY priority)
+{
+    return
+        (handleData->outboundQueuePolicy == IOTHUB_CLIENT_OUTBOUND_QUEUE_DROP_OLDEST) ||
+        ((handleData->outboundQueuePolicy == IOTHUB_CLIENT_OUTBOUND_QUEUE_DROP_LOWEST_PRIORITY) && (record->priority <= priority));
+}
+
+/*the message of waitingToSend dropped next: the oldest of those with the lowest priority, which start the last lane of waitingToSend*/
+static IOTHUB_MESSAGE_LIST* get_outbound_queue_victim(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, IOTHUB_MESSAGE_PRIORITY priority)
+{
+    IOTHUB_MESSAGE_LIST* result;
+    if ((handleData->outboundQueuePolicy == IOTHUB_CLIENT_OUTBOUND_QUEUE_REJECT_NEW) || DList_IsListEmpty(&handleData->waitingToSend))
     {
-        /*Codes_SRS_IOTHUBCLIENT_LL_10_021: [IoTHubClient_LL_SetMessageCallback_Ex shall fail and return IOTHUB_CLIENT_INVALID_ARG if parameter iotHubClientHandle is NULL.]*/
-        LogError("Invalid argument - iotHubClientHandle is NULL");
-        result = IOTHUB_CLIENT_INVALID_ARG;
+        result = NULL;
     }
     else
     {
-        IOTHUB_CLIENT_LL_HANDLE_DATA* handleData = (IOTHUB_CLIENT_LL_HANDLE_DATA*)iotHubClientHandle;
-        if (messageCallback == NULL)
+        IOTHUB_MESSAGE_LIST* first = containingRecord(handleData->waitingToSend.Flink, IOTHUB_MESSAGE_LIST, entry);
+        IOTHUB_MESSAGE_LIST* last = containingRecord(handleData->waitingToSend.Blink, IOTHUB_MESSAGE_LIST, entry);
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_064: [ When waitingToSend holds messages of different priorities, IOTHUB_CLIENT_OUTBOUND_QUEUE_DROP_OLDEST shall drop the oldest of the messages with the lowest priority first. ]*/
+        if (first->priority != last->priority)
         {
-            if (handleData->messageCallback.type == CALLBACK_TYPE_NONE)
-            {
-                /*Codes_SRS_IOTHUBCLIENT_LL_10_018: [If parameter messageCallback is NULL and IoTHubClient_LL_SetMessageCallback_Ex had not been used to subscribe for messages, then IoTHubClient_LL_SetMessageCallback_Ex shall fail and return IOTHUB_CLIENT_ERROR.] */
-                LogError("not currently set to accept or process incoming messages.");
-                result = IOTHUB_CLIENT_ERROR;
-            }
-            else if (handleData->messageCallback.type == CALLBACK_TYPE_SYNC)
+            PDLIST_ENTRY current = &last->entry;
+            while (containingRecord(current->Blink, IOTHUB_MESSAGE_LIST, entry)->priority == last->priority)
             {
-                /*Codes_SRS_IOTHUBCLIENT_LL_10_019: [If parameter messageCallback is NULL and IoTHubClient_LL_SetMessageCallback had been used to subscribe for messages, then IoTHubClient_LL_SetMessageCallback_Ex shall fail and return IOTHUB_CLIENT_ERROR.] */
-                LogError("Invalid workflow sequence. Please unsubscribe using the IoTHubClient_LL_SetMessageCallback function.");
-                result = IOTHUB_CLIENT_ERROR;
-            }
-            else
-            {
-                /*Codes_SRS_IOTHUBCLIENT_LL_10_023: [If parameter messageCallback is NULL then IoTHubClient_LL_SetMessageCallback_Ex shall call the underlying layer's _Unsubscribe function and return IOTHUB_CLIENT_OK.] */ 
-                handleData->IoTHubTransport_Unsubscribe(handleData->deviceHandle);
-                handleData->messageCallback.type = CALLBACK_TYPE_NONE;
-                handleData->messageCallback.callbackSync = NULL;
-                handleData->messageCallback.callbackAsync = NULL;
-                handleData->messageCallback.userContextCallback = NULL;
-                result = IOTHUB_CLIENT_OK;
+                current = current->Blink;
             }
+            first = containingRecord(current, IOTHUB_MESSAGE_LIST, entry);
         }
-        else
+        result = is_outbound_queue_victim_candidate(handleData, first, priority) ? first : NULL;
+    }
+    return result;
+}
+
+/*makes room in a bounded outbound queue for the messageCount messages, moving the messages it drops to dropped (which it initializes).
+Returns false, without dropping anything, when the messages cannot fit*/
+static bool make_room_in_outbound_queue(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, const IOTHUB_MESSAGE_HANDLE* messages, size_t messageCount, PDLIST_ENTRY dropped)
+{
+    bool result;
+    size_t byteCount = 0;
+    size_t reclaimableCount = 0;
+    size_t reclaimableBytes = 0;
+    IOTHUB_MESSAGE_PRIORITY priority = IOTHUB_MESSAGE_PRIORITY_HIGH;
+    size_t index;
+
+    DList_InitializeListHead(dropped);
+    for (index = 0; index < messageCount; index++)
+    {
+        if (handleData->outboundQueueMaxBytes != 0)
         {
-            if (handleData->messageCallback.type == CALLBACK_TYPE_SYNC)
+            byteCount += get_message_size(messages[index]);
+        }
+        /*a batch only drops what its lowest priority message could drop*/
+        if (handleData->outboundQueuePolicy == IOTHUB_CLIENT_OUTBOUND_QUEUE_DROP_LOWEST_PRIORITY)
+        {
+            IOTHUB_MESSAGE_PRIORITY messagePriority = IoTHubMessage_GetPriority(messages[index]);
+            if (messagePriority < priority)
             {
-                /*Codes_SRS_IOTHUBCLIENT_LL_10_020: [If parameter messageCallback is non-NULL, and IoTHubClient_LL_SetMessageCallback had been used to subscribe for messages, then IoTHubClient_LL_SetMessageCallback_Ex shall fail and return IOTHUB_CLIENT_ERROR.] */
-                LogError("Invalid workflow sequence. Please unsubscribe using the IoTHubClient_LL_MessageCallbackEx function before subscribing with MessageCallback.");
-                result = IOTHUB_CLIENT_ERROR;
+                priority = messagePriority;
             }
-            else
+        }
+    }
+
+    if (!outbound_queue_has_room(handleData, messageCount, byteCount, 0, 0))
+    {
+        PDLIST_ENTRY current;
+        for (current = handleData->waitingToSend.Flink; current != &handleData->waitingToSend; current = current->Flink)
+        {
+            IOTHUB_MESSAGE_LIST* record = containingRecord(current, IOTHUB_MESSAGE_LIST, entry);
+            if (is_outbound_queue_victim_candidate(handleData, record, priority))
             {
-                if (handleData->IoTHubTransport_Subscribe(handleData->deviceHandle) == 0)
-                {
-                    /*Codes_SRS_IOTHUBCLIENT_LL_10_024: [If parameter messageCallback is non-NULL then IoTHubClient_LL_SetMessageCallback_Ex shall call the underlying layer's _Subscribe function.]*/
-                    handleData->messageCallback.type = CALLBACK_TYPE_ASYNC;
-                    handleData->messageCallback.callbackAsync = messageCallback;
-                    handleData->messageCallback.userContextCallback = userContextCallback;
-                    result = IOTHUB_CLIENT_OK;
-                }
-                else
-                {
-                    /*Codes_SRS_IOTHUBCLIENT_LL_10_025: [If the underlying layer's _Subscribe function fails, then IoTHubClient_LL_SetMessageCallback_Ex shall fail and return IOTHUB_CLIENT_ERROR. Otherwise IoTHubClient_LL_SetMessageCallback_Ex shall succeed and return IOTHUB_CLIENT_OK.] */
-                    LogError("IoTHubTransport_Subscribe failed");
-                    handleData->messageCallback.type = CALLBACK_TYPE_NONE;
-                    handleData->messageCallback.callbackSync = NULL;
-                    handleData->messageCallback.callbackAsync = NULL;
-                    handleData->messageCallback.userContextCallback = NULL;
-                    result = IOTHUB_CLIENT_ERROR;
-                }
+                reclaimableCount++;
+                reclaimableBytes += record->messageSize;
             }
         }
     }
-    return result;
-}
 
-IOTHUB_CLIENT_RESULT IoTHubClient_LL_SendMessageDisposition(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle, MESSAGE_CALLBACK_INFO* message_data, IOTHUBMESSAGE_DISPOSITION_RESULT disposition)
-{
-    IOTHUB_CLIENT_RESULT result;
-    if ((iotHubClientHandle == NULL) || (message_data == NULL))
+    /*Codes_SRS_IOTHUBCLIENT_LL_31_035: [ If the messages do not fit in the outbound queue even after dropping all the messages the policy allows to drop, IoTHubClient_LL_SendEventAsync shall fail, drop nothing and return IOTHUB_CLIENT_QUEUE_FULL. ]*/
+    if (!outbound_queue_has_room(handleData, messageCount, byteCount, reclaimableCount, reclaimableBytes))
     {
-        /*Codes_SRS_IOTHUBCLIENT_LL_10_026: [IoTHubClient_LL_SendMessageDisposition shall fail and return IOTHUB_CLIENT_INVALID_ARG if parameter iotHubClientHandle is NULL.]*/
-        LogError("Invalid argument handle=%p, message=%p", iotHubClientHandle, message_data);
-        result = IOTHUB_CLIENT_INVALID_ARG;
+        result = false;
     }
     else
     {
-        IOTHUB_CLIENT_LL_HANDLE_DATA* handleData = (IOTHUB_CLIENT_LL_HANDLE_DATA*)iotHubClientHandle;
-        /*Codes_SRS_IOTHUBCLIENT_LL_10_027: [IoTHubClient_LL_SendMessageDisposition shall return the result from calling the underlying layer's _Send_Message_Disposition.]*/
-        result = handleData->IoTHubTransport_SendMessageDisposition(message_data, disposition);
+        IOTHUB_MESSAGE_LIST* victim;
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_036: [ With IOTHUB_CLIENT_OUTBOUND_QUEUE_REJECT_NEW, messages that do not fit shall be rejected. ]*/
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_037: [ With IOTHUB_CLIENT_OUTBOUND_QUEUE_DROP_OLDEST, the oldest messages not yet taken by the transport shall be dropped until the new messages fit. ]*/
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_038: [ With IOTHUB_CLIENT_OUTBOUND_QUEUE_DROP_LOWEST_PRIORITY, the oldest of the messages with the lowest priority not yet taken by the transport shall be dropped until the new messages fit, as long as that priority is not higher than the priority of the new messages. ]*/
+        while (!outbound_queue_has_room(handleData, messageCount, byteCount, 0, 0) &&
+            ((victim = get_outbound_queue_victim(handleData, priority)) != NULL))
+        {
+            DList_RemoveEntryList(&victim->entry);
+            timeout_queue_remove(&victim->timeout_entry);
+            release_outbound_queue_space(handleData, victim);
+            DList_InsertTailList(dropped, &victim->entry);
+        }
+        result = true;
     }
     return result;
 }
 
-static void DoTimeouts(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData)
+#ifndef DONT_USE_JOURNAL
+static size_t get_journal_string_size(const char* value)
 {
-    tickcounter_ms_t nowTick;
-    if (tickcounter_get_current_ms(handleData->tickCounter, &nowTick) != 0)
+    /*the length includes the terminating '\0', a length of 0 stands for NULL*/
+    return sizeof(uint32_t) + ((value == NULL) ? 0 : strlen(value) + 1);
+}
+
+static unsigned char* put_journal_uint32(unsigned char* destination, size_t value)
+{
+    destination[0] = (unsigned char)(value & 0xFF);
+    destination[1] = (unsigned char)((value >> 8) & 0xFF);
+    destination[2] = (unsigned char)((value >> 16) & 0xFF);
+    destination[3] = (unsigned char)((value >> 24) & 0xFF);
+    return destination + sizeof(uint32_t);
+}
+
+static unsigned char* put_journal_uint64(unsigned char* destination, uint64_t value)
+{
+    size_t index;
+    for (index = 0; index < sizeof(uint64_t); index++)
     {
-        LogError("unable to get the current ms, timeouts will not be processed");
+        destination[index] = (unsigned char)((value >> (8 * index)) & 0xFF);
     }
-    else
+    return destination + sizeof(uint64_t);
+}
+
+static unsigned char* put_journal_bytes(unsigned char* destination, const void* bytes, size_t size)
+{
+    destination = put_journal_uint32(destination, size);
+    if (size > 0)
     {
-        DLIST_ENTRY* currentItemInWaitingToSend = handleData->waitingToSend.Flink;
-        while (currentItemInWaitingToSend != &(handleData->waitingToSend)) /*while we are not at the end of the list*/
-        {
-            IOTHUB_MESSAGE_LIST* fullEntry = containingRecord(currentItemInWaitingToSend, IOTHUB_MESSAGE_LIST, entry);
-            /*Codes_SRS_IOTHUBCLIENT_LL_02_041: [ If more than value miliseconds have passed since the call to IoTHubClient_LL_SendEventAsync then the message callback shall be called with a status code of IOTHUB_CLIENT_CONFIRMATION_TIMEOUT. ]*/
-            if ((fullEntry->ms_timesOutAfter != 0) && (fullEntry->ms_timesOutAfter < nowTick))
-            {
-                PDLIST_ENTRY theNext = currentItemInWaitingToSend->Flink; /*need to save the next item, because the below operations are destructive*/
-                DList_RemoveEntryList(currentItemInWaitingToSend);
-                if (fullEntry->callback != NULL)
-                {
-                    fullEntry->callback(IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT, fullEntry->context);
-                }
-                IoTHubMessage_Destroy(fullEntry->messageHandle); /*because it has been cloned*/
-                free(fullEntry);
-                currentItemInWaitingToSend = theNext;
-            }
-            else
-            {
-                currentItemInWaitingToSend = currentItemInWaitingToSend->Flink;
-            }
-        }
+        (void)memcpy(destination, bytes, size);
     }
+    return destination + size;
 }
 
-void IoTHubClient_LL_DoWork(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle)
+static unsigned char* put_journal_string(unsigned char* destination, const char* value)
 {
-    /*Codes_SRS_IOTHUBCLIENT_LL_02_020: [If parameter iotHubClientHandle is NULL then IoTHubClient_LL_DoWork shall not perform any action.] */
-    if (iotHubClientHandle != NULL)
-    {
-        IOTHUB_CLIENT_LL_HANDLE_DATA* handleData = (IOTHUB_CLIENT_LL_HANDLE_DATA*)iotHubClientHandle;
+    return put_journal_bytes(destination, value, (value == NULL) ? 0 : strlen(value) + 1);
+}
+
+/*returns the content, id, correlation id, priority, expiry time and properties of message laid out in handleData->journalRecord*/
+static const unsigned char* serialize_message(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, IOTHUB_MESSAGE_HANDLE message, size_t* size)
+{
+    const unsigned char* result;
+    IOTHUBMESSAGE_CONTENT_TYPE contentType = IoTHubMessage_GetContentType(message);
+    const unsigned char* content = NULL;
+    size_t contentSize = 0;
+    const char*const* keys;
+    const char*const* values;
+    size_t propertyCount;
+
+    if (contentType == IOTHUBMESSAGE_BYTEARRAY)
+    {
+        if (IoTHubMessage_GetByteArray(message, &content, &contentSize) != IOTHUB_MESSAGE_OK)
+        {
+            contentType = IOTHUBMESSAGE_UNKNOWN;
+        }
+    }
+    else if ((contentType == IOTHUBMESSAGE_STRING) &&
+        ((content = (const unsigned char*)IoTHubMessage_GetString(message)) != NULL))
+    {
+        contentSize = strlen((const char*)content) + 1;
+    }
+    else
+    {
+        contentType = IOTHUBMESSAGE_UNKNOWN;
+    }
+
+    if (contentType == IOTHUBMESSAGE_UNKNOWN)
+    {
+        LogError("unable to get the content of the message");
+        result = NULL;
+    }
+    else if (Map_GetInternals(IoTHubMessage_ReadOnlyProperties(message), &keys, &values, &propertyCount) != MAP_OK)
+    {
+        LogError("unable to get the properties of the message");
+        result = NULL;
+    }
+    else
+    {
+        const char* messageId = IoTHubMessage_GetMessageId(message);
+        const char* correlationId = IoTHubMessage_GetCorrelationId(message);
+        size_t index;
+        size_t recordSize = JOURNAL_RECORD_HEADER_SIZE + sizeof(uint32_t) + contentSize + get_journal_string_size(messageId) + get_journal_string_size(correlationId) + sizeof(uint32_t);
+        for (index = 0; index < propertyCount; index++)
+        {
+            recordSize += get_journal_string_size(keys[index]) + get_journal_string_size(values[index]);
+        }
+
+        if (recordSize > handleData->journalRecordCapacity)
+        {
+            unsigned char* newRecord = (unsigned char*)realloc(handleData->journalRecord, recordSize);
+            if (newRecord == NULL)
+            {
+                LogError("unable to realloc %lu bytes", (unsigned long)recordSize);
+            }
+            else
+            {
+                handleData->journalRecord = newRecord;
+                handleData->journalRecordCapacity = recordSize;
+            }
+        }
+
+        if (recordSize > handleData->journalRecordCapacity)
+        {
+            result = NULL;
+        }
+        else
+        {
+            unsigned char* position = handleData->journalRecord;
+            *position++ = JOURNAL_RECORD_VERSION;
+            *position++ = (unsigned char)contentType;
+            *position++ = (unsigned char)IoTHubMessage_GetPriority(message);
+            position = put_journal_uint64(position, (uint64_t)(int64_t)IoTHubMessage_GetExpiryTime(message));
+            position = put_journal_bytes(position, content, contentSize);
+            position = put_journal_string(position, messageId);
+            position = put_journal_string(position, correlationId);
+            position = put_journal_uint32(position, propertyCount);
+            for (index = 0; index < propertyCount; index++)
+            {
+                position = put_journal_string(position, keys[index]);
+                position = put_journal_string(position, values[index]);
+            }
+            *size = recordSize;
+            result = handleData->journalRecord;
+        }
+    }
+    return result;
+}
+
+static const unsigned char* get_journal_bytes(const unsigned char* position, const unsigned char* end, const unsigned char** bytes, size_t* size)
+{
+    const unsigned char* result;
+    if ((position == NULL) || ((size_t)(end - position) < sizeof(uint32_t)))
+    {
+        result = NULL;
+    }
+    else
+    {
+        *size = (size_t)position[0] | ((size_t)position[1] << 8) | ((size_t)position[2] << 16) | ((size_t)position[3] << 24);
+        position += sizeof(uint32_t);
+        if ((size_t)(end - position) < *size)
+        {
+            result = NULL;
+        }
+        else
+        {
+            *bytes = position;
+            result = position + *size;
+        }
+    }
+    return result;
+}
+
+static const unsigned char* get_journal_string(const unsigned char* position, const unsigned char* end, const char** value)
+{
+    const unsigned char* bytes;
+    size_t size;
+    const unsigned char* result = get_journal_bytes(position, end, &bytes, &size);
+    if (result != NULL)
+    {
+        if (size == 0)
+        {
+            *value = NULL;
+        }
+        else if (bytes[size - 1] != '\0')
+        {
+            result = NULL;
+        }
+        else
+        {
+            *value = (const char*)bytes;
+        }
+    }
+    return result;
+}
+
+/*rebuilds a message laid out by serialize_message*/
+static IOTHUB_MESSAGE_HANDLE deserialize_message(const unsigned char* record, size_t size)
+{
+    IOTHUB_MESSAGE_HANDLE result;
+    const unsigned char* end = record + size;
+    const unsigned char* position;
+    time_t expiryTime = (time_t)0;
+    const unsigned char* content = NULL;
+    size_t contentSize = 0;
+    const char* messageId = NULL;
+    const char* correlationId = NULL;
+    const unsigned char* propertyCountBytes = NULL;
+    size_t propertyCount = 0;
+
+    if ((size >= JOURNAL_RECORD_HEADER_SIZE) && (record[0] == JOURNAL_RECORD_VERSION))
+    {
+        uint64_t value = 0;
+        size_t index;
+        for (index = 0; index < sizeof(uint64_t); index++)
+        {
+            value |= (uint64_t)record[JOURNAL_RECORD_VERSION_1_HEADER_SIZE + index] << (8 * index);
+        }
+        expiryTime = (time_t)(int64_t)value;
+        position = record + JOURNAL_RECORD_HEADER_SIZE;
+    }
+    else if ((size >= JOURNAL_RECORD_VERSION_1_HEADER_SIZE) && (record[0] == JOURNAL_RECORD_VERSION_1))
+    {
+        /*journals written before the expiry time was kept are still replayed*/
+        position = record + JOURNAL_RECORD_VERSION_1_HEADER_SIZE;
+    }
+    else
+    {
+        position = NULL;
+    }
+    position = get_journal_bytes(position, end, &content, &contentSize);
+    position = get_journal_string(position, end, &messageId);
+    position = get_journal_string(position, end, &correlationId);
+    if ((position != NULL) && ((size_t)(end - position) >= sizeof(uint32_t)))
+    {
+        propertyCountBytes = position;
+        propertyCount = (size_t)position[0] | ((size_t)position[1] << 8) | ((size_t)position[2] << 16) | ((size_t)position[3] << 24);
+        position += sizeof(uint32_t);
+    }
+
+    if ((position == NULL) || (propertyCountBytes == NULL))
+    {
+        LogError("malformed journal record");
+        result = NULL;
+    }
+    else if ((result = (record[1] == IOTHUBMESSAGE_STRING) ?
+        (((contentSize > 0) && (content[contentSize - 1] == '\0')) ? IoTHubMessage_CreateFromString((const char*)content) : NULL) :
+        IoTHubMessage_CreateFromByteArray(content, contentSize)) == NULL)
+    {
+        LogError("unable to create the message of a journal record");
+    }
+    else if (((messageId != NULL) && (IoTHubMessage_SetMessageId(result, messageId) != IOTHUB_MESSAGE_OK)) ||
+        ((correlationId != NULL) && (IoTHubMessage_SetCorrelationId(result, correlationId) != IOTHUB_MESSAGE_OK)) ||
+        (IoTHubMessage_SetPriority(result, (IOTHUB_MESSAGE_PRIORITY)record[2]) != IOTHUB_MESSAGE_OK) ||
+        ((expiryTime != (time_t)0) && (IoTHubMessage_SetExpiryTime(result, expiryTime) != IOTHUB_MESSAGE_OK)))
+    {
+        LogError("unable to set the ids, priority and expiry time of the message of a journal record");
+        IoTHubMessage_Destroy(result);
+        result = NULL;
+    }
+    else
+    {
+        MAP_HANDLE properties = IoTHubMessage_Properties(result);
+        size_t index;
+        for (index = 0; index < propertyCount; index++)
+        {
+            const char* key = NULL;
+            const char* value = NULL;
+            position = get_journal_string(position, end, &key);
+            position = get_journal_string(position, end, &value);
+            if ((position == NULL) || (key == NULL) || (value == NULL) ||
+                (Map_AddOrUpdate(properties, key, value) != MAP_OK))
+            {
+                LogError("unable to set the properties of the message of a journal record");
+                break;
+            }
+        }
+
+        if (index < propertyCount)
+        {
+            IoTHubMessage_Destroy(result);
+            result = NULL;
+        }
+    }
+    return result;
+}
+#endif /*DONT_USE_JOURNAL*/
+
+/*sets journalSequence to the sequence of message in the journal, or to 0 when there is no journal*/
+static int append_message_to_journal(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, IOTHUB_MESSAGE_HANDLE message, uint64_t* journalSequence)
+{
+    int result;
+    *journalSequence = 0;
+#ifndef DONT_USE_JOURNAL
+    if (handleData->journal != NULL)
+    {
+        const unsigned char* record;
+        size_t size;
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_049: [ When a journal is set, IoTHubClient_LL_SendEventAsync, IoTHubClient_LL_SendEventAsync_Move and IoTHubClient_LL_SendEventBatchAsync shall append the content, message id, correlation id, priority, expiry time and properties of every message to the journal before queueing it. ]*/
+        if (((record = serialize_message(handleData, message, &size)) == NULL) ||
+            (journal_append(handleData->journal, record, size, journalSequence) != 0))
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_050: [ If appending a message to the journal fails, the message shall not be queued and the call shall fail with IOTHUB_CLIENT_ERROR. ]*/
+            LogError("unable to append the message to the journal");
+            result = __FAILURE__;
+        }
+        else
+        {
+            result = 0;
+        }
+    }
+    else
+#else
+    (void)handleData;
+    (void)message;
+#endif
+    {
+        result = 0;
+    }
+    return result;
+}
+
+/*Codes_SRS_IOTHUBCLIENT_LL_31_052: [ A journaled message shall be confirmed in the journal once it is completed, times out, is dropped or cannot be queued. ]*/
+static void confirm_journaled_message(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, IOTHUB_MESSAGE_LIST* record)
+{
+#ifndef DONT_USE_JOURNAL
+    if ((handleData->journal != NULL) && (record->journalSequence != 0) &&
+        (journal_confirm(handleData->journal, record->journalSequence) != 0))
+    {
+        LogError("unable to confirm a message in the journal, it will be sent again after a restart");
+    }
+#else
+    (void)handleData;
+    (void)record;
+#endif
+}
+
+/*Codes_SRS_IOTHUBCLIENT_LL_31_039: [ The callbacks of the dropped messages shall be called with IOTHUB_CLIENT_CONFIRMATION_DROPPED. ]*/
+static void complete_dropped_messages(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, PDLIST_ENTRY dropped)
+{
+    PDLIST_ENTRY oldest;
+    while ((oldest = DList_RemoveHeadList(dropped)) != dropped)
+    {
+        IOTHUB_MESSAGE_LIST* record = containingRecord(oldest, IOTHUB_MESSAGE_LIST, entry);
+        if (record->callback != NULL)
+        {
+            record->callback(IOTHUB_CLIENT_CONFIRMATION_DROPPED, record->context);
+        }
+        count_completed_message(handleData, record, IOTHUB_CLIENT_CONFIRMATION_DROPPED);
+        confirm_journaled_message(handleData, record);
+        IoTHubMessage_Destroy(record->messageHandle);
+        object_pool_free(handleData->messagePool, record);
+    }
+}
+
+/*puts back in waitingToSend the messages make_room_in_outbound_queue dropped for messages that could not be queued after all.
+The victims were taken from the head of their lane, oldest first, so putting them back newest first at the head of their lane restores waitingToSend.
+A message that cannot be added back to the timeout queue stays in dropped*/
+static void restore_dropped_messages(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, PDLIST_ENTRY dropped)
+{
+    PDLIST_ENTRY current = dropped->Blink;
+    while (current != dropped)
+    {
+        IOTHUB_MESSAGE_LIST* record = containingRecord(current, IOTHUB_MESSAGE_LIST, entry);
+        PDLIST_ENTRY previous = current->Blink;
+        if ((record->ms_timesOutAfter == 0) || (timeout_queue_add(handleData->messageTimeouts, &record->timeout_entry, record->ms_timesOutAfter) == 0))
+        {
+            PDLIST_ENTRY next = handleData->waitingToSend.Flink;
+            while ((next != &(handleData->waitingToSend)) && (containingRecord(next, IOTHUB_MESSAGE_LIST, entry)->priority > record->priority))
+            {
+                next = next->Flink;
+            }
+            (void)DList_RemoveEntryList(current);
+            /*inserting at the tail of the list headed by next inserts before next*/
+            DList_InsertTailList(next, current);
+            handleData->outboundMessageCount++;
+            handleData->outboundByteCount += record->messageSize;
+        }
+        else
+        {
+            LogError("unable to add a dropped message back to the timeout queue");
+        }
+        current = previous;
+    }
+}
+
+/*waitingToSend is made of one lane per priority, the highest first. Messages are usually queued with the priority of the last lane, so the lane of a record is searched from the tail*/
+static void insert_message_record(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, IOTHUB_MESSAGE_LIST* record)
+{
+    PDLIST_ENTRY previous = handleData->waitingToSend.Blink;
+    /*Codes_SRS_IOTHUBCLIENT_LL_31_062: [ IoTHubClient_LL_SendEventAsync shall insert the record in waitingToSend after the messages of the same or a higher priority and before the messages of a lower priority, so that the transports, which take the messages from the head of waitingToSend, send the messages of a higher priority first and the messages of a priority in the order they were queued. ]*/
+    while ((previous != &(handleData->waitingToSend)) && (containingRecord(previous, IOTHUB_MESSAGE_LIST, entry)->priority < record->priority))
+    {
+        previous = previous->Blink;
+    }
+
+    if (previous == handleData->waitingToSend.Blink)
+    {
+        DList_InsertTailList(&(handleData->waitingToSend), &(record->entry));
+    }
+    else
+    {
+        DList_InsertHeadList(previous, &(record->entry));
+    }
+}
+
+/*returns a copy of message holding content instead of the content of message, with the same ids, priority, expiry time and properties plus the content encoding*/
+static IOTHUB_MESSAGE_HANDLE create_compressed_message(IOTHUB_MESSAGE_HANDLE message, const unsigned char* content, size_t size, const char* contentEncoding)
+{
+    IOTHUB_MESSAGE_HANDLE result;
+    const char* messageId = IoTHubMessage_GetMessageId(message);
+    const char* correlationId = IoTHubMessage_GetCorrelationId(message);
+    const char* const* keys;
+    const char* const* values;
+    size_t propertyCount;
+
+    if (Map_GetInternals(IoTHubMessage_ReadOnlyProperties(message), &keys, &values, &propertyCount) != MAP_OK)
+    {
+        LogError("unable to get the properties of the message");
+        result = NULL;
+    }
+    else if ((result = IoTHubMessage_CreateFromByteArray(content, size)) == NULL)
+    {
+        LogError("unable to create the compressed message");
+    }
+    else if (((messageId != NULL) && (IoTHubMessage_SetMessageId(result, messageId) != IOTHUB_MESSAGE_OK)) ||
+        ((correlationId != NULL) && (IoTHubMessage_SetCorrelationId(result, correlationId) != IOTHUB_MESSAGE_OK)) ||
+        (IoTHubMessage_SetPriority(result, IoTHubMessage_GetPriority(message)) != IOTHUB_MESSAGE_OK) ||
+        (IoTHubMessage_SetExpiryTime(result, IoTHubMessage_GetExpiryTime(message)) != IOTHUB_MESSAGE_OK))
+    {
+        LogError("unable to set the ids, priority and expiry time of the compressed message");
+        IoTHubMessage_Destroy(result);
+        result = NULL;
+    }
+    else
+    {
+        MAP_HANDLE properties = IoTHubMessage_Properties(result);
+        size_t index;
+        for (index = 0; index < propertyCount; index++)
+        {
+            if (Map_AddOrUpdate(properties, keys[index], values[index]) != MAP_OK)
+            {
+                break;
+            }
+        }
+
+        if ((index < propertyCount) ||
+            (Map_AddOrUpdate(properties, IOTHUB_CLIENT_CONTENT_ENCODING_PROPERTY, contentEncoding) != MAP_OK))
+        {
+            LogError("unable to set the properties of the compressed message");
+            IoTHubMessage_Destroy(result);
+            result = NULL;
+        }
+    }
+    return result;
+}
+
+/*returns a compressed copy of message, or NULL when message has to be sent as is*/
+static IOTHUB_MESSAGE_HANDLE compress_message(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, IOTHUB_MESSAGE_HANDLE message)
+{
+    IOTHUB_MESSAGE_HANDLE result = NULL;
+    if (handleData->compressionCodec != NULL)
+    {
+        const unsigned char* content;
+        size_t size;
+        bool isEncoded;
+
+        if (IoTHubMessage_GetContentType(message) == IOTHUBMESSAGE_BYTEARRAY)
+        {
+            if (IoTHubMessage_GetByteArray(message, &content, &size) != IOTHUB_MESSAGE_OK)
+            {
+                size = 0;
+            }
+        }
+        else
+        {
+            content = (const unsigned char*)IoTHubMessage_GetString(message);
+            size = (content == NULL) ? 0 : strlen((const char*)content);
+        }
+
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_068: [ An event shall be queued as is when its content is smaller than "compression_min_size" or empty, when it already has a "content-encoding" property or when the codec fails or does not make its content smaller. ]*/
+        if ((size == 0) || (size < handleData->compressionMinSize) ||
+            (Map_ContainsKey(IoTHubMessage_ReadOnlyProperties(message), IOTHUB_CLIENT_CONTENT_ENCODING_PROPERTY, &isEncoded) != MAP_OK) || isEncoded)
+        {
+            /*sent as is*/
+        }
+        else
+        {
+            size_t compressedSize = size - 1;
+            if (compressedSize > handleData->compressionBufferCapacity)
+            {
+                unsigned char* newBuffer = (unsigned char*)realloc(handleData->compressionBuffer, compressedSize);
+                if (newBuffer != NULL)
+                {
+                    handleData->compressionBuffer = newBuffer;
+                    handleData->compressionBufferCapacity = compressedSize;
+                }
+            }
+
+            if (compressedSize > handleData->compressionBufferCapacity)
+            {
+                LogError("unable to allocate the compression buffer, the message is sent uncompressed");
+            }
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_067: [ When a codec is set, IoTHubClient_LL_SendEventAsync, IoTHubClient_LL_SendEventAsync_Move and IoTHubClient_LL_SendEventBatchAsync shall queue, instead of the message, a copy of it whose content is compressed by the codec, with the same ids, priority, expiry time and properties plus a "content-encoding" property holding the content encoding of the codec. ]*/
+            else if ((handleData->compressionCodec->compress(content, size, handleData->compressionBuffer, &compressedSize) == 0) &&
+                (compressedSize < size))
+            {
+                /*Codes_SRS_IOTHUBCLIENT_LL_31_069: [ If creating the compressed copy fails, the event shall be queued as is. ]*/
+                result = create_compressed_message(message, handleData->compressionBuffer, compressedSize, handleData->compressionCodec->contentEncoding);
+            }
+        }
+    }
+    return result;
+}
+
+/*queues newEntry (whose ms_timesOutAfter and journalSequence are set) in waitingToSend, or at the tail of batch when batch is not NULL.
+When takeOwnership is true the message itself is queued instead of a clone. newEntry is released on failure*/
+static IOTHUB_CLIENT_RESULT queue_message_record(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, IOTHUB_MESSAGE_LIST* newEntry, IOTHUB_MESSAGE_HANDLE eventMessageHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK eventConfirmationCallback, void* userContextCallback, bool takeOwnership, PDLIST_ENTRY batch)
+{
+    IOTHUB_CLIENT_RESULT result;
+    IOTHUB_MESSAGE_HANDLE compressedMessage = compress_message(handleData, eventMessageHandle);
+    TIMEOUT_QUEUE_ENTRY_INIT(&newEntry->timeout_entry);
+    /*Codes_SRS_IOTHUBCLIENT_LL_02_013: [IoTHubClient_LL_SendEventAsync shall add the DLIST waitingToSend a new record cloning the information from eventMessageHandle, eventConfirmationCallback, userContextCallback.]*/
+    /*Codes_SRS_IOTHUBCLIENT_LL_31_013: [ IoTHubClient_LL_SendEventAsync_Move shall add to the DLIST waitingToSend a new record holding eventMessageHandle itself, without cloning it. ]*/
+    if ((newEntry->messageHandle = (compressedMessage != NULL) ? compressedMessage : (takeOwnership ? eventMessageHandle : IoTHubMessage_Clone(eventMessageHandle))) == NULL)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_LL_02_014: [If cloning and/or adding the information fails for any reason, IoTHubClient_LL_SendEventAsync shall fail and return IOTHUB_CLIENT_ERROR.] */
+        result = IOTHUB_CLIENT_ERROR;
+        confirm_journaled_message(handleData, newEntry);
+        object_pool_free(handleData->messagePool, newEntry);
+        LOG_ERROR_RESULT;
+    }
+    /*Codes_SRS_IOTHUBCLIENT_LL_31_010: [ If the message has a timeout, IoTHubClient_LL_SendEventAsync shall add it to the timeout queue. ]*/
+    else if ((newEntry->ms_timesOutAfter != 0) && (timeout_queue_add(handleData->messageTimeouts, &newEntry->timeout_entry, newEntry->ms_timesOutAfter) != 0))
+    {
+        /*Codes_SRS_IOTHUBCLIENT_LL_02_014: [If cloning and/or adding the information fails for any reason, IoTHubClient_LL_SendEventAsync shall fail and return IOTHUB_CLIENT_ERROR.] */
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_014: [ If adding the record fails, IoTHubClient_LL_SendEventAsync_Move shall return IOTHUB_CLIENT_ERROR and the caller keeps ownership of eventMessageHandle. ]*/
+        result = IOTHUB_CLIENT_ERROR;
+        if (!takeOwnership || (compressedMessage != NULL))
+        {
+            IoTHubMessage_Destroy(newEntry->messageHandle);
+        }
+        confirm_journaled_message(handleData, newEntry);
+        object_pool_free(handleData->messagePool, newEntry);
+        LOG_ERROR_RESULT;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBCLIENT_LL_02_013: [IoTHubClient_LL_SendEventAsync shall add the DLIST waitingToSend a new record cloning the information from eventMessageHandle, eventConfirmationCallback, userContextCallback.]*/
+        newEntry->callback = eventConfirmationCallback;
+        newEntry->context = userContextCallback;
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_044: [ A message shall count against the limits of the outbound queue from the time it is queued until it is completed, times out or is dropped, whether or not the transport took it from waitingToSend. ]*/
+        newEntry->messageSize = is_message_size_kept(handleData) ? get_message_size(eventMessageHandle) : 0;
+        handleData->outboundMessageCount++;
+        handleData->outboundByteCount += newEntry->messageSize;
+        newEntry->ms_queued = handleData->lastDoWorkTick;
+        newEntry->ms_sent = UNKNOWN_TICK;
+        if ((handleData->lingerMs != 0) && (handleData->lingerStartTick == UNKNOWN_TICK))
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_086: [ The linger of the messages shall start at the last call to IoTHubClient_LL_DoWork before the first of them was queued, and end once the transport has drained waitingToSend. ]*/
+            handleData->lingerStartTick = handleData->lastDoWorkTick;
+        }
+        handleData->statistics.events_queued++;
+        newEntry->priority = IoTHubMessage_GetPriority(eventMessageHandle);
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_071: [ IoTHubClient_LL_SendEventAsync, IoTHubClient_LL_SendEventAsync_Move and IoTHubClient_LL_SendEventBatchAsync shall keep in the record of a message the expiry time of the message. ]*/
+        newEntry->expiryTime = IoTHubMessage_GetExpiryTime(eventMessageHandle);
+        if (batch != NULL)
+        {
+            DList_InsertTailList(batch, &(newEntry->entry));
+        }
+        else
+        {
+            insert_message_record(handleData, newEntry);
+        }
+
+        if (takeOwnership && (compressedMessage != NULL))
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_070: [ Once the compressed copy of a message given to IoTHubClient_LL_SendEventAsync_Move is queued, the message shall be destroyed. ]*/
+            IoTHubMessage_Destroy(eventMessageHandle);
+        }
+        result = IOTHUB_CLIENT_OK;
+    }
+    return result;
+}
+
+/*queues the message in waitingToSend, when takeOwnership is true the message itself is queued instead of a clone*/
+static IOTHUB_CLIENT_RESULT send_event_async(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, IOTHUB_MESSAGE_HANDLE eventMessageHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK eventConfirmationCallback, void* userContextCallback, bool takeOwnership)
+{
+    IOTHUB_CLIENT_RESULT result;
+    DLIST_ENTRY dropped;
+    bool isOutboundQueueBounded = is_outbound_queue_bounded(handleData);
+    if (isOutboundQueueBounded && !make_room_in_outbound_queue(handleData, &eventMessageHandle, 1, &dropped))
+    {
+        result = IOTHUB_CLIENT_QUEUE_FULL;
+        LOG_ERROR_RESULT;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_017: [ When a message pool is set, IoTHubClient_LL_SendEventAsync shall take the record added to waitingToSend from the pool, falling back to malloc when the pool is exhausted. ]*/
+        IOTHUB_MESSAGE_LIST *newEntry = (IOTHUB_MESSAGE_LIST*)object_pool_alloc(handleData->messagePool, sizeof(IOTHUB_MESSAGE_LIST));
+        if (newEntry == NULL)
+        {
+            result = IOTHUB_CLIENT_ERROR;
+            LOG_ERROR_RESULT;
+        }
+        else if (get_ms_timesOutAfter(handleData, &newEntry->ms_timesOutAfter) != 0)
+        {
+            result = IOTHUB_CLIENT_ERROR;
+            LOG_ERROR_RESULT;
+            object_pool_free(handleData->messagePool, newEntry);
+        }
+        else if (append_message_to_journal(handleData, eventMessageHandle, &newEntry->journalSequence) != 0)
+        {
+            result = IOTHUB_CLIENT_ERROR;
+            LOG_ERROR_RESULT;
+            object_pool_free(handleData->messagePool, newEntry);
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_02_015: [Otherwise IoTHubClient_LL_SendEventAsync shall succeed and return IOTHUB_CLIENT_OK.] */
+            result = queue_message_record(handleData, newEntry, eventMessageHandle, eventConfirmationCallback, userContextCallback, takeOwnership, NULL);
+        }
+
+        if (isOutboundQueueBounded)
+        {
+            if (result != IOTHUB_CLIENT_OK)
+            {
+                /*Codes_SRS_IOTHUBCLIENT_LL_31_093: [ If queueing the new messages fails after messages were dropped to make room for them, the dropped messages shall be put back in waitingToSend where they were and their callbacks shall not be called. ]*/
+                restore_dropped_messages(handleData, &dropped);
+            }
+            complete_dropped_messages(handleData, &dropped);
+            update_outbound_queue_water_marks(handleData);
+        }
+    }
+    return result;
+}
+
+/*releases the records of batch without calling their callbacks*/
+static void unqueue_message_records(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, PDLIST_ENTRY batch)
+{
+    PDLIST_ENTRY entry;
+    while ((entry = DList_RemoveHeadList(batch)) != batch)
+    {
+        IOTHUB_MESSAGE_LIST* record = containingRecord(entry, IOTHUB_MESSAGE_LIST, entry);
+        timeout_queue_remove(&record->timeout_entry);
+        release_outbound_queue_space(handleData, record);
+        handleData->statistics.events_queued--;
+        confirm_journaled_message(handleData, record);
+        IoTHubMessage_Destroy(record->messageHandle);
+        object_pool_free(handleData->messagePool, record);
+    }
+}
+
+IOTHUB_CLIENT_RESULT IoTHubClient_LL_SendEventAsync(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle, IOTHUB_MESSAGE_HANDLE eventMessageHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK eventConfirmationCallback, void* userContextCallback)
+{
+    IOTHUB_CLIENT_RESULT result;
+    /*Codes_SRS_IOTHUBCLIENT_LL_02_011: [IoTHubClient_LL_SendEventAsync shall fail and return IOTHUB_CLIENT_INVALID_ARG if parameter iotHubClientHandle or eventMessageHandle is NULL.]*/
+    if (
+        (iotHubClientHandle == NULL) ||
+        (eventMessageHandle == NULL) ||
+        /*Codes_SRS_IOTHUBCLIENT_LL_02_012: [IoTHubClient_LL_SendEventAsync shall fail and return IOTHUB_CLIENT_INVALID_ARG if parameter eventConfirmationCallback is NULL and userContextCallback is not NULL.] */
+        ((eventConfirmationCallback == NULL) && (userContextCallback != NULL))
+        )
+    {
+        result = IOTHUB_CLIENT_INVALID_ARG;
+        LOG_ERROR_RESULT;
+    }
+    else
+    {
+        result = send_event_async((IOTHUB_CLIENT_LL_HANDLE_DATA*)iotHubClientHandle, eventMessageHandle, eventConfirmationCallback, userContextCallback, false);
+    }
+    return result;
+}
+
+IOTHUB_CLIENT_RESULT IoTHubClient_LL_SendEventAsync_Move(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle, IOTHUB_MESSAGE_HANDLE eventMessageHandle, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK eventConfirmationCallback, void* userContextCallback)
+{
+    IOTHUB_CLIENT_RESULT result;
+    /*Codes_SRS_IOTHUBCLIENT_LL_31_012: [ IoTHubClient_LL_SendEventAsync_Move shall fail and return IOTHUB_CLIENT_INVALID_ARG if iotHubClientHandle or eventMessageHandle is NULL, or if eventConfirmationCallback is NULL and userContextCallback is not NULL. ]*/
+    if (
+        (iotHubClientHandle == NULL) ||
+        (eventMessageHandle == NULL) ||
+        ((eventConfirmationCallback == NULL) && (userContextCallback != NULL))
+        )
+    {
+        result = IOTHUB_CLIENT_INVALID_ARG;
+        LOG_ERROR_RESULT;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_015: [ Otherwise IoTHubClient_LL_SendEventAsync_Move shall return IOTHUB_CLIENT_OK and the message shall be destroyed by IoTHubClient_LL once it is completed, the same way a clone made by IoTHubClient_LL_SendEventAsync is. ]*/
+        result = send_event_async((IOTHUB_CLIENT_LL_HANDLE_DATA*)iotHubClientHandle, eventMessageHandle, eventConfirmationCallback, userContextCallback, true);
+    }
+    return result;
+}
+
+IOTHUB_CLIENT_RESULT IoTHubClient_LL_SendEventBatchAsync(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle, const IOTHUB_MESSAGE_HANDLE* eventMessageHandles, size_t messageCount, IOTHUB_CLIENT_EVENT_CONFIRMATION_CALLBACK eventConfirmationCallback, void* userContextCallback)
+{
+    IOTHUB_CLIENT_RESULT result;
+    /*Codes_SRS_IOTHUBCLIENT_LL_31_025: [ IoTHubClient_LL_SendEventBatchAsync shall fail and return IOTHUB_CLIENT_INVALID_ARG if iotHubClientHandle or eventMessageHandles is NULL, if messageCount is 0, or if eventConfirmationCallback is NULL and userContextCallback is not NULL. ]*/
+    if (
+        (iotHubClientHandle == NULL) ||
+        (eventMessageHandles == NULL) ||
+        (messageCount == 0) ||
+        ((eventConfirmationCallback == NULL) && (userContextCallback != NULL))
+        )
+    {
+        result = IOTHUB_CLIENT_INVALID_ARG;
+        LOG_ERROR_RESULT;
+    }
+    else
+    {
+        IOTHUB_CLIENT_LL_HANDLE_DATA* handleData = (IOTHUB_CLIENT_LL_HANDLE_DATA*)iotHubClientHandle;
+        tickcounter_ms_t ms_timesOutAfter;
+        DLIST_ENTRY dropped;
+        DLIST_ENTRY batch;
+        bool isOutboundQueueBounded = is_outbound_queue_bounded(handleData);
+        size_t index;
+
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_026: [ If any of the messageCount handles in eventMessageHandles is NULL, IoTHubClient_LL_SendEventBatchAsync shall fail and return IOTHUB_CLIENT_INVALID_ARG without queueing any message. ]*/
+        for (index = 0; index < messageCount; index++)
+        {
+            if (eventMessageHandles[index] == NULL)
+            {
+                break;
+            }
+        }
+
+        if (index < messageCount)
+        {
+            result = IOTHUB_CLIENT_INVALID_ARG;
+            LogError("eventMessageHandles[%lu] is NULL", (unsigned long)index);
+        }
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_027: [ IoTHubClient_LL_SendEventBatchAsync shall read the current time only once and give all the messages of the batch the same timeout. ]*/
+        else if (get_ms_timesOutAfter(handleData, &ms_timesOutAfter) != 0)
+        {
+            result = IOTHUB_CLIENT_ERROR;
+            LOG_ERROR_RESULT;
+        }
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_045: [ IoTHubClient_LL_SendEventBatchAsync shall make room in the outbound queue for the whole batch before queueing any of its messages, and return IOTHUB_CLIENT_QUEUE_FULL when the batch does not fit. ]*/
+        else if (isOutboundQueueBounded && !make_room_in_outbound_queue(handleData, eventMessageHandles, messageCount, &dropped))
+        {
+            result = IOTHUB_CLIENT_QUEUE_FULL;
+            LOG_ERROR_RESULT;
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_028: [ IoTHubClient_LL_SendEventBatchAsync shall add to the DLIST waitingToSend, in the order of eventMessageHandles, one record per message cloning the message and holding eventConfirmationCallback and userContextCallback, the same way IoTHubClient_LL_SendEventAsync does. ]*/
+            result = IOTHUB_CLIENT_OK;
+            DList_InitializeListHead(&batch);
+            for (index = 0; (index < messageCount) && (result == IOTHUB_CLIENT_OK); index++)
+            {
+                IOTHUB_MESSAGE_LIST *newEntry = (IOTHUB_MESSAGE_LIST*)object_pool_alloc(handleData->messagePool, sizeof(IOTHUB_MESSAGE_LIST));
+                if (newEntry == NULL)
+                {
+                    result = IOTHUB_CLIENT_ERROR;
+                    LOG_ERROR_RESULT;
+                }
+                else if (append_message_to_journal(handleData, eventMessageHandles[index], &newEntry->journalSequence) != 0)
+                {
+                    result = IOTHUB_CLIENT_ERROR;
+                    LOG_ERROR_RESULT;
+                    object_pool_free(handleData->messagePool, newEntry);
+                }
+                else
+                {
+                    newEntry->ms_timesOutAfter = ms_timesOutAfter;
+                    result = queue_message_record(handleData, newEntry, eventMessageHandles[index], eventConfirmationCallback, userContextCallback, false, &batch);
+                }
+            }
+
+            if (result != IOTHUB_CLIENT_OK)
+            {
+                /*Codes_SRS_IOTHUBCLIENT_LL_31_029: [ If queueing any of the messages fails, IoTHubClient_LL_SendEventBatchAsync shall remove the messages of the batch it already queued, without calling their callbacks, and return IOTHUB_CLIENT_ERROR. ]*/
+                unqueue_message_records(handleData, &batch);
+                if (isOutboundQueueBounded)
+                {
+                    /*Codes_SRS_IOTHUBCLIENT_LL_31_093: [ If queueing the new messages fails after messages were dropped to make room for them, the dropped messages shall be put back in waitingToSend where they were and their callbacks shall not be called. ]*/
+                    restore_dropped_messages(handleData, &dropped);
+                }
+                result = IOTHUB_CLIENT_ERROR;
+            }
+            else
+            {
+                /*Codes_SRS_IOTHUBCLIENT_LL_31_063: [ IoTHubClient_LL_SendEventBatchAsync shall insert the records of the batch in waitingToSend, in the order of eventMessageHandles and each at the place of its priority, once all of them were created. ]*/
+                PDLIST_ENTRY entry;
+                while ((entry = DList_RemoveHeadList(&batch)) != &batch)
+                {
+                    insert_message_record(handleData, containingRecord(entry, IOTHUB_MESSAGE_LIST, entry));
+                }
+            }
+
+            if (isOutboundQueueBounded)
+            {
+                complete_dropped_messages(handleData, &dropped);
+                update_outbound_queue_water_marks(handleData);
+            }
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_030: [ Otherwise IoTHubClient_LL_SendEventBatchAsync shall return IOTHUB_CLIENT_OK, eventConfirmationCallback is then called once for every message of the batch. ]*/
+        }
+    }
+    return result;
+}
+
+IOTHUB_CLIENT_RESULT IoTHubClient_LL_SetMessageCallback(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle, IOTHUB_CLIENT_MESSAGE_CALLBACK_ASYNC messageCallback, void* userContextCallback)
+{
+    IOTHUB_CLIENT_RESULT result;
+    if (iotHubClientHandle == NULL)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_LL_02_016: [IoTHubClient_LL_SetMessageCallback shall fail and return IOTHUB_CLIENT_INVALID_ARG if parameter iotHubClientHandle is NULL.] */
+        LogError("Invalid argument - iotHubClientHandle is NULL");
+        result = IOTHUB_CLIENT_INVALID_ARG;
+    }
+    else
+    {
+        IOTHUB_CLIENT_LL_HANDLE_DATA* handleData = (IOTHUB_CLIENT_LL_HANDLE_DATA*)iotHubClientHandle;
+        if (messageCallback == NULL)
+        {
+            if (handleData->messageCallback.type == CALLBACK_TYPE_NONE)
+            {
+                /*Codes_SRS_IOTHUBCLIENT_LL_10_010: [If parameter messageCallback is NULL and the _SetMessageCallback had not been called to subscribe for messages, then IoTHubClient_LL_SetMessageCallback shall fail and return IOTHUB_CLIENT_ERROR.] */
+                LogError("not currently set to accept or process incoming messages.");
+                result = IOTHUB_CLIENT_ERROR;
+            }
+            else if (handleData->messageCallback.type == CALLBACK_TYPE_ASYNC)
+            {
+                /*Codes_SRS_IOTHUBCLIENT_LL_10_010: [If parameter messageCallback is NULL and the _SetMessageCallback had not been called to subscribe for messages, then IoTHubClient_LL_SetMessageCallback shall fail and return IOTHUB_CLIENT_ERROR.] */
+                LogError("Invalid workflow sequence. Please unsubscribe using the IoTHubClient_LL_SetMessageCallback_Ex function.");
+                result = IOTHUB_CLIENT_ERROR;
+            }
+            else
+            {
+                /*Codes_SRS_IOTHUBCLIENT_LL_02_019: [If parameter messageCallback is NULL then IoTHubClient_LL_SetMessageCallback shall call the underlying layer's _Unsubscribe function and return IOTHUB_CLIENT_OK.] */
+                handleData->IoTHubTransport_Unsubscribe(handleData->deviceHandle);
+                handleData->messageCallback.type = CALLBACK_TYPE_NONE;
+                handleData->messageCallback.callbackSync = NULL;
+                handleData->messageCallback.callbackAsync = NULL;
+                handleData->messageCallback.userContextCallback = NULL;
+                result = IOTHUB_CLIENT_OK;
+            }
+        }
+        else
+        {
+            if (handleData->messageCallback.type == CALLBACK_TYPE_ASYNC)
+            {
+                /* Codes_SRS_IOTHUBCLIENT_LL_10_011: [If parameter messageCallback is non-NULL and the _SetMessageCallback_Ex had been used to susbscribe for messages, then IoTHubClient_LL_SetMessageCallback shall fail and return IOTHUB_CLIENT_ERROR.] */
+                LogError("Invalid workflow sequence. Please unsubscribe using the IoTHubClient_LL_SetMessageCallback_Ex function before subscribing with MessageCallback.");
+                result = IOTHUB_CLIENT_ERROR;
+            }
+            else
+            {
+                if (handleData->IoTHubTransport_Subscribe(handleData->deviceHandle) == 0)
+                {
+                    /*Codes_SRS_IOTHUBCLIENT_LL_02_017: [If parameter messageCallback is non-NULL then IoTHubClient_LL_SetMessageCallback shall call the underlying layer's _Subscribe function.]*/
+                    handleData->messageCallback.type = CALLBACK_TYPE_SYNC;
+                    handleData->messageCallback.callbackSync = messageCallback;
+                    handleData->messageCallback.userContextCallback = userContextCallback;
+                    result = IOTHUB_CLIENT_OK;
+                }
+                else
+                {
+                    /*Codes_SRS_IOTHUBCLIENT_LL_02_018: [If the underlying layer's _Subscribe function fails, then IoTHubClient_LL_SetMessageCallback shall fail and return IOTHUB_CLIENT_ERROR. Otherwise IoTHubClient_LL_SetMessageCallback shall succeed and return IOTHUB_CLIENT_OK.]*/
+                    LogError("IoTHubTransport_Subscribe failed");
+                    handleData->messageCallback.type = CALLBACK_TYPE_NONE;
+                    handleData->messageCallback.callbackSync = NULL;
+                    handleData->messageCallback.callbackAsync = NULL;
+                    handleData->messageCallback.userContextCallback = NULL;
+                    result = IOTHUB_CLIENT_ERROR;
+                }
+            }
+        }
+    }
+    return result;
+}
+
+IOTHUB_CLIENT_RESULT IoTHubClient_LL_SetMessageCallback_Ex(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle, IOTHUB_CLIENT_MESSAGE_CALLBACK_ASYNC_EX messageCallback, void* userContextCallback)
+{
+    IOTHUB_CLIENT_RESULT result;
+    if (iotHubClientHandle == NULL)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_LL_10_021: [IoTHubClient_LL_SetMessageCallback_Ex shall fail and return IOTHUB_CLIENT_INVALID_ARG if parameter iotHubClientHandle is NULL.]*/
+        LogError("Invalid argument - iotHubClientHandle is NULL");
+        result = IOTHUB_CLIENT_INVALID_ARG;
+    }
+    else
+    {
+        IOTHUB_CLIENT_LL_HANDLE_DATA* handleData = (IOTHUB_CLIENT_LL_HANDLE_DATA*)iotHubClientHandle;
+        if (messageCallback == NULL)
+        {
+            if (handleData->messageCallback.type == CALLBACK_TYPE_NONE)
+            {
+                /*Codes_SRS_IOTHUBCLIENT_LL_10_018: [If parameter messageCallback is NULL and IoTHubClient_LL_SetMessageCallback_Ex had not been used to subscribe for messages, then IoTHubClient_LL_SetMessageCallback_Ex shall fail and return IOTHUB_CLIENT_ERROR.] */
+                LogError("not currently set to accept or process incoming messages.");
+                result = IOTHUB_CLIENT_ERROR;
+            }
+            else if (handleData->messageCallback.type == CALLBACK_TYPE_SYNC)
+            {
+                /*Codes_SRS_IOTHUBCLIENT_LL_10_019: [If parameter messageCallback is NULL and IoTHubClient_LL_SetMessageCallback had been used to subscribe for messages, then IoTHubClient_LL_SetMessageCallback_Ex shall fail and return IOTHUB_CLIENT_ERROR.] */
+                LogError("Invalid workflow sequence. Please unsubscribe using the IoTHubClient_LL_SetMessageCallback function.");
+                result = IOTHUB_CLIENT_ERROR;
+            }
+            else
+            {
+                /*Codes_SRS_IOTHUBCLIENT_LL_10_023: [If parameter messageCallback is NULL then IoTHubClient_LL_SetMessageCallback_Ex shall call the underlying layer's _Unsubscribe function and return IOTHUB_CLIENT_OK.] */ 
+                handleData->IoTHubTransport_Unsubscribe(handleData->deviceHandle);
+                handleData->messageCallback.type = CALLBACK_TYPE_NONE;
+                handleData->messageCallback.callbackSync = NULL;
+                handleData->messageCallback.callbackAsync = NULL;
+                handleData->messageCallback.userContextCallback = NULL;
+                result = IOTHUB_CLIENT_OK;
+            }
+        }
+        else
+        {
+            if (handleData->messageCallback.type == CALLBACK_TYPE_SYNC)
+            {
+                /*Codes_SRS_IOTHUBCLIENT_LL_10_020: [If parameter messageCallback is non-NULL, and IoTHubClient_LL_SetMessageCallback had been used to subscribe for messages, then IoTHubClient_LL_SetMessageCallback_Ex shall fail and return IOTHUB_CLIENT_ERROR.] */
+                LogError("Invalid workflow sequence. Please unsubscribe using the IoTHubClient_LL_MessageCallbackEx function before subscribing with MessageCallback.");
+                result = IOTHUB_CLIENT_ERROR;
+            }
+            else
+            {
+                if (handleData->IoTHubTransport_Subscribe(handleData->deviceHandle) == 0)
+                {
+                    /*Codes_SRS_IOTHUBCLIENT_LL_10_024: [If parameter messageCallback is non-NULL then IoTHubClient_LL_SetMessageCallback_Ex shall call the underlying layer's _Subscribe function.]*/
+                    handleData->messageCallback.type = CALLBACK_TYPE_ASYNC;
+                    handleData->messageCallback.callbackAsync = messageCallback;
+                    handleData->messageCallback.userContextCallback = userContextCallback;
+                    result = IOTHUB_CLIENT_OK;
+                }
+                else
+                {
+                    /*Codes_SRS_IOTHUBCLIENT_LL_10_025: [If the underlying layer's _Subscribe function fails, then IoTHubClient_LL_SetMessageCallback_Ex shall fail and return IOTHUB_CLIENT_ERROR. Otherwise IoTHubClient_LL_SetMessageCallback_Ex shall succeed and return IOTHUB_CLIENT_OK.] */
+                    LogError("IoTHubTransport_Subscribe failed");
+                    handleData->messageCallback.type = CALLBACK_TYPE_NONE;
+                    handleData->messageCallback.callbackSync = NULL;
+                    handleData->messageCallback.callbackAsync = NULL;
+                    handleData->messageCallback.userContextCallback = NULL;
+                    result = IOTHUB_CLIENT_ERROR;
+                }
+            }
+        }
+    }
+    return result;
+}
+
+IOTHUB_CLIENT_RESULT IoTHubClient_LL_SendMessageDisposition(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle, MESSAGE_CALLBACK_INFO* message_data, IOTHUBMESSAGE_DISPOSITION_RESULT disposition)
+{
+    IOTHUB_CLIENT_RESULT result;
+    if ((iotHubClientHandle == NULL) || (message_data == NULL))
+    {
+        /*Codes_SRS_IOTHUBCLIENT_LL_10_026: [IoTHubClient_LL_SendMessageDisposition shall fail and return IOTHUB_CLIENT_INVALID_ARG if parameter iotHubClientHandle is NULL.]*/
+        LogError("Invalid argument handle=%p, message=%p", iotHubClientHandle, message_data);
+        result = IOTHUB_CLIENT_INVALID_ARG;
+    }
+    else
+    {
+        IOTHUB_CLIENT_LL_HANDLE_DATA* handleData = (IOTHUB_CLIENT_LL_HANDLE_DATA*)iotHubClientHandle;
+        /*Codes_SRS_IOTHUBCLIENT_LL_10_027: [IoTHubClient_LL_SendMessageDisposition shall return the result from calling the underlying layer's _Send_Message_Disposition.]*/
+        result = handleData->IoTHubTransport_SendMessageDisposition(message_data, disposition);
+    }
+    return result;
+}
+
+static void DoTimeouts(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData)
+{
+    tickcounter_ms_t nowTick;
+    if (tickcounter_get_current_ms(handleData->tickCounter, &nowTick) != 0)
+    {
+        LogError("unable to get the current ms, timeouts will not be processed");
+    }
+    else
+    {
+        handleData->lastDoWorkTick = nowTick;
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_011: [ IoTHubClient_LL_DoWork shall only visit the messages that have timed out, in the order of their timeouts. ]*/
+        TIMEOUT_QUEUE_ENTRY* expired;
+        while ((expired = timeout_queue_pop_expired(handleData->messageTimeouts, nowTick)) != NULL)
+        {
+            IOTHUB_MESSAGE_LIST* fullEntry = containingRecord(expired, IOTHUB_MESSAGE_LIST, timeout_entry);
+            /*Codes_SRS_IOTHUBCLIENT_LL_02_041: [ If more than value miliseconds have passed since the call to IoTHubClient_LL_SendEventAsync then the message callback shall be called with a status code of IOTHUB_CLIENT_CONFIRMATION_TIMEOUT. ]*/
+            DList_RemoveEntryList(&(fullEntry->entry));
+            release_outbound_queue_space(handleData, fullEntry);
+            if (fullEntry->callback != NULL)
+            {
+                fullEntry->callback(IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT, fullEntry->context);
+            }
+            count_completed_message(handleData, fullEntry, IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT);
+            confirm_journaled_message(handleData, fullEntry);
+            IoTHubMessage_Destroy(fullEntry->messageHandle); /*because it has been cloned*/
+            object_pool_free(handleData->messagePool, fullEntry);
+        }
+        update_outbound_queue_water_marks(handleData);
+    }
+}
+
+/*moves the records from first to the tail of list to the tail of destination, in O(1)*/
+static void move_list_tail(PDLIST_ENTRY first, PDLIST_ENTRY list, PDLIST_ENTRY destination)
+{
+    if (first != list)
+    {
+        PDLIST_ENTRY last = list->Blink;
+        first->Blink->Flink = list;
+        list->Blink = first->Blink;
+        first->Blink = destination->Blink;
+        destination->Blink->Flink = first;
+        last->Flink = destination;
+        destination->Blink = last;
+    }
+}
+
+/*number of messages the transport may take from waitingToSend without exceeding the congestion window*/
+static size_t get_congestion_window_room(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData)
+{
+    size_t window = congestion_control_get_window(handleData->congestionControl);
+    IOTHUB_CLIENT_STATISTICS transportStatistics;
+    memset(&transportStatistics, 0, sizeof(transportStatistics));
+    if ((handleData->IoTHubTransport_GetStatistics != NULL) && (handleData->IoTHubTransport_GetStatistics(handleData->transportHandle, &transportStatistics) != 0))
+    {
+        LogError("transport failed to provide its statistics, its events in flight are not counted");
+        transportStatistics.in_flight = 0;
+    }
+    return (transportStatistics.in_flight < window) ? (window - transportStatistics.in_flight) : 0;
+}
+
+/*returns true when the messages of waitingToSend hold at least "linger_max_bytes" bytes, the walk stops there*/
+static bool is_linger_batch_full(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData)
+{
+    size_t byteCount = 0;
+    PDLIST_ENTRY entry;
+    for (entry = handleData->waitingToSend.Flink; (entry != &(handleData->waitingToSend)) && (byteCount < handleData->lingerMaxBytes); entry = entry->Flink)
+    {
+        byteCount += containingRecord(entry, IOTHUB_MESSAGE_LIST, entry)->messageSize;
+    }
+    return byteCount >= handleData->lingerMaxBytes;
+}
+
+/*returns true while the messages of waitingToSend are held back so that the transport sends more of them at once*/
+static bool is_lingering(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData)
+{
+    bool result;
+    if ((handleData->lingerMs == 0) || (handleData->lastDoWorkTick == UNKNOWN_TICK) || DList_IsListEmpty(&(handleData->waitingToSend)))
+    {
+        result = false;
+    }
+    else
+    {
+        if (handleData->lingerStartTick == UNKNOWN_TICK)
+        {
+            /*the messages were queued before "linger_ms" was set*/
+            handleData->lingerStartTick = handleData->lastDoWorkTick;
+        }
+
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_087: [ The messages shall stop lingering once "linger_ms" milliseconds have passed since the linger started, or once the messages in waitingToSend hold at least "linger_max_bytes" bytes of content when that option is set. ]*/
+        if (handleData->lastDoWorkTick - handleData->lingerStartTick >= handleData->lingerMs)
+        {
+            result = false;
+        }
+        else if ((handleData->lingerMaxBytes != 0) && is_linger_batch_full(handleData))
+        {
+            result = false;
+        }
+        else
+        {
+            result = true;
+        }
+    }
+    return result;
+}
+
+/*number of messages at the head of waitingToSend the transport may take, UNLIMITED_ROOM when none is held back*/
+static size_t get_transport_room(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, bool lingering)
+{
+    size_t result;
+    if (lingering)
+    {
+        result = 0;
+    }
+    else if (handleData->congestionControl != NULL)
+    {
+        result = get_congestion_window_room(handleData);
+    }
+    else
+    {
+        result = UNLIMITED_ROOM;
+    }
+    return result;
+}
+
+/*moves the records of waitingToSend past the first room ones to hidden, so that the transport does not see them. When stamp is true the records left are sent at the time of this _DoWork*/
+static void hide_messages_beyond(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, size_t room, bool stamp, PDLIST_ENTRY hidden)
+{
+    PDLIST_ENTRY entry = handleData->waitingToSend.Flink;
+    while ((entry != &(handleData->waitingToSend)) && (room > 0))
+    {
+        if (stamp)
+        {
+            containingRecord(entry, IOTHUB_MESSAGE_LIST, entry)->ms_sent = handleData->lastDoWorkTick;
+        }
+        room--;
+        entry = entry->Flink;
+    }
+    DList_InitializeListHead(hidden);
+    move_list_tail(entry, &(handleData->waitingToSend), hidden);
+}
+
+/*puts the hidden records back after those left in waitingToSend. The messages queued meanwhile by the callbacks, unless their priority is higher, go after the hidden ones, which were queued before them*/
+static void restore_hidden_messages(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, PDLIST_ENTRY hidden)
+{
+    if (!DList_IsListEmpty(hidden))
+    {
+        IOTHUB_MESSAGE_PRIORITY hiddenPriority = containingRecord(hidden->Flink, IOTHUB_MESSAGE_LIST, entry)->priority;
+        PDLIST_ENTRY entry = handleData->waitingToSend.Blink;
+        DLIST_ENTRY queuedMeanwhile;
+        while (entry != &(handleData->waitingToSend))
+        {
+            IOTHUB_MESSAGE_LIST* record = containingRecord(entry, IOTHUB_MESSAGE_LIST, entry);
+            if ((record->priority > hiddenPriority) || ((record->priority == hiddenPriority) && (record->ms_sent != UNKNOWN_TICK)))
+            {
+                break;
+            }
+            entry = entry->Blink;
+        }
+
+        DList_InitializeListHead(&queuedMeanwhile);
+        move_list_tail(entry->Flink, &(handleData->waitingToSend), &queuedMeanwhile);
+        move_list_tail(hidden->Flink, hidden, &(handleData->waitingToSend));
+        while ((entry = DList_RemoveHeadList(&queuedMeanwhile)) != &queuedMeanwhile)
+        {
+            insert_message_record(handleData, containingRecord(entry, IOTHUB_MESSAGE_LIST, entry));
+        }
+    }
+}
+
+void IoTHubClient_LL_DoWork(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle)
+{
+    /*Codes_SRS_IOTHUBCLIENT_LL_02_020: [If parameter iotHubClientHandle is NULL then IoTHubClient_LL_DoWork shall not perform any action.] */
+    if (iotHubClientHandle != NULL)
+    {
+        IOTHUB_CLIENT_LL_HANDLE_DATA* handleData = (IOTHUB_CLIENT_LL_HANDLE_DATA*)iotHubClientHandle;
         DoTimeouts(handleData);
 
         /*Codes_SRS_IOTHUBCLIENT_LL_07_008: [ IoTHubClient_LL_DoWork shall iterate the message queue and execute the underlying transports IoTHubTransport_ProcessItem function for each item. ] */
@@ -1136,10 +2326,191 @@ void IoTHubClient_LL_DoWork(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle)
             // Move along to the next item
             client_item = next_item;
         }
+        handleData->is_msg_queue_updated = false;
+
+#ifndef DONT_USE_JOURNAL
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_051: [ When a journal is set, IoTHubClient_LL_DoWork shall commit it once before calling the underlaying layer's _DoWork function, so that all the messages appended since the previous call are made durable by a single write before they are sent. ]*/
+        if ((handleData->journal != NULL) && (journal_commit(handleData->journal) != 0))
+        {
+            LogError("unable to commit the journal");
+        }
+#endif
+
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_085: [ While the messages linger, IoTHubClient_LL_DoWork shall leave none of them in waitingToSend while it invokes the underlaying layer's _DoWork function. ]*/
+        size_t room = get_transport_room(handleData, is_lingering(handleData));
+        if (room == UNLIMITED_ROOM)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_02_021: [Otherwise, IoTHubClient_LL_DoWork shall invoke the underlaying layer's _DoWork function.]*/
+            handleData->IoTHubTransport_DoWork(handleData->transportHandle, iotHubClientHandle);
+        }
+        else
+        {
+            DLIST_ENTRY hidden;
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_078: [ When the congestion control is enabled, IoTHubClient_LL_DoWork shall leave in waitingToSend, while it invokes the underlaying layer's _DoWork function, only as many messages as the congestion window less the events the transport has in flight according to its _GetStatistics function. ]*/
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_079: [ IoTHubClient_LL_DoWork shall keep in the records of the messages it leaves in waitingToSend the time of the call, as the time they are sent. ]*/
+            hide_messages_beyond(handleData, room, true, &hidden);
+            /*Codes_SRS_IOTHUBCLIENT_LL_02_021: [Otherwise, IoTHubClient_LL_DoWork shall invoke the underlaying layer's _DoWork function.]*/
+            handleData->IoTHubTransport_DoWork(handleData->transportHandle, iotHubClientHandle);
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_078: [ When the congestion control is enabled, IoTHubClient_LL_DoWork shall leave in waitingToSend, while it invokes the underlaying layer's _DoWork function, only as many messages as the congestion window less the events the transport has in flight according to its _GetStatistics function. ]*/
+            restore_hidden_messages(handleData, &hidden);
+        }
+
+        if ((handleData->lingerStartTick != UNKNOWN_TICK) && DList_IsListEmpty(&(handleData->waitingToSend)))
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_086: [ The linger of the messages shall start at the last call to IoTHubClient_LL_DoWork before the first of them was queued, and end once the transport has drained waitingToSend. ]*/
+            handleData->lingerStartTick = UNKNOWN_TICK;
+        }
+    }
+}
+
+static tickcounter_ms_t get_next_message_timeout(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, tickcounter_ms_t nowTick)
+{
+    tickcounter_ms_t result;
+    TIMEOUT_QUEUE_ENTRY* earliest = timeout_queue_peek(handleData->messageTimeouts);
+    if (earliest == NULL)
+    {
+        result = IOTHUB_CLIENT_LL_NO_DEADLINE;
+    }
+    else
+    {
+        /*DoTimeouts only expires messages strictly past ms_timesOutAfter*/
+        result = (earliest->expiry < nowTick) ? 0 : (earliest->expiry - nowTick + 1);
+    }
+    return result;
+}
+
+static int get_transport_next_deadline(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, tickcounter_ms_t nowTick, tickcounter_ms_t* transportDeadline)
+{
+    int result;
+    bool lingering = is_lingering(handleData);
+    size_t room = get_transport_room(handleData, lingering);
+    if (room == UNLIMITED_ROOM)
+    {
+        result = handleData->IoTHubTransport_GetNextDeadline(handleData->transportHandle, transportDeadline);
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_080: [ When the congestion control is enabled, IoTHubClient_LL_GetNextDeadline shall leave in waitingToSend, while it calls the transport's _GetNextDeadline function, only the messages IoTHubClient_LL_DoWork would leave, so that a full congestion window does not make the deadline 0. ]*/
+        DLIST_ENTRY hidden;
+        hide_messages_beyond(handleData, room, false, &hidden);
+        result = handleData->IoTHubTransport_GetNextDeadline(handleData->transportHandle, transportDeadline);
+        move_list_tail(hidden.Flink, &hidden, &(handleData->waitingToSend));
+
+        if ((result == 0) && lingering)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_088: [ While the messages linger, IoTHubClient_LL_GetNextDeadline shall hide them from the transport's _GetNextDeadline function the same way, and the deadline shall be at most the end of the linger. ]*/
+            tickcounter_ms_t lingerEnd = handleData->lingerStartTick + handleData->lingerMs;
+            tickcounter_ms_t lingerDeadline = (lingerEnd > nowTick) ? (lingerEnd - nowTick) : 0;
+            if (lingerDeadline < *transportDeadline)
+            {
+                *transportDeadline = lingerDeadline;
+            }
+        }
+    }
+    return result;
+}
+
+IOTHUB_CLIENT_RESULT IoTHubClient_LL_GetNextDeadline(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle, tickcounter_ms_t* msUntilNextDeadline)
+{
+    IOTHUB_CLIENT_RESULT result;
+    tickcounter_ms_t nowTick;
+
+    /*Codes_SRS_IOTHUBCLIENT_LL_31_001: [ If parameter iotHubClientHandle or msUntilNextDeadline is NULL then IoTHubClient_LL_GetNextDeadline shall return IOTHUB_CLIENT_INVALID_ARG. ]*/
+    if (iotHubClientHandle == NULL || msUntilNextDeadline == NULL)
+    {
+        result = IOTHUB_CLIENT_INVALID_ARG;
+        LOG_ERROR_RESULT;
+    }
+    /*Codes_SRS_IOTHUBCLIENT_LL_31_002: [ If getting the current time fails then IoTHubClient_LL_GetNextDeadline shall return IOTHUB_CLIENT_ERROR. ]*/
+    else if (tickcounter_get_current_ms(iotHubClientHandle->tickCounter, &nowTick) != 0)
+    {
+        result = IOTHUB_CLIENT_ERROR;
+        LogError("unable to get the current ms");
+    }
+    else
+    {
+        IOTHUB_CLIENT_LL_HANDLE_DATA* handleData = (IOTHUB_CLIENT_LL_HANDLE_DATA*)iotHubClientHandle;
+        tickcounter_ms_t transportDeadline;
+
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_003: [ IoTHubClient_LL_GetNextDeadline shall call the transport's _GetNextDeadline function. ]*/
+        if (handleData->IoTHubTransport_GetNextDeadline == NULL)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_004: [ If the transport does not provide a _GetNextDeadline function then the deadline shall be 0. ]*/
+            *msUntilNextDeadline = 0;
+            result = IOTHUB_CLIENT_OK;
+        }
+        else if (get_transport_next_deadline(handleData, nowTick, &transportDeadline) != 0)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_005: [ If the transport's _GetNextDeadline fails then IoTHubClient_LL_GetNextDeadline shall return IOTHUB_CLIENT_ERROR. ]*/
+            result = IOTHUB_CLIENT_ERROR;
+            LogError("transport failed to provide the next deadline");
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_006: [ IoTHubClient_LL_GetNextDeadline shall set msUntilNextDeadline to the smallest of the transport deadline and the time left until the earliest message in waitingToSend times out. ]*/
+            tickcounter_ms_t messageDeadline = get_next_message_timeout(handleData, nowTick);
+            *msUntilNextDeadline = (messageDeadline < transportDeadline) ? messageDeadline : transportDeadline;
+
+            if (!DList_IsListEmpty(&(handleData->iot_msg_queue)))
+            {
+                if (handleData->is_msg_queue_updated)
+                {
+                    /*Codes_SRS_IOTHUBCLIENT_LL_31_007: [ If items were queued for the transport since the last call to IoTHubClient_LL_DoWork then msUntilNextDeadline shall be 0. ]*/
+                    *msUntilNextDeadline = 0;
+                }
+                else if (*msUntilNextDeadline > PENDING_ITEM_RETRY_MS)
+                {
+                    /*Codes_SRS_IOTHUBCLIENT_LL_31_008: [ If items the transport could not yet process are queued then msUntilNextDeadline shall be at most 1000 milliseconds. ]*/
+                    *msUntilNextDeadline = PENDING_ITEM_RETRY_MS;
+                }
+            }
+            result = IOTHUB_CLIENT_OK;
+        }
+    }
+    return result;
+}
+
+IOTHUB_CLIENT_RESULT IoTHubClient_LL_GetStatistics(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle, IOTHUB_CLIENT_STATISTICS* statistics)
+{
+    IOTHUB_CLIENT_RESULT result;
+
+    /*Codes_SRS_IOTHUBCLIENT_LL_31_056: [ If parameter iotHubClientHandle or statistics is NULL then IoTHubClient_LL_GetStatistics shall return IOTHUB_CLIENT_INVALID_ARG. ]*/
+    if (iotHubClientHandle == NULL || statistics == NULL)
+    {
+        result = IOTHUB_CLIENT_INVALID_ARG;
+        LOG_ERROR_RESULT;
+    }
+    else
+    {
+        IOTHUB_CLIENT_LL_HANDLE_DATA* handleData = (IOTHUB_CLIENT_LL_HANDLE_DATA*)iotHubClientHandle;
+
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_059: [ IoTHubClient_LL_GetStatistics shall copy the counters of the client to statistics and set queue_depth to the number of messages not completed yet less those the transport has in flight, or 0 if the transport has more in flight. ]*/
+        *statistics = handleData->statistics;
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_083: [ IoTHubClient_LL_GetStatistics shall set congestion_window to the congestion window, or 0 when the congestion control is not enabled. ]*/
+        statistics->congestion_window = congestion_control_get_window(handleData->congestionControl);
+
+        if (handleData->IoTHubTransport_GetStatistics == NULL)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_060: [ IoTHubClient_LL_GetStatistics shall call the transport's _GetStatistics function, if any, to fill in_flight, retries and reconnects, and return IOTHUB_CLIENT_OK. ]*/
+            result = IOTHUB_CLIENT_OK;
+        }
+        else if (handleData->IoTHubTransport_GetStatistics(handleData->transportHandle, statistics) != 0)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_061: [ If the transport's _GetStatistics fails then IoTHubClient_LL_GetStatistics shall return IOTHUB_CLIENT_ERROR. ]*/
+            result = IOTHUB_CLIENT_ERROR;
+            LogError("transport failed to provide its statistics");
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_060: [ IoTHubClient_LL_GetStatistics shall call the transport's _GetStatistics function, if any, to fill in_flight, retries and reconnects, and return IOTHUB_CLIENT_OK. ]*/
+            result = IOTHUB_CLIENT_OK;
+        }
 
-        /*Codes_SRS_IOTHUBCLIENT_LL_02_021: [Otherwise, IoTHubClient_LL_DoWork shall invoke the underlaying layer's _DoWork function.]*/
-        handleData->IoTHubTransport_DoWork(handleData->transportHandle, iotHubClientHandle);
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_059: [ IoTHubClient_LL_GetStatistics shall copy the counters of the client to statistics and set queue_depth to the number of messages not completed yet less those the transport has in flight, or 0 if the transport has more in flight. ]*/
+        /*the messages not completed yet are either in waitingToSend or in flight, this does not walk waitingToSend. A shared transport counts in flight the events of all its devices, hence the 0*/
+        statistics->queue_depth = (handleData->outboundMessageCount > statistics->in_flight) ? (handleData->outboundMessageCount - statistics->in_flight) : 0;
     }
+    return result;
 }
 
 IOTHUB_CLIENT_RESULT IoTHubClient_LL_GetSendStatus(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle, IOTHUB_CLIENT_STATUS *iotHubClientStatus)
@@ -1164,6 +2535,23 @@ IOTHUB_CLIENT_RESULT IoTHubClient_LL_GetSendStatus(IOTHUB_CLIENT_LL_HANDLE iotHu
     return result;
 }
 
+static void count_congestion_feedback(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, IOTHUB_MESSAGE_LIST* record, IOTHUB_CLIENT_CONFIRMATION_RESULT result)
+{
+    if ((handleData->congestionControl != NULL) && (record->ms_sent != UNKNOWN_TICK) && (handleData->lastDoWorkTick >= record->ms_sent))
+    {
+        if (result == IOTHUB_CLIENT_CONFIRMATION_OK)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_081: [ When the congestion control is enabled, IoTHubClient_LL_SendComplete shall give it, for every message completed with IOTHUB_CLIENT_CONFIRMATION_OK, the time from the send of the message to the last call to IoTHubClient_LL_DoWork as the latency of its acknowledgement. ]*/
+            congestion_control_on_ack(handleData->congestionControl, handleData->lastDoWorkTick - record->ms_sent, handleData->lastDoWorkTick);
+        }
+        else if ((result == IOTHUB_CLIENT_CONFIRMATION_ERROR) || (result == IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT))
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_082: [ IoTHubClient_LL_SendComplete shall report the messages completed with IOTHUB_CLIENT_CONFIRMATION_ERROR or IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT as failures to the congestion control, and give it no feedback for the other results. ]*/
+            congestion_control_on_failure(handleData->congestionControl, handleData->lastDoWorkTick);
+        }
+    }
+}
+
 void IoTHubClient_LL_SendComplete(IOTHUB_CLIENT_LL_HANDLE handle, PDLIST_ENTRY completed, IOTHUB_CLIENT_CONFIRMATION_RESULT result)
 {
     /*Codes_SRS_IOTHUBCLIENT_LL_02_022: [If parameter completed is NULL, or parameter handle is NULL then IoTHubClient_LL_SendBatch shall return.]*/
@@ -1179,6 +2567,7 @@ void IoTHubClient_LL_SendComplete(IOTHUB_CLIENT_LL_HANDLE handle, PDLIST_ENTRY c
     {
         /*Codes_SRS_IOTHUBCLIENT_LL_02_027: [If parameter result is IOTHUB_CLIENT_CONFIRMATION_ERROR then IoTHubClient_LL_SendComplete shall call all the non-NULL callbacks with the result parameter set to IOTHUB_CLIENT_CONFIRMATION_ERROR and the context set to the context passed originally in the SendEventAsync call.] */
         /*Codes_SRS_IOTHUBCLIENT_LL_02_025: [If parameter result is IOTHUB_CLIENT_CONFIRMATION_OK then IoTHubClient_LL_SendComplete shall call all the non-NULL callbacks with the result parameter set to IOTHUB_CLIENT_CONFIRMATION_OK and the context set to the context passed originally in the SendEventAsync call.]*/
+        IOTHUB_CLIENT_LL_HANDLE_DATA* handleData = (IOTHUB_CLIENT_LL_HANDLE_DATA*)handle;
         PDLIST_ENTRY oldest;
         while ((oldest = DList_RemoveHeadList(completed)) != completed)
         {
@@ -1188,10 +2577,63 @@ void IoTHubClient_LL_SendComplete(IOTHUB_CLIENT_LL_HANDLE handle, PDLIST_ENTRY c
             {
                 messageList->callback(result, messageList->context);
             }
+            timeout_queue_remove(&messageList->timeout_entry);
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_057: [ IoTHubClient_LL_SendComplete, IoTHubClient_LL_DoWork and the send functions shall count the messages they complete in the statistics, by result, with the payload bytes of the messages completed with IOTHUB_CLIENT_CONFIRMATION_OK. ]*/
+            count_completed_message(handleData, messageList, result);
+            count_congestion_feedback(handleData, messageList, result);
+            release_outbound_queue_space(handleData, messageList);
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_053: [ Messages completed with IOTHUB_CLIENT_CONFIRMATION_BECAUSE_DESTROY shall not be confirmed in the journal, they are replayed by the next client that uses the journal directory. ]*/
+            if (result != IOTHUB_CLIENT_CONFIRMATION_BECAUSE_DESTROY)
+            {
+                confirm_journaled_message(handleData, messageList);
+            }
             IoTHubMessage_Destroy(messageList->messageHandle);
-            free(messageList);
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_018: [ IoTHubClient_LL_SendComplete shall return the completed records to the message pool they were taken from, or free them. ]*/
+            object_pool_free(handleData->messagePool, messageList);
+        }
+        update_outbound_queue_water_marks(handleData);
+    }
+}
+
+bool IoTHubClient_LL_CompleteIfExpired(IOTHUB_CLIENT_LL_HANDLE handle, IOTHUB_MESSAGE_LIST* message)
+{
+    bool result;
+    /*Codes_SRS_IOTHUBCLIENT_LL_31_072: [ If handle or message is NULL, IoTHubClient_LL_CompleteIfExpired shall return false. ]*/
+    if ((handle == NULL) || (message == NULL))
+    {
+        LogError("invalid arg IOTHUB_CLIENT_LL_HANDLE handle=%p, IOTHUB_MESSAGE_LIST* message=%p", handle, message);
+        result = false;
+    }
+    /*Codes_SRS_IOTHUBCLIENT_LL_31_073: [ If the message has no expiry time, IoTHubClient_LL_CompleteIfExpired shall return false. ]*/
+    else if (message->expiryTime == (time_t)0)
+    {
+        result = false;
+    }
+    else
+    {
+        time_t now = get_time(NULL);
+        if (now == INDEFINITE_TIME)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_074: [ If getting the current time fails, IoTHubClient_LL_CompleteIfExpired shall return false, so that the message is sent. ]*/
+            LogError("unable to get the current time");
+            result = false;
+        }
+        else if (now < message->expiryTime)
+        {
+            result = false;
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_075: [ Otherwise, when the expiry time of the message is past, IoTHubClient_LL_CompleteIfExpired shall remove the message from the list it is in, complete it like IoTHubClient_LL_SendComplete with IOTHUB_CLIENT_CONFIRMATION_MESSAGE_EXPIRED and return true. ]*/
+            DLIST_ENTRY completed;
+            (void)DList_RemoveEntryList(&message->entry);
+            DList_InitializeListHead(&completed);
+            DList_InsertTailList(&completed, &message->entry);
+            IoTHubClient_LL_SendComplete(handle, &completed, IOTHUB_CLIENT_CONFIRMATION_MESSAGE_EXPIRED);
+            result = true;
         }
     }
+    return result;
 }
 
 int IoTHubClient_LL_DeviceMethodComplete(IOTHUB_CLIENT_LL_HANDLE handle, const char* method_name, const unsigned char* payLoad, size_t size, METHOD_HANDLE response_id)
@@ -1378,6 +2820,15 @@ void IoTHubClient_LL_ConnectionStatusCallBack(IOTHUB_CLIENT_LL_HANDLE handle, IO
     {
         IOTHUB_CLIENT_LL_HANDLE_DATA* handleData = (IOTHUB_CLIENT_LL_HANDLE_DATA*)handle;
 
+        handleData->connectionStatus = status;
+        if (handleData->connectCallback != NULL)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_092: [ If a callback saved by IoTHubClient_LL_Connect is pending, IoTHubClient_LL_ConnectionStatusCallBack shall forget it and call it once with status, reason and its userContextCallback, before the callback set by IoTHubClient_LL_SetConnectionStatusCallback. ]*/
+            IOTHUB_CLIENT_CONNECTION_STATUS_CALLBACK connectCallback = handleData->connectCallback;
+            handleData->connectCallback = NULL;
+            connectCallback(status, reason, handleData->connectUserContextCallback);
+        }
+
         /*Codes_SRS_IOTHUBCLIENT_LL_25_114: [IoTHubClient_LL_ConnectionStatusCallBack shall call non-callback set by the user from IoTHubClient_LL_SetConnectionStatusCallback passing the status, reason and the passed userContextCallback.]*/
         if (handleData->conStatusCallback != NULL)
         {
@@ -1408,6 +2859,59 @@ IOTHUB_CLIENT_RESULT IoTHubClient_LL_SetConnectionStatusCallback(IOTHUB_CLIENT_L
     return result;
 }
 
+IOTHUB_CLIENT_RESULT IoTHubClient_LL_Connect(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle, IOTHUB_CLIENT_CONNECTION_STATUS_CALLBACK connectCallback, void* userContextCallback)
+{
+    IOTHUB_CLIENT_RESULT result;
+    /*Codes_SRS_IOTHUBCLIENT_LL_31_089: [ If iotHubClientHandle is NULL, IoTHubClient_LL_Connect shall return IOTHUB_CLIENT_INVALID_ARG. ]*/
+    if (iotHubClientHandle == NULL)
+    {
+        result = IOTHUB_CLIENT_INVALID_ARG;
+        LOG_ERROR_RESULT;
+    }
+    else
+    {
+        IOTHUB_CLIENT_LL_HANDLE_DATA* handleData = (IOTHUB_CLIENT_LL_HANDLE_DATA*)iotHubClientHandle;
+        if (handleData->connectionStatus == IOTHUB_CLIENT_CONNECTION_AUTHENTICATED)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_090: [ If the last connection status reported by the transport is IOTHUB_CLIENT_CONNECTION_AUTHENTICATED, IoTHubClient_LL_Connect shall call connectCallback, if not NULL, with IOTHUB_CLIENT_CONNECTION_AUTHENTICATED, IOTHUB_CLIENT_CONNECTION_OK and userContextCallback and return IOTHUB_CLIENT_OK. ]*/
+            if (connectCallback != NULL)
+            {
+                connectCallback(IOTHUB_CLIENT_CONNECTION_AUTHENTICATED, IOTHUB_CLIENT_CONNECTION_OK, userContextCallback);
+            }
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_091: [ Otherwise IoTHubClient_LL_Connect shall save connectCallback and userContextCallback, replacing those of a previous call not completed yet, call IoTHubClient_LL_DoWork so that the transport starts connecting and return IOTHUB_CLIENT_OK. ]*/
+            handleData->connectCallback = connectCallback;
+            handleData->connectUserContextCallback = userContextCallback;
+            IoTHubClient_LL_DoWork(iotHubClientHandle);
+        }
+        result = IOTHUB_CLIENT_OK;
+    }
+
+    return result;
+}
+
+IOTHUB_CLIENT_RESULT IoTHubClient_LL_SetOutboundQueueCallback(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle, IOTHUB_CLIENT_OUTBOUND_QUEUE_CALLBACK outboundQueueCallback, void* userContextCallback)
+{
+    IOTHUB_CLIENT_RESULT result;
+    /*Codes_SRS_IOTHUBCLIENT_LL_31_042: [ IoTHubClient_LL_SetOutboundQueueCallback shall return IOTHUB_CLIENT_INVALID_ARG if iotHubClientHandle is NULL. ]*/
+    if (iotHubClientHandle == NULL)
+    {
+        result = IOTHUB_CLIENT_INVALID_ARG;
+        LOG_ERROR_RESULT;
+    }
+    else
+    {
+        IOTHUB_CLIENT_LL_HANDLE_DATA* handleData = (IOTHUB_CLIENT_LL_HANDLE_DATA*)iotHubClientHandle;
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_043: [ Otherwise IoTHubClient_LL_SetOutboundQueueCallback shall save outboundQueueCallback and userContextCallback, replacing the previous ones, and return IOTHUB_CLIENT_OK. A NULL outboundQueueCallback stops the notifications. ]*/
+        handleData->outboundQueueCallback = outboundQueueCallback;
+        handleData->outboundQueueUserContextCallback = userContextCallback;
+        result = IOTHUB_CLIENT_OK;
+    }
+    return result;
+}
+
 IOTHUB_CLIENT_RESULT IoTHubClient_LL_SetRetryPolicy(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle, IOTHUB_CLIENT_RETRY_POLICY retryPolicy, size_t retryTimeoutLimitInSeconds)
 {
     IOTHUB_CLIENT_RESULT result;
@@ -1499,6 +3003,161 @@ IOTHUB_CLIENT_RESULT IoTHubClient_LL_GetLastMessageReceiveTime(IOTHUB_CLIENT_LL_
     return result;
 }
 
+static IOTHUB_CLIENT_RESULT set_message_pool_size(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, size_t poolSize)
+{
+    IOTHUB_CLIENT_RESULT result;
+    OBJECT_POOL_STATISTICS statistics;
+    if ((handleData->messagePool != NULL) &&
+        ((object_pool_get_statistics(handleData->messagePool, &statistics) != 0) || (statistics.in_use != 0)))
+    {
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_019: [ If records taken from the current message pool are still in use, IoTHubClient_LL_SetOption shall fail and return IOTHUB_CLIENT_ERROR. ]*/
+        LogError("unable to resize the message pool while messages are queued");
+        result = IOTHUB_CLIENT_ERROR;
+    }
+    else
+    {
+        OBJECT_POOL_HANDLE newPool = NULL;
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_020: [ A value of 0 shall remove the message pool. ]*/
+        if ((poolSize != 0) &&
+            ((newPool = object_pool_create(sizeof(IOTHUB_MESSAGE_LIST), poolSize)) == NULL))
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_021: [ If creating the message pool fails, IoTHubClient_LL_SetOption shall return IOTHUB_CLIENT_ERROR and keep the current pool. ]*/
+            LogError("unable to create a message pool of %lu entries", (unsigned long)poolSize);
+            result = IOTHUB_CLIENT_ERROR;
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_022: [ The transport shall be given the option too, so it can pool its own per message records. IOTHUB_CLIENT_INVALID_ARG from a transport that does not pool shall be ignored. ]*/
+            IOTHUB_CLIENT_RESULT transportResult = handleData->IoTHubTransport_SetOption(handleData->transportHandle, OPTION_MESSAGE_POOL_SIZE, &poolSize);
+            if (transportResult == IOTHUB_CLIENT_ERROR)
+            {
+                LogError("the transport failed setting its message pool");
+                object_pool_destroy(newPool);
+                result = IOTHUB_CLIENT_ERROR;
+            }
+            else
+            {
+                object_pool_destroy(handleData->messagePool);
+                handleData->messagePool = newPool;
+                result = IOTHUB_CLIENT_OK;
+            }
+        }
+    }
+    return result;
+}
+
+static IOTHUB_CLIENT_RESULT set_congestion_control_max_window(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, size_t maxWindow)
+{
+    IOTHUB_CLIENT_RESULT result;
+    CONGESTION_CONTROL_HANDLE congestionControl;
+    if (handleData->isSharedTransport)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_095: [ If the client shares its transport, IoTHubClient_LL_SetOption shall fail "congestion_control_max_window" with IOTHUB_CLIENT_ERROR: the window is applied by IoTHubClient_LL_DoWork, which the shared transport does not call, and the transport counts in flight the events of all its devices. ]*/
+        LogError("the congestion control cannot be set on a client sharing its transport");
+        result = IOTHUB_CLIENT_ERROR;
+    }
+    else if (maxWindow == 0)
+    {
+        congestion_control_destroy(handleData->congestionControl);
+        handleData->congestionControl = NULL;
+        result = IOTHUB_CLIENT_OK;
+    }
+    else if ((congestionControl = congestion_control_create(maxWindow)) == NULL)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_077: [ If creating the congestion control fails, IoTHubClient_LL_SetOption shall fail and return IOTHUB_CLIENT_ERROR, keeping the previous one. ]*/
+        result = IOTHUB_CLIENT_ERROR;
+        LOG_ERROR_RESULT;
+    }
+    else
+    {
+        congestion_control_destroy(handleData->congestionControl);
+        handleData->congestionControl = congestionControl;
+        result = IOTHUB_CLIENT_OK;
+    }
+    return result;
+}
+
+#ifndef DONT_USE_JOURNAL
+/*queues a message replayed by the journal, returns non-zero when the message is dropped so that the journal confirms it*/
+static int on_journal_replay(const unsigned char* record, size_t size, uint64_t sequence, void* context)
+{
+    int result;
+    IOTHUB_CLIENT_LL_HANDLE_DATA* handleData = (IOTHUB_CLIENT_LL_HANDLE_DATA*)context;
+    IOTHUB_MESSAGE_LIST* newEntry;
+    IOTHUB_MESSAGE_HANDLE message = deserialize_message(record, size);
+    if (message == NULL)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_048: [ A replayed message that cannot be rebuilt or queued shall be dropped and confirmed in the journal. ]*/
+        LogError("unable to rebuild message %llu of the journal, dropping it", (unsigned long long)sequence);
+        result = __FAILURE__;
+    }
+    else if ((newEntry = (IOTHUB_MESSAGE_LIST*)object_pool_alloc(handleData->messagePool, sizeof(IOTHUB_MESSAGE_LIST))) == NULL)
+    {
+        LogError("unable to queue message %llu of the journal, dropping it", (unsigned long long)sequence);
+        IoTHubMessage_Destroy(message);
+        result = __FAILURE__;
+    }
+    else if (get_ms_timesOutAfter(handleData, &newEntry->ms_timesOutAfter) != 0)
+    {
+        LogError("unable to queue message %llu of the journal, dropping it", (unsigned long long)sequence);
+        object_pool_free(handleData->messagePool, newEntry);
+        IoTHubMessage_Destroy(message);
+        result = __FAILURE__;
+    }
+    else
+    {
+        /*the journal is not set yet while it replays, a failure here leaves the confirmation to the journal*/
+        newEntry->journalSequence = sequence;
+        if (queue_message_record(handleData, newEntry, message, NULL, NULL, true, NULL) != IOTHUB_CLIENT_OK)
+        {
+            LogError("unable to queue message %llu of the journal, dropping it", (unsigned long long)sequence);
+            IoTHubMessage_Destroy(message);
+            result = __FAILURE__;
+        }
+        else
+        {
+            result = 0;
+        }
+    }
+    return result;
+}
+
+static IOTHUB_CLIENT_RESULT set_journal_directory(IOTHUB_CLIENT_LL_HANDLE_DATA* handleData, const char* directory)
+{
+    IOTHUB_CLIENT_RESULT result;
+    if (handleData->isSharedTransport)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_094: [ If the client shares its transport, IoTHubClient_LL_SetOption shall fail "journal_directory" with IOTHUB_CLIENT_ERROR: the journal is committed by IoTHubClient_LL_DoWork, which the shared transport does not call. ]*/
+        LogError("the journal directory cannot be set on a client sharing its transport");
+        result = IOTHUB_CLIENT_ERROR;
+    }
+    else if (handleData->journal != NULL)
+    {
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_047: [ If a journal is already set, or creating the journal fails, IoTHubClient_LL_SetOption shall fail and return IOTHUB_CLIENT_ERROR. ]*/
+        LogError("the journal directory can only be set once");
+        result = IOTHUB_CLIENT_ERROR;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_046: [ "journal_directory" - takes a const char* naming an existing directory. IoTHubClient_LL_SetOption shall create a journal in it, whose segments are "journal_segment_size" bytes, and add to waitingToSend, in order and without confirmation callbacks, the messages replayed from the journal. ]*/
+        JOURNAL_HANDLE journal = journal_create(directory, (handleData->journalSegmentSize == 0) ? JOURNAL_DEFAULT_SEGMENT_SIZE : handleData->journalSegmentSize, on_journal_replay, handleData);
+        if (journal == NULL)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_047: [ If a journal is already set, or creating the journal fails, IoTHubClient_LL_SetOption shall fail and return IOTHUB_CLIENT_ERROR. ]*/
+            LogError("unable to create a journal in %s", directory);
+            result = IOTHUB_CLIENT_ERROR;
+        }
+        else
+        {
+            handleData->journal = journal;
+            update_outbound_queue_water_marks(handleData);
+            result = IOTHUB_CLIENT_OK;
+        }
+    }
+    return result;
+}
+#endif /*DONT_USE_JOURNAL*/
+
 IOTHUB_CLIENT_RESULT IoTHubClient_LL_SetOption(IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle, const char* optionName, const void* value)
 {
 
@@ -1548,6 +3207,132 @@ IOTHUB_CLIENT_RESULT IoTHubClient_LL_SetOption(IOTHUB_CLIENT_LL_HANDLE iotHubCli
                 result = IOTHUB_CLIENT_OK;
             }
         }
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_016: [ "message_pool_size" - takes a pointer to a size_t holding the number of IOTHUB_MESSAGE_LIST records IoTHubClient_LL_SendEventAsync takes from a pool allocated once, instead of calling malloc for every message. ]*/
+        else if (strcmp(optionName, OPTION_MESSAGE_POOL_SIZE) == 0)
+        {
+            result = set_message_pool_size(handleData, *(const size_t*)value);
+        }
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_032: [ "outbound_queue_max_messages" and "outbound_queue_max_bytes" - take a pointer to a size_t holding the most messages, and the most bytes of message content, given to IoTHubClient_LL that may be waiting for their completion. 0 removes the limit. ]*/
+        else if (strcmp(optionName, OPTION_OUTBOUND_QUEUE_MAX_MESSAGES) == 0)
+        {
+            handleData->outboundQueueMaxMessages = *(const size_t*)value;
+            result = IOTHUB_CLIENT_OK;
+        }
+        else if (strcmp(optionName, OPTION_OUTBOUND_QUEUE_MAX_BYTES) == 0)
+        {
+            handleData->outboundQueueMaxBytes = *(const size_t*)value;
+            result = IOTHUB_CLIENT_OK;
+        }
+        else if (strcmp(optionName, OPTION_OUTBOUND_QUEUE_POLICY) == 0)
+        {
+            IOTHUB_CLIENT_OUTBOUND_QUEUE_POLICY policy = *(const IOTHUB_CLIENT_OUTBOUND_QUEUE_POLICY*)value;
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_033: [ "outbound_queue_policy" - takes a pointer to a IOTHUB_CLIENT_OUTBOUND_QUEUE_POLICY deciding what happens to a message that does not fit in the outbound queue. Any other value shall fail with IOTHUB_CLIENT_INVALID_ARG. ]*/
+            if ((policy != IOTHUB_CLIENT_OUTBOUND_QUEUE_REJECT_NEW) &&
+                (policy != IOTHUB_CLIENT_OUTBOUND_QUEUE_DROP_OLDEST) &&
+                (policy != IOTHUB_CLIENT_OUTBOUND_QUEUE_DROP_LOWEST_PRIORITY))
+            {
+                LogError("invalid outbound queue policy %d", (int)policy);
+                result = IOTHUB_CLIENT_INVALID_ARG;
+            }
+            else
+            {
+                handleData->outboundQueuePolicy = policy;
+                result = IOTHUB_CLIENT_OK;
+            }
+        }
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_034: [ "outbound_queue_high_water_mark" and "outbound_queue_low_water_mark" - take a pointer to a size_t holding a percentage of the limits of the outbound queue between 1 and 100. A value that would put the low water mark above the high water mark shall fail with IOTHUB_CLIENT_INVALID_ARG. ]*/
+        else if (strcmp(optionName, OPTION_OUTBOUND_QUEUE_HIGH_WATER_MARK) == 0)
+        {
+            size_t highWaterMark = *(const size_t*)value;
+            if ((highWaterMark == 0) || (highWaterMark > 100) || (highWaterMark < handleData->outboundQueueLowWaterMark))
+            {
+                LogError("invalid outbound queue high water mark %lu", (unsigned long)highWaterMark);
+                result = IOTHUB_CLIENT_INVALID_ARG;
+            }
+            else
+            {
+                handleData->outboundQueueHighWaterMark = highWaterMark;
+                result = IOTHUB_CLIENT_OK;
+            }
+        }
+        else if (strcmp(optionName, OPTION_OUTBOUND_QUEUE_LOW_WATER_MARK) == 0)
+        {
+            size_t lowWaterMark = *(const size_t*)value;
+            if ((lowWaterMark == 0) || (lowWaterMark > handleData->outboundQueueHighWaterMark))
+            {
+                LogError("invalid outbound queue low water mark %lu", (unsigned long)lowWaterMark);
+                result = IOTHUB_CLIENT_INVALID_ARG;
+            }
+            else
+            {
+                handleData->outboundQueueLowWaterMark = lowWaterMark;
+                result = IOTHUB_CLIENT_OK;
+            }
+        }
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_065: [ "compression_codec" - takes a pointer to an IOTHUB_CLIENT_COMPRESSION_CODEC, which has to outlive the client, compressing the content of the events queued from then on. A codec without a compress function shall fail with IOTHUB_CLIENT_INVALID_ARG. ]*/
+        else if (strcmp(optionName, OPTION_COMPRESSION_CODEC) == 0)
+        {
+            const IOTHUB_CLIENT_COMPRESSION_CODEC* codec = (const IOTHUB_CLIENT_COMPRESSION_CODEC*)value;
+            if ((codec->compress == NULL) || (codec->contentEncoding == NULL))
+            {
+                LogError("invalid compression codec");
+                result = IOTHUB_CLIENT_INVALID_ARG;
+            }
+            else
+            {
+                handleData->compressionCodec = codec;
+                result = IOTHUB_CLIENT_OK;
+            }
+        }
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_066: [ By default the events shall not be compressed, and once a codec is set only the events of at least IOTHUB_CLIENT_COMPRESSION_DEFAULT_MIN_SIZE bytes shall be. compression_min_size takes a pointer to a size_t holding another minimum. ]*/
+        else if (strcmp(optionName, OPTION_COMPRESSION_MIN_SIZE) == 0)
+        {
+            handleData->compressionMinSize = *(const size_t*)value;
+            result = IOTHUB_CLIENT_OK;
+        }
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_076: [ "congestion_control_max_window" - takes a pointer to a size_t holding the most events the congestion window may let the transport have in flight. A value other than 0 shall restart the congestion control with a window of 1 event, 0 shall disable it. It is disabled by default. ]*/
+        else if (strcmp(optionName, OPTION_CONGESTION_CONTROL_MAX_WINDOW) == 0)
+        {
+            result = set_congestion_control_max_window(handleData, *(const size_t*)value);
+        }
+        else if (handleData->isSharedTransport && ((strcmp(optionName, OPTION_LINGER_MS) == 0) || (strcmp(optionName, OPTION_LINGER_MAX_BYTES) == 0)))
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_096: [ If the client shares its transport, IoTHubClient_LL_SetOption shall fail "linger_ms" and "linger_max_bytes" with IOTHUB_CLIENT_ERROR: the messages are held back by IoTHubClient_LL_DoWork, which the shared transport does not call. ]*/
+            LogError("%s cannot be set on a client sharing its transport", optionName);
+            result = IOTHUB_CLIENT_ERROR;
+        }
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_084: [ "linger_ms" - takes a pointer to a tickcounter_ms_t holding the most milliseconds the messages may be held back in waitingToSend so that the transport sends more of them at once, and "linger_max_bytes" a pointer to a size_t holding the bytes of content at which they are sent anyway. 0 disables the linger, which is the default, or its bound in bytes. ]*/
+        else if (strcmp(optionName, OPTION_LINGER_MS) == 0)
+        {
+            handleData->lingerMs = *(const tickcounter_ms_t*)value;
+            handleData->lingerStartTick = UNKNOWN_TICK;
+            result = IOTHUB_CLIENT_OK;
+        }
+        else if (strcmp(optionName, OPTION_LINGER_MAX_BYTES) == 0)
+        {
+            handleData->lingerMaxBytes = *(const size_t*)value;
+            result = IOTHUB_CLIENT_OK;
+        }
+#ifndef DONT_USE_JOURNAL
+        else if (strcmp(optionName, OPTION_JOURNAL_DIRECTORY) == 0)
+        {
+            result = set_journal_directory(handleData, (const char*)value);
+        }
+        /*Codes_SRS_IOTHUBCLIENT_LL_31_055: [ "journal_segment_size" - takes a pointer to a size_t holding the size of the segment files of the journal, JOURNAL_DEFAULT_SEGMENT_SIZE by default. Setting it once the journal is set shall fail with IOTHUB_CLIENT_ERROR. ]*/
+        else if (strcmp(optionName, OPTION_JOURNAL_SEGMENT_SIZE) == 0)
+        {
+            if (handleData->journal != NULL)
+            {
+                LogError("the journal segment size cannot change once the journal is set");
+                result = IOTHUB_CLIENT_ERROR;
+            }
+            else
+            {
+                handleData->journalSegmentSize = *(const size_t*)value;
+                result = IOTHUB_CLIENT_OK;
+            }
+        }
+#endif /*DONT_USE_JOURNAL*/
         else
         {
 
@@ -1600,6 +3385,31 @@ IOTHUB_CLIENT_RESULT IoTHubClient_LL_GetOption(IOTHUB_CLIENT_LL_HANDLE iotHubCli
         result = IOTHUB_CLIENT_OK;
         *value = iotHubClientHandle->product_info;
     }
+    else if (strcmp(optionName, OPTION_MESSAGE_POOL_STATISTICS) == 0)
+    {
+        OBJECT_POOL_STATISTICS statistics;
+        if (iotHubClientHandle->messagePool == NULL)
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_023: [ If no message pool is set, IoTHubClient_LL_GetOption shall return IOTHUB_CLIENT_INVALID_ARG for "message_pool_statistics". ]*/
+            result = IOTHUB_CLIENT_INVALID_ARG;
+            LogError("no message pool is set");
+        }
+        else if (object_pool_get_statistics(iotHubClientHandle->messagePool, &statistics) != 0)
+        {
+            result = IOTHUB_CLIENT_ERROR;
+            LogError("unable to get the statistics of the message pool");
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBCLIENT_LL_31_024: [ "message_pool_statistics" - IoTHubClient_LL_GetOption shall set value to an IOTHUB_CLIENT_POOL_STATISTICS* holding the capacity, the records in use and the hit and miss counts of the message pool, valid until the next call. ]*/
+            iotHubClientHandle->messagePoolStatistics.capacity = statistics.capacity;
+            iotHubClientHandle->messagePoolStatistics.in_use = statistics.in_use;
+            iotHubClientHandle->messagePoolStatistics.hits = statistics.hits;
+            iotHubClientHandle->messagePoolStatistics.misses = statistics.misses;
+            *value = &iotHubClientHandle->messagePoolStatistics;
+            result = IOTHUB_CLIENT_OK;
+        }
+    }
     else
     {
         result = IOTHUB_CLIENT_INVALID_ARG;
@@ -1681,6 +3491,7 @@ IOTHUB_CLIENT_RESULT IoTHubClient_LL_SendReportedState(IOTHUB_CLIENT_LL_HANDLE i
             {
                 /* Codes_SRS_IOTHUBCLIENT_LL_07_001: [ IoTHubClient_LL_SendReportedState shall queue the constructed reportedState data to be consumed by the targeted transport. ] */
                 DList_InsertTailList(&(iotHubClientHandle->iot_msg_queue), &(client_data->entry));
+                iotHubClientHandle->is_msg_queue_updated = true;
 
                 /* Codes_SRS_IOTHUBCLIENT_LL_10_016: [ Otherwise IoTHubClient_LL_SendReportedState shall succeed and return IOTHUB_CLIENT_OK.] */
                 result = IOTHUB_CLIENT_OK;
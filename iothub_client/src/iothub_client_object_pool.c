@@ -0,0 +1,167 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stdint.h>
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/optimize_size.h"
+#include "azure_c_shared_utility/xlogging.h"
+
+#include "iothub_client_object_pool.h"
+
+/*every slot is aligned for any of the fields the pooled structures hold*/
+typedef union OBJECT_POOL_ALIGNMENT_TAG
+{
+    void* pointer;
+    uint64_t integer;
+    double floating;
+} OBJECT_POOL_ALIGNMENT;
+
+typedef struct OBJECT_POOL_FREE_SLOT_TAG
+{
+    struct OBJECT_POOL_FREE_SLOT_TAG* next;
+} OBJECT_POOL_FREE_SLOT;
+
+typedef struct OBJECT_POOL_INSTANCE_TAG
+{
+    unsigned char* slots;            /*object_count slots of slot_size bytes each*/
+    size_t slot_size;
+    size_t object_size;
+    OBJECT_POOL_FREE_SLOT* freeList; /*the free slots are linked through their own storage*/
+    OBJECT_POOL_STATISTICS statistics;
+} OBJECT_POOL_INSTANCE;
+
+static int is_pool_object(const OBJECT_POOL_INSTANCE* pool, const void* object)
+{
+    const unsigned char* address = (const unsigned char*)object;
+    return (address >= pool->slots) && (address < pool->slots + (pool->slot_size * pool->statistics.capacity));
+}
+
+OBJECT_POOL_HANDLE object_pool_create(size_t object_size, size_t object_count)
+{
+    OBJECT_POOL_INSTANCE* result;
+    /*Codes_SRS_IOTHUB_CLIENT_OBJECT_POOL_31_001: [ If object_size or object_count is 0, object_pool_create shall fail and return NULL. ]*/
+    if ((object_size == 0) || (object_count == 0))
+    {
+        LogError("invalid argument size_t object_size=%lu, size_t object_count=%lu", (unsigned long)object_size, (unsigned long)object_count);
+        result = NULL;
+    }
+    else if ((result = (OBJECT_POOL_INSTANCE*)malloc(sizeof(OBJECT_POOL_INSTANCE))) == NULL)
+    {
+        /*Codes_SRS_IOTHUB_CLIENT_OBJECT_POOL_31_002: [ If allocating memory fails, object_pool_create shall fail and return NULL. ]*/
+        LogError("unable to malloc");
+    }
+    else
+    {
+        size_t slot_size = (object_size < sizeof(OBJECT_POOL_FREE_SLOT)) ? sizeof(OBJECT_POOL_FREE_SLOT) : object_size;
+        slot_size = ((slot_size + sizeof(OBJECT_POOL_ALIGNMENT) - 1) / sizeof(OBJECT_POOL_ALIGNMENT)) * sizeof(OBJECT_POOL_ALIGNMENT);
+
+        /*Codes_SRS_IOTHUB_CLIENT_OBJECT_POOL_31_003: [ object_pool_create shall allocate the storage for object_count objects of object_size bytes in a single allocation and return the handle of the pool. ]*/
+        if ((object_count > SIZE_MAX / slot_size) ||
+            ((result->slots = (unsigned char*)malloc(slot_size * object_count)) == NULL))
+        {
+            /*Codes_SRS_IOTHUB_CLIENT_OBJECT_POOL_31_002: [ If allocating memory fails, object_pool_create shall fail and return NULL. ]*/
+            LogError("unable to malloc the storage of %lu objects", (unsigned long)object_count);
+            free(result);
+            result = NULL;
+        }
+        else
+        {
+            size_t index = object_count;
+            result->slot_size = slot_size;
+            result->object_size = object_size;
+            result->freeList = NULL;
+            while (index > 0)
+            {
+                OBJECT_POOL_FREE_SLOT* slot;
+                index--;
+                slot = (OBJECT_POOL_FREE_SLOT*)(result->slots + (index * slot_size));
+                slot->next = result->freeList;
+                result->freeList = slot;
+            }
+            result->statistics.capacity = object_count;
+            result->statistics.in_use = 0;
+            result->statistics.hits = 0;
+            result->statistics.misses = 0;
+        }
+    }
+    return result;
+}
+
+void object_pool_destroy(OBJECT_POOL_HANDLE handle)
+{
+    /*Codes_SRS_IOTHUB_CLIENT_OBJECT_POOL_31_004: [ If handle is NULL, object_pool_destroy shall do nothing. ]*/
+    if (handle != NULL)
+    {
+        if (handle->statistics.in_use != 0)
+        {
+            LogError("destroying a pool that still has %lu objects in use", (unsigned long)handle->statistics.in_use);
+        }
+        /*Codes_SRS_IOTHUB_CLIENT_OBJECT_POOL_31_005: [ object_pool_destroy shall free the storage of the pool and the pool. ]*/
+        free(handle->slots);
+        free(handle);
+    }
+}
+
+void* object_pool_alloc(OBJECT_POOL_HANDLE handle, size_t object_size)
+{
+    void* result;
+    if ((handle == NULL) || (object_size > handle->object_size))
+    {
+        /*Codes_SRS_IOTHUB_CLIENT_OBJECT_POOL_31_006: [ If handle is NULL or object_size is bigger than the objects of the pool, object_pool_alloc shall return the result of malloc(object_size). ]*/
+        result = malloc(object_size);
+    }
+    else if (handle->freeList != NULL)
+    {
+        /*Codes_SRS_IOTHUB_CLIENT_OBJECT_POOL_31_007: [ object_pool_alloc shall return a free object of the pool and count a hit. ]*/
+        result = handle->freeList;
+        handle->freeList = handle->freeList->next;
+        handle->statistics.in_use++;
+        handle->statistics.hits++;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUB_CLIENT_OBJECT_POOL_31_008: [ If the pool has no free object, object_pool_alloc shall count a miss and return the result of malloc(object_size). ]*/
+        handle->statistics.misses++;
+        result = malloc(object_size);
+    }
+    return result;
+}
+
+void object_pool_free(OBJECT_POOL_HANDLE handle, void* object)
+{
+    if (object != NULL)
+    {
+        if ((handle != NULL) && is_pool_object(handle, object))
+        {
+            /*Codes_SRS_IOTHUB_CLIENT_OBJECT_POOL_31_009: [ If object belongs to the pool, object_pool_free shall return it to the pool. ]*/
+            OBJECT_POOL_FREE_SLOT* slot = (OBJECT_POOL_FREE_SLOT*)object;
+            slot->next = handle->freeList;
+            handle->freeList = slot;
+            handle->statistics.in_use--;
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUB_CLIENT_OBJECT_POOL_31_010: [ Otherwise object_pool_free shall free object. ]*/
+            free(object);
+        }
+    }
+}
+
+int object_pool_get_statistics(OBJECT_POOL_HANDLE handle, OBJECT_POOL_STATISTICS* statistics)
+{
+    int result;
+    /*Codes_SRS_IOTHUB_CLIENT_OBJECT_POOL_31_011: [ If handle or statistics is NULL, object_pool_get_statistics shall fail and return a non-zero value. ]*/
+    if ((handle == NULL) || (statistics == NULL))
+    {
+        LogError("invalid argument OBJECT_POOL_HANDLE handle=%p, OBJECT_POOL_STATISTICS* statistics=%p", handle, statistics);
+        result = __FAILURE__;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUB_CLIENT_OBJECT_POOL_31_012: [ object_pool_get_statistics shall copy the capacity, the number of objects in use and the hit and miss counts of the pool to statistics and return 0. ]*/
+        *statistics = handle->statistics;
+        result = 0;
+    }
+    return result;
+}
@@ -0,0 +1,193 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/optimize_size.h"
+#include "azure_c_shared_utility/xlogging.h"
+
+#include "iothub_client_packet_id_table.h"
+
+typedef struct PACKET_ID_TABLE_INSTANCE_TAG
+{
+    PACKET_ID_TABLE_ENTRY** buckets; /*the entries of packet id p are chained in buckets[p & (bucketCount - 1)]*/
+    size_t bucketCount;              /*a power of 2*/
+    size_t count;
+} PACKET_ID_TABLE_INSTANCE;
+
+static PACKET_ID_TABLE_ENTRY** create_buckets(size_t bucketCount)
+{
+    PACKET_ID_TABLE_ENTRY** result = (PACKET_ID_TABLE_ENTRY**)malloc(bucketCount * sizeof(PACKET_ID_TABLE_ENTRY*));
+    if (result != NULL)
+    {
+        size_t index;
+        for (index = 0; index < bucketCount; index++)
+        {
+            result[index] = NULL;
+        }
+    }
+    return result;
+}
+
+static void insert_entry(PACKET_ID_TABLE_ENTRY** buckets, size_t bucketCount, PACKET_ID_TABLE_ENTRY* entry)
+{
+    PACKET_ID_TABLE_ENTRY** bucket = &buckets[entry->packet_id & (bucketCount - 1)];
+    entry->next = *bucket;
+    *bucket = entry;
+}
+
+static void grow_buckets(PACKET_ID_TABLE_INSTANCE* table)
+{
+    size_t newBucketCount = 2 * table->bucketCount;
+    PACKET_ID_TABLE_ENTRY** newBuckets = create_buckets(newBucketCount);
+    if (newBuckets == NULL)
+    {
+        /*the table keeps working with longer chains*/
+        LogError("unable to malloc, the table keeps %lu buckets", (unsigned long)table->bucketCount);
+    }
+    else
+    {
+        size_t index;
+        for (index = 0; index < table->bucketCount; index++)
+        {
+            PACKET_ID_TABLE_ENTRY* entry = table->buckets[index];
+            while (entry != NULL)
+            {
+                PACKET_ID_TABLE_ENTRY* next = entry->next;
+                insert_entry(newBuckets, newBucketCount, entry);
+                entry = next;
+            }
+        }
+        free(table->buckets);
+        table->buckets = newBuckets;
+        table->bucketCount = newBucketCount;
+    }
+}
+
+PACKET_ID_TABLE_HANDLE packet_id_table_create(void)
+{
+    /*Codes_SRS_IOTHUB_CLIENT_PACKET_ID_TABLE_31_001: [ packet_id_table_create shall allocate an empty table of PACKET_ID_TABLE_INITIAL_BUCKETS buckets and return its handle. ]*/
+    PACKET_ID_TABLE_INSTANCE* result = (PACKET_ID_TABLE_INSTANCE*)malloc(sizeof(PACKET_ID_TABLE_INSTANCE));
+    if (result == NULL)
+    {
+        /*Codes_SRS_IOTHUB_CLIENT_PACKET_ID_TABLE_31_002: [ If allocating memory fails, packet_id_table_create shall return NULL. ]*/
+        LogError("unable to malloc");
+    }
+    else if ((result->buckets = create_buckets(PACKET_ID_TABLE_INITIAL_BUCKETS)) == NULL)
+    {
+        /*Codes_SRS_IOTHUB_CLIENT_PACKET_ID_TABLE_31_002: [ If allocating memory fails, packet_id_table_create shall return NULL. ]*/
+        LogError("unable to malloc the buckets");
+        free(result);
+        result = NULL;
+    }
+    else
+    {
+        result->bucketCount = PACKET_ID_TABLE_INITIAL_BUCKETS;
+        result->count = 0;
+    }
+    return result;
+}
+
+void packet_id_table_destroy(PACKET_ID_TABLE_HANDLE handle)
+{
+    /*Codes_SRS_IOTHUB_CLIENT_PACKET_ID_TABLE_31_003: [ If handle is NULL, packet_id_table_destroy shall do nothing, otherwise it shall free the table without touching the entries still in it. ]*/
+    if (handle != NULL)
+    {
+        free(handle->buckets);
+        free(handle);
+    }
+}
+
+int packet_id_table_add(PACKET_ID_TABLE_HANDLE handle, PACKET_ID_TABLE_ENTRY* entry, uint16_t packet_id)
+{
+    int result;
+    /*Codes_SRS_IOTHUB_CLIENT_PACKET_ID_TABLE_31_004: [ If handle or entry is NULL, packet_id_table_add shall fail and return a non-zero value. ]*/
+    if ((handle == NULL) || (entry == NULL))
+    {
+        LogError("invalid argument PACKET_ID_TABLE_HANDLE handle=%p, PACKET_ID_TABLE_ENTRY* entry=%p", handle, entry);
+        result = __FAILURE__;
+    }
+    else
+    {
+        if ((handle->count >= handle->bucketCount) && (handle->bucketCount < PACKET_ID_TABLE_MAX_BUCKETS))
+        {
+            /*Codes_SRS_IOTHUB_CLIENT_PACKET_ID_TABLE_31_005: [ When the table holds as many entries as buckets, packet_id_table_add shall double the buckets, up to PACKET_ID_TABLE_MAX_BUCKETS, and keep the current ones if that fails. ]*/
+            grow_buckets(handle);
+        }
+
+        /*Codes_SRS_IOTHUB_CLIENT_PACKET_ID_TABLE_31_006: [ packet_id_table_add shall set the packet id of entry to packet_id, add it to the table and return 0. ]*/
+        entry->packet_id = packet_id;
+        insert_entry(handle->buckets, handle->bucketCount, entry);
+        handle->count++;
+        result = 0;
+    }
+    return result;
+}
+
+PACKET_ID_TABLE_ENTRY* packet_id_table_remove(PACKET_ID_TABLE_HANDLE handle, uint16_t packet_id)
+{
+    PACKET_ID_TABLE_ENTRY* result = NULL;
+    /*Codes_SRS_IOTHUB_CLIENT_PACKET_ID_TABLE_31_007: [ If handle is NULL, packet_id_table_remove shall return NULL. ]*/
+    if (handle == NULL)
+    {
+        LogError("invalid argument PACKET_ID_TABLE_HANDLE handle=NULL");
+    }
+    else
+    {
+        PACKET_ID_TABLE_ENTRY** link = &handle->buckets[packet_id & (handle->bucketCount - 1)];
+        while ((*link != NULL) && ((*link)->packet_id != packet_id))
+        {
+            link = &(*link)->next;
+        }
+
+        /*Codes_SRS_IOTHUB_CLIENT_PACKET_ID_TABLE_31_008: [ packet_id_table_remove shall remove from the table the last added entry whose packet id is packet_id and return it, or return NULL if there is none. ]*/
+        if (*link != NULL)
+        {
+            result = *link;
+            *link = result->next;
+            result->next = NULL;
+            handle->count--;
+        }
+    }
+    return result;
+}
+
+int packet_id_table_remove_entry(PACKET_ID_TABLE_HANDLE handle, PACKET_ID_TABLE_ENTRY* entry)
+{
+    int result;
+    /*Codes_SRS_IOTHUB_CLIENT_PACKET_ID_TABLE_31_010: [ If handle or entry is NULL, packet_id_table_remove_entry shall fail and return a non-zero value. ]*/
+    if ((handle == NULL) || (entry == NULL))
+    {
+        LogError("invalid argument PACKET_ID_TABLE_HANDLE handle=%p, PACKET_ID_TABLE_ENTRY* entry=%p", handle, entry);
+        result = __FAILURE__;
+    }
+    else
+    {
+        PACKET_ID_TABLE_ENTRY** link = &handle->buckets[entry->packet_id & (handle->bucketCount - 1)];
+        while ((*link != NULL) && (*link != entry))
+        {
+            link = &(*link)->next;
+        }
+
+        if (*link == NULL)
+        {
+            /*Codes_SRS_IOTHUB_CLIENT_PACKET_ID_TABLE_31_012: [ If entry is not in the table, packet_id_table_remove_entry shall fail and return a non-zero value. ]*/
+            result = __FAILURE__;
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUB_CLIENT_PACKET_ID_TABLE_31_011: [ packet_id_table_remove_entry shall remove entry from the table, and no other entry sharing its packet id, and return 0. ]*/
+            *link = entry->next;
+            entry->next = NULL;
+            handle->count--;
+            result = 0;
+        }
+    }
+    return result;
+}
+
+size_t packet_id_table_get_count(PACKET_ID_TABLE_HANDLE handle)
+{
+    /*Codes_SRS_IOTHUB_CLIENT_PACKET_ID_TABLE_31_009: [ packet_id_table_get_count shall return the number of entries in the table, or 0 if handle is NULL. ]*/
+    return (handle == NULL) ? 0 : handle->count;
+}
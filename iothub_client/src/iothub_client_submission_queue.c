@@ -0,0 +1,165 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/optimize_size.h"
+#include "azure_c_shared_utility/xlogging.h"
+
+#include "iothub_client_submission_queue.h"
+
+#if defined(SUBMISSION_QUEUE_USE_LOCK)
+/*the lock is only held for the few instructions that exchange the head of the queue*/
+static SUBMISSION_QUEUE_ENTRY* compare_and_swap_head(SUBMISSION_QUEUE* queue, SUBMISSION_QUEUE_ENTRY* comparand, SUBMISSION_QUEUE_ENTRY* exchange)
+{
+    SUBMISSION_QUEUE_ENTRY* result;
+    if (Lock(queue->lock) != LOCK_OK)
+    {
+        LogError("unable to Lock");
+        /*return any value other than comparand, so that the caller sees a concurrent change and tries again. The value is only ever compared, never dereferenced*/
+        result = (comparand == NULL) ? (SUBMISSION_QUEUE_ENTRY*)queue : NULL;
+    }
+    else
+    {
+        result = queue->head;
+        if (result == comparand)
+        {
+            queue->head = exchange;
+        }
+        (void)Unlock(queue->lock);
+    }
+    return result;
+}
+#elif defined(_MSC_VER)
+#include "windows.h"
+static SUBMISSION_QUEUE_ENTRY* compare_and_swap_head(SUBMISSION_QUEUE* queue, SUBMISSION_QUEUE_ENTRY* comparand, SUBMISSION_QUEUE_ENTRY* exchange)
+{
+    return (SUBMISSION_QUEUE_ENTRY*)InterlockedCompareExchangePointer((PVOID volatile*)&queue->head, exchange, comparand);
+}
+#else
+static SUBMISSION_QUEUE_ENTRY* compare_and_swap_head(SUBMISSION_QUEUE* queue, SUBMISSION_QUEUE_ENTRY* comparand, SUBMISSION_QUEUE_ENTRY* exchange)
+{
+    /*__sync builtins are full memory barriers*/
+    return __sync_val_compare_and_swap(&queue->head, comparand, exchange);
+}
+#endif
+
+int submission_queue_init(SUBMISSION_QUEUE* queue)
+{
+    int result;
+    /*Codes_SRS_IOTHUB_CLIENT_SUBMISSION_QUEUE_31_001: [ If queue is NULL, submission_queue_init shall fail and return a non-zero value. ]*/
+    if (queue == NULL)
+    {
+        LogError("invalid argument SUBMISSION_QUEUE* queue=%p", queue);
+        result = __FAILURE__;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUB_CLIENT_SUBMISSION_QUEUE_31_002: [ submission_queue_init shall initialize queue as an empty queue and return 0. ]*/
+        queue->head = NULL;
+#ifdef SUBMISSION_QUEUE_USE_LOCK
+        if ((queue->lock = Lock_Init()) == NULL)
+        {
+            /*Codes_SRS_IOTHUB_CLIENT_SUBMISSION_QUEUE_31_003: [ If the queue needs a lock and creating it fails, submission_queue_init shall fail and return a non-zero value. ]*/
+            LogError("unable to Lock_Init");
+            result = __FAILURE__;
+        }
+        else
+#endif
+        {
+            result = 0;
+        }
+    }
+    return result;
+}
+
+void submission_queue_deinit(SUBMISSION_QUEUE* queue)
+{
+    /*Codes_SRS_IOTHUB_CLIENT_SUBMISSION_QUEUE_31_004: [ If queue is NULL, submission_queue_deinit shall do nothing. ]*/
+    if (queue != NULL)
+    {
+        /*Codes_SRS_IOTHUB_CLIENT_SUBMISSION_QUEUE_31_005: [ submission_queue_deinit shall free the resources held by queue. The entries still in the queue are owned by the caller. ]*/
+        if (queue->head != NULL)
+        {
+            LogError("deinitializing a submission queue that is not empty");
+        }
+#ifdef SUBMISSION_QUEUE_USE_LOCK
+        (void)Lock_Deinit(queue->lock);
+#endif
+    }
+}
+
+int submission_queue_push(SUBMISSION_QUEUE* queue, SUBMISSION_QUEUE_ENTRY* entry)
+{
+    int result;
+    /*Codes_SRS_IOTHUB_CLIENT_SUBMISSION_QUEUE_31_006: [ If queue or entry is NULL, submission_queue_push shall fail and return a non-zero value. ]*/
+    if ((queue == NULL) || (entry == NULL))
+    {
+        LogError("invalid argument SUBMISSION_QUEUE* queue=%p, SUBMISSION_QUEUE_ENTRY* entry=%p", queue, entry);
+        result = __FAILURE__;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUB_CLIENT_SUBMISSION_QUEUE_31_007: [ submission_queue_push shall link entry to the queue with an atomic compare and swap of the head of the queue, retrying until it succeeds, and return 0. ]*/
+        /*the first attempt guesses an empty queue, a failed compare and swap returns the head to try with next*/
+        SUBMISSION_QUEUE_ENTRY* head = NULL;
+        SUBMISSION_QUEUE_ENTRY* observed;
+        entry->next = head;
+        while ((observed = compare_and_swap_head(queue, head, entry)) != head)
+        {
+            head = observed;
+            entry->next = head;
+        }
+        result = 0;
+    }
+    return result;
+}
+
+SUBMISSION_QUEUE_ENTRY* submission_queue_take_all(SUBMISSION_QUEUE* queue)
+{
+    SUBMISSION_QUEUE_ENTRY* result;
+    /*Codes_SRS_IOTHUB_CLIENT_SUBMISSION_QUEUE_31_008: [ If queue is NULL, submission_queue_take_all shall return NULL. ]*/
+    if (queue == NULL)
+    {
+        LogError("invalid argument SUBMISSION_QUEUE* queue=%p", queue);
+        result = NULL;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUB_CLIENT_SUBMISSION_QUEUE_31_009: [ submission_queue_take_all shall atomically detach all the entries from the queue, leaving it empty. ]*/
+        SUBMISSION_QUEUE_ENTRY* newest = compare_and_swap_head(queue, NULL, NULL);
+        SUBMISSION_QUEUE_ENTRY* observed;
+        while ((newest != NULL) && ((observed = compare_and_swap_head(queue, newest, NULL)) != newest))
+        {
+            newest = observed;
+        }
+
+        /*Codes_SRS_IOTHUB_CLIENT_SUBMISSION_QUEUE_31_010: [ submission_queue_take_all shall return the detached entries linked through next in the order they were pushed, or NULL if the queue was empty. ]*/
+        result = NULL;
+        while (newest != NULL)
+        {
+            SUBMISSION_QUEUE_ENTRY* next = newest->next;
+            newest->next = result;
+            result = newest;
+            newest = next;
+        }
+    }
+    return result;
+}
+
+bool submission_queue_is_empty(SUBMISSION_QUEUE* queue)
+{
+    bool result;
+    /*Codes_SRS_IOTHUB_CLIENT_SUBMISSION_QUEUE_31_011: [ If queue is NULL, submission_queue_is_empty shall return true. ]*/
+    if (queue == NULL)
+    {
+        LogError("invalid argument SUBMISSION_QUEUE* queue=%p", queue);
+        result = true;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUB_CLIENT_SUBMISSION_QUEUE_31_012: [ submission_queue_is_empty shall read the head of the queue with the same full memory barrier as submission_queue_push and return true if it is NULL. ]*/
+        result = (compare_and_swap_head(queue, NULL, NULL) == NULL);
+    }
+    return result;
+}
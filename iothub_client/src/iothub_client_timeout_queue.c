@@ -0,0 +1,214 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/optimize_size.h"
+#include "azure_c_shared_utility/xlogging.h"
+
+#include "iothub_client_timeout_queue.h"
+
+#define TIMEOUT_QUEUE_INITIAL_CAPACITY 16
+
+typedef struct TIMEOUT_QUEUE_INSTANCE_TAG
+{
+    TIMEOUT_QUEUE_ENTRY** entries; /*binary min-heap on expiry, entries[0] expires first*/
+    size_t count;
+    size_t capacity;
+} TIMEOUT_QUEUE_INSTANCE;
+
+static void place_entry(TIMEOUT_QUEUE_INSTANCE* queue, TIMEOUT_QUEUE_ENTRY* entry, size_t index)
+{
+    queue->entries[index] = entry;
+    entry->index = index;
+}
+
+static void sift_up(TIMEOUT_QUEUE_INSTANCE* queue, size_t index)
+{
+    TIMEOUT_QUEUE_ENTRY* entry = queue->entries[index];
+    while (index > 0)
+    {
+        size_t parent = (index - 1) / 2;
+        if (queue->entries[parent]->expiry <= entry->expiry)
+        {
+            break;
+        }
+        place_entry(queue, queue->entries[parent], index);
+        index = parent;
+    }
+    place_entry(queue, entry, index);
+}
+
+static void sift_down(TIMEOUT_QUEUE_INSTANCE* queue, size_t index)
+{
+    TIMEOUT_QUEUE_ENTRY* entry = queue->entries[index];
+    for (;;)
+    {
+        size_t child = (2 * index) + 1;
+        if (child >= queue->count)
+        {
+            break;
+        }
+        if ((child + 1 < queue->count) && (queue->entries[child + 1]->expiry < queue->entries[child]->expiry))
+        {
+            child++;
+        }
+        if (entry->expiry <= queue->entries[child]->expiry)
+        {
+            break;
+        }
+        place_entry(queue, queue->entries[child], index);
+        index = child;
+    }
+    place_entry(queue, entry, index);
+}
+
+TIMEOUT_QUEUE_HANDLE timeout_queue_create(void)
+{
+    /*Codes_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_001: [ timeout_queue_create shall allocate an empty queue and return its handle. ]*/
+    TIMEOUT_QUEUE_INSTANCE* result = (TIMEOUT_QUEUE_INSTANCE*)malloc(sizeof(TIMEOUT_QUEUE_INSTANCE));
+    if (result == NULL)
+    {
+        /*Codes_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_002: [ If allocating memory fails, timeout_queue_create shall return NULL. ]*/
+        LogError("unable to malloc");
+    }
+    else
+    {
+        /*the storage for the entries is allocated when the first entry is added*/
+        result->entries = NULL;
+        result->count = 0;
+        result->capacity = 0;
+    }
+    return result;
+}
+
+void timeout_queue_destroy(TIMEOUT_QUEUE_HANDLE handle)
+{
+    /*Codes_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_003: [ If handle is NULL, timeout_queue_destroy shall do nothing. ]*/
+    if (handle != NULL)
+    {
+        size_t index;
+        /*Codes_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_004: [ timeout_queue_destroy shall mark every entry still in the queue as not queued and free the queue. ]*/
+        for (index = 0; index < handle->count; index++)
+        {
+            handle->entries[index]->queue = NULL;
+        }
+        if (handle->entries != NULL)
+        {
+            free(handle->entries);
+        }
+        free(handle);
+    }
+}
+
+int timeout_queue_add(TIMEOUT_QUEUE_HANDLE handle, TIMEOUT_QUEUE_ENTRY* entry, tickcounter_ms_t expiry)
+{
+    int result;
+    /*Codes_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_005: [ If handle or entry is NULL, or entry is already queued, timeout_queue_add shall fail and return a non-zero value. ]*/
+    if ((handle == NULL) || (entry == NULL) || (entry->queue != NULL))
+    {
+        LogError("invalid argument TIMEOUT_QUEUE_HANDLE handle=%p, TIMEOUT_QUEUE_ENTRY* entry=%p", handle, entry);
+        result = __FAILURE__;
+    }
+    else
+    {
+        if (handle->count == handle->capacity)
+        {
+            /*Codes_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_006: [ When the queue is full, timeout_queue_add shall double its capacity. ]*/
+            size_t newCapacity = (handle->capacity == 0) ? TIMEOUT_QUEUE_INITIAL_CAPACITY : (2 * handle->capacity);
+            TIMEOUT_QUEUE_ENTRY** newEntries = (TIMEOUT_QUEUE_ENTRY**)realloc(handle->entries, newCapacity * sizeof(TIMEOUT_QUEUE_ENTRY*));
+            if (newEntries == NULL)
+            {
+                /*Codes_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_007: [ If growing the queue fails, timeout_queue_add shall fail, leave the queue unchanged and return a non-zero value. ]*/
+                LogError("unable to realloc");
+            }
+            else
+            {
+                handle->entries = newEntries;
+                handle->capacity = newCapacity;
+            }
+        }
+
+        if (handle->count == handle->capacity)
+        {
+            result = __FAILURE__;
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_008: [ timeout_queue_add shall insert entry ordered by expiry and return 0. ]*/
+            entry->queue = handle;
+            entry->expiry = expiry;
+            handle->count++;
+            place_entry(handle, entry, handle->count - 1);
+            sift_up(handle, entry->index);
+            result = 0;
+        }
+    }
+    return result;
+}
+
+void timeout_queue_remove(TIMEOUT_QUEUE_ENTRY* entry)
+{
+    /*Codes_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_009: [ If entry is NULL or is not queued, timeout_queue_remove shall do nothing. ]*/
+    if ((entry != NULL) && (entry->queue != NULL))
+    {
+        /*Codes_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_010: [ timeout_queue_remove shall remove entry from the queue that holds it and mark it as not queued. ]*/
+        TIMEOUT_QUEUE_INSTANCE* queue = entry->queue;
+        size_t index = entry->index;
+        TIMEOUT_QUEUE_ENTRY* last = queue->entries[queue->count - 1];
+
+        queue->count--;
+        if (last != entry)
+        {
+            /*the last entry takes the freed slot and moves to wherever its expiry belongs*/
+            place_entry(queue, last, index);
+            if ((index > 0) && (last->expiry < queue->entries[(index - 1) / 2]->expiry))
+            {
+                sift_up(queue, index);
+            }
+            else
+            {
+                sift_down(queue, index);
+            }
+        }
+        entry->queue = NULL;
+    }
+}
+
+TIMEOUT_QUEUE_ENTRY* timeout_queue_peek(TIMEOUT_QUEUE_HANDLE handle)
+{
+    TIMEOUT_QUEUE_ENTRY* result;
+    /*Codes_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_011: [ If handle is NULL or the queue is empty, timeout_queue_peek shall return NULL. ]*/
+    if ((handle == NULL) || (handle->count == 0))
+    {
+        result = NULL;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_012: [ Otherwise timeout_queue_peek shall return the entry that expires first without removing it. ]*/
+        result = handle->entries[0];
+    }
+    return result;
+}
+
+TIMEOUT_QUEUE_ENTRY* timeout_queue_pop_expired(TIMEOUT_QUEUE_HANDLE handle, tickcounter_ms_t current_ms)
+{
+    /*Codes_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_013: [ If the entry that expires first has an expiry smaller than current_ms, timeout_queue_pop_expired shall remove it from the queue and return it. ]*/
+    /*Codes_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_014: [ Otherwise, or if handle is NULL, timeout_queue_pop_expired shall return NULL. ]*/
+    TIMEOUT_QUEUE_ENTRY* result = timeout_queue_peek(handle);
+    if ((result != NULL) && (result->expiry < current_ms))
+    {
+        timeout_queue_remove(result);
+    }
+    else
+    {
+        result = NULL;
+    }
+    return result;
+}
+
+size_t timeout_queue_get_count(TIMEOUT_QUEUE_HANDLE handle)
+{
+    /*Codes_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_015: [ timeout_queue_get_count shall return the number of queued entries, or 0 if handle is NULL. ]*/
+    return (handle == NULL) ? 0 : handle->count;
+}
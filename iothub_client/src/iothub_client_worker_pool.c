@@ -0,0 +1,425 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/optimize_size.h"
+#include "azure_c_shared_utility/macro_utils.h"
+#include "azure_c_shared_utility/xlogging.h"
+#include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/condition.h"
+#include "azure_c_shared_utility/threadapi.h"
+#include "azure_c_shared_utility/tickcounter.h"
+#include "azure_c_shared_utility/doublylinkedlist.h"
+
+#include "iothub_client_worker_pool.h"
+
+/*IoTHubWorkerPool_Remove waits at most this long between 2 checks that the item stopped running*/
+#define WORKER_POOL_REMOVE_WAIT_MS  10
+
+#define WORKER_POOL_ITEM_STATE_VALUES   \
+    WORKER_POOL_ITEM_WAITING,           \
+    WORKER_POOL_ITEM_READY,             \
+    WORKER_POOL_ITEM_RUNNING,           \
+    WORKER_POOL_ITEM_STOPPED
+
+DEFINE_ENUM(WORKER_POOL_ITEM_STATE, WORKER_POOL_ITEM_STATE_VALUES)
+
+typedef struct IOTHUB_WORKER_POOL_ITEM_TAG
+{
+    struct IOTHUB_WORKER_POOL_TAG* pool;
+    IOTHUB_WORKER_POOL_WORK work;
+    void* context;
+    DLIST_ENTRY entry;              /*in the ready list of the pool when READY, in its waiting list when WAITING*/
+    tickcounter_ms_t due;           /*when a WAITING item becomes ready*/
+    WORKER_POOL_ITEM_STATE state;
+    bool signaled;                  /*set when the item is signaled while it runs, so that it runs again right away*/
+    bool removing;                  /*set by IoTHubWorkerPool_Remove while it waits for the item to stop running*/
+} IOTHUB_WORKER_POOL_ITEM;
+
+typedef struct IOTHUB_WORKER_POOL_TAG
+{
+    LOCK_HANDLE lock;               /*protects everything below and the lists and states of the items*/
+    COND_HANDLE work_signal;        /*signaled when an item becomes ready or the threads have to stop*/
+    COND_HANDLE done_signal;        /*signaled when an item being removed stops running*/
+    TICK_COUNTER_HANDLE tick_counter;
+    DLIST_ENTRY ready;              /*items to run, in the order they became ready*/
+    DLIST_ENTRY waiting;            /*items waiting for their due time, sorted by due time*/
+    size_t item_count;
+    THREAD_HANDLE* threads;
+    size_t thread_count;
+    int stop;
+} IOTHUB_WORKER_POOL;
+
+static int get_current_ms(IOTHUB_WORKER_POOL* pool, tickcounter_ms_t* current_ms)
+{
+    int result;
+    if (tickcounter_get_current_ms(pool->tick_counter, current_ms) != 0)
+    {
+        LogError("unable to tickcounter_get_current_ms");
+        result = __FAILURE__;
+    }
+    else
+    {
+        result = 0;
+    }
+    return result;
+}
+
+/*called with the pool lock held, returns the next item to run or NULL and the time to wait for the next item to be due (0 when there is none)*/
+static IOTHUB_WORKER_POOL_ITEM* take_ready_item(IOTHUB_WORKER_POOL* pool, int* wait_ms)
+{
+    IOTHUB_WORKER_POOL_ITEM* result;
+    *wait_ms = 0;
+    if (!DList_IsListEmpty(&pool->ready))
+    {
+        result = containingRecord(DList_RemoveHeadList(&pool->ready), IOTHUB_WORKER_POOL_ITEM, entry);
+    }
+    else if (DList_IsListEmpty(&pool->waiting))
+    {
+        result = NULL;
+    }
+    else
+    {
+        IOTHUB_WORKER_POOL_ITEM* first = containingRecord(pool->waiting.Flink, IOTHUB_WORKER_POOL_ITEM, entry);
+        tickcounter_ms_t current_ms;
+        /*Codes_SRS_IOTHUB_CLIENT_WORKER_POOL_31_011: [ A waiting item shall become ready when the delay returned by its last run elapsed. ]*/
+        if ((get_current_ms(pool, &current_ms) != 0) || (current_ms >= first->due))
+        {
+            (void)DList_RemoveEntryList(&first->entry);
+            result = first;
+        }
+        else
+        {
+            tickcounter_ms_t remaining = first->due - current_ms;
+            *wait_ms = (remaining > INT_MAX) ? INT_MAX : (int)remaining;
+            result = NULL;
+        }
+    }
+    return result;
+}
+
+/*called with the pool lock held*/
+static void make_item_ready(IOTHUB_WORKER_POOL* pool, IOTHUB_WORKER_POOL_ITEM* item)
+{
+    item->state = WORKER_POOL_ITEM_READY;
+    DList_InsertTailList(&pool->ready, &item->entry);
+    if (Condition_Post(pool->work_signal) != COND_OK)
+    {
+        LogError("unable to Condition_Post");
+    }
+}
+
+/*called with the pool lock held, keeps the waiting list sorted by due time. Items usually wait for the same delay, so they are inserted near the tail*/
+static void make_item_wait(IOTHUB_WORKER_POOL* pool, IOTHUB_WORKER_POOL_ITEM* item, unsigned int delay_ms)
+{
+    tickcounter_ms_t current_ms;
+    if (get_current_ms(pool, &current_ms) != 0)
+    {
+        make_item_ready(pool, item);
+    }
+    else
+    {
+        PDLIST_ENTRY previous = pool->waiting.Blink;
+        item->due = current_ms + delay_ms;
+        while ((previous != &pool->waiting) && (containingRecord(previous, IOTHUB_WORKER_POOL_ITEM, entry)->due > item->due))
+        {
+            previous = previous->Blink;
+        }
+        item->state = WORKER_POOL_ITEM_WAITING;
+        DList_InsertHeadList(previous, &item->entry);
+        /*Codes_SRS_IOTHUB_CLIENT_WORKER_POOL_31_018: [ When an item becomes the first waiting item, the threads of the pool waiting for work shall be woken up so that they wait for its due time instead. ]*/
+        if ((previous == &pool->waiting) && (Condition_Post(pool->work_signal) != COND_OK))
+        {
+            LogError("unable to Condition_Post");
+        }
+    }
+}
+
+static int WorkerPool_Thread(void* threadArgument)
+{
+    IOTHUB_WORKER_POOL* pool = (IOTHUB_WORKER_POOL*)threadArgument;
+    bool isLocked = (Lock(pool->lock) == LOCK_OK);
+
+    if (!isLocked)
+    {
+        LogError("unable to Lock");
+    }
+
+    while (isLocked)
+    {
+        int wait_ms;
+        IOTHUB_WORKER_POOL_ITEM* item = take_ready_item(pool, &wait_ms);
+        if (item != NULL)
+        {
+            unsigned int delay_ms;
+
+            /*Codes_SRS_IOTHUB_CLIENT_WORKER_POOL_31_012: [ A thread of the pool shall take the item that became ready first, mark it as running and call its work function without holding the lock of the pool, so that an item never runs on two threads at the same time. ]*/
+            item->state = WORKER_POOL_ITEM_RUNNING;
+            item->signaled = false;
+            (void)Unlock(pool->lock);
+
+            delay_ms = item->work(item->context);
+
+            isLocked = (Lock(pool->lock) == LOCK_OK);
+            if (!isLocked)
+            {
+                LogError("unable to Lock");
+            }
+            else if (item->removing)
+            {
+                item->state = WORKER_POOL_ITEM_STOPPED;
+                if (Condition_Post(pool->done_signal) != COND_OK)
+                {
+                    LogError("unable to Condition_Post");
+                }
+            }
+            /*Codes_SRS_IOTHUB_CLIENT_WORKER_POOL_31_013: [ After it ran, an item shall be ready again if it was signaled while it ran or its work function returned 0, otherwise it shall wait for the number of milliseconds returned by its work function. ]*/
+            else if (item->signaled || (delay_ms == 0))
+            {
+                make_item_ready(pool, item);
+            }
+            else
+            {
+                make_item_wait(pool, item, delay_ms);
+            }
+        }
+        /*Codes_SRS_IOTHUB_CLIENT_WORKER_POOL_31_014: [ The threads of the pool shall exit when IoTHubWorkerPool_Destroy is called. ]*/
+        else if (pool->stop)
+        {
+            (void)Unlock(pool->lock);
+            break;
+        }
+        else if (Condition_Wait(pool->work_signal, pool->lock, wait_ms) == COND_ERROR)
+        {
+            LogError("Condition_Wait failed");
+        }
+    }
+
+    return 0;
+}
+
+static void stop_threads(IOTHUB_WORKER_POOL* pool)
+{
+    size_t index;
+    if (Lock(pool->lock) != LOCK_OK)
+    {
+        LogError("unable to Lock");
+    }
+    else
+    {
+        pool->stop = 1;
+        for (index = 0; index < pool->thread_count; index++)
+        {
+            if (Condition_Post(pool->work_signal) != COND_OK)
+            {
+                LogError("unable to Condition_Post");
+            }
+        }
+        (void)Unlock(pool->lock);
+    }
+
+    for (index = 0; index < pool->thread_count; index++)
+    {
+        int res;
+        if (ThreadAPI_Join(pool->threads[index], &res) != THREADAPI_OK)
+        {
+            LogError("ThreadAPI_Join failed");
+        }
+    }
+    pool->thread_count = 0;
+}
+
+static void free_pool(IOTHUB_WORKER_POOL* pool)
+{
+    if (pool->threads != NULL)
+    {
+        free(pool->threads);
+    }
+    if (pool->tick_counter != NULL)
+    {
+        tickcounter_destroy(pool->tick_counter);
+    }
+    if (pool->done_signal != NULL)
+    {
+        Condition_Deinit(pool->done_signal);
+    }
+    if (pool->work_signal != NULL)
+    {
+        Condition_Deinit(pool->work_signal);
+    }
+    if (pool->lock != NULL)
+    {
+        Lock_Deinit(pool->lock);
+    }
+    free(pool);
+}
+
+IOTHUB_WORKER_POOL_HANDLE IoTHubWorkerPool_Create(size_t thread_count)
+{
+    IOTHUB_WORKER_POOL* result;
+    /*Codes_SRS_IOTHUB_CLIENT_WORKER_POOL_31_001: [ If thread_count is 0, IoTHubWorkerPool_Create shall fail and return NULL. ]*/
+    if (thread_count == 0)
+    {
+        LogError("invalid argument size_t thread_count=0");
+        result = NULL;
+    }
+    else if ((result = (IOTHUB_WORKER_POOL*)malloc(sizeof(IOTHUB_WORKER_POOL))) == NULL)
+    {
+        /*Codes_SRS_IOTHUB_CLIENT_WORKER_POOL_31_002: [ If allocating memory or creating the lock, the conditions, the tick counter or a thread fails, IoTHubWorkerPool_Create shall fail and return NULL. ]*/
+        LogError("unable to malloc");
+    }
+    else
+    {
+        (void)memset(result, 0, sizeof(IOTHUB_WORKER_POOL));
+        DList_InitializeListHead(&result->ready);
+        DList_InitializeListHead(&result->waiting);
+
+        if (((result->lock = Lock_Init()) == NULL) ||
+            ((result->work_signal = Condition_Init()) == NULL) ||
+            ((result->done_signal = Condition_Init()) == NULL) ||
+            ((result->tick_counter = tickcounter_create()) == NULL) ||
+            ((result->threads = (THREAD_HANDLE*)malloc(thread_count * sizeof(THREAD_HANDLE))) == NULL))
+        {
+            LogError("unable to create the pool");
+            free_pool(result);
+            result = NULL;
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUB_CLIENT_WORKER_POOL_31_003: [ IoTHubWorkerPool_Create shall start thread_count threads and return the handle of the pool. ]*/
+            while (result->thread_count < thread_count)
+            {
+                if (ThreadAPI_Create(&result->threads[result->thread_count], WorkerPool_Thread, result) != THREADAPI_OK)
+                {
+                    break;
+                }
+                result->thread_count++;
+            }
+
+            if (result->thread_count < thread_count)
+            {
+                LogError("ThreadAPI_Create failed");
+                stop_threads(result);
+                free_pool(result);
+                result = NULL;
+            }
+        }
+    }
+    return result;
+}
+
+void IoTHubWorkerPool_Destroy(IOTHUB_WORKER_POOL_HANDLE pool)
+{
+    /*Codes_SRS_IOTHUB_CLIENT_WORKER_POOL_31_004: [ If pool is NULL, IoTHubWorkerPool_Destroy shall do nothing. ]*/
+    if (pool != NULL)
+    {
+        /*Codes_SRS_IOTHUB_CLIENT_WORKER_POOL_31_005: [ IoTHubWorkerPool_Destroy shall stop and join the threads of the pool and free it. ]*/
+        stop_threads(pool);
+        if (pool->item_count != 0)
+        {
+            LogError("%lu clients still use the pool, they have to be destroyed before the pool", (unsigned long)pool->item_count);
+        }
+        free_pool(pool);
+    }
+}
+
+IOTHUB_WORKER_POOL_ITEM_HANDLE IoTHubWorkerPool_Add(IOTHUB_WORKER_POOL_HANDLE pool, IOTHUB_WORKER_POOL_WORK work, void* context)
+{
+    IOTHUB_WORKER_POOL_ITEM* result;
+    /*Codes_SRS_IOTHUB_CLIENT_WORKER_POOL_31_006: [ If pool or work is NULL, IoTHubWorkerPool_Add shall fail and return NULL. ]*/
+    if ((pool == NULL) || (work == NULL))
+    {
+        LogError("invalid arg (NULL)");
+        result = NULL;
+    }
+    else if ((result = (IOTHUB_WORKER_POOL_ITEM*)malloc(sizeof(IOTHUB_WORKER_POOL_ITEM))) == NULL)
+    {
+        /*Codes_SRS_IOTHUB_CLIENT_WORKER_POOL_31_007: [ If allocating memory or taking the lock of the pool fails, IoTHubWorkerPool_Add shall fail and return NULL. ]*/
+        LogError("unable to malloc");
+    }
+    else if (Lock(pool->lock) != LOCK_OK)
+    {
+        LogError("unable to Lock");
+        free(result);
+        result = NULL;
+    }
+    else
+    {
+        result->pool = pool;
+        result->work = work;
+        result->context = context;
+        result->due = 0;
+        result->signaled = false;
+        result->removing = false;
+        /*Codes_SRS_IOTHUB_CLIENT_WORKER_POOL_31_008: [ IoTHubWorkerPool_Add shall add an item running work with context to the pool, ready to run, and return its handle. ]*/
+        make_item_ready(pool, result);
+        pool->item_count++;
+        (void)Unlock(pool->lock);
+    }
+    return result;
+}
+
+void IoTHubWorkerPool_Signal(IOTHUB_WORKER_POOL_ITEM_HANDLE item)
+{
+    /*Codes_SRS_IOTHUB_CLIENT_WORKER_POOL_31_009: [ If item is NULL, IoTHubWorkerPool_Signal shall do nothing. ]*/
+    if (item != NULL)
+    {
+        IOTHUB_WORKER_POOL* pool = item->pool;
+        if (Lock(pool->lock) != LOCK_OK)
+        {
+            LogError("unable to Lock, the item runs when its delay elapses");
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUB_CLIENT_WORKER_POOL_31_010: [ IoTHubWorkerPool_Signal shall make a waiting item ready, and a running item ready again once it finished running. ]*/
+            if (item->state == WORKER_POOL_ITEM_WAITING)
+            {
+                (void)DList_RemoveEntryList(&item->entry);
+                make_item_ready(pool, item);
+            }
+            else if (item->state == WORKER_POOL_ITEM_RUNNING)
+            {
+                item->signaled = true;
+            }
+            (void)Unlock(pool->lock);
+        }
+    }
+}
+
+void IoTHubWorkerPool_Remove(IOTHUB_WORKER_POOL_ITEM_HANDLE item)
+{
+    /*Codes_SRS_IOTHUB_CLIENT_WORKER_POOL_31_015: [ If item is NULL, IoTHubWorkerPool_Remove shall do nothing. ]*/
+    if (item != NULL)
+    {
+        IOTHUB_WORKER_POOL* pool = item->pool;
+        if (Lock(pool->lock) != LOCK_OK)
+        {
+            LogError("unable to Lock, the item is leaked");
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUB_CLIENT_WORKER_POOL_31_016: [ If the item is running, IoTHubWorkerPool_Remove shall wait until it finished running. ]*/
+            item->removing = true;
+            while (item->state == WORKER_POOL_ITEM_RUNNING)
+            {
+                if (Condition_Wait(pool->done_signal, pool->lock, WORKER_POOL_REMOVE_WAIT_MS) == COND_ERROR)
+                {
+                    LogError("Condition_Wait failed");
+                }
+            }
+
+            /*Codes_SRS_IOTHUB_CLIENT_WORKER_POOL_31_017: [ IoTHubWorkerPool_Remove shall take the item out of the pool and free it, its work function is not called anymore. ]*/
+            if ((item->state == WORKER_POOL_ITEM_READY) || (item->state == WORKER_POOL_ITEM_WAITING))
+            {
+                (void)DList_RemoveEntryList(&item->entry);
+            }
+            pool->item_count--;
+            (void)Unlock(pool->lock);
+            free(item);
+        }
+    }
+}
@@ -6,6 +6,7 @@
 #include "azure_c_shared_utility/gballoc.h"
 #include "azure_c_shared_utility/xlogging.h"
 #include "azure_c_shared_utility/buffer_.h"
+#include "azure_c_shared_utility/refcount.h"
 
 #include "iothub_message.h"
 
@@ -26,8 +27,13 @@ typedef struct IOTHUB_MESSAGE_HANDLE_DATA_TAG
     MAP_HANDLE properties;
     char* messageId;
     char* correlationId;
+    bool isImmutable; /*once set, the message is never modified again and IoTHubMessage_Clone shares it*/
+    IOTHUB_MESSAGE_PRIORITY priority;
+    time_t expiryTime; /*(time_t)0 when the message never expires*/
 }IOTHUB_MESSAGE_HANDLE_DATA;
 
+DEFINE_REFCOUNT_TYPE(IOTHUB_MESSAGE_HANDLE_DATA);
+
 static bool ContainsOnlyUsAscii(const char* asciiValue)
 {
     bool result = true;
@@ -70,7 +76,7 @@ IOTHUB_MESSAGE_HANDLE IoTHubMessage_CreateFromByteArray(const unsigned char* byt
     }
     else
     {
-        result = (IOTHUB_MESSAGE_HANDLE_DATA*)malloc(sizeof(IOTHUB_MESSAGE_HANDLE_DATA));
+        result = REFCOUNT_TYPE_CREATE(IOTHUB_MESSAGE_HANDLE_DATA);
         if (result == NULL)
         {
             LogError("unable to malloc");
@@ -127,6 +133,11 @@ IOTHUB_MESSAGE_HANDLE IoTHubMessage_CreateFromByteArray(const unsigned char* byt
                     result->contentType = IOTHUBMESSAGE_BYTEARRAY;
                     result->messageId = NULL;
                     result->correlationId = NULL;
+                    result->isImmutable = false;
+                    /*Codes_SRS_IOTHUBMESSAGE_31_007: [ A new message shall have the priority IOTHUB_MESSAGE_PRIORITY_NORMAL. ]*/
+                    result->priority = IOTHUB_MESSAGE_PRIORITY_NORMAL;
+                    /*Codes_SRS_IOTHUBMESSAGE_31_014: [ A new message shall never expire. ]*/
+                    result->expiryTime = (time_t)0;
                     /*all is fine, return result*/
                 }
             }
@@ -145,7 +156,7 @@ IOTHUB_MESSAGE_HANDLE IoTHubMessage_CreateFromString(const char* source)
     }
     else
     {
-        result = (IOTHUB_MESSAGE_HANDLE_DATA*)malloc(sizeof(IOTHUB_MESSAGE_HANDLE_DATA));
+        result = REFCOUNT_TYPE_CREATE(IOTHUB_MESSAGE_HANDLE_DATA);
         if (result == NULL)
         {
             LogError("malloc failed");
@@ -178,6 +189,11 @@ IOTHUB_MESSAGE_HANDLE IoTHubMessage_CreateFromString(const char* source)
                 result->contentType = IOTHUBMESSAGE_STRING;
                 result->messageId = NULL;
                 result->correlationId = NULL;
+                result->isImmutable = false;
+                /*Codes_SRS_IOTHUBMESSAGE_31_007: [ A new message shall have the priority IOTHUB_MESSAGE_PRIORITY_NORMAL. ]*/
+                result->priority = IOTHUB_MESSAGE_PRIORITY_NORMAL;
+                /*Codes_SRS_IOTHUBMESSAGE_31_014: [ A new message shall never expire. ]*/
+                result->expiryTime = (time_t)0;
             }
         }
     }
@@ -195,9 +211,15 @@ IOTHUB_MESSAGE_HANDLE IoTHubMessage_Clone(IOTHUB_MESSAGE_HANDLE iotHubMessageHan
         result = NULL;
         LogError("iotHubMessageHandle parameter cannot be NULL for IoTHubMessage_Clone");
     }
+    else if (source->isImmutable)
+    {
+        /*Codes_SRS_IOTHUBMESSAGE_31_002: [ If iotHubMessageHandle is immutable, IoTHubMessage_Clone shall not copy anything, it shall increment the reference count of iotHubMessageHandle and return iotHubMessageHandle. ]*/
+        result = (IOTHUB_MESSAGE_HANDLE_DATA*)source;
+        INC_REF(IOTHUB_MESSAGE_HANDLE_DATA, result);
+    }
     else
     {
-        result = (IOTHUB_MESSAGE_HANDLE_DATA*)malloc(sizeof(IOTHUB_MESSAGE_HANDLE_DATA));
+        result = REFCOUNT_TYPE_CREATE(IOTHUB_MESSAGE_HANDLE_DATA);
         /*Codes_SRS_IOTHUBMESSAGE_03_004: [IoTHubMessage_Clone shall return NULL if it fails for any reason.]*/
         if (result == NULL)
         {
@@ -209,6 +231,12 @@ IOTHUB_MESSAGE_HANDLE IoTHubMessage_Clone(IOTHUB_MESSAGE_HANDLE iotHubMessageHan
         {
             result->messageId = NULL;
             result->correlationId = NULL;
+            /*Codes_SRS_IOTHUBMESSAGE_31_003: [ A copy made by IoTHubMessage_Clone shall not be immutable. ]*/
+            result->isImmutable = false;
+            /*Codes_SRS_IOTHUBMESSAGE_31_008: [ IoTHubMessage_Clone shall copy the priority of the message. ]*/
+            result->priority = source->priority;
+            /*Codes_SRS_IOTHUBMESSAGE_31_015: [ IoTHubMessage_Clone shall copy the expiry time of the message. ]*/
+            result->expiryTime = source->expiryTime;
             if (source->messageId != NULL && mallocAndStrcpy_s(&result->messageId, source->messageId) != 0)
             {
                 LogError("unable to Copy messageId");
@@ -409,7 +437,35 @@ MAP_HANDLE IoTHubMessage_Properties(IOTHUB_MESSAGE_HANDLE iotHubMessageHandle)
     }
     else
     {
-        /*Codes_SRS_IOTHUBMESSAGE_02_002: [Otherwise, for any non-NULL iotHubMessageHandle it shall return a non-NULL MAP_HANDLE.]*/
+        IOTHUB_MESSAGE_HANDLE_DATA* handleData = (IOTHUB_MESSAGE_HANDLE_DATA*)iotHubMessageHandle;
+        if (handleData->isImmutable)
+        {
+            /*the properties map of an immutable message is shared with every clone of the message, it is only handed out by IoTHubMessage_ReadOnlyProperties*/
+            /*Codes_SRS_IOTHUBMESSAGE_31_021: [ If the message is immutable, IoTHubMessage_Properties shall return NULL. ]*/
+            LogError("the message is immutable, its properties cannot be changed");
+            result = NULL;
+        }
+        else
+        {
+            /*Codes_SRS_IOTHUBMESSAGE_02_002: [Otherwise, for any non-NULL iotHubMessageHandle it shall return a non-NULL MAP_HANDLE.]*/
+            result = handleData->properties;
+        }
+    }
+    return result;
+}
+
+MAP_HANDLE IoTHubMessage_ReadOnlyProperties(IOTHUB_MESSAGE_HANDLE iotHubMessageHandle)
+{
+    MAP_HANDLE result;
+    /*Codes_SRS_IOTHUBMESSAGE_31_023: [ If iotHubMessageHandle is NULL then IoTHubMessage_ReadOnlyProperties shall return NULL. ]*/
+    if (iotHubMessageHandle == NULL)
+    {
+        LogError("invalid arg (NULL) passed to IoTHubMessage_ReadOnlyProperties");
+        result = NULL;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBMESSAGE_31_024: [ Otherwise IoTHubMessage_ReadOnlyProperties shall return the properties map of the message, also when the message is immutable. ]*/
         IOTHUB_MESSAGE_HANDLE_DATA* handleData = (IOTHUB_MESSAGE_HANDLE_DATA*)iotHubMessageHandle;
         result = handleData->properties;
     }
@@ -446,21 +502,30 @@ IOTHUB_MESSAGE_RESULT IoTHubMessage_SetCorrelationId(IOTHUB_MESSAGE_HANDLE iotHu
     else
     {
         IOTHUB_MESSAGE_HANDLE_DATA* handleData = iotHubMessageHandle;
-        /* Codes_SRS_IOTHUBMESSAGE_07_019: [If the IOTHUB_MESSAGE_HANDLE correlationId is not NULL, then the IOTHUB_MESSAGE_HANDLE correlationId will be deallocated.] */
-        if (handleData->correlationId != NULL)
-        {
-            free(handleData->correlationId);
-        }
-
-        if (mallocAndStrcpy_s(&handleData->correlationId, correlationId) != 0)
+        if (handleData->isImmutable)
         {
-            /* Codes_SRS_IOTHUBMESSAGE_07_020: [If the allocation or the copying of the correlationId fails, then IoTHubMessage_SetCorrelationId shall return IOTHUB_MESSAGE_ERROR.] */
+            /*Codes_SRS_IOTHUBMESSAGE_31_004: [ IoTHubMessage_SetMessageId and IoTHubMessage_SetCorrelationId shall fail and return IOTHUB_MESSAGE_ERROR if the message is immutable. ]*/
+            LogError("the message is immutable, its correlationId cannot be changed");
             result = IOTHUB_MESSAGE_ERROR;
         }
         else
         {
-            /* Codes_SRS_IOTHUBMESSAGE_07_021: [IoTHubMessage_SetCorrelationId finishes successfully it shall return IOTHUB_MESSAGE_OK.] */
-            result = IOTHUB_MESSAGE_OK;
+            /* Codes_SRS_IOTHUBMESSAGE_07_019: [If the IOTHUB_MESSAGE_HANDLE correlationId is not NULL, then the IOTHUB_MESSAGE_HANDLE correlationId will be deallocated.] */
+            if (handleData->correlationId != NULL)
+            {
+                free(handleData->correlationId);
+            }
+
+            if (mallocAndStrcpy_s(&handleData->correlationId, correlationId) != 0)
+        {
+                /* Codes_SRS_IOTHUBMESSAGE_07_020: [If the allocation or the copying of the correlationId fails, then IoTHubMessage_SetCorrelationId shall return IOTHUB_MESSAGE_ERROR.] */
+                result = IOTHUB_MESSAGE_ERROR;
+            }
+            else
+            {
+                /* Codes_SRS_IOTHUBMESSAGE_07_021: [IoTHubMessage_SetCorrelationId finishes successfully it shall return IOTHUB_MESSAGE_OK.] */
+                result = IOTHUB_MESSAGE_OK;
+            }
         }
     }
     return result;
@@ -478,20 +543,29 @@ IOTHUB_MESSAGE_RESULT IoTHubMessage_SetMessageId(IOTHUB_MESSAGE_HANDLE iotHubMes
     else
     {
         IOTHUB_MESSAGE_HANDLE_DATA* handleData = iotHubMessageHandle;
-        /* Codes_SRS_IOTHUBMESSAGE_07_013: [If the IOTHUB_MESSAGE_HANDLE messageId is not NULL, then the IOTHUB_MESSAGE_HANDLE messageId will be freed] */
-        if (handleData->messageId != NULL)
-        {
-            free(handleData->messageId);
-        }
-
-        /* Codes_SRS_IOTHUBMESSAGE_07_014: [If the allocation or the copying of the messageId fails, then IoTHubMessage_SetMessageId shall return IOTHUB_MESSAGE_ERROR.] */
-        if (mallocAndStrcpy_s(&handleData->messageId, messageId) != 0)
+        if (handleData->isImmutable)
         {
+            /*Codes_SRS_IOTHUBMESSAGE_31_004: [ IoTHubMessage_SetMessageId and IoTHubMessage_SetCorrelationId shall fail and return IOTHUB_MESSAGE_ERROR if the message is immutable. ]*/
+            LogError("the message is immutable, its messageId cannot be changed");
             result = IOTHUB_MESSAGE_ERROR;
         }
         else
         {
-            result = IOTHUB_MESSAGE_OK;
+            /* Codes_SRS_IOTHUBMESSAGE_07_013: [If the IOTHUB_MESSAGE_HANDLE messageId is not NULL, then the IOTHUB_MESSAGE_HANDLE messageId will be freed] */
+            if (handleData->messageId != NULL)
+            {
+                free(handleData->messageId);
+            }
+
+            /* Codes_SRS_IOTHUBMESSAGE_07_014: [If the allocation or the copying of the messageId fails, then IoTHubMessage_SetMessageId shall return IOTHUB_MESSAGE_ERROR.] */
+            if (mallocAndStrcpy_s(&handleData->messageId, messageId) != 0)
+            {
+                result = IOTHUB_MESSAGE_ERROR;
+            }
+            else
+            {
+                result = IOTHUB_MESSAGE_OK;
+            }
         }
     }
     return result;
@@ -515,30 +589,146 @@ const char* IoTHubMessage_GetMessageId(IOTHUB_MESSAGE_HANDLE iotHubMessageHandle
     return result;
 }
 
-void IoTHubMessage_Destroy(IOTHUB_MESSAGE_HANDLE iotHubMessageHandle)
+IOTHUB_MESSAGE_RESULT IoTHubMessage_SetImmutable(IOTHUB_MESSAGE_HANDLE iotHubMessageHandle)
 {
-    /*Codes_SRS_IOTHUBMESSAGE_01_004: [If iotHubMessageHandle is NULL, IoTHubMessage_Destroy shall do nothing.] */
-    if (iotHubMessageHandle != NULL)
+    IOTHUB_MESSAGE_RESULT result;
+    /*Codes_SRS_IOTHUBMESSAGE_31_005: [ If iotHubMessageHandle is NULL, IoTHubMessage_SetImmutable shall return IOTHUB_MESSAGE_INVALID_ARG. ]*/
+    if (iotHubMessageHandle == NULL)
+    {
+        LogError("invalid arg (NULL) passed to IoTHubMessage_SetImmutable");
+        result = IOTHUB_MESSAGE_INVALID_ARG;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBMESSAGE_31_001: [ IoTHubMessage_SetImmutable shall mark the message as immutable and return IOTHUB_MESSAGE_OK. ]*/
+        IOTHUB_MESSAGE_HANDLE_DATA* handleData = iotHubMessageHandle;
+        handleData->isImmutable = true;
+        result = IOTHUB_MESSAGE_OK;
+    }
+    return result;
+}
+
+IOTHUB_MESSAGE_RESULT IoTHubMessage_SetPriority(IOTHUB_MESSAGE_HANDLE iotHubMessageHandle, IOTHUB_MESSAGE_PRIORITY priority)
+{
+    IOTHUB_MESSAGE_RESULT result;
+    /*Codes_SRS_IOTHUBMESSAGE_31_009: [ If iotHubMessageHandle is NULL or priority is not a IOTHUB_MESSAGE_PRIORITY value, IoTHubMessage_SetPriority shall return IOTHUB_MESSAGE_INVALID_ARG. ]*/
+    if ((iotHubMessageHandle == NULL) ||
+        ((priority != IOTHUB_MESSAGE_PRIORITY_LOW) && (priority != IOTHUB_MESSAGE_PRIORITY_NORMAL) && (priority != IOTHUB_MESSAGE_PRIORITY_HIGH)))
+    {
+        LogError("invalid arg passed to IoTHubMessage_SetPriority, iotHubMessageHandle=%p, priority=%d", iotHubMessageHandle, (int)priority);
+        result = IOTHUB_MESSAGE_INVALID_ARG;
+    }
+    else
     {
-        /*Codes_SRS_IOTHUBMESSAGE_01_003: [IoTHubMessage_Destroy shall free all resources associated with iotHubMessageHandle.]  */
         IOTHUB_MESSAGE_HANDLE_DATA* handleData = iotHubMessageHandle;
-        if (handleData->contentType == IOTHUBMESSAGE_BYTEARRAY)
+        if (handleData->isImmutable)
         {
-            BUFFER_delete(handleData->value.byteArray);
+            /*Codes_SRS_IOTHUBMESSAGE_31_010: [ IoTHubMessage_SetPriority shall fail and return IOTHUB_MESSAGE_ERROR if the message is immutable. ]*/
+            LogError("the message is immutable, its priority cannot be changed");
+            result = IOTHUB_MESSAGE_ERROR;
         }
-        else if (handleData->contentType == IOTHUBMESSAGE_STRING)
+        else
         {
-            STRING_delete(handleData->value.string);
+            /*Codes_SRS_IOTHUBMESSAGE_31_011: [ Otherwise IoTHubMessage_SetPriority shall set the priority of the message and return IOTHUB_MESSAGE_OK. ]*/
+            handleData->priority = priority;
+            result = IOTHUB_MESSAGE_OK;
+        }
+    }
+    return result;
+}
+
+IOTHUB_MESSAGE_PRIORITY IoTHubMessage_GetPriority(IOTHUB_MESSAGE_HANDLE iotHubMessageHandle)
+{
+    IOTHUB_MESSAGE_PRIORITY result;
+    /*Codes_SRS_IOTHUBMESSAGE_31_012: [ If iotHubMessageHandle is NULL, IoTHubMessage_GetPriority shall return IOTHUB_MESSAGE_PRIORITY_NORMAL. ]*/
+    if (iotHubMessageHandle == NULL)
+    {
+        LogError("invalid arg (NULL) passed to IoTHubMessage_GetPriority");
+        result = IOTHUB_MESSAGE_PRIORITY_NORMAL;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBMESSAGE_31_013: [ IoTHubMessage_GetPriority shall return the priority of the message. ]*/
+        IOTHUB_MESSAGE_HANDLE_DATA* handleData = iotHubMessageHandle;
+        result = handleData->priority;
+    }
+    return result;
+}
+
+IOTHUB_MESSAGE_RESULT IoTHubMessage_SetExpiryTime(IOTHUB_MESSAGE_HANDLE iotHubMessageHandle, time_t expiryTime)
+{
+    IOTHUB_MESSAGE_RESULT result;
+    /*Codes_SRS_IOTHUBMESSAGE_31_016: [ If iotHubMessageHandle is NULL, IoTHubMessage_SetExpiryTime shall return IOTHUB_MESSAGE_INVALID_ARG. ]*/
+    if (iotHubMessageHandle == NULL)
+    {
+        LogError("invalid arg (NULL) passed to IoTHubMessage_SetExpiryTime");
+        result = IOTHUB_MESSAGE_INVALID_ARG;
+    }
+    else
+    {
+        IOTHUB_MESSAGE_HANDLE_DATA* handleData = iotHubMessageHandle;
+        if (handleData->isImmutable)
+        {
+            /*Codes_SRS_IOTHUBMESSAGE_31_017: [ IoTHubMessage_SetExpiryTime shall fail and return IOTHUB_MESSAGE_ERROR if the message is immutable. ]*/
+            LogError("the message is immutable, its expiry time cannot be changed");
+            result = IOTHUB_MESSAGE_ERROR;
         }
         else
         {
-            LogError("Unknown contentType in IoTHubMessage");
+            /*Codes_SRS_IOTHUBMESSAGE_31_018: [ Otherwise IoTHubMessage_SetExpiryTime shall set the expiry time of the message and return IOTHUB_MESSAGE_OK. ]*/
+            handleData->expiryTime = expiryTime;
+            result = IOTHUB_MESSAGE_OK;
+        }
+    }
+    return result;
+}
+
+time_t IoTHubMessage_GetExpiryTime(IOTHUB_MESSAGE_HANDLE iotHubMessageHandle)
+{
+    time_t result;
+    /*Codes_SRS_IOTHUBMESSAGE_31_019: [ If iotHubMessageHandle is NULL, IoTHubMessage_GetExpiryTime shall return (time_t)0. ]*/
+    if (iotHubMessageHandle == NULL)
+    {
+        LogError("invalid arg (NULL) passed to IoTHubMessage_GetExpiryTime");
+        result = (time_t)0;
+    }
+    else
+    {
+        /*Codes_SRS_IOTHUBMESSAGE_31_020: [ IoTHubMessage_GetExpiryTime shall return the expiry time of the message. ]*/
+        IOTHUB_MESSAGE_HANDLE_DATA* handleData = iotHubMessageHandle;
+        result = handleData->expiryTime;
+    }
+    return result;
+}
+
+void IoTHubMessage_Destroy(IOTHUB_MESSAGE_HANDLE iotHubMessageHandle)
+{
+    /*Codes_SRS_IOTHUBMESSAGE_01_004: [If iotHubMessageHandle is NULL, IoTHubMessage_Destroy shall do nothing.] */
+    if (iotHubMessageHandle != NULL)
+    {
+        IOTHUB_MESSAGE_HANDLE_DATA* handleData = iotHubMessageHandle;
+        /*Codes_SRS_IOTHUBMESSAGE_31_006: [ IoTHubMessage_Destroy shall decrement the reference count of the message and shall only free its resources when the count reaches zero. ]*/
+        if (DEC_REF(IOTHUB_MESSAGE_HANDLE_DATA, handleData) == DEC_RETURN_ZERO)
+        {
+            /*Codes_SRS_IOTHUBMESSAGE_01_003: [IoTHubMessage_Destroy shall free all resources associated with iotHubMessageHandle.]  */
+            if (handleData->contentType == IOTHUBMESSAGE_BYTEARRAY)
+            {
+                BUFFER_delete(handleData->value.byteArray);
+            }
+            else if (handleData->contentType == IOTHUBMESSAGE_STRING)
+            {
+                STRING_delete(handleData->value.string);
+            }
+            else
+            {
+                LogError("Unknown contentType in IoTHubMessage");
+            }
+            Map_Destroy(handleData->properties);
+            free(handleData->messageId);
+            handleData->messageId = NULL;
+            free(handleData->correlationId);
+            handleData->correlationId = NULL;
+            free(handleData);
         }
-        Map_Destroy(handleData->properties);
-        free(handleData->messageId);
-        handleData->messageId = NULL;
-        free(handleData->correlationId);
-        handleData->correlationId = NULL;
-        free(handleData);
     }
 }
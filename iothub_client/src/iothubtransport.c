@@ -114,6 +114,8 @@ TRANSPORT_HANDLE  IoTHubTransport_Create(IOTHUB_CLIENT_TRANSPORT_PROVIDER protoc
 						result->IoTHubTransport_DoWork = transportProtocol->IoTHubTransport_DoWork;
                         result->IoTHubTransport_SetRetryPolicy = transportProtocol->IoTHubTransport_SetRetryPolicy;
 						result->IoTHubTransport_GetSendStatus = transportProtocol->IoTHubTransport_GetSendStatus;
+						result->IoTHubTransport_GetNextDeadline = transportProtocol->IoTHubTransport_GetNextDeadline;
+						result->IoTHubTransport_GetStatistics = transportProtocol->IoTHubTransport_GetStatistics;
 					}
 				}
 			}
@@ -49,6 +49,7 @@
 #define DEFAULT_RETRY_POLICY                      IOTHUB_CLIENT_RETRY_EXPONENTIAL_BACKOFF_WITH_JITTER
 // DEFAULT_MAX_RETRY_TIME_IN_SECS = 0 means infinite retry.
 #define DEFAULT_MAX_RETRY_TIME_IN_SECS            0
+#define TIMER_RESOLUTION_MS                       1000
 
 // ---------- Data Definitions ---------- //
 
@@ -97,6 +98,9 @@ typedef struct AMQP_TRANSPORT_INSTANCE_TAG
 
                                                                         // Auth module used to generating handle authorization
     IOTHUB_AUTHORIZATION_HANDLE authorization_module;                   // with either SAS Token, x509 Certs, and Device SAS Token
+
+    size_t events_in_flight;                                            // Events passed to device_send_event_async whose on_event_send_complete was not called yet.
+    size_t reconnection_count;                                          // Number of times the transport prepared for a connection retry.
 } AMQP_TRANSPORT_INSTANCE;
 
 typedef struct AMQP_TRANSPORT_DEVICE_INSTANCE_TAG
@@ -733,6 +737,8 @@ static void prepare_for_connection_retry(AMQP_TRANSPORT_INSTANCE* transport_inst
 {
     LogInfo("Preparing transport for re-connection");
 
+    transport_instance->reconnection_count++;
+
     // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_034: [`instance->tls_io` options shall be saved on `instance->saved_tls_options` using xio_retrieveoptions()]
     if (save_underlying_io_transport_options(transport_instance) != RESULT_OK)
     {
@@ -809,17 +815,24 @@ static bool is_device_credential_acceptable(const IOTHUB_DEVICE_CONFIG* device_c
 
 static IOTHUB_MESSAGE_LIST* get_next_event_to_send(AMQP_TRANSPORT_DEVICE_INSTANCE* registered_device)
 {
-    IOTHUB_MESSAGE_LIST* message;
+    IOTHUB_MESSAGE_LIST* message = NULL;
 
-    if (!DList_IsListEmpty(registered_device->waiting_to_send))
+    while ((message == NULL) && !DList_IsListEmpty(registered_device->waiting_to_send))
     {
         PDLIST_ENTRY list_entry = registered_device->waiting_to_send->Flink;
         message = containingRecord(list_entry, IOTHUB_MESSAGE_LIST, entry);
-        (void)DList_RemoveEntryList(list_entry);
-    }
-    else
-    {
-        message = NULL;
+
+        // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_31_012: [An event of `waiting_to_send` whose expiry time is past shall not be sent, IoTHubClient_LL_CompleteIfExpired completes it with IOTHUB_CLIENT_CONFIRMATION_MESSAGE_EXPIRED]
+        if ((message->expiryTime != (time_t)0) && IoTHubClient_LL_CompleteIfExpired(registered_device->iothub_client_handle, message))
+        {
+            message = NULL;
+        }
+        else
+        {
+            (void)DList_RemoveEntryList(list_entry);
+            // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_31_006: [When an event is taken from `waiting_to_send`, it shall be removed from the client's timeout queue]
+            timeout_queue_remove(&message->timeout_entry);
+        }
     }
 
     return message;
@@ -860,6 +873,11 @@ static void on_event_send_complete(IOTHUB_MESSAGE_LIST* message, D2C_EVENT_SEND_
 {
     AMQP_TRANSPORT_DEVICE_INSTANCE* registered_device = (AMQP_TRANSPORT_DEVICE_INSTANCE*)context;
 
+    if (registered_device->transport_instance->events_in_flight > 0)
+    {
+        registered_device->transport_instance->events_in_flight--;
+    }
+
     if (result != D2C_EVENT_SEND_COMPLETE_RESULT_OK && result != D2C_EVENT_SEND_COMPLETE_RESULT_DEVICE_DESTROYED)
     {
         registered_device->number_of_send_event_complete_failures++;
@@ -869,24 +887,20 @@ static void on_event_send_complete(IOTHUB_MESSAGE_LIST* message, D2C_EVENT_SEND_
         registered_device->number_of_send_event_complete_failures = 0;
     }
 
-    // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_056: [If `message->callback` is not NULL, it shall invoked with the `iothub_send_result`]
-    if (message->callback != NULL)
-    {
-        // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_050: [If result is D2C_EVENT_SEND_COMPLETE_RESULT_OK, `iothub_send_result` shall be set using IOTHUB_CLIENT_CONFIRMATION_OK]
-        // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_051: [If result is D2C_EVENT_SEND_COMPLETE_RESULT_ERROR_CANNOT_PARSE, `iothub_send_result` shall be set using IOTHUB_CLIENT_CONFIRMATION_ERROR]
-        // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_052: [If result is D2C_EVENT_SEND_COMPLETE_RESULT_ERROR_FAIL_SENDING, `iothub_send_result` shall be set using IOTHUB_CLIENT_CONFIRMATION_ERROR]
-        // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_053: [If result is D2C_EVENT_SEND_COMPLETE_RESULT_ERROR_TIMEOUT, `iothub_send_result` shall be set using IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT]
-        // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_054: [If result is D2C_EVENT_SEND_COMPLETE_RESULT_DEVICE_DESTROYED, `iothub_send_result` shall be set using IOTHUB_CLIENT_CONFIRMATION_BECAUSE_DESTROY]
-        // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_055: [If result is D2C_EVENT_SEND_COMPLETE_RESULT_ERROR_UNKNOWN, `iothub_send_result` shall be set using IOTHUB_CLIENT_CONFIRMATION_ERROR]
-        IOTHUB_CLIENT_CONFIRMATION_RESULT iothub_send_result = get_iothub_client_confirmation_result_from(result);
-
-        message->callback(iothub_send_result, message->context);
-    }
-
-    // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_057: [`message->messageHandle` shall be destroyed using IoTHubMessage_Destroy]
-    IoTHubMessage_Destroy(message->messageHandle);
-    // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_058: [`message` shall be destroyed using free]
-    free(message);
+    // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_050: [If result is D2C_EVENT_SEND_COMPLETE_RESULT_OK, `iothub_send_result` shall be set using IOTHUB_CLIENT_CONFIRMATION_OK]
+    // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_051: [If result is D2C_EVENT_SEND_COMPLETE_RESULT_ERROR_CANNOT_PARSE, `iothub_send_result` shall be set using IOTHUB_CLIENT_CONFIRMATION_ERROR]
+    // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_052: [If result is D2C_EVENT_SEND_COMPLETE_RESULT_ERROR_FAIL_SENDING, `iothub_send_result` shall be set using IOTHUB_CLIENT_CONFIRMATION_ERROR]
+    // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_053: [If result is D2C_EVENT_SEND_COMPLETE_RESULT_ERROR_TIMEOUT, `iothub_send_result` shall be set using IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT]
+    // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_054: [If result is D2C_EVENT_SEND_COMPLETE_RESULT_DEVICE_DESTROYED, `iothub_send_result` shall be set using IOTHUB_CLIENT_CONFIRMATION_BECAUSE_DESTROY]
+    // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_055: [If result is D2C_EVENT_SEND_COMPLETE_RESULT_ERROR_UNKNOWN, `iothub_send_result` shall be set using IOTHUB_CLIENT_CONFIRMATION_ERROR]
+    IOTHUB_CLIENT_CONFIRMATION_RESULT iothub_send_result = get_iothub_client_confirmation_result_from(result);
+
+    // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_31_008: [`message` shall be completed by passing a list holding only `message` and `iothub_send_result` to IoTHubClient_LL_SendComplete, which calls `message->callback`, destroys `message->messageHandle` and releases `message`]
+    // IoTHubClient_LL owns the record: it may come from its message pool and it is counted against the outbound queue limits
+    DLIST_ENTRY completed;
+    DList_InitializeListHead(&completed);
+    DList_InsertTailList(&completed, &message->entry);
+    IoTHubClient_LL_SendComplete(registered_device->iothub_client_handle, &completed, iothub_send_result);
 }
 
 // @brief
@@ -903,6 +917,9 @@ static int send_pending_events(AMQP_TRANSPORT_DEVICE_INSTANCE* device_state)
     // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_047: [If the registered device is started, each event on `registered_device->wait_to_send_list` shall be removed from the list and sent using device_send_event_async()]
     while ((message = get_next_event_to_send(device_state)) != NULL)
     {
+        // on_event_send_complete is invoked for this event whether device_send_event_async succeeds or not
+        device_state->transport_instance->events_in_flight++;
+
         // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_048: [device_send_event_async() shall be invoked passing `on_event_send_complete`]
         if (device_send_event_async(device_state->device_handle, message, on_event_send_complete, device_state) != RESULT_OK)
         {
@@ -1633,6 +1650,89 @@ IOTHUB_CLIENT_RESULT IoTHubTransport_AMQP_Common_GetSendStatus(IOTHUB_DEVICE_HAN
     return result;
 }
 
+int IoTHubTransport_AMQP_Common_GetNextDeadline(TRANSPORT_LL_HANDLE handle, tickcounter_ms_t* msUntilDeadline)
+{
+    int result;
+
+    // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_31_001: [If `handle` or `msUntilDeadline` are NULL, IoTHubTransport_AMQP_Common_GetNextDeadline shall fail and return non-zero]
+    if (handle == NULL || msUntilDeadline == NULL)
+    {
+        LogError("Failed retrieving the next deadline (either handle (%p) or msUntilDeadline (%p) are NULL)", handle, msUntilDeadline);
+        result = __FAILURE__;
+    }
+    else
+    {
+        AMQP_TRANSPORT_INSTANCE* transport_instance = (AMQP_TRANSPORT_INSTANCE*)handle;
+        LIST_ITEM_HANDLE list_item = singlylinkedlist_get_head_item(transport_instance->registered_devices);
+
+        // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_31_002: [If there are no devices registered and no connection exists, `msUntilDeadline` shall be set to IOTHUB_CLIENT_LL_NO_DEADLINE]
+        if (list_item == NULL && transport_instance->amqp_connection == NULL)
+        {
+            *msUntilDeadline = IOTHUB_CLIENT_LL_NO_DEADLINE;
+        }
+        // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_31_003: [If a device is registered and the amqp_connection has not been created yet, `msUntilDeadline` shall be set to 0]
+        else if (transport_instance->state != AMQP_TRANSPORT_STATE_RECONNECTION_REQUIRED && list_item != NULL && transport_instance->amqp_connection == NULL)
+        {
+            *msUntilDeadline = 0;
+        }
+        else
+        {
+            // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_31_004: [Otherwise `msUntilDeadline` shall be set to TIMER_RESOLUTION_MS, since connection retries, CBS token refreshes and send timeouts are all evaluated in seconds]
+            *msUntilDeadline = TIMER_RESOLUTION_MS;
+
+            if (transport_instance->state != AMQP_TRANSPORT_STATE_RECONNECTION_REQUIRED &&
+                transport_instance->amqp_connection_state == AMQP_CONNECTION_STATE_OPENED)
+            {
+                while (list_item != NULL)
+                {
+                    AMQP_TRANSPORT_DEVICE_INSTANCE* registered_device = (AMQP_TRANSPORT_DEVICE_INSTANCE*)singlylinkedlist_item_get_value(list_item);
+
+                    // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_31_005: [If the connection is opened and a registered device needs to be started or has events waiting to be sent, `msUntilDeadline` shall be set to 0]
+                    if (registered_device != NULL &&
+                        (registered_device->device_state == DEVICE_STATE_STOPPED ||
+                        (registered_device->device_state == DEVICE_STATE_STARTED && !DList_IsListEmpty(registered_device->waiting_to_send))))
+                    {
+                        *msUntilDeadline = 0;
+                        break;
+                    }
+
+                    list_item = singlylinkedlist_get_next_item(list_item);
+                }
+            }
+        }
+
+        result = RESULT_OK;
+    }
+
+    return result;
+}
+
+int IoTHubTransport_AMQP_Common_GetStatistics(TRANSPORT_LL_HANDLE handle, IOTHUB_CLIENT_STATISTICS* statistics)
+{
+    int result;
+
+    // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_31_009: [If `handle` or `statistics` are NULL, IoTHubTransport_AMQP_Common_GetStatistics shall fail and return non-zero]
+    if (handle == NULL || statistics == NULL)
+    {
+        LogError("Failed retrieving the statistics (either handle (%p) or statistics (%p) are NULL)", handle, statistics);
+        result = __FAILURE__;
+    }
+    else
+    {
+        AMQP_TRANSPORT_INSTANCE* transport_instance = (AMQP_TRANSPORT_INSTANCE*)handle;
+
+        // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_31_010: [`statistics->in_flight` shall be set to the number of events passed to device_send_event_async whose completion was not received yet, for all the devices registered to the transport]
+        statistics->in_flight = transport_instance->events_in_flight;
+        // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_31_011: [`statistics->reconnects` shall be set to the number of connection retries and `statistics->retries` to 0, since the messenger does not resend events]
+        statistics->reconnects = transport_instance->reconnection_count;
+        statistics->retries = 0;
+
+        result = RESULT_OK;
+    }
+
+    return result;
+}
+
 IOTHUB_CLIENT_RESULT IoTHubTransport_AMQP_Common_SetOption(TRANSPORT_LL_HANDLE handle, const char* option, const void* value)
 {
     IOTHUB_CLIENT_RESULT result;
@@ -1687,6 +1787,11 @@ IOTHUB_CLIENT_RESULT IoTHubTransport_AMQP_Common_SetOption(TRANSPORT_LL_HANDLE h
                 result = IOTHUB_CLIENT_OK;
             }
         }
+        // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_31_007: [If `option` is `message_pool_size`, IoTHubTransport_AMQP_Common_SetOption shall return IOTHUB_CLIENT_INVALID_ARG without passing it to `instance->tls_io` (the messenger does not pool its send tasks)]
+        else if (strcmp(OPTION_MESSAGE_POOL_SIZE, option) == 0)
+        {
+            result = IOTHUB_CLIENT_INVALID_ARG;
+        }
         // Codes_SRS_IOTHUBTRANSPORT_AMQP_COMMON_09_104: [If `option` is `logtrace`, `value` shall be saved and applied to `instance->connection` using amqp_connection_set_logging()]
         else if (strcmp(OPTION_LOG_TRACE, option) == 0)
         {
@@ -14,6 +14,8 @@
 #include "iothub_client_ll.h"
 #include "iothub_client_options.h"
 #include "iothub_client_private.h"
+#include "iothub_client_object_pool.h"
+#include "iothub_client_packet_id_table.h"
 #include "azure_umqtt_c/mqtt_client.h"
 #include "azure_c_shared_utility/sastoken.h"
 #include "azure_c_shared_utility/tickcounter.h"
@@ -47,6 +49,7 @@
 #define STATUS_CODE_FAILURE_VALUE   500
 #define STATUS_CODE_TIMEOUT_VALUE   408
 #define ERROR_TIME_FOR_RETRY_SECS   5       // We won't retry more than once every 5 seconds
+#define RETRY_CHECK_INTERVAL_MS     1000    // The retry logic works with a 1 second resolution
 
 static const char TOPIC_DEVICE_TWIN_PREFIX[] = "$iothub/twin";
 static const char TOPIC_DEVICE_METHOD_PREFIX[] = "$iothub/methods";
@@ -197,6 +200,16 @@ typedef struct MQTTTRANSPORT_HANDLE_DATA_TAG
 
     // Telemetry specific
     DLIST_ENTRY telemetry_waitingForAck;
+    PACKET_ID_TABLE_HANDLE telemetry_byPacketId; /*the messages of telemetry_waitingForAck indexed by packet id for PUBACKs*/
+    size_t inFlightBytes;         // payload bytes of the messages of telemetry_waitingForAck
+    size_t maxInFlightMessages;   // "max_in_flight_messages", 0 for no limit
+    size_t maxInFlightBytes;      // "max_in_flight_bytes", 0 for no limit
+    char* staticProperties;       // "static_message_properties" formatted once for the topic of every telemetry message, NULL if none
+    size_t staticPropertiesLength;
+    bool telemetryAtMostOnce;     // "telemetry_at_most_once", publishes telemetry at QoS 0 and confirms it without PUBACK
+    size_t resendCount;     // publishes of telemetry messages sent again for lack of PUBACK
+    size_t connectCount;    // successful calls to mqtt_client_connect
+    OBJECT_POOL_HANDLE messageDetailsPool; /*optional pool for the MQTT_MESSAGE_DETAILS_LIST entries, set by "message_pool_size"*/
 
     //Retry Logic
     RETRY_LOGIC* retryLogic;
@@ -230,7 +243,9 @@ typedef struct MQTT_MESSAGE_DETAILS_LIST_TAG
     IOTHUB_MESSAGE_LIST* iotHubMessageEntry;
     void* context;
     uint16_t packet_id;
+    size_t msgSize;
     DLIST_ENTRY entry;
+    PACKET_ID_TABLE_ENTRY packetIdEntry;
 } MQTT_MESSAGE_DETAILS_LIST, *PMQTT_MESSAGE_DETAILS_LIST;
 
 typedef struct DEVICE_METHOD_INFO_TAG
@@ -569,6 +584,30 @@ static uint16_t get_next_packet_id(PMQTTTRANSPORT_HANDLE_DATA transport_data)
     return transport_data->packetId;
 }
 
+static bool is_resend_due(const MQTT_MESSAGE_DETAILS_LIST* mqttMsgEntry, tickcounter_ms_t current_ms)
+{
+    /*a message published again during this _DoWork is newer than current_ms*/
+    return (mqttMsgEntry->msgPublishTime <= current_ms) && (((current_ms - mqttMsgEntry->msgPublishTime) / 1000) > RESEND_TIMEOUT_VALUE_MIN);
+}
+
+static bool is_in_flight_window_full(PMQTTTRANSPORT_HANDLE_DATA transport_data, size_t messageLength)
+{
+    /*a message larger than "max_in_flight_bytes" is still sent, alone*/
+    return ((transport_data->maxInFlightMessages != 0) && (packet_id_table_get_count(transport_data->telemetry_byPacketId) >= transport_data->maxInFlightMessages)) ||
+        ((transport_data->maxInFlightBytes != 0) && (transport_data->inFlightBytes != 0) && (transport_data->inFlightBytes + messageLength > transport_data->maxInFlightBytes));
+}
+
+/*stops counting in flight a message that left telemetry_waitingForAck other than by its PUBACK. Packet ids wrap around, so the message is
+removed from the packet id table by its entry: removing it by packet id could unlink another message published with the same id*/
+static void remove_in_flight_message(PMQTTTRANSPORT_HANDLE_DATA transport_data, MQTT_MESSAGE_DETAILS_LIST* mqttMsgEntry)
+{
+    /* Codes_SRS_IOTHUB_TRANSPORT_MQTT_COMMON_31_016: [ IoTHubTransport_MQTT_Common_DoWork shall add every published telemetry message to the packet id table with packet_id_table_add, and remove it from the table with packet_id_table_remove_entry whenever it leaves the list of messages waiting for acknowledgement. A message the table could not take is not counted in flight. ] */
+    if (packet_id_table_remove_entry(transport_data->telemetry_byPacketId, &(mqttMsgEntry->packetIdEntry)) == 0)
+    {
+        transport_data->inFlightBytes -= mqttMsgEntry->msgSize;
+    }
+}
+
 static const char* retrieve_mqtt_return_codes(CONNECT_RETURN_CODE rtn_code)
 {
     switch (rtn_code)
@@ -798,53 +837,95 @@ static void sendMsgComplete(IOTHUB_MESSAGE_LIST* iothubMsgList, PMQTTTRANSPORT_H
     IoTHubClient_LL_SendComplete(transport_data->llClientHandle, &messageCompleted, confirmResult);
 }
 
-static STRING_HANDLE addPropertiesTouMqttMessage(IOTHUB_MESSAGE_HANDLE iothub_message_handle, const char* eventTopic)
+static size_t get_properties_length(const char* const* propertyKeys, const char* const* propertyValues, size_t propertyCount)
+{
+    size_t result = 0;
+    size_t index;
+    for (index = 0; index < propertyCount; index++)
+    {
+        result += strlen(propertyKeys[index]) + 1 + strlen(propertyValues[index]) + ((index == 0) ? 0 : 1);
+    }
+    return result;
+}
+
+/*writes "key1=value1&key2=value2" at destination, without a terminating '\0', and returns the position past it*/
+static char* write_properties(char* destination, const char* const* propertyKeys, const char* const* propertyValues, size_t propertyCount)
+{
+    size_t index;
+    for (index = 0; index < propertyCount; index++)
+    {
+        size_t keyLength = strlen(propertyKeys[index]);
+        size_t valueLength = strlen(propertyValues[index]);
+        if (index != 0)
+        {
+            *destination++ = PROPERTY_SEPARATOR[0];
+        }
+        (void)memcpy(destination, propertyKeys[index], keyLength);
+        destination += keyLength;
+        *destination++ = '=';
+        (void)memcpy(destination, propertyValues[index], valueLength);
+        destination += valueLength;
+    }
+    return destination;
+}
+
+static char* buildTelemetryTopic(PMQTTTRANSPORT_HANDLE_DATA transport_data, IOTHUB_MESSAGE_HANDLE iothub_message_handle)
 {
-    STRING_HANDLE result = STRING_construct(eventTopic);
-    const char* const* propertyKeys;
-    const char* const* propertyValues;
-    size_t propertyCount;
+    char* result;
+    const char* eventTopic = STRING_c_str(transport_data->topic_MqttEvent);
+    const char* const* propertyKeys = NULL;
+    const char* const* propertyValues = NULL;
+    size_t propertyCount = 0;
 
     // Construct Properties
-    MAP_HANDLE properties_map = IoTHubMessage_Properties(iothub_message_handle);
-    if (properties_map != NULL)
+    MAP_HANDLE properties_map = IoTHubMessage_ReadOnlyProperties(iothub_message_handle);
+    if ((properties_map != NULL) && (Map_GetInternals(properties_map, &propertyKeys, &propertyValues, &propertyCount) != MAP_OK))
     {
-        if (Map_GetInternals(properties_map, &propertyKeys, &propertyValues, &propertyCount) != MAP_OK)
+        LogError("Failed to get the internals of the property map.");
+        result = NULL;
+    }
+    else
+    {
+        /* Codes_SRS_IOTHUB_TRANSPORT_MQTT_COMMON_31_024: [ The topic of a telemetry message shall be built in a single allocation sized for the device events topic, the static properties and the properties of the message. ] */
+        size_t eventTopicLength = strlen(eventTopic);
+        size_t propertiesLength = get_properties_length(propertyKeys, propertyValues, propertyCount);
+        bool needsSeparator = (transport_data->staticPropertiesLength != 0) && (propertiesLength != 0);
+        if ((result = (char*)malloc(eventTopicLength + transport_data->staticPropertiesLength + (needsSeparator ? 1 : 0) + propertiesLength + 1)) == NULL)
         {
-            LogError("Failed to get the internals of the property map.");
-            STRING_delete(result);
-            result = NULL;
+            LogError("Failed allocating the topic of the telemetry message.");
         }
         else
         {
-            if (propertyCount != 0)
+            char* current = result;
+            (void)memcpy(current, eventTopic, eventTopicLength);
+            current += eventTopicLength;
+            if (transport_data->staticPropertiesLength != 0)
             {
-                size_t index = 0;
-                for (index = 0; index < propertyCount && result != NULL; index++)
-                {
-                    if (STRING_sprintf(result, "%s=%s%s", propertyKeys[index], propertyValues[index], propertyCount - 1 == index ? "" : PROPERTY_SEPARATOR) != 0)
-                    {
-                        STRING_delete(result);
-                        result = NULL;
-                    }
-                }
+                (void)memcpy(current, transport_data->staticProperties, transport_data->staticPropertiesLength);
+                current += transport_data->staticPropertiesLength;
             }
+            if (needsSeparator)
+            {
+                *current++ = PROPERTY_SEPARATOR[0];
+            }
+            current = write_properties(current, propertyKeys, propertyValues, propertyCount);
+            *current = '\0';
         }
     }
     return result;
 }
 
-static int publish_mqtt_telemetry_msg(PMQTTTRANSPORT_HANDLE_DATA transport_data, MQTT_MESSAGE_DETAILS_LIST* mqttMsgEntry, const unsigned char* payload, size_t len)
+static int publish_mqtt_telemetry_msg(PMQTTTRANSPORT_HANDLE_DATA transport_data, MQTT_MESSAGE_DETAILS_LIST* mqttMsgEntry, QOS_VALUE qosValue, const unsigned char* payload, size_t len)
 {
     int result;
-    STRING_HANDLE msgTopic = addPropertiesTouMqttMessage(mqttMsgEntry->iotHubMessageEntry->messageHandle, STRING_c_str(transport_data->topic_MqttEvent));
+    char* msgTopic = buildTelemetryTopic(transport_data, mqttMsgEntry->iotHubMessageEntry->messageHandle);
     if (msgTopic == NULL)
     {
         result = __FAILURE__;
     }
     else
     {
-        MQTT_MESSAGE_HANDLE mqttMsg = mqttmessage_create(mqttMsgEntry->packet_id, STRING_c_str(msgTopic), DELIVER_AT_LEAST_ONCE, payload, len);
+        MQTT_MESSAGE_HANDLE mqttMsg = mqttmessage_create(mqttMsgEntry->packet_id, msgTopic, qosValue, payload, len);
         if (mqttMsg == NULL)
         {
             result = __FAILURE__;
@@ -864,13 +945,17 @@ static int publish_mqtt_telemetry_msg(PMQTTTRANSPORT_HANDLE_DATA transport_data,
                 }
                 else
                 {
+                    if (mqttMsgEntry->retryCount > 0)
+                    {
+                        transport_data->resendCount++;
+                    }
                     mqttMsgEntry->retryCount++;
                     result = 0;
                 }
             }
             mqttmessage_destroy(mqttMsg);
         }
-        STRING_delete(msgTopic);
+        free(msgTopic);
     }
     return result;
 }
@@ -1344,20 +1429,15 @@ static void mqtt_operation_complete_callback(MQTT_CLIENT_HANDLE handle, MQTT_CLI
                 const PUBLISH_ACK* puback = (const PUBLISH_ACK*)msgInfo;
                 if (puback != NULL)
                 {
-                    PDLIST_ENTRY currentListEntry = transport_data->telemetry_waitingForAck.Flink;
-                    while (currentListEntry != &transport_data->telemetry_waitingForAck)
+                    /* Codes_SRS_IOTHUB_TRANSPORT_MQTT_COMMON_31_015: [ On a PUBACK, mqtt_operation_complete_callback shall find the telemetry message it acknowledges by its packet id with packet_id_table_remove, without scanning the messages waiting for acknowledgement. ] */
+                    PACKET_ID_TABLE_ENTRY* packetIdEntry = packet_id_table_remove(transport_data->telemetry_byPacketId, puback->packetId);
+                    if (packetIdEntry != NULL)
                     {
-                        MQTT_MESSAGE_DETAILS_LIST* mqttMsgEntry = containingRecord(currentListEntry, MQTT_MESSAGE_DETAILS_LIST, entry);
-                        DLIST_ENTRY saveListEntry;
-                        saveListEntry.Flink = currentListEntry->Flink;
-
-                        if (puback->packetId == mqttMsgEntry->packet_id)
-                        {
-                            (void)DList_RemoveEntryList(currentListEntry); //First remove the item from Waiting for Ack List.
-                            sendMsgComplete(mqttMsgEntry->iotHubMessageEntry, transport_data, IOTHUB_CLIENT_CONFIRMATION_OK);
-                            free(mqttMsgEntry);
-                        }
-                        currentListEntry = saveListEntry.Flink;
+                        MQTT_MESSAGE_DETAILS_LIST* mqttMsgEntry = containingRecord(packetIdEntry, MQTT_MESSAGE_DETAILS_LIST, packetIdEntry);
+                        (void)DList_RemoveEntryList(&mqttMsgEntry->entry); //First remove the item from Waiting for Ack List.
+                        transport_data->inFlightBytes -= mqttMsgEntry->msgSize;
+                        sendMsgComplete(mqttMsgEntry->iotHubMessageEntry, transport_data, IOTHUB_CLIENT_CONFIRMATION_OK);
+                        object_pool_free(transport_data->messageDetailsPool, mqttMsgEntry);
                     }
                 }
                 else
@@ -1725,6 +1805,7 @@ static int SendMqttConnectMsg(PMQTTTRANSPORT_HANDLE_DATA transport_data)
             else
             {
                 (void)tickcounter_get_current_ms(transport_data->msgTickCounter, &transport_data->mqtt_connect_time);
+                transport_data->connectCount++;
                 result = 0;
             }
         }
@@ -1931,6 +2012,20 @@ static PMQTTTRANSPORT_HANDLE_DATA InitializeTransportHandleData(const IOTHUB_CLI
                         free(state);
                         state = NULL;
                     }
+                    /* Codes_SRS_IOTHUB_TRANSPORT_MQTT_COMMON_31_017: [ IoTHubTransport_MQTT_Common_Create shall create the packet id table of the telemetry messages waiting for acknowledgement with packet_id_table_create, and fail if that fails. ] */
+                    else if ((state->telemetry_byPacketId = packet_id_table_create()) == NULL)
+                    {
+                        LogError("failure creating the packet id table.");
+                        STRING_delete(state->configPassedThroughUsername);
+                        STRING_delete(state->devicesPath);
+                        mqtt_client_deinit(state->mqttClient);
+                        STRING_delete(state->hostAddress);
+                        STRING_delete(state->topic_MqttEvent);
+                        STRING_delete(state->device_id);
+                        tickcounter_destroy(state->msgTickCounter);
+                        free(state);
+                        state = NULL;
+                    }
                     else
                     {
                         /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_07_010: [IoTHubTransport_MQTT_Common_Create shall allocate memory to save its internal state where all topics, hostname, device_id, device_key, sasTokenSr and client handle shall be saved.] */
@@ -2059,8 +2154,9 @@ void IoTHubTransport_MQTT_Common_Destroy(TRANSPORT_LL_HANDLE handle)
         {
             PDLIST_ENTRY currentEntry = DList_RemoveHeadList(&transport_data->telemetry_waitingForAck);
             MQTT_MESSAGE_DETAILS_LIST* mqttMsgEntry = containingRecord(currentEntry, MQTT_MESSAGE_DETAILS_LIST, entry);
+            remove_in_flight_message(transport_data, mqttMsgEntry);
             sendMsgComplete(mqttMsgEntry->iotHubMessageEntry, transport_data, IOTHUB_CLIENT_CONFIRMATION_BECAUSE_DESTROY);
-            free(mqttMsgEntry);
+            object_pool_free(transport_data->messageDetailsPool, mqttMsgEntry);
         }
         while (!DList_IsListEmpty(&transport_data->ack_waiting_queue))
         {
@@ -2085,6 +2181,12 @@ void IoTHubTransport_MQTT_Common_Destroy(TRANSPORT_LL_HANDLE handle)
 
         tickcounter_destroy(transport_data->msgTickCounter);
         DestroyRetryLogic(transport_data->retryLogic);
+        object_pool_destroy(transport_data->messageDetailsPool);
+        packet_id_table_destroy(transport_data->telemetry_byPacketId);
+        if (transport_data->staticProperties != NULL)
+        {
+            free(transport_data->staticProperties);
+        }
         /* Codes_SRS_IOTHUB_TRANSPORT_MQTT_COMMON_01_012: [ `IoTHubTransport_MQTT_Common_Destroy` shall free the stored proxy options. ]*/
         free_proxy_data(transport_data);
         free(transport_data);
@@ -2463,49 +2565,67 @@ void IoTHubTransport_MQTT_Common_DoWork(TRANSPORT_LL_HANDLE handle, IOTHUB_CLIEN
             else if (transport_data->currPacketState == PUBLISH_TYPE)
             {
                 PDLIST_ENTRY currentListEntry = transport_data->telemetry_waitingForAck.Flink;
-                while (currentListEntry != &transport_data->telemetry_waitingForAck)
+                if (currentListEntry != &transport_data->telemetry_waitingForAck)
                 {
-                    MQTT_MESSAGE_DETAILS_LIST* mqttMsgEntry = containingRecord(currentListEntry, MQTT_MESSAGE_DETAILS_LIST, entry);
-                    DLIST_ENTRY nextListEntry;
-                    nextListEntry.Flink = currentListEntry->Flink;
-
                     tickcounter_ms_t current_ms;
+                    bool resendDue = true;
                     (void)tickcounter_get_current_ms(transport_data->msgTickCounter, &current_ms);
-                    /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_07_033: [IoTHubTransport_MQTT_Common_DoWork shall iterate through the Waiting Acknowledge messages looking for any message that has been waiting longer than 2 min.]*/
-                    if (((current_ms - mqttMsgEntry->msgPublishTime) / 1000) > RESEND_TIMEOUT_VALUE_MIN)
+                    /* Codes_SRS_IOTHUB_TRANSPORT_MQTT_COMMON_31_022: [ The messages waiting for acknowledgement are kept in the order they were last published, so IoTHubTransport_MQTT_Common_DoWork shall stop looking for messages to resend at the first one that has not been waiting longer than 2 min. ] */
+                    while ((currentListEntry != &transport_data->telemetry_waitingForAck) && resendDue)
                     {
-                        /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_07_034: [If IoTHubTransport_MQTT_Common_DoWork has resent the message two times then it shall fail the message] */
-                        if (mqttMsgEntry->retryCount >= MAX_SEND_RECOUNT_LIMIT)
+                        MQTT_MESSAGE_DETAILS_LIST* mqttMsgEntry = containingRecord(currentListEntry, MQTT_MESSAGE_DETAILS_LIST, entry);
+                        DLIST_ENTRY nextListEntry;
+                        nextListEntry.Flink = currentListEntry->Flink;
+
+                        /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_07_033: [IoTHubTransport_MQTT_Common_DoWork shall iterate through the Waiting Acknowledge messages looking for any message that has been waiting longer than 2 min.]*/
+                        if (!is_resend_due(mqttMsgEntry, current_ms))
                         {
-                            (void)DList_RemoveEntryList(currentListEntry);
-                            sendMsgComplete(mqttMsgEntry->iotHubMessageEntry, transport_data, IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT);
-                            free(mqttMsgEntry);
+                            resendDue = false;
                         }
                         else
                         {
-                            size_t messageLength;
-                            const unsigned char* messagePayload = RetrieveMessagePayload(mqttMsgEntry->iotHubMessageEntry->messageHandle, &messageLength);
-                            if (messageLength == 0 || messagePayload == NULL)
+                            /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_07_034: [If IoTHubTransport_MQTT_Common_DoWork has resent the message two times then it shall fail the message] */
+                            if (mqttMsgEntry->retryCount >= MAX_SEND_RECOUNT_LIMIT)
                             {
-                                LogError("Failure from creating Message IoTHubMessage_GetData");
+                                (void)DList_RemoveEntryList(currentListEntry);
+                                remove_in_flight_message(transport_data, mqttMsgEntry);
+                                sendMsgComplete(mqttMsgEntry->iotHubMessageEntry, transport_data, IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT);
+                                object_pool_free(transport_data->messageDetailsPool, mqttMsgEntry);
                             }
                             else
                             {
-                                if (publish_mqtt_telemetry_msg(transport_data, mqttMsgEntry, messagePayload, messageLength) != 0)
+                                size_t messageLength;
+                                const unsigned char* messagePayload = RetrieveMessagePayload(mqttMsgEntry->iotHubMessageEntry->messageHandle, &messageLength);
+                                if (messageLength == 0 || messagePayload == NULL)
+                                {
+                                    LogError("Failure from creating Message IoTHubMessage_GetData");
+                                }
+                                else
                                 {
-                                    (void)DList_RemoveEntryList(currentListEntry);
-                                    sendMsgComplete(mqttMsgEntry->iotHubMessageEntry, transport_data, IOTHUB_CLIENT_CONFIRMATION_ERROR);
-                                    free(mqttMsgEntry);
+                                    if (publish_mqtt_telemetry_msg(transport_data, mqttMsgEntry, DELIVER_AT_LEAST_ONCE, messagePayload, messageLength) != 0)
+                                    {
+                                        (void)DList_RemoveEntryList(currentListEntry);
+                                        remove_in_flight_message(transport_data, mqttMsgEntry);
+                                        sendMsgComplete(mqttMsgEntry->iotHubMessageEntry, transport_data, IOTHUB_CLIENT_CONFIRMATION_ERROR);
+                                        object_pool_free(transport_data->messageDetailsPool, mqttMsgEntry);
+                                    }
+                                    else
+                                    {
+                                        /* Codes_SRS_IOTHUB_TRANSPORT_MQTT_COMMON_31_023: [ IoTHubTransport_MQTT_Common_DoWork shall move a message it publishes again to the tail of the list of messages waiting for acknowledgement. ] */
+                                        (void)DList_RemoveEntryList(currentListEntry);
+                                        DList_InsertTailList(&(transport_data->telemetry_waitingForAck), currentListEntry);
+                                    }
                                 }
                             }
                         }
+                        currentListEntry = nextListEntry.Flink;
                     }
-                    currentListEntry = nextListEntry.Flink;
                 }
 
+                bool windowFull = false;
                 currentListEntry = transport_data->waitingToSend->Flink;
                 /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_07_027: [IoTHubTransport_MQTT_Common_DoWork shall inspect the "waitingToSend" DLIST passed in config structure.] */
-                while (currentListEntry != transport_data->waitingToSend)
+                while ((currentListEntry != transport_data->waitingToSend) && !windowFull)
                 {
                     IOTHUB_MESSAGE_LIST* iothubMsgList = containingRecord(currentListEntry, IOTHUB_MESSAGE_LIST, entry);
                     DLIST_ENTRY savedFromCurrentListEntry;
@@ -2513,15 +2633,39 @@ void IoTHubTransport_MQTT_Common_DoWork(TRANSPORT_LL_HANDLE handle, IOTHUB_CLIEN
 
                     /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_07_027: [IoTHubTransport_MQTT_Common_DoWork shall inspect the "waitingToSend" DLIST passed in config structure.] */
                     size_t messageLength;
-                    const unsigned char* messagePayload = RetrieveMessagePayload(iothubMsgList->messageHandle, &messageLength);
-                    if (messageLength == 0 || messagePayload == NULL)
+                    const unsigned char* messagePayload;
+                    /* Codes_SRS_IOTHUB_TRANSPORT_MQTT_COMMON_31_014: [ IoTHubTransport_MQTT_Common_DoWork shall not publish a message of waitingToSend whose expiry time is past, IoTHubClient_LL_CompleteIfExpired completes it with IOTHUB_CLIENT_CONFIRMATION_MESSAGE_EXPIRED. ] */
+                    if ((iothubMsgList->expiryTime != (time_t)0) && IoTHubClient_LL_CompleteIfExpired(transport_data->llClientHandle, iothubMsgList))
+                    {
+                        /*not logged, a backlog of expired messages would log once per message. The client counts them in its statistics*/
+                    }
+                    else if ((messagePayload = RetrieveMessagePayload(iothubMsgList->messageHandle, &messageLength)) == NULL || messageLength == 0)
                     {
                         LogError("Failure result from IoTHubMessage_GetData");
                     }
+                    else if (transport_data->telemetryAtMostOnce)
+                    {
+                        /* Codes_SRS_IOTHUB_TRANSPORT_MQTT_COMMON_31_028: [ When telemetry_at_most_once is set, IoTHubTransport_MQTT_Common_DoWork shall publish the messages of waitingToSend with DELIVER_AT_MOST_ONCE and packet id 0, and complete them with IOTHUB_CLIENT_CONFIRMATION_OK as soon as mqtt_client_publish succeeds, or IOTHUB_CLIENT_CONFIRMATION_ERROR if it fails, without waiting for acknowledgement. ] */
+                        MQTT_MESSAGE_DETAILS_LIST mqttMsgEntry;
+                        mqttMsgEntry.retryCount = 0;
+                        mqttMsgEntry.iotHubMessageEntry = iothubMsgList;
+                        /*a QoS 0 PUBLISH carries no packet id, none is taken from the ids of the acknowledged messages*/
+                        mqttMsgEntry.packet_id = 0;
+                        mqttMsgEntry.msgSize = messageLength;
+                        int publishResult = publish_mqtt_telemetry_msg(transport_data, &mqttMsgEntry, DELIVER_AT_MOST_ONCE, messagePayload, messageLength);
+                        (void)(DList_RemoveEntryList(currentListEntry));
+                        sendMsgComplete(iothubMsgList, transport_data, (publishResult == 0) ? IOTHUB_CLIENT_CONFIRMATION_OK : IOTHUB_CLIENT_CONFIRMATION_ERROR);
+                    }
+                    else if (is_in_flight_window_full(transport_data, messageLength))
+                    {
+                        /* Codes_SRS_IOTHUB_TRANSPORT_MQTT_COMMON_31_020: [ IoTHubTransport_MQTT_Common_DoWork shall stop publishing the messages of waitingToSend while max_in_flight_messages messages are waiting for acknowledgement, or while the payload of the next message would bring the bytes waiting for acknowledgement above max_in_flight_bytes, unless none are. ] */
+                        windowFull = true;
+                    }
                     else
                     {
                         /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_07_029: [IoTHubTransport_MQTT_Common_DoWork shall create a MQTT_MESSAGE_HANDLE and pass this to a call to mqtt_client_publish.] */
-                        MQTT_MESSAGE_DETAILS_LIST* mqttMsgEntry = (MQTT_MESSAGE_DETAILS_LIST*)malloc(sizeof(MQTT_MESSAGE_DETAILS_LIST));
+                        /* Codes_SRS_IOTHUB_TRANSPORT_MQTT_COMMON_31_008: [ When a message pool is set, IoTHubTransport_MQTT_Common_DoWork shall take the MQTT_MESSAGE_DETAILS_LIST entries from it, falling back to malloc when the pool is exhausted. ] */
+                        MQTT_MESSAGE_DETAILS_LIST* mqttMsgEntry = (MQTT_MESSAGE_DETAILS_LIST*)object_pool_alloc(transport_data->messageDetailsPool, sizeof(MQTT_MESSAGE_DETAILS_LIST));
                         if (mqttMsgEntry == NULL)
                         {
                             LogError("Allocation Error: Failure allocating MQTT Message Detail List.");
@@ -2531,16 +2675,28 @@ void IoTHubTransport_MQTT_Common_DoWork(TRANSPORT_LL_HANDLE handle, IOTHUB_CLIEN
                             mqttMsgEntry->retryCount = 0;
                             mqttMsgEntry->iotHubMessageEntry = iothubMsgList;
                             mqttMsgEntry->packet_id = get_next_packet_id(transport_data);
-                            if (publish_mqtt_telemetry_msg(transport_data, mqttMsgEntry, messagePayload, messageLength) != 0)
+                            mqttMsgEntry->msgSize = messageLength;
+                            if (publish_mqtt_telemetry_msg(transport_data, mqttMsgEntry, DELIVER_AT_LEAST_ONCE, messagePayload, messageLength) != 0)
                             {
                                 (void)(DList_RemoveEntryList(currentListEntry));
                                 sendMsgComplete(iothubMsgList, transport_data, IOTHUB_CLIENT_CONFIRMATION_ERROR);
-                                free(mqttMsgEntry);
+                                object_pool_free(transport_data->messageDetailsPool, mqttMsgEntry);
                             }
                             else
                             {
                                 (void)(DList_RemoveEntryList(currentListEntry));
+                                /* Codes_SRS_IOTHUB_TRANSPORT_MQTT_COMMON_31_006: [ When a message moves from waitingToSend to the list of messages waiting for acknowledgement, IoTHubTransport_MQTT_Common_DoWork shall remove it from the client's timeout queue. ] */
+                                timeout_queue_remove(&iothubMsgList->timeout_entry);
                                 DList_InsertTailList(&(transport_data->telemetry_waitingForAck), &(mqttMsgEntry->entry));
+                                /* Codes_SRS_IOTHUB_TRANSPORT_MQTT_COMMON_31_016: [ IoTHubTransport_MQTT_Common_DoWork shall add every published telemetry message to the packet id table with packet_id_table_add, and remove it from the table with packet_id_table_remove_entry whenever it leaves the list of messages waiting for acknowledgement. A message the table could not take is not counted in flight. ] */
+                                if (packet_id_table_add(transport_data->telemetry_byPacketId, &(mqttMsgEntry->packetIdEntry), mqttMsgEntry->packet_id) != 0)
+                                {
+                                    LogError("unable to add the message to the packet id table, it is not counted in flight");
+                                }
+                                else
+                                {
+                                    transport_data->inFlightBytes += messageLength;
+                                }
                             }
                         }
                     }
@@ -2553,6 +2709,132 @@ void IoTHubTransport_MQTT_Common_DoWork(TRANSPORT_LL_HANDLE handle, IOTHUB_CLIEN
     }
 }
 
+static void update_deadline(tickcounter_ms_t* deadline, tickcounter_ms_t candidate)
+{
+    if (candidate < *deadline)
+    {
+        *deadline = candidate;
+    }
+}
+
+/*DoWork holds back the head of waitingToSend when its payload does not fit in the in flight window, so the deadline looks at the same payload*/
+static bool is_next_event_held_back(PMQTTTRANSPORT_HANDLE_DATA transport_data)
+{
+    size_t messageLength = 0;
+    if (transport_data->maxInFlightBytes != 0)
+    {
+        IOTHUB_MESSAGE_LIST* iothubMsgList = containingRecord(transport_data->waitingToSend->Flink, IOTHUB_MESSAGE_LIST, entry);
+        if (RetrieveMessagePayload(iothubMsgList->messageHandle, &messageLength) == NULL)
+        {
+            messageLength = 0;
+        }
+    }
+    return is_in_flight_window_full(transport_data, messageLength);
+}
+
+int IoTHubTransport_MQTT_Common_GetNextDeadline(TRANSPORT_LL_HANDLE handle, tickcounter_ms_t* msUntilDeadline)
+{
+    int result;
+    PMQTTTRANSPORT_HANDLE_DATA transport_data = (PMQTTTRANSPORT_HANDLE_DATA)handle;
+    tickcounter_ms_t current_ms;
+
+    /* Codes_SRS_IOTHUB_TRANSPORT_MQTT_COMMON_31_001: [ If handle or msUntilDeadline is NULL, IoTHubTransport_MQTT_Common_GetNextDeadline shall return a non-zero value. ] */
+    if (transport_data == NULL || msUntilDeadline == NULL)
+    {
+        LogError("Invalid parameter specified handle: %p, msUntilDeadline: %p", handle, msUntilDeadline);
+        result = __FAILURE__;
+    }
+    else if (tickcounter_get_current_ms(transport_data->msgTickCounter, &current_ms) != 0)
+    {
+        LogError("Failure getting the current tick count");
+        result = __FAILURE__;
+    }
+    else
+    {
+        tickcounter_ms_t deadline = IOTHUB_CLIENT_LL_NO_DEADLINE;
+
+        if (transport_data->isDestroyCalled)
+        {
+            // Nothing left to schedule
+        }
+        else if (transport_data->mqttClientStatus == MQTT_CLIENT_STATUS_NOT_CONNECTED)
+        {
+            /* Codes_SRS_IOTHUB_TRANSPORT_MQTT_COMMON_31_002: [ If the transport is not connected, IoTHubTransport_MQTT_Common_GetNextDeadline shall return 0 ms for the first connection attempt and RETRY_CHECK_INTERVAL_MS afterwards. ] */
+            if (transport_data->retryLogic != NULL && transport_data->retryLogic->firstAttempt)
+            {
+                deadline = current_ms;
+            }
+            else
+            {
+                deadline = current_ms + RETRY_CHECK_INTERVAL_MS;
+            }
+        }
+        else if (transport_data->mqttClientStatus == MQTT_CLIENT_STATUS_CONNECTING)
+        {
+            /* Codes_SRS_IOTHUB_TRANSPORT_MQTT_COMMON_31_003: [ If the transport is connecting, the deadline shall be the time the CONNACK wait times out. ] */
+            deadline = transport_data->mqtt_connect_time + ((tickcounter_ms_t)transport_data->keepAliveValue + 1) * 1000;
+        }
+        /* Codes_SRS_IOTHUB_TRANSPORT_MQTT_COMMON_31_021: [ Unless telemetry_at_most_once is set, events waiting while the in flight window is full, see max_in_flight_messages and max_in_flight_bytes, are not ready to be sent. The window is checked against the payload of the first event of waitingToSend, as IoTHubTransport_MQTT_Common_DoWork does. ] */
+        else if (transport_data->currPacketState == CONNACK_TYPE || transport_data->currPacketState == SUBACK_TYPE ||
+            (transport_data->currPacketState == PUBLISH_TYPE && !DList_IsListEmpty(transport_data->waitingToSend) && (transport_data->telemetryAtMostOnce || !is_next_event_held_back(transport_data))))
+        {
+            /* Codes_SRS_IOTHUB_TRANSPORT_MQTT_COMMON_31_004: [ If subscriptions or events are ready to be sent, IoTHubTransport_MQTT_Common_GetNextDeadline shall return 0 ms. ] */
+            deadline = current_ms;
+        }
+        else
+        {
+            PDLIST_ENTRY currentListEntry = transport_data->telemetry_waitingForAck.Flink;
+
+            /* Codes_SRS_IOTHUB_TRANSPORT_MQTT_COMMON_31_005: [ Otherwise the deadline shall be the earliest of the SAS token refresh, a quarter of the keep alive interval and the resend time of the oldest message waiting for acknowledgement. ] */
+            update_deadline(&deadline, transport_data->mqtt_connect_time + (tickcounter_ms_t)(SAS_TOKEN_DEFAULT_LIFETIME * SAS_REFRESH_MULTIPLIER + 1) * 1000);
+            if (transport_data->keepAliveValue != 0)
+            {
+                update_deadline(&deadline, current_ms + (tickcounter_ms_t)transport_data->keepAliveValue * 1000 / 4);
+            }
+            /*the messages waiting for acknowledgement are in publish order, the first one is the next to resend*/
+            if (currentListEntry != &transport_data->telemetry_waitingForAck)
+            {
+                MQTT_MESSAGE_DETAILS_LIST* mqttMsgEntry = containingRecord(currentListEntry, MQTT_MESSAGE_DETAILS_LIST, entry);
+                update_deadline(&deadline, mqttMsgEntry->msgPublishTime + (tickcounter_ms_t)(RESEND_TIMEOUT_VALUE_MIN + 1) * 1000);
+            }
+        }
+
+        if (deadline == IOTHUB_CLIENT_LL_NO_DEADLINE)
+        {
+            *msUntilDeadline = IOTHUB_CLIENT_LL_NO_DEADLINE;
+        }
+        else
+        {
+            *msUntilDeadline = (deadline > current_ms) ? (deadline - current_ms) : 0;
+        }
+        result = 0;
+    }
+    return result;
+}
+
+int IoTHubTransport_MQTT_Common_GetStatistics(TRANSPORT_LL_HANDLE handle, IOTHUB_CLIENT_STATISTICS* statistics)
+{
+    int result;
+    PMQTTTRANSPORT_HANDLE_DATA transport_data = (PMQTTTRANSPORT_HANDLE_DATA)handle;
+
+    /* Codes_SRS_IOTHUB_TRANSPORT_MQTT_COMMON_31_011: [ If handle or statistics is NULL, IoTHubTransport_MQTT_Common_GetStatistics shall return a non-zero value. ] */
+    if (transport_data == NULL || statistics == NULL)
+    {
+        LogError("Invalid parameter specified handle: %p, statistics: %p", handle, statistics);
+        result = __FAILURE__;
+    }
+    else
+    {
+        /* Codes_SRS_IOTHUB_TRANSPORT_MQTT_COMMON_31_012: [ IoTHubTransport_MQTT_Common_GetStatistics shall set in_flight to the number of telemetry messages waiting for their PUBACK, obtained with packet_id_table_get_count. ] */
+        statistics->in_flight = packet_id_table_get_count(transport_data->telemetry_byPacketId);
+        /* Codes_SRS_IOTHUB_TRANSPORT_MQTT_COMMON_31_013: [ IoTHubTransport_MQTT_Common_GetStatistics shall set retries to the number of telemetry messages published again because their PUBACK did not arrive in time, and reconnects to the number of successful connects after the first one, and return 0. ] */
+        statistics->retries = transport_data->resendCount;
+        statistics->reconnects = (transport_data->connectCount > 1) ? transport_data->connectCount - 1 : 0;
+        result = 0;
+    }
+    return result;
+}
+
 IOTHUB_CLIENT_RESULT IoTHubTransport_MQTT_Common_GetSendStatus(IOTHUB_DEVICE_HANDLE handle, IOTHUB_CLIENT_STATUS *iotHubClientStatus)
 {
     IOTHUB_CLIENT_RESULT result;
@@ -2629,6 +2911,93 @@ IOTHUB_CLIENT_RESULT IoTHubTransport_MQTT_Common_SetOption(TRANSPORT_LL_HANDLE h
             }
             result = IOTHUB_CLIENT_OK;
         }
+        else if (strcmp(OPTION_MESSAGE_POOL_SIZE, option) == 0)
+        {
+            size_t poolSize = *(const size_t*)value;
+            OBJECT_POOL_HANDLE newPool = NULL;
+            if (!DList_IsListEmpty(&transport_data->telemetry_waitingForAck))
+            {
+                /* Codes_SRS_IOTHUB_TRANSPORT_MQTT_COMMON_31_009: [ If messages are waiting for acknowledgement, IoTHubTransport_MQTT_Common_SetOption shall fail and return IOTHUB_CLIENT_ERROR. ] */
+                LogError("unable to resize the message pool while messages are waiting for acknowledgement");
+                result = IOTHUB_CLIENT_ERROR;
+            }
+            else if ((poolSize != 0) &&
+                ((newPool = object_pool_create(sizeof(MQTT_MESSAGE_DETAILS_LIST), poolSize)) == NULL))
+            {
+                /* Codes_SRS_IOTHUB_TRANSPORT_MQTT_COMMON_31_010: [ If creating the pool fails, IoTHubTransport_MQTT_Common_SetOption shall return IOTHUB_CLIENT_ERROR and keep the current pool. ] */
+                LogError("unable to create a message pool of %lu entries", (unsigned long)poolSize);
+                result = IOTHUB_CLIENT_ERROR;
+            }
+            else
+            {
+                /* Codes_SRS_IOTHUB_TRANSPORT_MQTT_COMMON_31_007: [ If the option parameter is set to "message_pool_size" then the value shall be a size_t_ptr holding the number of MQTT_MESSAGE_DETAILS_LIST entries to pool, 0 removes the pool. ] */
+                object_pool_destroy(transport_data->messageDetailsPool);
+                transport_data->messageDetailsPool = newPool;
+                result = IOTHUB_CLIENT_OK;
+            }
+        }
+        else if (strcmp(OPTION_MAX_IN_FLIGHT_MESSAGES, option) == 0)
+        {
+            /* Codes_SRS_IOTHUB_TRANSPORT_MQTT_COMMON_31_018: [ If the option parameter is set to "max_in_flight_messages" then the value shall be a size_t_ptr holding the most telemetry messages waiting for acknowledgement, 0 for no limit. ] */
+            transport_data->maxInFlightMessages = *(const size_t*)value;
+            result = IOTHUB_CLIENT_OK;
+        }
+        else if (strcmp(OPTION_MAX_IN_FLIGHT_BYTES, option) == 0)
+        {
+            /* Codes_SRS_IOTHUB_TRANSPORT_MQTT_COMMON_31_019: [ If the option parameter is set to "max_in_flight_bytes" then the value shall be a size_t_ptr holding the most payload bytes of the telemetry messages waiting for acknowledgement, 0 for no limit. ] */
+            transport_data->maxInFlightBytes = *(const size_t*)value;
+            result = IOTHUB_CLIENT_OK;
+        }
+        else if (strcmp(OPTION_TELEMETRY_AT_MOST_ONCE, option) == 0)
+        {
+            /* Codes_SRS_IOTHUB_TRANSPORT_MQTT_COMMON_31_027: [ If the option parameter is set to "telemetry_at_most_once" then the value shall be a bool_ptr, true publishes the telemetry messages at QoS 0. ] */
+            transport_data->telemetryAtMostOnce = *(const bool*)value;
+            result = IOTHUB_CLIENT_OK;
+        }
+        else if (strcmp(OPTION_STATIC_MESSAGE_PROPERTIES, option) == 0)
+        {
+            const char* const* propertyKeys;
+            const char* const* propertyValues;
+            size_t propertyCount;
+            if (Map_GetInternals((MAP_HANDLE)value, &propertyKeys, &propertyValues, &propertyCount) != MAP_OK)
+            {
+                LogError("Failed to get the internals of the static properties map.");
+                result = IOTHUB_CLIENT_ERROR;
+            }
+            else if (propertyCount == 0)
+            {
+                if (transport_data->staticProperties != NULL)
+                {
+                    free(transport_data->staticProperties);
+                }
+                transport_data->staticProperties = NULL;
+                transport_data->staticPropertiesLength = 0;
+                result = IOTHUB_CLIENT_OK;
+            }
+            else
+            {
+                size_t propertiesLength = get_properties_length(propertyKeys, propertyValues, propertyCount);
+                char* staticProperties = (char*)malloc(propertiesLength + 1);
+                if (staticProperties == NULL)
+                {
+                    /* Codes_SRS_IOTHUB_TRANSPORT_MQTT_COMMON_31_026: [ If formatting the static properties fails, IoTHubTransport_MQTT_Common_SetOption shall return IOTHUB_CLIENT_ERROR and keep the current ones. ] */
+                    LogError("Failed allocating the static properties.");
+                    result = IOTHUB_CLIENT_ERROR;
+                }
+                else
+                {
+                    /* Codes_SRS_IOTHUB_TRANSPORT_MQTT_COMMON_31_025: [ If the option parameter is set to "static_message_properties" then the value shall be a MAP_HANDLE of properties added to the topic of every telemetry message, formatted once, an empty map removes them. ] */
+                    *write_properties(staticProperties, propertyKeys, propertyValues, propertyCount) = '\0';
+                    if (transport_data->staticProperties != NULL)
+                    {
+                        free(transport_data->staticProperties);
+                    }
+                    transport_data->staticProperties = staticProperties;
+                    transport_data->staticPropertiesLength = propertiesLength;
+                    result = IOTHUB_CLIENT_OK;
+                }
+            }
+        }
         /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_07_039: [If the option parameter is set to "x509certificate" then the value shall be a const char of the certificate to be used for x509.] */
         else if ((strcmp(OPTION_X509_CERT, option) == 0) && (cred_type != IOTHUB_CREDENTIAL_TYPE_X509 && cred_type != IOTHUB_CREDENTIAL_TYPE_UNKNOWN))
         {
@@ -169,6 +169,18 @@ static IOTHUB_CLIENT_RESULT IoTHubTransportAMQP_WS_GetSendStatus(IOTHUB_DEVICE_H
     return IoTHubTransport_AMQP_Common_GetSendStatus(handle, iotHubClientStatus);
 }
 
+static int IoTHubTransportAMQP_WS_GetNextDeadline(TRANSPORT_LL_HANDLE handle, tickcounter_ms_t* msUntilDeadline)
+{
+    // Codes_SRS_IoTHubTransportAMQP_WS_31_001: [IoTHubTransportAMQP_WS_GetNextDeadline shall get the next deadline by calling into the IoTHubTransport_AMQP_Common_GetNextDeadline()]
+    return IoTHubTransport_AMQP_Common_GetNextDeadline(handle, msUntilDeadline);
+}
+
+static int IoTHubTransportAMQP_WS_GetStatistics(TRANSPORT_LL_HANDLE handle, IOTHUB_CLIENT_STATISTICS* statistics)
+{
+    // Codes_SRS_IoTHubTransportAMQP_WS_31_002: [IoTHubTransportAMQP_WS_GetStatistics shall get the statistics by calling into the IoTHubTransport_AMQP_Common_GetStatistics()]
+    return IoTHubTransport_AMQP_Common_GetStatistics(handle, statistics);
+}
+
 static IOTHUB_CLIENT_RESULT IoTHubTransportAMQP_WS_SetOption(TRANSPORT_LL_HANDLE handle, const char* option, const void* value)
 {
     // Codes_SRS_IoTHubTransportAMQP_WS_09_017: [IoTHubTransportAMQP_WS_SetOption shall set the options by calling into the IoTHubTransport_AMQP_Common_SetOption()]
@@ -229,7 +241,9 @@ static TRANSPORT_PROVIDER thisTransportProvider_WebSocketsOverTls =
     IoTHubTransportAMQP_WS_Unsubscribe,                                /*pfIoTHubTransport_Unsubscribe IoTHubTransport_Unsubscribe;*/
     IoTHubTransportAMQP_WS_DoWork,                                     /*pfIoTHubTransport_DoWork IoTHubTransport_DoWork;*/
     IoTHubTransportAMQP_WS_SetRetryPolicy,                             /*pfIoTHubTransport_SetRetryLogic IoTHubTransport_SetRetryPolicy;*/
-    IoTHubTransportAMQP_WS_GetSendStatus                               /*pfIoTHubTransport_GetSendStatus IoTHubTransport_GetSendStatus;*/
+    IoTHubTransportAMQP_WS_GetSendStatus,                              /*pfIoTHubTransport_GetSendStatus IoTHubTransport_GetSendStatus;*/
+    IoTHubTransportAMQP_WS_GetNextDeadline,                            /*pfIoTHubTransport_GetNextDeadline IoTHubTransport_GetNextDeadline;*/
+    IoTHubTransportAMQP_WS_GetStatistics                               /*pfIoTHubTransport_GetStatistics IoTHubTransport_GetStatistics;*/
 };
 
 /* Codes_SRS_IoTHubTransportAMQP_WS_09_019: [This function shall return a pointer to a structure of type TRANSPORT_PROVIDER having the following values for it's fields:
@@ -249,7 +263,9 @@ IoTHubTransport_Unsubscribe = IoTHubTransportAMQP_WS_Unsubscribe
 IoTHubTransport_DoWork = IoTHubTransportAMQP_WS_DoWork
 IoTHubTransport_SetRetryLogic = IoTHubTransportAMQP_WS_SetRetryLogic
 IoTHubTransport_SetOption = IoTHubTransportAMQP_WS_SetOption
-IoTHubTransport_GetSendStatus = IoTHubTransportAMQP_WS_GetSendStatus] */
+IoTHubTransport_GetSendStatus = IoTHubTransportAMQP_WS_GetSendStatus
+IoTHubTransport_GetNextDeadline = IoTHubTransportAMQP_WS_GetNextDeadline
+IoTHubTransport_GetStatistics = IoTHubTransportAMQP_WS_GetStatistics] */
 extern const TRANSPORT_PROVIDER* AMQP_Protocol_over_WebSocketsTls(void)
 {
     return &thisTransportProvider_WebSocketsOverTls;
@@ -1128,7 +1128,7 @@ static STRING_HANDLE make1EventJSONitem(PDLIST_ENTRY item, size_t *messageSizeCo
                     if (!(
                         (STRING_concat_with_STRING(result, encoded) == 0) &&
                         (STRING_concat(result, "\"") == 0) && /*\" because closing value*/
-                        (concat_Properties(result, IoTHubMessage_Properties(message->messageHandle), &propertiesSize) == 0) &&
+                        (concat_Properties(result, IoTHubMessage_ReadOnlyProperties(message->messageHandle), &propertiesSize) == 0) &&
                         (STRING_concat(result, "},") == 0) /*the last comma shall be replaced by a ']' by DaCr's suggestion (which is awesome enough to receive credits in the source code)*/
                         ))
                     {
@@ -1180,7 +1180,7 @@ static STRING_HANDLE make1EventJSONitem(PDLIST_ENTRY item, size_t *messageSizeCo
                     if (!(
                         (STRING_concat_with_STRING(result, asJson) == 0) &&
                         (STRING_concat(result, ",\"base64Encoded\":false") == 0) &&
-                        (concat_Properties(result, IoTHubMessage_Properties(message->messageHandle), &propertiesSize) == 0) &&
+                        (concat_Properties(result, IoTHubMessage_ReadOnlyProperties(message->messageHandle), &propertiesSize) == 0) &&
                         (STRING_concat(result, "},") == 0) /*the last comma shall be replaced by a ']' by DaCr's suggestion (which is awesome enough to receive credits in the source code)*/
                         ))
                     {
@@ -1345,8 +1345,25 @@ static void reversePutListBackIn(PDLIST_ENTRY source, PDLIST_ENTRY destination)
     DList_InitializeListHead(source);
 }
 
+static void completeExpiredEvents(HTTPTRANSPORT_PERDEVICE_DATA* deviceData, IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle)
+{
+    PDLIST_ENTRY actual = deviceData->waitingToSend->Flink;
+    while (actual != deviceData->waitingToSend)
+    {
+        IOTHUB_MESSAGE_LIST* message = containingRecord(actual, IOTHUB_MESSAGE_LIST, entry);
+        /*IoTHubClient_LL_CompleteIfExpired removes the message from waitingToSend when it completes it*/
+        actual = actual->Flink;
+        /*Codes_SRS_TRANSPORTMULTITHTTP_31_009: [ Before sending, IoTHubTransportHttp_DoWork shall call IoTHubClient_LL_CompleteIfExpired for every message of waitingToSend that has an expiry time, so that the expired messages are completed with IOTHUB_CLIENT_CONFIRMATION_MESSAGE_EXPIRED instead of being sent. ]*/
+        if (message->expiryTime != (time_t)0)
+        {
+            (void)IoTHubClient_LL_CompleteIfExpired(iotHubClientHandle, message);
+        }
+    }
+}
+
 static void DoEvent(HTTPTRANSPORT_HANDLE_DATA* handleData, HTTPTRANSPORT_PERDEVICE_DATA* deviceData, IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle)
 {
+    completeExpiredEvents(deviceData, iotHubClientHandle);
 
     if (DList_IsListEmpty(deviceData->waitingToSend))
     {
@@ -1508,7 +1525,7 @@ static void DoEvent(HTTPTRANSPORT_HANDLE_DATA* handleData, HTTPTRANSPORT_PERDEVI
                         else
                         {
                             /*Codes_SRS_TRANSPORTMULTITHTTP_17_078: [Every message property "property":"value" shall be added to the HTTP headers as an individual header "iothub-app-property":"value".] */
-                            MAP_HANDLE map = IoTHubMessage_Properties(message->messageHandle);
+                            MAP_HANDLE map = IoTHubMessage_ReadOnlyProperties(message->messageHandle);
                             const char*const* keys;
                             const char*const* values;
                             size_t count;
@@ -2314,6 +2331,97 @@ static IOTHUB_CLIENT_RESULT IoTHubTransportHttp_GetSendStatus(IOTHUB_DEVICE_HAND
     return result;
 }
 
+static tickcounter_ms_t get_device_next_deadline(HTTPTRANSPORT_HANDLE_DATA* handleData, HTTPTRANSPORT_PERDEVICE_DATA* deviceData)
+{
+    tickcounter_ms_t result;
+
+    if (!DList_IsListEmpty(deviceData->waitingToSend))
+    {
+        /*Codes_SRS_TRANSPORTMULTITHTTP_31_002: [ If a device has events waiting to be sent, the deadline shall be 0. ]*/
+        result = 0;
+    }
+    else if (!deviceData->DoWork_PullMessage)
+    {
+        /*Codes_SRS_TRANSPORTMULTITHTTP_31_003: [ If a device is not subscribed to messages and has no events waiting to be sent, it shall not contribute a deadline. ]*/
+        result = IOTHUB_CLIENT_LL_NO_DEADLINE;
+    }
+    else
+    {
+        /*Codes_SRS_TRANSPORTMULTITHTTP_31_004: [ If a device is subscribed to messages, the deadline shall be the time left until GetMinimumPollingTime has elapsed since the last poll, or 0 if the device has not polled yet or time is not available. ]*/
+        time_t timeNow = get_time(NULL);
+        if (deviceData->isFirstPoll || (timeNow == (time_t)(-1)))
+        {
+            result = 0;
+        }
+        else
+        {
+            double elapsedSeconds = get_difftime(timeNow, deviceData->lastPollTime);
+            if (elapsedSeconds > handleData->getMinimumPollingTime)
+            {
+                result = 0;
+            }
+            else
+            {
+                /*polling is allowed once strictly more than getMinimumPollingTime seconds have passed*/
+                result = (tickcounter_ms_t)((handleData->getMinimumPollingTime + 1 - elapsedSeconds) * 1000);
+            }
+        }
+    }
+
+    return result;
+}
+
+static int IoTHubTransportHttp_GetNextDeadline(TRANSPORT_LL_HANDLE handle, tickcounter_ms_t* msUntilDeadline)
+{
+    int result;
+    /*Codes_SRS_TRANSPORTMULTITHTTP_31_001: [ If handle or msUntilDeadline is NULL, then IoTHubTransportHttp_GetNextDeadline shall fail and return a non-zero value. ]*/
+    if (handle == NULL || msUntilDeadline == NULL)
+    {
+        LogError("Invalid parameter handle: %p, msUntilDeadline: %p", handle, msUntilDeadline);
+        result = __FAILURE__;
+    }
+    else
+    {
+        HTTPTRANSPORT_HANDLE_DATA* handleData = (HTTPTRANSPORT_HANDLE_DATA*)handle;
+        size_t deviceListSize = VECTOR_size(handleData->perDeviceList);
+
+        /*Codes_SRS_TRANSPORTMULTITHTTP_31_005: [ IoTHubTransportHttp_GetNextDeadline shall set msUntilDeadline to the smallest deadline of all the devices in the transport device list. ]*/
+        *msUntilDeadline = IOTHUB_CLIENT_LL_NO_DEADLINE;
+        for (size_t i = 0; i < deviceListSize; i++)
+        {
+            IOTHUB_DEVICE_HANDLE* listItem = (IOTHUB_DEVICE_HANDLE *)VECTOR_element(handleData->perDeviceList, i);
+            HTTPTRANSPORT_PERDEVICE_DATA* perDeviceItem = *(HTTPTRANSPORT_PERDEVICE_DATA**)(listItem);
+            tickcounter_ms_t deviceDeadline = get_device_next_deadline(handleData, perDeviceItem);
+            if (deviceDeadline < *msUntilDeadline)
+            {
+                *msUntilDeadline = deviceDeadline;
+            }
+        }
+        result = 0;
+    }
+    return result;
+}
+
+static int IoTHubTransportHttp_GetStatistics(TRANSPORT_LL_HANDLE handle, IOTHUB_CLIENT_STATISTICS* statistics)
+{
+    int result;
+    /*Codes_SRS_TRANSPORTMULTITHTTP_31_007: [ If handle or statistics is NULL, then IoTHubTransportHttp_GetStatistics shall fail and return a non-zero value. ]*/
+    if (handle == NULL || statistics == NULL)
+    {
+        LogError("Invalid parameter handle: %p, statistics: %p", handle, statistics);
+        result = __FAILURE__;
+    }
+    else
+    {
+        /*Codes_SRS_TRANSPORTMULTITHTTP_31_008: [ IoTHubTransportHttp_GetStatistics shall set in_flight, retries and reconnects to 0, since every request is completed within IoTHubTransportHttp_DoWork and is not resent. ]*/
+        statistics->in_flight = 0;
+        statistics->retries = 0;
+        statistics->reconnects = 0;
+        result = 0;
+    }
+    return result;
+}
+
 static IOTHUB_CLIENT_RESULT IoTHubTransportHttp_SetOption(TRANSPORT_LL_HANDLE handle, const char* option, const void* value)
 {
     IOTHUB_CLIENT_RESULT result;
@@ -2345,6 +2453,11 @@ static IOTHUB_CLIENT_RESULT IoTHubTransportHttp_SetOption(TRANSPORT_LL_HANDLE ha
             handleData->getMinimumPollingTime = *(unsigned int*)value;
             result = IOTHUB_CLIENT_OK;
         }
+        /*Codes_SRS_TRANSPORTMULTITHTTP_31_006: [ "message_pool_size" shall not be passed to HTTPAPIEX_SetOption, IoTHubTransportHttp_SetOption shall return IOTHUB_CLIENT_INVALID_ARG. ]*/
+        else if (strcmp(OPTION_MESSAGE_POOL_SIZE, option) == 0)
+        {
+            result = IOTHUB_CLIENT_INVALID_ARG;
+        }
         else
         {
             /*Codes_SRS_TRANSPORTMULTITHTTP_17_126: [ "TrustedCerts"] */
@@ -2423,7 +2536,9 @@ static TRANSPORT_PROVIDER thisTransportProvider =
     IoTHubTransportHttp_Unsubscribe,                /*pfIoTHubTransport_Unsubscribe IoTHubTransport_Unsubscribe;*/
     IoTHubTransportHttp_DoWork,                     /*pfIoTHubTransport_DoWork IoTHubTransport_DoWork;*/
     IoTHubTransportHttp_SetRetryPolicy,             /*pfIoTHubTransport_DoWork IoTHubTransport_SetRetryPolicy;*/
-    IoTHubTransportHttp_GetSendStatus               /*pfIoTHubTransport_GetSendStatus IoTHubTransport_GetSendStatus;*/
+    IoTHubTransportHttp_GetSendStatus,              /*pfIoTHubTransport_GetSendStatus IoTHubTransport_GetSendStatus;*/
+    IoTHubTransportHttp_GetNextDeadline,            /*pfIoTHubTransport_GetNextDeadline IoTHubTransport_GetNextDeadline;*/
+    IoTHubTransportHttp_GetStatistics               /*pfIoTHubTransport_GetStatistics IoTHubTransport_GetStatistics;*/
 };
 
 const TRANSPORT_PROVIDER* HTTP_Protocol(void)
@@ -126,6 +126,18 @@ static IOTHUB_CLIENT_RESULT IoTHubTransportMqtt_GetSendStatus(IOTHUB_DEVICE_HAND
     return IoTHubTransport_MQTT_Common_GetSendStatus(handle, iotHubClientStatus);
 }
 
+static int IoTHubTransportMqtt_GetNextDeadline(TRANSPORT_LL_HANDLE handle, tickcounter_ms_t* msUntilDeadline)
+{
+    /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_31_001: [ IoTHubTransportMqtt_GetNextDeadline shall get the next deadline by calling into the IoTHubTransport_MQTT_Common_GetNextDeadline function. ] */
+    return IoTHubTransport_MQTT_Common_GetNextDeadline(handle, msUntilDeadline);
+}
+
+static int IoTHubTransportMqtt_GetStatistics(TRANSPORT_LL_HANDLE handle, IOTHUB_CLIENT_STATISTICS* statistics)
+{
+    /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_31_002: [ IoTHubTransportMqtt_GetStatistics shall get the statistics by calling into the IoTHubTransport_MQTT_Common_GetStatistics function. ] */
+    return IoTHubTransport_MQTT_Common_GetStatistics(handle, statistics);
+}
+
 static IOTHUB_CLIENT_RESULT IoTHubTransportMqtt_SetOption(TRANSPORT_LL_HANDLE handle, const char* option, const void* value)
 {
     /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_07_009: [ IoTHubTransportMqtt_SetOption shall set the options by calling into the IoTHubMqttAbstract_SetOption function. ] */
@@ -169,7 +181,9 @@ static TRANSPORT_PROVIDER myfunc =
     IoTHubTransportMqtt_Unsubscribe,                /*pfIoTHubTransport_Unsubscribe IoTHubTransport_Unsubscribe;*/
     IoTHubTransportMqtt_DoWork,                     /*pfIoTHubTransport_DoWork IoTHubTransport_DoWork;*/
     IoTHubTransportMqtt_SetRetryPolicy,             /*pfIoTHubTransport_DoWork IoTHubTransport_SetRetryPolicy;*/
-    IoTHubTransportMqtt_GetSendStatus               /*pfIoTHubTransport_GetSendStatus IoTHubTransport_GetSendStatus;*/
+    IoTHubTransportMqtt_GetSendStatus,              /*pfIoTHubTransport_GetSendStatus IoTHubTransport_GetSendStatus;*/
+    IoTHubTransportMqtt_GetNextDeadline,            /*pfIoTHubTransport_GetNextDeadline IoTHubTransport_GetNextDeadline;*/
+    IoTHubTransportMqtt_GetStatistics               /*pfIoTHubTransport_GetStatistics IoTHubTransport_GetStatistics;*/
 };
 
 /* Codes_SRS_IOTHUB_MQTT_TRANSPORT_07_022: [This function shall return a pointer to a structure of type TRANSPORT_PROVIDER */
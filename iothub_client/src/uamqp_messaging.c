@@ -111,14 +111,14 @@ static int addApplicationPropertiesTouAMQPMessage(IOTHUB_MESSAGE_HANDLE iothub_m
 	const char* const* propertyValues;
 	size_t propertyCount = 0;
 
-	// Codes_SRS_UAMQP_MESSAGING_09_080: [The IOTHUB_MESSAGE_HANDLE properties shall be obtained by calling IoTHubMessage_Properties.]
-	if ((properties_map = IoTHubMessage_Properties(iothub_message_handle)) == NULL)
+	// Codes_SRS_UAMQP_MESSAGING_09_080: [The IOTHUB_MESSAGE_HANDLE properties shall be obtained by calling IoTHubMessage_ReadOnlyProperties.]
+	if ((properties_map = IoTHubMessage_ReadOnlyProperties(iothub_message_handle)) == NULL)
 	{
-		// Codes_SRS_UAMQP_MESSAGING_09_081: [If IoTHubMessage_Properties() fails, message_create_from_iothub_message() shall fail and return immediately..]
+		// Codes_SRS_UAMQP_MESSAGING_09_081: [If IoTHubMessage_ReadOnlyProperties() fails, message_create_from_iothub_message() shall fail and return immediately..]
 		LogError("Failed to get property map from IoTHub message.");
 		result = __FAILURE__;
 	}
-	// Codes_SRS_UAMQP_MESSAGING_09_082: [The actual keys and values, as well as the number of properties shall be obtained by calling Map_GetInternals on the handle obtained from IoTHubMessage_Properties.]
+	// Codes_SRS_UAMQP_MESSAGING_09_082: [The actual keys and values, as well as the number of properties shall be obtained by calling Map_GetInternals on the handle obtained from IoTHubMessage_ReadOnlyProperties.]
 	else if (Map_GetInternals(properties_map, &propertyKeys, &propertyValues, &propertyCount) != MAP_OK)
 	{
 		// Codes_SRS_UAMQP_MESSAGING_09_083: [If Map_GetInternals fails, message_create_from_iothub_message() shall fail and return immediately..]
@@ -0,0 +1,169 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "testrunnerswitcher.h"
+
+#include "iothub_client_compression.h"
+
+#define PERF_ITERATIONS         20000
+#define PERF_MAX_PAYLOAD_SIZE   8192
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+static char payload[PERF_MAX_PAYLOAD_SIZE];
+static unsigned char compressed[PERF_MAX_PAYLOAD_SIZE];
+static unsigned int random_state;
+
+static unsigned int next_random(void)
+{
+    random_state = random_state * 1103515245u + 12345u;
+    return (random_state >> 16) & 0x7FFF;
+}
+
+/*builds a JSON array of readings like the ones the samples send, with values that change from one reading to the next*/
+static size_t create_json_payload(size_t reading_count)
+{
+    size_t size = 0;
+    size_t i;
+    random_state = 1;
+    payload[size++] = '[';
+    for (i = 0; i < reading_count; i++)
+    {
+        int written = sprintf(payload + size, "%s{\"deviceId\":\"myFirstDevice\",\"windSpeed\":%u.%02u,\"temperature\":%u.%02u,\"humidity\":%u.%02u,\"ts\":\"2017-05-04T10:%02u:%02u.%03uZ\"}",
+            (i == 0) ? "" : ",",
+            10 + next_random() % 5, next_random() % 100,
+            20 + next_random() % 10, next_random() % 100,
+            60 + next_random() % 20, next_random() % 100,
+            (unsigned int)(i / 60) % 60, (unsigned int)i % 60, next_random() % 1000);
+        ASSERT_IS_TRUE(written > 0);
+        size += (size_t)written;
+        ASSERT_IS_TRUE(size < PERF_MAX_PAYLOAD_SIZE - 256);
+    }
+    payload[size++] = ']';
+    return size;
+}
+
+static size_t create_random_payload(size_t size)
+{
+    size_t i;
+    random_state = 1;
+    for (i = 0; i < size; i++)
+    {
+        payload[i] = (char)next_random();
+    }
+    return size;
+}
+
+/*compresses the payload the way IoTHubClient_LL does, in a destination one byte smaller than the payload,
+returns the compressed size or 0 when the payload would be sent uncompressed*/
+static size_t compress_payload(size_t size, const char* mode)
+{
+    size_t compressedSize = 0;
+    size_t i;
+    clock_t start;
+    double elapsed_ms;
+
+    start = clock();
+    for (i = 0; i < PERF_ITERATIONS; i++)
+    {
+        size_t destinationSize = size - 1;
+        compressedSize = (IoTHubCompression_Deflate((const unsigned char*)payload, size, compressed, &destinationSize) == 0) ? destinationSize : 0;
+    }
+    elapsed_ms = (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+
+    (void)printf("%-12s size=%5u compressed=%5u saved=%5.1f%% time/message=%7.2f us throughput=%6.1f MB/s\r\n",
+        mode, (unsigned int)size, (unsigned int)compressedSize,
+        (compressedSize == 0) ? 0.0 : 100.0 * (double)(size - compressedSize) / (double)size,
+        elapsed_ms * 1000.0 / PERF_ITERATIONS,
+        (elapsed_ms == 0.0) ? 0.0 : ((double)size * PERF_ITERATIONS / (1024.0 * 1024.0)) / (elapsed_ms / 1000.0));
+    return compressedSize;
+}
+
+BEGIN_TEST_SUITE(iothub_client_compression_perf)
+
+TEST_SUITE_INITIALIZE(TestClassInitialize)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+}
+
+TEST_SUITE_CLEANUP(TestClassCleanup)
+{
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest))
+    {
+        ASSERT_FAIL("Could not acquire test serialization mutex.");
+    }
+}
+
+TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+{
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+TEST_FUNCTION(IoTHubCompression_Deflate_single_json_reading)
+{
+    ///arrange
+    size_t size = create_json_payload(1);
+
+    ///act
+    (void)compress_payload(size, "json x1");
+
+    ///assert
+    /*a single reading has too little redundancy to be worth compressing, which is what the default "compression_min_size" is about*/
+    ASSERT_IS_TRUE(size < IOTHUB_CLIENT_COMPRESSION_DEFAULT_MIN_SIZE);
+}
+
+TEST_FUNCTION(IoTHubCompression_Deflate_batch_of_json_readings)
+{
+    ///arrange
+    size_t size = create_json_payload(10);
+
+    ///act
+    size_t compressedSize = compress_payload(size, "json x10");
+
+    ///assert
+    ASSERT_IS_TRUE(compressedSize != 0);
+    ASSERT_IS_TRUE(compressedSize * 2 < size);
+}
+
+TEST_FUNCTION(IoTHubCompression_Deflate_large_batch_of_json_readings)
+{
+    ///arrange
+    size_t size = create_json_payload(50);
+
+    ///act
+    size_t compressedSize = compress_payload(size, "json x50");
+
+    ///assert
+    ASSERT_IS_TRUE(compressedSize != 0);
+    ASSERT_IS_TRUE(compressedSize * 3 < size);
+}
+
+TEST_FUNCTION(IoTHubCompression_Deflate_random_bytes_are_sent_uncompressed)
+{
+    ///arrange
+    size_t size = create_random_payload(1024);
+
+    ///act
+    size_t compressedSize = compress_payload(size, "random");
+
+    ///assert
+    /*the time reported is what it costs to find out that a payload does not compress*/
+    ASSERT_ARE_EQUAL(size_t, (size_t)0, compressedSize);
+}
+
+END_TEST_SUITE(iothub_client_compression_perf)
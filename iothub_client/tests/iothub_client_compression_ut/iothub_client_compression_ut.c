@@ -0,0 +1,231 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifdef __cplusplus
+#include <cstdlib>
+#include <cstddef>
+#include <cstring>
+#else
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#endif
+
+static void* my_gballoc_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+static void my_gballoc_free(void* ptr)
+{
+    free(ptr);
+}
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+#include "umocktypes_charptr.h"
+#include "umocktypes_stdint.h"
+
+#define ENABLE_MOCKS
+#include "azure_c_shared_utility/gballoc.h"
+#undef ENABLE_MOCKS
+
+#include "iothub_client_compression.h"
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+DEFINE_ENUM_STRINGS(UMOCK_C_ERROR_CODE, UMOCK_C_ERROR_CODE_VALUES)
+
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    char temp_str[256];
+    (void)snprintf(temp_str, sizeof(temp_str), "umock_c reported error :%s", ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+    ASSERT_FAIL(temp_str);
+}
+
+static const unsigned char TEST_REPEATED_CONTENT[] = "abcabcabcabcabcabc";
+#define TEST_REPEATED_CONTENT_SIZE (sizeof(TEST_REPEATED_CONTENT) - 1)
+
+/*zlib header, "abc" as literals, a match of 15 bytes at distance 3, end of block, adler32*/
+static const unsigned char TEST_REPEATED_CONTENT_DEFLATED[] = { 0x78, 0x01, 0x4b, 0x4c, 0x4a, 0x46, 0x43, 0x00, 0x41, 0x7c, 0x06, 0xe5 };
+/*zlib header, end of block, adler32 of nothing*/
+static const unsigned char TEST_EMPTY_CONTENT_DEFLATED[] = { 0x78, 0x01, 0x03, 0x00, 0x00, 0x00, 0x00, 0x01 };
+
+BEGIN_TEST_SUITE(iothub_client_compression_ut)
+
+TEST_SUITE_INITIALIZE(TestClassInitialize)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+
+    umock_c_init(on_umock_c_error);
+
+    int result = umocktypes_charptr_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+    result = umocktypes_stdint_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_malloc, NULL);
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
+}
+
+TEST_SUITE_CLEANUP(TestClassCleanup)
+{
+    umock_c_deinit();
+
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest))
+    {
+        ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+    }
+
+    umock_c_reset_all_calls();
+}
+
+TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+{
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_COMPRESSION_31_001: [ If source is NULL while size is not 0, or destination or destinationSize is NULL, IoTHubCompression_Deflate shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubCompression_Deflate_NULL_source_fails)
+{
+    // arrange
+    unsigned char destination[64];
+    size_t destinationSize = sizeof(destination);
+
+    // act
+    int result = IoTHubCompression_Deflate(NULL, 1, destination, &destinationSize);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(size_t, sizeof(destination), destinationSize);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_COMPRESSION_31_001: [ If source is NULL while size is not 0, or destination or destinationSize is NULL, IoTHubCompression_Deflate shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubCompression_Deflate_NULL_destination_fails)
+{
+    // arrange
+    size_t destinationSize = 64;
+
+    // act
+    int result = IoTHubCompression_Deflate(TEST_REPEATED_CONTENT, TEST_REPEATED_CONTENT_SIZE, NULL, &destinationSize);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_COMPRESSION_31_001: [ If source is NULL while size is not 0, or destination or destinationSize is NULL, IoTHubCompression_Deflate shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubCompression_Deflate_NULL_destinationSize_fails)
+{
+    // arrange
+    unsigned char destination[64];
+
+    // act
+    int result = IoTHubCompression_Deflate(TEST_REPEATED_CONTENT, TEST_REPEATED_CONTENT_SIZE, destination, NULL);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_COMPRESSION_31_002: [ If allocating memory fails, IoTHubCompression_Deflate shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubCompression_Deflate_when_malloc_fails_fails)
+{
+    // arrange
+    unsigned char destination[64];
+    size_t destinationSize = sizeof(destination);
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+
+    // act
+    int result = IoTHubCompression_Deflate(TEST_REPEATED_CONTENT, TEST_REPEATED_CONTENT_SIZE, destination, &destinationSize);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(size_t, sizeof(destination), destinationSize);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_COMPRESSION_31_003: [ IoTHubCompression_Deflate shall write to destination a zlib stream (RFC 1950) holding a single deflate block (RFC 1951) of fixed Huffman codes, whose matches are found by looking up the last position of the same 3 bytes in the previous 32KB. ]*/
+/* Tests_SRS_IOTHUB_CLIENT_COMPRESSION_31_005: [ Otherwise IoTHubCompression_Deflate shall set *destinationSize to the size of the compressed content and return 0. ]*/
+TEST_FUNCTION(IoTHubCompression_Deflate_replaces_repeated_bytes_by_a_match)
+{
+    // arrange
+    unsigned char destination[64];
+    size_t destinationSize = sizeof(destination);
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    // act
+    int result = IoTHubCompression_Deflate(TEST_REPEATED_CONTENT, TEST_REPEATED_CONTENT_SIZE, destination, &destinationSize);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(size_t, sizeof(TEST_REPEATED_CONTENT_DEFLATED), destinationSize);
+    ASSERT_ARE_EQUAL(int, 0, memcmp(TEST_REPEATED_CONTENT_DEFLATED, destination, destinationSize));
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_COMPRESSION_31_003: [ IoTHubCompression_Deflate shall write to destination a zlib stream (RFC 1950) holding a single deflate block (RFC 1951) of fixed Huffman codes, whose matches are found by looking up the last position of the same 3 bytes in the previous 32KB. ]*/
+TEST_FUNCTION(IoTHubCompression_Deflate_empty_content_succeeds)
+{
+    // arrange
+    unsigned char destination[64];
+    size_t destinationSize = sizeof(destination);
+
+    // act
+    int result = IoTHubCompression_Deflate(NULL, 0, destination, &destinationSize);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(size_t, sizeof(TEST_EMPTY_CONTENT_DEFLATED), destinationSize);
+    ASSERT_ARE_EQUAL(int, 0, memcmp(TEST_EMPTY_CONTENT_DEFLATED, destination, destinationSize));
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_COMPRESSION_31_004: [ If the compressed content does not fit in *destinationSize bytes, IoTHubCompression_Deflate shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(IoTHubCompression_Deflate_when_the_compressed_content_does_not_fit_fails)
+{
+    // arrange
+    unsigned char destination[sizeof(TEST_REPEATED_CONTENT_DEFLATED) + 1];
+    size_t destinationSize = sizeof(TEST_REPEATED_CONTENT_DEFLATED) - 1;
+    destination[destinationSize] = 0xAA;
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    // act
+    int result = IoTHubCompression_Deflate(TEST_REPEATED_CONTENT, TEST_REPEATED_CONTENT_SIZE, destination, &destinationSize);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(size_t, sizeof(TEST_REPEATED_CONTENT_DEFLATED) - 1, destinationSize);
+    ASSERT_ARE_EQUAL(int, 0xAA, (int)destination[sizeof(TEST_REPEATED_CONTENT_DEFLATED) - 1]);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_COMPRESSION_31_006: [ IoTHubCompression_DeflateCodec shall return a codec compressing with IoTHubCompression_Deflate whose content encoding is "deflate". ]*/
+TEST_FUNCTION(IoTHubCompression_DeflateCodec_returns_the_deflate_codec)
+{
+    // act
+    const IOTHUB_CLIENT_COMPRESSION_CODEC* codec = IoTHubCompression_DeflateCodec();
+
+    // assert
+    ASSERT_IS_NOT_NULL(codec);
+    ASSERT_ARE_EQUAL(char_ptr, "deflate", codec->contentEncoding);
+    ASSERT_IS_TRUE(codec->compress == IoTHubCompression_Deflate);
+}
+
+END_TEST_SUITE(iothub_client_compression_ut)
@@ -0,0 +1,417 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifdef __cplusplus
+#include <cstdlib>
+#include <cstddef>
+#include <cstring>
+#else
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#endif
+
+static void* my_gballoc_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+static void my_gballoc_free(void* ptr)
+{
+    free(ptr);
+}
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+#include "umocktypes_charptr.h"
+#include "umocktypes_stdint.h"
+
+#define ENABLE_MOCKS
+#include "azure_c_shared_utility/gballoc.h"
+#undef ENABLE_MOCKS
+
+#include "iothub_client_congestion_control.h"
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+DEFINE_ENUM_STRINGS(UMOCK_C_ERROR_CODE, UMOCK_C_ERROR_CODE_VALUES)
+
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    char temp_str[256];
+    (void)snprintf(temp_str, sizeof(temp_str), "umock_c reported error :%s", ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+    ASSERT_FAIL(temp_str);
+}
+
+#define TEST_MAX_WINDOW 16
+/*with a base latency of 100 ms, a latency above 2 * 100 + 50 ms is a sign of congestion*/
+#define TEST_LATENCY 100
+#define TEST_CONGESTED_LATENCY 251
+/*with a smoothed latency of 100 ms, the window does not change for 100 + 50 ms after a decrease*/
+#define TEST_RECOVERY_MS 150
+
+static CONGESTION_CONTROL_HANDLE create_with_window(size_t window, tickcounter_ms_t* current_ms)
+{
+    CONGESTION_CONTROL_HANDLE handle = congestion_control_create(TEST_MAX_WINDOW);
+    ASSERT_IS_NOT_NULL(handle);
+    while (congestion_control_get_window(handle) < window)
+    {
+        congestion_control_on_ack(handle, TEST_LATENCY, *current_ms);
+        (*current_ms)++;
+    }
+    umock_c_reset_all_calls();
+    return handle;
+}
+
+BEGIN_TEST_SUITE(iothub_client_congestion_control_ut)
+
+TEST_SUITE_INITIALIZE(TestClassInitialize)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+
+    umock_c_init(on_umock_c_error);
+
+    int result = umocktypes_charptr_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+    result = umocktypes_stdint_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_malloc, NULL);
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
+}
+
+TEST_SUITE_CLEANUP(TestClassCleanup)
+{
+    umock_c_deinit();
+
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest))
+    {
+        ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+    }
+
+    umock_c_reset_all_calls();
+}
+
+TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+{
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_CONGESTION_CONTROL_31_001: [ If max_window is 0, congestion_control_create shall return NULL. ]*/
+TEST_FUNCTION(congestion_control_create_with_0_max_window_fails)
+{
+    // act
+    CONGESTION_CONTROL_HANDLE handle = congestion_control_create(0);
+
+    // assert
+    ASSERT_IS_NULL(handle);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_CONGESTION_CONTROL_31_002: [ If allocating memory fails, congestion_control_create shall return NULL. ]*/
+TEST_FUNCTION(congestion_control_create_when_malloc_fails_fails)
+{
+    // arrange
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+
+    // act
+    CONGESTION_CONTROL_HANDLE handle = congestion_control_create(TEST_MAX_WINDOW);
+
+    // assert
+    ASSERT_IS_NULL(handle);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_CONGESTION_CONTROL_31_003: [ congestion_control_create shall return a controller whose window is 1 and whose slow start threshold is max_window. ]*/
+TEST_FUNCTION(congestion_control_create_starts_with_a_window_of_1)
+{
+    // arrange
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+
+    // act
+    CONGESTION_CONTROL_HANDLE handle = congestion_control_create(TEST_MAX_WINDOW);
+
+    // assert
+    ASSERT_IS_NOT_NULL(handle);
+    ASSERT_ARE_EQUAL(size_t, 1, congestion_control_get_window(handle));
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    congestion_control_destroy(handle);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_CONGESTION_CONTROL_31_004: [ If handle is NULL, congestion_control_destroy shall do nothing, otherwise it shall free the controller. ]*/
+TEST_FUNCTION(congestion_control_destroy_with_NULL_handle_does_nothing)
+{
+    // act
+    congestion_control_destroy(NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_CONGESTION_CONTROL_31_004: [ If handle is NULL, congestion_control_destroy shall do nothing, otherwise it shall free the controller. ]*/
+TEST_FUNCTION(congestion_control_destroy_frees_the_controller)
+{
+    // arrange
+    CONGESTION_CONTROL_HANDLE handle = congestion_control_create(TEST_MAX_WINDOW);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_free(handle));
+
+    // act
+    congestion_control_destroy(handle);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_CONGESTION_CONTROL_31_005: [ If handle is NULL, congestion_control_on_ack and congestion_control_on_failure shall do nothing. ]*/
+TEST_FUNCTION(congestion_control_on_ack_and_on_failure_with_NULL_handle_do_nothing)
+{
+    // act
+    congestion_control_on_ack(NULL, TEST_LATENCY, 0);
+    congestion_control_on_failure(NULL, 0);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_CONGESTION_CONTROL_31_008: [ While the window is below the slow start threshold, congestion_control_on_ack shall grow it by 1. ]*/
+TEST_FUNCTION(congestion_control_on_ack_in_slow_start_grows_the_window_by_1_per_ack)
+{
+    // arrange
+    tickcounter_ms_t current_ms = 0;
+    CONGESTION_CONTROL_HANDLE handle = create_with_window(1, &current_ms);
+
+    // act
+    congestion_control_on_ack(handle, TEST_LATENCY, current_ms++);
+    size_t window_after_1_ack = congestion_control_get_window(handle);
+    congestion_control_on_ack(handle, TEST_LATENCY, current_ms++);
+    size_t window_after_2_acks = congestion_control_get_window(handle);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 2, window_after_1_ack);
+    ASSERT_ARE_EQUAL(size_t, 3, window_after_2_acks);
+
+    // cleanup
+    congestion_control_destroy(handle);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_CONGESTION_CONTROL_31_010: [ The window shall never grow above max_window. ]*/
+TEST_FUNCTION(congestion_control_on_ack_does_not_grow_the_window_above_max_window)
+{
+    // arrange
+    tickcounter_ms_t current_ms = 0;
+    CONGESTION_CONTROL_HANDLE handle = create_with_window(TEST_MAX_WINDOW, &current_ms);
+
+    // act
+    for (size_t i = 0; i < 2 * TEST_MAX_WINDOW; i++)
+    {
+        congestion_control_on_ack(handle, TEST_LATENCY, current_ms++);
+    }
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, TEST_MAX_WINDOW, congestion_control_get_window(handle));
+
+    // cleanup
+    congestion_control_destroy(handle);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_CONGESTION_CONTROL_31_011: [ congestion_control_on_failure shall halve the window, down to 1, and set the slow start threshold to the new window. ]*/
+TEST_FUNCTION(congestion_control_on_failure_halves_the_window)
+{
+    // arrange
+    tickcounter_ms_t current_ms = 0;
+    CONGESTION_CONTROL_HANDLE handle = create_with_window(8, &current_ms);
+
+    // act
+    congestion_control_on_failure(handle, current_ms);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 4, congestion_control_get_window(handle));
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    congestion_control_destroy(handle);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_CONGESTION_CONTROL_31_011: [ congestion_control_on_failure shall halve the window, down to 1, and set the slow start threshold to the new window. ]*/
+TEST_FUNCTION(congestion_control_on_failure_does_not_decrease_the_window_below_1)
+{
+    // arrange
+    tickcounter_ms_t current_ms = 0;
+    CONGESTION_CONTROL_HANDLE handle = create_with_window(1, &current_ms);
+
+    // act
+    congestion_control_on_failure(handle, current_ms);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 1, congestion_control_get_window(handle));
+
+    // cleanup
+    congestion_control_destroy(handle);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_CONGESTION_CONTROL_31_011: [ congestion_control_on_failure shall halve the window, down to 1, and set the slow start threshold to the new window. ]*/
+/* Tests_SRS_IOTHUB_CLIENT_CONGESTION_CONTROL_31_009: [ Otherwise congestion_control_on_ack shall grow the window by 1 once as many acks as the window were counted since it last changed. ]*/
+TEST_FUNCTION(congestion_control_on_ack_after_a_failure_grows_the_window_by_1_per_window_of_acks)
+{
+    // arrange
+    tickcounter_ms_t current_ms = 0;
+    CONGESTION_CONTROL_HANDLE handle = create_with_window(8, &current_ms);
+    congestion_control_on_failure(handle, current_ms);
+    current_ms += TEST_RECOVERY_MS;
+
+    // act
+    congestion_control_on_ack(handle, TEST_LATENCY, current_ms++);
+    congestion_control_on_ack(handle, TEST_LATENCY, current_ms++);
+    congestion_control_on_ack(handle, TEST_LATENCY, current_ms++);
+    size_t window_after_3_acks = congestion_control_get_window(handle);
+    congestion_control_on_ack(handle, TEST_LATENCY, current_ms++);
+    size_t window_after_4_acks = congestion_control_get_window(handle);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 4, window_after_3_acks);
+    ASSERT_ARE_EQUAL(size_t, 5, window_after_4_acks);
+
+    // cleanup
+    congestion_control_destroy(handle);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_CONGESTION_CONTROL_31_012: [ After a decrease, the window shall neither decrease nor grow again until the smoothed latency plus CONGESTION_CONTROL_LATENCY_SLACK_MS milliseconds have passed, so that it decreases at most once per round trip. ]*/
+TEST_FUNCTION(congestion_control_on_failure_decreases_the_window_at_most_once_per_round_trip)
+{
+    // arrange
+    tickcounter_ms_t current_ms = 0;
+    CONGESTION_CONTROL_HANDLE handle = create_with_window(8, &current_ms);
+    congestion_control_on_failure(handle, current_ms);
+
+    // act
+    congestion_control_on_failure(handle, current_ms + 1);
+    size_t window_during_the_round_trip = congestion_control_get_window(handle);
+    congestion_control_on_failure(handle, current_ms + TEST_RECOVERY_MS);
+    size_t window_after_the_round_trip = congestion_control_get_window(handle);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 4, window_during_the_round_trip);
+    ASSERT_ARE_EQUAL(size_t, 2, window_after_the_round_trip);
+
+    // cleanup
+    congestion_control_destroy(handle);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_CONGESTION_CONTROL_31_012: [ After a decrease, the window shall neither decrease nor grow again until the smoothed latency plus CONGESTION_CONTROL_LATENCY_SLACK_MS milliseconds have passed, so that it decreases at most once per round trip. ]*/
+TEST_FUNCTION(congestion_control_on_ack_does_not_grow_the_window_in_the_round_trip_after_a_decrease)
+{
+    // arrange
+    tickcounter_ms_t current_ms = 0;
+    CONGESTION_CONTROL_HANDLE handle = create_with_window(8, &current_ms);
+    congestion_control_on_failure(handle, current_ms);
+
+    // act
+    for (size_t i = 0; i < 8; i++)
+    {
+        congestion_control_on_ack(handle, TEST_LATENCY, current_ms + 1 + i);
+    }
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 4, congestion_control_get_window(handle));
+
+    // cleanup
+    congestion_control_destroy(handle);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_CONGESTION_CONTROL_31_007: [ If latency is above CONGESTION_CONTROL_LATENCY_FACTOR times the base latency plus CONGESTION_CONTROL_LATENCY_SLACK_MS, congestion_control_on_ack shall decrease the window like congestion_control_on_failure. ]*/
+TEST_FUNCTION(congestion_control_on_ack_with_a_latency_well_above_the_base_latency_halves_the_window)
+{
+    // arrange
+    tickcounter_ms_t current_ms = 0;
+    CONGESTION_CONTROL_HANDLE handle = create_with_window(8, &current_ms);
+
+    // act
+    congestion_control_on_ack(handle, TEST_CONGESTED_LATENCY, current_ms);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 4, congestion_control_get_window(handle));
+
+    // cleanup
+    congestion_control_destroy(handle);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_CONGESTION_CONTROL_31_007: [ If latency is above CONGESTION_CONTROL_LATENCY_FACTOR times the base latency plus CONGESTION_CONTROL_LATENCY_SLACK_MS, congestion_control_on_ack shall decrease the window like congestion_control_on_failure. ]*/
+TEST_FUNCTION(congestion_control_on_ack_with_a_latency_at_the_threshold_grows_the_window)
+{
+    // arrange
+    tickcounter_ms_t current_ms = 0;
+    CONGESTION_CONTROL_HANDLE handle = create_with_window(8, &current_ms);
+
+    // act
+    congestion_control_on_ack(handle, TEST_CONGESTED_LATENCY - 1, current_ms);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 9, congestion_control_get_window(handle));
+
+    // cleanup
+    congestion_control_destroy(handle);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_CONGESTION_CONTROL_31_006: [ The base latency shall be the lowest latency given to congestion_control_on_ack in the current and the previous period of CONGESTION_CONTROL_BASE_LATENCY_PERIOD_MS milliseconds. ]*/
+TEST_FUNCTION(congestion_control_on_ack_keeps_the_base_latency_of_the_previous_period)
+{
+    // arrange
+    tickcounter_ms_t current_ms = 0;
+    CONGESTION_CONTROL_HANDLE handle = create_with_window(2, &current_ms);
+    congestion_control_on_ack(handle, 2 * TEST_LATENCY, CONGESTION_CONTROL_BASE_LATENCY_PERIOD_MS);
+
+    // act
+    congestion_control_on_ack(handle, 3 * TEST_LATENCY, CONGESTION_CONTROL_BASE_LATENCY_PERIOD_MS + 1);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 1, congestion_control_get_window(handle));
+
+    // cleanup
+    congestion_control_destroy(handle);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_CONGESTION_CONTROL_31_006: [ The base latency shall be the lowest latency given to congestion_control_on_ack in the current and the previous period of CONGESTION_CONTROL_BASE_LATENCY_PERIOD_MS milliseconds. ]*/
+TEST_FUNCTION(congestion_control_on_ack_forgets_the_base_latency_older_than_2_periods)
+{
+    // arrange
+    tickcounter_ms_t current_ms = 0;
+    CONGESTION_CONTROL_HANDLE handle = create_with_window(2, &current_ms);
+    congestion_control_on_ack(handle, 2 * TEST_LATENCY, CONGESTION_CONTROL_BASE_LATENCY_PERIOD_MS);
+    congestion_control_on_ack(handle, 2 * TEST_LATENCY, 2 * CONGESTION_CONTROL_BASE_LATENCY_PERIOD_MS);
+
+    // act
+    congestion_control_on_ack(handle, 4 * TEST_LATENCY, 2 * CONGESTION_CONTROL_BASE_LATENCY_PERIOD_MS + 1);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 5, congestion_control_get_window(handle));
+
+    // cleanup
+    congestion_control_destroy(handle);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_CONGESTION_CONTROL_31_013: [ congestion_control_get_window shall return the window, or 0 if handle is NULL. ]*/
+TEST_FUNCTION(congestion_control_get_window_with_NULL_handle_returns_0)
+{
+    // act
+    size_t window = congestion_control_get_window(NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 0, window);
+}
+
+END_TEST_SUITE(iothub_client_congestion_control_ut)
@@ -0,0 +1,773 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifdef __cplusplus
+#include <cstdlib>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#else
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#endif
+
+static void* my_gballoc_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+static void my_gballoc_free(void* ptr)
+{
+    free(ptr);
+}
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+#include "umocktypes_charptr.h"
+#include "umocktypes_stdint.h"
+
+#define ENABLE_MOCKS
+#include "azure_c_shared_utility/gballoc.h"
+#undef ENABLE_MOCKS
+
+#include "iothub_client_journal.h"
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+DEFINE_ENUM_STRINGS(UMOCK_C_ERROR_CODE, UMOCK_C_ERROR_CODE_VALUES)
+
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    char temp_str[256];
+    (void)snprintf(temp_str, sizeof(temp_str), "umock_c reported error :%s", ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+    ASSERT_FAIL(temp_str);
+}
+
+/*the journal works on real files, in the directory the tests run from*/
+#define TEST_DIRECTORY          "."
+#define TEST_RECORD_SIZE        16
+#define TEST_MAX_SEGMENTS       8
+#define TEST_MAX_REPLAYED       16
+/*a segment holds exactly 2 records of TEST_RECORD_SIZE bytes*/
+#define TEST_SEGMENT_SIZE       (12 + (2 * (8 + TEST_RECORD_SIZE)))
+
+static size_t g_replayedCount;
+static uint64_t g_replayedSequences[TEST_MAX_REPLAYED];
+static unsigned char g_replayedFirstBytes[TEST_MAX_REPLAYED];
+static int g_replayResult;
+
+static int on_replay(const unsigned char* record, size_t size, uint64_t sequence, void* context)
+{
+    ASSERT_ARE_EQUAL(size_t, TEST_RECORD_SIZE, size);
+    ASSERT_ARE_EQUAL(void_ptr, (void*)&g_replayedCount, context);
+    if (g_replayedCount < TEST_MAX_REPLAYED)
+    {
+        g_replayedSequences[g_replayedCount] = sequence;
+        g_replayedFirstBytes[g_replayedCount] = record[0];
+    }
+    g_replayedCount++;
+    return g_replayResult;
+}
+
+static void remove_journal_files(void)
+{
+    char path[64];
+    unsigned long number;
+    (void)remove(TEST_DIRECTORY "/journal.head");
+    (void)remove(TEST_DIRECTORY "/journal.head.tmp");
+    for (number = 0; number < TEST_MAX_SEGMENTS; number++)
+    {
+        (void)sprintf(path, TEST_DIRECTORY "/journal_%lu.seg", number);
+        (void)remove(path);
+    }
+}
+
+static int segment_exists(unsigned long number)
+{
+    char path[64];
+    FILE* file;
+    (void)sprintf(path, TEST_DIRECTORY "/journal_%lu.seg", number);
+    file = fopen(path, "rb");
+    if (file != NULL)
+    {
+        (void)fclose(file);
+    }
+    return (file != NULL) ? 1 : 0;
+}
+
+/*leaves a head file holding content, as a crash while it was rewritten in place could have*/
+static void write_head_file(const char* content)
+{
+    FILE* file = fopen(TEST_DIRECTORY "/journal.head", "w");
+    ASSERT_IS_NOT_NULL(file);
+    ASSERT_IS_TRUE(fputs(content, file) >= 0);
+    (void)fclose(file);
+}
+
+static int file_exists(const char* path)
+{
+    FILE* file = fopen(path, "rb");
+    if (file != NULL)
+    {
+        (void)fclose(file);
+    }
+    return (file != NULL) ? 1 : 0;
+}
+
+static JOURNAL_HANDLE create_journal(void)
+{
+    JOURNAL_HANDLE result = journal_create(TEST_DIRECTORY, TEST_SEGMENT_SIZE, on_replay, &g_replayedCount);
+    ASSERT_IS_NOT_NULL(result);
+    umock_c_reset_all_calls();
+    return result;
+}
+
+static uint64_t append_record(JOURNAL_HANDLE journal, unsigned char value)
+{
+    unsigned char record[TEST_RECORD_SIZE];
+    uint64_t sequence = 0;
+    (void)memset(record, value, sizeof(record));
+    ASSERT_ARE_EQUAL(int, 0, journal_append(journal, record, sizeof(record), &sequence));
+    return sequence;
+}
+
+BEGIN_TEST_SUITE(iothub_client_journal_ut)
+
+TEST_SUITE_INITIALIZE(TestClassInitialize)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+
+    umock_c_init(on_umock_c_error);
+
+    int result = umocktypes_charptr_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+    result = umocktypes_stdint_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_malloc, NULL);
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
+}
+
+TEST_SUITE_CLEANUP(TestClassCleanup)
+{
+    umock_c_deinit();
+
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest))
+    {
+        ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+    }
+
+    umock_c_reset_all_calls();
+    remove_journal_files();
+    g_replayedCount = 0;
+    g_replayResult = 0;
+}
+
+TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+{
+    remove_journal_files();
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_001: [ If directory is NULL or segment_size cannot hold the header of a segment and a record of one byte, journal_create shall fail and return NULL. ]*/
+TEST_FUNCTION(journal_create_NULL_directory_fails)
+{
+    // act
+    JOURNAL_HANDLE journal = journal_create(NULL, TEST_SEGMENT_SIZE, on_replay, &g_replayedCount);
+
+    // assert
+    ASSERT_IS_NULL(journal);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_001: [ If directory is NULL or segment_size cannot hold the header of a segment and a record of one byte, journal_create shall fail and return NULL. ]*/
+TEST_FUNCTION(journal_create_too_small_segment_size_fails)
+{
+    // act
+    JOURNAL_HANDLE journal = journal_create(TEST_DIRECTORY, 20, on_replay, &g_replayedCount);
+
+    // assert
+    ASSERT_IS_NULL(journal);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_002: [ If allocating memory fails, journal_create shall fail and return NULL. ]*/
+TEST_FUNCTION(journal_create_malloc_fails)
+{
+    // arrange
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+
+    // act
+    JOURNAL_HANDLE journal = journal_create(TEST_DIRECTORY, TEST_SEGMENT_SIZE, on_replay, &g_replayedCount);
+
+    // assert
+    ASSERT_IS_NULL(journal);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_002: [ If allocating memory fails, journal_create shall fail and return NULL. ]*/
+TEST_FUNCTION(journal_create_path_malloc_fails)
+{
+    // arrange
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    // act
+    JOURNAL_HANDLE journal = journal_create(TEST_DIRECTORY, TEST_SEGMENT_SIZE, on_replay, &g_replayedCount);
+
+    // assert
+    ASSERT_IS_NULL(journal);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_003: [ journal_create shall read the number of the oldest segment from the head file of directory, or start from segment 0 if there is no head file. ]*/
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_007: [ journal_create shall start a new segment after the last one replayed, whose first record has the sequence following the last replayed record, or 1 for an empty journal, and return the handle of the journal. ]*/
+TEST_FUNCTION(journal_create_empty_directory_succeeds)
+{
+    // arrange
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+
+    // act
+    JOURNAL_HANDLE journal = journal_create(TEST_DIRECTORY, TEST_SEGMENT_SIZE, on_replay, &g_replayedCount);
+
+    // assert
+    ASSERT_IS_NOT_NULL(journal);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 0, g_replayedCount);
+    ASSERT_IS_TRUE(segment_exists(0));
+    ASSERT_ARE_EQUAL(size_t, 1, (size_t)append_record(journal, 1));
+
+    // cleanup
+    journal_destroy(journal);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_008: [ If replaying the segments or starting the new segment fails, journal_create shall fail and return NULL. ]*/
+TEST_FUNCTION(journal_create_segment_malloc_fails)
+{
+    // arrange
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    // act
+    JOURNAL_HANDLE journal = journal_create(TEST_DIRECTORY, TEST_SEGMENT_SIZE, on_replay, &g_replayedCount);
+
+    // assert
+    ASSERT_IS_NULL(journal);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_IS_FALSE(segment_exists(0));
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_004: [ journal_create shall read the segments from the oldest one to the first one missing and call replay_callback, if not NULL, with every record they hold, its size and its sequence, in the order they were appended. ]*/
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_010: [ journal_destroy shall commit the records appended since the last commit, close the newest segment and free the journal. The segment files are left in the directory. ]*/
+TEST_FUNCTION(journal_create_replays_the_records_in_order)
+{
+    // arrange
+    unsigned char value;
+    JOURNAL_HANDLE journal = create_journal();
+    for (value = 1; value <= 5; value++)
+    {
+        (void)append_record(journal, value);
+    }
+    journal_destroy(journal);
+
+    // act
+    journal = journal_create(TEST_DIRECTORY, TEST_SEGMENT_SIZE, on_replay, &g_replayedCount);
+
+    // assert
+    ASSERT_IS_NOT_NULL(journal);
+    ASSERT_ARE_EQUAL(size_t, 5, g_replayedCount);
+    for (value = 1; value <= 5; value++)
+    {
+        ASSERT_ARE_EQUAL(size_t, value, (size_t)g_replayedSequences[value - 1]);
+        ASSERT_ARE_EQUAL(int, value, g_replayedFirstBytes[value - 1]);
+    }
+    ASSERT_ARE_EQUAL(size_t, 6, (size_t)append_record(journal, 6));
+
+    // cleanup
+    journal_destroy(journal);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_005: [ Replaying a segment shall stop at the first record that is truncated or whose checksum does not match its bytes. ]*/
+TEST_FUNCTION(journal_create_stops_replaying_a_segment_at_a_torn_record)
+{
+    // arrange
+    FILE* file;
+    static const unsigned char tornRecord[] = { TEST_RECORD_SIZE, 0, 0, 0, 0x12, 0x34, 0x56, 0x78, 1, 2, 3 };
+    JOURNAL_HANDLE journal = create_journal();
+    (void)append_record(journal, 1);
+    journal_destroy(journal);
+    file = fopen(TEST_DIRECTORY "/journal_0.seg", "ab");
+    ASSERT_IS_NOT_NULL(file);
+    ASSERT_ARE_EQUAL(size_t, sizeof(tornRecord), fwrite(tornRecord, 1, sizeof(tornRecord), file));
+    (void)fclose(file);
+
+    // act
+    journal = journal_create(TEST_DIRECTORY, TEST_SEGMENT_SIZE, on_replay, &g_replayedCount);
+
+    // assert
+    ASSERT_IS_NOT_NULL(journal);
+    ASSERT_ARE_EQUAL(size_t, 1, g_replayedCount);
+    ASSERT_ARE_EQUAL(size_t, 2, (size_t)append_record(journal, 2));
+
+    // cleanup
+    journal_destroy(journal);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_006: [ If replay_callback returns a non-zero value, the record shall be confirmed. ]*/
+TEST_FUNCTION(journal_create_confirms_the_records_the_callback_fails)
+{
+    // arrange
+    JOURNAL_HANDLE journal = create_journal();
+    (void)append_record(journal, 1);
+    (void)append_record(journal, 2);
+    journal_destroy(journal);
+    g_replayResult = 1;
+
+    // act
+    journal = journal_create(TEST_DIRECTORY, TEST_SEGMENT_SIZE, on_replay, &g_replayedCount);
+
+    // assert
+    ASSERT_IS_NOT_NULL(journal);
+    ASSERT_ARE_EQUAL(size_t, 2, g_replayedCount);
+    ASSERT_IS_FALSE(segment_exists(0));
+    ASSERT_IS_TRUE(segment_exists(1));
+
+    // cleanup
+    journal_destroy(journal);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_009: [ If handle is NULL, journal_destroy shall do nothing. ]*/
+TEST_FUNCTION(journal_destroy_NULL_handle_does_nothing)
+{
+    // act
+    journal_destroy(NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_010: [ journal_destroy shall commit the records appended since the last commit, close the newest segment and free the journal. The segment files are left in the directory. ]*/
+TEST_FUNCTION(journal_destroy_frees_the_journal)
+{
+    // arrange
+    JOURNAL_HANDLE journal = create_journal();
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(journal));
+
+    // act
+    journal_destroy(journal);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_IS_TRUE(segment_exists(0));
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_011: [ If handle, record or sequence is NULL, or size is 0, journal_append shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(journal_append_NULL_handle_fails)
+{
+    // arrange
+    unsigned char record[TEST_RECORD_SIZE] = { 0 };
+    uint64_t sequence;
+
+    // act
+    int result = journal_append(NULL, record, sizeof(record), &sequence);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_011: [ If handle, record or sequence is NULL, or size is 0, journal_append shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(journal_append_NULL_record_fails)
+{
+    // arrange
+    uint64_t sequence;
+    JOURNAL_HANDLE journal = create_journal();
+
+    // act
+    int result = journal_append(journal, NULL, TEST_RECORD_SIZE, &sequence);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+
+    // cleanup
+    journal_destroy(journal);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_011: [ If handle, record or sequence is NULL, or size is 0, journal_append shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(journal_append_zero_size_fails)
+{
+    // arrange
+    unsigned char record[TEST_RECORD_SIZE] = { 0 };
+    uint64_t sequence;
+    JOURNAL_HANDLE journal = create_journal();
+
+    // act
+    int result = journal_append(journal, record, 0, &sequence);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+
+    // cleanup
+    journal_destroy(journal);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_011: [ If handle, record or sequence is NULL, or size is 0, journal_append shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(journal_append_NULL_sequence_fails)
+{
+    // arrange
+    unsigned char record[TEST_RECORD_SIZE] = { 0 };
+    JOURNAL_HANDLE journal = create_journal();
+
+    // act
+    int result = journal_append(journal, record, sizeof(record), NULL);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+
+    // cleanup
+    journal_destroy(journal);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_012: [ If size does not fit in a segment, journal_append shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(journal_append_record_bigger_than_a_segment_fails)
+{
+    // arrange
+    unsigned char record[TEST_SEGMENT_SIZE] = { 0 };
+    uint64_t sequence;
+    JOURNAL_HANDLE journal = create_journal();
+
+    // act
+    int result = journal_append(journal, record, sizeof(record), &sequence);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    journal_destroy(journal);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_014: [ journal_append shall write the size, the checksum and the bytes of the record to the stdio buffer of the newest segment, set sequence to the sequence of the record and return 0. ]*/
+TEST_FUNCTION(journal_append_numbers_the_records)
+{
+    // arrange
+    JOURNAL_HANDLE journal = create_journal();
+
+    // act
+    uint64_t first = append_record(journal, 1);
+    uint64_t second = append_record(journal, 2);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 1, (size_t)first);
+    ASSERT_ARE_EQUAL(size_t, 2, (size_t)second);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_IS_FALSE(segment_exists(1));
+
+    // cleanup
+    journal_destroy(journal);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_013: [ If the record does not fit in the rest of the newest segment, or writing the newest segment failed before, journal_append shall commit and close the newest segment and start a new one. ]*/
+TEST_FUNCTION(journal_append_starts_a_new_segment_when_the_newest_is_full)
+{
+    // arrange
+    JOURNAL_HANDLE journal = create_journal();
+    (void)append_record(journal, 1);
+    (void)append_record(journal, 2);
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+
+    // act
+    uint64_t sequence = append_record(journal, 3);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 3, (size_t)sequence);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_IS_TRUE(segment_exists(0));
+    ASSERT_IS_TRUE(segment_exists(1));
+
+    // cleanup
+    journal_destroy(journal);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_015: [ If writing the record fails, journal_append shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(journal_append_fails_when_the_new_segment_cannot_be_started)
+{
+    // arrange
+    unsigned char record[TEST_RECORD_SIZE] = { 0 };
+    uint64_t sequence;
+    JOURNAL_HANDLE journal = create_journal();
+    (void)append_record(journal, 1);
+    (void)append_record(journal, 2);
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+
+    // act
+    int result = journal_append(journal, record, sizeof(record), &sequence);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 3, (size_t)append_record(journal, 3));
+
+    // cleanup
+    journal_destroy(journal);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_016: [ If handle is NULL, journal_commit shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(journal_commit_NULL_handle_fails)
+{
+    // act
+    int result = journal_commit(NULL);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_017: [ If records were appended since the last commit, journal_commit shall flush the stdio buffer of the newest segment and synchronize the file with the storage, so that all those records are made durable by one write. ]*/
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_019: [ Otherwise journal_commit shall return 0. ]*/
+TEST_FUNCTION(journal_commit_makes_the_records_readable)
+{
+    // arrange
+    FILE* file;
+    long size;
+    JOURNAL_HANDLE journal = create_journal();
+    (void)append_record(journal, 1);
+
+    // act
+    int result = journal_commit(journal);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    file = fopen(TEST_DIRECTORY "/journal_0.seg", "rb");
+    ASSERT_IS_NOT_NULL(file);
+    (void)fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    (void)fclose(file);
+    ASSERT_ARE_EQUAL(long, 12 + 8 + TEST_RECORD_SIZE, size);
+
+    // cleanup
+    journal_destroy(journal);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_019: [ Otherwise journal_commit shall return 0. ]*/
+TEST_FUNCTION(journal_commit_without_new_records_succeeds)
+{
+    // arrange
+    JOURNAL_HANDLE journal = create_journal();
+
+    // act
+    int result = journal_commit(journal);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    journal_destroy(journal);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_020: [ If handle is NULL, journal_confirm shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(journal_confirm_NULL_handle_fails)
+{
+    // act
+    int result = journal_confirm(NULL, 1);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_021: [ If sequence is not the sequence of a record of the journal, journal_confirm shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(journal_confirm_unknown_sequence_fails)
+{
+    // arrange
+    JOURNAL_HANDLE journal = create_journal();
+    (void)append_record(journal, 1);
+
+    // act
+    int result = journal_confirm(journal, 2);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_NOT_EQUAL(int, 0, journal_confirm(journal, 0));
+
+    // cleanup
+    journal_destroy(journal);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_022: [ journal_confirm shall count the record as confirmed in its segment and return 0. ]*/
+TEST_FUNCTION(journal_confirm_keeps_the_newest_segment)
+{
+    // arrange
+    JOURNAL_HANDLE journal = create_journal();
+    uint64_t first = append_record(journal, 1);
+    uint64_t second = append_record(journal, 2);
+
+    // act
+    int result = journal_confirm(journal, second);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(int, 0, journal_confirm(journal, first));
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_IS_TRUE(segment_exists(0));
+
+    // cleanup
+    journal_destroy(journal);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_023: [ While all the records of the oldest segment are confirmed and it is not the newest segment, journal_confirm shall write the number of the next segment to the head file and delete the oldest segment. ]*/
+TEST_FUNCTION(journal_confirm_deletes_the_confirmed_segments)
+{
+    // arrange
+    JOURNAL_HANDLE journal = create_journal();
+    uint64_t first = append_record(journal, 1);
+    uint64_t second = append_record(journal, 2);
+    uint64_t third = append_record(journal, 3);
+    (void)append_record(journal, 4);
+    (void)append_record(journal, 5);
+    ASSERT_ARE_EQUAL(int, 0, journal_confirm(journal, third));
+    ASSERT_ARE_EQUAL(int, 0, journal_confirm(journal, first));
+    umock_c_reset_all_calls();
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    // act
+    int result = journal_confirm(journal, second);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_IS_FALSE(segment_exists(0));
+    ASSERT_IS_TRUE(segment_exists(1));
+    ASSERT_IS_TRUE(segment_exists(2));
+
+    // cleanup
+    journal_destroy(journal);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_003: [ journal_create shall read the number of the oldest segment from the head file of directory, or start from segment 0 if there is no head file. ]*/
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_004: [ journal_create shall read the segments from the oldest one to the first one missing and call replay_callback, if not NULL, with every record they hold, its size and its sequence, in the order they were appended. ]*/
+TEST_FUNCTION(journal_create_does_not_replay_the_deleted_segments)
+{
+    // arrange
+    JOURNAL_HANDLE journal = create_journal();
+    uint64_t first = append_record(journal, 1);
+    uint64_t second = append_record(journal, 2);
+    (void)append_record(journal, 3);
+    ASSERT_ARE_EQUAL(int, 0, journal_confirm(journal, first));
+    ASSERT_ARE_EQUAL(int, 0, journal_confirm(journal, second));
+    journal_destroy(journal);
+
+    // act
+    journal = journal_create(TEST_DIRECTORY, TEST_SEGMENT_SIZE, on_replay, &g_replayedCount);
+
+    // assert
+    ASSERT_IS_NOT_NULL(journal);
+    ASSERT_ARE_EQUAL(size_t, 1, g_replayedCount);
+    ASSERT_ARE_EQUAL(size_t, 3, (size_t)g_replayedSequences[0]);
+    ASSERT_ARE_EQUAL(int, 3, g_replayedFirstBytes[0]);
+    ASSERT_ARE_EQUAL(size_t, 4, (size_t)append_record(journal, 4));
+
+    // cleanup
+    journal_destroy(journal);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_024: [ If the head file is missing or cannot be read, journal_create shall start from the segment file of directory with the lowest number, or from segment 0 if there is none. ]*/
+TEST_FUNCTION(journal_create_with_an_empty_head_file_replays_from_the_oldest_segment)
+{
+    // arrange
+    JOURNAL_HANDLE journal = create_journal();
+    uint64_t first = append_record(journal, 1);
+    uint64_t second = append_record(journal, 2);
+    (void)append_record(journal, 3);
+    ASSERT_ARE_EQUAL(int, 0, journal_confirm(journal, first));
+    ASSERT_ARE_EQUAL(int, 0, journal_confirm(journal, second));
+    journal_destroy(journal);
+    ASSERT_IS_FALSE(segment_exists(0));
+    write_head_file("");
+
+    // act
+    journal = journal_create(TEST_DIRECTORY, TEST_SEGMENT_SIZE, on_replay, &g_replayedCount);
+
+    // assert
+    ASSERT_IS_NOT_NULL(journal);
+    ASSERT_ARE_EQUAL(size_t, 1, g_replayedCount);
+    ASSERT_ARE_EQUAL(size_t, 3, (size_t)g_replayedSequences[0]);
+    ASSERT_ARE_EQUAL(int, 3, g_replayedFirstBytes[0]);
+    ASSERT_ARE_EQUAL(size_t, 4, (size_t)append_record(journal, 4));
+
+    // cleanup
+    journal_destroy(journal);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_024: [ If the head file is missing or cannot be read, journal_create shall start from the segment file of directory with the lowest number, or from segment 0 if there is none. ]*/
+TEST_FUNCTION(journal_create_with_an_empty_head_file_and_no_segment_starts_from_segment_0)
+{
+    // arrange
+    write_head_file("");
+
+    // act
+    JOURNAL_HANDLE journal = journal_create(TEST_DIRECTORY, TEST_SEGMENT_SIZE, on_replay, &g_replayedCount);
+
+    // assert
+    ASSERT_IS_NOT_NULL(journal);
+    ASSERT_ARE_EQUAL(size_t, 0, g_replayedCount);
+    ASSERT_IS_TRUE(segment_exists(0));
+    ASSERT_ARE_EQUAL(size_t, 1, (size_t)append_record(journal, 1));
+
+    // cleanup
+    journal_destroy(journal);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_JOURNAL_31_025: [ The head file shall be replaced by writing and synchronizing a temporary file and renaming it over the head file, so that a crash leaves either the previous or the new head. ]*/
+TEST_FUNCTION(journal_confirm_renames_the_new_head_over_the_head_file)
+{
+    // arrange
+    JOURNAL_HANDLE journal = create_journal();
+    uint64_t first = append_record(journal, 1);
+    uint64_t second = append_record(journal, 2);
+    (void)append_record(journal, 3);
+    ASSERT_ARE_EQUAL(int, 0, journal_confirm(journal, first));
+
+    // act
+    int result = journal_confirm(journal, second);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_IS_TRUE(file_exists(TEST_DIRECTORY "/journal.head"));
+    ASSERT_IS_FALSE(file_exists(TEST_DIRECTORY "/journal.head.tmp"));
+    {
+        unsigned long head = 0;
+        FILE* file = fopen(TEST_DIRECTORY "/journal.head", "r");
+        ASSERT_IS_NOT_NULL(file);
+        ASSERT_ARE_EQUAL(int, 1, fscanf(file, "%lu", &head));
+        (void)fclose(file);
+        ASSERT_ARE_EQUAL(size_t, 1, (size_t)head);
+    }
+
+    // cleanup
+    journal_destroy(journal);
+}
+
+END_TEST_SUITE(iothub_client_journal_ut)
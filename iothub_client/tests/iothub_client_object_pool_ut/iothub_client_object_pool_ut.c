@@ -0,0 +1,409 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifdef __cplusplus
+#include <cstdlib>
+#include <cstddef>
+#include <cstring>
+#else
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#endif
+
+static void* my_gballoc_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+static void my_gballoc_free(void* ptr)
+{
+    free(ptr);
+}
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+#include "umocktypes_charptr.h"
+#include "umocktypes_stdint.h"
+
+#define ENABLE_MOCKS
+#include "azure_c_shared_utility/gballoc.h"
+#undef ENABLE_MOCKS
+
+#include "iothub_client_object_pool.h"
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+DEFINE_ENUM_STRINGS(UMOCK_C_ERROR_CODE, UMOCK_C_ERROR_CODE_VALUES)
+
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    char temp_str[256];
+    (void)snprintf(temp_str, sizeof(temp_str), "umock_c reported error :%s", ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+    ASSERT_FAIL(temp_str);
+}
+
+#define TEST_OBJECT_SIZE    40
+#define TEST_OBJECT_COUNT   4
+
+static OBJECT_POOL_HANDLE create_pool(void)
+{
+    OBJECT_POOL_HANDLE result = object_pool_create(TEST_OBJECT_SIZE, TEST_OBJECT_COUNT);
+    ASSERT_IS_NOT_NULL(result);
+    umock_c_reset_all_calls();
+    return result;
+}
+
+static void assert_statistics(OBJECT_POOL_HANDLE pool, size_t in_use, size_t hits, size_t misses)
+{
+    OBJECT_POOL_STATISTICS statistics;
+    ASSERT_ARE_EQUAL(int, 0, object_pool_get_statistics(pool, &statistics));
+    ASSERT_ARE_EQUAL(size_t, TEST_OBJECT_COUNT, statistics.capacity);
+    ASSERT_ARE_EQUAL(size_t, in_use, statistics.in_use);
+    ASSERT_ARE_EQUAL(size_t, hits, statistics.hits);
+    ASSERT_ARE_EQUAL(size_t, misses, statistics.misses);
+}
+
+BEGIN_TEST_SUITE(iothub_client_object_pool_ut)
+
+TEST_SUITE_INITIALIZE(TestClassInitialize)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+
+    umock_c_init(on_umock_c_error);
+
+    int result = umocktypes_charptr_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+    result = umocktypes_stdint_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_malloc, NULL);
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
+}
+
+TEST_SUITE_CLEANUP(TestClassCleanup)
+{
+    umock_c_deinit();
+
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest))
+    {
+        ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+    }
+
+    umock_c_reset_all_calls();
+}
+
+TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+{
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_OBJECT_POOL_31_001: [ If object_size or object_count is 0, object_pool_create shall fail and return NULL. ]*/
+TEST_FUNCTION(object_pool_create_zero_object_size_fails)
+{
+    // act
+    OBJECT_POOL_HANDLE pool = object_pool_create(0, TEST_OBJECT_COUNT);
+
+    // assert
+    ASSERT_IS_NULL(pool);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_OBJECT_POOL_31_001: [ If object_size or object_count is 0, object_pool_create shall fail and return NULL. ]*/
+TEST_FUNCTION(object_pool_create_zero_object_count_fails)
+{
+    // act
+    OBJECT_POOL_HANDLE pool = object_pool_create(TEST_OBJECT_SIZE, 0);
+
+    // assert
+    ASSERT_IS_NULL(pool);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_OBJECT_POOL_31_003: [ object_pool_create shall allocate the storage for object_count objects of object_size bytes in a single allocation and return the handle of the pool. ]*/
+TEST_FUNCTION(object_pool_create_succeeds)
+{
+    // arrange
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+
+    // act
+    OBJECT_POOL_HANDLE pool = object_pool_create(TEST_OBJECT_SIZE, TEST_OBJECT_COUNT);
+
+    // assert
+    ASSERT_IS_NOT_NULL(pool);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    assert_statistics(pool, 0, 0, 0);
+
+    // cleanup
+    object_pool_destroy(pool);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_OBJECT_POOL_31_002: [ If allocating memory fails, object_pool_create shall fail and return NULL. ]*/
+TEST_FUNCTION(object_pool_create_first_malloc_fails)
+{
+    // arrange
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+
+    // act
+    OBJECT_POOL_HANDLE pool = object_pool_create(TEST_OBJECT_SIZE, TEST_OBJECT_COUNT);
+
+    // assert
+    ASSERT_IS_NULL(pool);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_OBJECT_POOL_31_002: [ If allocating memory fails, object_pool_create shall fail and return NULL. ]*/
+TEST_FUNCTION(object_pool_create_storage_malloc_fails)
+{
+    // arrange
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    // act
+    OBJECT_POOL_HANDLE pool = object_pool_create(TEST_OBJECT_SIZE, TEST_OBJECT_COUNT);
+
+    // assert
+    ASSERT_IS_NULL(pool);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_OBJECT_POOL_31_004: [ If handle is NULL, object_pool_destroy shall do nothing. ]*/
+TEST_FUNCTION(object_pool_destroy_NULL_handle_does_nothing)
+{
+    // act
+    object_pool_destroy(NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_OBJECT_POOL_31_005: [ object_pool_destroy shall free the storage of the pool and the pool. ]*/
+TEST_FUNCTION(object_pool_destroy_frees_the_pool)
+{
+    // arrange
+    OBJECT_POOL_HANDLE pool = create_pool();
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(pool));
+
+    // act
+    object_pool_destroy(pool);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_OBJECT_POOL_31_006: [ If handle is NULL or object_size is bigger than the objects of the pool, object_pool_alloc shall return the result of malloc(object_size). ]*/
+/* Tests_SRS_IOTHUB_CLIENT_OBJECT_POOL_31_010: [ Otherwise object_pool_free shall free object. ]*/
+TEST_FUNCTION(object_pool_alloc_NULL_handle_uses_malloc)
+{
+    // arrange
+    STRICT_EXPECTED_CALL(gballoc_malloc(TEST_OBJECT_SIZE));
+
+    // act
+    void* object = object_pool_alloc(NULL, TEST_OBJECT_SIZE);
+
+    // assert
+    ASSERT_IS_NOT_NULL(object);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    STRICT_EXPECTED_CALL(gballoc_free(object));
+    object_pool_free(NULL, object);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_OBJECT_POOL_31_006: [ If handle is NULL or object_size is bigger than the objects of the pool, object_pool_alloc shall return the result of malloc(object_size). ]*/
+TEST_FUNCTION(object_pool_alloc_bigger_object_uses_malloc)
+{
+    // arrange
+    OBJECT_POOL_HANDLE pool = create_pool();
+    STRICT_EXPECTED_CALL(gballoc_malloc(TEST_OBJECT_SIZE + 1));
+
+    // act
+    void* object = object_pool_alloc(pool, TEST_OBJECT_SIZE + 1);
+
+    // assert
+    ASSERT_IS_NOT_NULL(object);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    assert_statistics(pool, 0, 0, 0);
+
+    // cleanup
+    object_pool_free(pool, object);
+    object_pool_destroy(pool);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_OBJECT_POOL_31_007: [ object_pool_alloc shall return a free object of the pool and count a hit. ]*/
+TEST_FUNCTION(object_pool_alloc_takes_the_objects_from_the_pool)
+{
+    // arrange
+    void* objects[TEST_OBJECT_COUNT];
+    size_t i;
+    OBJECT_POOL_HANDLE pool = create_pool();
+
+    // act
+    for (i = 0; i < TEST_OBJECT_COUNT; i++)
+    {
+        objects[i] = object_pool_alloc(pool, TEST_OBJECT_SIZE);
+        ASSERT_IS_NOT_NULL(objects[i]);
+        (void)memset(objects[i], 0xAB, TEST_OBJECT_SIZE);
+    }
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    assert_statistics(pool, TEST_OBJECT_COUNT, TEST_OBJECT_COUNT, 0);
+    for (i = 1; i < TEST_OBJECT_COUNT; i++)
+    {
+        ASSERT_ARE_NOT_EQUAL(void_ptr, objects[i - 1], objects[i]);
+    }
+
+    // cleanup
+    for (i = 0; i < TEST_OBJECT_COUNT; i++)
+    {
+        object_pool_free(pool, objects[i]);
+    }
+    object_pool_destroy(pool);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_OBJECT_POOL_31_008: [ If the pool has no free object, object_pool_alloc shall count a miss and return the result of malloc(object_size). ]*/
+TEST_FUNCTION(object_pool_alloc_exhausted_pool_uses_malloc)
+{
+    // arrange
+    void* objects[TEST_OBJECT_COUNT];
+    size_t i;
+    OBJECT_POOL_HANDLE pool = create_pool();
+    for (i = 0; i < TEST_OBJECT_COUNT; i++)
+    {
+        objects[i] = object_pool_alloc(pool, TEST_OBJECT_SIZE);
+    }
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(TEST_OBJECT_SIZE));
+
+    // act
+    void* object = object_pool_alloc(pool, TEST_OBJECT_SIZE);
+
+    // assert
+    ASSERT_IS_NOT_NULL(object);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    assert_statistics(pool, TEST_OBJECT_COUNT, TEST_OBJECT_COUNT, 1);
+
+    // cleanup
+    object_pool_free(pool, object);
+    for (i = 0; i < TEST_OBJECT_COUNT; i++)
+    {
+        object_pool_free(pool, objects[i]);
+    }
+    object_pool_destroy(pool);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_OBJECT_POOL_31_009: [ If object belongs to the pool, object_pool_free shall return it to the pool. ]*/
+TEST_FUNCTION(object_pool_free_returns_the_object_to_the_pool)
+{
+    // arrange
+    OBJECT_POOL_HANDLE pool = create_pool();
+    void* object = object_pool_alloc(pool, TEST_OBJECT_SIZE);
+    umock_c_reset_all_calls();
+
+    // act
+    object_pool_free(pool, object);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    assert_statistics(pool, 0, 1, 0);
+    ASSERT_ARE_EQUAL(void_ptr, object, object_pool_alloc(pool, TEST_OBJECT_SIZE));
+
+    // cleanup
+    object_pool_free(pool, object);
+    object_pool_destroy(pool);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_OBJECT_POOL_31_010: [ Otherwise object_pool_free shall free object. ]*/
+TEST_FUNCTION(object_pool_free_object_not_from_the_pool_frees_it)
+{
+    // arrange
+    OBJECT_POOL_HANDLE pool = create_pool();
+    void* object = my_gballoc_malloc(TEST_OBJECT_SIZE);
+    STRICT_EXPECTED_CALL(gballoc_free(object));
+
+    // act
+    object_pool_free(pool, object);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    assert_statistics(pool, 0, 0, 0);
+
+    // cleanup
+    object_pool_destroy(pool);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_OBJECT_POOL_31_011: [ If handle or statistics is NULL, object_pool_get_statistics shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(object_pool_get_statistics_NULL_handle_fails)
+{
+    // arrange
+    OBJECT_POOL_STATISTICS statistics;
+
+    // act
+    int result = object_pool_get_statistics(NULL, &statistics);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_OBJECT_POOL_31_011: [ If handle or statistics is NULL, object_pool_get_statistics shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(object_pool_get_statistics_NULL_statistics_fails)
+{
+    // arrange
+    OBJECT_POOL_HANDLE pool = create_pool();
+
+    // act
+    int result = object_pool_get_statistics(pool, NULL);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+
+    // cleanup
+    object_pool_destroy(pool);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_OBJECT_POOL_31_012: [ object_pool_get_statistics shall copy the capacity, the number of objects in use and the hit and miss counts of the pool to statistics and return 0. ]*/
+TEST_FUNCTION(object_pool_get_statistics_succeeds)
+{
+    // arrange
+    OBJECT_POOL_HANDLE pool = create_pool();
+    void* first = object_pool_alloc(pool, TEST_OBJECT_SIZE);
+    void* second = object_pool_alloc(pool, TEST_OBJECT_SIZE);
+    object_pool_free(pool, first);
+    umock_c_reset_all_calls();
+
+    // act
+    OBJECT_POOL_STATISTICS statistics;
+    int result = object_pool_get_statistics(pool, &statistics);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, TEST_OBJECT_COUNT, statistics.capacity);
+    ASSERT_ARE_EQUAL(size_t, 1, statistics.in_use);
+    ASSERT_ARE_EQUAL(size_t, 2, statistics.hits);
+    ASSERT_ARE_EQUAL(size_t, 0, statistics.misses);
+
+    // cleanup
+    object_pool_free(pool, second);
+    object_pool_destroy(pool);
+}
+
+END_TEST_SUITE(iothub_client_object_pool_ut)
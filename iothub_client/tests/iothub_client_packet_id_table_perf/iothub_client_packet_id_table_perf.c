@@ -0,0 +1,208 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "testrunnerswitcher.h"
+
+#include "iothub_client_packet_id_table.h"
+
+#define PERF_IN_FLIGHT_MESSAGES 10000
+#define PERF_ROUNDS             10
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+/*stands in for MQTT_MESSAGE_DETAILS_LIST: a publish waiting for its PUBACK, both on a list (the way the transport
+scanned for it) and in a packet id table*/
+typedef struct PERF_MESSAGE_TAG
+{
+    struct PERF_MESSAGE_TAG* previous;
+    struct PERF_MESSAGE_TAG* next;
+    uint16_t packet_id;
+    PACKET_ID_TABLE_ENTRY packetIdEntry;
+} PERF_MESSAGE;
+
+static PERF_MESSAGE messages[PERF_IN_FLIGHT_MESSAGES];
+static uint16_t ack_order[PERF_IN_FLIGHT_MESSAGES];
+static PERF_MESSAGE list_head;
+static unsigned int random_state;
+
+static unsigned int next_random(void)
+{
+    random_state = random_state * 1103515245u + 12345u;
+    return (random_state >> 16) & 0x7FFF;
+}
+
+/*packet ids are handed out in sequence, starting past the wrap around of the 16 bit id like a long running connection;
+PUBACKs come back in a shuffled order*/
+static void create_ack_order(uint16_t first_packet_id)
+{
+    size_t i;
+    random_state = 1;
+    for (i = 0; i < PERF_IN_FLIGHT_MESSAGES; i++)
+    {
+        ack_order[i] = (uint16_t)(first_packet_id + i);
+    }
+    for (i = PERF_IN_FLIGHT_MESSAGES - 1; i > 0; i--)
+    {
+        size_t j = ((size_t)next_random() << 15 | next_random()) % (i + 1);
+        uint16_t temp = ack_order[i];
+        ack_order[i] = ack_order[j];
+        ack_order[j] = temp;
+    }
+}
+
+static void list_insert_tail(PERF_MESSAGE* message)
+{
+    message->next = &list_head;
+    message->previous = list_head.previous;
+    list_head.previous->next = message;
+    list_head.previous = message;
+}
+
+static PERF_MESSAGE* list_find_and_remove(uint16_t packet_id)
+{
+    PERF_MESSAGE* result = NULL;
+    PERF_MESSAGE* current = list_head.next;
+    while (current != &list_head)
+    {
+        if (current->packet_id == packet_id)
+        {
+            current->previous->next = current->next;
+            current->next->previous = current->previous;
+            result = current;
+            break;
+        }
+        current = current->next;
+    }
+    return result;
+}
+
+static void print_result(const char* mode, double elapsed_ms)
+{
+    (void)printf("%-12s in flight=%5u time/ack=%8.3f us\r\n",
+        mode, (unsigned int)PERF_IN_FLIGHT_MESSAGES,
+        elapsed_ms * 1000.0 / ((double)PERF_IN_FLIGHT_MESSAGES * PERF_ROUNDS));
+}
+
+static double ack_with_list_scan(uint16_t first_packet_id)
+{
+    size_t round;
+    size_t i;
+    double elapsed_ms = 0.0;
+
+    for (round = 0; round < PERF_ROUNDS; round++)
+    {
+        clock_t start;
+        list_head.next = &list_head;
+        list_head.previous = &list_head;
+        for (i = 0; i < PERF_IN_FLIGHT_MESSAGES; i++)
+        {
+            messages[i].packet_id = (uint16_t)(first_packet_id + i);
+            list_insert_tail(&messages[i]);
+        }
+
+        start = clock();
+        for (i = 0; i < PERF_IN_FLIGHT_MESSAGES; i++)
+        {
+            PERF_MESSAGE* message = list_find_and_remove(ack_order[i]);
+            ASSERT_IS_NOT_NULL(message);
+        }
+        elapsed_ms += (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+        ASSERT_ARE_EQUAL(void_ptr, &list_head, list_head.next);
+    }
+    print_result("list scan", elapsed_ms);
+    return elapsed_ms;
+}
+
+static double ack_with_packet_id_table(uint16_t first_packet_id)
+{
+    size_t round;
+    size_t i;
+    double elapsed_ms = 0.0;
+
+    for (round = 0; round < PERF_ROUNDS; round++)
+    {
+        clock_t start;
+        PACKET_ID_TABLE_HANDLE table = packet_id_table_create();
+        ASSERT_IS_NOT_NULL(table);
+        for (i = 0; i < PERF_IN_FLIGHT_MESSAGES; i++)
+        {
+            ASSERT_ARE_EQUAL(int, 0, packet_id_table_add(table, &messages[i].packetIdEntry, (uint16_t)(first_packet_id + i)));
+        }
+
+        start = clock();
+        for (i = 0; i < PERF_IN_FLIGHT_MESSAGES; i++)
+        {
+            PACKET_ID_TABLE_ENTRY* entry = packet_id_table_remove(table, ack_order[i]);
+            ASSERT_IS_NOT_NULL(entry);
+        }
+        elapsed_ms += (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+        ASSERT_ARE_EQUAL(size_t, (size_t)0, packet_id_table_get_count(table));
+
+        packet_id_table_destroy(table);
+    }
+    print_result("table", elapsed_ms);
+    return elapsed_ms;
+}
+
+BEGIN_TEST_SUITE(iothub_client_packet_id_table_perf)
+
+TEST_SUITE_INITIALIZE(TestClassInitialize)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+}
+
+TEST_SUITE_CLEANUP(TestClassCleanup)
+{
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest))
+    {
+        ASSERT_FAIL("Could not acquire test serialization mutex.");
+    }
+}
+
+TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+{
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+TEST_FUNCTION(packet_id_table_acks_10k_in_flight_messages)
+{
+    ///arrange
+    create_ack_order(1);
+
+    ///act
+    double list_ms = ack_with_list_scan(1);
+    double table_ms = ack_with_packet_id_table(1);
+
+    ///assert
+    /*the list scan walks half the in flight messages on average for each ack*/
+    ASSERT_IS_TRUE(table_ms * 10 < list_ms);
+}
+
+TEST_FUNCTION(packet_id_table_acks_10k_in_flight_messages_across_packet_id_wrap_around)
+{
+    ///arrange
+    /*get_next_packet_id skips 0, but the table does not care about the ids it is given*/
+    create_ack_order((uint16_t)(UINT16_MAX - PERF_IN_FLIGHT_MESSAGES / 2));
+
+    ///act
+    double table_ms = ack_with_packet_id_table((uint16_t)(UINT16_MAX - PERF_IN_FLIGHT_MESSAGES / 2));
+
+    ///assert
+    ASSERT_IS_TRUE(table_ms >= 0.0);
+}
+
+END_TEST_SUITE(iothub_client_packet_id_table_perf)
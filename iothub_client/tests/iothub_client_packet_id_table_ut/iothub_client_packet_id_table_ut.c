@@ -0,0 +1,448 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifdef __cplusplus
+#include <cstdlib>
+#include <cstddef>
+#else
+#include <stdlib.h>
+#include <stddef.h>
+#endif
+
+static void* my_gballoc_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+static void my_gballoc_free(void* ptr)
+{
+    free(ptr);
+}
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+#include "umocktypes_charptr.h"
+#include "umocktypes_stdint.h"
+
+#define ENABLE_MOCKS
+#include "azure_c_shared_utility/gballoc.h"
+#undef ENABLE_MOCKS
+
+#include "iothub_client_packet_id_table.h"
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+DEFINE_ENUM_STRINGS(UMOCK_C_ERROR_CODE, UMOCK_C_ERROR_CODE_VALUES)
+
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    char temp_str[256];
+    (void)snprintf(temp_str, sizeof(temp_str), "umock_c reported error :%s", ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+    ASSERT_FAIL(temp_str);
+}
+
+#define TEST_ENTRY_COUNT (PACKET_ID_TABLE_INITIAL_BUCKETS + 4)
+
+static PACKET_ID_TABLE_ENTRY test_entries[TEST_ENTRY_COUNT];
+
+static PACKET_ID_TABLE_HANDLE create_table(void)
+{
+    PACKET_ID_TABLE_HANDLE result = packet_id_table_create();
+    ASSERT_IS_NOT_NULL(result);
+    umock_c_reset_all_calls();
+    return result;
+}
+
+/*adds count entries with packet ids first, first + 1, ... the way the MQTT transport hands them out*/
+static void add_entries(PACKET_ID_TABLE_HANDLE table, uint16_t first, size_t count)
+{
+    size_t i;
+    for (i = 0; i < count; i++)
+    {
+        ASSERT_ARE_EQUAL(int, 0, packet_id_table_add(table, &test_entries[i], (uint16_t)(first + i)));
+    }
+    umock_c_reset_all_calls();
+}
+
+BEGIN_TEST_SUITE(iothub_client_packet_id_table_ut)
+
+TEST_SUITE_INITIALIZE(TestClassInitialize)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+
+    umock_c_init(on_umock_c_error);
+
+    int result = umocktypes_charptr_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+    result = umocktypes_stdint_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_malloc, NULL);
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
+}
+
+TEST_SUITE_CLEANUP(TestClassCleanup)
+{
+    umock_c_deinit();
+
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest))
+    {
+        ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+    }
+
+    umock_c_reset_all_calls();
+}
+
+TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+{
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_PACKET_ID_TABLE_31_001: [ packet_id_table_create shall allocate an empty table of PACKET_ID_TABLE_INITIAL_BUCKETS buckets and return its handle. ]*/
+TEST_FUNCTION(packet_id_table_create_succeeds)
+{
+    // arrange
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(PACKET_ID_TABLE_INITIAL_BUCKETS * sizeof(PACKET_ID_TABLE_ENTRY*)));
+
+    // act
+    PACKET_ID_TABLE_HANDLE table = packet_id_table_create();
+
+    // assert
+    ASSERT_IS_NOT_NULL(table);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 0, packet_id_table_get_count(table));
+    ASSERT_IS_NULL(packet_id_table_remove(table, 1));
+
+    // cleanup
+    packet_id_table_destroy(table);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_PACKET_ID_TABLE_31_002: [ If allocating memory fails, packet_id_table_create shall return NULL. ]*/
+TEST_FUNCTION(packet_id_table_create_malloc_fails)
+{
+    // arrange
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+
+    // act
+    PACKET_ID_TABLE_HANDLE table = packet_id_table_create();
+
+    // assert
+    ASSERT_IS_NULL(table);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_PACKET_ID_TABLE_31_002: [ If allocating memory fails, packet_id_table_create shall return NULL. ]*/
+TEST_FUNCTION(packet_id_table_create_buckets_malloc_fails)
+{
+    // arrange
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    // act
+    PACKET_ID_TABLE_HANDLE table = packet_id_table_create();
+
+    // assert
+    ASSERT_IS_NULL(table);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_PACKET_ID_TABLE_31_003: [ If handle is NULL, packet_id_table_destroy shall do nothing, otherwise it shall free the table without touching the entries still in it. ]*/
+TEST_FUNCTION(packet_id_table_destroy_NULL_does_nothing)
+{
+    // act
+    packet_id_table_destroy(NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_PACKET_ID_TABLE_31_003: [ If handle is NULL, packet_id_table_destroy shall do nothing, otherwise it shall free the table without touching the entries still in it. ]*/
+TEST_FUNCTION(packet_id_table_destroy_frees_the_table)
+{
+    // arrange
+    PACKET_ID_TABLE_HANDLE table = create_table();
+    add_entries(table, 1, 2);
+
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(table));
+
+    // act
+    packet_id_table_destroy(table);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(uint16_t, 1, test_entries[0].packet_id);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_PACKET_ID_TABLE_31_004: [ If handle or entry is NULL, packet_id_table_add shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(packet_id_table_add_NULL_handle_fails)
+{
+    // act
+    int result = packet_id_table_add(NULL, &test_entries[0], 1);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_PACKET_ID_TABLE_31_004: [ If handle or entry is NULL, packet_id_table_add shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(packet_id_table_add_NULL_entry_fails)
+{
+    // arrange
+    PACKET_ID_TABLE_HANDLE table = create_table();
+
+    // act
+    int result = packet_id_table_add(table, NULL, 1);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(size_t, 0, packet_id_table_get_count(table));
+
+    // cleanup
+    packet_id_table_destroy(table);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_PACKET_ID_TABLE_31_006: [ packet_id_table_add shall set the packet id of entry to packet_id, add it to the table and return 0. ]*/
+/* Tests_SRS_IOTHUB_CLIENT_PACKET_ID_TABLE_31_009: [ packet_id_table_get_count shall return the number of entries in the table, or 0 if handle is NULL. ]*/
+TEST_FUNCTION(packet_id_table_add_succeeds)
+{
+    // arrange
+    PACKET_ID_TABLE_HANDLE table = create_table();
+
+    // act
+    int result = packet_id_table_add(table, &test_entries[0], 42);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(uint16_t, 42, test_entries[0].packet_id);
+    ASSERT_ARE_EQUAL(size_t, 1, packet_id_table_get_count(table));
+
+    // cleanup
+    packet_id_table_destroy(table);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_PACKET_ID_TABLE_31_005: [ When the table holds as many entries as buckets, packet_id_table_add shall double the buckets, up to PACKET_ID_TABLE_MAX_BUCKETS, and keep the current ones if that fails. ]*/
+TEST_FUNCTION(packet_id_table_add_grows_the_buckets_when_full)
+{
+    // arrange
+    PACKET_ID_TABLE_HANDLE table = create_table();
+    size_t i;
+    add_entries(table, 1, PACKET_ID_TABLE_INITIAL_BUCKETS);
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(2 * PACKET_ID_TABLE_INITIAL_BUCKETS * sizeof(PACKET_ID_TABLE_ENTRY*)));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    // act
+    int result = packet_id_table_add(table, &test_entries[PACKET_ID_TABLE_INITIAL_BUCKETS], PACKET_ID_TABLE_INITIAL_BUCKETS + 1);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, PACKET_ID_TABLE_INITIAL_BUCKETS + 1, packet_id_table_get_count(table));
+    for (i = 0; i <= PACKET_ID_TABLE_INITIAL_BUCKETS; i++)
+    {
+        ASSERT_ARE_EQUAL(void_ptr, &test_entries[i], packet_id_table_remove(table, (uint16_t)(i + 1)));
+    }
+
+    // cleanup
+    packet_id_table_destroy(table);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_PACKET_ID_TABLE_31_005: [ When the table holds as many entries as buckets, packet_id_table_add shall double the buckets, up to PACKET_ID_TABLE_MAX_BUCKETS, and keep the current ones if that fails. ]*/
+TEST_FUNCTION(packet_id_table_add_keeps_the_buckets_when_growing_fails)
+{
+    // arrange
+    PACKET_ID_TABLE_HANDLE table = create_table();
+    size_t i;
+    add_entries(table, 1, PACKET_ID_TABLE_INITIAL_BUCKETS);
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+
+    // act
+    int result = packet_id_table_add(table, &test_entries[PACKET_ID_TABLE_INITIAL_BUCKETS], PACKET_ID_TABLE_INITIAL_BUCKETS + 1);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, PACKET_ID_TABLE_INITIAL_BUCKETS + 1, packet_id_table_get_count(table));
+    for (i = 0; i <= PACKET_ID_TABLE_INITIAL_BUCKETS; i++)
+    {
+        ASSERT_ARE_EQUAL(void_ptr, &test_entries[i], packet_id_table_remove(table, (uint16_t)(i + 1)));
+    }
+
+    // cleanup
+    packet_id_table_destroy(table);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_PACKET_ID_TABLE_31_007: [ If handle is NULL, packet_id_table_remove shall return NULL. ]*/
+TEST_FUNCTION(packet_id_table_remove_NULL_handle_returns_NULL)
+{
+    // act
+    PACKET_ID_TABLE_ENTRY* result = packet_id_table_remove(NULL, 1);
+
+    // assert
+    ASSERT_IS_NULL(result);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_PACKET_ID_TABLE_31_008: [ packet_id_table_remove shall remove from the table the last added entry whose packet id is packet_id and return it, or return NULL if there is none. ]*/
+TEST_FUNCTION(packet_id_table_remove_returns_the_entry_of_the_packet_id)
+{
+    // arrange
+    PACKET_ID_TABLE_HANDLE table = create_table();
+    add_entries(table, 100, 3);
+
+    // act
+    PACKET_ID_TABLE_ENTRY* result = packet_id_table_remove(table, 101);
+
+    // assert
+    ASSERT_ARE_EQUAL(void_ptr, &test_entries[1], result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 2, packet_id_table_get_count(table));
+    ASSERT_IS_NULL(packet_id_table_remove(table, 101));
+
+    // cleanup
+    packet_id_table_destroy(table);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_PACKET_ID_TABLE_31_008: [ packet_id_table_remove shall remove from the table the last added entry whose packet id is packet_id and return it, or return NULL if there is none. ]*/
+TEST_FUNCTION(packet_id_table_remove_finds_entries_sharing_a_bucket)
+{
+    // arrange
+    PACKET_ID_TABLE_HANDLE table = create_table();
+    ASSERT_ARE_EQUAL(int, 0, packet_id_table_add(table, &test_entries[0], 5));
+    ASSERT_ARE_EQUAL(int, 0, packet_id_table_add(table, &test_entries[1], 5 + PACKET_ID_TABLE_INITIAL_BUCKETS));
+    ASSERT_ARE_EQUAL(int, 0, packet_id_table_add(table, &test_entries[2], 5 + 2 * PACKET_ID_TABLE_INITIAL_BUCKETS));
+    umock_c_reset_all_calls();
+
+    // act
+    PACKET_ID_TABLE_ENTRY* result = packet_id_table_remove(table, 5 + PACKET_ID_TABLE_INITIAL_BUCKETS);
+
+    // assert
+    ASSERT_ARE_EQUAL(void_ptr, &test_entries[1], result);
+    ASSERT_ARE_EQUAL(void_ptr, &test_entries[0], packet_id_table_remove(table, 5));
+    ASSERT_ARE_EQUAL(void_ptr, &test_entries[2], packet_id_table_remove(table, 5 + 2 * PACKET_ID_TABLE_INITIAL_BUCKETS));
+    ASSERT_ARE_EQUAL(size_t, 0, packet_id_table_get_count(table));
+
+    // cleanup
+    packet_id_table_destroy(table);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_PACKET_ID_TABLE_31_008: [ packet_id_table_remove shall remove from the table the last added entry whose packet id is packet_id and return it, or return NULL if there is none. ]*/
+TEST_FUNCTION(packet_id_table_remove_returns_the_last_added_entry_of_a_reused_packet_id)
+{
+    // arrange
+    PACKET_ID_TABLE_HANDLE table = create_table();
+    ASSERT_ARE_EQUAL(int, 0, packet_id_table_add(table, &test_entries[0], 7));
+    ASSERT_ARE_EQUAL(int, 0, packet_id_table_add(table, &test_entries[1], 7));
+    umock_c_reset_all_calls();
+
+    // act
+    PACKET_ID_TABLE_ENTRY* result = packet_id_table_remove(table, 7);
+
+    // assert
+    ASSERT_ARE_EQUAL(void_ptr, &test_entries[1], result);
+    ASSERT_ARE_EQUAL(void_ptr, &test_entries[0], packet_id_table_remove(table, 7));
+    ASSERT_IS_NULL(packet_id_table_remove(table, 7));
+
+    // cleanup
+    packet_id_table_destroy(table);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_PACKET_ID_TABLE_31_010: [ If handle or entry is NULL, packet_id_table_remove_entry shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(packet_id_table_remove_entry_NULL_handle_fails)
+{
+    // act
+    int result = packet_id_table_remove_entry(NULL, &test_entries[0]);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_PACKET_ID_TABLE_31_010: [ If handle or entry is NULL, packet_id_table_remove_entry shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(packet_id_table_remove_entry_NULL_entry_fails)
+{
+    // arrange
+    PACKET_ID_TABLE_HANDLE table = create_table();
+
+    // act
+    int result = packet_id_table_remove_entry(table, NULL);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    packet_id_table_destroy(table);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_PACKET_ID_TABLE_31_011: [ packet_id_table_remove_entry shall remove entry from the table, and no other entry sharing its packet id, and return 0. ]*/
+TEST_FUNCTION(packet_id_table_remove_entry_removes_the_entry_of_a_reused_packet_id)
+{
+    // arrange
+    PACKET_ID_TABLE_HANDLE table = create_table();
+    ASSERT_ARE_EQUAL(int, 0, packet_id_table_add(table, &test_entries[0], 7));
+    ASSERT_ARE_EQUAL(int, 0, packet_id_table_add(table, &test_entries[1], 7));
+    umock_c_reset_all_calls();
+
+    // act
+    int result = packet_id_table_remove_entry(table, &test_entries[0]);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 1, packet_id_table_get_count(table));
+    ASSERT_ARE_EQUAL(void_ptr, &test_entries[1], packet_id_table_remove(table, 7));
+    ASSERT_IS_NULL(packet_id_table_remove(table, 7));
+
+    // cleanup
+    packet_id_table_destroy(table);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_PACKET_ID_TABLE_31_012: [ If entry is not in the table, packet_id_table_remove_entry shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(packet_id_table_remove_entry_of_an_entry_not_in_the_table_fails)
+{
+    // arrange
+    PACKET_ID_TABLE_HANDLE table = create_table();
+    ASSERT_ARE_EQUAL(int, 0, packet_id_table_add(table, &test_entries[0], 7));
+    ASSERT_ARE_EQUAL(int, 0, packet_id_table_add(table, &test_entries[1], 7));
+    ASSERT_ARE_EQUAL(int, 0, packet_id_table_remove_entry(table, &test_entries[1]));
+    umock_c_reset_all_calls();
+
+    // act
+    int result = packet_id_table_remove_entry(table, &test_entries[1]);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(size_t, 1, packet_id_table_get_count(table));
+    ASSERT_ARE_EQUAL(void_ptr, &test_entries[0], packet_id_table_remove(table, 7));
+
+    // cleanup
+    packet_id_table_destroy(table);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_PACKET_ID_TABLE_31_009: [ packet_id_table_get_count shall return the number of entries in the table, or 0 if handle is NULL. ]*/
+TEST_FUNCTION(packet_id_table_get_count_NULL_handle_returns_0)
+{
+    // act
+    size_t result = packet_id_table_get_count(NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 0, result);
+}
+
+END_TEST_SUITE(iothub_client_packet_id_table_ut)
@@ -0,0 +1,345 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifdef __cplusplus
+#include <cstdlib>
+#include <cstddef>
+#else
+#include <stdlib.h>
+#include <stddef.h>
+#endif
+
+static void* my_gballoc_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+static void my_gballoc_free(void* ptr)
+{
+    free(ptr);
+}
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+#include "umocktypes_charptr.h"
+#include "umocktypes_stdint.h"
+
+#define ENABLE_MOCKS
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/lock.h"
+#undef ENABLE_MOCKS
+
+#include "iothub_client_submission_queue.h"
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+DEFINE_ENUM_STRINGS(UMOCK_C_ERROR_CODE, UMOCK_C_ERROR_CODE_VALUES)
+
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    char temp_str[256];
+    (void)snprintf(temp_str, sizeof(temp_str), "umock_c reported error :%s", ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+    ASSERT_FAIL(temp_str);
+}
+
+static LOCK_HANDLE my_Lock_Init(void)
+{
+    return (LOCK_HANDLE)my_gballoc_malloc(1);
+}
+
+static LOCK_RESULT my_Lock_Deinit(LOCK_HANDLE handle)
+{
+    my_gballoc_free(handle);
+    return LOCK_OK;
+}
+
+typedef struct TEST_ITEM_TAG
+{
+    SUBMISSION_QUEUE_ENTRY entry;
+    int value;
+} TEST_ITEM;
+
+static void init_queue(SUBMISSION_QUEUE* queue)
+{
+    ASSERT_ARE_EQUAL(int, 0, submission_queue_init(queue));
+    umock_c_reset_all_calls();
+}
+
+static void init_items(TEST_ITEM* items, size_t count)
+{
+    size_t index;
+    for (index = 0; index < count; index++)
+    {
+        items[index].entry.next = NULL;
+        items[index].value = (int)index;
+    }
+}
+
+BEGIN_TEST_SUITE(iothub_client_submission_queue_ut)
+
+TEST_SUITE_INITIALIZE(TestClassInitialize)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+
+    umock_c_init(on_umock_c_error);
+
+    int result = umocktypes_charptr_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+    result = umocktypes_stdint_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+
+    REGISTER_UMOCK_ALIAS_TYPE(LOCK_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(LOCK_RESULT, int);
+
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_malloc, NULL);
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
+
+    REGISTER_GLOBAL_MOCK_HOOK(Lock_Init, my_Lock_Init);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(Lock_Init, NULL);
+    REGISTER_GLOBAL_MOCK_HOOK(Lock_Deinit, my_Lock_Deinit);
+    REGISTER_GLOBAL_MOCK_RETURN(Lock, LOCK_OK);
+    REGISTER_GLOBAL_MOCK_RETURN(Unlock, LOCK_OK);
+}
+
+TEST_SUITE_CLEANUP(TestClassCleanup)
+{
+    umock_c_deinit();
+
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest))
+    {
+        ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+    }
+
+    umock_c_reset_all_calls();
+}
+
+TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+{
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_SUBMISSION_QUEUE_31_001: [ If queue is NULL, submission_queue_init shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(submission_queue_init_NULL_queue_fails)
+{
+    // act
+    int result = submission_queue_init(NULL);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_SUBMISSION_QUEUE_31_002: [ submission_queue_init shall initialize queue as an empty queue and return 0. ]*/
+TEST_FUNCTION(submission_queue_init_succeeds)
+{
+    // arrange
+    SUBMISSION_QUEUE queue;
+#ifdef SUBMISSION_QUEUE_USE_LOCK
+    STRICT_EXPECTED_CALL(Lock_Init());
+#endif
+
+    // act
+    int result = submission_queue_init(&queue);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_IS_TRUE(submission_queue_is_empty(&queue));
+    ASSERT_IS_NULL(submission_queue_take_all(&queue));
+
+    // cleanup
+    submission_queue_deinit(&queue);
+}
+
+#ifdef SUBMISSION_QUEUE_USE_LOCK
+/* Tests_SRS_IOTHUB_CLIENT_SUBMISSION_QUEUE_31_003: [ If the queue needs a lock and creating it fails, submission_queue_init shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(submission_queue_init_Lock_Init_fails)
+{
+    // arrange
+    SUBMISSION_QUEUE queue;
+    STRICT_EXPECTED_CALL(Lock_Init())
+        .SetReturn(NULL);
+
+    // act
+    int result = submission_queue_init(&queue);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+#endif
+
+/* Tests_SRS_IOTHUB_CLIENT_SUBMISSION_QUEUE_31_004: [ If queue is NULL, submission_queue_deinit shall do nothing. ]*/
+TEST_FUNCTION(submission_queue_deinit_NULL_queue_does_nothing)
+{
+    // act
+    submission_queue_deinit(NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_SUBMISSION_QUEUE_31_005: [ submission_queue_deinit shall free the resources held by queue. The entries still in the queue are owned by the caller. ]*/
+TEST_FUNCTION(submission_queue_deinit_succeeds)
+{
+    // arrange
+    SUBMISSION_QUEUE queue;
+    init_queue(&queue);
+#ifdef SUBMISSION_QUEUE_USE_LOCK
+    STRICT_EXPECTED_CALL(Lock_Deinit(IGNORED_PTR_ARG));
+#endif
+
+    // act
+    submission_queue_deinit(&queue);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_SUBMISSION_QUEUE_31_006: [ If queue or entry is NULL, submission_queue_push shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(submission_queue_push_NULL_queue_fails)
+{
+    // arrange
+    TEST_ITEM item;
+    init_items(&item, 1);
+
+    // act
+    int result = submission_queue_push(NULL, &item.entry);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_SUBMISSION_QUEUE_31_006: [ If queue or entry is NULL, submission_queue_push shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(submission_queue_push_NULL_entry_fails)
+{
+    // arrange
+    SUBMISSION_QUEUE queue;
+    init_queue(&queue);
+
+    // act
+    int result = submission_queue_push(&queue, NULL);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_IS_TRUE(submission_queue_is_empty(&queue));
+
+    // cleanup
+    submission_queue_deinit(&queue);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_SUBMISSION_QUEUE_31_007: [ submission_queue_push shall link entry to the queue with an atomic compare and swap of the head of the queue, retrying until it succeeds, and return 0. ]*/
+/* Tests_SRS_IOTHUB_CLIENT_SUBMISSION_QUEUE_31_012: [ submission_queue_is_empty shall read the head of the queue with the same full memory barrier as submission_queue_push and return true if it is NULL. ]*/
+TEST_FUNCTION(submission_queue_push_succeeds)
+{
+    // arrange
+    SUBMISSION_QUEUE queue;
+    TEST_ITEM item;
+    init_items(&item, 1);
+    init_queue(&queue);
+
+    // act
+    int result = submission_queue_push(&queue, &item.entry);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_IS_FALSE(submission_queue_is_empty(&queue));
+
+    // cleanup
+    (void)submission_queue_take_all(&queue);
+    submission_queue_deinit(&queue);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_SUBMISSION_QUEUE_31_008: [ If queue is NULL, submission_queue_take_all shall return NULL. ]*/
+TEST_FUNCTION(submission_queue_take_all_NULL_queue_returns_NULL)
+{
+    // act
+    SUBMISSION_QUEUE_ENTRY* result = submission_queue_take_all(NULL);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_SUBMISSION_QUEUE_31_009: [ submission_queue_take_all shall atomically detach all the entries from the queue, leaving it empty. ]*/
+/* Tests_SRS_IOTHUB_CLIENT_SUBMISSION_QUEUE_31_010: [ submission_queue_take_all shall return the detached entries linked through next in the order they were pushed, or NULL if the queue was empty. ]*/
+TEST_FUNCTION(submission_queue_take_all_returns_the_entries_in_push_order)
+{
+    // arrange
+    SUBMISSION_QUEUE queue;
+    TEST_ITEM items[4];
+    SUBMISSION_QUEUE_ENTRY* entry;
+    size_t index;
+    init_items(items, 4);
+    init_queue(&queue);
+    for (index = 0; index < 4; index++)
+    {
+        ASSERT_ARE_EQUAL(int, 0, submission_queue_push(&queue, &items[index].entry));
+    }
+
+    // act
+    entry = submission_queue_take_all(&queue);
+
+    // assert
+    for (index = 0; index < 4; index++)
+    {
+        ASSERT_IS_NOT_NULL(entry);
+        ASSERT_ARE_EQUAL(int, (int)index, ((TEST_ITEM*)entry)->value);
+        entry = entry->next;
+    }
+    ASSERT_IS_NULL(entry);
+    ASSERT_IS_TRUE(submission_queue_is_empty(&queue));
+
+    // cleanup
+    submission_queue_deinit(&queue);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_SUBMISSION_QUEUE_31_009: [ submission_queue_take_all shall atomically detach all the entries from the queue, leaving it empty. ]*/
+TEST_FUNCTION(submission_queue_push_after_take_all_starts_a_new_batch)
+{
+    // arrange
+    SUBMISSION_QUEUE queue;
+    TEST_ITEM items[3];
+    SUBMISSION_QUEUE_ENTRY* entry;
+    init_items(items, 3);
+    init_queue(&queue);
+    (void)submission_queue_push(&queue, &items[0].entry);
+    (void)submission_queue_push(&queue, &items[1].entry);
+    (void)submission_queue_take_all(&queue);
+
+    // act
+    (void)submission_queue_push(&queue, &items[2].entry);
+    entry = submission_queue_take_all(&queue);
+
+    // assert
+    ASSERT_ARE_EQUAL(void_ptr, &items[2].entry, entry);
+    ASSERT_IS_NULL(entry->next);
+    ASSERT_IS_NULL(submission_queue_take_all(&queue));
+
+    // cleanup
+    submission_queue_deinit(&queue);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_SUBMISSION_QUEUE_31_011: [ If queue is NULL, submission_queue_is_empty shall return true. ]*/
+TEST_FUNCTION(submission_queue_is_empty_NULL_queue_returns_true)
+{
+    // act
+    bool result = submission_queue_is_empty(NULL);
+
+    // assert
+    ASSERT_IS_TRUE(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+END_TEST_SUITE(iothub_client_submission_queue_ut)
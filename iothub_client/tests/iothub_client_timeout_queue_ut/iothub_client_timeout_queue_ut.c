@@ -0,0 +1,449 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifdef __cplusplus
+#include <cstdlib>
+#include <cstddef>
+#else
+#include <stdlib.h>
+#include <stddef.h>
+#endif
+
+static void* my_gballoc_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+static void* my_gballoc_realloc(void* ptr, size_t size)
+{
+    return realloc(ptr, size);
+}
+
+static void my_gballoc_free(void* ptr)
+{
+    free(ptr);
+}
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+#include "umocktypes_charptr.h"
+#include "umocktypes_stdint.h"
+
+#define ENABLE_MOCKS
+#include "azure_c_shared_utility/gballoc.h"
+#undef ENABLE_MOCKS
+
+#include "iothub_client_timeout_queue.h"
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+DEFINE_ENUM_STRINGS(UMOCK_C_ERROR_CODE, UMOCK_C_ERROR_CODE_VALUES)
+
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    char temp_str[256];
+    (void)snprintf(temp_str, sizeof(temp_str), "umock_c reported error :%s", ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+    ASSERT_FAIL(temp_str);
+}
+
+#define TEST_ENTRY_COUNT 20
+
+static TIMEOUT_QUEUE_ENTRY test_entries[TEST_ENTRY_COUNT];
+
+static TIMEOUT_QUEUE_HANDLE create_queue(void)
+{
+    TIMEOUT_QUEUE_HANDLE result = timeout_queue_create();
+    ASSERT_IS_NOT_NULL(result);
+    umock_c_reset_all_calls();
+    return result;
+}
+
+static void add_entries(TIMEOUT_QUEUE_HANDLE queue, const tickcounter_ms_t* expiries, size_t count)
+{
+    size_t i;
+    for (i = 0; i < count; i++)
+    {
+        ASSERT_ARE_EQUAL(int, 0, timeout_queue_add(queue, &test_entries[i], expiries[i]));
+    }
+    umock_c_reset_all_calls();
+}
+
+BEGIN_TEST_SUITE(iothub_client_timeout_queue_ut)
+
+TEST_SUITE_INITIALIZE(TestClassInitialize)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+
+    umock_c_init(on_umock_c_error);
+
+    int result = umocktypes_charptr_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+    result = umocktypes_stdint_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_malloc, NULL);
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_realloc, my_gballoc_realloc);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_realloc, NULL);
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
+}
+
+TEST_SUITE_CLEANUP(TestClassCleanup)
+{
+    umock_c_deinit();
+
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+{
+    size_t i;
+
+    if (TEST_MUTEX_ACQUIRE(g_testByTest))
+    {
+        ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+    }
+
+    for (i = 0; i < TEST_ENTRY_COUNT; i++)
+    {
+        TIMEOUT_QUEUE_ENTRY_INIT(&test_entries[i]);
+    }
+
+    umock_c_reset_all_calls();
+}
+
+TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+{
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_001: [ timeout_queue_create shall allocate an empty queue and return its handle. ]*/
+TEST_FUNCTION(timeout_queue_create_succeeds)
+{
+    // arrange
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+
+    // act
+    TIMEOUT_QUEUE_HANDLE queue = timeout_queue_create();
+
+    // assert
+    ASSERT_IS_NOT_NULL(queue);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 0, timeout_queue_get_count(queue));
+    ASSERT_IS_NULL(timeout_queue_peek(queue));
+
+    // cleanup
+    timeout_queue_destroy(queue);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_002: [ If allocating memory fails, timeout_queue_create shall return NULL. ]*/
+TEST_FUNCTION(timeout_queue_create_malloc_fails)
+{
+    // arrange
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+
+    // act
+    TIMEOUT_QUEUE_HANDLE queue = timeout_queue_create();
+
+    // assert
+    ASSERT_IS_NULL(queue);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_003: [ If handle is NULL, timeout_queue_destroy shall do nothing. ]*/
+TEST_FUNCTION(timeout_queue_destroy_NULL_handle_does_nothing)
+{
+    // act
+    timeout_queue_destroy(NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_004: [ timeout_queue_destroy shall mark every entry still in the queue as not queued and free the queue. ]*/
+TEST_FUNCTION(timeout_queue_destroy_releases_the_remaining_entries)
+{
+    // arrange
+    tickcounter_ms_t expiries[] = { 30, 10 };
+    TIMEOUT_QUEUE_HANDLE queue = create_queue();
+    add_entries(queue, expiries, 2);
+
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    // act
+    timeout_queue_destroy(queue);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_IS_NULL(test_entries[0].queue);
+    ASSERT_IS_NULL(test_entries[1].queue);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_005: [ If handle or entry is NULL, or entry is already queued, timeout_queue_add shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(timeout_queue_add_NULL_handle_fails)
+{
+    // act
+    int result = timeout_queue_add(NULL, &test_entries[0], 10);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_005: [ If handle or entry is NULL, or entry is already queued, timeout_queue_add shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(timeout_queue_add_NULL_entry_fails)
+{
+    // arrange
+    TIMEOUT_QUEUE_HANDLE queue = create_queue();
+
+    // act
+    int result = timeout_queue_add(queue, NULL, 10);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    timeout_queue_destroy(queue);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_005: [ If handle or entry is NULL, or entry is already queued, timeout_queue_add shall fail and return a non-zero value. ]*/
+TEST_FUNCTION(timeout_queue_add_already_queued_entry_fails)
+{
+    // arrange
+    tickcounter_ms_t expiries[] = { 10 };
+    TIMEOUT_QUEUE_HANDLE queue = create_queue();
+    add_entries(queue, expiries, 1);
+
+    // act
+    int result = timeout_queue_add(queue, &test_entries[0], 20);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 1, timeout_queue_get_count(queue));
+    ASSERT_ARE_EQUAL(uint64_t, 10, test_entries[0].expiry);
+
+    // cleanup
+    timeout_queue_destroy(queue);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_006: [ When the queue is full, timeout_queue_add shall double its capacity. ]*/
+/* Tests_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_008: [ timeout_queue_add shall insert entry ordered by expiry and return 0. ]*/
+TEST_FUNCTION(timeout_queue_add_first_entry_succeeds)
+{
+    // arrange
+    TIMEOUT_QUEUE_HANDLE queue = create_queue();
+
+    STRICT_EXPECTED_CALL(gballoc_realloc(NULL, IGNORED_NUM_ARG));
+
+    // act
+    int result = timeout_queue_add(queue, &test_entries[0], 10);
+
+    // assert
+    ASSERT_ARE_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 1, timeout_queue_get_count(queue));
+    ASSERT_ARE_EQUAL(void_ptr, queue, test_entries[0].queue);
+    ASSERT_ARE_EQUAL(void_ptr, &test_entries[0], timeout_queue_peek(queue));
+
+    // cleanup
+    timeout_queue_destroy(queue);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_006: [ When the queue is full, timeout_queue_add shall double its capacity. ]*/
+TEST_FUNCTION(timeout_queue_add_grows_only_when_full)
+{
+    // arrange
+    tickcounter_ms_t expiries[TEST_ENTRY_COUNT];
+    size_t i;
+    TIMEOUT_QUEUE_HANDLE queue = create_queue();
+
+    for (i = 0; i < TEST_ENTRY_COUNT; i++)
+    {
+        expiries[i] = 1000 - i;
+    }
+
+    STRICT_EXPECTED_CALL(gballoc_realloc(NULL, IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(gballoc_realloc(IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+
+    // act
+    for (i = 0; i < TEST_ENTRY_COUNT; i++)
+    {
+        ASSERT_ARE_EQUAL(int, 0, timeout_queue_add(queue, &test_entries[i], expiries[i]));
+    }
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, TEST_ENTRY_COUNT, timeout_queue_get_count(queue));
+    ASSERT_ARE_EQUAL(void_ptr, &test_entries[TEST_ENTRY_COUNT - 1], timeout_queue_peek(queue));
+
+    // cleanup
+    timeout_queue_destroy(queue);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_007: [ If growing the queue fails, timeout_queue_add shall fail, leave the queue unchanged and return a non-zero value. ]*/
+TEST_FUNCTION(timeout_queue_add_realloc_fails)
+{
+    // arrange
+    TIMEOUT_QUEUE_HANDLE queue = create_queue();
+
+    STRICT_EXPECTED_CALL(gballoc_realloc(NULL, IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+
+    // act
+    int result = timeout_queue_add(queue, &test_entries[0], 10);
+
+    // assert
+    ASSERT_ARE_NOT_EQUAL(int, 0, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 0, timeout_queue_get_count(queue));
+    ASSERT_IS_NULL(test_entries[0].queue);
+
+    // cleanup
+    timeout_queue_destroy(queue);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_009: [ If entry is NULL or is not queued, timeout_queue_remove shall do nothing. ]*/
+TEST_FUNCTION(timeout_queue_remove_entry_not_queued_does_nothing)
+{
+    // arrange
+    tickcounter_ms_t expiries[] = { 10 };
+    TIMEOUT_QUEUE_HANDLE queue = create_queue();
+    add_entries(queue, expiries, 1);
+
+    // act
+    timeout_queue_remove(NULL);
+    timeout_queue_remove(&test_entries[1]);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 1, timeout_queue_get_count(queue));
+
+    // cleanup
+    timeout_queue_destroy(queue);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_010: [ timeout_queue_remove shall remove entry from the queue that holds it and mark it as not queued. ]*/
+TEST_FUNCTION(timeout_queue_remove_keeps_the_remaining_entries_ordered)
+{
+    // arrange
+    tickcounter_ms_t expiries[] = { 50, 20, 80, 10, 60, 30, 70, 40 };
+    tickcounter_ms_t expected[] = { 10, 20, 30, 60, 70, 80 };
+    size_t i;
+    TIMEOUT_QUEUE_HANDLE queue = create_queue();
+    add_entries(queue, expiries, 8);
+
+    // act
+    timeout_queue_remove(&test_entries[0]);
+    timeout_queue_remove(&test_entries[7]);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_IS_NULL(test_entries[0].queue);
+    ASSERT_IS_NULL(test_entries[7].queue);
+    ASSERT_ARE_EQUAL(size_t, 6, timeout_queue_get_count(queue));
+    for (i = 0; i < sizeof(expected) / sizeof(expected[0]); i++)
+    {
+        TIMEOUT_QUEUE_ENTRY* entry = timeout_queue_pop_expired(queue, 1000);
+        ASSERT_IS_NOT_NULL(entry);
+        ASSERT_ARE_EQUAL(uint64_t, expected[i], entry->expiry);
+    }
+    ASSERT_IS_NULL(timeout_queue_pop_expired(queue, 1000));
+
+    // cleanup
+    timeout_queue_destroy(queue);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_011: [ If handle is NULL or the queue is empty, timeout_queue_peek shall return NULL. ]*/
+TEST_FUNCTION(timeout_queue_peek_NULL_handle_returns_NULL)
+{
+    // act
+    TIMEOUT_QUEUE_ENTRY* result = timeout_queue_peek(NULL);
+
+    // assert
+    ASSERT_IS_NULL(result);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_012: [ Otherwise timeout_queue_peek shall return the entry that expires first without removing it. ]*/
+TEST_FUNCTION(timeout_queue_peek_returns_the_earliest_entry)
+{
+    // arrange
+    tickcounter_ms_t expiries[] = { 30, 10, 20 };
+    TIMEOUT_QUEUE_HANDLE queue = create_queue();
+    add_entries(queue, expiries, 3);
+
+    // act
+    TIMEOUT_QUEUE_ENTRY* result = timeout_queue_peek(queue);
+
+    // assert
+    ASSERT_ARE_EQUAL(void_ptr, &test_entries[1], result);
+    ASSERT_ARE_EQUAL(size_t, 3, timeout_queue_get_count(queue));
+
+    // cleanup
+    timeout_queue_destroy(queue);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_013: [ If the entry that expires first has an expiry smaller than current_ms, timeout_queue_pop_expired shall remove it from the queue and return it. ]*/
+/* Tests_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_014: [ Otherwise, or if handle is NULL, timeout_queue_pop_expired shall return NULL. ]*/
+TEST_FUNCTION(timeout_queue_pop_expired_returns_only_expired_entries)
+{
+    // arrange
+    tickcounter_ms_t expiries[] = { 30, 10, 20 };
+    TIMEOUT_QUEUE_HANDLE queue = create_queue();
+    add_entries(queue, expiries, 3);
+
+    // act
+    TIMEOUT_QUEUE_ENTRY* first = timeout_queue_pop_expired(queue, 21);
+    TIMEOUT_QUEUE_ENTRY* second = timeout_queue_pop_expired(queue, 21);
+    TIMEOUT_QUEUE_ENTRY* third = timeout_queue_pop_expired(queue, 21);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(void_ptr, &test_entries[1], first);
+    ASSERT_ARE_EQUAL(void_ptr, &test_entries[2], second);
+    ASSERT_IS_NULL(third);
+    ASSERT_IS_NULL(test_entries[1].queue);
+    ASSERT_ARE_EQUAL(size_t, 1, timeout_queue_get_count(queue));
+
+    // cleanup
+    timeout_queue_destroy(queue);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_014: [ Otherwise, or if handle is NULL, timeout_queue_pop_expired shall return NULL. ]*/
+TEST_FUNCTION(timeout_queue_pop_expired_on_the_edge_returns_NULL)
+{
+    // arrange
+    tickcounter_ms_t expiries[] = { 10 };
+    TIMEOUT_QUEUE_HANDLE queue = create_queue();
+    add_entries(queue, expiries, 1);
+
+    // act
+    TIMEOUT_QUEUE_ENTRY* result = timeout_queue_pop_expired(queue, 10);
+
+    // assert
+    ASSERT_IS_NULL(result);
+    ASSERT_IS_NULL(timeout_queue_pop_expired(NULL, 10));
+    ASSERT_ARE_EQUAL(size_t, 1, timeout_queue_get_count(queue));
+
+    // cleanup
+    timeout_queue_destroy(queue);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_TIMEOUT_QUEUE_31_015: [ timeout_queue_get_count shall return the number of queued entries, or 0 if handle is NULL. ]*/
+TEST_FUNCTION(timeout_queue_get_count_NULL_handle_returns_0)
+{
+    // act
+    size_t result = timeout_queue_get_count(NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 0, result);
+}
+
+END_TEST_SUITE(iothub_client_timeout_queue_ut)
@@ -0,0 +1,728 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifdef __cplusplus
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#else
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#endif
+
+static void* my_gballoc_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+static void my_gballoc_free(void* ptr)
+{
+    free(ptr);
+}
+
+#include "testrunnerswitcher.h"
+#include "umock_c.h"
+#include "umocktypes_charptr.h"
+#include "umocktypes_stdint.h"
+
+#define ENABLE_MOCKS
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/lock.h"
+#include "azure_c_shared_utility/condition.h"
+#include "azure_c_shared_utility/threadapi.h"
+#include "azure_c_shared_utility/tickcounter.h"
+#include "azure_c_shared_utility/doublylinkedlist.h"
+#undef ENABLE_MOCKS
+
+#include "iothub_client_worker_pool.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    void real_DList_InitializeListHead(PDLIST_ENTRY listHead);
+    int real_DList_IsListEmpty(const PDLIST_ENTRY listHead);
+    void real_DList_InsertTailList(PDLIST_ENTRY listHead, PDLIST_ENTRY listEntry);
+    void real_DList_InsertHeadList(PDLIST_ENTRY listHead, PDLIST_ENTRY listEntry);
+    int real_DList_RemoveEntryList(PDLIST_ENTRY listEntry);
+    PDLIST_ENTRY real_DList_RemoveHeadList(PDLIST_ENTRY listHead);
+
+#ifdef __cplusplus
+}
+#endif
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+DEFINE_ENUM_STRINGS(UMOCK_C_ERROR_CODE, UMOCK_C_ERROR_CODE_VALUES)
+
+static void on_umock_c_error(UMOCK_C_ERROR_CODE error_code)
+{
+    char temp_str[256];
+    (void)snprintf(temp_str, sizeof(temp_str), "umock_c reported error :%s", ENUM_TO_STRING(UMOCK_C_ERROR_CODE, error_code));
+    ASSERT_FAIL(temp_str);
+}
+
+#define TEST_THREAD_COUNT       2
+#define TEST_MAX_RUNS           8
+
+static THREAD_HANDLE TEST_THREAD_HANDLE = (THREAD_HANDLE)0x4242;
+static TICK_COUNTER_HANDLE TEST_TICK_COUNTER = (TICK_COUNTER_HANDLE)0x4243;
+static void* TEST_CONTEXT = (void*)0x4244;
+
+static THREAD_START_FUNC g_thread_func;
+static void* g_thread_func_arg;
+static tickcounter_ms_t g_current_ms;
+static size_t g_lock_calls_before_failure;  /*0 means Lock never fails*/
+
+/*what the test work function returns for each of its runs*/
+static unsigned int g_work_delays[TEST_MAX_RUNS];
+static size_t g_work_runs;
+static size_t g_stop_after_runs;            /*once the work ran that many times, the next Lock fails so that the thread under test exits*/
+static IOTHUB_WORKER_POOL_ITEM_HANDLE g_item_to_signal_on_wait;
+static size_t g_work_signal_posts;
+static size_t g_work_signal_posts_seen_by_slow_work;
+
+static LOCK_HANDLE my_Lock_Init(void)
+{
+    return (LOCK_HANDLE)my_gballoc_malloc(1);
+}
+
+static LOCK_RESULT my_Lock_Deinit(LOCK_HANDLE handle)
+{
+    my_gballoc_free(handle);
+    return LOCK_OK;
+}
+
+static LOCK_RESULT my_Lock(LOCK_HANDLE handle)
+{
+    LOCK_RESULT result;
+    (void)handle;
+    if (g_lock_calls_before_failure == 1)
+    {
+        result = LOCK_ERROR;
+    }
+    else
+    {
+        if (g_lock_calls_before_failure > 1)
+        {
+            g_lock_calls_before_failure--;
+        }
+        result = LOCK_OK;
+    }
+    return result;
+}
+
+static COND_HANDLE my_Condition_Init(void)
+{
+    return (COND_HANDLE)my_gballoc_malloc(1);
+}
+
+static void my_Condition_Deinit(COND_HANDLE handle)
+{
+    my_gballoc_free(handle);
+}
+
+static COND_RESULT my_Condition_Wait(COND_HANDLE handle, LOCK_HANDLE lock, int timeout_milliseconds)
+{
+    (void)handle;
+    (void)lock;
+    if (g_item_to_signal_on_wait != NULL)
+    {
+        IOTHUB_WORKER_POOL_ITEM_HANDLE item = g_item_to_signal_on_wait;
+        g_item_to_signal_on_wait = NULL;
+        IoTHubWorkerPool_Signal(item);
+    }
+    else
+    {
+        g_current_ms += (tickcounter_ms_t)timeout_milliseconds;
+    }
+    return COND_TIMEOUT;
+}
+
+static COND_RESULT my_Condition_Post(COND_HANDLE handle)
+{
+    (void)handle;
+    g_work_signal_posts++;
+    return COND_OK;
+}
+
+static THREADAPI_RESULT my_ThreadAPI_Create(THREAD_HANDLE* threadHandle, THREAD_START_FUNC func, void* arg)
+{
+    *threadHandle = TEST_THREAD_HANDLE;
+    g_thread_func = func;
+    g_thread_func_arg = arg;
+    return THREADAPI_OK;
+}
+
+static THREADAPI_RESULT my_ThreadAPI_Join(THREAD_HANDLE threadHandle, int* res)
+{
+    (void)threadHandle;
+    *res = 0;
+    return THREADAPI_OK;
+}
+
+static TICK_COUNTER_HANDLE my_tickcounter_create(void)
+{
+    return TEST_TICK_COUNTER;
+}
+
+static int my_tickcounter_get_current_ms(TICK_COUNTER_HANDLE tick_counter, tickcounter_ms_t* current_ms)
+{
+    (void)tick_counter;
+    *current_ms = g_current_ms;
+    return 0;
+}
+
+static unsigned int test_work(void* context)
+{
+    unsigned int result;
+    ASSERT_ARE_EQUAL(void_ptr, TEST_CONTEXT, context);
+    result = (g_work_runs < TEST_MAX_RUNS) ? g_work_delays[g_work_runs] : 0;
+    g_work_runs++;
+    if (g_work_runs == g_stop_after_runs)
+    {
+        g_lock_calls_before_failure = 1;
+    }
+    return result;
+}
+
+/*stands for a DoWork taking longer than the delay of the other items: records whether the threads waiting for work were woken up since the test started counting, and stops the thread under test*/
+static unsigned int test_slow_work(void* context)
+{
+    ASSERT_ARE_EQUAL(void_ptr, TEST_CONTEXT, context);
+    g_current_ms += 200;
+    g_work_signal_posts_seen_by_slow_work = g_work_signal_posts;
+    g_lock_calls_before_failure = 1;
+    return 0;
+}
+
+static IOTHUB_WORKER_POOL_HANDLE create_pool(void)
+{
+    IOTHUB_WORKER_POOL_HANDLE result = IoTHubWorkerPool_Create(TEST_THREAD_COUNT);
+    ASSERT_IS_NOT_NULL(result);
+    umock_c_reset_all_calls();
+    return result;
+}
+
+/*runs a thread of the pool until the work ran g_stop_after_runs times*/
+static void run_pool_thread(size_t runs)
+{
+    g_stop_after_runs = runs;
+    ASSERT_IS_NOT_NULL(g_thread_func);
+    (void)g_thread_func(g_thread_func_arg);
+    g_lock_calls_before_failure = 0;
+}
+
+/*the thread under test exited while the item was running, so the item never went back to the pool and cannot be removed*/
+static void destroy_pool_with_running_item(IOTHUB_WORKER_POOL_HANDLE pool, IOTHUB_WORKER_POOL_ITEM_HANDLE item)
+{
+    my_gballoc_free(item);
+    IoTHubWorkerPool_Destroy(pool);
+}
+
+BEGIN_TEST_SUITE(iothub_client_worker_pool_ut)
+
+TEST_SUITE_INITIALIZE(TestClassInitialize)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+
+    umock_c_init(on_umock_c_error);
+
+    int result = umocktypes_charptr_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+    result = umocktypes_stdint_register_types();
+    ASSERT_ARE_EQUAL(int, 0, result);
+
+    REGISTER_UMOCK_ALIAS_TYPE(LOCK_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(LOCK_RESULT, int);
+    REGISTER_UMOCK_ALIAS_TYPE(COND_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(COND_RESULT, int);
+    REGISTER_UMOCK_ALIAS_TYPE(THREAD_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(THREADAPI_RESULT, int);
+    REGISTER_UMOCK_ALIAS_TYPE(THREAD_START_FUNC, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(TICK_COUNTER_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(PDLIST_ENTRY, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(const PDLIST_ENTRY, void*);
+
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_malloc, NULL);
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
+
+    REGISTER_GLOBAL_MOCK_HOOK(Lock_Init, my_Lock_Init);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(Lock_Init, NULL);
+    REGISTER_GLOBAL_MOCK_HOOK(Lock_Deinit, my_Lock_Deinit);
+    REGISTER_GLOBAL_MOCK_HOOK(Lock, my_Lock);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(Lock, LOCK_ERROR);
+    REGISTER_GLOBAL_MOCK_RETURN(Unlock, LOCK_OK);
+
+    REGISTER_GLOBAL_MOCK_HOOK(Condition_Init, my_Condition_Init);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(Condition_Init, NULL);
+    REGISTER_GLOBAL_MOCK_HOOK(Condition_Deinit, my_Condition_Deinit);
+    REGISTER_GLOBAL_MOCK_HOOK(Condition_Wait, my_Condition_Wait);
+    REGISTER_GLOBAL_MOCK_HOOK(Condition_Post, my_Condition_Post);
+
+    REGISTER_GLOBAL_MOCK_HOOK(ThreadAPI_Create, my_ThreadAPI_Create);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(ThreadAPI_Create, THREADAPI_ERROR);
+    REGISTER_GLOBAL_MOCK_HOOK(ThreadAPI_Join, my_ThreadAPI_Join);
+
+    REGISTER_GLOBAL_MOCK_HOOK(tickcounter_create, my_tickcounter_create);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(tickcounter_create, NULL);
+    REGISTER_GLOBAL_MOCK_HOOK(tickcounter_get_current_ms, my_tickcounter_get_current_ms);
+
+    REGISTER_GLOBAL_MOCK_HOOK(DList_InitializeListHead, real_DList_InitializeListHead);
+    REGISTER_GLOBAL_MOCK_HOOK(DList_IsListEmpty, real_DList_IsListEmpty);
+    REGISTER_GLOBAL_MOCK_HOOK(DList_InsertTailList, real_DList_InsertTailList);
+    REGISTER_GLOBAL_MOCK_HOOK(DList_InsertHeadList, real_DList_InsertHeadList);
+    REGISTER_GLOBAL_MOCK_HOOK(DList_RemoveEntryList, real_DList_RemoveEntryList);
+    REGISTER_GLOBAL_MOCK_HOOK(DList_RemoveHeadList, real_DList_RemoveHeadList);
+}
+
+TEST_SUITE_CLEANUP(TestClassCleanup)
+{
+    umock_c_deinit();
+
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+{
+    size_t i;
+
+    if (TEST_MUTEX_ACQUIRE(g_testByTest))
+    {
+        ASSERT_FAIL("our mutex is ABANDONED. Failure in test framework");
+    }
+
+    g_thread_func = NULL;
+    g_thread_func_arg = NULL;
+    g_current_ms = 1000;
+    g_lock_calls_before_failure = 0;
+    g_work_runs = 0;
+    g_stop_after_runs = 0;
+    g_item_to_signal_on_wait = NULL;
+    g_work_signal_posts = 0;
+    g_work_signal_posts_seen_by_slow_work = 0;
+    for (i = 0; i < TEST_MAX_RUNS; i++)
+    {
+        g_work_delays[i] = 0;
+    }
+
+    umock_c_reset_all_calls();
+}
+
+TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+{
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_WORKER_POOL_31_001: [ If thread_count is 0, IoTHubWorkerPool_Create shall fail and return NULL. ]*/
+TEST_FUNCTION(IoTHubWorkerPool_Create_thread_count_0_fails)
+{
+    // act
+    IOTHUB_WORKER_POOL_HANDLE pool = IoTHubWorkerPool_Create(0);
+
+    // assert
+    ASSERT_IS_NULL(pool);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_WORKER_POOL_31_003: [ IoTHubWorkerPool_Create shall start thread_count threads and return the handle of the pool. ]*/
+TEST_FUNCTION(IoTHubWorkerPool_Create_succeeds)
+{
+    // arrange
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(DList_InitializeListHead(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_InitializeListHead(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Lock_Init());
+    STRICT_EXPECTED_CALL(Condition_Init());
+    STRICT_EXPECTED_CALL(Condition_Init());
+    STRICT_EXPECTED_CALL(tickcounter_create());
+    STRICT_EXPECTED_CALL(gballoc_malloc(TEST_THREAD_COUNT * sizeof(THREAD_HANDLE)));
+    STRICT_EXPECTED_CALL(ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+
+    // act
+    IOTHUB_WORKER_POOL_HANDLE pool = IoTHubWorkerPool_Create(TEST_THREAD_COUNT);
+
+    // assert
+    ASSERT_IS_NOT_NULL(pool);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(void_ptr, (void*)pool, g_thread_func_arg);
+
+    // cleanup
+    IoTHubWorkerPool_Destroy(pool);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_WORKER_POOL_31_002: [ If allocating memory or creating the lock, the conditions, the tick counter or a thread fails, IoTHubWorkerPool_Create shall fail and return NULL. ]*/
+TEST_FUNCTION(IoTHubWorkerPool_Create_ThreadAPI_Create_fails_stops_the_started_threads)
+{
+    // arrange
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(DList_InitializeListHead(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_InitializeListHead(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Lock_Init());
+    STRICT_EXPECTED_CALL(Condition_Init());
+    STRICT_EXPECTED_CALL(Condition_Init());
+    STRICT_EXPECTED_CALL(tickcounter_create());
+    STRICT_EXPECTED_CALL(gballoc_malloc(TEST_THREAD_COUNT * sizeof(THREAD_HANDLE)));
+    STRICT_EXPECTED_CALL(ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(ThreadAPI_Create(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG)).SetReturn(THREADAPI_ERROR);
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Condition_Post(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(ThreadAPI_Join(TEST_THREAD_HANDLE, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(tickcounter_destroy(TEST_TICK_COUNTER));
+    STRICT_EXPECTED_CALL(Condition_Deinit(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Condition_Deinit(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Lock_Deinit(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    // act
+    IOTHUB_WORKER_POOL_HANDLE pool = IoTHubWorkerPool_Create(TEST_THREAD_COUNT);
+
+    // assert
+    ASSERT_IS_NULL(pool);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_WORKER_POOL_31_002: [ If allocating memory or creating the lock, the conditions, the tick counter or a thread fails, IoTHubWorkerPool_Create shall fail and return NULL. ]*/
+TEST_FUNCTION(IoTHubWorkerPool_Create_tickcounter_create_fails)
+{
+    // arrange
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(DList_InitializeListHead(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_InitializeListHead(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Lock_Init());
+    STRICT_EXPECTED_CALL(Condition_Init());
+    STRICT_EXPECTED_CALL(Condition_Init());
+    STRICT_EXPECTED_CALL(tickcounter_create()).SetReturn(NULL);
+    STRICT_EXPECTED_CALL(Condition_Deinit(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Condition_Deinit(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Lock_Deinit(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    // act
+    IOTHUB_WORKER_POOL_HANDLE pool = IoTHubWorkerPool_Create(TEST_THREAD_COUNT);
+
+    // assert
+    ASSERT_IS_NULL(pool);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_WORKER_POOL_31_004: [ If pool is NULL, IoTHubWorkerPool_Destroy shall do nothing. ]*/
+TEST_FUNCTION(IoTHubWorkerPool_Destroy_NULL_does_nothing)
+{
+    // act
+    IoTHubWorkerPool_Destroy(NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_WORKER_POOL_31_005: [ IoTHubWorkerPool_Destroy shall stop and join the threads of the pool and free it. ]*/
+/* Tests_SRS_IOTHUB_CLIENT_WORKER_POOL_31_014: [ The threads of the pool shall exit when IoTHubWorkerPool_Destroy is called. ]*/
+TEST_FUNCTION(IoTHubWorkerPool_Destroy_stops_and_joins_the_threads)
+{
+    // arrange
+    IOTHUB_WORKER_POOL_HANDLE pool = create_pool();
+
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Condition_Post(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Condition_Post(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(ThreadAPI_Join(TEST_THREAD_HANDLE, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(ThreadAPI_Join(TEST_THREAD_HANDLE, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(tickcounter_destroy(TEST_TICK_COUNTER));
+    STRICT_EXPECTED_CALL(Condition_Deinit(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Condition_Deinit(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Lock_Deinit(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    // act
+    IoTHubWorkerPool_Destroy(pool);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_WORKER_POOL_31_006: [ If pool or work is NULL, IoTHubWorkerPool_Add shall fail and return NULL. ]*/
+TEST_FUNCTION(IoTHubWorkerPool_Add_NULL_pool_fails)
+{
+    // act
+    IOTHUB_WORKER_POOL_ITEM_HANDLE item = IoTHubWorkerPool_Add(NULL, test_work, TEST_CONTEXT);
+
+    // assert
+    ASSERT_IS_NULL(item);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_WORKER_POOL_31_006: [ If pool or work is NULL, IoTHubWorkerPool_Add shall fail and return NULL. ]*/
+TEST_FUNCTION(IoTHubWorkerPool_Add_NULL_work_fails)
+{
+    // arrange
+    IOTHUB_WORKER_POOL_HANDLE pool = create_pool();
+
+    // act
+    IOTHUB_WORKER_POOL_ITEM_HANDLE item = IoTHubWorkerPool_Add(pool, NULL, TEST_CONTEXT);
+
+    // assert
+    ASSERT_IS_NULL(item);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubWorkerPool_Destroy(pool);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_WORKER_POOL_31_008: [ IoTHubWorkerPool_Add shall add an item running work with context to the pool, ready to run, and return its handle. ]*/
+TEST_FUNCTION(IoTHubWorkerPool_Add_succeeds)
+{
+    // arrange
+    IOTHUB_WORKER_POOL_HANDLE pool = create_pool();
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Condition_Post(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG));
+
+    // act
+    IOTHUB_WORKER_POOL_ITEM_HANDLE item = IoTHubWorkerPool_Add(pool, test_work, TEST_CONTEXT);
+
+    // assert
+    ASSERT_IS_NOT_NULL(item);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubWorkerPool_Remove(item);
+    IoTHubWorkerPool_Destroy(pool);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_WORKER_POOL_31_007: [ If allocating memory or taking the lock of the pool fails, IoTHubWorkerPool_Add shall fail and return NULL. ]*/
+TEST_FUNCTION(IoTHubWorkerPool_Add_Lock_fails)
+{
+    // arrange
+    IOTHUB_WORKER_POOL_HANDLE pool = create_pool();
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG)).SetReturn(LOCK_ERROR);
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    // act
+    IOTHUB_WORKER_POOL_ITEM_HANDLE item = IoTHubWorkerPool_Add(pool, test_work, TEST_CONTEXT);
+
+    // assert
+    ASSERT_IS_NULL(item);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubWorkerPool_Destroy(pool);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_WORKER_POOL_31_012: [ A thread of the pool shall take the item that became ready first, mark it as running and call its work function without holding the lock of the pool, so that an item never runs on two threads at the same time. ]*/
+TEST_FUNCTION(IoTHubWorkerPool_thread_runs_a_ready_item_without_the_lock)
+{
+    // arrange
+    IOTHUB_WORKER_POOL_HANDLE pool = create_pool();
+    IOTHUB_WORKER_POOL_ITEM_HANDLE item = IoTHubWorkerPool_Add(pool, test_work, TEST_CONTEXT);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_IsListEmpty(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG));
+
+    // act
+    run_pool_thread(1);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 1, g_work_runs);
+
+    // cleanup
+    destroy_pool_with_running_item(pool, item);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_WORKER_POOL_31_013: [ After it ran, an item shall be ready again if it was signaled while it ran or its work function returned 0, otherwise it shall wait for the number of milliseconds returned by its work function. ]*/
+TEST_FUNCTION(IoTHubWorkerPool_thread_runs_an_item_returning_0_again)
+{
+    // arrange
+    IOTHUB_WORKER_POOL_HANDLE pool = create_pool();
+    IOTHUB_WORKER_POOL_ITEM_HANDLE item = IoTHubWorkerPool_Add(pool, test_work, TEST_CONTEXT);
+    umock_c_reset_all_calls();
+
+    // act
+    run_pool_thread(3);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 3, g_work_runs);
+    ASSERT_ARE_EQUAL(int, 1000, (int)g_current_ms);
+
+    // cleanup
+    destroy_pool_with_running_item(pool, item);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_WORKER_POOL_31_011: [ A waiting item shall become ready when the delay returned by its last run elapsed. ]*/
+/* Tests_SRS_IOTHUB_CLIENT_WORKER_POOL_31_013: [ After it ran, an item shall be ready again if it was signaled while it ran or its work function returned 0, otherwise it shall wait for the number of milliseconds returned by its work function. ]*/
+TEST_FUNCTION(IoTHubWorkerPool_thread_waits_for_the_delay_returned_by_the_work)
+{
+    // arrange
+    IOTHUB_WORKER_POOL_HANDLE pool = create_pool();
+    IOTHUB_WORKER_POOL_ITEM_HANDLE item = IoTHubWorkerPool_Add(pool, test_work, TEST_CONTEXT);
+    g_work_delays[0] = 100;
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_IsListEmpty(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(TEST_TICK_COUNTER, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_InsertHeadList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Condition_Post(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_IsListEmpty(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_IsListEmpty(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(TEST_TICK_COUNTER, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Condition_Wait(IGNORED_PTR_ARG, IGNORED_PTR_ARG, 100));
+    STRICT_EXPECTED_CALL(DList_IsListEmpty(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_IsListEmpty(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(TEST_TICK_COUNTER, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveEntryList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG));
+
+    // act
+    run_pool_thread(2);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(size_t, 2, g_work_runs);
+
+    // cleanup
+    destroy_pool_with_running_item(pool, item);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_WORKER_POOL_31_018: [ When an item becomes the first waiting item, the threads of the pool waiting for work shall be woken up so that they wait for its due time instead. ]*/
+TEST_FUNCTION(IoTHubWorkerPool_thread_wakes_the_idle_threads_before_running_a_slow_item)
+{
+    // arrange
+    /*the other thread of the pool went to wait without timeout while there was no waiting item; the thread under test
+    makes the first item wait 100 ms, then runs the second one for 200 ms, during which the first one becomes due*/
+    IOTHUB_WORKER_POOL_HANDLE pool = create_pool();
+    IOTHUB_WORKER_POOL_ITEM_HANDLE item = IoTHubWorkerPool_Add(pool, test_work, TEST_CONTEXT);
+    IOTHUB_WORKER_POOL_ITEM_HANDLE slow_item = IoTHubWorkerPool_Add(pool, test_slow_work, TEST_CONTEXT);
+    g_work_delays[0] = 100;
+    g_work_signal_posts = 0;
+    umock_c_reset_all_calls();
+
+    // act
+    run_pool_thread(0);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 1, g_work_runs);
+    ASSERT_ARE_EQUAL(size_t, 1, g_work_signal_posts_seen_by_slow_work);
+
+    // cleanup
+    IoTHubWorkerPool_Remove(item);
+    destroy_pool_with_running_item(pool, slow_item);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_WORKER_POOL_31_018: [ When an item becomes the first waiting item, the threads of the pool waiting for work shall be woken up so that they wait for its due time instead. ]*/
+TEST_FUNCTION(IoTHubWorkerPool_thread_does_not_wake_the_idle_threads_for_an_item_waiting_after_another)
+{
+    // arrange
+    IOTHUB_WORKER_POOL_HANDLE pool = create_pool();
+    IOTHUB_WORKER_POOL_ITEM_HANDLE first_item = IoTHubWorkerPool_Add(pool, test_work, TEST_CONTEXT);
+    IOTHUB_WORKER_POOL_ITEM_HANDLE second_item = IoTHubWorkerPool_Add(pool, test_work, TEST_CONTEXT);
+    IOTHUB_WORKER_POOL_ITEM_HANDLE slow_item = IoTHubWorkerPool_Add(pool, test_slow_work, TEST_CONTEXT);
+    g_work_delays[0] = 100;
+    g_work_delays[1] = 100;
+    g_work_signal_posts = 0;
+    umock_c_reset_all_calls();
+
+    // act
+    run_pool_thread(0);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 2, g_work_runs);
+    ASSERT_ARE_EQUAL(size_t, 1, g_work_signal_posts_seen_by_slow_work);
+
+    // cleanup
+    IoTHubWorkerPool_Remove(first_item);
+    IoTHubWorkerPool_Remove(second_item);
+    destroy_pool_with_running_item(pool, slow_item);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_WORKER_POOL_31_010: [ IoTHubWorkerPool_Signal shall make a waiting item ready, and a running item ready again once it finished running. ]*/
+TEST_FUNCTION(IoTHubWorkerPool_Signal_makes_a_waiting_item_ready)
+{
+    // arrange
+    IOTHUB_WORKER_POOL_HANDLE pool = create_pool();
+    IOTHUB_WORKER_POOL_ITEM_HANDLE item = IoTHubWorkerPool_Add(pool, test_work, TEST_CONTEXT);
+    g_work_delays[0] = 60000;
+    g_item_to_signal_on_wait = item;
+    umock_c_reset_all_calls();
+
+    // act
+    run_pool_thread(2);
+
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 2, g_work_runs);
+    ASSERT_ARE_EQUAL(int, 1000, (int)g_current_ms);
+
+    // cleanup
+    destroy_pool_with_running_item(pool, item);
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_WORKER_POOL_31_009: [ If item is NULL, IoTHubWorkerPool_Signal shall do nothing. ]*/
+TEST_FUNCTION(IoTHubWorkerPool_Signal_NULL_does_nothing)
+{
+    // act
+    IoTHubWorkerPool_Signal(NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_WORKER_POOL_31_015: [ If item is NULL, IoTHubWorkerPool_Remove shall do nothing. ]*/
+TEST_FUNCTION(IoTHubWorkerPool_Remove_NULL_does_nothing)
+{
+    // act
+    IoTHubWorkerPool_Remove(NULL);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/* Tests_SRS_IOTHUB_CLIENT_WORKER_POOL_31_017: [ IoTHubWorkerPool_Remove shall take the item out of the pool and free it, its work function is not called anymore. ]*/
+TEST_FUNCTION(IoTHubWorkerPool_Remove_takes_the_item_out_of_the_pool)
+{
+    // arrange
+    IOTHUB_WORKER_POOL_HANDLE pool = create_pool();
+    IOTHUB_WORKER_POOL_ITEM_HANDLE item = IoTHubWorkerPool_Add(pool, test_work, TEST_CONTEXT);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(Lock(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveEntryList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(Unlock(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    // act
+    IoTHubWorkerPool_Remove(item);
+
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    // cleanup
+    IoTHubWorkerPool_Destroy(pool);
+}
+
+END_TEST_SUITE(iothub_client_worker_pool_ut)
@@ -53,6 +53,8 @@ void* my_gballoc_realloc(void* ptr, size_t size)
 #include "iothub_client_ll.h"
 #include "iothub_client_private.h"
 #include "iothub_client_options.h"
+#include "iothub_client_compression.h"
+#include "iothub_client_congestion_control.h"
 
 #define ENABLE_MOCKS
 
@@ -60,6 +62,10 @@ void* my_gballoc_realloc(void* ptr, size_t size)
 #include "iothub_client_ll_uploadtoblob.h"
 #endif
 
+#ifndef DONT_USE_JOURNAL
+#include "iothub_client_journal.h"
+#endif
+
 MOCKABLE_FUNCTION(, void, test_event_confirmation_callback, IOTHUB_CLIENT_CONFIRMATION_RESULT, result, void*, userContextCallback);
 MOCKABLE_FUNCTION(, IOTHUBMESSAGE_DISPOSITION_RESULT, test_message_callback_async, IOTHUB_MESSAGE_HANDLE, message, void*, userContextCallback);
 MOCKABLE_FUNCTION(, void, iothub_reported_state_callback, int, status_code, void*, userContextCallback);
@@ -78,6 +84,8 @@ MOCKABLE_FUNCTION(, void, FAKE_IoTHubTransport_Unsubscribe, IOTHUB_DEVICE_HANDLE
 MOCKABLE_FUNCTION(, void, FAKE_IoTHubTransport_DoWork, TRANSPORT_LL_HANDLE, handle, IOTHUB_CLIENT_LL_HANDLE, iotHubClientHandle);
 MOCKABLE_FUNCTION(, int, FAKE_IoTHubTransport_SetRetryPolicy, TRANSPORT_LL_HANDLE, handle, IOTHUB_CLIENT_RETRY_POLICY, retryPolicy, size_t, retryTimeoutLimitInSeconds);
 MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, FAKE_IoTHubTransport_GetSendStatus, IOTHUB_DEVICE_HANDLE, handle, IOTHUB_CLIENT_STATUS*, iotHubClientStatus);
+MOCKABLE_FUNCTION(, int, FAKE_IoTHubTransport_GetNextDeadline, TRANSPORT_LL_HANDLE, handle, tickcounter_ms_t*, msUntilDeadline);
+MOCKABLE_FUNCTION(, int, FAKE_IoTHubTransport_GetStatistics, TRANSPORT_LL_HANDLE, handle, IOTHUB_CLIENT_STATISTICS*, statistics);
 MOCKABLE_FUNCTION(, int, FAKE_IoTHubTransport_Subscribe_DeviceTwin, IOTHUB_DEVICE_HANDLE, handle);
 MOCKABLE_FUNCTION(, void, FAKE_IoTHubTransport_Unsubscribe_DeviceTwin, IOTHUB_DEVICE_HANDLE, handle);
 MOCKABLE_FUNCTION(, IOTHUB_CLIENT_RESULT, FAKE_IoTHubTransport_SendMessageDisposition, MESSAGE_CALLBACK_INFO*, messageData, IOTHUBMESSAGE_DISPOSITION_RESULT, disposition);
@@ -86,6 +94,8 @@ MOCKABLE_FUNCTION(, IOTHUB_PROCESS_ITEM_RESULT, FAKE_IoTHubTransport_ProcessItem
 MOCKABLE_FUNCTION(, int, FAKE_IoTHubTransport_Subscribe_DeviceMethod, IOTHUB_DEVICE_HANDLE, handle);
 MOCKABLE_FUNCTION(, void, FAKE_IoTHubTransport_Unsubscribe_DeviceMethod, IOTHUB_DEVICE_HANDLE, handle);
 MOCKABLE_FUNCTION(, void, connectionStatusCallback, IOTHUB_CLIENT_CONNECTION_STATUS, result3, IOTHUB_CLIENT_CONNECTION_STATUS_REASON, reason, void*, userContextCallback);
+MOCKABLE_FUNCTION(, void, outboundQueueCallback, IOTHUB_CLIENT_OUTBOUND_QUEUE_STATE, state, void*, userContextCallback);
+MOCKABLE_FUNCTION(, int, test_compress, const unsigned char*, source, size_t, size, unsigned char*, destination, size_t*, destinationSize);
 MOCKABLE_FUNCTION(, IOTHUBMESSAGE_DISPOSITION_RESULT, messageCallback, IOTHUB_MESSAGE_HANDLE, message, void*, userContextCallback);
 MOCKABLE_FUNCTION(, bool, messageCallbackEx, MESSAGE_CALLBACK_INFO*, messageData, void*, userContextCallback);
 MOCKABLE_FUNCTION(, void, eventConfirmationCallback, IOTHUB_CLIENT_CONFIRMATION_RESULT, result2, void*, userContextCallback);
@@ -147,6 +157,11 @@ static const char* TEST_STRING_VALUE = "Test string value";
 
 #define TEST_DEVICEMESSAGE_HANDLE (IOTHUB_MESSAGE_HANDLE)0x52
 #define TEST_DEVICEMESSAGE_HANDLE_2 (IOTHUB_MESSAGE_HANDLE)0x53
+#define TEST_LOW_PRIORITY_MESSAGE_HANDLE (IOTHUB_MESSAGE_HANDLE)0x54
+#define TEST_MESSAGE_SIZE 8
+#define TEST_COMPRESSED_MESSAGE_HANDLE (IOTHUB_MESSAGE_HANDLE)0x55
+#define TEST_COMPRESSED_SIZE 5
+#define TEST_CONTENT_ENCODING "test-encoding"
 #define TEST_IOTHUB_CLIENT_LL_HANDLE    (IOTHUB_CLIENT_LL_HANDLE)0x4242
 
 #define TEST_STRING_HANDLE (STRING_HANDLE)0x46
@@ -164,6 +179,8 @@ static const char* TEST_STRING_VALUE = "Test string value";
 #define TEST_RETRY_TIMEOUT_SECS             60
 
 #define TEST_METHOD_ID                      (METHOD_HANDLE)0x61
+#define TEST_JOURNAL_HANDLE                 (JOURNAL_HANDLE)0x71
+#define TEST_JOURNAL_DIRECTORY              "theJournalDirectory"
 
 static const char* TEST_METHOD_NAME = "method_name";
 static const char* TEST_CHAR = "TestChar";
@@ -332,6 +349,49 @@ static void my_tickcounter_destroy(TICK_COUNTER_HANDLE tick_counter)
     my_gballoc_free(tick_counter);
 }
 
+static IOTHUB_MESSAGE_PRIORITY my_IoTHubMessage_GetPriority(IOTHUB_MESSAGE_HANDLE iotHubMessageHandle)
+{
+    return (iotHubMessageHandle == TEST_LOW_PRIORITY_MESSAGE_HANDLE) ? IOTHUB_MESSAGE_PRIORITY_LOW : IOTHUB_MESSAGE_PRIORITY_NORMAL;
+}
+
+static IOTHUB_MESSAGE_RESULT my_IoTHubMessage_GetByteArray(IOTHUB_MESSAGE_HANDLE iotHubMessageHandle, const unsigned char** buffer, size_t* size)
+{
+    (void)iotHubMessageHandle;
+    *buffer = NULL;
+    *size = TEST_MESSAGE_SIZE;
+    return IOTHUB_MESSAGE_OK;
+}
+
+static int my_test_compress(const unsigned char* source, size_t size, unsigned char* destination, size_t* destinationSize)
+{
+    (void)source;
+    (void)size;
+    (void)destination;
+    *destinationSize = TEST_COMPRESSED_SIZE;
+    return 0;
+}
+
+static bool g_message_is_encoded;
+
+static MAP_RESULT my_Map_ContainsKey(MAP_HANDLE handle, const char* key, bool* keyExists)
+{
+    (void)handle;
+    (void)key;
+    *keyExists = g_message_is_encoded;
+    return MAP_OK;
+}
+
+static MAP_RESULT my_Map_GetInternals(MAP_HANDLE handle, const char*const** keys, const char*const** values, size_t* count)
+{
+    (void)handle;
+    *keys = NULL;
+    *values = NULL;
+    *count = 0;
+    return MAP_OK;
+}
+
+static const IOTHUB_CLIENT_COMPRESSION_CODEC TEST_CODEC = { TEST_CONTENT_ENCODING, test_compress };
+
 static CONSTBUFFER_HANDLE my_CONSTBUFFER_Create(const unsigned char* source, size_t size)
 {
     (void)source;
@@ -355,12 +415,29 @@ static void my_IoTHubClient_LL_UploadToBlob_Destroy(IOTHUB_CLIENT_LL_UPLOADTOBLO
     my_gballoc_free(handle);
 }
 
+static PDLIST_ENTRY g_waitingToSend;
+static size_t g_messages_seen_by_transport_DoWork;
+static size_t g_transport_DoWork_calls;
+
+static void my_FAKE_IoTHubTransport_DoWork(TRANSPORT_LL_HANDLE handle, IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle)
+{
+    PDLIST_ENTRY entry;
+    (void)handle;
+    (void)iotHubClientHandle;
+    g_transport_DoWork_calls++;
+    g_messages_seen_by_transport_DoWork = 0;
+    for (entry = g_waitingToSend->Flink; entry != g_waitingToSend; entry = entry->Flink)
+    {
+        g_messages_seen_by_transport_DoWork++;
+    }
+}
+
 static IOTHUB_DEVICE_HANDLE my_FAKE_IoTHubTransport_Register(TRANSPORT_LL_HANDLE handle, const IOTHUB_DEVICE_CONFIG* device, IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle, PDLIST_ENTRY waitingToSend)
 {
     (void)handle;
     (void)device;
     (void)iotHubClientHandle;
-    (void)waitingToSend;
+    g_waitingToSend = waitingToSend;
     return (IOTHUB_DEVICE_HANDLE)my_gballoc_malloc(1);
 }
 
@@ -369,6 +446,21 @@ static void my_FAKE_IoTHubTransport_Unregister(IOTHUB_DEVICE_HANDLE deviceHandle
     my_gballoc_free(deviceHandle);
 }
 
+#define TEST_TRANSPORT_IN_FLIGHT 1
+#define TEST_TRANSPORT_RETRIES 2
+#define TEST_TRANSPORT_RECONNECTS 3
+
+static size_t g_transport_in_flight;
+
+static int my_FAKE_IoTHubTransport_GetStatistics(TRANSPORT_LL_HANDLE handle, IOTHUB_CLIENT_STATISTICS* statistics)
+{
+    (void)handle;
+    statistics->in_flight = g_transport_in_flight;
+    statistics->retries = TEST_TRANSPORT_RETRIES;
+    statistics->reconnects = TEST_TRANSPORT_RECONNECTS;
+    return 0;
+}
+
 static IOTHUB_CLIENT_RESULT my_FAKE_IoTHubTransport_GetSendStatus(TRANSPORT_LL_HANDLE handle, IOTHUB_CLIENT_STATUS* iotHubClientStatus)
 {
     (void)handle;
@@ -433,7 +525,9 @@ static TRANSPORT_PROVIDER FAKE_transport_provider =
     FAKE_IoTHubTransport_Unsubscribe,   /*pfIoTHubTransport_Unsubscribe IoTHubTransport_Unsubscribe;    */
     FAKE_IoTHubTransport_DoWork,        /*pfIoTHubTransport_DoWork IoTHubTransport_DoWork;              */
     FAKE_IoTHubTransport_SetRetryPolicy,/*pfIoTHubTransport_SetRetryPolicy IoTHubTransport_SetRetryPolicy;*/
-    FAKE_IoTHubTransport_GetSendStatus  /*pfIoTHubTransport_GetSendStatus IoTHubTransport_GetSendStatus;*/
+    FAKE_IoTHubTransport_GetSendStatus, /*pfIoTHubTransport_GetSendStatus IoTHubTransport_GetSendStatus;*/
+    FAKE_IoTHubTransport_GetNextDeadline, /*pfIoTHubTransport_GetNextDeadline IoTHubTransport_GetNextDeadline;*/
+    FAKE_IoTHubTransport_GetStatistics  /*pfIoTHubTransport_GetStatistics IoTHubTransport_GetStatistics;*/
 };
 
 static const TRANSPORT_PROVIDER* provideFAKE(void)
@@ -527,11 +621,23 @@ TEST_SUITE_INITIALIZE(suite_init)
     REGISTER_UMOCK_ALIAS_TYPE(IOTHUB_CLIENT_CONNECTION_STATUS, int);
     REGISTER_UMOCK_ALIAS_TYPE(IOTHUB_CLIENT_CONNECTION_STATUS_REASON, int);
     REGISTER_UMOCK_ALIAS_TYPE(IOTHUB_CLIENT_RETRY_POLICY, int);
+    REGISTER_UMOCK_ALIAS_TYPE(IOTHUB_CLIENT_OUTBOUND_QUEUE_STATE, int);
+    REGISTER_UMOCK_ALIAS_TYPE(IOTHUB_MESSAGE_PRIORITY, int);
+    REGISTER_UMOCK_ALIAS_TYPE(time_t, int64_t);
+    REGISTER_UMOCK_ALIAS_TYPE(IOTHUB_MESSAGE_RESULT, int);
+    REGISTER_UMOCK_ALIAS_TYPE(IOTHUBMESSAGE_CONTENT_TYPE, int);
+    REGISTER_UMOCK_ALIAS_TYPE(MAP_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(MAP_RESULT, int);
 
 #ifndef DONT_USE_UPLOADTOBLOB
     REGISTER_UMOCK_ALIAS_TYPE(IOTHUB_CLIENT_LL_UPLOADTOBLOB_HANDLE, void*);
 #endif // DONT_USE_UPLOADTOBLOB
 
+#ifndef DONT_USE_JOURNAL
+    REGISTER_UMOCK_ALIAS_TYPE(JOURNAL_HANDLE, void*);
+    REGISTER_UMOCK_ALIAS_TYPE(JOURNAL_REPLAY_CALLBACK, void*);
+#endif // DONT_USE_JOURNAL
+
     REGISTER_GLOBAL_MOCK_RETURN(IoTHubClient_GetVersionString, "version 1.0");
 
     REGISTER_GLOBAL_MOCK_RETURN(FAKE_IoTHubTransport_Subscribe_DeviceTwin, 0);
@@ -555,6 +661,11 @@ TEST_SUITE_INITIALIZE(suite_init)
     REGISTER_GLOBAL_MOCK_FAIL_RETURN(FAKE_IoTHubTransport_SetRetryPolicy, __FAILURE__);
     REGISTER_GLOBAL_MOCK_HOOK(FAKE_IoTHubTransport_GetSendStatus, my_FAKE_IoTHubTransport_GetSendStatus);
     REGISTER_GLOBAL_MOCK_FAIL_RETURN(FAKE_IoTHubTransport_GetSendStatus, IOTHUB_CLIENT_ERROR);
+    REGISTER_GLOBAL_MOCK_RETURN(FAKE_IoTHubTransport_GetNextDeadline, 0);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(FAKE_IoTHubTransport_GetNextDeadline, __FAILURE__);
+    REGISTER_GLOBAL_MOCK_HOOK(FAKE_IoTHubTransport_GetStatistics, my_FAKE_IoTHubTransport_GetStatistics);
+    REGISTER_GLOBAL_MOCK_HOOK(FAKE_IoTHubTransport_DoWork, my_FAKE_IoTHubTransport_DoWork);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(FAKE_IoTHubTransport_GetStatistics, __FAILURE__);
     REGISTER_GLOBAL_MOCK_RETURN(FAKE_IoTHubTransport_Subscribe_DeviceMethod, 0);
 
     REGISTER_GLOBAL_MOCK_FAIL_RETURN(FAKE_IoTHubTransport_Subscribe_DeviceMethod, __FAILURE__);
@@ -577,12 +688,20 @@ TEST_SUITE_INITIALIZE(suite_init)
     REGISTER_GLOBAL_MOCK_RETURN(IoTHubMessage_CreateFromString, (IOTHUB_MESSAGE_HANDLE)0x44);
     REGISTER_GLOBAL_MOCK_RETURN(IoTHubMessage_Clone, (IOTHUB_MESSAGE_HANDLE)0x44);
     REGISTER_GLOBAL_MOCK_FAIL_RETURN(IoTHubMessage_Clone, NULL);
+    REGISTER_GLOBAL_MOCK_HOOK(IoTHubMessage_GetPriority, my_IoTHubMessage_GetPriority);
+    REGISTER_GLOBAL_MOCK_RETURN(IoTHubMessage_GetContentType, IOTHUBMESSAGE_BYTEARRAY);
+    REGISTER_GLOBAL_MOCK_HOOK(IoTHubMessage_GetByteArray, my_IoTHubMessage_GetByteArray);
+    REGISTER_GLOBAL_MOCK_HOOK(test_compress, my_test_compress);
+    REGISTER_GLOBAL_MOCK_HOOK(Map_ContainsKey, my_Map_ContainsKey);
+    REGISTER_GLOBAL_MOCK_HOOK(Map_GetInternals, my_Map_GetInternals);
 
     REGISTER_GLOBAL_MOCK_RETURN(get_time, (time_t)TEST_TIME_VALUE);
 
     REGISTER_GLOBAL_MOCK_HOOK(gballoc_malloc, my_gballoc_malloc);
     REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_malloc, NULL);
     REGISTER_GLOBAL_MOCK_HOOK(gballoc_free, my_gballoc_free);
+    REGISTER_GLOBAL_MOCK_HOOK(gballoc_realloc, my_gballoc_realloc);
+    REGISTER_GLOBAL_MOCK_FAIL_RETURN(gballoc_realloc, NULL);
 
     REGISTER_GLOBAL_MOCK_HOOK(STRING_new, my_STRING_new);
     REGISTER_GLOBAL_MOCK_FAIL_RETURN(STRING_new, NULL);
@@ -649,6 +768,9 @@ TEST_FUNCTION_INITIALIZE(method_init)
     g_fail_string_construct_sprintf = false;
     g_fail_platform_get_platform_info = false;
     g_fail_string_concat_with_string = false;
+    g_message_is_encoded = false;
+    g_transport_in_flight = TEST_TRANSPORT_IN_FLIGHT;
+    g_transport_DoWork_calls = 0;
 }
 
 TEST_FUNCTION_CLEANUP(TestMethodCleanup)
@@ -693,6 +815,7 @@ static void setup_iothubclient_ll_create_mocks(bool use_device_config)
     STRICT_EXPECTED_CALL(IoTHubClient_LL_UploadToBlob_Create(IGNORED_PTR_ARG));
 #endif /*DONT_USE_UPLOADTOBLOB*/
     STRICT_EXPECTED_CALL(tickcounter_create());
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG)); /*the message timeout queue*/
     STRICT_EXPECTED_CALL(DList_InitializeListHead(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
     STRICT_EXPECTED_CALL(DList_InitializeListHead(IGNORED_PTR_ARG))
@@ -822,7 +945,7 @@ TEST_FUNCTION(IoTHubClient_LL_CreateFromConnectionString_with_DeviceKey_fail)
     umock_c_negative_tests_snapshot();
 
     // act
-    size_t calls_cannot_fail[] = { 0, 10, 16, 19, 24, 27, 29, 30, 36, 37, 38, 41, 42, 43, 44, 45, 46, 47, 48, 49 };
+    size_t calls_cannot_fail[] = { 0, 10, 16, 19, 24, 27, 29, 30, 37, 38, 39, 42, 43, 44, 45, 46, 47, 48, 49, 50 };
     size_t count = umock_c_negative_tests_call_count();
     for (size_t index = 0; index < count; index++)
     {
@@ -1219,7 +1342,7 @@ TEST_FUNCTION(IoTHubClient_LL_Create_fail)
     umock_c_negative_tests_snapshot();
 
     // act
-    size_t calls_cannot_fail[] = { 1, 2, 8, 9, 10 };
+    size_t calls_cannot_fail[] = { 1, 2, 9, 10, 11 };
     size_t count = umock_c_negative_tests_call_count();
     for (size_t index = 0; index < count; index++)
     {
@@ -1324,7 +1447,7 @@ TEST_FUNCTION(IoTHubClient_LL_CreateWithTransport_fail)
     umock_c_negative_tests_snapshot();
 
     // act
-    size_t calls_cannot_fail[] = { 1, 2, 6, 10, 11, 12, 15 };
+    size_t calls_cannot_fail[] = { 1, 2, 6, 11, 12, 13, 16 };
 
     size_t count = umock_c_negative_tests_call_count();
     for (size_t index = 0; index < count; index++)
@@ -1383,6 +1506,7 @@ TEST_FUNCTION(IoTHubClient_LL_Destroys_the_underlying_transport_succeeds)
 
     STRICT_EXPECTED_CALL(IoTHubClient_Auth_Destroy(IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)); /*the message timeout queue*/
     STRICT_EXPECTED_CALL(tickcounter_destroy(IGNORED_PTR_ARG));
 
 #ifndef DONT_USE_UPLOADTOBLOB
@@ -1417,6 +1541,7 @@ TEST_FUNCTION(IoTHubClient_LL_Destroys_unregisters_but_does_not_destroy_transpor
 
     STRICT_EXPECTED_CALL(IoTHubClient_Auth_Destroy(IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)); /*the message timeout queue*/
     STRICT_EXPECTED_CALL(tickcounter_destroy(IGNORED_PTR_ARG));
 
 #ifndef DONT_USE_UPLOADTOBLOB
@@ -1499,6 +1624,9 @@ TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_succeeds)
     STRICT_EXPECTED_CALL(IoTHubMessage_Clone(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
 
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetExpiryTime(TEST_MESSAGE_HANDLE));
+
     STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreArgument(1)
         .IgnoreArgument(2);
@@ -1540,6 +1668,7 @@ TEST_FUNCTION(IoTHubClient_LL_Destroy_after_sendEvent_succeeds)
 
     STRICT_EXPECTED_CALL(IoTHubClient_Auth_Destroy(IGNORED_PTR_ARG));
     STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)); /*the message timeout queue*/
     STRICT_EXPECTED_CALL(tickcounter_destroy(IGNORED_PTR_ARG));
 
 #ifndef DONT_USE_UPLOADTOBLOB
@@ -1578,6 +1707,11 @@ TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_fails)
     STRICT_EXPECTED_CALL(IoTHubMessage_Clone(IGNORED_PTR_ARG))
         .IgnoreArgument(1);
 
+    STRICT_EXPECTED_CALL(gballoc_realloc(IGNORED_PTR_ARG, IGNORED_NUM_ARG)); /*the message timeout queue grows on the first timed message*/
+
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetExpiryTime(TEST_MESSAGE_HANDLE));
+
     STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreArgument(1)
         .IgnoreArgument(2);
@@ -1585,7 +1719,7 @@ TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_fails)
     umock_c_negative_tests_snapshot();
 
     // act
-    size_t calls_cannot_fail[] = { 3 };
+    size_t calls_cannot_fail[] = { 4, 5, 6 };
     size_t count = umock_c_negative_tests_call_count();
     for (size_t index = 0; index < count; index++)
     {
@@ -1611,1236 +1745,3471 @@ TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_fails)
     umock_c_negative_tests_deinit();
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_25_111: [IoTHubClient_LL_SetConnectionStatusCallback shall return IOTHUB_CLIENT_INVALID_ARG if called with NULL parameter iotHubClientHandle]*/
-TEST_FUNCTION(IoTHubClient_LL_SetConnectionStatusCallback_with_NULL_iotHubClientHandle_fails)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_012: [ IoTHubClient_LL_SendEventAsync_Move shall fail and return IOTHUB_CLIENT_INVALID_ARG if iotHubClientHandle or eventMessageHandle is NULL, or if eventConfirmationCallback is NULL and userContextCallback is not NULL. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_Move_with_NULL_iotHubClientHandle_fails)
 {
-    ///arrange
+    //arrange
 
-    ///act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetConnectionStatusCallback(NULL, connectionStatusCallback, (void*)1);
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventAsync_Move(NULL, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)3);
 
-    ///assert
+    //assert
     ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_25_112: [IoTHubClient_LL_SetConnectionStatusCallback shall return IOTHUB_CLIENT_OK and save the callback and userContext as a member of the handle.]*/
-TEST_FUNCTION(IoTHubClient_LL_SetConnectionStatusCallback_with_non_NULL_succeeds)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_012: [ IoTHubClient_LL_SendEventAsync_Move shall fail and return IOTHUB_CLIENT_INVALID_ARG if iotHubClientHandle or eventMessageHandle is NULL, or if eventConfirmationCallback is NULL and userContextCallback is not NULL. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_Move_with_NULL_test_event_confirmation_callback_and_non_NULL_context_fails)
 {
-    ///arrange
-
+    //arrange
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
     umock_c_reset_all_calls();
 
-    ///act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetConnectionStatusCallback(handle, connectionStatusCallback, (void*)1);
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventAsync_Move(handle, TEST_MESSAGE_HANDLE, NULL, (void*)3);
 
-    ///assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-    ///cleanup
+    //cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_02_016: [IoTHubClient_LL_SetMessageCallback shall fail and return IOTHUB_CLIENT_INVALID_ARG if parameter iotHubClientHandle is NULL.]*/
-TEST_FUNCTION(IoTHubClient_LL_SetMessageCallback_with_NULL_iotHubClientHandle_fails)
-{
-    ///arrange
-
-    ///act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetMessageCallback(NULL, messageCallback, (void*)1);
-
-    ///assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
-    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
-}
-
-/*Tests_SRS_IOTHUBCLIENT_LL_02_019: [If parameter messageCallback is NULL then IoTHubClient_LL_SetMessageCallback shall call the underlying layer's _Unsubscribe function and return IOTHUB_CLIENT_OK.] */
-TEST_FUNCTION(IoTHubClient_LL_SetMessageCallback_with_NULL_calls_Unsubscribe_and_succeeds)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_013: [ IoTHubClient_LL_SendEventAsync_Move shall add to the DLIST waitingToSend a new record holding eventMessageHandle itself, without cloning it. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_31_015: [ Otherwise IoTHubClient_LL_SendEventAsync_Move shall return IOTHUB_CLIENT_OK and the message shall be destroyed by IoTHubClient_LL once it is completed, the same way a clone made by IoTHubClient_LL_SendEventAsync is. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_Move_succeeds_without_cloning)
 {
-    ///arrange
+    //arrange
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    (void)IoTHubClient_LL_SetMessageCallback(handle, test_message_callback_async, (void*)1);
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Unsubscribe(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetExpiryTime(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
 
-    ///act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetMessageCallback(handle, NULL, (void*)1);
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventAsync_Move(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
 
-    ///assert
+    //assert
     ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-    ///cleanup
+    //cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_10_010: [If parameter messageCallback is NULL and the _SetMessageCallback had not been called to subscribe for messages, then IoTHubClient_LL_SetMessageCallback shall fail and return IOTHUB_CLIENT_ERROR.] */
-TEST_FUNCTION(IoTHubClient_LL_SetMessageCallback_with_NULL_after_SetMessageCallbacEx_fails)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_015: [ Otherwise IoTHubClient_LL_SendEventAsync_Move shall return IOTHUB_CLIENT_OK and the message shall be destroyed by IoTHubClient_LL once it is completed, the same way a clone made by IoTHubClient_LL_SendEventAsync is. ]*/
+TEST_FUNCTION(IoTHubClient_LL_Destroy_after_SendEventAsync_Move_destroys_the_message)
 {
-    ///arrange
+    //arrange
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    (void)IoTHubClient_LL_SetMessageCallback_Ex(handle, messageCallbackEx, (void*)1);
+    (void)IoTHubClient_LL_SendEventAsync_Move(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
     umock_c_reset_all_calls();
 
-    ///act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetMessageCallback(handle, NULL, (void*)1);
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Unregister(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Destroy(IGNORED_PTR_ARG));
 
-    ///assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
-    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG)); /*because there is one item in the list*/
+    STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_BECAUSE_DESTROY, (void*)1));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy(TEST_MESSAGE_HANDLE)); /*the moved message itself*/
 
-    ///cleanup
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)); /*IOTHUBMESSAGE*/
+
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
+
+    STRICT_EXPECTED_CALL(IoTHubClient_Auth_Destroy(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)); /*the message timeout queue*/
+    STRICT_EXPECTED_CALL(tickcounter_destroy(IGNORED_PTR_ARG));
+
+#ifndef DONT_USE_UPLOADTOBLOB
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_UploadToBlob_Destroy(IGNORED_PTR_ARG));
+#endif
+
+    STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    //act
     IoTHubClient_LL_Destroy(handle);
+
+    //assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 }
 
-/* Tests_SRS_IOTHUBCLIENT_LL_10_011: [If parameter messageCallback is non-NULL and the _SetMessageCallback_Ex had been used to susbscribe for messages, then IoTHubClient_LL_SetMessageCallback shall fail and return IOTHUB_CLIENT_ERROR.] */
-TEST_FUNCTION(IoTHubClient_LL_SetMessageCallback_after_SetMessageCallbacEx_fails)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_014: [ If adding the record fails, IoTHubClient_LL_SendEventAsync_Move shall return IOTHUB_CLIENT_ERROR and the caller keeps ownership of eventMessageHandle. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_Move_fails_and_does_not_destroy_the_message)
 {
-    ///arrange
+    //arrange
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    (void)IoTHubClient_LL_SetMessageCallback_Ex(handle, messageCallbackEx, (void*)1);
     umock_c_reset_all_calls();
 
-    ///act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetMessageCallback(handle, messageCallback, (void*)1);
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .SetReturn(NULL);
 
-    ///assert
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventAsync_Move(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+
+    //assert
     ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-    ///cleanup
+    //cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_10_021: [IoTHubClient_LL_SetMessageCallback_Ex shall fail and return IOTHUB_CLIENT_INVALID_ARG if parameter iotHubClientHandle is NULL.] */
-TEST_FUNCTION(IoTHubClient_LL_SetMessageCallback_Ex_with_NULL_iotHubClientHandle_fails)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_025: [ IoTHubClient_LL_SendEventBatchAsync shall fail and return IOTHUB_CLIENT_INVALID_ARG if iotHubClientHandle or eventMessageHandles is NULL, if messageCount is 0, or if eventConfirmationCallback is NULL and userContextCallback is not NULL. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventBatchAsync_with_NULL_iotHubClientHandle_fails)
 {
-    ///arrange
+    //arrange
+    IOTHUB_MESSAGE_HANDLE messages[] = { TEST_MESSAGE_HANDLE, TEST_MESSAGE_HANDLE };
 
-    ///act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetMessageCallback_Ex(NULL, messageCallbackEx, (void*)1);
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventBatchAsync(NULL, messages, 2, test_event_confirmation_callback, (void*)3);
 
-    ///assert
+    //assert
     ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_10_018: [If parameter messageCallback is NULL and IoTHubClient_LL_SetMessageCallback_Ex had not been used to subscribe for messages, then IoTHubClient_LL_SetMessageCallback_Ex shall fail and return IOTHUB_CLIENT_ERROR.] */
-TEST_FUNCTION(IoTHubClient_LL_SetMessageCallback_Ex_with_NULL_not_subscribed_fails)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_025: [ IoTHubClient_LL_SendEventBatchAsync shall fail and return IOTHUB_CLIENT_INVALID_ARG if iotHubClientHandle or eventMessageHandles is NULL, if messageCount is 0, or if eventConfirmationCallback is NULL and userContextCallback is not NULL. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventBatchAsync_with_NULL_eventMessageHandles_fails)
 {
-    ///arrange
+    //arrange
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
     umock_c_reset_all_calls();
 
-    ///act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetMessageCallback_Ex(handle, NULL, (void*)1);
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventBatchAsync(handle, NULL, 2, test_event_confirmation_callback, (void*)3);
 
-    ///assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-    ///cleanup
+    //cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_10_019: [If parameter messageCallback is NULL and IoTHubClient_LL_SetMessageCallback had been used to subscribe for messages, then IoTHubClient_LL_SetMessageCallback_Ex shall fail and return IOTHUB_CLIENT_ERROR.] */
-TEST_FUNCTION(IoTHubClient_LL_SetMessageCallback_Ex_with_NULL_after_SetMessageCallback_fails)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_025: [ IoTHubClient_LL_SendEventBatchAsync shall fail and return IOTHUB_CLIENT_INVALID_ARG if iotHubClientHandle or eventMessageHandles is NULL, if messageCount is 0, or if eventConfirmationCallback is NULL and userContextCallback is not NULL. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventBatchAsync_with_0_messageCount_fails)
 {
-    ///arrange
+    //arrange
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    (void)IoTHubClient_LL_SetMessageCallback(handle, messageCallback, (void*)1);
+    IOTHUB_MESSAGE_HANDLE messages[] = { TEST_MESSAGE_HANDLE };
     umock_c_reset_all_calls();
 
-    ///act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetMessageCallback_Ex(handle, NULL, (void*)1);
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventBatchAsync(handle, messages, 0, test_event_confirmation_callback, (void*)3);
 
-    ///assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-    ///cleanup
+    //cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_10_023: [If parameter messageCallback is NULL then IoTHubClient_LL_SetMessageCallback_Ex shall call the underlying layer's _Unsubscribe function and return IOTHUB_CLIENT_OK.] */
-TEST_FUNCTION(IoTHubClient_LL_SetMessageCallback_Ex_with_NULL_unsubscribe_succeeds)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_025: [ IoTHubClient_LL_SendEventBatchAsync shall fail and return IOTHUB_CLIENT_INVALID_ARG if iotHubClientHandle or eventMessageHandles is NULL, if messageCount is 0, or if eventConfirmationCallback is NULL and userContextCallback is not NULL. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventBatchAsync_with_NULL_test_event_confirmation_callback_and_non_NULL_context_fails)
 {
-    ///arrange
+    //arrange
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    (void)IoTHubClient_LL_SetMessageCallback_Ex(handle, messageCallbackEx, (void*)1);
+    IOTHUB_MESSAGE_HANDLE messages[] = { TEST_MESSAGE_HANDLE };
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Unsubscribe(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-
-    ///act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetMessageCallback_Ex(handle, NULL, (void*)1);
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventBatchAsync(handle, messages, 1, NULL, (void*)3);
 
-    ///assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-    ///cleanup
+    //cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_10_025: [If the underlying layer's _Subscribe function fails, then IoTHubClient_LL_SetMessageCallback_Ex shall fail and return IOTHUB_CLIENT_ERROR. Otherwise IoTHubClient_LL_SetMessageCallback shall succeed and return IOTHUB_CLIENT_OK.] */
-TEST_FUNCTION(IoTHubClient_LL_SetMessageCallback_Ex_Subscribe_fails)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_026: [ If any of the messageCount handles in eventMessageHandles is NULL, IoTHubClient_LL_SendEventBatchAsync shall fail and return IOTHUB_CLIENT_INVALID_ARG without queueing any message. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventBatchAsync_with_a_NULL_message_fails_without_queueing)
 {
-    ///arrange
+    //arrange
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_MESSAGE_HANDLE messages[] = { TEST_MESSAGE_HANDLE, TEST_MESSAGE_HANDLE, NULL };
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Subscribe(IGNORED_PTR_ARG))
-        .IgnoreArgument_handle()
-        .SetReturn(__LINE__);
-
-    ///act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetMessageCallback_Ex(handle, messageCallbackEx, (void*)1);
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventBatchAsync(handle, messages, 3, test_event_confirmation_callback, (void*)1);
 
-    ///assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-    ///cleanup
+    //cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_10_020: [If parameter messageCallback is non-NULL, and IoTHubClient_LL_SetMessageCallback had been used to subscribe for messages, then IoTHubClient_LL_SetMessageCallback_Ex shall fail and return IOTHUB_CLIENT_ERROR.] */
-TEST_FUNCTION(IoTHubClient_LL_SetMessageCallback_Ex_after_SetMessageCallback_fails)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_028: [ IoTHubClient_LL_SendEventBatchAsync shall add to the DLIST waitingToSend, in the order of eventMessageHandles, one record per message cloning the message and holding eventConfirmationCallback and userContextCallback, the same way IoTHubClient_LL_SendEventAsync does. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_31_030: [ Otherwise IoTHubClient_LL_SendEventBatchAsync shall return IOTHUB_CLIENT_OK, eventConfirmationCallback is then called once for every message of the batch. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventBatchAsync_succeeds)
 {
-    ///arrange
+    //arrange
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    (void)IoTHubClient_LL_SetMessageCallback(handle, messageCallback, (void*)1);
+    IOTHUB_MESSAGE_HANDLE messages[] = { (IOTHUB_MESSAGE_HANDLE)0x61, (IOTHUB_MESSAGE_HANDLE)0x62, (IOTHUB_MESSAGE_HANDLE)0x63 };
+    size_t index;
     umock_c_reset_all_calls();
 
-    ///act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetMessageCallback_Ex(handle, messageCallbackEx, (void*)1);
+    for (index = 0; index < 3; index++)
+    {
+        STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+        STRICT_EXPECTED_CALL(IoTHubMessage_Clone(messages[index]));
+        STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(messages[index]));
+        STRICT_EXPECTED_CALL(IoTHubMessage_GetExpiryTime(messages[index]));
+        STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    }
+    for (index = 0; index < 3; index++)
+    {
+        STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG)); /*from the batch to waitingToSend*/
+        STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    }
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
 
-    ///assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventBatchAsync(handle, messages, 3, test_event_confirmation_callback, (void*)1);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-    ///cleanup
+    //cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_10_024: [If parameter messageCallback is non-NULL then IoTHubClient_LL_SetMessageCallback_Ex shall call the underlying layer's _Subscribe function.]*/
-TEST_FUNCTION(IoTHubClient_LL_SetMessageCallback_Ex_happy_path_succeeds)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_027: [ IoTHubClient_LL_SendEventBatchAsync shall read the current time only once and give all the messages of the batch the same timeout. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventBatchAsync_with_messageTimeout_reads_the_time_once)
 {
-    ///arrange
+    //arrange
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_MESSAGE_HANDLE messages[] = { TEST_MESSAGE_HANDLE, TEST_MESSAGE_HANDLE, TEST_MESSAGE_HANDLE };
+    tickcounter_ms_t timeout = 1000;
+    (void)IoTHubClient_LL_SetOption(handle, "messageTimeout", &timeout);
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Subscribe(IGNORED_PTR_ARG))
-        .IgnoreArgument_handle();
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Clone(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(gballoc_realloc(IGNORED_PTR_ARG, IGNORED_NUM_ARG)); /*the message timeout queue grows on the first timed message*/
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetExpiryTime(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Clone(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetExpiryTime(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Clone(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetExpiryTime(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
 
-    ///act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetMessageCallback_Ex(handle, messageCallbackEx, (void*)1);
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventBatchAsync(handle, messages, 3, test_event_confirmation_callback, (void*)1);
 
-    ///assert
+    //assert
     ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-    ///cleanup
+    //cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_10_026: [IoTHubClient_LL_SendMessageDisposition shall fail and return IOTHUB_CLIENT_INVALID_ARG if parameter iotHubClientHandle is NULL.]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_31_029: [ If queueing any of the messages fails, IoTHubClient_LL_SendEventBatchAsync shall remove the messages of the batch it already queued, without calling their callbacks, and return IOTHUB_CLIENT_ERROR. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventBatchAsync_clone_fails_removes_the_queued_messages)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_MESSAGE_HANDLE messages[] = { TEST_MESSAGE_HANDLE, TEST_MESSAGE_HANDLE, TEST_MESSAGE_HANDLE };
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Clone(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetExpiryTime(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Clone(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetExpiryTime(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Clone(TEST_MESSAGE_HANDLE))
+        .SetReturn(NULL);
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventBatchAsync(handle, messages, 3, test_event_confirmation_callback, (void*)1);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_029: [ If queueing any of the messages fails, IoTHubClient_LL_SendEventBatchAsync shall remove the messages of the batch it already queued, without calling their callbacks, and return IOTHUB_CLIENT_ERROR. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventBatchAsync_fails)
+{
+    //arrange
+    int negativeTestsInitResult = umock_c_negative_tests_init();
+    ASSERT_ARE_EQUAL(int, 0, negativeTestsInitResult);
+
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_MESSAGE_HANDLE messages[] = { TEST_MESSAGE_HANDLE, TEST_MESSAGE_HANDLE };
+    tickcounter_ms_t timeout = 1000;
+    (void)IoTHubClient_LL_SetOption(handle, "messageTimeout", &timeout);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Clone(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(gballoc_realloc(IGNORED_PTR_ARG, IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetExpiryTime(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Clone(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetExpiryTime(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
+
+    umock_c_negative_tests_snapshot();
+
+    // act
+    size_t calls_cannot_fail[] = { 4, 5, 6, 9, 10, 11, 12, 13, 14, 15, 16 };
+    size_t count = umock_c_negative_tests_call_count();
+    for (size_t index = 0; index < count; index++)
+    {
+        if (should_skip_index(index, calls_cannot_fail, sizeof(calls_cannot_fail) / sizeof(calls_cannot_fail[0])) != 0)
+        {
+            continue;
+        }
+
+        umock_c_negative_tests_reset();
+        umock_c_negative_tests_fail_call(index);
+
+        IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventBatchAsync(handle, messages, 2, test_event_confirmation_callback, (void*)1);
+
+        //assert
+        ASSERT_ARE_NOT_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    }
+
+    //cleanup
+    IoTHubClient_LL_Destroy(handle);
+    umock_c_negative_tests_deinit();
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_062: [ IoTHubClient_LL_SendEventAsync shall insert the record in waitingToSend after the messages of the same or a higher priority and before the messages of a lower priority, so that the transports, which take the messages from the head of waitingToSend, send the messages of a higher priority first and the messages of a priority in the order they were queued. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_queues_the_message_before_the_messages_of_a_lower_priority)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    (void)IoTHubClient_LL_SendEventAsync_Move(handle, TEST_LOW_PRIORITY_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(TEST_DEVICEMESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetExpiryTime(TEST_DEVICEMESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(DList_InsertHeadList(g_waitingToSend, IGNORED_PTR_ARG));
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventAsync_Move(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)2);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(void_ptr, TEST_DEVICEMESSAGE_HANDLE, containingRecord(g_waitingToSend->Flink, IOTHUB_MESSAGE_LIST, entry)->messageHandle);
+    ASSERT_ARE_EQUAL(void_ptr, TEST_LOW_PRIORITY_MESSAGE_HANDLE, containingRecord(g_waitingToSend->Blink, IOTHUB_MESSAGE_LIST, entry)->messageHandle);
+
+    //cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_063: [ IoTHubClient_LL_SendEventBatchAsync shall insert the records of the batch in waitingToSend, in the order of eventMessageHandles and each at the place of its priority, once all of them were created. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventBatchAsync_queues_each_message_in_the_lane_of_its_priority)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_MESSAGE_HANDLE messages[] = { TEST_LOW_PRIORITY_MESSAGE_HANDLE, TEST_MESSAGE_HANDLE, TEST_LOW_PRIORITY_MESSAGE_HANDLE };
+    IOTHUB_MESSAGE_LIST* record;
+    umock_c_reset_all_calls();
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventBatchAsync(handle, messages, 3, test_event_confirmation_callback, (void*)1);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    record = containingRecord(g_waitingToSend->Flink, IOTHUB_MESSAGE_LIST, entry);
+    ASSERT_ARE_EQUAL(int, IOTHUB_MESSAGE_PRIORITY_NORMAL, record->priority);
+    record = containingRecord(record->entry.Flink, IOTHUB_MESSAGE_LIST, entry);
+    ASSERT_ARE_EQUAL(int, IOTHUB_MESSAGE_PRIORITY_LOW, record->priority);
+    record = containingRecord(record->entry.Flink, IOTHUB_MESSAGE_LIST, entry);
+    ASSERT_ARE_EQUAL(int, IOTHUB_MESSAGE_PRIORITY_LOW, record->priority);
+    ASSERT_ARE_EQUAL(void_ptr, g_waitingToSend, record->entry.Flink);
+
+    //cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_065: [ "compression_codec" - takes a pointer to an IOTHUB_CLIENT_COMPRESSION_CODEC, which has to outlive the client, compressing the content of the events queued from then on. A codec without a compress function shall fail with IOTHUB_CLIENT_INVALID_ARG. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_compression_codec_succeeds)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetOption(handle, OPTION_COMPRESSION_CODEC, &TEST_CODEC);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_065: [ "compression_codec" - takes a pointer to an IOTHUB_CLIENT_COMPRESSION_CODEC, which has to outlive the client, compressing the content of the events queued from then on. A codec without a compress function shall fail with IOTHUB_CLIENT_INVALID_ARG. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_compression_codec_without_compress_function_fails)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_CLIENT_COMPRESSION_CODEC codec = { TEST_CONTENT_ENCODING, NULL };
+    umock_c_reset_all_calls();
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetOption(handle, OPTION_COMPRESSION_CODEC, &codec);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+static IOTHUB_CLIENT_LL_HANDLE create_client_with_codec(size_t minSize)
+{
+    IOTHUB_CLIENT_LL_HANDLE result = IoTHubClient_LL_Create(&TEST_CONFIG);
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, IoTHubClient_LL_SetOption(result, OPTION_COMPRESSION_CODEC, &TEST_CODEC));
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, IoTHubClient_LL_SetOption(result, OPTION_COMPRESSION_MIN_SIZE, &minSize));
+    umock_c_reset_all_calls();
+    return result;
+}
+
+static void setup_compress_message_expectations(IOTHUB_MESSAGE_HANDLE message)
+{
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetContentType(message));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetByteArray(message, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_ReadOnlyProperties(message));
+    STRICT_EXPECTED_CALL(Map_ContainsKey(IGNORED_PTR_ARG, IOTHUB_CLIENT_CONTENT_ENCODING_PROPERTY, IGNORED_PTR_ARG));
+}
+
+static void setup_create_compressed_message_expectations(IOTHUB_MESSAGE_HANDLE message, time_t expiryTime)
+{
+    STRICT_EXPECTED_CALL(gballoc_realloc(NULL, TEST_MESSAGE_SIZE - 1));
+    STRICT_EXPECTED_CALL(test_compress(IGNORED_PTR_ARG, TEST_MESSAGE_SIZE, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetMessageId(message));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetCorrelationId(message));
+    STRICT_EXPECTED_CALL(IoTHubMessage_ReadOnlyProperties(message));
+    STRICT_EXPECTED_CALL(Map_GetInternals(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_CreateFromByteArray(IGNORED_PTR_ARG, TEST_COMPRESSED_SIZE))
+        .SetReturn(TEST_COMPRESSED_MESSAGE_HANDLE);
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(message));
+    STRICT_EXPECTED_CALL(IoTHubMessage_SetPriority(TEST_COMPRESSED_MESSAGE_HANDLE, IOTHUB_MESSAGE_PRIORITY_NORMAL));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetExpiryTime(message))
+        .SetReturn(expiryTime);
+    STRICT_EXPECTED_CALL(IoTHubMessage_SetExpiryTime(TEST_COMPRESSED_MESSAGE_HANDLE, expiryTime));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Properties(TEST_COMPRESSED_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(Map_AddOrUpdate(IGNORED_PTR_ARG, IOTHUB_CLIENT_CONTENT_ENCODING_PROPERTY, TEST_CONTENT_ENCODING));
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_067: [ When a codec is set, IoTHubClient_LL_SendEventAsync, IoTHubClient_LL_SendEventAsync_Move and IoTHubClient_LL_SendEventBatchAsync shall queue, instead of the message, a copy of it whose content is compressed by the codec, with the same ids, priority, expiry time and properties plus a "content-encoding" property holding the content encoding of the codec. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_with_a_codec_queues_a_compressed_copy)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = create_client_with_codec(1);
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    setup_compress_message_expectations(TEST_MESSAGE_HANDLE);
+    setup_create_compressed_message_expectations(TEST_MESSAGE_HANDLE, 0);
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetExpiryTime(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(g_waitingToSend, IGNORED_PTR_ARG));
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(void_ptr, TEST_COMPRESSED_MESSAGE_HANDLE, containingRecord(g_waitingToSend->Flink, IOTHUB_MESSAGE_LIST, entry)->messageHandle);
+
+    //cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_067: [ When a codec is set, IoTHubClient_LL_SendEventAsync, IoTHubClient_LL_SendEventAsync_Move and IoTHubClient_LL_SendEventBatchAsync shall queue, instead of the message, a copy of it whose content is compressed by the codec, with the same ids, priority, expiry time and properties plus a "content-encoding" property holding the content encoding of the codec. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_with_a_codec_keeps_the_expiry_time_in_the_compressed_copy)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = create_client_with_codec(1);
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    setup_compress_message_expectations(TEST_MESSAGE_HANDLE);
+    setup_create_compressed_message_expectations(TEST_MESSAGE_HANDLE, TEST_TIME_VALUE + 60);
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetExpiryTime(TEST_MESSAGE_HANDLE))
+        .SetReturn(TEST_TIME_VALUE + 60);
+    STRICT_EXPECTED_CALL(DList_InsertTailList(g_waitingToSend, IGNORED_PTR_ARG));
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(void_ptr, TEST_COMPRESSED_MESSAGE_HANDLE, containingRecord(g_waitingToSend->Flink, IOTHUB_MESSAGE_LIST, entry)->messageHandle);
+    ASSERT_IS_TRUE(containingRecord(g_waitingToSend->Flink, IOTHUB_MESSAGE_LIST, entry)->expiryTime == TEST_TIME_VALUE + 60);
+
+    //cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_070: [ Once the compressed copy of a message given to IoTHubClient_LL_SendEventAsync_Move is queued, the message shall be destroyed. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_Move_with_a_codec_destroys_the_message_once_its_compressed_copy_is_queued)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = create_client_with_codec(1);
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    setup_compress_message_expectations(TEST_DEVICEMESSAGE_HANDLE);
+    setup_create_compressed_message_expectations(TEST_DEVICEMESSAGE_HANDLE, 0);
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(TEST_DEVICEMESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetExpiryTime(TEST_DEVICEMESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(g_waitingToSend, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy(TEST_DEVICEMESSAGE_HANDLE));
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventAsync_Move(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(void_ptr, TEST_COMPRESSED_MESSAGE_HANDLE, containingRecord(g_waitingToSend->Flink, IOTHUB_MESSAGE_LIST, entry)->messageHandle);
+
+    //cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_066: [ By default the events shall not be compressed, and once a codec is set only the events of at least IOTHUB_CLIENT_COMPRESSION_DEFAULT_MIN_SIZE bytes shall be. compression_min_size takes a pointer to a size_t holding another minimum. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_31_068: [ An event shall be queued as is when its content is smaller than "compression_min_size" or empty, when it already has a "content-encoding" property or when the codec fails or does not make its content smaller. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_with_a_codec_does_not_compress_a_message_smaller_than_the_min_size)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_COMPRESSION_CODEC, &TEST_CODEC);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetContentType(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetByteArray(TEST_MESSAGE_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Clone(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetExpiryTime(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(g_waitingToSend, IGNORED_PTR_ARG));
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_068: [ An event shall be queued as is when its content is smaller than "compression_min_size" or empty, when it already has a "content-encoding" property or when the codec fails or does not make its content smaller. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_with_a_codec_does_not_compress_an_encoded_message)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = create_client_with_codec(1);
+    g_message_is_encoded = true;
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetContentType(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetByteArray(TEST_MESSAGE_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_ReadOnlyProperties(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(Map_ContainsKey(IGNORED_PTR_ARG, IOTHUB_CLIENT_CONTENT_ENCODING_PROPERTY, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Clone(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetExpiryTime(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(g_waitingToSend, IGNORED_PTR_ARG));
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_068: [ An event shall be queued as is when its content is smaller than "compression_min_size" or empty, when it already has a "content-encoding" property or when the codec fails or does not make its content smaller. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_with_a_codec_that_fails_queues_the_message_as_is)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = create_client_with_codec(1);
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    setup_compress_message_expectations(TEST_MESSAGE_HANDLE);
+    STRICT_EXPECTED_CALL(gballoc_realloc(NULL, TEST_MESSAGE_SIZE - 1));
+    STRICT_EXPECTED_CALL(test_compress(IGNORED_PTR_ARG, TEST_MESSAGE_SIZE, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .SetReturn(1);
+    STRICT_EXPECTED_CALL(IoTHubMessage_Clone(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetExpiryTime(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(g_waitingToSend, IGNORED_PTR_ARG));
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_069: [ If creating the compressed copy fails, the event shall be queued as is. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_with_a_codec_when_creating_the_compressed_copy_fails_queues_the_message_as_is)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = create_client_with_codec(1);
+
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    setup_compress_message_expectations(TEST_MESSAGE_HANDLE);
+    STRICT_EXPECTED_CALL(gballoc_realloc(NULL, TEST_MESSAGE_SIZE - 1));
+    STRICT_EXPECTED_CALL(test_compress(IGNORED_PTR_ARG, TEST_MESSAGE_SIZE, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetMessageId(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetCorrelationId(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_ReadOnlyProperties(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(Map_GetInternals(IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_CreateFromByteArray(IGNORED_PTR_ARG, TEST_COMPRESSED_SIZE))
+        .SetReturn(NULL);
+    STRICT_EXPECTED_CALL(IoTHubMessage_Clone(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetExpiryTime(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(g_waitingToSend, IGNORED_PTR_ARG));
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_25_111: [IoTHubClient_LL_SetConnectionStatusCallback shall return IOTHUB_CLIENT_INVALID_ARG if called with NULL parameter iotHubClientHandle]*/
+TEST_FUNCTION(IoTHubClient_LL_SetConnectionStatusCallback_with_NULL_iotHubClientHandle_fails)
+{
+    ///arrange
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetConnectionStatusCallback(NULL, connectionStatusCallback, (void*)1);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_25_112: [IoTHubClient_LL_SetConnectionStatusCallback shall return IOTHUB_CLIENT_OK and save the callback and userContext as a member of the handle.]*/
+TEST_FUNCTION(IoTHubClient_LL_SetConnectionStatusCallback_with_non_NULL_succeeds)
+{
+    ///arrange
+
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetConnectionStatusCallback(handle, connectionStatusCallback, (void*)1);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_042: [ IoTHubClient_LL_SetOutboundQueueCallback shall return IOTHUB_CLIENT_INVALID_ARG if iotHubClientHandle is NULL. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOutboundQueueCallback_with_NULL_iotHubClientHandle_fails)
+{
+    ///arrange
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetOutboundQueueCallback(NULL, outboundQueueCallback, (void*)7);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_043: [ Otherwise IoTHubClient_LL_SetOutboundQueueCallback shall save outboundQueueCallback and userContextCallback, replacing the previous ones, and return IOTHUB_CLIENT_OK. A NULL outboundQueueCallback stops the notifications. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_31_040: [ When the fill level of the outbound queue reaches the high water mark, the outbound queue callback shall be called once with IOTHUB_CLIENT_OUTBOUND_QUEUE_HIGH_WATER_MARK. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_reaching_the_high_water_mark_calls_the_outbound_queue_callback)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    size_t maxMessages = 2;
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_OUTBOUND_QUEUE_MAX_MESSAGES, &maxMessages);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetOutboundQueueCallback(handle, outboundQueueCallback, (void*)7);
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)1); /*50%, below the high water mark*/
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(DList_InitializeListHead(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Clone(TEST_DEVICEMESSAGE_HANDLE_2));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(TEST_DEVICEMESSAGE_HANDLE_2));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetExpiryTime(TEST_DEVICEMESSAGE_HANDLE_2));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(outboundQueueCallback(IOTHUB_CLIENT_OUTBOUND_QUEUE_HIGH_WATER_MARK, (void*)7));
+
+    ///act
+    result = IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE_2, test_event_confirmation_callback, (void*)2);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_041: [ When the fill level of the outbound queue then drains to the low water mark, the outbound queue callback shall be called once with IOTHUB_CLIENT_OUTBOUND_QUEUE_LOW_WATER_MARK. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_31_044: [ A message shall count against the limits of the outbound queue from the time it is queued until it is completed, times out or is dropped, whether or not the transport took it from waitingToSend. ]*/
+TEST_FUNCTION(IoTHubClient_LL_DoWork_draining_to_the_low_water_mark_calls_the_outbound_queue_callback)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    tickcounter_ms_t one = 1;
+    size_t maxMessages = 1;
+    (void)IoTHubClient_LL_SetOption(handle, "messageTimeout", &one);
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_OUTBOUND_QUEUE_MAX_MESSAGES, &maxMessages);
+    (void)IoTHubClient_LL_SetOutboundQueueCallback(handle, outboundQueueCallback, (void*)7);
+
+    tickcounter_ms_t ten = 10;
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .CopyOutArgumentBuffer(2, &ten, sizeof(ten));
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)TEST_DEVICEMESSAGE_HANDLE); /*100%, calls the callback with HIGH_WATER_MARK*/
+    umock_c_reset_all_calls();
+
+    tickcounter_ms_t twelve = 12;
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .CopyOutArgumentBuffer(2, &twelve, sizeof(twelve));
+    STRICT_EXPECTED_CALL(DList_RemoveEntryList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT, (void*)TEST_DEVICEMESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(outboundQueueCallback(IOTHUB_CLIENT_OUTBOUND_QUEUE_LOW_WATER_MARK, (void*)7));
+    EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllCalls();
+
+    ///act
+    IoTHubClient_LL_DoWork(handle);
+
+    ///assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_035: [ If the messages do not fit in the outbound queue even after dropping all the messages the policy allows to drop, IoTHubClient_LL_SendEventAsync shall fail, drop nothing and return IOTHUB_CLIENT_QUEUE_FULL. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_31_036: [ With IOTHUB_CLIENT_OUTBOUND_QUEUE_REJECT_NEW, messages that do not fit shall be rejected. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_with_a_full_outbound_queue_and_REJECT_NEW_fails)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    size_t maxMessages = 1;
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_OUTBOUND_QUEUE_MAX_MESSAGES, &maxMessages);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(DList_InitializeListHead(IGNORED_PTR_ARG));
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE_2, test_event_confirmation_callback, (void*)2);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_QUEUE_FULL, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_032: [ "outbound_queue_max_messages" and "outbound_queue_max_bytes" - take a pointer to a size_t holding the most messages, and the most bytes of message content, given to IoTHubClient_LL that may be waiting for their completion. 0 removes the limit. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_over_outbound_queue_max_bytes_fails)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    size_t maxBytes = TEST_MESSAGE_SIZE + TEST_MESSAGE_SIZE / 2;
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_OUTBOUND_QUEUE_MAX_BYTES, &maxBytes);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(DList_InitializeListHead(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetContentType(TEST_DEVICEMESSAGE_HANDLE_2));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetByteArray(TEST_DEVICEMESSAGE_HANDLE_2, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+
+    ///act
+    result = IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE_2, test_event_confirmation_callback, (void*)2);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_QUEUE_FULL, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_037: [ With IOTHUB_CLIENT_OUTBOUND_QUEUE_DROP_OLDEST, the oldest messages not yet taken by the transport shall be dropped until the new messages fit. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_31_039: [ The callbacks of the dropped messages shall be called with IOTHUB_CLIENT_CONFIRMATION_DROPPED. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_with_a_full_outbound_queue_and_DROP_OLDEST_drops_the_oldest_message)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    size_t maxMessages = 1;
+    IOTHUB_CLIENT_OUTBOUND_QUEUE_POLICY policy = IOTHUB_CLIENT_OUTBOUND_QUEUE_DROP_OLDEST;
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_OUTBOUND_QUEUE_MAX_MESSAGES, &maxMessages);
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_OUTBOUND_QUEUE_POLICY, &policy);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(DList_InitializeListHead(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_IsListEmpty(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveEntryList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Clone(TEST_DEVICEMESSAGE_HANDLE_2));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(TEST_DEVICEMESSAGE_HANDLE_2));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetExpiryTime(TEST_DEVICEMESSAGE_HANDLE_2));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_DROPPED, (void*)1));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE_2, test_event_confirmation_callback, (void*)2);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_064: [ When waitingToSend holds messages of different priorities, IOTHUB_CLIENT_OUTBOUND_QUEUE_DROP_OLDEST shall drop the oldest of the messages with the lowest priority first. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_with_DROP_OLDEST_drops_the_oldest_message_of_the_lowest_priority)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    size_t maxMessages = 2;
+    IOTHUB_CLIENT_OUTBOUND_QUEUE_POLICY policy = IOTHUB_CLIENT_OUTBOUND_QUEUE_DROP_OLDEST;
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_OUTBOUND_QUEUE_MAX_MESSAGES, &maxMessages);
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_OUTBOUND_QUEUE_POLICY, &policy);
+    (void)IoTHubClient_LL_SendEventAsync_Move(handle, TEST_LOW_PRIORITY_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+    (void)IoTHubClient_LL_SendEventAsync_Move(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)2);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(DList_InitializeListHead(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_IsListEmpty(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveEntryList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(TEST_DEVICEMESSAGE_HANDLE_2));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetExpiryTime(TEST_DEVICEMESSAGE_HANDLE_2));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_DROPPED, (void*)1));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy(TEST_LOW_PRIORITY_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventAsync_Move(handle, TEST_DEVICEMESSAGE_HANDLE_2, test_event_confirmation_callback, (void*)3);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_038: [ With IOTHUB_CLIENT_OUTBOUND_QUEUE_DROP_LOWEST_PRIORITY, the oldest of the messages with the lowest priority not yet taken by the transport shall be dropped until the new messages fit, as long as that priority is not higher than the priority of the new messages. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_with_a_full_outbound_queue_and_DROP_LOWEST_PRIORITY_drops_the_lowest_priority_message)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    size_t maxMessages = 2;
+    IOTHUB_CLIENT_OUTBOUND_QUEUE_POLICY policy = IOTHUB_CLIENT_OUTBOUND_QUEUE_DROP_LOWEST_PRIORITY;
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_OUTBOUND_QUEUE_MAX_MESSAGES, &maxMessages);
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_OUTBOUND_QUEUE_POLICY, &policy);
+    /*_Move keeps the messages themselves in waitingToSend, so their priorities can be told apart*/
+    (void)IoTHubClient_LL_SendEventAsync_Move(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+    (void)IoTHubClient_LL_SendEventAsync_Move(handle, TEST_LOW_PRIORITY_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)2);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(DList_InitializeListHead(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(TEST_DEVICEMESSAGE_HANDLE_2));
+    STRICT_EXPECTED_CALL(DList_IsListEmpty(IGNORED_PTR_ARG)); /*the low priority message starts the last lane*/
+    STRICT_EXPECTED_CALL(DList_RemoveEntryList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(TEST_DEVICEMESSAGE_HANDLE_2));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetExpiryTime(TEST_DEVICEMESSAGE_HANDLE_2));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_DROPPED, (void*)2));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy(TEST_LOW_PRIORITY_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventAsync_Move(handle, TEST_DEVICEMESSAGE_HANDLE_2, test_event_confirmation_callback, (void*)3);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_038: [ With IOTHUB_CLIENT_OUTBOUND_QUEUE_DROP_LOWEST_PRIORITY, the oldest of the messages with the lowest priority not yet taken by the transport shall be dropped until the new messages fit, as long as that priority is not higher than the priority of the new messages. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_with_DROP_LOWEST_PRIORITY_does_not_drop_higher_priority_messages)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    size_t maxMessages = 1;
+    IOTHUB_CLIENT_OUTBOUND_QUEUE_POLICY policy = IOTHUB_CLIENT_OUTBOUND_QUEUE_DROP_LOWEST_PRIORITY;
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_OUTBOUND_QUEUE_MAX_MESSAGES, &maxMessages);
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_OUTBOUND_QUEUE_POLICY, &policy);
+    (void)IoTHubClient_LL_SendEventAsync_Move(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(DList_InitializeListHead(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(TEST_LOW_PRIORITY_MESSAGE_HANDLE));
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventAsync_Move(handle, TEST_LOW_PRIORITY_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)2);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_QUEUE_FULL, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_093: [ If queueing the new messages fails after messages were dropped to make room for them, the dropped messages shall be put back in waitingToSend where they were and their callbacks shall not be called. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_with_DROP_OLDEST_failing_to_queue_does_not_drop_the_oldest_message)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    size_t maxMessages = 1;
+    IOTHUB_CLIENT_OUTBOUND_QUEUE_POLICY policy = IOTHUB_CLIENT_OUTBOUND_QUEUE_DROP_OLDEST;
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_OUTBOUND_QUEUE_MAX_MESSAGES, &maxMessages);
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_OUTBOUND_QUEUE_POLICY, &policy);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(DList_InitializeListHead(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_IsListEmpty(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveEntryList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+    STRICT_EXPECTED_CALL(DList_RemoveEntryList(IGNORED_PTR_ARG)); /*back from dropped...*/
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG)); /*...to waitingToSend*/
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG)); /*nothing left to drop*/
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE_2, test_event_confirmation_callback, (void*)2);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(void_ptr, (void*)1, containingRecord(g_waitingToSend->Flink, IOTHUB_MESSAGE_LIST, entry)->context);
+    ASSERT_ARE_EQUAL(void_ptr, g_waitingToSend, g_waitingToSend->Flink->Flink);
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_093: [ If queueing the new messages fails after messages were dropped to make room for them, the dropped messages shall be put back in waitingToSend where they were and their callbacks shall not be called. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventBatchAsync_with_DROP_OLDEST_failing_to_queue_does_not_drop_the_oldest_message)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_MESSAGE_HANDLE messages[] = { TEST_DEVICEMESSAGE_HANDLE_2 };
+    size_t maxMessages = 1;
+    IOTHUB_CLIENT_OUTBOUND_QUEUE_POLICY policy = IOTHUB_CLIENT_OUTBOUND_QUEUE_DROP_OLDEST;
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_OUTBOUND_QUEUE_MAX_MESSAGES, &maxMessages);
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_OUTBOUND_QUEUE_POLICY, &policy);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(DList_InitializeListHead(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_IsListEmpty(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveEntryList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_InitializeListHead(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Clone(TEST_DEVICEMESSAGE_HANDLE_2))
+        .SetReturn(NULL);
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG)); /*empty batch*/
+    STRICT_EXPECTED_CALL(DList_RemoveEntryList(IGNORED_PTR_ARG)); /*back from dropped...*/
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG)); /*...to waitingToSend*/
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG)); /*nothing left to drop*/
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventBatchAsync(handle, messages, 1, test_event_confirmation_callback, (void*)2);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(void_ptr, (void*)1, containingRecord(g_waitingToSend->Flink, IOTHUB_MESSAGE_LIST, entry)->context);
+    ASSERT_ARE_EQUAL(void_ptr, g_waitingToSend, g_waitingToSend->Flink->Flink);
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_045: [ IoTHubClient_LL_SendEventBatchAsync shall make room in the outbound queue for the whole batch before queueing any of its messages, and return IOTHUB_CLIENT_QUEUE_FULL when the batch does not fit. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventBatchAsync_larger_than_the_outbound_queue_fails_without_queueing)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_MESSAGE_HANDLE messages[] = { (IOTHUB_MESSAGE_HANDLE)0x61, (IOTHUB_MESSAGE_HANDLE)0x62, (IOTHUB_MESSAGE_HANDLE)0x63 };
+    size_t maxMessages = 2;
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_OUTBOUND_QUEUE_MAX_MESSAGES, &maxMessages);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(DList_InitializeListHead(IGNORED_PTR_ARG));
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendEventBatchAsync(handle, messages, 3, test_event_confirmation_callback, (void*)1);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_QUEUE_FULL, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_033: [ "outbound_queue_policy" - takes a pointer to a IOTHUB_CLIENT_OUTBOUND_QUEUE_POLICY deciding what happens to a message that does not fit in the outbound queue. Any other value shall fail with IOTHUB_CLIENT_INVALID_ARG. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_outbound_queue_policy_with_invalid_value_fails)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_CLIENT_OUTBOUND_QUEUE_POLICY policy = (IOTHUB_CLIENT_OUTBOUND_QUEUE_POLICY)42;
+    umock_c_reset_all_calls();
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetOption(handle, OPTION_OUTBOUND_QUEUE_POLICY, &policy);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_031: [ By default the outbound queue shall not be bounded, its policy shall be IOTHUB_CLIENT_OUTBOUND_QUEUE_REJECT_NEW and its high and low water marks shall be 80 and 50 percent. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_31_034: [ "outbound_queue_high_water_mark" and "outbound_queue_low_water_mark" - take a pointer to a size_t holding a percentage of the limits of the outbound queue between 1 and 100. A value that would put the low water mark above the high water mark shall fail with IOTHUB_CLIENT_INVALID_ARG. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_outbound_queue_low_water_mark_above_the_high_water_mark_fails)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    size_t lowWaterMark = 81;
+    umock_c_reset_all_calls();
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetOption(handle, OPTION_OUTBOUND_QUEUE_LOW_WATER_MARK, &lowWaterMark);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+#ifndef DONT_USE_JOURNAL
+/*Tests_SRS_IOTHUBCLIENT_LL_31_046: [ "journal_directory" - takes a const char* naming an existing directory. IoTHubClient_LL_SetOption shall create a journal in it, whose segments are "journal_segment_size" bytes, and add to waitingToSend, in order and without confirmation callbacks, the messages replayed from the journal. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_journal_directory_creates_the_journal)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(journal_create(TEST_JOURNAL_DIRECTORY, JOURNAL_DEFAULT_SEGMENT_SIZE, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .SetReturn(TEST_JOURNAL_HANDLE);
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetOption(handle, OPTION_JOURNAL_DIRECTORY, TEST_JOURNAL_DIRECTORY);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_055: [ "journal_segment_size" - takes a pointer to a size_t holding the size of the segment files of the journal, JOURNAL_DEFAULT_SEGMENT_SIZE by default. Setting it once the journal is set shall fail with IOTHUB_CLIENT_ERROR. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_journal_segment_size_is_passed_to_the_journal)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    size_t segmentSize = 4096;
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_JOURNAL_SEGMENT_SIZE, &segmentSize);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(journal_create(TEST_JOURNAL_DIRECTORY, 4096, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .SetReturn(TEST_JOURNAL_HANDLE);
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetOption(handle, OPTION_JOURNAL_DIRECTORY, TEST_JOURNAL_DIRECTORY);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_055: [ "journal_segment_size" - takes a pointer to a size_t holding the size of the segment files of the journal, JOURNAL_DEFAULT_SEGMENT_SIZE by default. Setting it once the journal is set shall fail with IOTHUB_CLIENT_ERROR. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_journal_segment_size_after_the_journal_fails)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    size_t segmentSize = 4096;
+    STRICT_EXPECTED_CALL(journal_create(TEST_JOURNAL_DIRECTORY, JOURNAL_DEFAULT_SEGMENT_SIZE, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .SetReturn(TEST_JOURNAL_HANDLE);
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_JOURNAL_DIRECTORY, TEST_JOURNAL_DIRECTORY);
+    umock_c_reset_all_calls();
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetOption(handle, OPTION_JOURNAL_SEGMENT_SIZE, &segmentSize);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_047: [ If a journal is already set, or creating the journal fails, IoTHubClient_LL_SetOption shall fail and return IOTHUB_CLIENT_ERROR. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_journal_directory_when_journal_create_fails_fails)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(journal_create(TEST_JOURNAL_DIRECTORY, JOURNAL_DEFAULT_SEGMENT_SIZE, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .SetReturn(NULL);
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetOption(handle, OPTION_JOURNAL_DIRECTORY, TEST_JOURNAL_DIRECTORY);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_047: [ If a journal is already set, or creating the journal fails, IoTHubClient_LL_SetOption shall fail and return IOTHUB_CLIENT_ERROR. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_journal_directory_twice_fails)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    STRICT_EXPECTED_CALL(journal_create(TEST_JOURNAL_DIRECTORY, JOURNAL_DEFAULT_SEGMENT_SIZE, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .SetReturn(TEST_JOURNAL_HANDLE);
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_JOURNAL_DIRECTORY, TEST_JOURNAL_DIRECTORY);
+    umock_c_reset_all_calls();
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetOption(handle, OPTION_JOURNAL_DIRECTORY, TEST_JOURNAL_DIRECTORY);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_094: [ If the client shares its transport, IoTHubClient_LL_SetOption shall fail "journal_directory" with IOTHUB_CLIENT_ERROR: the journal is committed by IoTHubClient_LL_DoWork, which the shared transport does not call. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_journal_directory_on_a_shared_transport_fails)
+{
+    ///arrange
+    STRICT_EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .SetReturn(TEST_HOSTNAME_VALUE);
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_CreateWithTransport(&TEST_DEVICE_CONFIG);
+    umock_c_reset_all_calls();
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetOption(handle, OPTION_JOURNAL_DIRECTORY, TEST_JOURNAL_DIRECTORY);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_051: [ When a journal is set, IoTHubClient_LL_DoWork shall commit it once before calling the underlaying layer's _DoWork function, so that all the messages appended since the previous call are made durable by a single write before they are sent. ]*/
+TEST_FUNCTION(IoTHubClient_LL_DoWork_commits_the_journal_before_the_underlying_DoWork)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    STRICT_EXPECTED_CALL(journal_create(TEST_JOURNAL_DIRECTORY, JOURNAL_DEFAULT_SEGMENT_SIZE, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .SetReturn(TEST_JOURNAL_HANDLE);
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_JOURNAL_DIRECTORY, TEST_JOURNAL_DIRECTORY);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreAllArguments();
+    STRICT_EXPECTED_CALL(journal_commit(TEST_JOURNAL_HANDLE));
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, handle))
+        .IgnoreArgument(1);
+
+    ///act
+    IoTHubClient_LL_DoWork(handle);
+
+    ///assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_054: [ IoTHubClient_LL_Destroy shall close the journal without confirming the messages that were not completed. ]*/
+TEST_FUNCTION(IoTHubClient_LL_Destroy_closes_the_journal)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    STRICT_EXPECTED_CALL(journal_create(TEST_JOURNAL_DIRECTORY, JOURNAL_DEFAULT_SEGMENT_SIZE, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .SetReturn(TEST_JOURNAL_HANDLE);
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_JOURNAL_DIRECTORY, TEST_JOURNAL_DIRECTORY);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Unregister(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Destroy(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(IoTHubClient_Auth_Destroy(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG)); /*the message timeout queue*/
+    STRICT_EXPECTED_CALL(tickcounter_destroy(IGNORED_PTR_ARG));
+#ifndef DONT_USE_UPLOADTOBLOB
+    STRICT_EXPECTED_CALL(IoTHubClient_LL_UploadToBlob_Destroy(IGNORED_PTR_ARG));
+#endif
+    STRICT_EXPECTED_CALL(STRING_delete(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(journal_destroy(TEST_JOURNAL_HANDLE));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    ///act
+    IoTHubClient_LL_Destroy(handle);
+
+    ///assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+#endif /*DONT_USE_JOURNAL*/
+
+/*Tests_SRS_IOTHUBCLIENT_LL_02_016: [IoTHubClient_LL_SetMessageCallback shall fail and return IOTHUB_CLIENT_INVALID_ARG if parameter iotHubClientHandle is NULL.]*/
+TEST_FUNCTION(IoTHubClient_LL_SetMessageCallback_with_NULL_iotHubClientHandle_fails)
+{
+    ///arrange
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetMessageCallback(NULL, messageCallback, (void*)1);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_02_019: [If parameter messageCallback is NULL then IoTHubClient_LL_SetMessageCallback shall call the underlying layer's _Unsubscribe function and return IOTHUB_CLIENT_OK.] */
+TEST_FUNCTION(IoTHubClient_LL_SetMessageCallback_with_NULL_calls_Unsubscribe_and_succeeds)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    (void)IoTHubClient_LL_SetMessageCallback(handle, test_message_callback_async, (void*)1);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Unsubscribe(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetMessageCallback(handle, NULL, (void*)1);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_10_010: [If parameter messageCallback is NULL and the _SetMessageCallback had not been called to subscribe for messages, then IoTHubClient_LL_SetMessageCallback shall fail and return IOTHUB_CLIENT_ERROR.] */
+TEST_FUNCTION(IoTHubClient_LL_SetMessageCallback_with_NULL_after_SetMessageCallbacEx_fails)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    (void)IoTHubClient_LL_SetMessageCallback_Ex(handle, messageCallbackEx, (void*)1);
+    umock_c_reset_all_calls();
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetMessageCallback(handle, NULL, (void*)1);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/* Tests_SRS_IOTHUBCLIENT_LL_10_011: [If parameter messageCallback is non-NULL and the _SetMessageCallback_Ex had been used to susbscribe for messages, then IoTHubClient_LL_SetMessageCallback shall fail and return IOTHUB_CLIENT_ERROR.] */
+TEST_FUNCTION(IoTHubClient_LL_SetMessageCallback_after_SetMessageCallbacEx_fails)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    (void)IoTHubClient_LL_SetMessageCallback_Ex(handle, messageCallbackEx, (void*)1);
+    umock_c_reset_all_calls();
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetMessageCallback(handle, messageCallback, (void*)1);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_10_021: [IoTHubClient_LL_SetMessageCallback_Ex shall fail and return IOTHUB_CLIENT_INVALID_ARG if parameter iotHubClientHandle is NULL.] */
+TEST_FUNCTION(IoTHubClient_LL_SetMessageCallback_Ex_with_NULL_iotHubClientHandle_fails)
+{
+    ///arrange
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetMessageCallback_Ex(NULL, messageCallbackEx, (void*)1);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_10_018: [If parameter messageCallback is NULL and IoTHubClient_LL_SetMessageCallback_Ex had not been used to subscribe for messages, then IoTHubClient_LL_SetMessageCallback_Ex shall fail and return IOTHUB_CLIENT_ERROR.] */
+TEST_FUNCTION(IoTHubClient_LL_SetMessageCallback_Ex_with_NULL_not_subscribed_fails)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetMessageCallback_Ex(handle, NULL, (void*)1);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_10_019: [If parameter messageCallback is NULL and IoTHubClient_LL_SetMessageCallback had been used to subscribe for messages, then IoTHubClient_LL_SetMessageCallback_Ex shall fail and return IOTHUB_CLIENT_ERROR.] */
+TEST_FUNCTION(IoTHubClient_LL_SetMessageCallback_Ex_with_NULL_after_SetMessageCallback_fails)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    (void)IoTHubClient_LL_SetMessageCallback(handle, messageCallback, (void*)1);
+    umock_c_reset_all_calls();
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetMessageCallback_Ex(handle, NULL, (void*)1);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_10_023: [If parameter messageCallback is NULL then IoTHubClient_LL_SetMessageCallback_Ex shall call the underlying layer's _Unsubscribe function and return IOTHUB_CLIENT_OK.] */
+TEST_FUNCTION(IoTHubClient_LL_SetMessageCallback_Ex_with_NULL_unsubscribe_succeeds)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    (void)IoTHubClient_LL_SetMessageCallback_Ex(handle, messageCallbackEx, (void*)1);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Unsubscribe(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetMessageCallback_Ex(handle, NULL, (void*)1);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_10_025: [If the underlying layer's _Subscribe function fails, then IoTHubClient_LL_SetMessageCallback_Ex shall fail and return IOTHUB_CLIENT_ERROR. Otherwise IoTHubClient_LL_SetMessageCallback shall succeed and return IOTHUB_CLIENT_OK.] */
+TEST_FUNCTION(IoTHubClient_LL_SetMessageCallback_Ex_Subscribe_fails)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Subscribe(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle()
+        .SetReturn(__LINE__);
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetMessageCallback_Ex(handle, messageCallbackEx, (void*)1);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_10_020: [If parameter messageCallback is non-NULL, and IoTHubClient_LL_SetMessageCallback had been used to subscribe for messages, then IoTHubClient_LL_SetMessageCallback_Ex shall fail and return IOTHUB_CLIENT_ERROR.] */
+TEST_FUNCTION(IoTHubClient_LL_SetMessageCallback_Ex_after_SetMessageCallback_fails)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    (void)IoTHubClient_LL_SetMessageCallback(handle, messageCallback, (void*)1);
+    umock_c_reset_all_calls();
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetMessageCallback_Ex(handle, messageCallbackEx, (void*)1);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_10_024: [If parameter messageCallback is non-NULL then IoTHubClient_LL_SetMessageCallback_Ex shall call the underlying layer's _Subscribe function.]*/
+TEST_FUNCTION(IoTHubClient_LL_SetMessageCallback_Ex_happy_path_succeeds)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Subscribe(IGNORED_PTR_ARG))
+        .IgnoreArgument_handle();
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetMessageCallback_Ex(handle, messageCallbackEx, (void*)1);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_10_026: [IoTHubClient_LL_SendMessageDisposition shall fail and return IOTHUB_CLIENT_INVALID_ARG if parameter iotHubClientHandle is NULL.]*/
 TEST_FUNCTION(IoTHubClient_LL_SendMessageDisposition_with_first_NULL_fails)
 {
-    ///act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendMessageDisposition(NULL, NULL, IOTHUBMESSAGE_ACCEPTED);
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendMessageDisposition(NULL, NULL, IOTHUBMESSAGE_ACCEPTED);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_10_027: [IoTHubClient_LL_SendMessageDisposition shall return the result from calling the underlying layer's _Send_Message_Disposition.]*/
+TEST_FUNCTION(IoTHubClient_LL_SendMessageDisposition_with_second_NULL_fails)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendMessageDisposition(NULL, NULL, IOTHUBMESSAGE_ACCEPTED);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_10_027: [IoTHubClient_LL_SendMessageDisposition shall return the result from calling the underlying layer's Send_MessageDisposition.]*/
+TEST_FUNCTION(IoTHubClient_LL_SendMessageDisposition_Succeeds)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    MESSAGE_CALLBACK_INFO* testMessage = make_test_message_info(TEST_MESSAGE_HANDLE);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_SendMessageDisposition(testMessage, IOTHUBMESSAGE_ACCEPTED));
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendMessageDisposition(handle, testMessage, IOTHUBMESSAGE_ACCEPTED);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    destroy_test_message_info(testMessage);
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_02_025: [If parameter result is IOTHUB_CLIENT_CONFIRMATION_OK then IoTHubClient_LL_SendComplete shall call all the non-NULL callbacks with the result parameter set to IOTHUB_CLIENT_CONFIRMATION_OK and the context set to the context passed originally in the SendEventAsync call.]*/
+TEST_FUNCTION(IoTHubClient_LL_SendComplete_with_1_items_with_callback_succeeds)
+{
+    ///arrange
+
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    DLIST_ENTRY temp;
+    DList_InitializeListHead(&temp);
+    IOTHUB_MESSAGE_LIST* one = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
+    one->messageHandle = (IOTHUB_MESSAGE_HANDLE)1;
+    one->callback = eventConfirmationCallback;
+    one->context = (void*)1;
+    DList_InsertTailList(&temp, &(one->entry));
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(eventConfirmationCallback(IOTHUB_CLIENT_CONFIRMATION_OK, (void*)1));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetContentType((IOTHUB_MESSAGE_HANDLE)1));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetByteArray((IOTHUB_MESSAGE_HANDLE)1, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)1));
+    STRICT_EXPECTED_CALL(gballoc_free(one));
+
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    ///act
+    IoTHubClient_LL_SendComplete(handle, &temp, IOTHUB_CLIENT_CONFIRMATION_OK);
+
+    ///assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_02_025: [If parameter result is IOTHUB_CLIENT_CONFIRMATION_OK then IoTHubClient_LL_SendComplete shall call all the non-NULL callbacks with the result parameter set to IOTHUB_CLIENT_CONFIRMATION_OK and the context set to the context passed originally in the SendEventAsync call.]*/
+TEST_FUNCTION(IoTHubClient_LL_SendComplete_with_3_items_with_callback_succeeds)
+{
+    ///arrange
+
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    DLIST_ENTRY temp;
+    DList_InitializeListHead(&temp);
+
+    IOTHUB_MESSAGE_LIST* one = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
+    one->messageHandle = (IOTHUB_MESSAGE_HANDLE)1;
+    one->callback = eventConfirmationCallback;
+    one->context = (void*)1;
+    DList_InsertTailList(&temp, &(one->entry));
+
+    IOTHUB_MESSAGE_LIST* two = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
+    two->messageHandle = (IOTHUB_MESSAGE_HANDLE)2;
+    two->callback = eventConfirmationCallback;
+    two->context = (void*)2;
+    DList_InsertTailList(&temp, &(two->entry));
+
+    IOTHUB_MESSAGE_LIST* three = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
+    three->messageHandle = (IOTHUB_MESSAGE_HANDLE)3;
+    three->callback = eventConfirmationCallback;
+    three->context = (void*)3;
+    DList_InsertTailList(&temp, &(three->entry));
+
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(eventConfirmationCallback(IOTHUB_CLIENT_CONFIRMATION_OK, (void*)1));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetContentType((IOTHUB_MESSAGE_HANDLE)1));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetByteArray((IOTHUB_MESSAGE_HANDLE)1, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)1));
+    STRICT_EXPECTED_CALL(gballoc_free(one));
+
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(eventConfirmationCallback(IOTHUB_CLIENT_CONFIRMATION_OK, (void*)2));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetContentType((IOTHUB_MESSAGE_HANDLE)2));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetByteArray((IOTHUB_MESSAGE_HANDLE)2, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)2));
+    STRICT_EXPECTED_CALL(gballoc_free(two));
+
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(eventConfirmationCallback(IOTHUB_CLIENT_CONFIRMATION_OK, (void*)3));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetContentType((IOTHUB_MESSAGE_HANDLE)3));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetByteArray((IOTHUB_MESSAGE_HANDLE)3, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)3));
+    STRICT_EXPECTED_CALL(gballoc_free(three));
+
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    ///act
+    IoTHubClient_LL_SendComplete(handle, &temp, IOTHUB_CLIENT_CONFIRMATION_OK);
+
+    ///assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_02_027: [If parameter result is IOTHUB_BACTCHSTATE_FAILED then IoTHubClient_LL_SendComplete shall call all the non-NULL callbacks with the result parameter set to IOTHUB_CLIENT_CONFIRMATION_ERROR and the context set to the context passed originally in the SendEventAsync call.]*/
+TEST_FUNCTION(IoTHubClient_LL_SendComplete_with_3_items_with_callback__but_batch_failed_succeeds)
+{
+    ///arrange
+
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    DLIST_ENTRY temp;
+    DList_InitializeListHead(&temp);
+
+    IOTHUB_MESSAGE_LIST* one = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
+    one->messageHandle = (IOTHUB_MESSAGE_HANDLE)1;
+    one->callback = eventConfirmationCallback;
+    one->context = (void*)1;
+    DList_InsertTailList(&temp, &(one->entry));
+
+    IOTHUB_MESSAGE_LIST* two = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
+    two->messageHandle = (IOTHUB_MESSAGE_HANDLE)2;
+    two->callback = eventConfirmationCallback;
+    two->context = (void*)2;
+    DList_InsertTailList(&temp, &(two->entry));
+
+    IOTHUB_MESSAGE_LIST* three = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
+    three->messageHandle = (IOTHUB_MESSAGE_HANDLE)3;
+    three->callback = eventConfirmationCallback;
+    three->context = (void*)3;
+    DList_InsertTailList(&temp, &(three->entry));
+
+
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(eventConfirmationCallback(IOTHUB_CLIENT_CONFIRMATION_ERROR, (void*)1));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)1));
+    STRICT_EXPECTED_CALL(gballoc_free(one));
+
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(eventConfirmationCallback(IOTHUB_CLIENT_CONFIRMATION_ERROR, (void*)2));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)2));
+    STRICT_EXPECTED_CALL(gballoc_free(two));
+
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(eventConfirmationCallback(IOTHUB_CLIENT_CONFIRMATION_ERROR, (void*)3));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)3));
+    STRICT_EXPECTED_CALL(gballoc_free(three));
+
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    ///act
+    IoTHubClient_LL_SendComplete(handle, &temp, IOTHUB_CLIENT_CONFIRMATION_ERROR);
+
+    ///assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+
+/* Tests_SRS_IOTHUBCLIENT_LL_25_116: [**IoTHubClient_LL_SetRetryPolicy shall return IOTHUB_CLIENT_INVALID_ARG if called with NULL iotHubClientHandle]*/
+TEST_FUNCTION(IoTHubClient_LL_SetRetryPolicy_with_NULL_iotHubClientHandle_fails)
+{
+    ///arrange
+    umock_c_reset_all_calls();
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetRetryPolicy(NULL, TEST_RETRY_POLICY, TEST_RETRY_TIMEOUT_SECS);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+}
+
+TEST_FUNCTION(IoTHubClient_LL_SetRetryPolicy_Retrytimeout_0_pass)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    ///act
+    for (int policy = 0; policy <= 6; policy++)
+    {
+        STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_SetRetryPolicy(IGNORED_PTR_ARG, (IOTHUB_CLIENT_RETRY_POLICY)policy, 0))
+                .IgnoreArgument(1);
+
+        IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetRetryPolicy(handle, (IOTHUB_CLIENT_RETRY_POLICY)policy, 0);
+        ///assert
+
+        ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    }
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+TEST_FUNCTION(IoTHubClient_LL_SetRetryPolicy_success)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_SetRetryPolicy(IGNORED_PTR_ARG, TEST_RETRY_POLICY, TEST_RETRY_TIMEOUT_SECS))
+        .IgnoreArgument(1);
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetRetryPolicy(handle, TEST_RETRY_POLICY, TEST_RETRY_TIMEOUT_SECS);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_25_114: [**IoTHubClient_LL_ConnectionStatusCallBack shall call non-callback set by the user from IoTHubClient_LL_SetConnectionStatusCallback passing the status, reason and the passed userContextCallback.]*/
+TEST_FUNCTION(IoTHubClient_LL_ConnectionStatusCallBack_calls_upper_layer_succeeds)
+{
+    ///arrange
+
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    (void)IoTHubClient_LL_SetConnectionStatusCallback(handle, connectionStatusCallback, (void*)11);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(connectionStatusCallback((IOTHUB_CLIENT_CONNECTION_STATUS)IGNORED_NUM_ARG, (IOTHUB_CLIENT_CONNECTION_STATUS_REASON)IGNORED_NUM_ARG, (void*)11)).IgnoreAllArguments();
+
+    ///act
+    IoTHubClient_LL_ConnectionStatusCallBack(handle, (IOTHUB_CLIENT_CONNECTION_STATUS)IGNORED_NUM_ARG, (IOTHUB_CLIENT_CONNECTION_STATUS_REASON)IGNORED_NUM_ARG);
+
+    ///assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_25_113: [If parameter connectionStatus is NULL or parameter handle is NULL then IoTHubClient_LL_ConnectionStatusCallBack shall return.] */
+TEST_FUNCTION(IoTHubClient_LL_ConnectionStatusCallBack_with_NULL_parameter_fails)
+{
+    ///arrange
+
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    (void)IoTHubClient_LL_SetConnectionStatusCallback(handle, connectionStatusCallback, (void*)11);
+    umock_c_reset_all_calls();
+
+    ///act
+    IoTHubClient_LL_ConnectionStatusCallBack(NULL, (IOTHUB_CLIENT_CONNECTION_STATUS)IGNORED_NUM_ARG, (IOTHUB_CLIENT_CONNECTION_STATUS_REASON)IGNORED_NUM_ARG);
+
+    ///assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_25_113: [If parameter connectionStatus is NULL or parameter handle is NULL then IoTHubClient_LL_ConnectionStatusCallBack shall return.] */
+TEST_FUNCTION(IoTHubClient_LL_ConnectionStatusCallBack_with_NULL_callback_fails)
+{
+    ///arrange
+
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    (void)IoTHubClient_LL_SetConnectionStatusCallback(handle, NULL, (void*)11);
+    umock_c_reset_all_calls();
+
+    ///act
+    IoTHubClient_LL_ConnectionStatusCallBack(NULL, (IOTHUB_CLIENT_CONNECTION_STATUS)IGNORED_NUM_ARG, (IOTHUB_CLIENT_CONNECTION_STATUS_REASON)IGNORED_NUM_ARG);
+
+    ///assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_089: [ If iotHubClientHandle is NULL, IoTHubClient_LL_Connect shall return IOTHUB_CLIENT_INVALID_ARG. ]*/
+TEST_FUNCTION(IoTHubClient_LL_Connect_with_NULL_iotHubClientHandle_fails)
+{
+    ///arrange
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_Connect(NULL, connectionStatusCallback, (void*)22);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_091: [ Otherwise IoTHubClient_LL_Connect shall save connectCallback and userContextCallback, replacing those of a previous call not completed yet, call IoTHubClient_LL_DoWork so that the transport starts connecting and return IOTHUB_CLIENT_OK. ]*/
+TEST_FUNCTION(IoTHubClient_LL_Connect_calls_the_underlying_DoWork)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_Connect(handle, connectionStatusCallback, (void*)22);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(size_t, 1, g_transport_DoWork_calls);
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_092: [ If a callback saved by IoTHubClient_LL_Connect is pending, IoTHubClient_LL_ConnectionStatusCallBack shall forget it and call it once with status, reason and its userContextCallback, before the callback set by IoTHubClient_LL_SetConnectionStatusCallback. ]*/
+TEST_FUNCTION(IoTHubClient_LL_ConnectionStatusCallBack_completes_IoTHubClient_LL_Connect_once)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    (void)IoTHubClient_LL_Connect(handle, connectionStatusCallback, (void*)22);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(connectionStatusCallback(IOTHUB_CLIENT_CONNECTION_UNAUTHENTICATED, IOTHUB_CLIENT_CONNECTION_NO_NETWORK, (void*)22));
+
+    ///act
+    IoTHubClient_LL_ConnectionStatusCallBack(handle, IOTHUB_CLIENT_CONNECTION_UNAUTHENTICATED, IOTHUB_CLIENT_CONNECTION_NO_NETWORK);
+    IoTHubClient_LL_ConnectionStatusCallBack(handle, IOTHUB_CLIENT_CONNECTION_AUTHENTICATED, IOTHUB_CLIENT_CONNECTION_OK);
+
+    ///assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_090: [ If the last connection status reported by the transport is IOTHUB_CLIENT_CONNECTION_AUTHENTICATED, IoTHubClient_LL_Connect shall call connectCallback, if not NULL, with IOTHUB_CLIENT_CONNECTION_AUTHENTICATED, IOTHUB_CLIENT_CONNECTION_OK and userContextCallback and return IOTHUB_CLIENT_OK. ]*/
+TEST_FUNCTION(IoTHubClient_LL_Connect_when_connected_completes_right_away)
+{
+    ///arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IoTHubClient_LL_ConnectionStatusCallBack(handle, IOTHUB_CLIENT_CONNECTION_AUTHENTICATED, IOTHUB_CLIENT_CONNECTION_OK);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(connectionStatusCallback(IOTHUB_CLIENT_CONNECTION_AUTHENTICATED, IOTHUB_CLIENT_CONNECTION_OK, (void*)22));
+
+    ///act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_Connect(handle, connectionStatusCallback, (void*)22);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(size_t, 0, g_transport_DoWork_calls);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_10_010: [If parameter messageCallback is NULL and the _SetMessageCallback had not been called to subscribe for messages, then IoTHubClient_LL_SetMessageCallback shall fail and return IOTHUB_CLIENT_ERROR.] */
+TEST_FUNCTION(IoTHubClient_LL_SetMessageCallback_with_NULL_before_subscribe_fails)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetMessageCallback(handle, NULL, (void*)1);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_02_017: [If parameter messageCallback is non-NULL then IoTHubClient_LL_SetMessageCallback shall call the underlying layer's _Subscribe function.]*/
+TEST_FUNCTION(IoTHubClient_LL_SetMessageCallback_with_non_NULL_succeeds)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Subscribe(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetMessageCallback(handle, test_message_callback_async, (void*)1);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_02_018: [If the underlying layer's _Subscribe function fails, then IoTHubClient_LL_SetMessageCallback shall fail and return IOTHUB_CLIENT_ERROR. Otherwise IoTHubClient_LL_SetMessageCallback shall succeed and return IOTHUB_CLIENT_OK.]*/
+TEST_FUNCTION(IoTHubClient_LL_SetMessageCallback_with_non_fails_when_underlying_transport_fails)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Subscribe(IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .SetReturn(1);
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetMessageCallback(handle, test_message_callback_async, (void*)1);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_02_020: [If parameter iotHubClientHandle is NULL then IoTHubClient_LL_DoWork shall not perform any action.] */
+TEST_FUNCTION(IoTHubClient_LL_DoWork_with_NULL_does_nothing)
+{
+    //arrange
+
+    //act
+    IoTHubClient_LL_DoWork(NULL);
+
+    //assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_02_021: [Otherwise, IoTHubClient_LL_DoWork shall invoke the underlaying layer's _DoWork function.] */
+TEST_FUNCTION(IoTHubClient_LL_DoWork_calls_underlying_succeeds)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*_DoWork will ask "what's the time"*/
+        .IgnoreAllArguments();
+
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, handle))
+        .IgnoreArgument(1);
+
+    //act
+    IoTHubClient_LL_DoWork(handle);
+
+    //assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_02_022: [If parameter completed is NULL or parameter handle is NULL then IoTHubClient_LL_SendBatch shall return.]*/
+TEST_FUNCTION(IoTHubClient_LL_SendComplete_with_NULL_handle_shall_return)
+{
+    //arrange
+    DLIST_ENTRY temp;
+    DList_InitializeListHead(&temp);
+    umock_c_reset_all_calls();
+
+    //act
+    IoTHubClient_LL_SendComplete(NULL, &temp, IOTHUB_CLIENT_CONFIRMATION_OK);
+
+    //assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_02_022: [If parameter completed is NULL or parameter handle is NULL then IoTHubClient_LL_SendBatch shall return.]*/
+TEST_FUNCTION(IoTHubClient_LL_SendComplete_with_NULL_completed_shall_return)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    //act
+    IoTHubClient_LL_SendComplete(handle, NULL, IOTHUB_CLIENT_CONFIRMATION_OK);
+
+    //assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_02_022: [If parameter completed is NULL or parameter handle is NULL then IoTHubClient_LL_SendBatch shall return.]*/
+TEST_FUNCTION(IoTHubClient_LL_SendComplete_with_empty_completed_shall_return)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    DLIST_ENTRY temp;
+    DList_InitializeListHead(&temp);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(&temp));
+
+    //act
+    IoTHubClient_LL_SendComplete(handle, &temp, IOTHUB_CLIENT_CONFIRMATION_OK);
+
+    //assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_02_025: [If parameter result is IOTHUB_CLIENT_CONFIRMATION_OK then IoTHubClient_LL_SendComplete shall call all the non-NULL callbacks with the result parameter set to IOTHUB_CLIENT_CONFIRMATION_OK and the context set to the context passed originally in the SendEventAsync call.]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_02_026: [If any callback is NULL then there shall not be a callback call.]*/
+TEST_FUNCTION(IoTHubClient_LL_SendComplete_with_3_items_one_without_callback_succeeds) /*for fun*/
+{
+    //arrange
+
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    DLIST_ENTRY temp;
+    DList_InitializeListHead(&temp);
+
+    IOTHUB_MESSAGE_LIST* one = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
+    one->messageHandle = (IOTHUB_MESSAGE_HANDLE)1;
+    one->callback = test_event_confirmation_callback;
+    one->context = (void*)1;
+    DList_InsertTailList(&temp, &(one->entry));
+
+    IOTHUB_MESSAGE_LIST* two = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
+    two->messageHandle = (IOTHUB_MESSAGE_HANDLE)2;
+    two->callback = NULL;
+    two->context = NULL;
+    DList_InsertTailList(&temp, &(two->entry));
+
+    IOTHUB_MESSAGE_LIST* three = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
+    three->messageHandle = (IOTHUB_MESSAGE_HANDLE)3;
+    three->callback = test_event_confirmation_callback;
+    three->context = (void*)3;
+    DList_InsertTailList(&temp, &(three->entry));
+
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_OK, (void*)1));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetContentType((IOTHUB_MESSAGE_HANDLE)1));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetByteArray((IOTHUB_MESSAGE_HANDLE)1, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)1));
+    STRICT_EXPECTED_CALL(gballoc_free(one));
+
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetContentType((IOTHUB_MESSAGE_HANDLE)2));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetByteArray((IOTHUB_MESSAGE_HANDLE)2, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)2));
+    STRICT_EXPECTED_CALL(gballoc_free(two));
+
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_OK, (void*)3));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetContentType((IOTHUB_MESSAGE_HANDLE)3));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetByteArray((IOTHUB_MESSAGE_HANDLE)3, IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)3));
+    STRICT_EXPECTED_CALL(gballoc_free(three));
+
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    //act
+    IoTHubClient_LL_SendComplete(handle, &temp, IOTHUB_CLIENT_CONFIRMATION_OK);
+
+    ///assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_02_026: [If any callback is NULL then there shall not be a callback call.] */
+TEST_FUNCTION(IoTHubClient_LL_SendComplete_with_3_items_one_with_callback_but_batch_failed_succeeds)
+{
+    //arrange
+
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    DLIST_ENTRY temp;
+    DList_InitializeListHead(&temp);
+
+    IOTHUB_MESSAGE_LIST* one = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
+    one->messageHandle = (IOTHUB_MESSAGE_HANDLE)1;
+    one->callback = NULL;
+    one->context = NULL;
+    DList_InsertTailList(&temp, &(one->entry));
+
+    IOTHUB_MESSAGE_LIST* two = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
+    two->messageHandle = (IOTHUB_MESSAGE_HANDLE)2;
+    two->callback = NULL;
+    two->context = NULL;
+    DList_InsertTailList(&temp, &(two->entry));
+
+    IOTHUB_MESSAGE_LIST* three = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
+    three->messageHandle = (IOTHUB_MESSAGE_HANDLE)3;
+    three->callback = test_event_confirmation_callback;
+    three->context = (void*)3;
+    DList_InsertTailList(&temp, &(three->entry));
+
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)1));
+    STRICT_EXPECTED_CALL(gballoc_free(one));
+
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)2));
+    STRICT_EXPECTED_CALL(gballoc_free(two));
+
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_ERROR, (void*)3));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)3));
+    STRICT_EXPECTED_CALL(gballoc_free(three));
+
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
+        .IgnoreArgument(1);
+
+    //act
+    IoTHubClient_LL_SendComplete(handle, &temp, IOTHUB_CLIENT_CONFIRMATION_ERROR);
+
+    ///assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    ///cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_02_029: [If parameter handle is NULL then IoTHubClient_LL_MessageCallback shall return IOTHUBMESSAGE_ABANDONED.] */
+TEST_FUNCTION(IoTHubClient_LL_MessageCallback_with_handle_NULL_parameter_fails)
+{
+    //arrange
+
+    //act
+    bool result = IoTHubClient_LL_MessageCallback(NULL, (MESSAGE_CALLBACK_INFO*)1);
 
     ///assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_IS_FALSE(result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_10_027: [IoTHubClient_LL_SendMessageDisposition shall return the result from calling the underlying layer's _Send_Message_Disposition.]*/
-TEST_FUNCTION(IoTHubClient_LL_SendMessageDisposition_with_second_NULL_fails)
+/*Tests_SRS_IOTHUBCLIENT_LL_02_029: [If either parameter `handle` or `messageData` is NULL then IoTHubClient_LL_MessageCallback shall return IOTHUBMESSAGE_ABANDONED.] */
+TEST_FUNCTION(IoTHubClient_LL_MessageCallback_with_messageData_NULL_parameter_fails)
 {
-    ///arrange
+    //arrange
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
     umock_c_reset_all_calls();
 
-    ///act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendMessageDisposition(NULL, NULL, IOTHUBMESSAGE_ACCEPTED);
+    //act
+    bool result = IoTHubClient_LL_MessageCallback(handle, NULL);
 
     ///assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_IS_FALSE(result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-    ///cleanup
+    //cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_10_027: [IoTHubClient_LL_SendMessageDisposition shall return the result from calling the underlying layer's Send_MessageDisposition.]*/
-TEST_FUNCTION(IoTHubClient_LL_SendMessageDisposition_Succeeds)
+/*Tests_SRS_IOTHUBCLIENT_LL_10_004: [If messageHandle field of the messageData parameter is NULL then IoTHubClient_LL_MessageCallback shall return false.] */
+TEST_FUNCTION(IoTHubClient_LL_MessageCallback_with_messageData_messageHandle_is_NULL_fails)
 {
-    ///arrange
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    MESSAGE_CALLBACK_INFO* testMessage = make_test_message_info(NULL);
+    umock_c_reset_all_calls();
+
+    //act
+    bool result = IoTHubClient_LL_MessageCallback(handle, testMessage);
+
+    //assert
+    ASSERT_IS_FALSE(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    destroy_test_message_info(testMessage);
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_02_032: [If messageCallbackType is NONE then IoTHubClient_LL_MessageCallback shall report false.] */
+TEST_FUNCTION(IoTHubClient_LL_MessageCallback_with_unsubscribed_returns_false)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    MESSAGE_CALLBACK_INFO* testMessage = make_test_message_info(TEST_MESSAGE_HANDLE);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(get_time(NULL));
+
+    //act
+    bool result = IoTHubClient_LL_MessageCallback(handle, testMessage);
+
+    //assert
+    ASSERT_IS_FALSE(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    destroy_test_message_info(testMessage);
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_02_030: [If messageCallbackType is LEGACY then IoTHubClient_LL_MessageCallback shall invoke the last callback function (the parameter messageCallback to IoTHubClient_LL_SetMessageCallback) passing the message and the passed userContextCallback.]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_10_007: [If messageCallbackType is LEGACY then IoTHubClient_LL_MessageCallback shall send the message disposition as returned by the client to the underlying layer and return true.]*/
+TEST_FUNCTION(IoTHubClient_LL_MessageCallback_with_messageCallback_calls_client_layer_succeeds)
+{
+    //arrange
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    (void)IoTHubClient_LL_SetMessageCallback(handle, test_message_callback_async, (void*)11);
     MESSAGE_CALLBACK_INFO* testMessage = make_test_message_info(TEST_MESSAGE_HANDLE);
     umock_c_reset_all_calls();
 
+    STRICT_EXPECTED_CALL(get_time(NULL));
+    STRICT_EXPECTED_CALL(test_message_callback_async(testMessage->messageHandle, (void*)11));
     STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_SendMessageDisposition(testMessage, IOTHUBMESSAGE_ACCEPTED));
 
-    ///act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SendMessageDisposition(handle, testMessage, IOTHUBMESSAGE_ACCEPTED);
+    //act
+    bool result = IoTHubClient_LL_MessageCallback(handle, testMessage);
 
-    ///assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    //assert
+    ASSERT_IS_TRUE(result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-    ///cleanup
+    //cleanup
     destroy_test_message_info(testMessage);
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_02_025: [If parameter result is IOTHUB_CLIENT_CONFIRMATION_OK then IoTHubClient_LL_SendComplete shall call all the non-NULL callbacks with the result parameter set to IOTHUB_CLIENT_CONFIRMATION_OK and the context set to the context passed originally in the SendEventAsync call.]*/
-TEST_FUNCTION(IoTHubClient_LL_SendComplete_with_1_items_with_callback_succeeds)
+TEST_FUNCTION(IoTHubClient_LL_MessageCallback_with_messageCallback_calls_client_layer_succeeds_report_disposition_fails)
 {
-    ///arrange
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    (void)IoTHubClient_LL_SetMessageCallback(handle, test_message_callback_async, (void*)11);
+    MESSAGE_CALLBACK_INFO* testMessage = make_test_message_info(TEST_MESSAGE_HANDLE);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(get_time(NULL));
+    STRICT_EXPECTED_CALL(test_message_callback_async(testMessage->messageHandle, (void*)11));
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_SendMessageDisposition(testMessage, IOTHUBMESSAGE_ACCEPTED))
+        .SetReturn(IOTHUB_CLIENT_ERROR);
+
+    //act
+    bool result = IoTHubClient_LL_MessageCallback(handle, testMessage);
+
+    //assert
+    ASSERT_IS_TRUE(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    destroy_test_message_info(testMessage);
+    IoTHubClient_LL_Destroy(handle);
+}
 
+TEST_FUNCTION(IoTHubClient_LL_MessageCallback_with_messageCallbackEx_calls_client_layer_succeeds)
+{
+    //arrange
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    DLIST_ENTRY temp;
-    DList_InitializeListHead(&temp);
-    IOTHUB_MESSAGE_LIST* one = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
-    one->messageHandle = (IOTHUB_MESSAGE_HANDLE)1;
-    one->callback = eventConfirmationCallback;
-    one->context = (void*)1;
-    DList_InsertTailList(&temp, &(one->entry));
+    (void)IoTHubClient_LL_SetMessageCallback_Ex(handle, messageCallbackEx, (void*)11);
+    MESSAGE_CALLBACK_INFO* testMessage = make_test_message_info(TEST_MESSAGE_HANDLE);
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(eventConfirmationCallback(IOTHUB_CLIENT_CONFIRMATION_OK, (void*)1));
-    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)1));
-    STRICT_EXPECTED_CALL(gballoc_free(one));
+    STRICT_EXPECTED_CALL(get_time(NULL));
+    STRICT_EXPECTED_CALL(messageCallbackEx(testMessage, (void*)11));
 
-    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
+    //act
+    bool result = IoTHubClient_LL_MessageCallback(handle, testMessage);
 
-    ///act
-    IoTHubClient_LL_SendComplete(handle, &temp, IOTHUB_CLIENT_CONFIRMATION_OK);
+    //assert
+    ASSERT_IS_TRUE(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-    ///assert
+    //cleanup
+    destroy_test_message_info(testMessage);
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_10_009: [If messageCallbackType is ASYNC then  IoTHubClient_LL_MessageCallback shall return what messageCallbacEx returns.] */
+TEST_FUNCTION(IoTHubClient_LL_MessageCallback_with_messageCallbackEx_calls_client_layer_reports_true)
+{
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    (void)IoTHubClient_LL_SetMessageCallback_Ex(handle, messageCallbackEx, (void*)11);
+    MESSAGE_CALLBACK_INFO* testMessage = make_test_message_info(TEST_MESSAGE_HANDLE);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(get_time(NULL));
+    STRICT_EXPECTED_CALL(messageCallbackEx(testMessage, (void*)11));
+
+    //act
+    bool result = IoTHubClient_LL_MessageCallback(handle, testMessage);
+
+    //assert
+    ASSERT_IS_TRUE(result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-    ///cleanup
+    //cleanup
+    destroy_test_message_info(testMessage);
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_02_025: [If parameter result is IOTHUB_CLIENT_CONFIRMATION_OK then IoTHubClient_LL_SendComplete shall call all the non-NULL callbacks with the result parameter set to IOTHUB_CLIENT_CONFIRMATION_OK and the context set to the context passed originally in the SendEventAsync call.]*/
-TEST_FUNCTION(IoTHubClient_LL_SendComplete_with_3_items_with_callback_succeeds)
+/*Tests_SRS_IOTHUBCLIENT_LL_10_009: [If messageCallbackType is ASYNC then  IoTHubClient_LL_MessageCallback shall return what messageCallbacEx returns.] */
+TEST_FUNCTION(IoTHubClient_LL_MessageCallback_with_messageCallbackEx_calls_client_layer_reports_false)
 {
-    ///arrange
+    //arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    (void)IoTHubClient_LL_SetMessageCallback_Ex(handle, messageCallbackEx, (void*)11);
+    MESSAGE_CALLBACK_INFO* testMessage = make_test_message_info(TEST_MESSAGE_HANDLE);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(get_time(NULL));
+    STRICT_EXPECTED_CALL(messageCallbackEx(testMessage, (void*)11))
+        .SetReturn(false);
+
+    //act
+    bool result = IoTHubClient_LL_MessageCallback(handle, testMessage);
+
+    //assert
+    ASSERT_IS_FALSE(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    destroy_test_message_info(testMessage);
+    IoTHubClient_LL_Destroy(handle);
+}
 
+TEST_FUNCTION(IoTHubClient_LL_MessageCallback_with_messageCallbackEx_calls_client_layer_fails_disposition_reporting_fails)
+{
+    //arrange
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    DLIST_ENTRY temp;
-    DList_InitializeListHead(&temp);
+    (void)IoTHubClient_LL_SetMessageCallback_Ex(handle, messageCallbackEx, (void*)11);
+    MESSAGE_CALLBACK_INFO* testMessage = make_test_message_info(TEST_MESSAGE_HANDLE);
+    umock_c_reset_all_calls();
+
+    STRICT_EXPECTED_CALL(get_time(NULL));
+    STRICT_EXPECTED_CALL(messageCallbackEx(testMessage, (void*)11))
+        .SetReturn(false);
+
+    //act
+    bool result = IoTHubClient_LL_MessageCallback(handle, testMessage);
 
-    IOTHUB_MESSAGE_LIST* one = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
-    one->messageHandle = (IOTHUB_MESSAGE_HANDLE)1;
-    one->callback = eventConfirmationCallback;
-    one->context = (void*)1;
-    DList_InsertTailList(&temp, &(one->entry));
+    //assert
+    ASSERT_IS_FALSE(result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-    IOTHUB_MESSAGE_LIST* two = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
-    two->messageHandle = (IOTHUB_MESSAGE_HANDLE)2;
-    two->callback = eventConfirmationCallback;
-    two->context = (void*)2;
-    DList_InsertTailList(&temp, &(two->entry));
+    //cleanup
+    destroy_test_message_info(testMessage);
+    IoTHubClient_LL_Destroy(handle);
+}
 
-    IOTHUB_MESSAGE_LIST* three = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
-    three->messageHandle = (IOTHUB_MESSAGE_HANDLE)3;
-    three->callback = eventConfirmationCallback;
-    three->context = (void*)3;
-    DList_InsertTailList(&temp, &(three->entry));
+/*** IoTHubClient_LL_GetLastMessageReceiveTime ***/
+
+/* Tests_SRS_IOTHUBCLIENT_LL_09_001: [IoTHubClient_LL_GetLastMessageReceiveTime shall return IOTHUB_CLIENT_INVALID_ARG if any of the arguments is NULL] */
+TEST_FUNCTION(IoTHubClient_LL_GetLastMessageReceiveTime_InvalidClientHandleArg_fails)
+{
+    // arrange
+    time_t lastMessageReceiveTime;
 
+    IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle = IoTHubClient_LL_Create(&TEST_CONFIG);
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(eventConfirmationCallback(IOTHUB_CLIENT_CONFIRMATION_OK, (void*)1));
-    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)1));
-    STRICT_EXPECTED_CALL(gballoc_free(one));
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetLastMessageReceiveTime(NULL, &lastMessageReceiveTime);
 
-    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(eventConfirmationCallback(IOTHUB_CLIENT_CONFIRMATION_OK, (void*)2));
-    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)2));
-    STRICT_EXPECTED_CALL(gballoc_free(two));
+    // assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(eventConfirmationCallback(IOTHUB_CLIENT_CONFIRMATION_OK, (void*)3));
-    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)3));
-    STRICT_EXPECTED_CALL(gballoc_free(three));
+    // Cleanup
+    IoTHubClient_LL_Destroy(iotHubClientHandle);
+}
 
-    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
+/* Tests_SRS_IOTHUBCLIENT_LL_09_001: [IoTHubClient_LL_GetLastMessageReceiveTime shall return IOTHUB_CLIENT_INVALID_ARG if any of the arguments is NULL] */
+TEST_FUNCTION(IoTHubClient_LL_GetLastMessageReceiveTime_InvalidTimeRefArg_fails)
+{
+    // arrange
+    IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
 
-    ///act
-    IoTHubClient_LL_SendComplete(handle, &temp, IOTHUB_CLIENT_CONFIRMATION_OK);
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetLastMessageReceiveTime(iotHubClientHandle, NULL);
 
-    ///assert
+    // assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-    ///cleanup
-    IoTHubClient_LL_Destroy(handle);
+
+    // Cleanup
+    IoTHubClient_LL_Destroy(iotHubClientHandle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_02_027: [If parameter result is IOTHUB_BACTCHSTATE_FAILED then IoTHubClient_LL_SendComplete shall call all the non-NULL callbacks with the result parameter set to IOTHUB_CLIENT_CONFIRMATION_ERROR and the context set to the context passed originally in the SendEventAsync call.]*/
-TEST_FUNCTION(IoTHubClient_LL_SendComplete_with_3_items_with_callback__but_batch_failed_succeeds)
+/* Tests_SRS_IOTHUBCLIENT_LL_09_002: [IoTHubClient_LL_GetLastMessageReceiveTime shall return IOTHUB_CLIENT_INDEFINITE_TIME - and not set 'lastMessageReceiveTime' - if it is unable to provide the time for the last commands] */
+TEST_FUNCTION(IoTHubClient_LL_GetLastMessageReceiveTime_NoMessagesReceived_fails)
 {
-    ///arrange
+    // arrange
+    time_t lastMessageReceiveTime = (time_t)0;
 
-    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    DLIST_ENTRY temp;
-    DList_InitializeListHead(&temp);
+    IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
 
-    IOTHUB_MESSAGE_LIST* one = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
-    one->messageHandle = (IOTHUB_MESSAGE_HANDLE)1;
-    one->callback = eventConfirmationCallback;
-    one->context = (void*)1;
-    DList_InsertTailList(&temp, &(one->entry));
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetLastMessageReceiveTime(iotHubClientHandle, &lastMessageReceiveTime);
 
-    IOTHUB_MESSAGE_LIST* two = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
-    two->messageHandle = (IOTHUB_MESSAGE_HANDLE)2;
-    two->callback = eventConfirmationCallback;
-    two->context = (void*)2;
-    DList_InsertTailList(&temp, &(two->entry));
+    // assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INDEFINITE_TIME, result);
+    ASSERT_ARE_EQUAL(int, 0, (int)(lastMessageReceiveTime));
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-    IOTHUB_MESSAGE_LIST* three = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
-    three->messageHandle = (IOTHUB_MESSAGE_HANDLE)3;
-    three->callback = eventConfirmationCallback;
-    three->context = (void*)3;
-    DList_InsertTailList(&temp, &(three->entry));
+    // Cleanup
+    IoTHubClient_LL_Destroy(iotHubClientHandle);
+}
 
+/* Tests_SRS_IOTHUBCLIENT_LL_09_003: [IoTHubClient_LL_GetLastMessageReceiveTime shall return IOTHUB_CLIENT_OK if it wrote in the lastMessageReceiveTime the time when the last command was received] */
+/* Tests_SRS_IOTHUBCLIENT_LL_09_004: [IoTHubClient_LL_GetLastMessageReceiveTime shall return lastMessageReceiveTime in localtime] */
+TEST_FUNCTION(IoTHubClient_LL_GetLastMessageReceiveTime_MessagesReceived_succeeds)
+{
+    // arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    (void)IoTHubClient_LL_SetMessageCallback(handle, test_message_callback_async, (void*)11);
 
+    MESSAGE_CALLBACK_INFO* testMessage = make_test_message_info(TEST_MESSAGE_HANDLE);
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(eventConfirmationCallback(IOTHUB_CLIENT_CONFIRMATION_ERROR, (void*)1));
-    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)1));
-    STRICT_EXPECTED_CALL(gballoc_free(one));
-
-    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(eventConfirmationCallback(IOTHUB_CLIENT_CONFIRMATION_ERROR, (void*)2));
-    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)2));
-    STRICT_EXPECTED_CALL(gballoc_free(two));
+    STRICT_EXPECTED_CALL(get_time(NULL));
+    STRICT_EXPECTED_CALL(test_message_callback_async(testMessage->messageHandle, (void*)11));
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_SendMessageDisposition(testMessage, IOTHUBMESSAGE_ACCEPTED));
 
-    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(eventConfirmationCallback(IOTHUB_CLIENT_CONFIRMATION_ERROR, (void*)3));
-    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)3));
-    STRICT_EXPECTED_CALL(gballoc_free(three));
+    (void)IoTHubClient_LL_MessageCallback(handle, testMessage);
 
-    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
+    // act
+    time_t lastMessageReceiveTime = (time_t)0;
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetLastMessageReceiveTime(handle, &lastMessageReceiveTime);
 
-    ///act
-    IoTHubClient_LL_SendComplete(handle, &temp, IOTHUB_CLIENT_CONFIRMATION_ERROR);
+    // assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(int, (int)TEST_TIME_VALUE, (int)lastMessageReceiveTime);
 
-    ///assert
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
     ///cleanup
     IoTHubClient_LL_Destroy(handle);
+    destroy_test_message_info(testMessage);
 }
 
+/*** IoTHubClient_LL_GetSendStatus ***/
 
-/* Tests_SRS_IOTHUBCLIENT_LL_25_116: [**IoTHubClient_LL_SetRetryPolicy shall return IOTHUB_CLIENT_INVALID_ARG if called with NULL iotHubClientHandle]*/
-TEST_FUNCTION(IoTHubClient_LL_SetRetryPolicy_with_NULL_iotHubClientHandle_fails)
+/* Tests_SRS_IOTHUBCLIENT_09_007: [IoTHubClient_LL_GetSendStatus shall return IOTHUB_CLIENT_INVALID_ARG if called with NULL parameter] */
+TEST_FUNCTION(IoTHubClient_LL_GetSendStatus_BadHandleArgument_fails)
 {
-    ///arrange
+    // arrange
+
     umock_c_reset_all_calls();
-    ///act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetRetryPolicy(NULL, TEST_RETRY_POLICY, TEST_RETRY_TIMEOUT_SECS);
 
-    ///assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    IOTHUB_CLIENT_STATUS status;
+
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetSendStatus(NULL, &status);
+
+    // assert
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
 
+    // cleanup
 }
 
-TEST_FUNCTION(IoTHubClient_LL_SetRetryPolicy_Retrytimeout_0_pass)
+/* Tests_SRS_IOTHUBCLIENT_09_007: [IoTHubClient_LL_GetSendStatus shall return IOTHUB_CLIENT_INVALID_ARG if called with NULL parameter] */
+TEST_FUNCTION(IoTHubClient_LL_GetSendStatus_BadStatusArgument_fails)
 {
-    ///arrange
+    // arrange
+
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
     umock_c_reset_all_calls();
 
-    ///act
-    for (int policy = 0; policy <= 6; policy++)
-    {
-        STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_SetRetryPolicy(IGNORED_PTR_ARG, (IOTHUB_CLIENT_RETRY_POLICY)policy, 0))
-                .IgnoreArgument(1);
-
-        IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetRetryPolicy(handle, (IOTHUB_CLIENT_RETRY_POLICY)policy, 0);
-        ///assert
-
-        ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
-        ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetSendStatus(handle, NULL);
 
-    }
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
 
-    ///cleanup
+    // cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-TEST_FUNCTION(IoTHubClient_LL_SetRetryPolicy_success)
+/* Tests_SRS_IOTHUBCLIENT_09_008: [IoTHubClient_LL_GetSendStatus shall return IOTHUB_CLIENT_OK and status IOTHUB_CLIENT_SEND_STATUS_IDLE if there is currently no items to be sent] */
+TEST_FUNCTION(IoTHubClient_GetSendStatus_NoEventToSend_Succeeds)
 {
-    ///arrange
+    // arrange
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_SetRetryPolicy(IGNORED_PTR_ARG, TEST_RETRY_POLICY, TEST_RETRY_TIMEOUT_SECS))
-        .IgnoreArgument(1);
+    IOTHUB_CLIENT_STATUS status;
+    IOTHUB_CLIENT_STATUS desire_status = IOTHUB_CLIENT_SEND_STATUS_IDLE;
 
-    ///act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetRetryPolicy(handle, TEST_RETRY_POLICY, TEST_RETRY_TIMEOUT_SECS);
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_GetSendStatus(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument_handle()
+        .CopyOutArgumentBuffer_iotHubClientStatus(&desire_status, sizeof(status))
+        .SetReturn(IOTHUB_CLIENT_OK);
 
-    ///assert
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetSendStatus(handle, &status);
+
+    // assert
     ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_STATUS, IOTHUB_CLIENT_SEND_STATUS_IDLE, status);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-    ///cleanup
+    // cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_25_114: [**IoTHubClient_LL_ConnectionStatusCallBack shall call non-callback set by the user from IoTHubClient_LL_SetConnectionStatusCallback passing the status, reason and the passed userContextCallback.]*/
-TEST_FUNCTION(IoTHubClient_LL_ConnectionStatusCallBack_calls_upper_layer_succeeds)
+/* Tests_SRS_IOTHUBCLIENT_09_009: [IoTHubClient_LL_GetSendStatus shall return IOTHUB_CLIENT_OK and status IOTHUB_CLIENT_SEND_STATUS_BUSY if there are currently items to be sent] */
+TEST_FUNCTION(IoTHubClient_GetSendStatus_HasEventToSend_Succeeds)
 {
-    ///arrange
-
+    // arrange
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    (void)IoTHubClient_LL_SetConnectionStatusCallback(handle, connectionStatusCallback, (void*)11);
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(connectionStatusCallback((IOTHUB_CLIENT_CONNECTION_STATUS)IGNORED_NUM_ARG, (IOTHUB_CLIENT_CONNECTION_STATUS_REASON)IGNORED_NUM_ARG, (void*)11)).IgnoreAllArguments();
+    IOTHUB_CLIENT_STATUS status;
+    IOTHUB_CLIENT_STATUS desire_status = IOTHUB_CLIENT_SEND_STATUS_BUSY;
 
-    ///act
-    IoTHubClient_LL_ConnectionStatusCallBack(handle, (IOTHUB_CLIENT_CONNECTION_STATUS)IGNORED_NUM_ARG, (IOTHUB_CLIENT_CONNECTION_STATUS_REASON)IGNORED_NUM_ARG);
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_GetSendStatus(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .IgnoreArgument_handle()
+        .CopyOutArgumentBuffer_iotHubClientStatus(&desire_status, sizeof(status))
+        .SetReturn(IOTHUB_CLIENT_OK);
 
-    ///assert
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetSendStatus(handle, &status);
+
+    // assert
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
-    ///cleanup
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_STATUS, IOTHUB_CLIENT_SEND_STATUS_BUSY, status);
+
+    // cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_25_113: [If parameter connectionStatus is NULL or parameter handle is NULL then IoTHubClient_LL_ConnectionStatusCallBack shall return.] */
-TEST_FUNCTION(IoTHubClient_LL_ConnectionStatusCallBack_with_NULL_parameter_fails)
+/* Tests_SRS_IOTHUBCLIENT_LL_31_001: [ If parameter iotHubClientHandle or msUntilNextDeadline is NULL then IoTHubClient_LL_GetNextDeadline shall return IOTHUB_CLIENT_INVALID_ARG. ]*/
+TEST_FUNCTION(IoTHubClient_LL_GetNextDeadline_with_NULL_handle_fails)
 {
-    ///arrange
-
-    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    (void)IoTHubClient_LL_SetConnectionStatusCallback(handle, connectionStatusCallback, (void*)11);
-    umock_c_reset_all_calls();
+    // arrange
+    tickcounter_ms_t deadline;
 
-    ///act
-    IoTHubClient_LL_ConnectionStatusCallBack(NULL, (IOTHUB_CLIENT_CONNECTION_STATUS)IGNORED_NUM_ARG, (IOTHUB_CLIENT_CONNECTION_STATUS_REASON)IGNORED_NUM_ARG);
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetNextDeadline(NULL, &deadline);
 
-    ///assert
+    // assert
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
-    ///cleanup
-    IoTHubClient_LL_Destroy(handle);
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_25_113: [If parameter connectionStatus is NULL or parameter handle is NULL then IoTHubClient_LL_ConnectionStatusCallBack shall return.] */
-TEST_FUNCTION(IoTHubClient_LL_ConnectionStatusCallBack_with_NULL_callback_fails)
+/* Tests_SRS_IOTHUBCLIENT_LL_31_001: [ If parameter iotHubClientHandle or msUntilNextDeadline is NULL then IoTHubClient_LL_GetNextDeadline shall return IOTHUB_CLIENT_INVALID_ARG. ]*/
+TEST_FUNCTION(IoTHubClient_LL_GetNextDeadline_with_NULL_msUntilNextDeadline_fails)
 {
-    ///arrange
-
+    // arrange
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    (void)IoTHubClient_LL_SetConnectionStatusCallback(handle, NULL, (void*)11);
     umock_c_reset_all_calls();
 
-    ///act
-    IoTHubClient_LL_ConnectionStatusCallBack(NULL, (IOTHUB_CLIENT_CONNECTION_STATUS)IGNORED_NUM_ARG, (IOTHUB_CLIENT_CONNECTION_STATUS_REASON)IGNORED_NUM_ARG);
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetNextDeadline(handle, NULL);
 
-    ///assert
+    // assert
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
-    ///cleanup
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+
+    // cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_10_010: [If parameter messageCallback is NULL and the _SetMessageCallback had not been called to subscribe for messages, then IoTHubClient_LL_SetMessageCallback shall fail and return IOTHUB_CLIENT_ERROR.] */
-TEST_FUNCTION(IoTHubClient_LL_SetMessageCallback_with_NULL_before_subscribe_fails)
+/* Tests_SRS_IOTHUBCLIENT_LL_31_003: [ IoTHubClient_LL_GetNextDeadline shall call the transport's _GetNextDeadline function. ]*/
+/* Tests_SRS_IOTHUBCLIENT_LL_31_006: [ IoTHubClient_LL_GetNextDeadline shall set msUntilNextDeadline to the smallest of the transport deadline and the time left until the earliest message in waitingToSend times out. ]*/
+TEST_FUNCTION(IoTHubClient_LL_GetNextDeadline_returns_transport_deadline_succeeds)
 {
-    //arrange
+    // arrange
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
     umock_c_reset_all_calls();
 
-    //act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetMessageCallback(handle, NULL, (void*)1);
+    tickcounter_ms_t transport_deadline = 5000;
+    tickcounter_ms_t deadline;
 
-    //assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_GetNextDeadline(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .CopyOutArgumentBuffer_msUntilDeadline(&transport_deadline, sizeof(transport_deadline));
+
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetNextDeadline(handle, &deadline);
+
+    // assert
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(uint64_t, (uint64_t)5000, (uint64_t)deadline);
 
-    //cleanup
+    // cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_02_017: [If parameter messageCallback is non-NULL then IoTHubClient_LL_SetMessageCallback shall call the underlying layer's _Subscribe function.]*/
-TEST_FUNCTION(IoTHubClient_LL_SetMessageCallback_with_non_NULL_succeeds)
+/* Tests_SRS_IOTHUBCLIENT_LL_31_006: [ IoTHubClient_LL_GetNextDeadline shall set msUntilNextDeadline to the smallest of the transport deadline and the time left until the earliest message in waitingToSend times out. ]*/
+TEST_FUNCTION(IoTHubClient_LL_GetNextDeadline_returns_message_timeout_when_earlier_succeeds)
 {
-    //arrange
+    // arrange
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    tickcounter_ms_t hundred = 100;
+    (void)IoTHubClient_LL_SetOption(handle, "messageTimeout", &hundred);
+
+    tickcounter_ms_t ten = 10;
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .CopyOutArgumentBuffer(2, &ten, sizeof(ten));
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_DEVICEMESSAGE_HANDLE, test_event_confirmation_callback, (void*)TEST_DEVICEMESSAGE_HANDLE);
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Subscribe(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
+    tickcounter_ms_t fifty = 50; /*message times out once the time is past 10 + 100*/
+    tickcounter_ms_t transport_deadline = 5000;
+    tickcounter_ms_t deadline;
 
-    //act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetMessageCallback(handle, test_message_callback_async, (void*)1);
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .CopyOutArgumentBuffer(2, &fifty, sizeof(fifty));
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_GetNextDeadline(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .CopyOutArgumentBuffer_msUntilDeadline(&transport_deadline, sizeof(transport_deadline));
 
-    //assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetNextDeadline(handle, &deadline);
+
+    // assert
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(uint64_t, (uint64_t)61, (uint64_t)deadline);
 
-    //cleanup
+    // cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_02_018: [If the underlying layer's _Subscribe function fails, then IoTHubClient_LL_SetMessageCallback shall fail and return IOTHUB_CLIENT_ERROR. Otherwise IoTHubClient_LL_SetMessageCallback shall succeed and return IOTHUB_CLIENT_OK.]*/
-TEST_FUNCTION(IoTHubClient_LL_SetMessageCallback_with_non_fails_when_underlying_transport_fails)
+/* Tests_SRS_IOTHUBCLIENT_LL_31_002: [ If getting the current time fails then IoTHubClient_LL_GetNextDeadline shall return IOTHUB_CLIENT_ERROR. ]*/
+/* Tests_SRS_IOTHUBCLIENT_LL_31_005: [ If the transport's _GetNextDeadline fails then IoTHubClient_LL_GetNextDeadline shall return IOTHUB_CLIENT_ERROR. ]*/
+TEST_FUNCTION(IoTHubClient_LL_GetNextDeadline_fail)
 {
-    //arrange
+    // arrange
+    int negativeTestsInitResult = umock_c_negative_tests_init();
+    ASSERT_ARE_EQUAL(int, 0, negativeTestsInitResult);
+
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_Subscribe(IGNORED_PTR_ARG))
-        .IgnoreArgument(1)
-        .SetReturn(1);
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_GetNextDeadline(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
 
-    //act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetMessageCallback(handle, test_message_callback_async, (void*)1);
+    umock_c_negative_tests_snapshot();
 
-    //assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
-    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    for (size_t index = 0; index < umock_c_negative_tests_call_count(); index++)
+    {
+        umock_c_negative_tests_reset();
+        umock_c_negative_tests_fail_call(index);
 
-    //cleanup
-    IoTHubClient_LL_Destroy(handle);
-}
+        char tmp_msg[64];
+        sprintf(tmp_msg, "IoTHubClient_LL_GetNextDeadline failure in test %zu/%zu", index, umock_c_negative_tests_call_count());
 
-/*Tests_SRS_IOTHUBCLIENT_LL_02_020: [If parameter iotHubClientHandle is NULL then IoTHubClient_LL_DoWork shall not perform any action.] */
-TEST_FUNCTION(IoTHubClient_LL_DoWork_with_NULL_does_nothing)
-{
-    //arrange
+        tickcounter_ms_t deadline;
 
-    //act
-    IoTHubClient_LL_DoWork(NULL);
+        // act
+        IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetNextDeadline(handle, &deadline);
 
-    //assert
-    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+        // assert
+        ASSERT_ARE_EQUAL_WITH_MSG(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result, tmp_msg);
+    }
+
+    // cleanup
+    umock_c_negative_tests_deinit();
+    IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_02_021: [Otherwise, IoTHubClient_LL_DoWork shall invoke the underlaying layer's _DoWork function.] */
-TEST_FUNCTION(IoTHubClient_LL_DoWork_calls_underlying_succeeds)
+/* Tests_SRS_IOTHUBCLIENT_LL_31_007: [ If items were queued for the transport since the last call to IoTHubClient_LL_DoWork then msUntilNextDeadline shall be 0. ]*/
+TEST_FUNCTION(IoTHubClient_LL_GetNextDeadline_after_SendReportedState_returns_0)
 {
-    //arrange
+    // arrange
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    (void)IoTHubClient_LL_SendReportedState(handle, TEST_REPORTED_STATE, TEST_REPORTED_SIZE, iothub_reported_state_callback, NULL);
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG)) /*_DoWork will ask "what's the time"*/
-        .IgnoreAllArguments();
+    tickcounter_ms_t transport_deadline = 5000;
+    tickcounter_ms_t deadline;
 
-    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_DoWork(IGNORED_PTR_ARG, handle))
-        .IgnoreArgument(1);
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_GetNextDeadline(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .CopyOutArgumentBuffer_msUntilDeadline(&transport_deadline, sizeof(transport_deadline));
 
-    //act
-    IoTHubClient_LL_DoWork(handle);
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetNextDeadline(handle, &deadline);
 
-    //assert
+    // assert
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(uint64_t, (uint64_t)0, (uint64_t)deadline);
 
-    //cleanup
+    // cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_02_022: [If parameter completed is NULL or parameter handle is NULL then IoTHubClient_LL_SendBatch shall return.]*/
-TEST_FUNCTION(IoTHubClient_LL_SendComplete_with_NULL_handle_shall_return)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_056: [ If parameter iotHubClientHandle or statistics is NULL then IoTHubClient_LL_GetStatistics shall return IOTHUB_CLIENT_INVALID_ARG. ]*/
+TEST_FUNCTION(IoTHubClient_LL_GetStatistics_with_NULL_handle_fails)
 {
-    //arrange
-    DLIST_ENTRY temp;
-    DList_InitializeListHead(&temp);
-    umock_c_reset_all_calls();
+    // arrange
+    IOTHUB_CLIENT_STATISTICS statistics;
 
-    //act
-    IoTHubClient_LL_SendComplete(NULL, &temp, IOTHUB_CLIENT_CONFIRMATION_OK);
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetStatistics(NULL, &statistics);
 
-    //assert
+    // assert
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_02_022: [If parameter completed is NULL or parameter handle is NULL then IoTHubClient_LL_SendBatch shall return.]*/
-TEST_FUNCTION(IoTHubClient_LL_SendComplete_with_NULL_completed_shall_return)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_056: [ If parameter iotHubClientHandle or statistics is NULL then IoTHubClient_LL_GetStatistics shall return IOTHUB_CLIENT_INVALID_ARG. ]*/
+TEST_FUNCTION(IoTHubClient_LL_GetStatistics_with_NULL_statistics_fails)
 {
-    //arrange
+    // arrange
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
     umock_c_reset_all_calls();
 
-    //act
-    IoTHubClient_LL_SendComplete(handle, NULL, IOTHUB_CLIENT_CONFIRMATION_OK);
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetStatistics(handle, NULL);
 
-    //assert
+    // assert
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
 
-    //cleanup
+    // cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_02_022: [If parameter completed is NULL or parameter handle is NULL then IoTHubClient_LL_SendBatch shall return.]*/
-TEST_FUNCTION(IoTHubClient_LL_SendComplete_with_empty_completed_shall_return)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_059: [ IoTHubClient_LL_GetStatistics shall copy the counters of the client to statistics and set queue_depth to the number of messages not completed yet less those the transport has in flight, or 0 if the transport has more in flight. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_31_060: [ IoTHubClient_LL_GetStatistics shall call the transport's _GetStatistics function, if any, to fill in_flight, retries and reconnects, and return IOTHUB_CLIENT_OK. ]*/
+TEST_FUNCTION(IoTHubClient_LL_GetStatistics_with_queued_events_succeeds)
 {
-    //arrange
+    // arrange
+    IOTHUB_CLIENT_STATISTICS statistics;
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    DLIST_ENTRY temp;
-    DList_InitializeListHead(&temp);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)2);
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(DList_RemoveHeadList(&temp));
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_GetStatistics(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
 
-    //act
-    IoTHubClient_LL_SendComplete(handle, &temp, IOTHUB_CLIENT_CONFIRMATION_OK);
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetStatistics(handle, &statistics);
 
-    //assert
+    // assert
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(size_t, 2 - TEST_TRANSPORT_IN_FLIGHT, statistics.queue_depth);
+    ASSERT_ARE_EQUAL(size_t, 2, statistics.events_queued);
+    ASSERT_ARE_EQUAL(size_t, 0, statistics.events_sent);
+    ASSERT_ARE_EQUAL(size_t, TEST_TRANSPORT_IN_FLIGHT, statistics.in_flight);
+    ASSERT_ARE_EQUAL(size_t, TEST_TRANSPORT_RETRIES, statistics.retries);
+    ASSERT_ARE_EQUAL(size_t, TEST_TRANSPORT_RECONNECTS, statistics.reconnects);
 
-    //cleanup
+    // cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_02_025: [If parameter result is IOTHUB_CLIENT_CONFIRMATION_OK then IoTHubClient_LL_SendComplete shall call all the non-NULL callbacks with the result parameter set to IOTHUB_CLIENT_CONFIRMATION_OK and the context set to the context passed originally in the SendEventAsync call.]*/
-/*Tests_SRS_IOTHUBCLIENT_LL_02_026: [If any callback is NULL then there shall not be a callback call.]*/
-TEST_FUNCTION(IoTHubClient_LL_SendComplete_with_3_items_one_without_callback_succeeds) /*for fun*/
+/*Tests_SRS_IOTHUBCLIENT_LL_31_057: [ IoTHubClient_LL_SendComplete, IoTHubClient_LL_DoWork and the send functions shall count the messages they complete in the statistics, by result, with the payload bytes of the messages completed with IOTHUB_CLIENT_CONFIRMATION_OK. ]*/
+TEST_FUNCTION(IoTHubClient_LL_GetStatistics_after_SendComplete_succeeds)
 {
-    //arrange
-
+    // arrange
+    IOTHUB_CLIENT_STATISTICS statistics;
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    DLIST_ENTRY temp;
-    DList_InitializeListHead(&temp);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)2);
+    IoTHubClient_LL_SendComplete(handle, g_waitingToSend, IOTHUB_CLIENT_CONFIRMATION_OK); /*what the transport does once the 2 messages are sent*/
+    umock_c_reset_all_calls();
 
-    IOTHUB_MESSAGE_LIST* one = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
-    one->messageHandle = (IOTHUB_MESSAGE_HANDLE)1;
-    one->callback = test_event_confirmation_callback;
-    one->context = (void*)1;
-    DList_InsertTailList(&temp, &(one->entry));
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_GetStatistics(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
 
-    IOTHUB_MESSAGE_LIST* two = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
-    two->messageHandle = (IOTHUB_MESSAGE_HANDLE)2;
-    two->callback = NULL;
-    two->context = NULL;
-    DList_InsertTailList(&temp, &(two->entry));
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetStatistics(handle, &statistics);
 
-    IOTHUB_MESSAGE_LIST* three = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
-    three->messageHandle = (IOTHUB_MESSAGE_HANDLE)3;
-    three->callback = test_event_confirmation_callback;
-    three->context = (void*)3;
-    DList_InsertTailList(&temp, &(three->entry));
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(size_t, 0, statistics.queue_depth);
+    ASSERT_ARE_EQUAL(size_t, 2, statistics.events_sent);
+    ASSERT_ARE_EQUAL(size_t, 0, statistics.events_failed);
+    ASSERT_ARE_EQUAL(uint64_t, (uint64_t)(2 * TEST_MESSAGE_SIZE), statistics.bytes_sent);
 
+    // cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+static size_t get_latency_count(const IOTHUB_CLIENT_STATISTICS* statistics)
+{
+    size_t result = 0;
+    size_t i;
+    for (i = 0; i < IOTHUB_CLIENT_LATENCY_HISTOGRAM_BUCKETS; i++)
+    {
+        result += statistics->latency_histogram[i];
+    }
+    return result;
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_058: [ The latency of a message is the time between the call to IoTHubClient_LL_DoWork that sent it and its completion with IOTHUB_CLIENT_CONFIRMATION_OK. When the send time of the message is not known, because neither the congestion control nor the linger held it back, the latency is counted from the call to IoTHubClient_LL_DoWork preceding its queueing instead. Messages queued before the first call to IoTHubClient_LL_DoWork are not counted in the latency histogram. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendComplete_OK_counts_the_latency_from_the_send_of_the_message)
+{
+    // arrange
+    IOTHUB_CLIENT_STATISTICS statistics;
+    size_t maxWindow = 16;
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_CONGESTION_CONTROL_MAX_WINDOW, &maxWindow);
+    IoTHubClient_LL_DoWork(handle);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+    IoTHubClient_LL_DoWork(handle); /*the window is full, the message waits*/
+    g_transport_in_flight = 0;
+    IoTHubClient_LL_DoWork(handle); /*the message is sent*/
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_OK, (void*)1));
-    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)1));
-    STRICT_EXPECTED_CALL(gballoc_free(one));
+    // act
+    IoTHubClient_LL_SendComplete(handle, g_waitingToSend, IOTHUB_CLIENT_CONFIRMATION_OK);
 
-    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)2));
-    STRICT_EXPECTED_CALL(gballoc_free(two));
+    // assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, IoTHubClient_LL_GetStatistics(handle, &statistics));
+    ASSERT_ARE_EQUAL(size_t, 1, statistics.latency_histogram[0]);
+    ASSERT_ARE_EQUAL(size_t, 1, get_latency_count(&statistics));
 
-    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_OK, (void*)3));
-    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)3));
-    STRICT_EXPECTED_CALL(gballoc_free(three));
+    // cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
 
-    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
+/*Tests_SRS_IOTHUBCLIENT_LL_31_058: [ The latency of a message is the time between the call to IoTHubClient_LL_DoWork that sent it and its completion with IOTHUB_CLIENT_CONFIRMATION_OK. When the send time of the message is not known, because neither the congestion control nor the linger held it back, the latency is counted from the call to IoTHubClient_LL_DoWork preceding its queueing instead. Messages queued before the first call to IoTHubClient_LL_DoWork are not counted in the latency histogram. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendComplete_OK_counts_the_latency_from_the_queueing_when_the_send_is_not_known)
+{
+    // arrange
+    IOTHUB_CLIENT_STATISTICS statistics;
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IoTHubClient_LL_DoWork(handle);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+    IoTHubClient_LL_DoWork(handle);
+    IoTHubClient_LL_DoWork(handle);
+    umock_c_reset_all_calls();
 
-    //act
-    IoTHubClient_LL_SendComplete(handle, &temp, IOTHUB_CLIENT_CONFIRMATION_OK);
+    // act
+    IoTHubClient_LL_SendComplete(handle, g_waitingToSend, IOTHUB_CLIENT_CONFIRMATION_OK);
 
-    ///assert
-    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    // assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, IoTHubClient_LL_GetStatistics(handle, &statistics));
+    ASSERT_ARE_EQUAL(size_t, 0, statistics.latency_histogram[0]);
+    ASSERT_ARE_EQUAL(size_t, 1, get_latency_count(&statistics));
 
-    ///cleanup
+    // cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_02_026: [If any callback is NULL then there shall not be a callback call.] */
-TEST_FUNCTION(IoTHubClient_LL_SendComplete_with_3_items_one_with_callback_but_batch_failed_succeeds)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_076: [ "congestion_control_max_window" - takes a pointer to a size_t holding the most events the congestion window may let the transport have in flight. A value other than 0 shall restart the congestion control with a window of 1 event, 0 shall disable it. It is disabled by default. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_31_083: [ IoTHubClient_LL_GetStatistics shall set congestion_window to the congestion window, or 0 when the congestion control is not enabled. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_congestion_control_max_window_starts_with_a_window_of_1)
 {
-    //arrange
-
+    // arrange
+    IOTHUB_CLIENT_STATISTICS statistics;
+    size_t maxWindow = 16;
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    DLIST_ENTRY temp;
-    DList_InitializeListHead(&temp);
+    umock_c_reset_all_calls();
 
-    IOTHUB_MESSAGE_LIST* one = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
-    one->messageHandle = (IOTHUB_MESSAGE_HANDLE)1;
-    one->callback = NULL;
-    one->context = NULL;
-    DList_InsertTailList(&temp, &(one->entry));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
 
-    IOTHUB_MESSAGE_LIST* two = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
-    two->messageHandle = (IOTHUB_MESSAGE_HANDLE)2;
-    two->callback = NULL;
-    two->context = NULL;
-    DList_InsertTailList(&temp, &(two->entry));
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetOption(handle, OPTION_CONGESTION_CONTROL_MAX_WINDOW, &maxWindow);
 
-    IOTHUB_MESSAGE_LIST* three = (IOTHUB_MESSAGE_LIST*)malloc(sizeof(IOTHUB_MESSAGE_LIST)); /*this is SendEvent wannabe*/
-    three->messageHandle = (IOTHUB_MESSAGE_HANDLE)3;
-    three->callback = test_event_confirmation_callback;
-    three->context = (void*)3;
-    DList_InsertTailList(&temp, &(three->entry));
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, IoTHubClient_LL_GetStatistics(handle, &statistics));
+    ASSERT_ARE_EQUAL(size_t, 1, statistics.congestion_window);
+
+    // cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
 
+/*Tests_SRS_IOTHUBCLIENT_LL_31_076: [ "congestion_control_max_window" - takes a pointer to a size_t holding the most events the congestion window may let the transport have in flight. A value other than 0 shall restart the congestion control with a window of 1 event, 0 shall disable it. It is disabled by default. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_31_083: [ IoTHubClient_LL_GetStatistics shall set congestion_window to the congestion window, or 0 when the congestion control is not enabled. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_congestion_control_max_window_0_disables_the_congestion_control)
+{
+    // arrange
+    IOTHUB_CLIENT_STATISTICS statistics;
+    size_t maxWindow = 16;
+    size_t noWindow = 0;
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_CONGESTION_CONTROL_MAX_WINDOW, &maxWindow);
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)1));
-    STRICT_EXPECTED_CALL(gballoc_free(one));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
 
-    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)2));
-    STRICT_EXPECTED_CALL(gballoc_free(two));
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetOption(handle, OPTION_CONGESTION_CONTROL_MAX_WINDOW, &noWindow);
 
-    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
-    STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_ERROR, (void*)3));
-    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy((IOTHUB_MESSAGE_HANDLE)3));
-    STRICT_EXPECTED_CALL(gballoc_free(three));
+    // assert
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, IoTHubClient_LL_GetStatistics(handle, &statistics));
+    ASSERT_ARE_EQUAL(size_t, 0, statistics.congestion_window);
 
-    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG))
-        .IgnoreArgument(1);
+    // cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
 
-    //act
-    IoTHubClient_LL_SendComplete(handle, &temp, IOTHUB_CLIENT_CONFIRMATION_ERROR);
+/*Tests_SRS_IOTHUBCLIENT_LL_31_077: [ If creating the congestion control fails, IoTHubClient_LL_SetOption shall fail and return IOTHUB_CLIENT_ERROR, keeping the previous one. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_congestion_control_max_window_when_malloc_fails_fails)
+{
+    // arrange
+    size_t maxWindow = 16;
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
 
-    ///assert
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetOption(handle, OPTION_CONGESTION_CONTROL_MAX_WINDOW, &maxWindow);
+
+    // assert
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
 
-    ///cleanup
+    // cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_02_029: [If parameter handle is NULL then IoTHubClient_LL_MessageCallback shall return IOTHUBMESSAGE_ABANDONED.] */
-TEST_FUNCTION(IoTHubClient_LL_MessageCallback_with_handle_NULL_parameter_fails)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_095: [ If the client shares its transport, IoTHubClient_LL_SetOption shall fail "congestion_control_max_window" with IOTHUB_CLIENT_ERROR: the window is applied by IoTHubClient_LL_DoWork, which the shared transport does not call, and the transport counts in flight the events of all its devices. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_congestion_control_max_window_on_a_shared_transport_fails)
 {
-    //arrange
+    // arrange
+    size_t maxWindow = 16;
+    STRICT_EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .SetReturn(TEST_HOSTNAME_VALUE);
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_CreateWithTransport(&TEST_DEVICE_CONFIG);
+    umock_c_reset_all_calls();
 
-    //act
-    bool result = IoTHubClient_LL_MessageCallback(NULL, (MESSAGE_CALLBACK_INFO*)1);
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetOption(handle, OPTION_CONGESTION_CONTROL_MAX_WINDOW, &maxWindow);
 
-    ///assert
-    ASSERT_IS_FALSE(result);
+    // assert
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
+
+    // cleanup
+    IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_02_029: [If either parameter `handle` or `messageData` is NULL then IoTHubClient_LL_MessageCallback shall return IOTHUBMESSAGE_ABANDONED.] */
-TEST_FUNCTION(IoTHubClient_LL_MessageCallback_with_messageData_NULL_parameter_fails)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_078: [ When the congestion control is enabled, IoTHubClient_LL_DoWork shall leave in waitingToSend, while it invokes the underlaying layer's _DoWork function, only as many messages as the congestion window less the events the transport has in flight according to its _GetStatistics function. ]*/
+TEST_FUNCTION(IoTHubClient_LL_DoWork_with_congestion_control_lets_the_transport_see_the_room_of_the_window)
 {
-    //arrange
+    // arrange
+    size_t maxWindow = 16;
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_CONGESTION_CONTROL_MAX_WINDOW, &maxWindow);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)2);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)3);
+    g_transport_in_flight = 0;
     umock_c_reset_all_calls();
 
-    //act
-    bool result = IoTHubClient_LL_MessageCallback(handle, NULL);
+    // act
+    IoTHubClient_LL_DoWork(handle);
 
-    ///assert
-    ASSERT_IS_FALSE(result);
-    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 1, g_messages_seen_by_transport_DoWork);
+    ASSERT_ARE_EQUAL(void_ptr, (void*)1, containingRecord(g_waitingToSend->Flink, IOTHUB_MESSAGE_LIST, entry)->context);
+    ASSERT_ARE_EQUAL(void_ptr, (void*)2, containingRecord(g_waitingToSend->Flink->Flink, IOTHUB_MESSAGE_LIST, entry)->context);
+    ASSERT_ARE_EQUAL(void_ptr, (void*)3, containingRecord(g_waitingToSend->Blink, IOTHUB_MESSAGE_LIST, entry)->context);
 
-    //cleanup
+    // cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_10_004: [If messageHandle field of the messageData parameter is NULL then IoTHubClient_LL_MessageCallback shall return false.] */
-TEST_FUNCTION(IoTHubClient_LL_MessageCallback_with_messageData_messageHandle_is_NULL_fails)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_078: [ When the congestion control is enabled, IoTHubClient_LL_DoWork shall leave in waitingToSend, while it invokes the underlaying layer's _DoWork function, only as many messages as the congestion window less the events the transport has in flight according to its _GetStatistics function. ]*/
+TEST_FUNCTION(IoTHubClient_LL_DoWork_with_a_full_congestion_window_hides_all_the_messages)
 {
-    //arrange
+    // arrange
+    size_t maxWindow = 16;
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    MESSAGE_CALLBACK_INFO* testMessage = make_test_message_info(NULL);
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_CONGESTION_CONTROL_MAX_WINDOW, &maxWindow);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
     umock_c_reset_all_calls();
 
-    //act
-    bool result = IoTHubClient_LL_MessageCallback(handle, testMessage);
+    // act
+    IoTHubClient_LL_DoWork(handle);
 
-    //assert
-    ASSERT_IS_FALSE(result);
-    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 0, g_messages_seen_by_transport_DoWork);
+    ASSERT_ARE_EQUAL(void_ptr, (void*)1, containingRecord(g_waitingToSend->Flink, IOTHUB_MESSAGE_LIST, entry)->context);
 
-    //cleanup
-    destroy_test_message_info(testMessage);
+    // cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_02_032: [If messageCallbackType is NONE then IoTHubClient_LL_MessageCallback shall report false.] */
-TEST_FUNCTION(IoTHubClient_LL_MessageCallback_with_unsubscribed_returns_false)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_079: [ IoTHubClient_LL_DoWork shall keep in the records of the messages it leaves in waitingToSend the time of the call, as the time they are sent. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_31_081: [ When the congestion control is enabled, IoTHubClient_LL_SendComplete shall give it, for every message completed with IOTHUB_CLIENT_CONFIRMATION_OK, the time from the send of the message to the last call to IoTHubClient_LL_DoWork as the latency of its acknowledgement. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendComplete_OK_grows_the_congestion_window)
 {
-    //arrange
+    // arrange
+    IOTHUB_CLIENT_STATISTICS statistics;
+    size_t maxWindow = 16;
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    MESSAGE_CALLBACK_INFO* testMessage = make_test_message_info(TEST_MESSAGE_HANDLE);
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_CONGESTION_CONTROL_MAX_WINDOW, &maxWindow);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+    g_transport_in_flight = 0;
+    IoTHubClient_LL_DoWork(handle);
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(get_time(NULL));
-
-    //act
-    bool result = IoTHubClient_LL_MessageCallback(handle, testMessage);
+    // act
+    IoTHubClient_LL_SendComplete(handle, g_waitingToSend, IOTHUB_CLIENT_CONFIRMATION_OK);
 
-    //assert
-    ASSERT_IS_FALSE(result);
-    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    // assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, IoTHubClient_LL_GetStatistics(handle, &statistics));
+    ASSERT_ARE_EQUAL(size_t, 2, statistics.congestion_window);
 
-    //cleanup
-    destroy_test_message_info(testMessage);
+    // cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_02_030: [If messageCallbackType is LEGACY then IoTHubClient_LL_MessageCallback shall invoke the last callback function (the parameter messageCallback to IoTHubClient_LL_SetMessageCallback) passing the message and the passed userContextCallback.]*/
-/*Tests_SRS_IOTHUBCLIENT_LL_10_007: [If messageCallbackType is LEGACY then IoTHubClient_LL_MessageCallback shall send the message disposition as returned by the client to the underlying layer and return true.]*/
-TEST_FUNCTION(IoTHubClient_LL_MessageCallback_with_messageCallback_calls_client_layer_succeeds)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_082: [ IoTHubClient_LL_SendComplete shall report the messages completed with IOTHUB_CLIENT_CONFIRMATION_ERROR or IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT as failures to the congestion control, and give it no feedback for the other results. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendComplete_ERROR_halves_the_congestion_window)
 {
-    //arrange
+    // arrange
+    IOTHUB_CLIENT_STATISTICS statistics;
+    size_t maxWindow = 16;
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    (void)IoTHubClient_LL_SetMessageCallback(handle, test_message_callback_async, (void*)11);
-    MESSAGE_CALLBACK_INFO* testMessage = make_test_message_info(TEST_MESSAGE_HANDLE);
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_CONGESTION_CONTROL_MAX_WINDOW, &maxWindow);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+    g_transport_in_flight = 0;
+    IoTHubClient_LL_DoWork(handle);
+    IoTHubClient_LL_SendComplete(handle, g_waitingToSend, IOTHUB_CLIENT_CONFIRMATION_OK); /*the window is now 2*/
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)2);
+    IoTHubClient_LL_DoWork(handle);
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(get_time(NULL));
-    STRICT_EXPECTED_CALL(test_message_callback_async(testMessage->messageHandle, (void*)11));
-    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_SendMessageDisposition(testMessage, IOTHUBMESSAGE_ACCEPTED));
-
-    //act
-    bool result = IoTHubClient_LL_MessageCallback(handle, testMessage);
+    // act
+    IoTHubClient_LL_SendComplete(handle, g_waitingToSend, IOTHUB_CLIENT_CONFIRMATION_ERROR);
 
-    //assert
-    ASSERT_IS_TRUE(result);
-    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    // assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, IoTHubClient_LL_GetStatistics(handle, &statistics));
+    ASSERT_ARE_EQUAL(size_t, 1, statistics.congestion_window);
 
-    //cleanup
-    destroy_test_message_info(testMessage);
+    // cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-TEST_FUNCTION(IoTHubClient_LL_MessageCallback_with_messageCallback_calls_client_layer_succeeds_report_disposition_fails)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_082: [ IoTHubClient_LL_SendComplete shall report the messages completed with IOTHUB_CLIENT_CONFIRMATION_ERROR or IOTHUB_CLIENT_CONFIRMATION_MESSAGE_TIMEOUT as failures to the congestion control, and give it no feedback for the other results. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendComplete_BECAUSE_DESTROY_does_not_change_the_congestion_window)
 {
-    //arrange
+    // arrange
+    IOTHUB_CLIENT_STATISTICS statistics;
+    size_t maxWindow = 16;
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    (void)IoTHubClient_LL_SetMessageCallback(handle, test_message_callback_async, (void*)11);
-    MESSAGE_CALLBACK_INFO* testMessage = make_test_message_info(TEST_MESSAGE_HANDLE);
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_CONGESTION_CONTROL_MAX_WINDOW, &maxWindow);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+    g_transport_in_flight = 0;
+    IoTHubClient_LL_DoWork(handle);
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(get_time(NULL));
-    STRICT_EXPECTED_CALL(test_message_callback_async(testMessage->messageHandle, (void*)11));
-    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_SendMessageDisposition(testMessage, IOTHUBMESSAGE_ACCEPTED))
-        .SetReturn(IOTHUB_CLIENT_ERROR);
+    // act
+    IoTHubClient_LL_SendComplete(handle, g_waitingToSend, IOTHUB_CLIENT_CONFIRMATION_BECAUSE_DESTROY);
 
-    //act
-    bool result = IoTHubClient_LL_MessageCallback(handle, testMessage);
+    // assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, IoTHubClient_LL_GetStatistics(handle, &statistics));
+    ASSERT_ARE_EQUAL(size_t, 1, statistics.congestion_window);
 
-    //assert
-    ASSERT_IS_TRUE(result);
+    // cleanup
+    IoTHubClient_LL_Destroy(handle);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_096: [ If the client shares its transport, IoTHubClient_LL_SetOption shall fail "linger_ms" and "linger_max_bytes" with IOTHUB_CLIENT_ERROR: the messages are held back by IoTHubClient_LL_DoWork, which the shared transport does not call. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_linger_on_a_shared_transport_fails)
+{
+    // arrange
+    tickcounter_ms_t lingerMs = 5000;
+    size_t lingerMaxBytes = 1024;
+    STRICT_EXPECTED_CALL(STRING_c_str(IGNORED_PTR_ARG))
+        .IgnoreArgument(1)
+        .SetReturn(TEST_HOSTNAME_VALUE);
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_CreateWithTransport(&TEST_DEVICE_CONFIG);
+    umock_c_reset_all_calls();
+
+    // act
+    IOTHUB_CLIENT_RESULT resultMs = IoTHubClient_LL_SetOption(handle, OPTION_LINGER_MS, &lingerMs);
+    IOTHUB_CLIENT_RESULT resultMaxBytes = IoTHubClient_LL_SetOption(handle, OPTION_LINGER_MAX_BYTES, &lingerMaxBytes);
+
+    // assert
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, resultMs);
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, resultMaxBytes);
 
-    //cleanup
-    destroy_test_message_info(testMessage);
+    // cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-TEST_FUNCTION(IoTHubClient_LL_MessageCallback_with_messageCallbackEx_calls_client_layer_succeeds)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_084: [ "linger_ms" - takes a pointer to a tickcounter_ms_t holding the most milliseconds the messages may be held back in waitingToSend so that the transport sends more of them at once, and "linger_max_bytes" a pointer to a size_t holding the bytes of content at which they are sent anyway. 0 disables the linger, which is the default, or its bound in bytes. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_31_085: [ While the messages linger, IoTHubClient_LL_DoWork shall leave none of them in waitingToSend while it invokes the underlaying layer's _DoWork function. ]*/
+TEST_FUNCTION(IoTHubClient_LL_DoWork_with_linger_holds_the_messages_back)
 {
-    //arrange
+    // arrange
+    tickcounter_ms_t lingerMs = 5000;
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    (void)IoTHubClient_LL_SetMessageCallback_Ex(handle, messageCallbackEx, (void*)11);
-    MESSAGE_CALLBACK_INFO* testMessage = make_test_message_info(TEST_MESSAGE_HANDLE);
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, IoTHubClient_LL_SetOption(handle, OPTION_LINGER_MS, &lingerMs));
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(get_time(NULL));
-    STRICT_EXPECTED_CALL(messageCallbackEx(testMessage, (void*)11));
-
-    //act
-    bool result = IoTHubClient_LL_MessageCallback(handle, testMessage);
+    // act
+    IoTHubClient_LL_DoWork(handle);
 
-    //assert
-    ASSERT_IS_TRUE(result);
-    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 0, g_messages_seen_by_transport_DoWork);
+    ASSERT_ARE_EQUAL(void_ptr, (void*)1, containingRecord(g_waitingToSend->Flink, IOTHUB_MESSAGE_LIST, entry)->context);
 
-    //cleanup
-    destroy_test_message_info(testMessage);
+    // cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_10_009: [If messageCallbackType is ASYNC then  IoTHubClient_LL_MessageCallback shall return what messageCallbacEx returns.] */
-TEST_FUNCTION(IoTHubClient_LL_MessageCallback_with_messageCallbackEx_calls_client_layer_reports_true)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_087: [ The messages shall stop lingering once "linger_ms" milliseconds have passed since the linger started, or once the messages in waitingToSend hold at least "linger_max_bytes" bytes of content when that option is set. ]*/
+TEST_FUNCTION(IoTHubClient_LL_DoWork_after_linger_ms_lets_the_transport_see_the_messages)
 {
-    //arrange
+    // arrange
+    tickcounter_ms_t lingerMs = 5000;
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    (void)IoTHubClient_LL_SetMessageCallback_Ex(handle, messageCallbackEx, (void*)11);
-    MESSAGE_CALLBACK_INFO* testMessage = make_test_message_info(TEST_MESSAGE_HANDLE);
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_LINGER_MS, &lingerMs);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)2);
+    IoTHubClient_LL_DoWork(handle); /*starts the linger*/
+    g_current_ms += lingerMs;
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(get_time(NULL));
-    STRICT_EXPECTED_CALL(messageCallbackEx(testMessage, (void*)11));
-
-    //act
-    bool result = IoTHubClient_LL_MessageCallback(handle, testMessage);
+    // act
+    IoTHubClient_LL_DoWork(handle);
 
-    //assert
-    ASSERT_IS_TRUE(result);
-    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 2, g_messages_seen_by_transport_DoWork);
 
-    //cleanup
-    destroy_test_message_info(testMessage);
+    // cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*Tests_SRS_IOTHUBCLIENT_LL_10_009: [If messageCallbackType is ASYNC then  IoTHubClient_LL_MessageCallback shall return what messageCallbacEx returns.] */
-TEST_FUNCTION(IoTHubClient_LL_MessageCallback_with_messageCallbackEx_calls_client_layer_reports_false)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_087: [ The messages shall stop lingering once "linger_ms" milliseconds have passed since the linger started, or once the messages in waitingToSend hold at least "linger_max_bytes" bytes of content when that option is set. ]*/
+TEST_FUNCTION(IoTHubClient_LL_DoWork_after_linger_max_bytes_lets_the_transport_see_the_messages)
 {
-    //arrange
+    // arrange
+    tickcounter_ms_t lingerMs = 5000;
+    size_t lingerMaxBytes = 2 * TEST_MESSAGE_SIZE;
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    (void)IoTHubClient_LL_SetMessageCallback_Ex(handle, messageCallbackEx, (void*)11);
-    MESSAGE_CALLBACK_INFO* testMessage = make_test_message_info(TEST_MESSAGE_HANDLE);
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_LINGER_MS, &lingerMs);
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, IoTHubClient_LL_SetOption(handle, OPTION_LINGER_MAX_BYTES, &lingerMaxBytes));
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+    IoTHubClient_LL_DoWork(handle);
+    ASSERT_ARE_EQUAL(size_t, 0, g_messages_seen_by_transport_DoWork);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)2);
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(get_time(NULL));
-    STRICT_EXPECTED_CALL(messageCallbackEx(testMessage, (void*)11))
-        .SetReturn(false);
-
-    //act
-    bool result = IoTHubClient_LL_MessageCallback(handle, testMessage);
+    // act
+    IoTHubClient_LL_DoWork(handle);
 
-    //assert
-    ASSERT_IS_FALSE(result);
-    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    // assert
+    ASSERT_ARE_EQUAL(size_t, 2, g_messages_seen_by_transport_DoWork);
 
-    //cleanup
-    destroy_test_message_info(testMessage);
+    // cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-TEST_FUNCTION(IoTHubClient_LL_MessageCallback_with_messageCallbackEx_calls_client_layer_fails_disposition_reporting_fails)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_088: [ While the messages linger, IoTHubClient_LL_GetNextDeadline shall hide them from the transport's _GetNextDeadline function the same way, and the deadline shall be at most the end of the linger. ]*/
+TEST_FUNCTION(IoTHubClient_LL_GetNextDeadline_while_lingering_returns_the_end_of_the_linger)
 {
-    //arrange
+    // arrange
+    tickcounter_ms_t lingerMs = 5000;
+    tickcounter_ms_t transport_deadline = 10000;
+    tickcounter_ms_t deadline;
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    (void)IoTHubClient_LL_SetMessageCallback_Ex(handle, messageCallbackEx, (void*)11);
-    MESSAGE_CALLBACK_INFO* testMessage = make_test_message_info(TEST_MESSAGE_HANDLE);
+    (void)IoTHubClient_LL_SetOption(handle, OPTION_LINGER_MS, &lingerMs);
+    (void)IoTHubClient_LL_SendEventAsync(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+    IoTHubClient_LL_DoWork(handle); /*starts the linger*/
     umock_c_reset_all_calls();
 
-    STRICT_EXPECTED_CALL(get_time(NULL));
-    STRICT_EXPECTED_CALL(messageCallbackEx(testMessage, (void*)11))
-        .SetReturn(false);
+    STRICT_EXPECTED_CALL(tickcounter_get_current_ms(IGNORED_PTR_ARG, IGNORED_PTR_ARG)); /*1000 ms after the _DoWork*/
+    STRICT_EXPECTED_CALL(DList_IsListEmpty(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_InitializeListHead(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_GetNextDeadline(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .CopyOutArgumentBuffer_msUntilDeadline(&transport_deadline, sizeof(transport_deadline));
+    STRICT_EXPECTED_CALL(DList_IsListEmpty(IGNORED_PTR_ARG));
 
-    //act
-    bool result = IoTHubClient_LL_MessageCallback(handle, testMessage);
+    // act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetNextDeadline(handle, &deadline);
 
-    //assert
-    ASSERT_IS_FALSE(result);
+    // assert
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(uint64_t, (uint64_t)(lingerMs - 1000), (uint64_t)deadline);
 
-    //cleanup
-    destroy_test_message_info(testMessage);
+    // cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/*** IoTHubClient_LL_GetLastMessageReceiveTime ***/
+static IOTHUB_MESSAGE_LIST* queue_message_expiring_at(IOTHUB_CLIENT_LL_HANDLE handle, time_t expiryTime)
+{
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetExpiryTime(TEST_MESSAGE_HANDLE))
+        .SetReturn(expiryTime);
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, IoTHubClient_LL_SendEventAsync_Move(handle, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1));
+    umock_c_reset_all_calls();
+    return containingRecord(g_waitingToSend->Flink, IOTHUB_MESSAGE_LIST, entry);
+}
 
-/* Tests_SRS_IOTHUBCLIENT_LL_09_001: [IoTHubClient_LL_GetLastMessageReceiveTime shall return IOTHUB_CLIENT_INVALID_ARG if any of the arguments is NULL] */
-TEST_FUNCTION(IoTHubClient_LL_GetLastMessageReceiveTime_InvalidClientHandleArg_fails)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_071: [ IoTHubClient_LL_SendEventAsync, IoTHubClient_LL_SendEventAsync_Move and IoTHubClient_LL_SendEventBatchAsync shall keep in the record of a message the expiry time of the message. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_keeps_the_expiry_time_in_the_record)
 {
     // arrange
-    time_t lastMessageReceiveTime;
-
-    IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
     umock_c_reset_all_calls();
 
     // act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetLastMessageReceiveTime(NULL, &lastMessageReceiveTime);
+    IOTHUB_MESSAGE_LIST* record = queue_message_expiring_at(handle, TEST_TIME_VALUE + 10);
 
     // assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
-    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_IS_TRUE(record->expiryTime == TEST_TIME_VALUE + 10);
 
-    // Cleanup
-    IoTHubClient_LL_Destroy(iotHubClientHandle);
+    // cleanup
+    IoTHubClient_LL_Destroy(handle);
 }
 
-/* Tests_SRS_IOTHUBCLIENT_LL_09_001: [IoTHubClient_LL_GetLastMessageReceiveTime shall return IOTHUB_CLIENT_INVALID_ARG if any of the arguments is NULL] */
-TEST_FUNCTION(IoTHubClient_LL_GetLastMessageReceiveTime_InvalidTimeRefArg_fails)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_072: [ If handle or message is NULL, IoTHubClient_LL_CompleteIfExpired shall return false. ]*/
+TEST_FUNCTION(IoTHubClient_LL_CompleteIfExpired_with_NULL_handle_returns_false)
 {
     // arrange
-    IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    umock_c_reset_all_calls();
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_MESSAGE_LIST* record = queue_message_expiring_at(handle, TEST_TIME_VALUE - 10);
 
     // act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetLastMessageReceiveTime(iotHubClientHandle, NULL);
+    bool result = IoTHubClient_LL_CompleteIfExpired(NULL, record);
 
     // assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_IS_FALSE(result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-
-    // Cleanup
-    IoTHubClient_LL_Destroy(iotHubClientHandle);
+    // cleanup
+    IoTHubClient_LL_Destroy(handle);
 }
 
-/* Tests_SRS_IOTHUBCLIENT_LL_09_002: [IoTHubClient_LL_GetLastMessageReceiveTime shall return IOTHUB_CLIENT_INDEFINITE_TIME - and not set 'lastMessageReceiveTime' - if it is unable to provide the time for the last commands] */
-TEST_FUNCTION(IoTHubClient_LL_GetLastMessageReceiveTime_NoMessagesReceived_fails)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_072: [ If handle or message is NULL, IoTHubClient_LL_CompleteIfExpired shall return false. ]*/
+TEST_FUNCTION(IoTHubClient_LL_CompleteIfExpired_with_NULL_message_returns_false)
 {
     // arrange
-    time_t lastMessageReceiveTime = (time_t)0;
-
-    IOTHUB_CLIENT_LL_HANDLE iotHubClientHandle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
     umock_c_reset_all_calls();
 
     // act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetLastMessageReceiveTime(iotHubClientHandle, &lastMessageReceiveTime);
+    bool result = IoTHubClient_LL_CompleteIfExpired(handle, NULL);
 
     // assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INDEFINITE_TIME, result);
-    ASSERT_ARE_EQUAL(int, 0, (int)(lastMessageReceiveTime));
+    ASSERT_IS_FALSE(result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
 
-    // Cleanup
-    IoTHubClient_LL_Destroy(iotHubClientHandle);
+    // cleanup
+    IoTHubClient_LL_Destroy(handle);
 }
 
-/* Tests_SRS_IOTHUBCLIENT_LL_09_003: [IoTHubClient_LL_GetLastMessageReceiveTime shall return IOTHUB_CLIENT_OK if it wrote in the lastMessageReceiveTime the time when the last command was received] */
-/* Tests_SRS_IOTHUBCLIENT_LL_09_004: [IoTHubClient_LL_GetLastMessageReceiveTime shall return lastMessageReceiveTime in localtime] */
-TEST_FUNCTION(IoTHubClient_LL_GetLastMessageReceiveTime_MessagesReceived_succeeds)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_073: [ If the message has no expiry time, IoTHubClient_LL_CompleteIfExpired shall return false. ]*/
+TEST_FUNCTION(IoTHubClient_LL_CompleteIfExpired_without_expiry_time_returns_false)
 {
     // arrange
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    (void)IoTHubClient_LL_SetMessageCallback(handle, test_message_callback_async, (void*)11);
-
-    MESSAGE_CALLBACK_INFO* testMessage = make_test_message_info(TEST_MESSAGE_HANDLE);
-    umock_c_reset_all_calls();
-
-    STRICT_EXPECTED_CALL(get_time(NULL));
-    STRICT_EXPECTED_CALL(test_message_callback_async(testMessage->messageHandle, (void*)11));
-    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_SendMessageDisposition(testMessage, IOTHUBMESSAGE_ACCEPTED));
-
-    (void)IoTHubClient_LL_MessageCallback(handle, testMessage);
+    IOTHUB_MESSAGE_LIST* record = queue_message_expiring_at(handle, (time_t)0);
 
     // act
-    time_t lastMessageReceiveTime = (time_t)0;
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetLastMessageReceiveTime(handle, &lastMessageReceiveTime);
+    bool result = IoTHubClient_LL_CompleteIfExpired(handle, record);
 
     // assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
-    ASSERT_ARE_EQUAL(int, (int)TEST_TIME_VALUE, (int)lastMessageReceiveTime);
-
+    ASSERT_IS_FALSE(result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_IS_TRUE(g_waitingToSend->Flink == &record->entry);
 
-    ///cleanup
+    // cleanup
     IoTHubClient_LL_Destroy(handle);
-    destroy_test_message_info(testMessage);
 }
 
-/*** IoTHubClient_LL_GetSendStatus ***/
-
-/* Tests_SRS_IOTHUBCLIENT_09_007: [IoTHubClient_LL_GetSendStatus shall return IOTHUB_CLIENT_INVALID_ARG if called with NULL parameter] */
-TEST_FUNCTION(IoTHubClient_LL_GetSendStatus_BadHandleArgument_fails)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_075: [ Otherwise, when the expiry time of the message is past, IoTHubClient_LL_CompleteIfExpired shall remove the message from the list it is in, complete it like IoTHubClient_LL_SendComplete with IOTHUB_CLIENT_CONFIRMATION_MESSAGE_EXPIRED and return true. ]*/
+TEST_FUNCTION(IoTHubClient_LL_CompleteIfExpired_before_the_expiry_time_returns_false)
 {
     // arrange
+    IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
+    IOTHUB_MESSAGE_LIST* record = queue_message_expiring_at(handle, TEST_TIME_VALUE + 1);
 
-    umock_c_reset_all_calls();
-
-    IOTHUB_CLIENT_STATUS status;
+    STRICT_EXPECTED_CALL(get_time(NULL));
 
     // act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetSendStatus(NULL, &status);
+    bool result = IoTHubClient_LL_CompleteIfExpired(handle, record);
 
     // assert
+    ASSERT_IS_FALSE(result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_IS_TRUE(g_waitingToSend->Flink == &record->entry);
 
     // cleanup
+    IoTHubClient_LL_Destroy(handle);
 }
 
-/* Tests_SRS_IOTHUBCLIENT_09_007: [IoTHubClient_LL_GetSendStatus shall return IOTHUB_CLIENT_INVALID_ARG if called with NULL parameter] */
-TEST_FUNCTION(IoTHubClient_LL_GetSendStatus_BadStatusArgument_fails)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_075: [ Otherwise, when the expiry time of the message is past, IoTHubClient_LL_CompleteIfExpired shall remove the message from the list it is in, complete it like IoTHubClient_LL_SendComplete with IOTHUB_CLIENT_CONFIRMATION_MESSAGE_EXPIRED and return true. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_31_057: [ IoTHubClient_LL_SendComplete, IoTHubClient_LL_DoWork and the send functions shall count the messages they complete in the statistics, by result, with the payload bytes of the messages completed with IOTHUB_CLIENT_CONFIRMATION_OK. ]*/
+TEST_FUNCTION(IoTHubClient_LL_CompleteIfExpired_at_the_expiry_time_completes_the_message_with_MESSAGE_EXPIRED)
 {
     // arrange
-
+    IOTHUB_CLIENT_STATISTICS statistics;
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    umock_c_reset_all_calls();
+    IOTHUB_MESSAGE_LIST* record = queue_message_expiring_at(handle, TEST_TIME_VALUE);
+
+    STRICT_EXPECTED_CALL(get_time(NULL));
+    STRICT_EXPECTED_CALL(DList_RemoveEntryList(&record->entry));
+    STRICT_EXPECTED_CALL(DList_InitializeListHead(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, &record->entry));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(test_event_confirmation_callback(IOTHUB_CLIENT_CONFIRMATION_MESSAGE_EXPIRED, (void*)1));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Destroy(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(gballoc_free(record));
+    STRICT_EXPECTED_CALL(DList_RemoveHeadList(IGNORED_PTR_ARG));
 
     // act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetSendStatus(handle, NULL);
+    bool result = IoTHubClient_LL_CompleteIfExpired(handle, record);
 
     // assert
+    ASSERT_IS_TRUE(result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_IS_TRUE(DList_IsListEmpty(g_waitingToSend) != 0);
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, IoTHubClient_LL_GetStatistics(handle, &statistics));
+    ASSERT_ARE_EQUAL(size_t, 1, statistics.events_expired);
+    ASSERT_ARE_EQUAL(size_t, 0, statistics.events_failed);
 
     // cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/* Tests_SRS_IOTHUBCLIENT_09_008: [IoTHubClient_LL_GetSendStatus shall return IOTHUB_CLIENT_OK and status IOTHUB_CLIENT_SEND_STATUS_IDLE if there is currently no items to be sent] */
-TEST_FUNCTION(IoTHubClient_GetSendStatus_NoEventToSend_Succeeds)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_074: [ If getting the current time fails, IoTHubClient_LL_CompleteIfExpired shall return false, so that the message is sent. ]*/
+TEST_FUNCTION(IoTHubClient_LL_CompleteIfExpired_when_get_time_fails_returns_false)
 {
     // arrange
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
-    umock_c_reset_all_calls();
-
-    IOTHUB_CLIENT_STATUS status;
-    IOTHUB_CLIENT_STATUS desire_status = IOTHUB_CLIENT_SEND_STATUS_IDLE;
+    IOTHUB_MESSAGE_LIST* record = queue_message_expiring_at(handle, TEST_TIME_VALUE - 10);
 
-    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_GetSendStatus(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument_handle()
-        .CopyOutArgumentBuffer_iotHubClientStatus(&desire_status, sizeof(status))
-        .SetReturn(IOTHUB_CLIENT_OK);
+    STRICT_EXPECTED_CALL(get_time(NULL))
+        .SetReturn((time_t)-1);
 
     // act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetSendStatus(handle, &status);
+    bool result = IoTHubClient_LL_CompleteIfExpired(handle, record);
 
     // assert
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_STATUS, IOTHUB_CLIENT_SEND_STATUS_IDLE, status);
+    ASSERT_IS_FALSE(result);
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    ASSERT_IS_TRUE(g_waitingToSend->Flink == &record->entry);
 
     // cleanup
     IoTHubClient_LL_Destroy(handle);
 }
 
-/* Tests_SRS_IOTHUBCLIENT_09_009: [IoTHubClient_LL_GetSendStatus shall return IOTHUB_CLIENT_OK and status IOTHUB_CLIENT_SEND_STATUS_BUSY if there are currently items to be sent] */
-TEST_FUNCTION(IoTHubClient_GetSendStatus_HasEventToSend_Succeeds)
+/*Tests_SRS_IOTHUBCLIENT_LL_31_061: [ If the transport's _GetStatistics fails then IoTHubClient_LL_GetStatistics shall return IOTHUB_CLIENT_ERROR. ]*/
+TEST_FUNCTION(IoTHubClient_LL_GetStatistics_transport_fails)
 {
     // arrange
+    IOTHUB_CLIENT_STATISTICS statistics;
     IOTHUB_CLIENT_LL_HANDLE handle = IoTHubClient_LL_Create(&TEST_CONFIG);
     umock_c_reset_all_calls();
 
-    IOTHUB_CLIENT_STATUS status;
-    IOTHUB_CLIENT_STATUS desire_status = IOTHUB_CLIENT_SEND_STATUS_BUSY;
-
-    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_GetSendStatus(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
-        .IgnoreArgument_handle()
-        .CopyOutArgumentBuffer_iotHubClientStatus(&desire_status, sizeof(status))
-        .SetReturn(IOTHUB_CLIENT_OK);
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_GetStatistics(IGNORED_PTR_ARG, IGNORED_PTR_ARG))
+        .SetReturn(__FAILURE__);
 
     // act
-    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetSendStatus(handle, &status);
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetStatistics(handle, &statistics);
 
     // assert
     ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
-    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_STATUS, IOTHUB_CLIENT_SEND_STATUS_BUSY, status);
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
 
     // cleanup
     IoTHubClient_LL_Destroy(handle);
@@ -4579,4 +6948,224 @@ TEST_FUNCTION(IoTHubClient_LL_SetOption_product_info_fails_case1)
     IoTHubClient_LL_Destroy(h);
 }
 
+/*Tests_SRS_IOTHUBCLIENT_LL_31_016: [ "message_pool_size" - takes a pointer to a size_t holding the number of IOTHUB_MESSAGE_LIST records IoTHubClient_LL_SendEventAsync takes from a pool allocated once, instead of calling malloc for every message. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_31_022: [ The transport shall be given the option too, so it can pool its own per message records. IOTHUB_CLIENT_INVALID_ARG from a transport that does not pool shall be ignored. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_message_pool_size_succeeds)
+{
+    //arrange
+    size_t poolSize = 8;
+    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_SetOption(IGNORED_PTR_ARG, OPTION_MESSAGE_POOL_SIZE, IGNORED_PTR_ARG));
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetOption(h, OPTION_MESSAGE_POOL_SIZE, &poolSize);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(h);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_022: [ The transport shall be given the option too, so it can pool its own per message records. IOTHUB_CLIENT_INVALID_ARG from a transport that does not pool shall be ignored. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_message_pool_size_ignores_transport_INVALID_ARG)
+{
+    //arrange
+    size_t poolSize = 8;
+    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_SetOption(IGNORED_PTR_ARG, OPTION_MESSAGE_POOL_SIZE, IGNORED_PTR_ARG))
+        .SetReturn(IOTHUB_CLIENT_INVALID_ARG);
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetOption(h, OPTION_MESSAGE_POOL_SIZE, &poolSize);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(h);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_022: [ The transport shall be given the option too, so it can pool its own per message records. IOTHUB_CLIENT_INVALID_ARG from a transport that does not pool shall be ignored. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_message_pool_size_fails_when_transport_fails)
+{
+    //arrange
+    size_t poolSize = 8;
+    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_SetOption(IGNORED_PTR_ARG, OPTION_MESSAGE_POOL_SIZE, IGNORED_PTR_ARG))
+        .SetReturn(IOTHUB_CLIENT_ERROR);
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetOption(h, OPTION_MESSAGE_POOL_SIZE, &poolSize);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(h);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_021: [ If creating the message pool fails, IoTHubClient_LL_SetOption shall return IOTHUB_CLIENT_ERROR and keep the current pool. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_message_pool_size_fails_when_malloc_fails)
+{
+    //arrange
+    size_t poolSize = 8;
+    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG))
+        .SetReturn(NULL);
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetOption(h, OPTION_MESSAGE_POOL_SIZE, &poolSize);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(h);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_020: [ A value of 0 shall remove the message pool. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_message_pool_size_0_removes_the_pool)
+{
+    //arrange
+    size_t poolSize = 8;
+    size_t zero = 0;
+    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    (void)IoTHubClient_LL_SetOption(h, OPTION_MESSAGE_POOL_SIZE, &poolSize);
+    umock_c_reset_all_calls();
+    STRICT_EXPECTED_CALL(FAKE_IoTHubTransport_SetOption(IGNORED_PTR_ARG, OPTION_MESSAGE_POOL_SIZE, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_free(IGNORED_PTR_ARG));
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetOption(h, OPTION_MESSAGE_POOL_SIZE, &zero);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(h);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_017: [ When a message pool is set, IoTHubClient_LL_SendEventAsync shall take the record added to waitingToSend from the pool, falling back to malloc when the pool is exhausted. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SendEventAsync_with_message_pool_does_not_malloc)
+{
+    //arrange
+    size_t poolSize = 1;
+    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    (void)IoTHubClient_LL_SetOption(h, OPTION_MESSAGE_POOL_SIZE, &poolSize);
+    umock_c_reset_all_calls();
+    STRICT_EXPECTED_CALL(IoTHubMessage_Clone(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetExpiryTime(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+    STRICT_EXPECTED_CALL(gballoc_malloc(IGNORED_NUM_ARG));
+    STRICT_EXPECTED_CALL(IoTHubMessage_Clone(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetPriority(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(IoTHubMessage_GetExpiryTime(TEST_MESSAGE_HANDLE));
+    STRICT_EXPECTED_CALL(DList_InsertTailList(IGNORED_PTR_ARG, IGNORED_PTR_ARG));
+
+    //act
+    IOTHUB_CLIENT_RESULT result1 = IoTHubClient_LL_SendEventAsync(h, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+    IOTHUB_CLIENT_RESULT result2 = IoTHubClient_LL_SendEventAsync(h, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)2);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result1);
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result2);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(h);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_019: [ If records taken from the current message pool are still in use, IoTHubClient_LL_SetOption shall fail and return IOTHUB_CLIENT_ERROR. ]*/
+TEST_FUNCTION(IoTHubClient_LL_SetOption_message_pool_size_with_queued_messages_fails)
+{
+    //arrange
+    size_t poolSize = 4;
+    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    (void)IoTHubClient_LL_SetOption(h, OPTION_MESSAGE_POOL_SIZE, &poolSize);
+    (void)IoTHubClient_LL_SendEventAsync(h, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+    umock_c_reset_all_calls();
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_SetOption(h, OPTION_MESSAGE_POOL_SIZE, &poolSize);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_ERROR, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(h);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_023: [ If no message pool is set, IoTHubClient_LL_GetOption shall return IOTHUB_CLIENT_INVALID_ARG for "message_pool_statistics". ]*/
+TEST_FUNCTION(IoTHubClient_LL_GetOption_message_pool_statistics_without_pool_fails)
+{
+    //arrange
+    void* value = NULL;
+    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    umock_c_reset_all_calls();
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetOption(h, OPTION_MESSAGE_POOL_STATISTICS, &value);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+
+    //cleanup
+    IoTHubClient_LL_Destroy(h);
+}
+
+/*Tests_SRS_IOTHUBCLIENT_LL_31_018: [ IoTHubClient_LL_SendComplete shall return the completed records to the message pool they were taken from, or free them. ]*/
+/*Tests_SRS_IOTHUBCLIENT_LL_31_024: [ "message_pool_statistics" - IoTHubClient_LL_GetOption shall set value to an IOTHUB_CLIENT_POOL_STATISTICS* holding the capacity, the records in use and the hit and miss counts of the message pool, valid until the next call. ]*/
+TEST_FUNCTION(IoTHubClient_LL_GetOption_message_pool_statistics_succeeds)
+{
+    //arrange
+    size_t poolSize = 2;
+    void* value = NULL;
+    IOTHUB_CLIENT_POOL_STATISTICS* statistics;
+    IOTHUB_CLIENT_LL_HANDLE h = IoTHubClient_LL_Create(&TEST_CONFIG);
+    (void)IoTHubClient_LL_SetOption(h, OPTION_MESSAGE_POOL_SIZE, &poolSize);
+    (void)IoTHubClient_LL_SendEventAsync(h, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)1);
+    (void)IoTHubClient_LL_SendEventAsync(h, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)2);
+    (void)IoTHubClient_LL_SendEventAsync(h, TEST_MESSAGE_HANDLE, test_event_confirmation_callback, (void*)3);
+    IoTHubClient_LL_SendComplete(h, g_waitingToSend, IOTHUB_CLIENT_CONFIRMATION_OK); /*what the transport does once the 3 messages are sent*/
+    umock_c_reset_all_calls();
+
+    //act
+    IOTHUB_CLIENT_RESULT result = IoTHubClient_LL_GetOption(h, OPTION_MESSAGE_POOL_STATISTICS, &value);
+
+    //assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK, result);
+    ASSERT_ARE_EQUAL(char_ptr, umock_c_get_expected_calls(), umock_c_get_actual_calls());
+    statistics = (IOTHUB_CLIENT_POOL_STATISTICS*)value;
+    ASSERT_IS_NOT_NULL(statistics);
+    ASSERT_ARE_EQUAL(size_t, 2, statistics->capacity);
+    ASSERT_ARE_EQUAL(size_t, 0, statistics->in_use);
+    ASSERT_ARE_EQUAL(size_t, 2, statistics->hits);
+    ASSERT_ARE_EQUAL(size_t, 1, statistics->misses);
+
+    //cleanup
+    IoTHubClient_LL_Destroy(h);
+}
+
 END_TEST_SUITE(iothubclient_ll_ut)
@@ -0,0 +1,169 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "testrunnerswitcher.h"
+
+/*iothub_message.c and the shared utility code under test are built with GB_MEASURE_MEMORY_FOR_THIS,
+so every allocation they make lands in the functions below*/
+#define GBALLOC_H
+
+void* gballoc_malloc(size_t size);
+void* gballoc_calloc(size_t nmemb, size_t size);
+void* gballoc_realloc(void* ptr, size_t size);
+void gballoc_free(void* ptr);
+
+static size_t allocation_count;
+
+void* gballoc_malloc(size_t size)
+{
+    allocation_count++;
+    return malloc(size);
+}
+
+void* gballoc_calloc(size_t nmemb, size_t size)
+{
+    allocation_count++;
+    return calloc(nmemb, size);
+}
+
+void* gballoc_realloc(void* ptr, size_t size)
+{
+    allocation_count++;
+    return realloc(ptr, size);
+}
+
+void gballoc_free(void* ptr)
+{
+    free(ptr);
+}
+
+#include "iothub_message.h"
+
+#define PERF_MESSAGE_COUNT      100000
+#define PERF_PAYLOAD_SIZE       256
+#define PERF_PROPERTY_COUNT     4
+
+static TEST_MUTEX_HANDLE g_testByTest;
+static TEST_MUTEX_HANDLE g_dllByDll;
+
+static unsigned char payload[PERF_PAYLOAD_SIZE];
+
+static IOTHUB_MESSAGE_HANDLE create_test_message(void)
+{
+    IOTHUB_MESSAGE_HANDLE result = IoTHubMessage_CreateFromByteArray(payload, sizeof(payload));
+    MAP_HANDLE properties;
+    char key[16];
+    size_t i;
+
+    ASSERT_IS_NOT_NULL(result);
+    properties = IoTHubMessage_Properties(result);
+    for (i = 0; i < PERF_PROPERTY_COUNT; i++)
+    {
+        (void)sprintf(key, "property%u", (unsigned int)i);
+        ASSERT_ARE_EQUAL(int, (int)MAP_OK, (int)Map_AddOrUpdate(properties, key, "some property value"));
+    }
+    ASSERT_ARE_EQUAL(int, (int)IOTHUB_MESSAGE_OK, (int)IoTHubMessage_SetMessageId(result, "3820ADAE-E3CA-4065-843A-A6BDE950D8DC"));
+    ASSERT_ARE_EQUAL(int, (int)IOTHUB_MESSAGE_OK, (int)IoTHubMessage_SetCorrelationId(result, "052BA01A-ECBF-48CF-BC7B-64B315D898B7"));
+    return result;
+}
+
+/*does to the message what sending it does: IoTHubClient_LL_SendEventAsync keeps a clone, the transport
+reads the payload and the properties and the clone is destroyed once the send completes*/
+static void send_messages(IOTHUB_MESSAGE_HANDLE message, const char* mode)
+{
+    size_t i;
+    size_t allocations;
+    clock_t start;
+    double elapsed_ms;
+
+    allocation_count = 0;
+    start = clock();
+    for (i = 0; i < PERF_MESSAGE_COUNT; i++)
+    {
+        IOTHUB_MESSAGE_HANDLE clone = IoTHubMessage_Clone(message);
+        const unsigned char* buffer;
+        size_t size;
+        const char* const* keys;
+        const char* const* values;
+        size_t count;
+
+        ASSERT_IS_NOT_NULL(clone);
+        ASSERT_ARE_EQUAL(int, (int)IOTHUB_MESSAGE_OK, (int)IoTHubMessage_GetByteArray(clone, &buffer, &size));
+        ASSERT_ARE_EQUAL(int, (int)MAP_OK, (int)Map_GetInternals(IoTHubMessage_ReadOnlyProperties(clone), &keys, &values, &count));
+        ASSERT_ARE_EQUAL(size_t, (size_t)PERF_PROPERTY_COUNT, count);
+        IoTHubMessage_Destroy(clone);
+    }
+    elapsed_ms = (double)(clock() - start) * 1000.0 / CLOCKS_PER_SEC;
+    allocations = allocation_count;
+
+    (void)printf("%-10s messages=%u allocations/message=%.2f time/message=%.3f us\r\n",
+        mode, (unsigned int)PERF_MESSAGE_COUNT, (double)allocations / PERF_MESSAGE_COUNT, elapsed_ms * 1000.0 / PERF_MESSAGE_COUNT);
+}
+
+BEGIN_TEST_SUITE(iothubmessage_perf)
+
+TEST_SUITE_INITIALIZE(TestClassInitialize)
+{
+    TEST_INITIALIZE_MEMORY_DEBUG(g_dllByDll);
+    g_testByTest = TEST_MUTEX_CREATE();
+    ASSERT_IS_NOT_NULL(g_testByTest);
+}
+
+TEST_SUITE_CLEANUP(TestClassCleanup)
+{
+    TEST_MUTEX_DESTROY(g_testByTest);
+    TEST_DEINITIALIZE_MEMORY_DEBUG(g_dllByDll);
+}
+
+TEST_FUNCTION_INITIALIZE(TestMethodInitialize)
+{
+    if (TEST_MUTEX_ACQUIRE(g_testByTest))
+    {
+        ASSERT_FAIL("Could not acquire test serialization mutex.");
+    }
+}
+
+TEST_FUNCTION_CLEANUP(TestMethodCleanup)
+{
+    TEST_MUTEX_RELEASE(g_testByTest);
+}
+
+TEST_FUNCTION(IoTHubMessage_send_path_allocations_mutable_message)
+{
+    ///arrange
+    IOTHUB_MESSAGE_HANDLE message = create_test_message();
+
+    ///act
+    send_messages(message, "mutable");
+
+    ///assert
+    /*a copy of the message, its buffer, its properties map and both ids is made for every send*/
+    ASSERT_IS_TRUE(allocation_count >= (size_t)PERF_MESSAGE_COUNT * 4);
+
+    ///cleanup
+    IoTHubMessage_Destroy(message);
+}
+
+TEST_FUNCTION(IoTHubMessage_send_path_allocations_immutable_message)
+{
+    ///arrange
+    IOTHUB_MESSAGE_HANDLE message = create_test_message();
+    ASSERT_ARE_EQUAL(int, (int)IOTHUB_MESSAGE_OK, (int)IoTHubMessage_SetImmutable(message));
+
+    ///act
+    send_messages(message, "immutable");
+
+    ///assert
+    /*sending an immutable message shares it, nothing is allocated per send*/
+    ASSERT_ARE_EQUAL(size_t, (size_t)0, allocation_count);
+
+    ///cleanup
+    IoTHubMessage_Destroy(message);
+}
+
+END_TEST_SUITE(iothubmessage_perf)
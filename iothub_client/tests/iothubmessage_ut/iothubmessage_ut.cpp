@@ -384,6 +384,7 @@ DECLARE_GLOBAL_MOCK_METHOD_1(CIoTHubMessageMocks, , size_t, STRING_length, STRIN
 
 DEFINE_MICROMOCK_ENUM_TO_STRING(IOTHUB_MESSAGE_RESULT, IOTHUB_MESSAGE_RESULT_VALUES);
 DEFINE_MICROMOCK_ENUM_TO_STRING(IOTHUBMESSAGE_CONTENT_TYPE, IOTHUBMESSAGE_CONTENT_TYPE_VALUES);
+DEFINE_MICROMOCK_ENUM_TO_STRING(IOTHUB_MESSAGE_PRIORITY, IOTHUB_MESSAGE_PRIORITY_VALUES);
 
 static MICROMOCK_GLOBAL_SEMAPHORE_HANDLE g_dllByDll;
 
@@ -1173,6 +1174,63 @@ BEGIN_TEST_SUITE(iothubmessage_ut)
         ///cleanup
     }
 
+    /*Tests_SRS_IOTHUBMESSAGE_31_021: [ If the message is immutable, IoTHubMessage_Properties shall return NULL. ]*/
+    TEST_FUNCTION(IoTHubMessage_Properties_of_immutable_message_returns_NULL)
+    {
+        ///arrange
+        CIoTHubMessageMocks mocks;
+        auto h = IoTHubMessage_CreateFromString("c, 1");
+        (void)IoTHubMessage_SetImmutable(h);
+        mocks.ResetAllCalls();
+
+        ///act
+        auto r = IoTHubMessage_Properties(h);
+
+        ///assert
+        ASSERT_IS_NULL(r);
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        IoTHubMessage_Destroy(h);
+    }
+
+    /*Tests_SRS_IOTHUBMESSAGE_31_023: [ If iotHubMessageHandle is NULL then IoTHubMessage_ReadOnlyProperties shall return NULL. ]*/
+    TEST_FUNCTION(IoTHubMessage_ReadOnlyProperties_with_NULL_handle_returns_NULL)
+    {
+        ///arrange
+        CIoTHubMessageMocks mocks;
+
+        ///act
+        auto r = IoTHubMessage_ReadOnlyProperties(NULL);
+
+        ///assert
+        ASSERT_IS_NULL(r);
+        mocks.AssertActualAndExpectedCalls();
+    }
+
+    /*Tests_SRS_IOTHUBMESSAGE_31_024: [ Otherwise IoTHubMessage_ReadOnlyProperties shall return the properties map of the message, also when the message is immutable. ]*/
+    TEST_FUNCTION(IoTHubMessage_ReadOnlyProperties_of_immutable_message_does_not_copy_the_properties)
+    {
+        ///arrange
+        CIoTHubMessageMocks mocks;
+        auto h = IoTHubMessage_CreateFromString("c, 1");
+        auto properties = IoTHubMessage_Properties(h);
+        (void)IoTHubMessage_SetImmutable(h);
+        auto r1 = IoTHubMessage_Clone(h);
+        mocks.ResetAllCalls();
+
+        ///act
+        auto r = IoTHubMessage_ReadOnlyProperties(r1);
+
+        ///assert
+        ASSERT_ARE_EQUAL(void_ptr, properties, r);
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        IoTHubMessage_Destroy(r1);
+        IoTHubMessage_Destroy(h);
+    }
+
     /*Tests_SRS_IOTHUBMESSAGE_02_008: [If any parameter is NULL then IoTHubMessage_GetContentType shall return IOTHUBMESSAGE_UNKNOWN.] */
     TEST_FUNCTION(IoTHubMessage_GetContentType_with_NULL_handle_fails)
     {
@@ -1520,4 +1578,345 @@ BEGIN_TEST_SUITE(iothubmessage_ut)
         IoTHubMessage_Destroy(h);
     }
 
+    /*Tests_SRS_IOTHUBMESSAGE_31_005: [ If iotHubMessageHandle is NULL, IoTHubMessage_SetImmutable shall return IOTHUB_MESSAGE_INVALID_ARG. ]*/
+    TEST_FUNCTION(IoTHubMessage_SetImmutable_with_NULL_handle_fails)
+    {
+        ///arrange
+        CIoTHubMessageMocks mocks;
+
+        ///act
+        IOTHUB_MESSAGE_RESULT result = IoTHubMessage_SetImmutable(NULL);
+
+        ///assert
+        ASSERT_ARE_EQUAL(IOTHUB_MESSAGE_RESULT, IOTHUB_MESSAGE_INVALID_ARG, result);
+        mocks.AssertActualAndExpectedCalls();
+    }
+
+    /*Tests_SRS_IOTHUBMESSAGE_31_001: [ IoTHubMessage_SetImmutable shall mark the message as immutable and return IOTHUB_MESSAGE_OK. ]*/
+    /*Tests_SRS_IOTHUBMESSAGE_31_002: [ If iotHubMessageHandle is immutable, IoTHubMessage_Clone shall not copy anything, it shall increment the reference count of iotHubMessageHandle and return iotHubMessageHandle. ]*/
+    TEST_FUNCTION(IoTHubMessage_Clone_of_immutable_message_returns_the_same_handle)
+    {
+        ///arrange
+        CIoTHubMessageMocks mocks;
+        auto h = IoTHubMessage_CreateFromByteArray(c, 1);
+        IOTHUB_MESSAGE_RESULT result = IoTHubMessage_SetImmutable(h);
+        ASSERT_ARE_EQUAL(IOTHUB_MESSAGE_RESULT, IOTHUB_MESSAGE_OK, result);
+        mocks.ResetAllCalls();
+
+        ///act
+        auto r = IoTHubMessage_Clone(h);
+
+        ///assert
+        ASSERT_ARE_EQUAL(void_ptr, h, r);
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        IoTHubMessage_Destroy(r);
+        IoTHubMessage_Destroy(h);
+    }
+
+    /*Tests_SRS_IOTHUBMESSAGE_31_006: [ IoTHubMessage_Destroy shall decrement the reference count of the message and shall only free its resources when the count reaches zero. ]*/
+    TEST_FUNCTION(IoTHubMessage_Destroy_of_shared_message_frees_it_with_the_last_reference)
+    {
+        ///arrange
+        CIoTHubMessageMocks mocks;
+        auto h = IoTHubMessage_CreateFromString("aaaa");
+        (void)IoTHubMessage_SetImmutable(h);
+        auto r = IoTHubMessage_Clone(h);
+        mocks.ResetAllCalls();
+
+        ///act
+        IoTHubMessage_Destroy(r);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+
+        ///arrange
+        mocks.ResetAllCalls();
+        STRICT_EXPECTED_CALL(mocks, Map_Destroy(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, STRING_delete(IGNORED_PTR_ARG))
+            .IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(h));
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
+        STRICT_EXPECTED_CALL(mocks, gballoc_free(IGNORED_PTR_ARG)).IgnoreArgument(1);
+
+        ///act
+        IoTHubMessage_Destroy(h);
+
+        ///assert
+        mocks.AssertActualAndExpectedCalls();
+    }
+
+    /*Tests_SRS_IOTHUBMESSAGE_31_004: [ IoTHubMessage_SetMessageId and IoTHubMessage_SetCorrelationId shall fail and return IOTHUB_MESSAGE_ERROR if the message is immutable. ]*/
+    TEST_FUNCTION(IoTHubMessage_SetMessageId_on_immutable_message_fails)
+    {
+        ///arrange
+        CIoTHubMessageMocks mocks;
+        auto h = IoTHubMessage_CreateFromByteArray(c, 1);
+        (void)IoTHubMessage_SetImmutable(h);
+        mocks.ResetAllCalls();
+
+        ///act
+        IOTHUB_MESSAGE_RESULT result = IoTHubMessage_SetMessageId(h, TEST_MESSAGE_ID);
+
+        ///assert
+        ASSERT_ARE_EQUAL(IOTHUB_MESSAGE_RESULT, IOTHUB_MESSAGE_ERROR, result);
+        ASSERT_IS_NULL(IoTHubMessage_GetMessageId(h));
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        IoTHubMessage_Destroy(h);
+    }
+
+    /*Tests_SRS_IOTHUBMESSAGE_31_004: [ IoTHubMessage_SetMessageId and IoTHubMessage_SetCorrelationId shall fail and return IOTHUB_MESSAGE_ERROR if the message is immutable. ]*/
+    TEST_FUNCTION(IoTHubMessage_SetCorrelationId_on_immutable_message_fails)
+    {
+        ///arrange
+        CIoTHubMessageMocks mocks;
+        auto h = IoTHubMessage_CreateFromByteArray(c, 1);
+        (void)IoTHubMessage_SetImmutable(h);
+        mocks.ResetAllCalls();
+
+        ///act
+        IOTHUB_MESSAGE_RESULT result = IoTHubMessage_SetCorrelationId(h, TEST_MESSAGE_ID);
+
+        ///assert
+        ASSERT_ARE_EQUAL(IOTHUB_MESSAGE_RESULT, IOTHUB_MESSAGE_ERROR, result);
+        ASSERT_IS_NULL(IoTHubMessage_GetCorrelationId(h));
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        IoTHubMessage_Destroy(h);
+    }
+
+    /*Tests_SRS_IOTHUBMESSAGE_31_003: [ A copy made by IoTHubMessage_Clone shall not be immutable. ]*/
+    TEST_FUNCTION(IoTHubMessage_Clone_of_mutable_message_is_mutable)
+    {
+        ///arrange
+        CIoTHubMessageMocks mocks;
+        auto h = IoTHubMessage_CreateFromByteArray(c, 1);
+        auto r = IoTHubMessage_Clone(h);
+        mocks.ResetAllCalls();
+
+        STRICT_EXPECTED_CALL(mocks, mallocAndStrcpy_s(IGNORED_PTR_ARG, TEST_MESSAGE_ID))
+            .IgnoreArgument(1);
+
+        ///act
+        IOTHUB_MESSAGE_RESULT result = IoTHubMessage_SetMessageId(r, TEST_MESSAGE_ID);
+
+        ///assert
+        ASSERT_ARE_NOT_EQUAL(void_ptr, h, r);
+        ASSERT_ARE_EQUAL(IOTHUB_MESSAGE_RESULT, IOTHUB_MESSAGE_OK, result);
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        IoTHubMessage_Destroy(r);
+        IoTHubMessage_Destroy(h);
+    }
+
+    /*Tests_SRS_IOTHUBMESSAGE_31_007: [ A new message shall have the priority IOTHUB_MESSAGE_PRIORITY_NORMAL. ]*/
+    /*Tests_SRS_IOTHUBMESSAGE_31_013: [ IoTHubMessage_GetPriority shall return the priority of the message. ]*/
+    TEST_FUNCTION(IoTHubMessage_GetPriority_of_new_message_returns_NORMAL)
+    {
+        ///arrange
+        CIoTHubMessageMocks mocks;
+        auto h = IoTHubMessage_CreateFromString("aaaa");
+        mocks.ResetAllCalls();
+
+        ///act
+        IOTHUB_MESSAGE_PRIORITY priority = IoTHubMessage_GetPriority(h);
+
+        ///assert
+        ASSERT_ARE_EQUAL(IOTHUB_MESSAGE_PRIORITY, IOTHUB_MESSAGE_PRIORITY_NORMAL, priority);
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        IoTHubMessage_Destroy(h);
+    }
+
+    /*Tests_SRS_IOTHUBMESSAGE_31_012: [ If iotHubMessageHandle is NULL, IoTHubMessage_GetPriority shall return IOTHUB_MESSAGE_PRIORITY_NORMAL. ]*/
+    TEST_FUNCTION(IoTHubMessage_GetPriority_with_NULL_handle_returns_NORMAL)
+    {
+        ///arrange
+        CIoTHubMessageMocks mocks;
+
+        ///act
+        IOTHUB_MESSAGE_PRIORITY priority = IoTHubMessage_GetPriority(NULL);
+
+        ///assert
+        ASSERT_ARE_EQUAL(IOTHUB_MESSAGE_PRIORITY, IOTHUB_MESSAGE_PRIORITY_NORMAL, priority);
+        mocks.AssertActualAndExpectedCalls();
+    }
+
+    /*Tests_SRS_IOTHUBMESSAGE_31_009: [ If iotHubMessageHandle is NULL or priority is not a IOTHUB_MESSAGE_PRIORITY value, IoTHubMessage_SetPriority shall return IOTHUB_MESSAGE_INVALID_ARG. ]*/
+    TEST_FUNCTION(IoTHubMessage_SetPriority_with_NULL_handle_fails)
+    {
+        ///arrange
+        CIoTHubMessageMocks mocks;
+
+        ///act
+        IOTHUB_MESSAGE_RESULT result = IoTHubMessage_SetPriority(NULL, IOTHUB_MESSAGE_PRIORITY_HIGH);
+
+        ///assert
+        ASSERT_ARE_EQUAL(IOTHUB_MESSAGE_RESULT, IOTHUB_MESSAGE_INVALID_ARG, result);
+        mocks.AssertActualAndExpectedCalls();
+    }
+
+    /*Tests_SRS_IOTHUBMESSAGE_31_009: [ If iotHubMessageHandle is NULL or priority is not a IOTHUB_MESSAGE_PRIORITY value, IoTHubMessage_SetPriority shall return IOTHUB_MESSAGE_INVALID_ARG. ]*/
+    TEST_FUNCTION(IoTHubMessage_SetPriority_with_invalid_priority_fails)
+    {
+        ///arrange
+        CIoTHubMessageMocks mocks;
+        auto h = IoTHubMessage_CreateFromByteArray(c, 1);
+        mocks.ResetAllCalls();
+
+        ///act
+        IOTHUB_MESSAGE_RESULT result = IoTHubMessage_SetPriority(h, (IOTHUB_MESSAGE_PRIORITY)42);
+
+        ///assert
+        ASSERT_ARE_EQUAL(IOTHUB_MESSAGE_RESULT, IOTHUB_MESSAGE_INVALID_ARG, result);
+        ASSERT_ARE_EQUAL(IOTHUB_MESSAGE_PRIORITY, IOTHUB_MESSAGE_PRIORITY_NORMAL, IoTHubMessage_GetPriority(h));
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        IoTHubMessage_Destroy(h);
+    }
+
+    /*Tests_SRS_IOTHUBMESSAGE_31_011: [ Otherwise IoTHubMessage_SetPriority shall set the priority of the message and return IOTHUB_MESSAGE_OK. ]*/
+    /*Tests_SRS_IOTHUBMESSAGE_31_008: [ IoTHubMessage_Clone shall copy the priority of the message. ]*/
+    TEST_FUNCTION(IoTHubMessage_SetPriority_succeeds_and_Clone_copies_it)
+    {
+        ///arrange
+        CIoTHubMessageMocks mocks;
+        auto h = IoTHubMessage_CreateFromByteArray(c, 1);
+        mocks.ResetAllCalls();
+
+        ///act
+        IOTHUB_MESSAGE_RESULT result = IoTHubMessage_SetPriority(h, IOTHUB_MESSAGE_PRIORITY_LOW);
+        auto r = IoTHubMessage_Clone(h);
+
+        ///assert
+        ASSERT_ARE_EQUAL(IOTHUB_MESSAGE_RESULT, IOTHUB_MESSAGE_OK, result);
+        ASSERT_ARE_EQUAL(IOTHUB_MESSAGE_PRIORITY, IOTHUB_MESSAGE_PRIORITY_LOW, IoTHubMessage_GetPriority(h));
+        ASSERT_ARE_EQUAL(IOTHUB_MESSAGE_PRIORITY, IOTHUB_MESSAGE_PRIORITY_LOW, IoTHubMessage_GetPriority(r));
+
+        ///cleanup
+        IoTHubMessage_Destroy(r);
+        IoTHubMessage_Destroy(h);
+    }
+
+    /*Tests_SRS_IOTHUBMESSAGE_31_010: [ IoTHubMessage_SetPriority shall fail and return IOTHUB_MESSAGE_ERROR if the message is immutable. ]*/
+    TEST_FUNCTION(IoTHubMessage_SetPriority_on_immutable_message_fails)
+    {
+        ///arrange
+        CIoTHubMessageMocks mocks;
+        auto h = IoTHubMessage_CreateFromByteArray(c, 1);
+        (void)IoTHubMessage_SetImmutable(h);
+        mocks.ResetAllCalls();
+
+        ///act
+        IOTHUB_MESSAGE_RESULT result = IoTHubMessage_SetPriority(h, IOTHUB_MESSAGE_PRIORITY_HIGH);
+
+        ///assert
+        ASSERT_ARE_EQUAL(IOTHUB_MESSAGE_RESULT, IOTHUB_MESSAGE_ERROR, result);
+        ASSERT_ARE_EQUAL(IOTHUB_MESSAGE_PRIORITY, IOTHUB_MESSAGE_PRIORITY_NORMAL, IoTHubMessage_GetPriority(h));
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        IoTHubMessage_Destroy(h);
+    }
+
+    /*Tests_SRS_IOTHUBMESSAGE_31_014: [ A new message shall never expire. ]*/
+    /*Tests_SRS_IOTHUBMESSAGE_31_020: [ IoTHubMessage_GetExpiryTime shall return the expiry time of the message. ]*/
+    TEST_FUNCTION(IoTHubMessage_GetExpiryTime_of_new_message_returns_0)
+    {
+        ///arrange
+        CIoTHubMessageMocks mocks;
+        auto h = IoTHubMessage_CreateFromString("aaaa");
+        mocks.ResetAllCalls();
+
+        ///act
+        time_t expiryTime = IoTHubMessage_GetExpiryTime(h);
+
+        ///assert
+        ASSERT_IS_TRUE(expiryTime == (time_t)0);
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        IoTHubMessage_Destroy(h);
+    }
+
+    /*Tests_SRS_IOTHUBMESSAGE_31_019: [ If iotHubMessageHandle is NULL, IoTHubMessage_GetExpiryTime shall return (time_t)0. ]*/
+    TEST_FUNCTION(IoTHubMessage_GetExpiryTime_with_NULL_handle_returns_0)
+    {
+        ///arrange
+        CIoTHubMessageMocks mocks;
+
+        ///act
+        time_t expiryTime = IoTHubMessage_GetExpiryTime(NULL);
+
+        ///assert
+        ASSERT_IS_TRUE(expiryTime == (time_t)0);
+        mocks.AssertActualAndExpectedCalls();
+    }
+
+    /*Tests_SRS_IOTHUBMESSAGE_31_016: [ If iotHubMessageHandle is NULL, IoTHubMessage_SetExpiryTime shall return IOTHUB_MESSAGE_INVALID_ARG. ]*/
+    TEST_FUNCTION(IoTHubMessage_SetExpiryTime_with_NULL_handle_fails)
+    {
+        ///arrange
+        CIoTHubMessageMocks mocks;
+
+        ///act
+        IOTHUB_MESSAGE_RESULT result = IoTHubMessage_SetExpiryTime(NULL, (time_t)42);
+
+        ///assert
+        ASSERT_ARE_EQUAL(IOTHUB_MESSAGE_RESULT, IOTHUB_MESSAGE_INVALID_ARG, result);
+        mocks.AssertActualAndExpectedCalls();
+    }
+
+    /*Tests_SRS_IOTHUBMESSAGE_31_018: [ Otherwise IoTHubMessage_SetExpiryTime shall set the expiry time of the message and return IOTHUB_MESSAGE_OK. ]*/
+    /*Tests_SRS_IOTHUBMESSAGE_31_015: [ IoTHubMessage_Clone shall copy the expiry time of the message. ]*/
+    TEST_FUNCTION(IoTHubMessage_SetExpiryTime_succeeds_and_Clone_copies_it)
+    {
+        ///arrange
+        CIoTHubMessageMocks mocks;
+        auto h = IoTHubMessage_CreateFromByteArray(c, 1);
+        mocks.ResetAllCalls();
+
+        ///act
+        IOTHUB_MESSAGE_RESULT result = IoTHubMessage_SetExpiryTime(h, (time_t)42);
+        auto r = IoTHubMessage_Clone(h);
+
+        ///assert
+        ASSERT_ARE_EQUAL(IOTHUB_MESSAGE_RESULT, IOTHUB_MESSAGE_OK, result);
+        ASSERT_IS_TRUE(IoTHubMessage_GetExpiryTime(h) == (time_t)42);
+        ASSERT_IS_TRUE(IoTHubMessage_GetExpiryTime(r) == (time_t)42);
+
+        ///cleanup
+        IoTHubMessage_Destroy(r);
+        IoTHubMessage_Destroy(h);
+    }
+
+    /*Tests_SRS_IOTHUBMESSAGE_31_017: [ IoTHubMessage_SetExpiryTime shall fail and return IOTHUB_MESSAGE_ERROR if the message is immutable. ]*/
+    TEST_FUNCTION(IoTHubMessage_SetExpiryTime_on_immutable_message_fails)
+    {
+        ///arrange
+        CIoTHubMessageMocks mocks;
+        auto h = IoTHubMessage_CreateFromByteArray(c, 1);
+        (void)IoTHubMessage_SetImmutable(h);
+        mocks.ResetAllCalls();
+
+        ///act
+        IOTHUB_MESSAGE_RESULT result = IoTHubMessage_SetExpiryTime(h, (time_t)42);
+
+        ///assert
+        ASSERT_ARE_EQUAL(IOTHUB_MESSAGE_RESULT, IOTHUB_MESSAGE_ERROR, result);
+        ASSERT_IS_TRUE(IoTHubMessage_GetExpiryTime(h) == (time_t)0);
+        mocks.AssertActualAndExpectedCalls();
+
+        ///cleanup
+        IoTHubMessage_Destroy(h);
+    }
+
 END_TEST_SUITE(iothubmessage_ut)
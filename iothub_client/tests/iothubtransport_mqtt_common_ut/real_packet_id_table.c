@@ -0,0 +1,13 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#define packet_id_table_create real_packet_id_table_create
+#define packet_id_table_destroy real_packet_id_table_destroy
+#define packet_id_table_add real_packet_id_table_add
+#define packet_id_table_remove real_packet_id_table_remove
+#define packet_id_table_remove_entry real_packet_id_table_remove_entry
+#define packet_id_table_get_count real_packet_id_table_get_count
+
+#define GBALLOC_H
+
+#include "../../src/iothub_client_packet_id_table.c"
@@ -531,6 +531,67 @@ static pfIoTHubTransport_DoWork                         IoTHubTransportHttp_DoWo
 static pfIoTHubTransport_GetSendStatus                  IoTHubTransportHttp_GetSendStatus;
 
 
+/*the properties map of every test message, for both IoTHubMessage_Properties and IoTHubMessage_ReadOnlyProperties*/
+static MAP_HANDLE get_test_message_properties(IOTHUB_MESSAGE_HANDLE iotHubMessageHandle)
+{
+    MAP_HANDLE result2;
+    if(iotHubMessageHandle == TEST_IOTHUB_MESSAGE_HANDLE_1)
+    {
+        result2 = TEST_MAP_EMPTY;
+    }
+    else if(iotHubMessageHandle == TEST_IOTHUB_MESSAGE_HANDLE_2)
+    {
+        result2 = TEST_MAP_EMPTY;
+    }
+    else if(iotHubMessageHandle == TEST_IOTHUB_MESSAGE_HANDLE_3)
+    {
+        result2 = TEST_MAP_EMPTY;
+    }
+    else if(iotHubMessageHandle == TEST_IOTHUB_MESSAGE_HANDLE_4)  /*this is out of bounds message (>256K)*/
+    {
+        result2 = TEST_MAP_EMPTY;
+    }
+    else if(iotHubMessageHandle == TEST_IOTHUB_MESSAGE_HANDLE_5) /*this is a message that just fits*/
+    {
+        result2 = TEST_MAP_EMPTY;
+    }
+    else if (iotHubMessageHandle == TEST_IOTHUB_MESSAGE_HANDLE_6)
+    {
+        result2 = TEST_MAP_1_PROPERTY;
+    }
+    else if(iotHubMessageHandle == TEST_IOTHUB_MESSAGE_HANDLE_7)
+    {
+        result2 = TEST_MAP_2_PROPERTY;
+    }
+    else if(iotHubMessageHandle == TEST_IOTHUB_MESSAGE_HANDLE_8)
+    {
+        result2 = TEST_MAP_3_PROPERTY;
+    }
+    else if(iotHubMessageHandle == TEST_IOTHUB_MESSAGE_HANDLE_9)
+    {
+        result2 = TEST_MAP_EMPTY;
+    }
+    else if(iotHubMessageHandle == TEST_IOTHUB_MESSAGE_HANDLE_10)
+    {
+        result2 = TEST_MAP_EMPTY;
+    }
+    else if(iotHubMessageHandle == TEST_IOTHUB_MESSAGE_HANDLE_11)
+    {
+        result2 = TEST_MAP_1_PROPERTY_A_B;
+    }
+    else if(iotHubMessageHandle == TEST_IOTHUB_MESSAGE_HANDLE_12)
+    {
+        result2 = TEST_MAP_1_PROPERTY_AA_B;
+    }
+    else
+    {
+        /*not expected really*/
+        result2 = NULL;
+        ASSERT_FAIL("not expected");
+    }
+    return result2;
+}
+
 TYPED_MOCK_CLASS(CIoTHubTransportHttpMocks, CGlobalMock)
 {
 public:
@@ -872,61 +933,11 @@ public:
     MOCK_METHOD_END(const char*, result2)
 
     MOCK_STATIC_METHOD_1(, MAP_HANDLE, IoTHubMessage_Properties, IOTHUB_MESSAGE_HANDLE, iotHubMessageHandle)
-        MAP_HANDLE result2;
-        if(iotHubMessageHandle == TEST_IOTHUB_MESSAGE_HANDLE_1)
-        {
-            result2 = TEST_MAP_EMPTY;
-        }
-        else if(iotHubMessageHandle == TEST_IOTHUB_MESSAGE_HANDLE_2)
-        {
-            result2 = TEST_MAP_EMPTY;
-        }
-        else if(iotHubMessageHandle == TEST_IOTHUB_MESSAGE_HANDLE_3)
-        {
-            result2 = TEST_MAP_EMPTY;
-        }
-        else if(iotHubMessageHandle == TEST_IOTHUB_MESSAGE_HANDLE_4)  /*this is out of bounds message (>256K)*/
-        {
-            result2 = TEST_MAP_EMPTY;
-        }
-        else if(iotHubMessageHandle == TEST_IOTHUB_MESSAGE_HANDLE_5) /*this is a message that just fits*/
-        {
-            result2 = TEST_MAP_EMPTY;
-        }
-        else if (iotHubMessageHandle == TEST_IOTHUB_MESSAGE_HANDLE_6)
-        {
-            result2 = TEST_MAP_1_PROPERTY;
-        }
-        else if(iotHubMessageHandle == TEST_IOTHUB_MESSAGE_HANDLE_7)
-        {
-            result2 = TEST_MAP_2_PROPERTY;
-        }
-        else if(iotHubMessageHandle == TEST_IOTHUB_MESSAGE_HANDLE_8)
-        {
-            result2 = TEST_MAP_3_PROPERTY;
-        }
-        else if(iotHubMessageHandle == TEST_IOTHUB_MESSAGE_HANDLE_9)
-        {
-            result2 = TEST_MAP_EMPTY;
-        }
-        else if(iotHubMessageHandle == TEST_IOTHUB_MESSAGE_HANDLE_10)
-        {
-            result2 = TEST_MAP_EMPTY;
-        }
-        else if(iotHubMessageHandle == TEST_IOTHUB_MESSAGE_HANDLE_11)
-        {
-            result2 = TEST_MAP_1_PROPERTY_A_B;
-        }
-        else if(iotHubMessageHandle == TEST_IOTHUB_MESSAGE_HANDLE_12)
-        {
-            result2 = TEST_MAP_1_PROPERTY_AA_B;
-        }
-        else
-        {
-            /*not expected really*/
-            result2 = NULL;
-            ASSERT_FAIL("not expected");
-        }
+        MAP_HANDLE result2 = get_test_message_properties(iotHubMessageHandle);
+    MOCK_METHOD_END(MAP_HANDLE, result2)
+
+    MOCK_STATIC_METHOD_1(, MAP_HANDLE, IoTHubMessage_ReadOnlyProperties, IOTHUB_MESSAGE_HANDLE, iotHubMessageHandle)
+        MAP_HANDLE result2 = get_test_message_properties(iotHubMessageHandle);
     MOCK_METHOD_END(MAP_HANDLE, result2)
 
     MOCK_STATIC_METHOD_2(, IOTHUB_MESSAGE_RESULT, IoTHubMessage_SetMessageId, IOTHUB_MESSAGE_HANDLE, iotHubMessageHandle, const char*, messageId)
@@ -980,6 +991,11 @@ public:
     MOCK_STATIC_METHOD_3(, void, IoTHubClient_LL_SendComplete, IOTHUB_CLIENT_LL_HANDLE, handle, PDLIST_ENTRY, completed, IOTHUB_CLIENT_CONFIRMATION_RESULT, result2)
     MOCK_VOID_METHOD_END()
 
+    MOCK_STATIC_METHOD_2(, bool, IoTHubClient_LL_CompleteIfExpired, IOTHUB_CLIENT_LL_HANDLE, handle, IOTHUB_MESSAGE_LIST*, message)
+        /*the messages given to this mock are expired, they leave waitingToSend like with the real IoTHubClient_LL_CompleteIfExpired*/
+        (void)BASEIMPLEMENTATION::DList_RemoveEntryList(&(message->entry));
+    MOCK_METHOD_END(bool, true)
+
     MOCK_STATIC_METHOD_3(, IOTHUB_CLIENT_RESULT, IoTHubClient_LL_GetOption, IOTHUB_CLIENT_LL_HANDLE, handle, const char*, option, void**, value)
         *value = TEST_STRING_HANDLE;
     MOCK_METHOD_END(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_OK)
@@ -1274,6 +1290,7 @@ DECLARE_GLOBAL_MOCK_METHOD_3(CIoTHubTransportHttpMocks, , IOTHUB_MESSAGE_RESULT,
 DECLARE_GLOBAL_MOCK_METHOD_1(CIoTHubTransportHttpMocks, , const char*, IoTHubMessage_GetString, IOTHUB_MESSAGE_HANDLE, handle);
 DECLARE_GLOBAL_MOCK_METHOD_1(CIoTHubTransportHttpMocks, , void, IoTHubMessage_Destroy, IOTHUB_MESSAGE_HANDLE, iotHubMessageHandle);
 DECLARE_GLOBAL_MOCK_METHOD_1(CIoTHubTransportHttpMocks, , MAP_HANDLE, IoTHubMessage_Properties, IOTHUB_MESSAGE_HANDLE, iotHubMessageHandle)
+DECLARE_GLOBAL_MOCK_METHOD_1(CIoTHubTransportHttpMocks, , MAP_HANDLE, IoTHubMessage_ReadOnlyProperties, IOTHUB_MESSAGE_HANDLE, iotHubMessageHandle)
 DECLARE_GLOBAL_MOCK_METHOD_1(CIoTHubTransportHttpMocks, , IOTHUBMESSAGE_CONTENT_TYPE, IoTHubMessage_GetContentType, IOTHUB_MESSAGE_HANDLE, iotHubMessageHandle)
 DECLARE_GLOBAL_MOCK_METHOD_2(CIoTHubTransportHttpMocks, , IOTHUB_MESSAGE_RESULT, IoTHubMessage_SetMessageId, IOTHUB_MESSAGE_HANDLE, iotHubMessageHandle, const char*, messageId);
 DECLARE_GLOBAL_MOCK_METHOD_1(CIoTHubTransportHttpMocks, , const char*, IoTHubMessage_GetMessageId, IOTHUB_MESSAGE_HANDLE, iotHubMessageHandle);
@@ -1286,6 +1303,7 @@ DECLARE_GLOBAL_MOCK_METHOD_4(CIoTHubTransportHttpMocks, , MAP_RESULT, Map_GetInt
 //IoTHubClient_LL
 DECLARE_GLOBAL_MOCK_METHOD_2(CIoTHubTransportHttpMocks, , bool, IoTHubClient_LL_MessageCallback, IOTHUB_CLIENT_LL_HANDLE, handle, MESSAGE_CALLBACK_INFO*, messageData)
 DECLARE_GLOBAL_MOCK_METHOD_3(CIoTHubTransportHttpMocks, , void, IoTHubClient_LL_SendComplete, IOTHUB_CLIENT_LL_HANDLE, handle, PDLIST_ENTRY, completed, IOTHUB_CLIENT_CONFIRMATION_RESULT, result2)
+DECLARE_GLOBAL_MOCK_METHOD_2(CIoTHubTransportHttpMocks, , bool, IoTHubClient_LL_CompleteIfExpired, IOTHUB_CLIENT_LL_HANDLE, handle, IOTHUB_MESSAGE_LIST*, message)
 DECLARE_GLOBAL_MOCK_METHOD_3(CIoTHubTransportHttpMocks, , IOTHUB_CLIENT_RESULT, IoTHubClient_LL_GetOption, IOTHUB_CLIENT_LL_HANDLE, handle, const char*, option, void**, value)
 
 //BUFFER
@@ -4524,6 +4542,34 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_happy_path_with_empty_waitingToSend_and
     IoTHubTransportHttp_Destroy(handle);
 }
 
+//Tests_SRS_TRANSPORTMULTITHTTP_31_009: [ Before sending, IoTHubTransportHttp_DoWork shall call IoTHubClient_LL_CompleteIfExpired for every message of waitingToSend that has an expiry time, so that the expired messages are completed with IOTHUB_CLIENT_CONFIRMATION_MESSAGE_EXPIRED instead of being sent. ]
+TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_expired_event_item_does_not_send_it)
+{
+    ///arrange
+    CIoTHubTransportHttpMocks mocks;
+    message1.expiryTime = (time_t)1;
+    DList_InsertTailList(&(waitingToSend), &(message1.entry));
+    auto handle = IoTHubTransportHttp_Create(&TEST_CONFIG);
+    (void)IoTHubTransportHttp_Register(handle, &TEST_DEVICE_1, TEST_IOTHUB_CLIENT_LL_HANDLE, TEST_CONFIG.waitingToSend);
+
+    mocks.ResetAllCalls();
+
+    setupDoWorkLoopOnceForOneDevice(mocks);
+
+    STRICT_EXPECTED_CALL(mocks, IoTHubClient_LL_CompleteIfExpired(TEST_IOTHUB_CLIENT_LL_HANDLE, &message1));
+    STRICT_EXPECTED_CALL(mocks, DList_IsListEmpty(&waitingToSend));
+
+    ///act
+    IoTHubTransportHttp_DoWork(handle, TEST_IOTHUB_CLIENT_LL_HANDLE);
+
+    ///assert
+    mocks.AssertActualAndExpectedCalls();
+
+    ///cleanup
+    message1.expiryTime = (time_t)0;
+    IoTHubTransportHttp_Destroy(handle);
+}
+
 //Tests_SRS_TRANSPORTMULTITHTTP_17_083: [ If device is not subscribed then _DoWork shall advance to the next action. ]
 //Tests_SRS_TRANSPORTMULTITHTTP_17_110: [ Otherwise, IoTHubTransportHttp_Subscribe shall set the device so that subsequent calls to DoWork shall not execute HTTP requests. ]
 TEST_FUNCTION(IoTHubTransportHttp_DoWork_happy_path_no_work_check_unsubscribe)
@@ -5372,7 +5418,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_2devices_2nd_has_1_event_item_as_string
 
         STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, ",\"base64Encoded\":false")) /*closing the value of the body*/
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message10.messageHandle));
+        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(message10.messageHandle));
         STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(2)
             .IgnoreArgument(3)
@@ -9389,7 +9435,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_happy_path_succeeds)
 
         STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message1.messageHandle));
+        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(message1.messageHandle));
         STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(2)
             .IgnoreArgument(3)
@@ -9516,7 +9562,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_items_puts_it_back_when_ht
 
         STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message1.messageHandle));
+        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(message1.messageHandle));
         STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(2)
             .IgnoreArgument(3)
@@ -9642,7 +9688,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_items_puts_it_back_when_HT
 
         STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message1.messageHandle));
+        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(message1.messageHandle));
         STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(2)
             .IgnoreArgument(3)
@@ -9769,7 +9815,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_items_puts_it_back_when_BU
 
         STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message1.messageHandle));
+        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(message1.messageHandle));
         STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(2)
             .IgnoreArgument(3)
@@ -9877,7 +9923,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_items_puts_it_back_when_BU
 
         STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message1.messageHandle));
+        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(message1.messageHandle));
         STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(2)
             .IgnoreArgument(3)
@@ -9973,7 +10019,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_when_STRING_concat_wi
 
         STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message1.messageHandle));
+        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(message1.messageHandle));
         STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(2)
             .IgnoreArgument(3)
@@ -10049,7 +10095,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_when_STRING_concat_it
 
         STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message1.messageHandle));
+        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(message1.messageHandle));
         STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(2)
             .IgnoreArgument(3)
@@ -10446,7 +10492,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_bigger_than_256K_path
 
         STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message4.messageHandle));
+        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(message4.messageHandle));
         STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(2)
             .IgnoreArgument(3)
@@ -10527,7 +10573,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_almost255_happy_path_
         STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
             .IgnoreArgument(1);
 
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message5.messageHandle));
+        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(message5.messageHandle));
         STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(2)
             .IgnoreArgument(3)
@@ -10656,7 +10702,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_2_event_items_makes_1_batch_succee
 
         STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message1.messageHandle));
+        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(message1.messageHandle));
         STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(2)
             .IgnoreArgument(3)
@@ -10693,7 +10739,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_2_event_items_makes_1_batch_succee
 
         STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message2.messageHandle));
+        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(message2.messageHandle));
         STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(2)
             .IgnoreArgument(3)
@@ -10826,7 +10872,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_2_event_items_when_the_second_item
 
         STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message1.messageHandle));
+        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(message1.messageHandle));
         STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(2)
             .IgnoreArgument(3)
@@ -10863,7 +10909,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_2_event_items_when_the_second_item
 
         STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message2.messageHandle));
+        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(message2.messageHandle));
         STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(2)
             .IgnoreArgument(3)
@@ -10987,7 +11033,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_2_event_items_when_the_second_item
 
         STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message1.messageHandle));
+        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(message1.messageHandle));
         STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(2)
             .IgnoreArgument(3)
@@ -11023,7 +11069,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_2_event_items_when_the_second_item
             .IgnoreArgument(2);
         STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message2.messageHandle));
+        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(message2.messageHandle));
         STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(2)
             .IgnoreArgument(3)
@@ -11154,7 +11200,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_2_event_items_the_second_one_does_
 
         STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message1.messageHandle));
+        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(message1.messageHandle));
         STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(2)
             .IgnoreArgument(3)
@@ -11191,7 +11237,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_2_event_items_the_second_one_does_
 
         STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "\"")) /*closing the value of the body*/
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message5.messageHandle));
+        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(message5.messageHandle));
         STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(2)
             .IgnoreArgument(3)
@@ -11558,7 +11604,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_items_with_properties_succ
 
     setupIrrelevantMocksForProperties(&mocks, message6.messageHandle);
 
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message6.messageHandle));
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(message6.messageHandle));
     STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_1_PROPERTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreArgument(2)
         .IgnoreArgument(3)
@@ -11613,7 +11659,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_items_with_1_properties_at
 
     setupIrrelevantMocksForProperties(&mocks, message11.messageHandle);
 
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message11.messageHandle));
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(message11.messageHandle));
     STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_1_PROPERTY_A_B, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreArgument(2)
         .IgnoreArgument(3)
@@ -11869,7 +11915,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_2_event_items_with_properties_succ
 
     setupIrrelevantMocksForProperties2(&mocks, message6.messageHandle, message7.messageHandle);
 
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message6.messageHandle));
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(message6.messageHandle));
     STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_1_PROPERTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreArgument(2)
         .IgnoreArgument(3)
@@ -11897,7 +11943,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_2_event_items_with_properties_succ
     STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, "}"))/*closing of the properties*/
         .IgnoreArgument(1);
 
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message7.messageHandle));
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(message7.messageHandle));
     STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_2_PROPERTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreArgument(2)
         .IgnoreArgument(3)
@@ -12148,6 +12194,26 @@ TEST_FUNCTION(IoTHubTransportHttp_SetOption_with_NULL_value_fails)
     IoTHubTransportHttp_Destroy(handle);
 }
 
+//Tests_SRS_TRANSPORTMULTITHTTP_31_006: [ "message_pool_size" shall not be passed to HTTPAPIEX_SetOption, IoTHubTransportHttp_SetOption shall return IOTHUB_CLIENT_INVALID_ARG. ]
+TEST_FUNCTION(IoTHubTransportHttp_SetOption_message_pool_size_is_not_passed_to_HTTPAPIEX)
+{
+    ///arrange
+    CIoTHubTransportHttpMocks mocks;
+    auto handle = IoTHubTransportHttp_Create(&TEST_CONFIG);
+    size_t poolSize = 8;
+    mocks.ResetAllCalls();
+
+    ///act
+    auto result = IoTHubTransportHttp_SetOption(handle, OPTION_MESSAGE_POOL_SIZE, &poolSize);
+
+    ///assert
+    ASSERT_ARE_EQUAL(IOTHUB_CLIENT_RESULT, IOTHUB_CLIENT_INVALID_ARG, result);
+    mocks.AssertActualAndExpectedCalls();
+
+    ///cleanup
+    IoTHubTransportHttp_Destroy(handle);
+}
+
 //Tests_SRS_TRANSPORTMULTITHTTP_17_119: [ The following table translates HTTPAPIEX return codes to IOTHUB_CLIENT_RESULT return codes: ]
 //Tests_SRS_TRANSPORTMULTITHTTP_17_118: [ Otherwise, IoTHubTransport_Http shall call HTTPAPIEX_SetOption with the same parameters and return the translated code. ]
 TEST_FUNCTION(IoTHubTransportHttp_SetOption_succeeds_when_HTTPAPIEX_succeeds)
@@ -13480,7 +13546,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_no_properties_unbatch
         .IgnoreArgument(1);
 
     /*no properties, so no more headers*/
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(TEST_IOTHUB_MESSAGE_HANDLE_1));
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(TEST_IOTHUB_MESSAGE_HANDLE_1));
     STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreArgument(2)
         .IgnoreArgument(3)
@@ -13574,7 +13640,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_no_properties_string_
         .IgnoreArgument(1);
 
     /*no properties, so no more headers*/
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(TEST_IOTHUB_MESSAGE_HANDLE_10));
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(TEST_IOTHUB_MESSAGE_HANDLE_10));
     STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreArgument(2)
         .IgnoreArgument(3)
@@ -13663,7 +13729,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_unbatched_happy_path_at_th
         .IgnoreArgument(1);
 
     /*1 property*/
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(TEST_IOTHUB_MESSAGE_HANDLE_11));
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(TEST_IOTHUB_MESSAGE_HANDLE_11));
     STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_1_PROPERTY_A_B, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreArgument(2)
         .IgnoreArgument(3)
@@ -13839,7 +13905,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_
         .IgnoreArgument(1);
 
     /*no properties, so no more headers*/
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(TEST_IOTHUB_MESSAGE_HANDLE_6));
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(TEST_IOTHUB_MESSAGE_HANDLE_6));
     STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_1_PROPERTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreArgument(2)
         .IgnoreArgument(3)
@@ -13940,7 +14006,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_
         .IgnoreArgument(1);
 
     /*no properties, so no more headers*/
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(TEST_IOTHUB_MESSAGE_HANDLE_6));
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(TEST_IOTHUB_MESSAGE_HANDLE_6));
     STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_1_PROPERTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreArgument(2)
         .IgnoreArgument(3)
@@ -14030,7 +14096,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_
         .IgnoreArgument(1);
 
     /*no properties, so no more headers*/
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(TEST_IOTHUB_MESSAGE_HANDLE_6));
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(TEST_IOTHUB_MESSAGE_HANDLE_6));
     STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_1_PROPERTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreArgument(2)
         .IgnoreArgument(3)
@@ -14120,7 +14186,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_
         .IgnoreArgument(1);
 
     /*no properties, so no more headers*/
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(TEST_IOTHUB_MESSAGE_HANDLE_6));
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(TEST_IOTHUB_MESSAGE_HANDLE_6));
     STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_1_PROPERTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreArgument(2)
         .IgnoreArgument(3)
@@ -14191,7 +14257,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_
         .IgnoreArgument(1);
 
     /*no properties, so no more headers*/
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(TEST_IOTHUB_MESSAGE_HANDLE_6));
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(TEST_IOTHUB_MESSAGE_HANDLE_6));
     STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_1_PROPERTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreArgument(2)
         .IgnoreArgument(3)
@@ -14255,7 +14321,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_
         .IgnoreArgument(1);
 
     /*no properties, so no more headers*/
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(TEST_IOTHUB_MESSAGE_HANDLE_6));
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(TEST_IOTHUB_MESSAGE_HANDLE_6));
     STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_1_PROPERTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreArgument(2)
         .IgnoreArgument(3)
@@ -14317,7 +14383,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_
         .IgnoreArgument(1);
 
     /*no properties, so no more headers*/
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(TEST_IOTHUB_MESSAGE_HANDLE_6));
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(TEST_IOTHUB_MESSAGE_HANDLE_6));
     STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_1_PROPERTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreArgument(2)
         .IgnoreArgument(3)
@@ -14375,7 +14441,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_
         .IgnoreArgument(1);
 
     /*no properties, so no more headers*/
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(TEST_IOTHUB_MESSAGE_HANDLE_6));
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(TEST_IOTHUB_MESSAGE_HANDLE_6));
     STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_1_PROPERTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreArgument(2)
         .IgnoreArgument(3)
@@ -14429,7 +14495,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_1_property_unbatched_
         .IgnoreArgument(1);
 
     /*no properties, so no more headers*/
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(TEST_IOTHUB_MESSAGE_HANDLE_6));
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(TEST_IOTHUB_MESSAGE_HANDLE_6));
     STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_1_PROPERTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreArgument(2)
         .IgnoreArgument(3)
@@ -14642,7 +14708,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_as_string_happy_path_
 
         STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, ",\"base64Encoded\":false")) /*closing the value of the body*/
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message10.messageHandle));
+        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(message10.messageHandle));
         STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(2)
             .IgnoreArgument(3)
@@ -14765,7 +14831,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_as_string_when_string
 
         STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, ",\"base64Encoded\":false")) /*closing the value of the body*/
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message10.messageHandle));
+        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(message10.messageHandle));
         STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(2)
             .IgnoreArgument(3)
@@ -14829,7 +14895,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_with_1_event_item_as_string_when_Map_Ge
 
         STRICT_EXPECTED_CALL(mocks, STRING_concat(IGNORED_PTR_ARG, ",\"base64Encoded\":false")) /*closing the value of the body*/
             .IgnoreArgument(1);
-        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(message10.messageHandle));
+        STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(message10.messageHandle));
         STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_EMPTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
             .IgnoreArgument(2)
             .IgnoreArgument(3)
@@ -15471,7 +15537,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_GetMessageId_succeeds)
         .IgnoreArgument(1);
 
     /*no properties, so no more headers*/
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(TEST_IOTHUB_MESSAGE_HANDLE_6));
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(TEST_IOTHUB_MESSAGE_HANDLE_6));
     STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_1_PROPERTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreArgument(2)
         .IgnoreArgument(3)
@@ -15573,7 +15639,7 @@ TEST_FUNCTION(IoTHubTransportHttp_DoWork_GetCorrelationId_succeeds)
         .IgnoreArgument(1);
 
     /*no properties, so no more headers*/
-    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_Properties(TEST_IOTHUB_MESSAGE_HANDLE_6));
+    STRICT_EXPECTED_CALL(mocks, IoTHubMessage_ReadOnlyProperties(TEST_IOTHUB_MESSAGE_HANDLE_6));
     STRICT_EXPECTED_CALL(mocks, Map_GetInternals(TEST_MAP_1_PROPERTY, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
         .IgnoreArgument(2)
         .IgnoreArgument(3)
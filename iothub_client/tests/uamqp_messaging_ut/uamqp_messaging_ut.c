@@ -145,7 +145,7 @@ void set_exp_calls_for_addPropertiesTouAMQPMessage(bool has_message_id, bool has
 
 static void set_exp_calls_for_addApplicationPropertiesTouAMQPMessage(size_t number_of_app_properties)
 {
-	STRICT_EXPECTED_CALL(IoTHubMessage_Properties(TEST_IOTHUB_MESSAGE_HANDLE));
+	STRICT_EXPECTED_CALL(IoTHubMessage_ReadOnlyProperties(TEST_IOTHUB_MESSAGE_HANDLE));
 	STRICT_EXPECTED_CALL(Map_GetInternals(TEST_MAP_HANDLE, IGNORED_PTR_ARG, IGNORED_PTR_ARG, IGNORED_PTR_ARG))
 		.IgnoreArgument(2).IgnoreArgument(3).IgnoreArgument(4)
 		.CopyOutArgumentBuffer_keys(&TEST_MAP_KEYS, sizeof(char**))
@@ -332,6 +332,8 @@ TEST_SUITE_INITIALIZE(TestClassInitialize)
 
 	REGISTER_GLOBAL_MOCK_RETURN(IoTHubMessage_Properties, TEST_MAP_HANDLE);
 	REGISTER_GLOBAL_MOCK_FAIL_RETURN(IoTHubMessage_Properties, NULL);
+	REGISTER_GLOBAL_MOCK_RETURN(IoTHubMessage_ReadOnlyProperties, TEST_MAP_HANDLE);
+	REGISTER_GLOBAL_MOCK_FAIL_RETURN(IoTHubMessage_ReadOnlyProperties, NULL);
 
 	REGISTER_GLOBAL_MOCK_FAIL_RETURN(Map_GetInternals, MAP_ERROR);
 	REGISTER_GLOBAL_MOCK_FAIL_RETURN(amqpvalue_create_map, NULL);
@@ -436,8 +438,8 @@ TEST_FUNCTION_CLEANUP(TestMethodCleanup)
 // Tests_SRS_UAMQP_MESSAGING_09_077: [The uAMQP correlation-id AMQP_VALUE instance shall be destroyed using amqpvalue_destroy().]
 // Tests_SRS_UAMQP_MESSAGING_09_078: [The updated PROPERTIES_HANDLE instance shall be set on the uAMQP message using message_set_properties()]
 // Tests_SRS_UAMQP_MESSAGING_09_099: [The uAMQP message properties (obtained with message_get_properties()) shall be destroyed by calling properties_destroy().]
-// Tests_SRS_UAMQP_MESSAGING_09_080: [The IOTHUB_MESSAGE_HANDLE properties shall be obtained by calling IoTHubMessage_Properties.]
-// Tests_SRS_UAMQP_MESSAGING_09_082: [The actual keys and values, as well as the number of properties shall be obtained by calling Map_GetInternals on the handle obtained from IoTHubMessage_Properties.]
+// Tests_SRS_UAMQP_MESSAGING_09_080: [The IOTHUB_MESSAGE_HANDLE properties shall be obtained by calling IoTHubMessage_ReadOnlyProperties.]
+// Tests_SRS_UAMQP_MESSAGING_09_082: [The actual keys and values, as well as the number of properties shall be obtained by calling Map_GetInternals on the handle obtained from IoTHubMessage_ReadOnlyProperties.]
 // Tests_SRS_UAMQP_MESSAGING_09_085: [If the number of properties is greater than 0, message_create_from_iothub_message() shall iterate through all the properties and add them to the uAMQP message.]
 // Tests_SRS_UAMQP_MESSAGING_09_086: [A uAMQP property map shall be created by calling amqpvalue_create_map().]
 // Tests_SRS_UAMQP_MESSAGING_09_088: [An AMQP_VALUE instance shall be created using amqpvalue_create_string() to hold each uAMQP property name.]
@@ -573,7 +575,7 @@ TEST_FUNCTION(message_create_from_iothub_message_no_msg_hdl_props_success)
 // Tests_SRS_UAMQP_MESSAGING_09_074: [If amqpvalue_create_string() fails, message_create_from_iothub_message() shall fail and return immediately.]
 // Tests_SRS_UAMQP_MESSAGING_09_076: [If properties_set_correlation_id() fails, message_create_from_iothub_message() shall fail and return immediately.]
 // Tests_SRS_UAMQP_MESSAGING_09_079: [If message_set_properties() fails, message_create_from_iothub_message() shall fail and return immediately.]
-// Tests_SRS_UAMQP_MESSAGING_09_081: [If IoTHubMessage_Properties() fails, message_create_from_iothub_message() shall fail and return immediately..]
+// Tests_SRS_UAMQP_MESSAGING_09_081: [If IoTHubMessage_ReadOnlyProperties() fails, message_create_from_iothub_message() shall fail and return immediately..]
 // Tests_SRS_UAMQP_MESSAGING_09_083: [If Map_GetInternals fails, message_create_from_iothub_message() shall fail and return immediately..]
 // Tests_SRS_UAMQP_MESSAGING_09_087: [If amqpvalue_create_map() fails, message_create_from_iothub_message() shall fail and return immediately.]
 // Tests_SRS_UAMQP_MESSAGING_09_089: [If amqpvalue_create_string() fails, message_create_from_iothub_message() shall fail and return immediately..]